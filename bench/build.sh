@@ -0,0 +1,120 @@
+#!/bin/sh
+# build.sh - Builds the benches on the host into $OUT (/tmp/sb16-bench by
+# default). The driver is built from a copy with its CRLF line ends and
+# its asm taken out: the interrupt's entry and exit, which the card model
+# stands in for by calling sb16_interrupt, and hlt, which becomes
+# host_halt. Everything else is the tree's own code.
+# Written by Soumithri Bala.
+
+set -e
+
+BENCH=$(cd "$(dirname "$0")" && pwd)
+REPO=$(dirname "$BENCH")
+OUT=${OUT:-/tmp/sb16-bench}
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+OPT=${OPT:--O2 -g}
+
+# the user-level code sees the host's system calls; the driver is linked
+# low so (int32_t)buffer holds its address
+CFLAGS="$OPT -std=gnu99 -Wall -Wno-int-to-pointer-cast -I$BENCH/host -I$REPO"
+CXXFLAGS="$OPT -std=c++17 -Wall -Wno-int-to-pointer-cast -I$BENCH/host -I$REPO"
+LDFLAGS="-no-pie -lm"
+
+mkdir -p "$OUT"
+
+tr -d '\r' < "$REPO/sb16_driver.h" > "$OUT/sb16.h"
+tr -d '\r' < "$REPO/sb16_driver.c" |
+    sed -e 's/asm volatile("pushal");//' \
+        -e 's/asm volatile("sti; hlt; cli" : : : "memory");/host_halt();/' \
+        -e '/asm volatile(" *\\n\\$/,/^ *");$/d' > "$OUT/sb16_host.c"
+$CC $OPT -std=gnu99 -w -fno-builtin -I"$OUT" -I"$BENCH/host/kernel" \
+    -c "$OUT/sb16_host.c" -o "$OUT/sb16_host.o"
+$CC $OPT -std=gnu99 -Wall -c "$BENCH/host/port.c" -o "$OUT/port.o"
+
+# obj <source> -- compiles a bench or tree source into $OUT
+obj() {
+    case "$1" in
+    *.cpp) $CXX $CXXFLAGS $EXTRA -c "$1" -o "$OUT/$(basename "$1" .cpp).o" ;;
+    *) $CC $CFLAGS -c "$1" -o "$OUT/$(basename "$1" .c).o" ;;
+    esac
+}
+
+# the user-level code of the tree, less the player's main
+TREE=""
+for src in "$REPO"/*.c; do
+    case "$(basename "$src")" in
+    sb16_driver.c|user_level_program.c) ;;
+    *) obj "$src"; TREE="$TREE $OUT/$(basename "$src" .c).o" ;;
+    esac
+done
+rm -f "$OUT/libtree.a"
+ar rcs "$OUT/libtree.a" $TREE
+
+# bench <name> <sources...> -- builds a bench on the tree, the driver,
+# the card model and the host's file calls
+bench() {
+    name=$1
+    shift
+    objs=""
+    for src in "$@" "$BENCH/host/sys_sb16.c" "$BENCH/host/files.c"; do
+        obj "$src"
+        objs="$objs $OUT/$(basename "${src%.*}").o"
+    done
+    $CXX -o "$OUT/$name" $objs "$OUT/libtree.a" "$OUT/sb16_host.o" "$OUT/port.o" $LDFLAGS
+    echo "$OUT/$name"
+}
+
+bench pull_bench "$BENCH/pull_bench.c"
+bench devfile_bench "$BENCH/devfile_bench.c"
+bench fm_bench "$BENCH/fm_bench.c"
+bench uart_bench "$BENCH/uart_bench.c"
+bench wt_bench "$BENCH/wt_bench.c"
+bench tracker_bench "$BENCH/tracker_bench.c"
+bench stretch_bench "$BENCH/stretch_bench.c"
+bench downmix_bench "$BENCH/downmix_bench.c"
+bench loop_bench "$BENCH/loop_bench.c"
+bench xfade_bench "$BENCH/xfade_bench.c"
+bench eq_bench "$BENCH/eq_bench.c"
+bench lim_bench "$BENCH/lim_bench.c"
+bench meter_bench "$BENCH/meter_bench.c"
+bench silence_bench "$BENCH/silence_bench.c"
+bench loud_bench "$BENCH/loud_bench.c"
+bench mp3_bench "$BENCH/mp3_bench.c"
+bench ogg_bench "$BENCH/ogg_bench.c"
+bench seek_bench "$BENCH/seek_bench.c"
+bench jump_bench "$BENCH/jump_bench.c"
+bench standby_bench "$BENCH/standby_bench.c"
+
+# the stream bench compares loops that compile to the same instructions,
+# so their placement is pinned; otherwise 32-byte branch boundaries alone
+# swing them by up to 2x
+EXTRA="-Wa,-mbranches-within-32B-boundaries -falign-loops=32"
+bench stream_bench "$BENCH/stream_bench.cpp"
+EXTRA=
+
+# gen <file> <script> [args...] -- makes one of the benches' input files,
+# once
+gen() {
+    out=$1
+    script=$2
+    shift 2
+    [ -f "$OUT/$out" ] || python3 -B "$BENCH/gen/$script" "$OUT/$out" "$@" || rm -f "$OUT/$out"
+}
+gen dense.mid dense_mid.py
+gen pcm.wav pcm_wav.py
+gen pcm48.wav pcm_wav.py 60 48000
+gen loop.wav loop_wav.py
+gen bank.sf2 bank_sf2.py
+for n in 1 8 16 32 64; do
+    gen poly$n.mid poly_mid.py $n
+done
+for n in 4 8 16 32; do
+    gen mod$n.mod mod_gen.py $n
+done
+for n in 2 3 4 5 6 7 8; do
+    gen multi$n.wav multi_wav.py $n
+done
+for layout in album hidden hiss; do
+    gen $layout.wav quiet_wav.py $layout
+done
@@ -0,0 +1,310 @@
+/* devfile_bench.c - The card's device file on the driver and the card
+ * model. Streams a counting pattern in writes of 64 bytes to 64 KB and
+ * checks the DMA played it exactly, then runs a writer that stalls, a
+ * stream of just a header, one shorter than a period, and a refill
+ * interrupted by the next boundary.
+ *   devfile_bench
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "port.h"
+#include "sys_sb16.h"
+
+#define HEADER_SIZE         44
+#define RATE                48000
+#define FRAME_SIZE          4
+#define STREAM_SECS         6
+#define STREAM_BYTES        (RATE * FRAME_SIZE * STREAM_SECS)
+/* streams end short of a period, so the last one is padded */
+#define STREAM_SHORT        1000
+#define WRITE_MIN           64
+#define WRITE_MAX           65536
+#define WRITE_STEP          4
+/* a write that sleeps lets more than this pass */
+#define SLEEP_NS            (100 * NS_PER_US)
+#define STALL_WRITE         4096
+#define STALL_AT            4
+#define STALL_PERIODS       6
+#define STALL_LEN           8
+#define SHORT_BYTES         5000
+#define RING_PERIODS        4
+/* how far before the next boundary the late interrupt is let in */
+#define NEST_LEAD           (50 * NS_PER_US)
+
+/* the driver's state the checks look at */
+extern volatile int32_t in_use;
+extern volatile uint32_t fd_underruns;
+extern volatile uint32_t fd_tail;
+
+static int16_t src[STREAM_BYTES / 2];
+
+
+/* local function definitions */
+static void header(uint8_t* h);
+static int32_t played(uint32_t len);
+static int32_t sizes(void);
+static void stall(void);
+static int32_t edges(void);
+static int32_t nested(void);
+static uint64_t period_ns(void);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the checks
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if they passed, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(void) {
+
+    uint32_t i;
+    int32_t ok;
+
+    for (i = 0; i < STREAM_BYTES / 2; i++) src[i] = (int16_t)(i * 7 + 1);
+
+    ok = sizes();
+    stall();
+    ok &= edges();
+    ok &= nested();
+
+    return ok ? 0 : 1;
+}
+
+
+/* header
+ *
+ * 		DESCRIPTION: makes the WAV header of a 48 kHz 16-bit stereo stream
+ *		INPUTS: none
+ *		OUTPUTS: h -- the header
+ *		RETURN VALUE: none
+ */
+static void header(uint8_t* h) {
+
+    static const uint8_t wav[HEADER_SIZE] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0,
+        0x80, 0xBB, 0, 0, 0x00, 0xEE, 0x02, 0, 4, 0, 16, 0,
+        'd', 'a', 't', 'a', 0, 0, 0, 0
+    };
+    uint32_t i;
+
+    for (i = 0; i < HEADER_SIZE; i++) h[i] = wav[i];
+}
+
+
+/* played
+ *
+ * 		DESCRIPTION: checks that the DMA played the start of the pattern
+ *		             and then only silence
+ *		INPUTS: len -- bytes of the pattern written
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if so
+ */
+static int32_t played(uint32_t len) {
+
+    uint64_t n, i;
+    int16_t* rec = port_recorded(&n);
+
+    if (n * 2 < len) return 0;
+    for (i = 0; i < n; i++) {
+        if (rec[i] != (i < len / 2 ? src[i] : 0)) return 0;
+    }
+
+    return 1;
+}
+
+
+/* sizes
+ *
+ * 		DESCRIPTION: streams the pattern in writes of each size
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every stream played exactly
+ *		SIDE EFFECTS: prints a line a size
+ */
+static int32_t sizes(void) {
+
+    uint8_t h[HEADER_SIZE];
+    uint32_t len = STREAM_BYTES - STREAM_SHORT;
+    uint32_t size, off, n, writes, sleeps;
+    struct timespec a, b;
+    uint64_t before;
+    double ns;
+    int32_t fd, exact, ok = 1;
+
+    header(h);
+    printf("write size   writes   host ns/write   host MB/s   sleeps   underruns   exact\n");
+
+    for (size = WRITE_MIN; size <= WRITE_MAX; size *= WRITE_STEP) {
+        port_record(1);
+        fd = sys_dev_open();
+        sys_dev_write(fd, h, HEADER_SIZE);
+
+        writes = sleeps = 0;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (off = 0; off < len; off += n) {
+            n = len - off < size ? len - off : size;
+            before = port_now;
+            if (sys_dev_write(fd, (uint8_t*)src + off, n) != (int32_t)n) {
+                printf("short write\n");
+                break;
+            }
+            if (port_now - before > SLEEP_NS) sleeps++;
+            writes++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        sys_dev_close(fd);
+        port_record(0);
+
+        ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+        exact = played(len);
+        ok &= exact;
+        printf("%10u %8u %15.1f %11.1f %8u %11u   %s\n", size, writes, ns / writes,
+               len / ns * 1e3, sleeps, fd_underruns, exact ? "yes" : "NO");
+    }
+
+    return ok;
+}
+
+
+/* stall
+ *
+ * 		DESCRIPTION: a writer that stops for longer than the ring lasts
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the result
+ */
+static void stall(void) {
+
+    uint8_t h[HEADER_SIZE];
+    uint32_t off, len = PORT_HALF_SIZE * STALL_LEN;
+    uint64_t n;
+    int32_t fd;
+
+    header(h);
+    port_record(1);
+    fd = sys_dev_open();
+    sys_dev_write(fd, h, HEADER_SIZE);
+    for (off = 0; off < len; off += STALL_WRITE) {
+        sys_dev_write(fd, (uint8_t*)src + off, STALL_WRITE);
+        if (off + STALL_WRITE == PORT_HALF_SIZE * STALL_AT) port_advance(period_ns() * STALL_PERIODS);
+    }
+    sys_dev_close(fd);
+    port_record(0);
+    port_recorded(&n);
+
+    printf("stall of %d periods: %u underruns, %llu halves played for %d written\n",
+           STALL_PERIODS, fd_underruns, (unsigned long long)n / PORT_HALF_WORDS, STALL_LEN);
+}
+
+
+/* edges
+ *
+ * 		DESCRIPTION: a stream of just its header, and one shorter than a
+ *		             period
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if both released the card and the short one
+ *		              played exactly
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t edges(void) {
+
+    uint8_t h[HEADER_SIZE];
+    uint64_t n, before;
+    int32_t fd, exact, empty;
+
+    header(h);
+    port_record(1);
+    fd = sys_dev_open();
+    sys_dev_write(fd, h, HEADER_SIZE);
+    sys_dev_close(fd);
+    port_record(0);
+    port_recorded(&n);
+    empty = !in_use && !n;
+    printf("header only: card %s, %llu samples played\n", in_use ? "held" : "released",
+           (unsigned long long)n);
+
+    port_record(1);
+    fd = sys_dev_open();
+    sys_dev_write(fd, h, HEADER_SIZE);
+    before = port_now;
+    sys_dev_write(fd, src, SHORT_BYTES);
+    sys_dev_close(fd);
+    port_record(0);
+    exact = played(SHORT_BYTES);
+    printf("%d bytes: closed after %.3f s, card %s, %s\n", SHORT_BYTES,
+           (double)(port_now - before) / NS_PER_SEC, in_use ? "held" : "released",
+           exact ? "exact" : "WRONG");
+
+    return empty && exact && !in_use;
+}
+
+
+/* nested
+ *
+ * 		DESCRIPTION: holds interrupts off over a boundary until just
+ *		             before the next, so the refill the late interrupt
+ *		             starts is itself interrupted by that boundary
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if both refills took their period and the stream
+ *		              played exactly
+ *		SIDE EFFECTS: prints the result
+ */
+static int32_t nested(void) {
+
+    uint8_t h[HEADER_SIZE];
+    uint32_t len = PORT_HALF_SIZE * (RING_PERIODS + 2) * 2;
+    uint32_t tail, taken;
+    uint64_t next;
+    port_stats_t s0, s1;
+    int32_t fd, exact;
+
+    header(h);
+    port_record(1);
+    fd = sys_dev_open();
+    sys_dev_write(fd, h, HEADER_SIZE);
+
+    /* both halves and a full ring */
+    sys_dev_write(fd, src, PORT_HALF_SIZE * (RING_PERIODS + 2));
+
+    next = port_boundary(port_halves() + 1);
+    port_advance(next - port_now - NS_PER_US);
+    port_stats(&s0);
+    tail = fd_tail;
+    port_masked(period_ns() - NEST_LEAD + NS_PER_US);
+    taken = (fd_tail - tail) / PORT_HALF_SIZE;
+    port_stats(&s1);
+
+    sys_dev_write(fd, (uint8_t*)src + PORT_HALF_SIZE * (RING_PERIODS + 2),
+                  len - PORT_HALF_SIZE * (RING_PERIODS + 2));
+    sys_dev_close(fd);
+    port_record(0);
+    exact = played(len);
+
+    printf("refill interrupted by the next boundary: %llu nested interrupts, "
+           "%u periods taken from the ring, %s\n",
+           (unsigned long long)(s1.nested - s0.nested), taken, exact ? "exact" : "WRONG");
+
+    return s1.nested > s0.nested && taken == 2 && exact;
+}
+
+
+/* period_ns
+ *
+ * 		DESCRIPTION: length of a period of the bench's streams
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static uint64_t period_ns(void) {
+
+    return (uint64_t)PORT_HALF_SIZE * NS_PER_SEC / (RATE * FRAME_SIZE);
+}
@@ -0,0 +1,114 @@
+/* downmix_bench.c - The multichannel downmix (wav.c) on the host. Fills
+ * periods from each file to its end, best of three, and times a period
+ * against the same fill of the first file, which should be stereo and so
+ * read straight.
+ *   downmix_bench multi2.wav multi3.wav ... multi8.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "port.h"
+#include "wav.h"
+
+#define REPEATS             3
+#define PCT                 100
+
+static wav_t wav;
+static int8_t half[PORT_HALF_SIZE];
+
+
+/* local function definitions */
+static int32_t play(const char* name, double* ns, uint32_t* channels);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each file
+ *		INPUTS: argv[1] -- stereo WAV file
+ *		        argv[2...] -- WAV files of more channels
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file opened, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    double ns, best, base = 0, period_ns;
+    uint32_t channels;
+    int32_t i, r;
+
+    if (argc < 3) {
+        printf("usage: downmix_bench multi2.wav multi3.wav ... multi8.wav\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        for (best = 0, r = 0; r < REPEATS; r++) {
+            if (play(argv[i], &ns, &channels) == -1) {
+                printf("%s: can't open\n", argv[i]);
+                return 1;
+            }
+            if (!r || ns < best) best = ns;
+        }
+        if (i == 1) base = best;
+
+        period_ns = (double)NS_PER_SEC * PORT_HALF_SIZE / wav.block_align / wav.sample_rate;
+        printf("%s: %u channels, %.1f host us a period, %.2f ns a frame over the straight "
+               "read, %.3f%% of a period\n", argv[i], channels, best / NS_PER_US,
+               (best - base) / (PORT_HALF_SIZE / wav.block_align), best / period_ns * PCT);
+    }
+
+    return 0;
+}
+
+
+/* play
+ *
+ * 		DESCRIPTION: fills periods from a file to its end
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: ns -- host ns a full period
+ *		         channels -- channels in the file
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t play(const char* name, double* ns, uint32_t* channels) {
+
+    struct timespec a, b;
+    double sum = 0;
+    uint32_t periods = 0;
+    int32_t n;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) return -1;
+    *channels = wav.src_channels ? wav.src_channels : wav.nchannels;
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        n = wav_fill(&wav, half, PORT_HALF_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        if (n == PORT_HALF_SIZE) {
+            sum += host_ns(&a, &b);
+            periods++;
+        }
+    } while (n == PORT_HALF_SIZE);
+    wav_close(&wav);
+
+    if (!periods) return -1;
+    *ns = sum / periods;
+
+    return 0;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
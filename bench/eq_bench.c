@@ -0,0 +1,128 @@
+/* eq_bench.c - The equalizer (eq.c) on the host. Filters periods of a
+ * loud stereo bus through 0 to 8 peak bands and times each chain, then
+ * fits a line through the results to find what a band costs a frame and
+ * what a full chain costs a period at 44.1 kHz.
+ *   eq_bench
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "eq.h"
+#include "port.h"
+
+#define RATE                44100
+#define CHANNELS            2
+#define FRAMES              (PORT_HALF_WORDS / CHANNELS)
+#define PERIODS             200
+#define REPEATS             5
+#define BAND_GAIN           60      /* +6 dB */
+#define BAND_Q              141
+#define LOW_FREQ            60
+#define PCT                 100
+
+static eq_t eq;
+static int32_t src[FRAMES * CHANNELS];
+static int32_t bus[FRAMES * CHANNELS];
+
+
+/* local function definitions */
+static double chain(int32_t nbands);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each length of chain, then fits the cost per band
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0
+ *		SIDE EFFECTS: prints the results
+ */
+int main(void) {
+
+    double x, y[EQ_MAX_BANDS + 1];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, slope, base, period_ns;
+    uint32_t seed = 1, i;
+    int32_t n;
+
+    /* noise at 16-bit full scale */
+    for (i = 0; i < FRAMES * CHANNELS; i++) {
+        seed = seed * 1103515245 + 12345;
+        src[i] = (int32_t)(seed >> 8) - (1 << 23);
+        src[i] >>= 8;
+    }
+
+    period_ns = (double)FRAMES * 1e9 / RATE;
+    for (n = 0; n <= EQ_MAX_BANDS; n++) {
+        y[n] = chain(n);
+        printf("%d band%s: %.2f host ns a frame, %.0f us a period of %u frames, %.3f%% of it\n",
+               n, n == 1 ? "" : "s", y[n], y[n] * FRAMES / 1e3, FRAMES, y[n] * FRAMES / period_ns * PCT);
+    }
+
+    /* no bands returns at once, so the line goes through the rest */
+    for (n = 1; n <= EQ_MAX_BANDS; n++) {
+        x = n;
+        sx += x;
+        sy += y[n];
+        sxx += x * x;
+        sxy += x * y[n];
+    }
+    n = EQ_MAX_BANDS;
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    base = (sy - slope * sx) / n;
+    printf("%.2f host ns a band a frame (%.2f a band a sample) on %.2f ns a frame of clipping "
+           "and rounding\n", slope, slope / CHANNELS, base);
+
+    return 0;
+}
+
+
+/* chain
+ *
+ * 		DESCRIPTION: sets up peak bands an octave apart from 60 Hz and times
+ *		             them over the periods, keeping the best of the repeats
+ *		INPUTS: nbands -- bands in the chain
+ *		OUTPUTS: none
+ *		RETURN VALUE: host ns a frame
+ *		SIDE EFFECTS: none
+ */
+static double chain(int32_t nbands) {
+
+    struct timespec a, b;
+    uint32_t p, i;
+    int32_t rep, n;
+    double ns, best = 0;
+
+    eq_init(&eq);
+    for (n = 0; n < nbands; n++)
+        eq_set_band(&eq, n, EQ_PEAK, LOW_FREQ << n, BAND_GAIN, BAND_Q);
+
+    for (rep = 0; rep < REPEATS; rep++) {
+        ns = 0;
+        for (p = 0; p < PERIODS; p++) {
+            for (i = 0; i < FRAMES * CHANNELS; i++) bus[i] = src[i];
+            clock_gettime(CLOCK_MONOTONIC, &a);
+            eq_process(&eq, bus, FRAMES, CHANNELS, RATE);
+            clock_gettime(CLOCK_MONOTONIC, &b);
+            ns += host_ns(&a, &b);
+        }
+        if (!rep || ns < best) best = ns;
+    }
+
+    return best / ((double)PERIODS * FRAMES);
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,259 @@
+/* fm_bench.c - MIDI on the OPL3 (fm.c, midi.c) against PCM streaming, on
+ * the driver and the card model. Plays a MIDI file the way play_midi
+ * does, a tick of the RTC at a time, and counts the register writes and
+ * the port I/O they cost the machine per second of music; then times the
+ * sequencer alone on the host, with its writes dropped. A WAV file
+ * streamed through the DMA buffer gives the same two costs for PCM.
+ *   fm_bench file.mid file.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "ece391syscall.h"
+#include "fm.h"
+#include "midi.h"
+#include "port.h"
+#include "sys_sb16.h"
+#include "wav.h"
+
+/* the player's sequencer clock */
+#define TICK_HZ             512
+#define US_PER_SEC          1000000
+#define HOST_REPEATS        5
+
+static midi_t midi;
+static fm_t fm;
+static wav_t wav;
+
+
+/* local function definitions */
+static int32_t fm_virtual(const char* name);
+static void fm_host(void);
+static uint32_t fm_play(int32_t card, uint32_t* events);
+static int32_t pcm(const char* name);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the three passes
+ *		INPUTS: argv[1] -- MIDI file
+ *		        argv[2] -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if both files played, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    if (argc < 3) {
+        printf("usage: fm_bench file.mid file.wav\n");
+        return 1;
+    }
+
+    if (fm_virtual(argv[1]) == -1) return 1;
+    fm_host();
+    if (pcm(argv[2]) == -1) return 1;
+
+    return 0;
+}
+
+
+/* fm_virtual
+ *
+ * 		DESCRIPTION: plays the MIDI file through to its end on the card
+ *		             model, with the RTC's ticks passing in virtual time
+ *		INPUTS: name -- MIDI file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: leaves the file open on the OPL3; prints the result
+ */
+static int32_t fm_virtual(const char* name) {
+
+    port_stats_t s0, s1;
+    uint64_t t0, idle;
+    uint32_t ticks, events;
+    double secs;
+
+    if (midi_open(&midi, (const uint8_t*)name) != 0) {
+        printf("%s: not a MIDI file\n", name);
+        return -1;
+    }
+
+    /* the chip is found by its timer, which needs the ports to take time */
+    if (ece391_audio_fm_open() == -1) {
+        printf("no OPL3\n");
+        return -1;
+    }
+    fm_init(&fm, (const uint8_t*)FM_BANK_FILE);
+
+    port_stats(&s0);
+    t0 = port_now;
+    ticks = fm_play(1, &events);
+    port_stats(&s1);
+
+    /* what the ticks didn't spend waiting went to the system calls and
+     * the ports */
+    secs = (double)ticks / TICK_HZ;
+    idle = (uint64_t)ticks * NS_PER_SEC / TICK_HZ;
+    printf("fm: %.1f s of music, %.0f events/s, %.0f register writes/s, %.0f key-ons/s, "
+           "%.0f port accesses/s, %.0f us of system calls and port I/O a second of music\n",
+           secs, events / secs, (s1.fm_writes - s0.fm_writes) / secs,
+           (s1.fm_keyons - s0.fm_keyons) / secs, (s1.io - s0.io) / secs,
+           (double)(port_now - t0 - idle) / NS_PER_US / secs);
+
+    return 0;
+}
+
+
+/* fm_host
+ *
+ * 		DESCRIPTION: times the sequencer over the whole file, keeping the
+ *		             best of the repeats; the writes it queues are dropped,
+ *		             as the virtual pass has counted what they cost
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: closes the OPL3; prints the result
+ */
+static void fm_host(void) {
+
+    struct timespec a, b;
+    uint32_t ticks = 0, events, rep;
+    double ns, best = 0;
+
+    for (rep = 0; rep < HOST_REPEATS; rep++) {
+        midi_rewind(&midi);
+        fm_reset(&fm);
+        fm_flush(&fm);
+
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        ticks = fm_play(0, &events);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+
+        ns = host_ns(&a, &b);
+        if (!rep || ns < best) best = ns;
+    }
+
+    fm_reset(&fm);
+    fm_flush(&fm);
+    ece391_audio_fm_close();
+
+    printf("fm: %.1f host us a second of music, best of %d\n",
+           best / NS_PER_US / ((double)ticks / TICK_HZ), HOST_REPEATS);
+}
+
+
+/* fm_play
+ *
+ * 		DESCRIPTION: the loop of play_midi: flush the last tick's writes,
+ *		             wait for the tick, and play the events it made due
+ *		INPUTS: card -- 1 to send the writes and let each tick pass in
+ *		                virtual time, 0 to drop them
+ *		OUTPUTS: events -- events played
+ *		RETURN VALUE: ticks to the end of the song
+ *		SIDE EFFECTS: programs the OPL3
+ */
+static uint32_t fm_play(int32_t card, uint32_t* events) {
+
+    midi_event_t ev;
+    uint32_t us, carry = 0, ticks = 0;
+    int32_t ret;
+
+    *events = 0;
+    while (1) {
+        if (card) {
+            if (fm_flush(&fm) == -1) break;
+            port_advance(NS_PER_SEC / TICK_HZ);
+        } else {
+            fm.nwrites = 0;
+        }
+        ticks++;
+
+        carry += US_PER_SEC;
+        us = carry / TICK_HZ;
+        carry -= us * TICK_HZ;
+        midi_advance(&midi, us);
+
+        while ((ret = midi_next(&midi, &ev)) > 0) {
+            fm_event(&fm, &ev);
+            (*events)++;
+        }
+        if (ret == -1) break;
+    }
+
+    return ticks;
+}
+
+
+/* pcm
+ *
+ * 		DESCRIPTION: streams a WAV file through the DMA buffer as the
+ *		             player does, timing the fills on the host
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: prints the result
+ */
+static int32_t pcm(const char* name) {
+
+    struct timespec a, b;
+    port_stats_t s0, s1;
+    int8_t* base;
+    uint64_t calls, bytes;
+    int32_t half, filled = 1, n;
+    double fill_ns = 0, secs;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) {
+        printf("%s: not a WAV file\n", name);
+        return -1;
+    }
+    if ((base = (int8_t*)ece391_audio_open()) == (int8_t*)-1) {
+        wav_close(&wav);
+        return -1;
+    }
+
+    /* both halves are full before the start */
+    bytes = wav_fill(&wav, base, PORT_HALF_SIZE * 2);
+    port_stats(&s0);
+    calls = sys_calls;
+    ece391_audio_start(wav.info_block);
+
+    do {
+        half = ece391_audio_wait(filled);
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        n = wav_fill(&wav, base + half * PORT_HALF_SIZE, PORT_HALF_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        fill_ns += host_ns(&a, &b);
+        bytes += n;
+        filled = half;
+    } while (n == PORT_HALF_SIZE);
+
+    port_stats(&s1);
+    calls = sys_calls - calls;
+    ece391_audio_shutdown();
+    wav_close(&wav);
+
+    secs = (double)bytes / (wav.sample_rate * wav.block_align);
+    printf("pcm: %.1f s of %u Hz audio, %.0f port accesses/s, %.0f us of system calls "
+           "and port I/O a second of audio, %.0f host us a second in the fill\n",
+           secs, wav.sample_rate, (s1.io - s0.io) / secs,
+           (double)((s1.io - s0.io) * PORT_IO_NS + calls * SYSCALL_NS) / NS_PER_US / secs,
+           fill_ns / NS_PER_US / secs);
+
+    return 0;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,116 @@
+# bank_sf2.py - A small SoundFont 2 bank for the wavetable bench: a looped
+# sine, a looped saw split in two zones across the keyboard, and a drum
+# kit of a noise burst and two hats, so voices run every path of the
+# renderer: looping, one-shot, filtered, panned and enveloped.
+#   python3 bank_sf2.py out.sf2
+# Written by Soumithri Bala.
+
+import math
+import random
+import struct
+import sys
+
+PERIOD = 100
+GUARD = 46
+
+# generator operators
+PAN = 17
+ATTACK = 34
+DECAY = 36
+SUSTAIN = 37
+RELEASE = 38
+INSTRUMENT = 41
+KEY_RANGE = 43
+KEYNUM = 46
+ATTENUATION = 48
+SAMPLE_ID = 53
+SAMPLE_MODES = 54
+SCALE_TUNING = 56
+EXCLUSIVE = 57
+ROOT_KEY = 58
+
+pool = []
+headers = []
+
+
+def sample(name, data, rate, pitch, loop=None):
+    """Adds a sample and its header; loop is (start, end) within it."""
+    start = len(pool)
+    pool.extend(data)
+    end = len(pool)
+    pool.extend([0] * GUARD)
+    ls, le = (start, end) if loop is None else (start + loop[0], start + loop[1])
+    headers.append((name, start, end, ls, le, rate, pitch, 0, 0, 1))
+
+
+def amount(v):
+    """A generator's amount: a signed word, or a (low, high) range."""
+    if isinstance(v, tuple):
+        return struct.pack('<BB', v[0], v[1])
+    return struct.pack('<h', v)
+
+
+def chunk(cid, data):
+    """A RIFF chunk, padded to an even length."""
+    d = cid + struct.pack('<I', len(data)) + data
+    return d + b'\0' if len(data) & 1 else d
+
+
+def zones(items, name_fmt):
+    """Header, bag and generator chunks for instruments or presets."""
+    hdr = bag = gen = b''
+    nbag = ngen = 0
+    for fields, zs in items:
+        hdr += struct.pack(name_fmt, *fields, nbag)
+        for z in zs:
+            bag += struct.pack('<HH', ngen, 0)
+            nbag += 1
+            for op, a in z:
+                gen += struct.pack('<H', op) + amount(a)
+                ngen += 1
+    return hdr, bag + struct.pack('<HH', ngen, 0), gen + b'\0' * 4, nbag
+
+
+random.seed(1)
+sine = [int(20000 * math.sin(2 * math.pi * i / PERIOD)) for i in range(PERIOD * 40)]
+sample('sine', sine, 44000, 69, (PERIOD * 20, PERIOD * 40))
+saw = [int(16000 * (2 * ((i % PERIOD) / PERIOD) - 1)) for i in range(PERIOD * 40)]
+sample('saw', saw, 44000, 69, (PERIOD * 20, PERIOD * 40))
+noise = [int(20000 * random.uniform(-1, 1) * math.exp(-i / 3000)) for i in range(15000)]
+sample('noise', noise, 44100, 60)
+headers.append(('EOS', 0, 0, 0, 0, 0, 0, 0, 0, 0))
+
+# instruments: a global zone first where there is one
+insts = [
+    (('sine',), [[(ATTACK, -2000), (DECAY, 2000), (SUSTAIN, 100), (RELEASE, -1200)],
+                 [(KEY_RANGE, (0, 127)), (SAMPLE_MODES, 1), (SAMPLE_ID, 0)]]),
+    (('saw',), [[(KEY_RANGE, (0, 59)), (PAN, -300), (SAMPLE_MODES, 1), (RELEASE, 0), (SAMPLE_ID, 1)],
+                [(KEY_RANGE, (60, 127)), (PAN, 300), (ATTENUATION, 60), (SAMPLE_MODES, 3),
+                 (RELEASE, -2400), (SAMPLE_ID, 1)]]),
+    (('kick',), [[(KEY_RANGE, (36, 36)), (ROOT_KEY, 60), (SAMPLE_ID, 2)]]),
+    (('hat',), [[(EXCLUSIVE, 1), (SCALE_TUNING, 0)],
+                [(KEY_RANGE, (42, 42)), (KEYNUM, 80), (SAMPLE_ID, 2)],
+                [(KEY_RANGE, (46, 46)), (KEYNUM, 90), (SAMPLE_MODES, 0), (SAMPLE_ID, 2)]]),
+]
+presets = [
+    (('Sine', 0, 0), [[(ATTENUATION, 20)], [(INSTRUMENT, 0)]]),
+    (('Saw', 1, 0), [[(INSTRUMENT, 1)]]),
+    (('Kit', 0, 128), [[(INSTRUMENT, 2)], [(INSTRUMENT, 3)]]),
+    (('Bank1', 0, 1), [[(INSTRUMENT, 1)]]),
+]
+
+inst, ibag, igen, ni = zones([((n.encode(),), z) for (n,), z in insts], '<20sH')
+inst += struct.pack('<20sH', b'EOI', ni)
+phdr, pbag, pgen, np = zones([((n.encode(), p, b), z) for (n, p, b), z in presets], '<20sHHH')
+phdr = b''.join(phdr[i:i + 26] + b'\0' * 12 for i in range(0, len(phdr), 26))
+phdr += struct.pack('<20sHHHIII', b'EOP', 0, 0, np, 0, 0, 0)
+shdr = b''.join(struct.pack('<20sIIIIIBbHH', n.encode(), *rest) for n, *rest in headers)
+
+info = b'INFO' + chunk(b'ifil', struct.pack('<HH', 2, 1)) + chunk(b'INAM', b'bench\0')
+sdta = b'sdta' + chunk(b'smpl', struct.pack('<%dh' % len(pool), *pool))
+pdta = (b'pdta' + chunk(b'phdr', phdr) + chunk(b'pbag', pbag) + chunk(b'pmod', b'\0' * 10) +
+        chunk(b'pgen', pgen) + chunk(b'inst', inst) + chunk(b'ibag', ibag) +
+        chunk(b'imod', b'\0' * 10) + chunk(b'igen', igen) + chunk(b'shdr', shdr))
+body = b'sfbk' + chunk(b'LIST', info) + chunk(b'LIST', sdta) + chunk(b'LIST', pdta)
+with open(sys.argv[1], 'wb') as f:
+    f.write(b'RIFF' + struct.pack('<I', len(body)) + body)
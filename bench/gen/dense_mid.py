@@ -0,0 +1,51 @@
+# dense_mid.py - A busy General MIDI file for the FM bench: 16 channels
+# for 60 s at 120 bpm, each playing a two-note chord every 16th note with
+# pitch bends, expression and the sustain pedal thrown in at random.
+#   python3 dense_mid.py out.mid
+# Written by Soumithri Bala.
+
+import random
+import sys
+
+from smf import EOT, smf, tempo
+
+PPQN = 480
+STEP = PPQN // 4
+LENGTH = PPQN * 120
+CHANNELS = 16
+
+
+def channel(ch):
+    """One channel's track."""
+    ev = [(0, bytes([0xC0 | ch, random.randrange(128)])),
+          (0, bytes([0xB0 | ch, 7, random.randrange(60, 127)])),
+          (0, bytes([0xB0 | ch, 10, random.randrange(128)]))]
+    t = 0
+    held = []
+    while t < LENGTH:
+        # the last chord's note offs carry the step, else an expression change
+        first = True
+        for n in held:
+            ev.append((STEP if first else 0, bytes([0x80 | ch, n, 64])))
+            first = False
+        if first:
+            ev.append((STEP, bytes([0xB0 | ch, 11, random.randrange(128)])))
+        held = [random.randrange(30, 90) for _ in range(2)]
+        for n in held:
+            ev.append((0, bytes([0x90 | ch, n, random.randrange(1, 128)])))
+        if random.random() < 0.3:
+            ev.append((0, bytes([0xE0 | ch, random.randrange(128), random.randrange(128)])))
+        if random.random() < 0.1:
+            ev.append((0, bytes([0xB0 | ch, 64, random.choice([0, 127])])))
+        t += STEP
+    for n in held:
+        ev.append((0, bytes([0x80 | ch, n, 0])))
+    ev.append((0, EOT))
+    return ev
+
+
+random.seed(1)
+tracks = [[(0, tempo(500000)), (0, EOT)]]
+tracks += [channel(ch) for ch in range(CHANNELS)]
+with open(sys.argv[1], 'wb') as f:
+    f.write(smf(1, PPQN, tracks))
@@ -0,0 +1,29 @@
+# loop_wav.py - A 16-bit stereo WAV with a smpl loop, for the loop bench:
+# half a second of intro, a loop body of a second and 37 frames, so the
+# wrap lands at a different place in each period, and half a second of
+# tail. Sample i of the data is (i * 7 + 1) as a 16-bit word, so a reader
+# can check what was played against where it came from.
+#   python3 loop_wav.py out.wav
+# Written by Soumithri Bala.
+
+import struct
+import sys
+
+RATE = 44100
+INTRO = RATE // 2
+BODY = RATE + 37
+TAIL = RATE // 2
+
+frames = INTRO + BODY + TAIL
+data = struct.pack('<%dH' % (frames * 2), *((i * 7 + 1) & 0xFFFF for i in range(frames * 2)))
+
+# one forward loop, played forever; its end frame is played
+smpl = struct.pack('<9I', 0, 0, 1000000000 // RATE, 60, 0, 0, 0, 1, 0)
+smpl += struct.pack('<6I', 0, 0, INTRO, INTRO + BODY - 1, 0, 0)
+
+body = b'WAVE'
+body += b'fmt ' + struct.pack('<IHHIIHH', 16, 1, 2, RATE, RATE * 4, 4, 16)
+body += b'data' + struct.pack('<I', len(data)) + data
+body += b'smpl' + struct.pack('<I', len(smpl)) + smpl
+with open(sys.argv[1], 'wb') as f:
+    f.write(b'RIFF' + struct.pack('<I', len(body)) + body)
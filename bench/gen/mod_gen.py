@@ -0,0 +1,46 @@
+# mod_gen.py - A ProTracker MOD of n channels, each holding a looped saw
+# note from the first row, retriggered every 16 rows at a new pitch so
+# the song moves on, for timing the tracker at a channel count.
+#   python3 mod_gen.py out.mod n
+# Written by Soumithri Bala.
+
+import struct
+import sys
+
+ROWS = 64
+PATTERNS = 4
+ORDERS = 8
+RETRIGGER = 16
+SAMPLE_LEN = 512
+PERIODS = [856, 808, 762, 720, 678, 640, 604, 570, 538, 508, 480, 453,
+           428, 404, 381, 360, 339, 320, 302, 285, 269, 254, 240, 226]
+
+
+def signature(n):
+    if n == 4:
+        return b'M.K.'
+    if n < 10:
+        return b'%dCHN' % n
+    return b'%dCH' % n
+
+
+n = int(sys.argv[2])
+head = bytearray(b'bench'.ljust(20, b'\0'))
+head += b'saw'.ljust(22, b'\0') + struct.pack('>HBBHH', SAMPLE_LEN // 2, 0, 64, 0, SAMPLE_LEN // 2)
+head += bytes(30) * 30
+head += bytes([ORDERS, 127]) + bytes(p % PATTERNS for p in range(ORDERS)).ljust(128, b'\0')
+head += signature(n)
+
+pats = bytearray()
+for p in range(PATTERNS):
+    for row in range(ROWS):
+        for c in range(n):
+            if row % RETRIGGER:
+                pats += bytes(4)
+            else:
+                period = PERIODS[(c * 5 + p * 3 + row // RETRIGGER) % len(PERIODS)]
+                pats += bytes([0x00 | period >> 8, period & 0xFF, 0x10, 0])
+
+saw = bytes((i * 256 // SAMPLE_LEN - 128) & 0xFF for i in range(SAMPLE_LEN))
+with open(sys.argv[1], 'wb') as f:
+    f.write(head + pats + saw)
@@ -0,0 +1,34 @@
+# multi_wav.py - A 16-bit WAVE_FORMAT_EXTENSIBLE file of n channels with
+# the usual speaker mask for n, a tone of its own on each, for timing the
+# downmix to stereo.
+#   python3 multi_wav.py out.wav n [seconds]
+# Written by Soumithri Bala.
+
+import array
+import math
+import struct
+import sys
+
+RATE = 44100
+MASKS = {1: 0x4, 2: 0x3, 3: 0x7, 4: 0x33, 5: 0x37, 6: 0x3F, 7: 0x70F, 8: 0x63F}
+PCM_GUID = bytes.fromhex('0100000000001000800000aa00389b71')
+
+n = int(sys.argv[2])
+secs = int(sys.argv[3]) if len(sys.argv) > 3 else 10
+frames = secs * RATE
+
+samples = array.array('h', bytes(frames * n * 2))
+for c in range(n):
+    step = 2 * math.pi * 110 * (c + 2) / RATE
+    samples[c::n] = array.array('h', (int(8000 * math.sin(step * i)) for i in range(frames)))
+if sys.byteorder == 'big':
+    samples.byteswap()
+data = samples.tobytes()
+
+fmt = struct.pack('<HHIIHHHHI', 0xFFFE, n, RATE, RATE * n * 2, n * 2, 16, 22, 16, MASKS[n])
+fmt += PCM_GUID
+with open(sys.argv[1], 'wb') as f:
+    f.write(b'RIFF' + struct.pack('<I', 4 + 8 + len(fmt) + 8 + len(data)) + b'WAVE')
+    f.write(b'fmt ' + struct.pack('<I', len(fmt)) + fmt)
+    f.write(b'data' + struct.pack('<I', len(data)))
+    f.write(data)
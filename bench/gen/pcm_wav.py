@@ -0,0 +1,24 @@
+# pcm_wav.py - A 16-bit stereo WAV of a chirp, for timing PCM playback.
+#   python3 pcm_wav.py out.wav [seconds] [rate]
+# Written by Soumithri Bala.
+
+import math
+import struct
+import sys
+
+secs = int(sys.argv[2]) if len(sys.argv) > 2 else 60
+rate = int(sys.argv[3]) if len(sys.argv) > 3 else 44100
+frames = secs * rate
+
+data = bytearray(frames * 4)
+phase = 0.0
+for i in range(frames):
+    phase += 2 * math.pi * (200 + 1800 * i / frames) / rate
+    s = int(12000 * math.sin(phase))
+    struct.pack_into('<hh', data, i * 4, s, -s)
+
+with open(sys.argv[1], 'wb') as f:
+    f.write(b'RIFF' + struct.pack('<I', 36 + len(data)) + b'WAVE')
+    f.write(b'fmt ' + struct.pack('<IHHIIHH', 16, 1, 2, rate, rate * 4, 4, 16))
+    f.write(b'data' + struct.pack('<I', len(data)))
+    f.write(data)
@@ -0,0 +1,21 @@
+# poly_mid.py - A MIDI file that holds n notes for 30 s on the saw, spread
+# over 8 channels, for timing the wavetable synthesizer at a polyphony.
+#   python3 poly_mid.py out.mid n
+# Written by Soumithri Bala.
+
+import sys
+
+from smf import EOT, smf
+
+PPQN = 480
+HOLD = PPQN * 2 * 30
+CHANNELS = 8
+FIRST_KEY = 30
+PROGRAM = 1
+
+n = int(sys.argv[2])
+ev = [(0, bytes([0xC0 | c, PROGRAM])) for c in range(CHANNELS)]
+ev += [(0, bytes([0x90 | (i % CHANNELS), FIRST_KEY + i, 100])) for i in range(n)]
+ev += [(HOLD, bytes([0x80, FIRST_KEY, 0])), (0, EOT)]
+with open(sys.argv[1], 'wb') as f:
+    f.write(smf(0, PPQN, [ev]))
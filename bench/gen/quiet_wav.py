@@ -0,0 +1,79 @@
+# quiet_wav.py - A 16-bit stereo WAV laid out the way released audio puts
+# its quiet parts, for counting the periods the silence check finds:
+#   album  -- four 25 s tracks, each fading out over 3 s into dither and
+#             followed by a 2 s gap of zeros, as between the tracks of a CD
+#   hidden -- a 25 s track, 60 s of zeros and a 15 s hidden track
+#   hiss   -- a 25 s track with a 10 s pause in it that holds tape hiss at
+#             about -60 dBFS instead of zeros
+# The music is three-note chords changing every half second.
+#   python3 quiet_wav.py out.wav album|hidden|hiss
+# Written by Soumithri Bala.
+
+import array
+import math
+import random
+import struct
+import sys
+
+RATE = 44100
+NOTE = RATE // 2
+CHORDS = ((220.0, 277.2, 329.6), (196.0, 246.9, 293.7), (174.6, 220.0, 261.6), (164.8, 207.7, 246.9))
+
+rng = random.Random(12345)
+
+
+def music(secs, fade=0):
+    """secs of chords, the last fade seconds fading to nothing"""
+    frames = int(secs * RATE)
+    out = array.array('h', bytes(frames * 2))
+    for i in range(frames):
+        f = CHORDS[(i // NOTE) % len(CHORDS)]
+        t = (i % NOTE) / RATE
+        env = 6000 * math.exp(-3 * t)
+        if fade and i >= frames - fade * RATE:
+            env *= (frames - i) / (fade * RATE)
+        out[i] = int(env * (math.sin(2 * math.pi * f[0] * t) + math.sin(2 * math.pi * f[1] * t) +
+                            math.sin(2 * math.pi * f[2] * t)) / 3)
+    return out
+
+
+def dither(secs, size):
+    """secs of noise of +-size"""
+    return array.array('h', (rng.randint(-size, size) for i in range(int(secs * RATE))))
+
+
+def zeros(secs):
+    return array.array('h', bytes(int(secs * RATE) * 2))
+
+
+layout = sys.argv[2]
+mono = array.array('h')
+if layout == 'album':
+    for track in range(4):
+        mono += music(25, fade=3)
+        # the fade ends in the master's dither before the gap
+        mono += dither(0.5, 1)
+        mono += zeros(2)
+elif layout == 'hidden':
+    mono += music(25, fade=3)
+    mono += zeros(60)
+    mono += music(15)
+elif layout == 'hiss':
+    mono += music(10)
+    mono += dither(10, 33)
+    mono += music(15)
+else:
+    sys.exit('quiet_wav.py: layout is album, hidden or hiss')
+
+samples = array.array('h', bytes(len(mono) * 4))
+samples[0::2] = mono
+samples[1::2] = mono
+if sys.byteorder == 'big':
+    samples.byteswap()
+data = samples.tobytes()
+
+with open(sys.argv[1], 'wb') as f:
+    f.write(b'RIFF' + struct.pack('<I', 36 + len(data)) + b'WAVE')
+    f.write(b'fmt ' + struct.pack('<IHHIIHH', 16, 1, 2, RATE, RATE * 4, 4, 16))
+    f.write(b'data' + struct.pack('<I', len(data)))
+    f.write(data)
@@ -0,0 +1,33 @@
+# smf.py - Writes Standard MIDI Files for the benches.
+# Written by Soumithri Bala.
+
+import struct
+
+EOT = bytes([0xFF, 0x2F, 0])
+
+
+def varlen(n):
+    """A delta time as a MIDI variable-length number."""
+    b = [n & 0x7F]
+    n >>= 7
+    while n:
+        b.append((n & 0x7F) | 0x80)
+        n >>= 7
+    return bytes(reversed(b))
+
+
+def tempo(us):
+    """A tempo meta event, in microseconds a quarter note."""
+    return bytes([0xFF, 0x51, 3]) + us.to_bytes(3, 'big')
+
+
+def track(events):
+    """An MTrk chunk from (delta, bytes) pairs."""
+    data = b''.join(varlen(dt) + ev for dt, ev in events)
+    return b'MTrk' + struct.pack('>I', len(data)) + data
+
+
+def smf(fmt, division, tracks):
+    """A whole file from lists of (delta, bytes) pairs."""
+    return (b'MThd' + struct.pack('>IHHH', 6, fmt, len(tracks), division) +
+            b''.join(track(t) for t in tracks))
@@ -0,0 +1,18 @@
+/* ece391support.h - User-level string helpers, for building on the host.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _ECE391SUPPORT_H
+#define _ECE391SUPPORT_H
+
+#include <stdint.h>
+
+uint32_t ece391_strlen(const uint8_t* s);
+void ece391_strcpy(uint8_t* dst, const uint8_t* src);
+void ece391_fdputs(int32_t fd, const uint8_t* s);
+int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2);
+int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n);
+uint8_t* ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix);
+
+
+#endif
@@ -0,0 +1,52 @@
+/* ece391syscall.h - System calls the user-level code makes, for building
+ * it on the host. The file calls are served from the host's files by
+ * files.c, the audio calls by sys_sb16.c through the driver and the card
+ * model, and the FM calls by opl3.c.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _ECE391SYSCALL_H
+#define _ECE391SYSCALL_H
+
+#include <stdint.h>
+
+struct meter_stats;
+
+int32_t ece391_halt(uint8_t status);
+int32_t ece391_execute(const uint8_t* command);
+int32_t ece391_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t ece391_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t ece391_open(const uint8_t* filename);
+int32_t ece391_close(int32_t fd);
+int32_t ece391_getargs(uint8_t* buf, int32_t nbytes);
+int32_t ece391_vidmap(uint8_t** screen_start);
+
+int32_t ece391_audio_init(const uint8_t* info_block);
+int32_t ece391_audio_resume(const uint8_t* info_block);
+int32_t ece391_audio_open(void);
+int32_t ece391_audio_ready(void);
+int32_t ece391_audio_start(const uint8_t* info_block);
+int32_t ece391_audio_reconfigure(const uint8_t* info_block);
+int32_t ece391_audio_loop(const uint8_t* info_block, const int8_t* clip, uint32_t length);
+int32_t ece391_audio_cstatus(void);
+int32_t ece391_audio_wait(int32_t half);
+int32_t ece391_audio_clock(int32_t* frames);
+int32_t ece391_audio_pause(int32_t on);
+int32_t ece391_audio_restart(const uint8_t* info_block);
+int32_t ece391_audio_meter_post(int32_t half, const struct meter_stats* stats);
+int32_t ece391_audio_meter(struct meter_stats* stats);
+int32_t ece391_audio_standby(int32_t periods);
+uint32_t ece391_audio_standby_irqs(void);
+int32_t ece391_audio_shutdown(void);
+
+int32_t ece391_audio_fm_open(void);
+int32_t ece391_audio_fm_write(const uint32_t* writes, uint32_t n);
+int32_t ece391_audio_fm_close(void);
+
+int32_t ece391_audio_midi_open(void);
+int32_t ece391_audio_midi_read(uint8_t* buf, uint32_t n);
+int32_t ece391_audio_midi_write(const uint8_t* buf, uint32_t n);
+int32_t ece391_audio_midi_close(void);
+
+
+#endif
@@ -0,0 +1,183 @@
+/* files.c - File system calls and user-level string helpers on the host.
+ * A file is read whole when it's opened, so reads cost no host I/O while
+ * a bench is timing them; what the storage would cost is charged in
+ * virtual time instead, through port_file_ns and port_file_byte_ns.
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "port.h"
+
+/* descriptors 0 and 1 are the terminal, as in the kernel */
+#define FIRST_FD            2
+#define MAX_FILES           8
+
+
+typedef struct host_file {
+    uint8_t* data;
+    uint32_t size;
+    uint32_t pos;
+} host_file_t;
+
+static host_file_t files[MAX_FILES];
+
+
+/* ece391_open
+ *
+ * 		DESCRIPTION: opens a host file for reading
+ *		INPUTS: filename -- path
+ *		OUTPUTS: none
+ *		RETURN VALUE: descriptor, or -1 on fail
+ *		SIDE EFFECTS: reads the whole file into memory; the storage
+ *		              model's request time passes
+ */
+int32_t ece391_open(const uint8_t* filename) {
+
+    FILE* fp;
+    long size;
+    int32_t fd;
+
+    for (fd = FIRST_FD; fd < MAX_FILES && files[fd].data; fd++);
+    if (fd == MAX_FILES) return -1;
+
+    if (!(fp = fopen((const char*)filename, "rb"))) return -1;
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    rewind(fp);
+
+    files[fd].data = malloc(size + 1);
+    files[fd].size = fread(files[fd].data, 1, size, fp);
+    files[fd].pos = 0;
+    fclose(fp);
+
+    if (port_file_ns) port_advance(port_file_ns);
+
+    return fd;
+}
+
+
+/* ece391_read
+ *
+ * 		DESCRIPTION: reads on from where the last read stopped
+ *		INPUTS: fd -- descriptor
+ *		        nbytes -- most to read
+ *		OUTPUTS: buf -- bytes read
+ *		RETURN VALUE: bytes read, 0 at the end, -1 on fail
+ *		SIDE EFFECTS: the storage model's time for the read passes
+ */
+int32_t ece391_read(int32_t fd, void* buf, int32_t nbytes) {
+
+    host_file_t* f;
+    uint32_t n;
+
+    if (fd < FIRST_FD || fd >= MAX_FILES || !files[fd].data || nbytes < 0) return -1;
+
+    f = &files[fd];
+    n = f->size - f->pos;
+    if (n > (uint32_t)nbytes) n = nbytes;
+    memcpy(buf, f->data + f->pos, n);
+    f->pos += n;
+
+    if (port_file_ns || port_file_byte_ns) port_advance(port_file_ns + n * port_file_byte_ns);
+
+    return n;
+}
+
+
+/* ece391_write
+ *
+ * 		DESCRIPTION: writes to the terminal; files are read-only
+ *		INPUTS: fd -- descriptor
+ *		        buf -- bytes
+ *		        nbytes -- how many
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes written, or -1 on fail
+ *		SIDE EFFECTS: prints
+ */
+int32_t ece391_write(int32_t fd, const void* buf, int32_t nbytes) {
+
+    if (fd != 1 || nbytes < 0) return -1;
+
+    return fwrite(buf, 1, nbytes, stdout);
+}
+
+
+/* ece391_close
+ *
+ * 		DESCRIPTION: closes a file
+ *		INPUTS: fd -- descriptor
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: frees its copy
+ */
+int32_t ece391_close(int32_t fd) {
+
+    if (fd < FIRST_FD || fd >= MAX_FILES || !files[fd].data) return -1;
+
+    free(files[fd].data);
+    files[fd].data = NULL;
+
+    return 0;
+}
+
+
+/* ece391_strlen, ece391_strcpy, ece391_fdputs, ece391_strcmp,
+ * ece391_strncmp, ece391_itoa
+ *
+ * 		DESCRIPTION: the user-level library's string helpers
+ *		INPUTS: as in ece391support.h
+ *		OUTPUTS: as in ece391support.h
+ *		RETURN VALUE: as in ece391support.h
+ *		SIDE EFFECTS: ece391_fdputs prints
+ */
+uint32_t ece391_strlen(const uint8_t* s) {
+
+    return strlen((const char*)s);
+}
+
+
+void ece391_strcpy(uint8_t* dst, const uint8_t* src) {
+
+    strcpy((char*)dst, (const char*)src);
+}
+
+
+void ece391_fdputs(int32_t fd, const uint8_t* s) {
+
+    ece391_write(fd, s, strlen((const char*)s));
+}
+
+
+int32_t ece391_strcmp(const uint8_t* s1, const uint8_t* s2) {
+
+    return strcmp((const char*)s1, (const char*)s2);
+}
+
+
+int32_t ece391_strncmp(const uint8_t* s1, const uint8_t* s2, uint32_t n) {
+
+    return strncmp((const char*)s1, (const char*)s2, n);
+}
+
+
+uint8_t* ece391_itoa(uint32_t value, uint8_t* buf, int32_t radix) {
+
+    static const char digits[] = "0123456789ABCDEF";
+    char tmp[33];
+    int32_t n = 0;
+    int32_t i;
+
+    do {
+        tmp[n++] = digits[value % radix];
+        value /= radix;
+    } while (value);
+    for (i = 0; i < n; i++) buf[i] = tmp[n - 1 - i];
+    buf[n] = '\0';
+
+    return buf;
+}
@@ -0,0 +1,15 @@
+/* i8259.h - PIC stand-in; the EOI unmasks the card's line in port.c.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _I8259_H
+#define _I8259_H
+
+#include "types.h"
+
+void enable_irq(uint32_t irq_num);
+void disable_irq(uint32_t irq_num);
+void send_eoi(uint32_t irq_num);
+
+
+#endif
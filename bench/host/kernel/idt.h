@@ -0,0 +1,9 @@
+/* idt.h - IDT stand-in; port.c calls the handler directly.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _IDT_H
+#define _IDT_H
+
+
+#endif
@@ -0,0 +1,36 @@
+/* lib.h - Kernel library stand-in: port I/O and interrupt masking go to
+ * the card model in port.c, and printf to stderr.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _LIB_H
+#define _LIB_H
+
+#include "types.h"
+
+#define FOUR_B              4
+
+/* the driver's messages */
+int32_t kprintf(const int8_t* format, ...);
+#define printf kprintf
+
+/* copies cost virtual time like port accesses do */
+void* host_memcpy(void* dest, const void* src, uint32_t n);
+void* host_memset(void* dest, int32_t c, uint32_t n);
+#define memcpy host_memcpy
+#define memset host_memset
+
+int8_t* strrev(int8_t* s);
+
+uint8_t inb(uint16_t port);
+void outb(uint8_t data, uint16_t port);
+
+/* IF as the model keeps it; hlt in sb16_wait becomes host_halt */
+void host_cli(void);
+void host_sti(void);
+void host_halt(void);
+#define cli() host_cli()
+#define sti() host_sti()
+
+
+#endif
@@ -0,0 +1,20 @@
+/* types.h - Kernel integer types, for building the driver on the host.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _TYPES_H
+#define _TYPES_H
+
+#define NULL 0
+
+typedef int int32_t;
+typedef unsigned int uint32_t;
+typedef short int16_t;
+typedef unsigned short uint16_t;
+typedef char int8_t;
+typedef unsigned char uint8_t;
+typedef long long int64_t;
+typedef unsigned long long uint64_t;
+
+
+#endif
@@ -0,0 +1,960 @@
+/* port.c - Virtual-time model of the SB16, its 16-bit DMA channel, the
+ * MPU-401 UART and the OPL3's registers and first timer. The driver is
+ * built unchanged apart from its asm, so its port accesses, cli/sti and
+ * hlt land here; the model keeps a clock that each of them moves on and
+ * delivers the card's interrupt by calling sb16_interrupt the way the
+ * CPU would.
+ * Written by Soumithri Bala. */
+
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "port.h"
+
+/* DSP and mixer ports the model answers */
+#define DSP_RESET           0x226
+#define DSP_READ            0x22A
+#define DSP_WRITE           0x22C
+#define DSP_POLL            0x22E
+#define DSP_ACK_16          0x22F
+#define MIXER_ADDR          0x224
+#define MIXER_DATA          0x225
+#define DSP_RATE            0x41
+#define DSP_START_16        0xB6
+#define DSP_PAUSE_16        0xD5
+#define DSP_RESUME_16       0xD6
+#define DSP_EXIT_AUTO       0xD9
+#define DSP_READY           0x80
+#define DSP_RESET_OK        0xAA
+#define DSP_STEREO          0x20
+#define IRQ_STATUS_DMA16    0x02
+#define IRQ_STATUS_MPU      0x04
+
+/* 16-bit DMA channel */
+#define DMA_COUNT           0xC6
+#define DMA_ADDR            0xC4
+#define DMA_CLEAR_FF        0xD8
+#define DMA_WORDS           (PORT_HALF_WORDS * 2)
+
+/* MPU-401 */
+#define UART_DATA           0x330
+#define UART_STAT           0x331
+#define UART_DRR            0x40
+#define UART_DSR            0x80
+#define UART_RESET          0xFF
+#define UART_MODE           0x3F
+#define UART_ACK            0xFE
+
+/* OPL3: two banks of registers behind an address and a data port each;
+ * timer 1 counts up from its register in steps of 80 us */
+#define FM_ADDR             0x388
+#define FM_DATA             0x389
+#define FM_ADDR2            0x38A
+#define FM_DATA2            0x38B
+#define FM_BANK             0x100
+#define FM_REGS             0x200
+#define FM_REG_TIMER1       0x02
+#define FM_REG_CTRL         0x04
+#define FM_REG_KEY          0xB0
+#define FM_CHANNELS         9
+#define FM_CTRL_RESET       0x80
+#define FM_CTRL_T1          0x01
+#define FM_STATUS_T1        0xC0
+#define FM_KEY_ON           0x20
+#define FM_TIMER1_STEP      (80 * NS_PER_US)
+#define FM_TIMER1_STEPS     256
+
+/* memory the driver's copies go through; a period takes about 130 us */
+#define COPY_BYTES_PER_US   256
+
+#define REC_GROW            (1 << 20)
+#define WIRE_GROW           65536
+
+/* the driver's buffer, handler and acknowledge */
+extern int8_t buffer[2][PORT_HALF_SIZE];
+void sb16_interrupt(void);
+
+uint64_t port_now = 0;
+int32_t port_fast = 0;
+int32_t port_dsp_busy = 0;
+uint64_t port_file_ns = 0;
+uint64_t port_file_byte_ns = 0;
+
+static port_stats_t stats;
+
+/* the CPU's IF, the PIC's mask on the card's line until its EOI, and
+ * how deep interrupts are nested */
+static int32_t if_on = 1;
+static int32_t line_masked = 0;
+static int32_t depth = 0;
+
+/* the DMA runs from t_base, when it had moved words_base words, at wps
+ * words a second; stop_words is where an exit from auto-init ends it */
+static int32_t dma_running = 0;
+static int32_t dma_frozen = 0;
+/* the 8237 was given the buffer's address again, so the next start
+ * begins at the top of the buffer */
+static int32_t dma_rewound = 0;
+static uint64_t t_base = 0;
+static uint64_t t_start = 0;
+static uint64_t words_base = 0;
+static uint64_t stop_words = 0;
+static uint64_t wps = 0;
+static uint32_t rate = 0;
+static uint32_t channels = 2;
+static uint64_t halves_done = 0;
+static uint64_t halves_acked = 0;
+static int32_t flip_flop = 0;
+
+/* DSP command being collected */
+static uint8_t dsp_cmd = 0;
+static int32_t dsp_need = 0;
+static int32_t dsp_got = 0;
+static uint8_t dsp_arg[3];
+
+static int32_t recording = 0;
+static int16_t* rec = NULL;
+static uint64_t rec_len = 0;
+static uint64_t rec_cap = 0;
+
+/* UART transmit: the shift register is busy until shift_end and one byte
+ * can wait behind it */
+static uint64_t shift_end = 0;
+static int32_t hold_full = 0;
+static uint8_t hold;
+static uint8_t* wire = NULL;
+static uint64_t* wire_t = NULL;
+static uint64_t wire_len = 0;
+static uint64_t wire_cap = 0;
+
+/* UART receive */
+static uint8_t rx_fifo[UART_RX_FIFO];
+static int32_t rx_n = 0;
+static const uint8_t* rx_src = NULL;
+static uint64_t rx_total = 0;
+static uint64_t rx_next = 0;
+static uint64_t rx_period = 0;
+static uint64_t rx_start = 0;
+static uint64_t rx_overrun = 0;
+static int32_t ack_pending = 0;
+static int32_t uart_mode = 0;
+
+/* OPL3 */
+static uint8_t fm_reg[FM_REGS];
+static uint32_t fm_addr[2];
+static int32_t fm_t1_running = 0;
+static uint64_t fm_t1_start = 0;
+static uint8_t fm_status = 0;
+
+
+/* local function definitions */
+static uint64_t dma_words(void);
+static void dma_rebase(void);
+static void dma_update(void);
+static void dsp_command(uint8_t data);
+static void fm_write(uint32_t reg, uint8_t data);
+static void uart_update(void);
+static void wire_put(uint8_t data, uint64_t t);
+static int32_t irq_pending(void);
+static void irq_poll(void);
+static uint64_t next_event(void);
+static void spend(uint64_t ns);
+
+
+/* inb
+ *
+ * 		DESCRIPTION: reads a port of the model
+ *		INPUTS: port -- port to read
+ *		OUTPUTS: none
+ *		RETURN VALUE: what the card would return
+ *		SIDE EFFECTS: costs a port access; may deliver the interrupt
+ */
+uint8_t inb(uint16_t port) {
+
+    uint8_t status = 0;
+    uint32_t count;
+
+    if (!port_fast) stats.io++;
+    spend(PORT_IO_NS);
+    dma_update();
+    uart_update();
+
+    switch (port) {
+    case DMA_COUNT:
+        /* words left in the pass, less one, a byte at a time */
+        count = DMA_WORDS - 1 - (uint32_t)(dma_words() % DMA_WORDS);
+        flip_flop = !flip_flop;
+        return flip_flop ? count & 0xFF : count >> 8;
+
+    case FM_ADDR:
+        if (fm_t1_running && port_now >= fm_t1_start +
+            (FM_TIMER1_STEPS - fm_reg[FM_REG_TIMER1]) * FM_TIMER1_STEP)
+            fm_status |= FM_STATUS_T1;
+        return fm_status;
+
+    case DSP_POLL:
+        return DSP_READY;
+
+    case DSP_READ:
+        return DSP_RESET_OK;
+
+    case DSP_WRITE:
+        return port_dsp_busy ? DSP_READY : 0;
+
+    case MIXER_DATA:
+        if (halves_done > halves_acked) status |= IRQ_STATUS_DMA16;
+        if (rx_n || ack_pending) status |= IRQ_STATUS_MPU;
+        return status;
+
+    case DSP_ACK_16:
+        /* the DSP latches one interrupt; boundaries that pass before the
+         * acknowledge are folded into it */
+        halves_acked = halves_done;
+        return 0;
+
+    case UART_STAT:
+        if (!port_fast && hold_full) status |= UART_DRR;
+        if (!rx_n && !ack_pending) status |= UART_DSR;
+        return status;
+
+    case UART_DATA:
+        if (ack_pending) {
+            ack_pending = 0;
+            return UART_ACK;
+        }
+        if (rx_n) {
+            status = rx_fifo[0];
+            memmove(rx_fifo, rx_fifo + 1, --rx_n);
+            return status;
+        }
+        return 0xFF;
+    }
+
+    return 0;
+}
+
+
+/* outb
+ *
+ * 		DESCRIPTION: writes a port of the model
+ *		INPUTS: data -- byte to write
+ *		        port -- port to write
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: costs a port access; may start or stop the DMA,
+ *		              put a byte on the wire or deliver the interrupt
+ */
+void outb(uint8_t data, uint16_t port) {
+
+    if (!port_fast) stats.io++;
+    spend(PORT_IO_NS);
+    dma_update();
+    uart_update();
+
+    switch (port) {
+    case DMA_CLEAR_FF:
+        flip_flop = 0;
+        break;
+
+    case DMA_ADDR:
+        dma_rewound = 1;
+        flip_flop = !flip_flop;
+        break;
+
+    case DMA_COUNT:
+        flip_flop = !flip_flop;
+        break;
+
+    case FM_ADDR:
+        fm_addr[0] = data;
+        break;
+
+    case FM_ADDR2:
+        fm_addr[1] = FM_BANK | data;
+        break;
+
+    case FM_DATA:
+        fm_write(fm_addr[0], data);
+        break;
+
+    case FM_DATA2:
+        fm_write(fm_addr[1], data);
+        break;
+
+    case DSP_RESET:
+        if (data) {
+            dma_running = 0;
+            dma_frozen = 0;
+            dsp_need = 0;
+        }
+        break;
+
+    case DSP_WRITE:
+        if (!port_dsp_busy) dsp_command(data);
+        break;
+
+    case UART_STAT:
+        if (data == UART_RESET) {
+            /* a UART in UART mode doesn't acknowledge its reset */
+            ack_pending = !uart_mode;
+            uart_mode = 0;
+        } else if (data == UART_MODE) {
+            ack_pending = 1;
+            uart_mode = 1;
+        }
+        break;
+
+    case UART_DATA:
+        if (port_fast) {
+            wire_put(data, port_now);
+        } else if (port_now >= shift_end) {
+            wire_put(data, port_now);
+            shift_end = port_now + UART_BYTE_NS;
+        } else if (!hold_full) {
+            hold = data;
+            hold_full = 1;
+        } else {
+            fprintf(stderr, "port: UART written while DRR was set\n");
+            exit(1);
+        }
+        break;
+    }
+}
+
+
+/* host_cli
+ *
+ * 		DESCRIPTION: clears the model's IF
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: holds off the interrupt
+ */
+void host_cli(void) {
+
+    if_on = 0;
+}
+
+
+/* host_sti
+ *
+ * 		DESCRIPTION: sets the model's IF, taking an interrupt that was
+ *		             held off
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may call sb16_interrupt
+ */
+void host_sti(void) {
+
+    if_on = 1;
+    irq_poll();
+}
+
+
+/* host_halt
+ *
+ * 		DESCRIPTION: sti; hlt; cli -- lets time run to the next interrupt
+ *		             and takes it
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: moves the clock on; calls sb16_interrupt; exits if
+ *		              nothing could ever wake the CPU
+ */
+void host_halt(void) {
+
+    uint64_t before = stats.irqs;
+    uint64_t t;
+
+    if_on = 1;
+    irq_poll();
+    while (stats.irqs == before) {
+        if ((t = next_event()) == 0) {
+            fprintf(stderr, "port: hlt with no interrupt to come\n");
+            exit(1);
+        }
+        if (t > port_now) port_now = t;
+        irq_poll();
+    }
+    if_on = 0;
+}
+
+
+/* enable_irq, disable_irq, send_eoi
+ *
+ * 		DESCRIPTION: the PIC; only the EOI matters, unmasking the line
+ *		INPUTS: irq_num -- line
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void enable_irq(uint32_t irq_num) {
+
+    (void)irq_num;
+}
+
+
+void disable_irq(uint32_t irq_num) {
+
+    (void)irq_num;
+}
+
+
+void send_eoi(uint32_t irq_num) {
+
+    (void)irq_num;
+    line_masked = 0;
+}
+
+
+/* host_memcpy, host_memset
+ *
+ * 		DESCRIPTION: the driver's copies, charged at memory speed
+ *		INPUTS: as memcpy and memset
+ *		OUTPUTS: dest -- written
+ *		RETURN VALUE: dest
+ *		SIDE EFFECTS: moves the clock on
+ */
+void* host_memcpy(void* dest, const void* src, uint32_t n) {
+
+    memcpy(dest, src, n);
+    spend((uint64_t)n * NS_PER_US / COPY_BYTES_PER_US);
+
+    return dest;
+}
+
+
+void* host_memset(void* dest, int32_t c, uint32_t n) {
+
+    memset(dest, c, n);
+    spend((uint64_t)n * NS_PER_US / COPY_BYTES_PER_US);
+
+    return dest;
+}
+
+
+/* strrev
+ *
+ * 		DESCRIPTION: the kernel library's in-place string reverse
+ *		INPUTS: s -- string
+ *		OUTPUTS: s -- reversed
+ *		RETURN VALUE: s
+ *		SIDE EFFECTS: none
+ */
+char* strrev(char* s) {
+
+    size_t i, n = strlen(s);
+    char c;
+
+    for (i = 0; i < n / 2; i++) {
+        c = s[i];
+        s[i] = s[n - 1 - i];
+        s[n - 1 - i] = c;
+    }
+
+    return s;
+}
+
+
+/* kprintf
+ *
+ * 		DESCRIPTION: the driver's printf, to stderr
+ *		INPUTS: format -- as printf
+ *		OUTPUTS: none
+ *		RETURN VALUE: characters written
+ *		SIDE EFFECTS: none
+ */
+int32_t kprintf(const char* format, ...) {
+
+    va_list ap;
+    int32_t n;
+
+    va_start(ap, format);
+    n = vfprintf(stderr, format, ap);
+    va_end(ap);
+
+    return n;
+}
+
+
+/* port_advance
+ *
+ * 		DESCRIPTION: lets time pass with interrupts on
+ *		INPUTS: ns -- how long
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: takes every interrupt that comes up meanwhile
+ */
+void port_advance(uint64_t ns) {
+
+    uint64_t end = port_now + ns;
+    uint64_t t;
+
+    if_on = 1;
+    irq_poll();
+    while (port_now < end) {
+        t = next_event();
+        if (t <= port_now || t > end) t = end;
+        port_now = t;
+        irq_poll();
+    }
+}
+
+
+/* port_masked
+ *
+ * 		DESCRIPTION: lets time pass with interrupts off, then turns them on
+ *		INPUTS: ns -- how long
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: takes what was held off
+ */
+void port_masked(uint64_t ns) {
+
+    if_on = 0;
+    port_now += ns;
+    dma_update();
+    uart_update();
+    host_sti();
+}
+
+
+/* port_boundary
+ *
+ * 		DESCRIPTION: tells when the DMA reaches the end of a half
+ *		INPUTS: halves -- halves from the start
+ *		OUTPUTS: none
+ *		RETURN VALUE: virtual time, or 0 if the DMA isn't running
+ */
+uint64_t port_boundary(uint64_t halves) {
+
+    uint64_t words = halves * PORT_HALF_WORDS;
+
+    if (!dma_running || dma_frozen || !wps) return 0;
+    if (words <= words_base) return t_base;
+
+    return t_base + ((words - words_base) * NS_PER_SEC + wps - 1) / wps;
+}
+
+
+/* port_dma_start, port_halves
+ *
+ * 		DESCRIPTION: when the DMA last started, and halves it has finished
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: as described
+ */
+uint64_t port_dma_start(void) {
+
+    return t_start;
+}
+
+
+uint64_t port_halves(void) {
+
+    dma_update();
+    return halves_done;
+}
+
+
+/* port_record
+ *
+ * 		DESCRIPTION: starts or stops collecting what the DMA plays
+ *		INPUTS: on -- 1 to start afresh, 0 to stop
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void port_record(int32_t on) {
+
+    dma_update();
+    recording = on;
+    if (on) rec_len = 0;
+}
+
+
+/* port_recorded
+ *
+ * 		DESCRIPTION: what the DMA has played while recording
+ *		INPUTS: none
+ *		OUTPUTS: samples -- 16-bit samples collected
+ *		RETURN VALUE: the samples
+ */
+int16_t* port_recorded(uint64_t* samples) {
+
+    *samples = rec_len;
+    return rec;
+}
+
+
+/* port_uart_feed
+ *
+ * 		DESCRIPTION: has bytes arrive at the UART at a steady pace, the
+ *		             first a period from now
+ *		INPUTS: bytes -- bytes to receive, kept by the caller
+ *		        n -- how many
+ *		        period -- ns between them
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void port_uart_feed(const uint8_t* bytes, uint32_t n, uint64_t period) {
+
+    rx_src = bytes;
+    rx_total = n;
+    rx_next = 0;
+    rx_period = period;
+    rx_start = port_now;
+}
+
+
+/* port_uart_rx
+ *
+ * 		DESCRIPTION: how the receive side went
+ *		INPUTS: none
+ *		OUTPUTS: sent -- bytes that have arrived
+ *		         overrun -- of them, bytes lost with the FIFO full
+ *		RETURN VALUE: none
+ */
+void port_uart_rx(uint64_t* sent, uint64_t* overrun) {
+
+    uart_update();
+    *sent = rx_next;
+    *overrun = rx_overrun;
+}
+
+
+/* port_uart_wire
+ *
+ * 		DESCRIPTION: what the UART has sent
+ *		INPUTS: none
+ *		OUTPUTS: bytes -- the bytes
+ *		         times -- when each started on the wire
+ *		RETURN VALUE: bytes sent
+ */
+uint64_t port_uart_wire(const uint8_t** bytes, const uint64_t** times) {
+
+    uart_update();
+    if (bytes) *bytes = wire;
+    if (times) *times = wire_t;
+
+    return wire_len;
+}
+
+
+/* port_stats
+ *
+ * 		DESCRIPTION: counts kept by the model
+ *		INPUTS: none
+ *		OUTPUTS: out -- the counts
+ *		RETURN VALUE: none
+ */
+void port_stats(port_stats_t* out) {
+
+    stats.halves = halves_done;
+    *out = stats;
+}
+
+
+/* dma_words
+ *
+ * 		DESCRIPTION: words the DMA has moved since it started
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: words
+ */
+static uint64_t dma_words(void) {
+
+    uint64_t words;
+
+    if (!dma_running || dma_frozen || !wps) return words_base;
+
+    words = words_base + (port_now - t_base) * wps / NS_PER_SEC;
+    if (stop_words && words > stop_words) words = stop_words;
+
+    return words;
+}
+
+
+/* dma_rebase
+ *
+ * 		DESCRIPTION: counts from now, before the rate changes
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+static void dma_rebase(void) {
+
+    words_base = dma_words();
+    t_base = port_now;
+}
+
+
+/* dma_update
+ *
+ * 		DESCRIPTION: catches up with the halves the DMA has finished,
+ *		             recording each as it was played
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may stop the DMA at the end of an exit from
+ *		              auto-init
+ */
+static void dma_update(void) {
+
+    uint64_t done = dma_words() / PORT_HALF_WORDS;
+
+    while (halves_done < done) {
+        if (recording) {
+            if (rec_len + PORT_HALF_WORDS > rec_cap) {
+                rec_cap += REC_GROW;
+                rec = realloc(rec, rec_cap * sizeof(int16_t));
+            }
+            memcpy(rec + rec_len, buffer[halves_done % 2], PORT_HALF_SIZE);
+            rec_len += PORT_HALF_WORDS;
+        }
+        halves_done++;
+    }
+
+    if (stop_words && dma_words() >= stop_words) {
+        dma_rebase();
+        dma_running = 0;
+        stop_words = 0;
+    }
+}
+
+
+/* dsp_command
+ *
+ * 		DESCRIPTION: takes a byte written to the DSP
+ *		INPUTS: data -- command or argument
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sets the rate, starts, pauses or stops the DMA
+ */
+static void dsp_command(uint8_t data) {
+
+    if (dsp_need) {
+        dsp_arg[dsp_got++] = data;
+        if (dsp_got < dsp_need) return;
+        dsp_need = 0;
+
+        if (dsp_cmd == DSP_RATE) {
+            dma_rebase();
+            rate = (dsp_arg[0] << 8) | dsp_arg[1];
+        } else if (!dma_running || dma_rewound) {
+            /* a fresh start at the top of the buffer */
+            dma_rewound = 0;
+            channels = (dsp_arg[0] & DSP_STEREO) ? 2 : 1;
+            dma_running = 1;
+            dma_frozen = 0;
+            words_base = 0;
+            stop_words = 0;
+            t_base = t_start = port_now;
+            halves_done = halves_acked = 0;
+        } else {
+            dma_rebase();
+            channels = (dsp_arg[0] & DSP_STEREO) ? 2 : 1;
+        }
+        wps = (uint64_t)rate * channels;
+        return;
+    }
+
+    dsp_cmd = data;
+    dsp_got = 0;
+
+    switch (data) {
+    case DSP_RATE:
+        dsp_need = 2;
+        break;
+
+    case DSP_START_16:
+        dsp_need = 3;
+        break;
+
+    case DSP_PAUSE_16:
+        dma_rebase();
+        dma_frozen = 1;
+        break;
+
+    case DSP_RESUME_16:
+        t_base = port_now;
+        dma_frozen = 0;
+        break;
+
+    case DSP_EXIT_AUTO:
+        /* the block under way is played out */
+        stop_words = (dma_words() / PORT_HALF_WORDS + 1) * PORT_HALF_WORDS;
+        break;
+    }
+}
+
+
+/* fm_write
+ *
+ * 		DESCRIPTION: takes a write to an OPL3 register
+ *		INPUTS: reg -- register, with the bank in bit 8
+ *		        data -- value
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: starts, stops or resets timer 1; counts key-ons
+ */
+static void fm_write(uint32_t reg, uint8_t data) {
+
+    uint32_t key = reg & ~FM_BANK;
+
+    stats.fm_writes++;
+    if (key >= FM_REG_KEY && key < FM_REG_KEY + FM_CHANNELS &&
+        (data & FM_KEY_ON) && !(fm_reg[reg] & FM_KEY_ON))
+        stats.fm_keyons++;
+
+    if (reg == FM_REG_CTRL) {
+        if (data & FM_CTRL_RESET) {
+            fm_status = 0;
+        } else {
+            fm_t1_running = data & FM_CTRL_T1;
+            fm_t1_start = port_now;
+        }
+        return;
+    }
+
+    fm_reg[reg] = data;
+}
+
+
+/* uart_update
+ *
+ * 		DESCRIPTION: moves the UART on to the present: the held byte
+ *		             goes out once the shift register is free, and bytes
+ *		             due to arrive go into the FIFO
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+static void uart_update(void) {
+
+    if (port_fast) return;
+
+    if (hold_full && port_now >= shift_end) {
+        wire_put(hold, shift_end);
+        shift_end += UART_BYTE_NS;
+        hold_full = 0;
+    }
+
+    while (rx_src && rx_next < rx_total && port_now >= rx_start + (rx_next + 1) * rx_period) {
+        if (rx_n < UART_RX_FIFO) {
+            rx_fifo[rx_n++] = rx_src[rx_next];
+        } else {
+            rx_overrun++;
+        }
+        rx_next++;
+    }
+}
+
+
+/* wire_put
+ *
+ * 		DESCRIPTION: logs a byte going out on the wire
+ *		INPUTS: data -- byte
+ *		        t -- when it started
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+static void wire_put(uint8_t data, uint64_t t) {
+
+    if (wire_len == wire_cap) {
+        wire_cap += WIRE_GROW;
+        wire = realloc(wire, wire_cap);
+        wire_t = realloc(wire_t, wire_cap * sizeof(uint64_t));
+    }
+    wire[wire_len] = data;
+    wire_t[wire_len++] = t;
+}
+
+
+/* irq_pending
+ *
+ * 		DESCRIPTION: tells whether the card holds its interrupt line up
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if so
+ */
+static int32_t irq_pending(void) {
+
+    return halves_done > halves_acked || rx_n || ack_pending;
+}
+
+
+/* irq_poll
+ *
+ * 		DESCRIPTION: delivers the interrupt while the card raises it, IF
+ *		             is set and the PIC has had its EOI
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: calls sb16_interrupt, which may nest
+ */
+static void irq_poll(void) {
+
+    if (port_fast) return;
+
+    dma_update();
+    uart_update();
+    while (if_on && !line_masked && irq_pending()) {
+        stats.irqs++;
+        if (depth) stats.nested++;
+
+        /* the interrupt gate clears IF; iret sets it again */
+        depth++;
+        line_masked = 1;
+        if_on = 0;
+        sb16_interrupt();
+        if_on = 1;
+        depth--;
+
+        dma_update();
+        uart_update();
+    }
+}
+
+
+/* next_event
+ *
+ * 		DESCRIPTION: finds when the card next raises its interrupt
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: virtual time, or 0 if nothing is coming
+ */
+static uint64_t next_event(void) {
+
+    uint64_t t = port_boundary(halves_done + 1);
+    uint64_t rx;
+
+    if (rx_src && rx_next < rx_total) {
+        rx = (rx_next + 1) * rx_period;
+        if (!t || rx < t) t = rx;
+    }
+
+    return t;
+}
+
+
+/* spend
+ *
+ * 		DESCRIPTION: moves the clock on for work the CPU does
+ *		INPUTS: ns -- how long
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: takes the interrupt if it comes up with IF set
+ */
+static void spend(uint64_t ns) {
+
+    if (port_fast) return;
+
+    port_now += ns;
+    irq_poll();
+}
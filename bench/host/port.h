@@ -0,0 +1,83 @@
+/* port.h - Virtual-time model of the SB16, its 16-bit DMA channel, the
+ * MPU-401 UART and the OPL3, for running the driver on the host. Every
+ * port access costs a microsecond of virtual time, the DMA moves through the buffer
+ * at the rate the DSP was given, and the interrupt is delivered to
+ * sb16_interrupt whenever the model's IF allows it.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _PORT_H
+#define _PORT_H
+
+#include <stdint.h>
+
+#define NS_PER_US           1000ULL
+#define NS_PER_SEC          1000000000ULL
+
+/* time an ISA port access takes */
+#define PORT_IO_NS          NS_PER_US
+
+/* the driver's buffer: two halves of 16384 words */
+#define PORT_HALF_SIZE      32768
+#define PORT_HALF_WORDS     (PORT_HALF_SIZE / 2)
+
+/* 10 bits at 31250 baud */
+#define UART_BYTE_NS        320000ULL
+#define UART_RX_FIFO        16
+
+typedef struct port_stats {
+    uint64_t io;            /* port accesses */
+    uint64_t irqs;          /* interrupts delivered */
+    uint64_t nested;        /* of them, taken inside another */
+    uint64_t halves;        /* halves the DMA has finished */
+    uint64_t fm_writes;     /* OPL3 register writes */
+    uint64_t fm_keyons;     /* of them, notes keyed on */
+} port_stats_t;
+
+
+/* virtual time in nanoseconds */
+extern uint64_t port_now;
+
+/* 1 to make ports free and the UART never busy, for timing host CPU */
+extern int32_t port_fast;
+
+/* 1 to have the DSP stop taking commands */
+extern int32_t port_dsp_busy;
+
+/* the storage the files are read from: what a request costs and what a
+ * byte costs on top, both 0 by default; an open or a read lets that much
+ * virtual time pass with interrupts on */
+extern uint64_t port_file_ns;
+extern uint64_t port_file_byte_ns;
+
+/* lets virtual time pass with interrupts on, as user code running */
+void port_advance(uint64_t ns);
+
+/* runs the CPU with interrupts off for a while, then turns them back on */
+void port_masked(uint64_t ns);
+
+/* time of the boundary at the end of a half, counting from the start */
+uint64_t port_boundary(uint64_t halves);
+
+/* when the DMA started */
+uint64_t port_dma_start(void);
+
+/* halves the DMA has finished */
+uint64_t port_halves(void);
+
+/* collects a copy of each half as the DMA finishes it; samples counts
+ * 16-bit samples in rec */
+void port_record(int32_t on);
+int16_t* port_recorded(uint64_t* samples);
+
+/* bytes received on the UART, one every period ns */
+void port_uart_feed(const uint8_t* bytes, uint32_t n, uint64_t period);
+void port_uart_rx(uint64_t* sent, uint64_t* overrun);
+
+/* bytes the UART has sent, with the time each started */
+uint64_t port_uart_wire(const uint8_t** bytes, const uint64_t** times);
+
+void port_stats(port_stats_t* stats);
+
+
+#endif
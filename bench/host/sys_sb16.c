@@ -0,0 +1,283 @@
+/* sys_sb16.c - The audio system calls, served by the driver running on
+ * the card model. Each call costs the trip into the kernel and back in
+ * virtual time before the driver sees it.
+ * Written by Soumithri Bala. */
+
+
+#include "ece391syscall.h"
+#include "port.h"
+#include "sys_sb16.h"
+
+/* the driver, with user-level types; its kernel types match these */
+int32_t sb16_init(const uint8_t* info_block);
+int32_t sb16_resume(const uint8_t* info_block);
+int32_t sb16_open(void);
+int32_t sb16_open_status(void);
+int32_t sb16_start(const uint8_t* info_block);
+int32_t sb16_reconfigure(const uint8_t* info_block);
+int32_t sb16_loop(const uint8_t* info_block, const int8_t* clip, uint32_t length);
+int32_t sb16_copy_status(void);
+int32_t sb16_wait(int32_t half);
+int32_t sb16_clock(int32_t* frames);
+int32_t sb16_pause(int32_t on);
+int32_t sb16_restart(const uint8_t* info_block);
+int32_t sb16_meter_post(int32_t half, const struct meter_stats* stats);
+int32_t sb16_meter_read(struct meter_stats* stats);
+int32_t sb16_standby(int32_t periods);
+uint32_t sb16_standby_irqs(void);
+int32_t sb16_shutdown(void);
+int32_t sb16_midi_open(void);
+int32_t sb16_midi_read(uint8_t* buf, uint32_t n);
+int32_t sb16_midi_write(const uint8_t* buf, uint32_t n);
+int32_t sb16_midi_close(void);
+int32_t sb16_fm_open(void);
+int32_t sb16_fm_write(const uint32_t* writes, uint32_t n);
+int32_t sb16_fm_close(void);
+int32_t sb16_fd_open(const uint8_t* filename);
+int32_t sb16_fd_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t sb16_fd_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t sb16_fd_poll(int32_t fd);
+int32_t sb16_fd_close(int32_t fd);
+
+/* system calls made since the start */
+uint64_t sys_calls = 0;
+
+
+/* local function definitions */
+static void enter(void);
+
+
+/* ece391_audio_*
+ *
+ * 		DESCRIPTION: the audio system calls; each goes to the driver
+ *		             function that serves it in the kernel
+ *		INPUTS: as the system call
+ *		OUTPUTS: as the system call
+ *		RETURN VALUE: as the system call
+ *		SIDE EFFECTS: as the system call
+ */
+int32_t ece391_audio_init(const uint8_t* info_block) {
+
+    enter();
+    return sb16_init(info_block);
+}
+
+
+int32_t ece391_audio_resume(const uint8_t* info_block) {
+
+    enter();
+    return sb16_resume(info_block);
+}
+
+
+int32_t ece391_audio_open(void) {
+
+    enter();
+    return sb16_open();
+}
+
+
+int32_t ece391_audio_ready(void) {
+
+    enter();
+    return sb16_open_status();
+}
+
+
+int32_t ece391_audio_start(const uint8_t* info_block) {
+
+    enter();
+    return sb16_start(info_block);
+}
+
+
+int32_t ece391_audio_reconfigure(const uint8_t* info_block) {
+
+    enter();
+    return sb16_reconfigure(info_block);
+}
+
+
+int32_t ece391_audio_loop(const uint8_t* info_block, const int8_t* clip, uint32_t length) {
+
+    enter();
+    return sb16_loop(info_block, clip, length);
+}
+
+
+int32_t ece391_audio_cstatus(void) {
+
+    enter();
+    return sb16_copy_status();
+}
+
+
+int32_t ece391_audio_wait(int32_t half) {
+
+    enter();
+    return sb16_wait(half);
+}
+
+
+int32_t ece391_audio_clock(int32_t* frames) {
+
+    enter();
+    return sb16_clock(frames);
+}
+
+
+int32_t ece391_audio_pause(int32_t on) {
+
+    enter();
+    return sb16_pause(on);
+}
+
+
+int32_t ece391_audio_restart(const uint8_t* info_block) {
+
+    enter();
+    return sb16_restart(info_block);
+}
+
+
+int32_t ece391_audio_meter_post(int32_t half, const struct meter_stats* stats) {
+
+    enter();
+    return sb16_meter_post(half, stats);
+}
+
+
+int32_t ece391_audio_meter(struct meter_stats* stats) {
+
+    enter();
+    return sb16_meter_read(stats);
+}
+
+
+int32_t ece391_audio_standby(int32_t periods) {
+
+    enter();
+    return sb16_standby(periods);
+}
+
+
+uint32_t ece391_audio_standby_irqs(void) {
+
+    enter();
+    return sb16_standby_irqs();
+}
+
+
+int32_t ece391_audio_shutdown(void) {
+
+    enter();
+    return sb16_shutdown();
+}
+
+
+int32_t ece391_audio_midi_open(void) {
+
+    enter();
+    return sb16_midi_open();
+}
+
+
+int32_t ece391_audio_midi_read(uint8_t* buf, uint32_t n) {
+
+    enter();
+    return sb16_midi_read(buf, n);
+}
+
+
+int32_t ece391_audio_midi_write(const uint8_t* buf, uint32_t n) {
+
+    enter();
+    return sb16_midi_write(buf, n);
+}
+
+
+int32_t ece391_audio_midi_close(void) {
+
+    enter();
+    return sb16_midi_close();
+}
+
+
+int32_t ece391_audio_fm_open(void) {
+
+    enter();
+    return sb16_fm_open();
+}
+
+
+int32_t ece391_audio_fm_write(const uint32_t* writes, uint32_t n) {
+
+    enter();
+    return sb16_fm_write(writes, n);
+}
+
+
+int32_t ece391_audio_fm_close(void) {
+
+    enter();
+    return sb16_fm_close();
+}
+
+
+/* sys_dev_open, sys_dev_read, sys_dev_write, sys_dev_poll, sys_dev_close
+ *
+ * 		DESCRIPTION: open, read, write, poll and close on the card's
+ *		             device file, as the file system would route them
+ *		INPUTS: as the file operations
+ *		OUTPUTS: as the file operations
+ *		RETURN VALUE: as the file operations
+ *		SIDE EFFECTS: as the file operations
+ */
+int32_t sys_dev_open(void) {
+
+    enter();
+    return sb16_fd_open((const uint8_t*)SYS_DEV_NAME) == 0 ? SYS_DEV_FD : -1;
+}
+
+
+int32_t sys_dev_read(int32_t fd, void* buf, int32_t nbytes) {
+
+    enter();
+    return sb16_fd_read(fd, buf, nbytes);
+}
+
+
+int32_t sys_dev_write(int32_t fd, const void* buf, int32_t nbytes) {
+
+    enter();
+    return sb16_fd_write(fd, buf, nbytes);
+}
+
+
+int32_t sys_dev_poll(int32_t fd) {
+
+    enter();
+    return sb16_fd_poll(fd);
+}
+
+
+int32_t sys_dev_close(int32_t fd) {
+
+    enter();
+    return sb16_fd_close(fd);
+}
+
+
+/* enter
+ *
+ * 		DESCRIPTION: the int 0x80 and iret around a call
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: moves the clock on, taking an interrupt due
+ */
+static void enter(void) {
+
+    sys_calls++;
+    port_advance(SYSCALL_NS);
+}
@@ -0,0 +1,25 @@
+/* sys_sb16.h - The card's device file, for benches that write to it.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _SYS_SB16_H
+#define _SYS_SB16_H
+
+#include <stdint.h>
+
+/* trip into the kernel and back */
+#define SYSCALL_NS          1000ULL
+
+#define SYS_DEV_NAME        "sb16"
+#define SYS_DEV_FD          2
+
+extern uint64_t sys_calls;
+
+int32_t sys_dev_open(void);
+int32_t sys_dev_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t sys_dev_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t sys_dev_poll(int32_t fd);
+int32_t sys_dev_close(int32_t fd);
+
+
+#endif
@@ -0,0 +1,288 @@
+/* jump_bench.c - Seeks during playback (-j) on the driver and the card
+ * model, with the files read from a model of the storage. Each seek is
+ * made at a random point in a half and timed from the request to the
+ * moment the card starts playing the new position, two ways: as the
+ * player seeks, pausing the DMA, refilling both halves and restarting;
+ * and by refilling the next free half from the new position while the
+ * halves already filled play out. Seek targets are random frames; a
+ * compressed file is indexed first, so its seeks go straight to a point.
+ * Each file is run with free storage and with slow storage.
+ *   jump_bench a.wav [b.mp3 ...]
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "ece391syscall.h"
+#include "port.h"
+#include "wav.h"
+
+#define SEEKS               32
+#define SEED                12345
+#define WARMUP_HALVES       2
+#define STORAGES            2
+#define NS_PER_MS           1e6
+
+static wav_t wav;
+static int8_t* buf[2];
+static int32_t cur;
+static uint32_t seed;
+
+/* ns a request and ns a byte: free, and 200 us and 10 MB/s */
+static const uint64_t storage[STORAGES][2] = { { 0, 0 }, { 200000, 100 } };
+
+typedef struct tally {
+    uint64_t sum;
+    uint64_t max;
+    double host;
+} tally_t;
+
+
+/* local function definitions */
+static int32_t run(const char* name, const uint64_t* cost);
+static void fill(int32_t half);
+static void play(uint32_t halves);
+static uint64_t restart_seek(uint32_t frame);
+static uint64_t playout_seek(uint32_t frame);
+static void add(tally_t* t, uint64_t ns, double host);
+static uint32_t rnd(void);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the seeks on each file
+ *		INPUTS: argv[1..] -- files the player can play
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file played and seeked, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t i, s, ok = 1;
+
+    if (argc < 2) {
+        printf("usage: jump_bench a.wav [b.mp3 ...]\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        for (s = 0; s < STORAGES; s++) ok &= run(argv[i], storage[s]);
+    }
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: plays a file and makes the same seeks in it both ways
+ *		INPUTS: name -- the file
+ *		        cost -- ns a request and ns a byte of storage
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if it played and every seek restarted
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t run(const char* name, const uint64_t* cost) {
+
+    struct timespec a, b;
+    tally_t fast = { 0 }, slow = { 0 };
+    seek_index_t* idx;
+    uint64_t half_ns, l;
+    uint32_t span, i, frame;
+    int32_t init, ok = 1;
+
+    /* the length, and for a compressed file its whole index */
+    port_file_ns = port_file_byte_ns = 0;
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) {
+        printf("%s: can't play\n", name);
+        return 0;
+    }
+    idx = wav_index(&wav);
+    span = idx ? (idx->total ? idx->total : idx->pt[idx->npoints - 1].sample) :
+                 wav.data_size / wav.block_align;
+    wav_close(&wav);
+
+    port_file_ns = cost[0];
+    port_file_byte_ns = cost[1];
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0 ||
+            (init = ece391_audio_open()) == -1)
+        return 0;
+    buf[0] = (int8_t*)init;
+    buf[1] = buf[0] + PORT_HALF_SIZE;
+    fill(0);
+    fill(1);
+    if (ece391_audio_start(wav.info_block) == -1) {
+        printf("%s: can't start\n", name);
+        wav_close(&wav);
+        return 0;
+    }
+    cur = ece391_audio_cstatus();
+    half_ns = NS_PER_SEC * PORT_HALF_SIZE / wav.block_align / wav.sample_rate;
+
+    seed = SEED;
+    for (i = 0; i < SEEKS; i++) {
+        play(WARMUP_HALVES);
+        port_advance(rnd() % half_ns);
+        frame = rnd() % span;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        l = restart_seek(frame);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        if (!l) ok = 0;
+        add(&fast, l, host_ns(&a, &b));
+
+        play(WARMUP_HALVES);
+        port_advance(rnd() % half_ns);
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        l = playout_seek(frame);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        add(&slow, l, host_ns(&a, &b));
+    }
+    ece391_audio_shutdown();
+    wav_close(&wav);
+
+    printf("%s: %u seeks, a half is %.0f ms, storage %llu us a request and %llu ns a byte\n",
+           name, SEEKS, half_ns / NS_PER_MS, (unsigned long long)(cost[0] / NS_PER_US),
+           (unsigned long long)cost[1]);
+    printf("  restart  to audible mean %7.2f ms worst %7.2f ms; host %.2f ms a seek\n",
+           fast.sum / NS_PER_MS / SEEKS, fast.max / NS_PER_MS, fast.host / NS_PER_MS / SEEKS);
+    printf("  play out to audible mean %7.2f ms worst %7.2f ms; host %.2f ms a seek\n",
+           slow.sum / NS_PER_MS / SEEKS, slow.max / NS_PER_MS, slow.host / NS_PER_MS / SEEKS);
+
+    return ok;
+}
+
+
+/* fill
+ *
+ * 		DESCRIPTION: fills a half of the driver's buffer from the file,
+ *		             with silence past its end
+ *		INPUTS: half -- which half
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: reads the file
+ */
+static void fill(int32_t half) {
+
+    int32_t n = wav_fill(&wav, buf[half], PORT_HALF_SIZE);
+
+    if (n < 0) n = 0;
+    memset(buf[half] + n, 0, PORT_HALF_SIZE - n);
+}
+
+
+/* play
+ *
+ * 		DESCRIPTION: plays on for some halves, filling each as it's freed,
+ *		             as the player does
+ *		INPUTS: halves -- how many
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: reads the file
+ */
+static void play(uint32_t halves) {
+
+    uint32_t i;
+    int32_t h;
+
+    for (i = 0; i < halves; i++) {
+        if ((h = ece391_audio_wait(cur)) == -1) return;
+        fill(h);
+        cur = h;
+    }
+}
+
+
+/* restart_seek
+ *
+ * 		DESCRIPTION: seeks as the player's -j does: pauses the DMA,
+ *		             refills both halves from the new position and
+ *		             restarts from the first
+ *		INPUTS: frame -- where to go
+ *		OUTPUTS: none
+ *		RETURN VALUE: ns from the request until the new position plays,
+ *		              0 on fail
+ *		SIDE EFFECTS: reads the file, restarts the DMA
+ */
+static uint64_t restart_seek(uint32_t frame) {
+
+    uint64_t t = port_now;
+
+    if (ece391_audio_pause(1) == -1 || wav_seek(&wav, frame) == -1) return 0;
+    fill(0);
+    fill(1);
+    if (ece391_audio_restart(wav.info_block) == -1) return 0;
+    cur = ece391_audio_cstatus();
+
+    return port_dma_start() - t;
+}
+
+
+/* playout_seek
+ *
+ * 		DESCRIPTION: seeks without touching the DMA: the half playing and
+ *		             the one filled after it play out, and the next free
+ *		             half is filled from the new position
+ *		INPUTS: frame -- where to go
+ *		OUTPUTS: none
+ *		RETURN VALUE: ns from the request until the new position plays
+ *		SIDE EFFECTS: reads the file
+ */
+static uint64_t playout_seek(uint32_t frame) {
+
+    uint64_t t = port_now;
+
+    wav_seek(&wav, frame);
+    play(1);
+
+    /* it plays once the DMA reaches the half just filled */
+    return port_boundary(port_halves() + 1) - t;
+}
+
+
+/* add
+ *
+ * 		DESCRIPTION: counts a seek's latency
+ *		INPUTS: t -- tally
+ *		        ns -- virtual time to audible
+ *		        host -- host time the seek took
+ *		OUTPUTS: t -- sums and worst
+ *		RETURN VALUE: none
+ */
+static void add(tally_t* t, uint64_t ns, double host) {
+
+    t->sum += ns;
+    if (ns > t->max) t->max = ns;
+    t->host += host;
+}
+
+
+/* rnd
+ *
+ * 		DESCRIPTION: the next number of a fixed sequence, so every run
+ *		             makes the same seeks
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 31 random bits
+ */
+static uint32_t rnd(void) {
+
+    seed = seed * 1103515245 + 12345;
+
+    return seed >> 1;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,184 @@
+/* lim_bench.c - The look-ahead limiter (limiter.c) on the host. Drives
+ * 10 s of a loud stereo bus, noise in bursts up to twice full scale with
+ * single-frame spikes far past it, through the limiter at look-aheads
+ * from 1 ms up to its cap, in periods of the DMA half and in small ones.
+ * Checks that no sample gets past the threshold and times a frame of each.
+ * Then checks that the gain comes all the way back to unity after a
+ * spike, so a steady level below the threshold comes out unchanged.
+ *   lim_bench
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "limiter.h"
+#include "port.h"
+
+#define RATE                44100
+#define CHANNELS            2
+#define SECS                10
+#define FRAMES              (RATE * SECS)
+#define BURST_FRAMES        (RATE / 10)
+#define SPIKE_FRAMES        (RATE / 2)
+#define SPIKE               250000
+#define STEADY              10000
+#define SMALL_PERIOD        256
+#define REPEATS             3
+#define MS_PER_SEC          1000
+#define PCT                 100
+
+static const uint32_t lookahead_ms[] = { 1, 5, 10, 20, 47 };
+static const uint32_t periods[] = { PORT_HALF_WORDS / CHANNELS, SMALL_PERIOD };
+
+static limiter_t lim;
+static int32_t bus[FRAMES * CHANNELS];
+static int16_t out[FRAMES * CHANNELS];
+
+
+/* local function definitions */
+static double run(uint32_t lookahead, uint32_t period, int32_t* peak);
+static uint32_t recover(uint32_t lookahead, int32_t* level);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs every look-ahead at both period sizes, then the
+ *		             recovery from a spike at each look-ahead
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if nothing got past the threshold and the gain
+ *		              always came back to unity, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(void) {
+
+    uint32_t seed = 1, i, c, level = 0, l, p, lookahead;
+    int32_t peak, steady, ok = 1;
+    double ns;
+
+    for (i = 0; i < FRAMES; i++) {
+        if (i % BURST_FRAMES == 0) level = (i / BURST_FRAMES * 5 % 8 + 1) << 13;
+        for (c = 0; c < CHANNELS; c++) {
+            seed = seed * 1103515245 + 12345;
+            bus[i * CHANNELS + c] = (int32_t)(((int64_t)((int32_t)(seed >> 8) - (1 << 23)) *
+                                    level) >> 23);
+        }
+        if (i % SPIKE_FRAMES == SPIKE_FRAMES / 3) bus[i * CHANNELS] = SPIKE;
+    }
+
+    printf("%d s of stereo at %u Hz, threshold %d, best of %d:\n", SECS, RATE, LIM_THRESHOLD,
+           REPEATS);
+    for (l = 0; l < sizeof(lookahead_ms) / sizeof(lookahead_ms[0]); l++) {
+        lookahead = lookahead_ms[l] * RATE / MS_PER_SEC;
+        if (lookahead > LIM_MAX_LOOKAHEAD) lookahead = LIM_MAX_LOOKAHEAD;
+        for (p = 0; p < sizeof(periods) / sizeof(periods[0]); p++) {
+            ns = run(lookahead, periods[p], &peak);
+            printf("  %2u ms (%4u frames), periods of %4u: peak %5d %s, %.2f host ns a frame, "
+                   "%.3f%% of a period\n", lookahead_ms[l], lookahead, periods[p], peak,
+                   peak <= LIM_THRESHOLD ? "ok" : "OVER", ns, ns * RATE / 1e9 * PCT);
+            ok &= peak <= LIM_THRESHOLD;
+        }
+    }
+
+    printf("a spike of %d, then %d for the rest of the %d s:\n", SPIKE, STEADY, SECS);
+    for (l = 0; l < sizeof(lookahead_ms) / sizeof(lookahead_ms[0]); l++) {
+        lookahead = lookahead_ms[l] * RATE / MS_PER_SEC;
+        if (lookahead > LIM_MAX_LOOKAHEAD) lookahead = LIM_MAX_LOOKAHEAD;
+        i = recover(lookahead, &steady);
+        printf("  %2u ms: settled at %.0f ms, lowest %d over the last second %s\n",
+               lookahead_ms[l], (double)i * MS_PER_SEC / RATE, steady,
+               steady == STEADY ? "ok" : "STUCK");
+        ok &= steady == STEADY;
+    }
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: limits the whole bus a period at a time, keeping the
+ *		             best of the repeats
+ *		INPUTS: lookahead -- look-ahead in frames
+ *		        period -- frames a call
+ *		OUTPUTS: peak -- largest output magnitude
+ *		RETURN VALUE: host ns a frame
+ *		SIDE EFFECTS: none
+ */
+static double run(uint32_t lookahead, uint32_t period, int32_t* peak) {
+
+    struct timespec a, b;
+    uint32_t i, n;
+    int32_t rep, mag;
+    double ns, best = 0;
+
+    for (rep = 0; rep < REPEATS; rep++) {
+        lim_init(&lim, lookahead, CHANNELS, RATE);
+
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (i = 0; i < FRAMES; i += n) {
+            n = FRAMES - i < period ? FRAMES - i : period;
+            lim_process(&lim, bus + i * CHANNELS, out + i * CHANNELS, n, 0);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+
+        ns = host_ns(&a, &b);
+        if (!rep || ns < best) best = ns;
+    }
+
+    *peak = 0;
+    for (i = 0; i < FRAMES * CHANNELS; i++) {
+        mag = out[i] < 0 ? -out[i] : out[i];
+        if (mag > *peak) *peak = mag;
+    }
+
+    return best / FRAMES;
+}
+
+
+/* recover
+ *
+ * 		DESCRIPTION: limits a spike on both channels followed by a steady
+ *		             level under the threshold, which should come out
+ *		             whole once the gain is released
+ *		INPUTS: lookahead -- look-ahead in frames
+ *		OUTPUTS: level -- lowest output over the last second
+ *		RETURN VALUE: frames from the spike to the last change in the
+ *		              output
+ *		SIDE EFFECTS: overwrites the bus
+ */
+static uint32_t recover(uint32_t lookahead, int32_t* level) {
+
+    uint32_t i, last = 0;
+
+    for (i = 0; i < FRAMES * CHANNELS; i++)
+        bus[i] = i < CHANNELS ? SPIKE : STEADY;
+
+    lim_init(&lim, lookahead, CHANNELS, RATE);
+    lim_process(&lim, bus, out, FRAMES, 0);
+
+    /* the output runs lookahead frames behind the bus */
+    for (i = lookahead + 1; i < FRAMES; i++)
+        if (out[i * CHANNELS] != out[(i - 1) * CHANNELS]) last = i - lookahead;
+
+    *level = STEADY;
+    for (i = (FRAMES - RATE) * CHANNELS; i < FRAMES * CHANNELS; i++)
+        if (out[i] < *level) *level = out[i];
+
+    return last;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,171 @@
+/* loop_bench.c - Looping fills (wav.c) on the host. Plays a WAV file's
+ * smpl loop for many periods and checks every period against the file,
+ * wraps included, and that the file isn't read again once the loop body
+ * is cached; then times a period of the loop against a period of a
+ * straight read of another file.
+ *   loop_bench loop.wav straight.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "port.h"
+#include "wav.h"
+
+#define LOOP_PERIODS        2000
+
+static wav_t wav;
+static int8_t half[PORT_HALF_SIZE];
+
+
+/* local function definitions */
+static int32_t period_ok(uint64_t at);
+static int32_t looping(const char* name);
+static void straight(const char* name);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the check and the timings
+ *		INPUTS: argv[1] -- WAV file with a smpl loop made by loop_wav.py
+ *		        argv[2] -- WAV file to read straight through
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if the loop played exactly, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t ok;
+
+    if (argc < 3) {
+        printf("usage: loop_bench loop.wav straight.wav\n");
+        return 1;
+    }
+
+    ok = looping(argv[1]);
+    straight(argv[2]);
+
+    return ok ? 0 : 1;
+}
+
+
+/* period_ok
+ *
+ * 		DESCRIPTION: checks a period of the loop against the file's
+ *		             pattern, sample i being i * 7 + 1
+ *		INPUTS: at -- bytes played before the period
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if it matches
+ */
+static int32_t period_ok(uint64_t at) {
+
+    uint64_t p, q, body = wav.loop_end - wav.loop_start;
+    uint16_t* s = (uint16_t*)half;
+    uint32_t i;
+
+    for (i = 0; i < PORT_HALF_WORDS; i++) {
+        p = at + i * 2;
+        q = p < wav.loop_end ? p : wav.loop_start + (p - wav.loop_start) % body;
+        if (s[i] != (uint16_t)(q / 2 * 7 + 1)) return 0;
+    }
+
+    return 1;
+}
+
+
+/* looping
+ *
+ * 		DESCRIPTION: fills periods from the loop, checking each and timing
+ *		             those served from the cache
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every period matched and the file was read
+ *		              once
+ *		SIDE EFFECTS: prints the result
+ */
+static int32_t looping(const char* name) {
+
+    struct timespec a, b;
+    uint64_t at = 0;
+    uint32_t p, cached = 0, in_cache = 0, read_to, exact = 1;
+    double ns = 0;
+
+    if (wav_open(&wav, (const uint8_t*)name, 1) != 0 || !wav.loop_end) {
+        printf("%s: no loop\n", name);
+        return 0;
+    }
+
+    for (p = 0; p < LOOP_PERIODS; p++) {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        if (wav_fill(&wav, half, PORT_HALF_SIZE) != PORT_HALF_SIZE) exact = 0;
+        clock_gettime(CLOCK_MONOTONIC, &b);
+
+        /* the first pass reads the body into the cache */
+        if (in_cache) {
+            ns += host_ns(&a, &b);
+            cached++;
+        }
+        in_cache = wav.file_pos == wav.loop_end;
+
+        exact &= period_ok(at);
+        at += PORT_HALF_SIZE;
+    }
+    read_to = wav.file_pos;
+    wav_close(&wav);
+
+    printf("loop: %u periods over a %u-byte body, %s, file read to %u and no further; "
+           "%.0f host ns a period from the cache\n", LOOP_PERIODS, wav.loop_end - wav.loop_start,
+           exact ? "exact" : "WRONG", read_to, ns / cached);
+
+    return exact && read_to == wav.loop_end;
+}
+
+
+/* straight
+ *
+ * 		DESCRIPTION: times periods read straight through a file
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the result
+ */
+static void straight(const char* name) {
+
+    struct timespec a, b;
+    uint32_t periods = 0;
+    int32_t n;
+    double ns = 0;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) {
+        printf("%s: not a WAV file\n", name);
+        return;
+    }
+
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        n = wav_fill(&wav, half, PORT_HALF_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        if (n == PORT_HALF_SIZE) {
+            ns += host_ns(&a, &b);
+            periods++;
+        }
+    } while (n == PORT_HALF_SIZE);
+    wav_close(&wav);
+
+    printf("straight: %u periods, %.0f host ns a period from the file\n", periods, ns / periods);
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
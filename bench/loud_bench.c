@@ -0,0 +1,143 @@
+/* loud_bench.c - The loudness scan (loudness.c) the player's -s and -n
+ * make, on the host. Scans each WAV file whole, best of three, and gives
+ * the speed as a multiple of real time, beside a read of the same file
+ * in the scan's 4 KB pieces with no K-weighting or gating, which is the
+ * floor; then scans once more from storage at a request of 200 us and
+ * 10 MB/s, to give the speed the storage alone allows.
+ *   loud_bench a.wav [b.wav ...]
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "loudness.h"
+#include "port.h"
+#include "wav.h"
+
+#define REPEATS             3
+#define FILE_NS             200000ULL
+#define FILE_BYTE_NS        100ULL
+#define LU_TENTHS           10
+
+static loudness_t loud;
+static wav_t wav;
+static int8_t buf[SCRATCH_SIZE];
+
+
+/* local function definitions */
+static int32_t run(const char* name);
+static double read_ns(const char* name);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each file
+ *		INPUTS: argv[1...] -- 16-bit WAV files
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file scanned, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t i, ok = 1;
+
+    if (argc < 2) {
+        printf("usage: loud_bench a.wav [b.wav ...]\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) ok &= run(argv[i]);
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: scans a file from memory and from storage
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if it scanned
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t run(const char* name) {
+
+    struct timespec a, b;
+    double ns, best = 0, floor = 0, secs;
+    uint64_t t;
+    int32_t lufs, r;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) {
+        printf("%s: can't open\n", name);
+        return 0;
+    }
+    secs = (double)wav.data_size / wav.block_align / wav.sample_rate;
+    wav_close(&wav);
+
+    port_file_ns = port_file_byte_ns = 0;
+    for (r = 0; r < REPEATS; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        if (loud_scan(&loud, (const uint8_t*)name, &lufs) == -1) {
+            printf("%s: can't scan\n", name);
+            return 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        ns = host_ns(&a, &b);
+        if (!r || ns < best) best = ns;
+
+        ns = read_ns(name);
+        if (!r || ns < floor) floor = ns;
+    }
+
+    /* storage is charged to virtual time, the scan's work to the host */
+    port_file_ns = FILE_NS;
+    port_file_byte_ns = FILE_BYTE_NS;
+    t = port_now;
+    loud_scan(&loud, (const uint8_t*)name, &lufs);
+    t = port_now - t;
+    port_file_ns = port_file_byte_ns = 0;
+
+    printf("%s: %.1f s, %.1f LUFS; scan %.1f host ms, %.0fx real time; read alone %.1f ms, "
+           "%.0fx; from storage %.0f ms, %.0fx\n", name, secs, (double)lufs / LU_TENTHS,
+           best / 1e6, secs * 1e9 / best, floor / 1e6, secs * 1e9 / floor, t / 1e6, secs * 1e9 / t);
+
+    return 1;
+}
+
+
+/* read_ns
+ *
+ * 		DESCRIPTION: reads a file through as the scan does, doing nothing
+ *		             with the samples
+ *		INPUTS: name -- WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: host ns the read took
+ *		SIDE EFFECTS: none
+ */
+static double read_ns(const char* name) {
+
+    struct timespec a, b;
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) return 0;
+    while (wav_fill(&wav, buf, sizeof(buf) - sizeof(buf) % wav.block_align) > 0);
+    wav_close(&wav);
+    clock_gettime(CLOCK_MONOTONIC, &b);
+
+    return host_ns(&a, &b);
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
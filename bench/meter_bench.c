@@ -0,0 +1,198 @@
+/* meter_bench.c - Metering (meter.c) on the host, on each of the paths
+ * the player packs a period by: the mix bus saturated to 16 bits, the
+ * bus through the limiter, and a file read straight into the half. Times
+ * a 186 ms period of stereo noise with metering off and on, and for the
+ * limiter against metering in a second pass over its output, and checks
+ * that metering in the limiter gives the levels the second pass does.
+ *   meter_bench
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "fixmath.h"
+#include "limiter.h"
+#include "meter.h"
+#include "port.h"
+
+#define RATE                44100
+#define CHANNELS            2
+#define FRAMES              (PORT_HALF_WORDS / CHANNELS)
+#define LOOKAHEAD           (RATE / 100)
+#define PERIODS             2000
+#define REPEATS             3
+#define LEVEL               20000
+#define PCT                 100
+
+/* how a period is packed */
+#define PACK                0
+#define PACK_METER          1
+#define LIM                 2
+#define LIM_METER           3
+#define LIM_SCAN            4
+#define STRAIGHT            5
+#define STRAIGHT_METER      6
+#define WAYS                7
+
+static const char* const way_name[WAYS] = {
+    "bus packed", "bus packed, metered", "limiter", "limiter, metered",
+    "limiter, then scanned", "straight, silence check", "straight, metered"
+};
+
+static limiter_t lim, twin;
+static meter_t meter;
+static int32_t bus[PORT_HALF_WORDS];
+static int16_t out[PORT_HALF_WORDS];
+
+
+/* local function definitions */
+static double run(int32_t way);
+static int32_t same_levels(void);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: checks the limiter's metering, then times each way
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if the limiter metered what a scan does, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(void) {
+
+    uint32_t seed = 1, i;
+    int32_t way, r, ok;
+    double ns, best[WAYS], period_ns = (double)NS_PER_SEC * FRAMES / RATE;
+
+    /* noise well below the threshold, so the limiter passes it through */
+    for (i = 0; i < PORT_HALF_WORDS; i++) {
+        seed = seed * 1103515245 + 12345;
+        bus[i] = (int32_t)(seed >> 16) % (2 * LEVEL) - LEVEL;
+    }
+
+    ok = same_levels();
+    printf("limiter metering: %s the levels of a second pass\n", ok ? "same as" : "DIFFERENT FROM");
+
+    for (way = 0; way < WAYS; way++) {
+        for (r = 0; r < REPEATS; r++) {
+            ns = run(way);
+            if (!r || ns < best[way]) best[way] = ns;
+        }
+    }
+
+    for (way = 0; way < WAYS; way++) {
+        printf("%-26s %6.1f host us a period, %.3f%% of it", way_name[way],
+               best[way] / NS_PER_US, best[way] / period_ns * PCT);
+        if (way == PACK_METER || way == STRAIGHT_METER || way == LIM_METER)
+            printf(", metering %+.1f us", (best[way] - best[way - 1]) / NS_PER_US);
+        if (way == LIM_SCAN)
+            printf(", %+.1f us over metering in the limiter", (best[way] - best[LIM_METER]) / NS_PER_US);
+        printf("\n");
+    }
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: packs the period PERIODS times one way
+ *		INPUTS: way -- PACK to STRAIGHT_METER
+ *		OUTPUTS: none
+ *		RETURN VALUE: host ns a period
+ *		SIDE EFFECTS: none
+ */
+static double run(int32_t way) {
+
+    struct timespec a, b;
+    uint32_t p, i;
+    int32_t quiet = 0;
+
+    lim_init(&lim, LOOKAHEAD, CHANNELS, RATE);
+    for (i = 0; i < PORT_HALF_WORDS; i++) out[i] = bus[i];
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (p = 0; p < PERIODS; p++) {
+        meter_start(&meter, CHANNELS);
+        switch (way) {
+        case PACK:
+            for (i = 0; i < PORT_HALF_WORDS; i++) out[i] = fix_sat16(bus[i]);
+            break;
+        case PACK_METER:
+            meter_pack(&meter, bus, out, FRAMES);
+            break;
+        case LIM:
+            lim_process(&lim, bus, out, FRAMES, 0);
+            break;
+        case LIM_METER:
+            lim_process(&lim, bus, out, FRAMES, &meter);
+            break;
+        case LIM_SCAN:
+            lim_process(&lim, bus, out, FRAMES, 0);
+            meter_scan(&meter, out, FRAMES);
+            break;
+        case STRAIGHT:
+            quiet += meter_silent(out, PORT_HALF_WORDS);
+            break;
+        case STRAIGHT_METER:
+            meter_scan(&meter, out, FRAMES);
+            quiet += meter_quiet(&meter);
+            break;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+
+    /* keeps the checks from being thrown away */
+    if (quiet) printf("the noise was silent\n");
+
+    return host_ns(&a, &b) / PERIODS;
+}
+
+
+/* same_levels
+ *
+ * 		DESCRIPTION: meters a few periods in the limiter and by a second
+ *		             pass over its output, and compares the levels
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if they match
+ *		SIDE EFFECTS: none
+ */
+static int32_t same_levels(void) {
+
+    meter_stats_t fused, scanned;
+    uint32_t p;
+
+    lim_init(&lim, LOOKAHEAD, CHANNELS, RATE);
+    lim_init(&twin, LOOKAHEAD, CHANNELS, RATE);
+    for (p = 0; p < REPEATS; p++) {
+        meter_start(&meter, CHANNELS);
+        lim_process(&lim, bus, out, FRAMES, &meter);
+        meter_finish(&meter, &fused);
+
+        meter_start(&meter, CHANNELS);
+        lim_process(&twin, bus, out, FRAMES, 0);
+        meter_scan(&meter, out, FRAMES);
+        meter_finish(&meter, &scanned);
+
+        if (memcmp(&fused, &scanned, sizeof(fused))) return 0;
+    }
+
+    return 1;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
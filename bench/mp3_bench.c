@@ -0,0 +1,217 @@
+/* mp3_bench.c - The Layer III decoder (mp3dec.c) on the host. Decodes
+ * each file whole, lines it up with a reference decode of the same file,
+ * which may have had the encoder's delay trimmed off its start, and
+ * reports how far the output strays from it in 16-bit steps. Then times
+ * the decode against the length of the audio.
+ *   mp3_bench a.mp3 a.wav [b.mp3 b.wav ...]
+ * Written by Soumithri Bala. */
+
+
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "mp3dec.h"
+#include "wav.h"
+
+#define MAX_FRAMES          (1 << 20)
+#define MAX_LAG             4096
+#define MATCH_FRAMES        8192
+#define CHUNK               4096
+#define REPEATS             3
+#define BOUND_LSB           1       /* the error bound the README states */
+
+static mp3dec_t dec;
+static wav_t ref_wav;
+static int16_t out[MAX_FRAMES * MP3_MAX_CHANNELS];
+static int16_t ref[MAX_FRAMES * MP3_MAX_CHANNELS];
+
+
+/* local function definitions */
+static int32_t decode(const char* name, uint32_t* frames, double* ns);
+static int32_t load_ref(const char* name, uint32_t* frames);
+static uint32_t find_lag(uint32_t n, uint32_t m, uint32_t ch);
+static int32_t compare(const char* mp3, const char* wav);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: checks and times each file against its reference
+ *		INPUTS: argv[1..] -- pairs of an MP3 file and its reference decode
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file is within the bound, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t i, ok = 1;
+
+    if (argc < 3 || !(argc & 1)) {
+        printf("usage: mp3_bench a.mp3 a.wav [b.mp3 b.wav ...]\n");
+        return 1;
+    }
+
+    for (i = 1; i + 1 < argc; i += 2) ok &= compare(argv[i], argv[i + 1]);
+
+    return ok ? 0 : 1;
+}
+
+
+/* decode
+ *
+ * 		DESCRIPTION: decodes a file whole, keeping the best time of the
+ *		             repeats
+ *		INPUTS: name -- MP3 file
+ *		OUTPUTS: frames -- frames decoded
+ *		         ns -- host ns the best decode took
+ *		RETURN VALUE: 0 on success, -1 if the file didn't open
+ *		SIDE EFFECTS: fills out
+ */
+static int32_t decode(const char* name, uint32_t* frames, double* ns) {
+
+    struct timespec a, b;
+    uint32_t n, bytes;
+    int32_t rep, got;
+    double t;
+
+    for (rep = 0; rep < REPEATS; rep++) {
+        if (mp3dec_open(&dec, (const uint8_t*)name) == -1) return -1;
+        bytes = CHUNK * dec.channels * sizeof(int16_t);
+
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (n = 0; n + CHUNK <= MAX_FRAMES; n += got / (dec.channels * sizeof(int16_t))) {
+            got = mp3dec_read(&dec, (int8_t*)(out + n * dec.channels), bytes);
+            if (got <= 0) break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        mp3dec_close(&dec);
+
+        t = host_ns(&a, &b);
+        if (!rep || t < *ns) *ns = t;
+        *frames = n;
+    }
+
+    return 0;
+}
+
+
+/* load_ref
+ *
+ * 		DESCRIPTION: reads a reference decode
+ *		INPUTS: name -- 16-bit WAV file
+ *		OUTPUTS: frames -- frames read
+ *		RETURN VALUE: channels, or -1 if it isn't a 16-bit WAV file
+ *		SIDE EFFECTS: fills ref
+ */
+static int32_t load_ref(const char* name, uint32_t* frames) {
+
+    uint32_t n = 0, ch;
+    int32_t got;
+
+    if (wav_open(&ref_wav, (const uint8_t*)name, 0) != 0 || ref_wav.bits != 16)
+        return -1;
+    ch = ref_wav.nchannels;
+
+    while (n + CHUNK <= MAX_FRAMES) {
+        got = wav_fill(&ref_wav, (int8_t*)(ref + n * ch), CHUNK * ch * sizeof(int16_t));
+        if (got <= 0) break;
+        n += got / (ch * sizeof(int16_t));
+    }
+    wav_close(&ref_wav);
+    *frames = n;
+
+    return ch;
+}
+
+
+/* find_lag
+ *
+ * 		DESCRIPTION: finds how many frames of output come before the
+ *		             reference starts, as the lag that matches a stretch
+ *		             of the reference most closely
+ *		INPUTS: n -- frames of output
+ *		        m -- frames of reference
+ *		        ch -- channels of both
+ *		OUTPUTS: none
+ *		RETURN VALUE: frames to skip in the output
+ *		SIDE EFFECTS: none
+ */
+static uint32_t find_lag(uint32_t n, uint32_t m, uint32_t ch) {
+
+    uint32_t lag, best_lag = 0, i, len = m < MATCH_FRAMES ? m : MATCH_FRAMES;
+    double err, best = -1, d;
+
+    for (lag = 0; lag < MAX_LAG && lag + len <= n; lag++) {
+        err = 0;
+        for (i = 0; i < len * ch && (best < 0 || err < best); i++) {
+            d = out[lag * ch + i] - ref[i];
+            err += d * d;
+        }
+        if (best < 0 || err < best) {
+            best = err;
+            best_lag = lag;
+        }
+    }
+
+    return best_lag;
+}
+
+
+/* compare
+ *
+ * 		DESCRIPTION: decodes a file, lines it up with its reference and
+ *		             prints the largest and RMS difference over the frames
+ *		             both have, and the decode's speed
+ *		INPUTS: mp3 -- MP3 file
+ *		        wav -- its reference decode
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if the largest difference is within the bound
+ *		SIDE EFFECTS: prints the result
+ */
+static int32_t compare(const char* mp3, const char* wav) {
+
+    uint32_t n, m, ch, lag, len, i, over = 0;
+    int32_t d, max = 0;
+    double ns, sq = 0, secs;
+
+    if (decode(mp3, &n, &ns) == -1) {
+        printf("%s: not an MP3 file\n", mp3);
+        return 0;
+    }
+    if ((int32_t)(ch = load_ref(wav, &m)) == -1 || ch != dec.channels) {
+        printf("%s: not a 16-bit WAV file of %u channels\n", wav, dec.channels);
+        return 0;
+    }
+
+    lag = find_lag(n, m, ch);
+    len = n - lag < m ? n - lag : m;
+    for (i = 0; i < len * ch; i++) {
+        d = out[lag * ch + i] - ref[i];
+        if (d < 0) d = -d;
+        if (d > max) max = d;
+        if (d > 1) over++;
+        sq += (double)d * d;
+    }
+
+    secs = (double)n / dec.sample_rate;
+    printf("%s: %u Hz, %u ch, %u kbps, %.1f s; lag %u, %u frames compared: max %d LSB, "
+           "rms %.3f LSB, %u samples over 1 LSB; %.2f host ms a second of audio, %.0fx real "
+           "time\n", mp3, dec.sample_rate, ch, dec.mp3.hdr.bitrate, secs, lag, len, max,
+           len ? sqrt(sq / (len * ch)) : 0, over, ns / 1e6 / secs, secs * 1e9 / ns);
+
+    return max <= BOUND_LSB;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
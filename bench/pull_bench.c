@@ -0,0 +1,269 @@
+/* pull_bench.c - Pull-model streams (pull.c) on the driver and the card
+ * model. Checks that a stream whose client runs dry plays out exactly and
+ * releases the card, then measures what a period costs: system calls and
+ * host time to dispatch the fill, and how long after the DMA frees a half
+ * the client gets it, against a client polling ece391_audio_cstatus.
+ *   pull_bench [periods]
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ece391syscall.h"
+#include "port.h"
+#include "pull.h"
+#include "sys_sb16.h"
+
+#define DEFAULT_PERIODS     100000
+#define PUSH_PERIODS        1000
+#define END_AFTER           5
+#define HEADER_SIZE         44
+
+/* the driver's state the checks look at */
+extern volatile int32_t in_use;
+
+typedef struct client {
+    uint32_t fills;
+    uint32_t limit;         /* fills before running dry, 0 for never */
+    uint32_t pattern;       /* 1 to write the samples, 0 to time dispatch */
+    uint32_t next;          /* samples of the counting pattern written */
+    uint64_t lat_sum;       /* ns from the boundary to the fill */
+    uint64_t lat_max;
+    uint64_t lat_n;
+} client_t;
+
+
+/* local function definitions */
+static uint32_t fill(void* ctx, int8_t* dst, uint32_t frames);
+static void latency(client_t* c);
+static void header(uint8_t* h);
+static int32_t ending(void);
+static void dispatch(uint32_t periods);
+static void push(void);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the check and the two measurements
+ *		INPUTS: argv[1] -- periods to time, optional
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if the check passed, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    uint32_t periods = argc > 1 ? (uint32_t)atol(argv[1]) : DEFAULT_PERIODS;
+    int32_t ok;
+
+    ok = ending();
+    dispatch(periods);
+    push();
+
+    return ok ? 0 : 1;
+}
+
+
+/* fill
+ *
+ * 		DESCRIPTION: the client: a counting pattern, a third of a period
+ *		             once it runs dry
+ *		INPUTS: ctx -- client state
+ *		        frames -- frames wanted
+ *		OUTPUTS: dst -- frames written
+ *		RETURN VALUE: frames written
+ *		SIDE EFFECTS: records the wake latency
+ */
+static uint32_t fill(void* ctx, int8_t* dst, uint32_t frames) {
+
+    client_t* c = ctx;
+    int16_t* out = (int16_t*)dst;
+    uint32_t i;
+
+    /* the first two fills are before the start */
+    if (c->fills++ >= 2) latency(c);
+
+    if (c->limit && c->fills > c->limit) frames /= 3;
+    if (c->pattern) {
+        for (i = 0; i < frames * 2; i++) out[i] = (int16_t)c->next++;
+    }
+
+    return frames;
+}
+
+
+/* latency
+ *
+ * 		DESCRIPTION: notes how long ago the DMA freed the half now being
+ *		             handed out
+ *		INPUTS: c -- client state
+ *		OUTPUTS: c -- latency counts
+ *		RETURN VALUE: none
+ */
+static void latency(client_t* c) {
+
+    uint64_t l = port_now - port_boundary(port_halves());
+
+    c->lat_sum += l;
+    if (l > c->lat_max) c->lat_max = l;
+    c->lat_n++;
+}
+
+
+/* header
+ *
+ * 		DESCRIPTION: makes the WAV header of a 48 kHz 16-bit stereo stream
+ *		INPUTS: none
+ *		OUTPUTS: h -- the header
+ *		RETURN VALUE: none
+ */
+static void header(uint8_t* h) {
+
+    static const uint8_t wav[HEADER_SIZE] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0,
+        0x80, 0xBB, 0, 0, 0x00, 0xEE, 0x02, 0, 4, 0, 16, 0,
+        'd', 'a', 't', 'a', 0, 0, 0, 0
+    };
+    uint32_t i;
+
+    for (i = 0; i < HEADER_SIZE; i++) h[i] = wav[i];
+}
+
+
+/* ending
+ *
+ * 		DESCRIPTION: runs a stream whose client runs dry in its sixth
+ *		             period and checks what the DMA played
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if it played exactly and released the card
+ *		SIDE EFFECTS: prints the result
+ */
+static int32_t ending(void) {
+
+    client_t c = { 0 };
+    pull_t p;
+    uint8_t h[HEADER_SIZE];
+    uint64_t n, i, want, end;
+    int16_t* rec;
+    int32_t ret, exact = 1;
+
+    header(h);
+    c.limit = END_AFTER;
+    c.pattern = 1;
+    port_record(1);
+    if (pull_open(&p, h, fill, &c) == -1) {
+        printf("ending: open failed\n");
+        return 0;
+    }
+    end = port_boundary(END_AFTER + 1);
+    ret = pull_run(&p);
+    port_record(0);
+
+    /* five full periods, a third of the sixth, then silence */
+    rec = port_recorded(&n);
+    want = (uint64_t)c.next;
+    for (i = 0; i < n; i++) {
+        if (rec[i] != (i < want ? (int16_t)i : 0)) {
+            exact = 0;
+            break;
+        }
+    }
+
+    printf("ending: ret %d, %u fills, %u periods, card %s, returned %.1f us after "
+           "the end half played, %llu halves recorded, %s\n",
+           ret, c.fills, p.periods, in_use ? "held" : "released",
+           ((double)port_now - end) / NS_PER_US, (unsigned long long)n / PORT_HALF_WORDS,
+           exact && n >= want ? "exact" : "WRONG");
+
+    return ret == 0 && !in_use && exact && n >= want;
+}
+
+
+/* dispatch
+ *
+ * 		DESCRIPTION: times pull_step over many periods
+ *		INPUTS: periods -- how many
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the result
+ */
+static void dispatch(uint32_t periods) {
+
+    client_t c = { 0 };
+    pull_t p;
+    uint8_t h[HEADER_SIZE];
+    struct timespec a, b;
+    uint64_t calls;
+    uint32_t i;
+
+    header(h);
+    if (pull_open(&p, h, fill, &c) == -1) return;
+
+    calls = sys_calls;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (i = 0; i < periods; i++) pull_step(&p);
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    calls = sys_calls - calls;
+    ece391_audio_shutdown();
+
+    printf("pull: %u periods, %.2f system calls a period, %.1f host ns a period, "
+           "fill %.1f us after the boundary on average, %.1f us at most\n",
+           periods, (double)calls / periods, host_ns(&a, &b) / periods,
+           (double)c.lat_sum / c.lat_n / NS_PER_US, (double)c.lat_max / NS_PER_US);
+}
+
+
+/* push
+ *
+ * 		DESCRIPTION: the same stream filled by polling the interrupt
+ *		             status, as user_level_program.c does with work to do
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the result
+ */
+static void push(void) {
+
+    client_t c = { 0 };
+    uint8_t h[HEADER_SIZE];
+    uint64_t calls;
+    int32_t prev = 1, status;
+    uint32_t periods = 0;
+
+    header(h);
+    if (ece391_audio_open() == -1 || ece391_audio_start(h) == -1) return;
+
+    c.fills = 2;
+    calls = sys_calls;
+    while (periods < PUSH_PERIODS) {
+        if ((status = ece391_audio_cstatus()) != prev) {
+            latency(&c);
+            prev = status;
+            periods++;
+        }
+    }
+    calls = sys_calls - calls;
+    ece391_audio_shutdown();
+
+    printf("push: %u periods, %.0f system calls a period, "
+           "fill %.1f us after the boundary on average, %.1f us at most\n",
+           periods, (double)calls / periods,
+           (double)c.lat_sum / c.lat_n / NS_PER_US, (double)c.lat_max / NS_PER_US);
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,301 @@
+/* seek_bench.c - Random seeks in compressed files (wav.c, seekidx.c) on
+ * the host. Each file gets the same random seeks three ways: in a fresh
+ * process with no seek.cache, so every seek has to find its own way
+ * through the file; again in that process, with the points the first
+ * seeks left behind; and in a fresh process reading the seek.cache the
+ * player's -k would have put in the image. A seek is timed from
+ * wav_seek to the end of the first half it fills, in virtual time spent
+ * on the storage model and in host time spent decoding.
+ *   seek_bench a.mp3 [b.ogg ...]
+ * Written by Soumithri Bala. */
+
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "port.h"
+#include "wav.h"
+
+#define SEEKS               64
+#define SEED                12345
+/* storage at a request of 200 us and 10 MB/s */
+#define FILE_NS             200000ULL
+#define FILE_BYTE_NS        100ULL
+#define NS_PER_MS           1e6
+
+static wav_t wav;
+static int8_t half[PORT_HALF_SIZE];
+static uint32_t seed;
+
+
+/* local function definitions */
+static int32_t run(const char* path);
+static void build(const char* name, int32_t out);
+static int32_t timed(const char* name, uint32_t span, int32_t passes);
+static void pass(const char* what, uint32_t span);
+static int32_t finish(pid_t pid);
+static uint32_t rnd(void);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the seeks on each file in a scratch directory,
+ *		             where the cache file goes
+ *		INPUTS: argv[1..] -- MP3 or Ogg Vorbis files
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file opened and seeked, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    char dir[] = "/tmp/seek_benchXXXXXX";
+    char path[PATH_MAX];
+    int32_t i, ok = 1;
+
+    if (argc < 2) {
+        printf("usage: seek_bench a.mp3 [b.ogg ...]\n");
+        return 1;
+    }
+    if (!mkdtemp(dir)) return 1;
+
+    printf("storage: %llu us a request, %llu ns a byte\n", FILE_NS / NS_PER_US, FILE_BYTE_NS);
+    for (i = 1; i < argc; i++) {
+        if (!realpath(argv[i], path) || chdir(dir) == -1) {
+            printf("%s: not found\n", argv[i]);
+            ok = 0;
+            continue;
+        }
+        ok &= run(path);
+    }
+    rmdir(dir);
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: indexes a file in one process, then seeks in it in
+ *		             two more, the first without the cache file and the
+ *		             second with it
+ *		INPUTS: path -- the file's full path
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every process succeeded
+ *		SIDE EFFECTS: makes and removes a link to the file and the cache
+ *		              file in the current directory; prints the results
+ */
+static int32_t run(const char* path) {
+
+    const char* name = strrchr(path, '/') + 1;
+    uint32_t span = 0;
+    int32_t fds[2], ok;
+    pid_t pid;
+
+    printf("%s\n", name);
+    if (symlink(path, name) == -1 || pipe(fds) == -1) return 0;
+
+    fflush(stdout);
+    if (!(pid = fork())) build(name, fds[1]);
+    close(fds[1]);
+    if (read(fds[0], &span, sizeof(span)) != sizeof(span)) span = 0;
+    close(fds[0]);
+    ok = finish(pid) && span;
+
+    /* the same seeks without the cache file, then with it */
+    if (ok) {
+        rename(SEEK_CACHE_FILE, SEEK_CACHE_FILE ".keep");
+        ok = timed(name, span, 2);
+        rename(SEEK_CACHE_FILE ".keep", SEEK_CACHE_FILE);
+        ok &= timed(name, span, 1);
+    }
+
+    unlink(SEEK_CACHE_FILE);
+    unlink(name);
+
+    return ok;
+}
+
+
+/* build
+ *
+ * 		DESCRIPTION: in a child, reads a file to its end for its index,
+ *		             as -k does, and prints the index to the cache file
+ *		INPUTS: name -- the file
+ *		        out -- pipe to send the length in frames down
+ *		OUTPUTS: none
+ *		RETURN VALUE: none; exits
+ *		SIDE EFFECTS: writes the cache file, prints the time it took
+ */
+static void build(const char* name, int32_t out) {
+
+    struct timespec a, b;
+    seek_index_t* idx;
+    uint64_t t;
+    uint32_t span;
+    int32_t fd, term;
+
+    port_file_ns = FILE_NS;
+    port_file_byte_ns = FILE_BYTE_NS;
+    t = port_now;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0 || !(idx = wav_index(&wav)) || !idx->npoints) {
+        printf("  not an MP3 or Ogg Vorbis file\n");
+        exit(1);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    span = idx->total ? idx->total : idx->pt[idx->npoints - 1].sample;
+
+    printf("  index: %u points over %.1f s, built in %.0f ms storage + %.0f ms host\n",
+           idx->npoints, (double)span / wav.sample_rate, (port_now - t) / NS_PER_MS,
+           host_ns(&a, &b) / NS_PER_MS);
+
+    /* what -k prints goes to the cache file */
+    fflush(stdout);
+    term = dup(1);
+    fd = open(SEEK_CACHE_FILE, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    dup2(fd, 1);
+    close(fd);
+    seek_print((const uint8_t*)name, idx);
+    fflush(stdout);
+    dup2(term, 1);
+    close(term);
+    wav_close(&wav);
+
+    if (write(out, &span, sizeof(span)) != sizeof(span)) exit(1);
+    exit(0);
+}
+
+
+/* timed
+ *
+ * 		DESCRIPTION: runs passes of the seeks in a fresh process
+ *		INPUTS: name -- the file
+ *		        span -- its length in frames
+ *		        passes -- 2 to follow a pass without the cache file with
+ *		                  one on the points it found, 1 for the cache file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if the process succeeded
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t timed(const char* name, uint32_t span, int32_t passes) {
+
+    uint64_t t;
+    pid_t pid;
+
+    fflush(stdout);
+    if (!(pid = fork())) {
+        port_file_ns = FILE_NS;
+        port_file_byte_ns = FILE_BYTE_NS;
+        t = port_now;
+        if (wav_open(&wav, (const uint8_t*)name, 0) != 0) exit(1);
+        printf("  open: %.1f ms storage%s\n", (port_now - t) / NS_PER_MS,
+               passes == 1 ? ", reading " SEEK_CACHE_FILE : "");
+        if (passes == 2) {
+            pass("cold", span);
+            pass("again", span);
+        } else {
+            pass("cached", span);
+        }
+        wav_close(&wav);
+        exit(0);
+    }
+
+    return finish(pid);
+}
+
+
+/* pass
+ *
+ * 		DESCRIPTION: makes the seeks, the same ones each pass, filling a
+ *		             half after each
+ *		INPUTS: what -- name of the pass
+ *		        span -- length of the file in frames
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the first, mean and worst seek
+ */
+static void pass(const char* what, uint32_t span) {
+
+    struct timespec a, b;
+    uint64_t t, v, v_first = 0, v_sum = 0, v_max = 0;
+    double h, h_first = 0, h_sum = 0, h_max = 0;
+    uint32_t i;
+
+    seed = SEED;
+    for (i = 0; i < SEEKS; i++) {
+        t = port_now;
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        wav_seek(&wav, rnd() % span);
+        wav_fill(&wav, half, PORT_HALF_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+
+        v = port_now - t;
+        h = host_ns(&a, &b);
+        if (!i) {
+            v_first = v;
+            h_first = h;
+        }
+        v_sum += v;
+        h_sum += h;
+        if (v > v_max) v_max = v;
+        if (h > h_max) h_max = h;
+    }
+
+    printf("  %-6s storage ms first %6.1f mean %6.1f worst %6.1f; "
+           "host ms first %5.2f mean %5.2f worst %5.2f\n", what,
+           v_first / NS_PER_MS, v_sum / NS_PER_MS / SEEKS, v_max / NS_PER_MS,
+           h_first / NS_PER_MS, h_sum / NS_PER_MS / SEEKS, h_max / NS_PER_MS);
+}
+
+
+/* finish
+ *
+ * 		DESCRIPTION: waits for a child
+ *		INPUTS: pid -- the child
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if it exited with 0
+ */
+static int32_t finish(pid_t pid) {
+
+    int status;
+
+    if (pid == -1 || waitpid(pid, &status, 0) == -1) return 0;
+
+    return WIFEXITED(status) && !WEXITSTATUS(status);
+}
+
+
+/* rnd
+ *
+ * 		DESCRIPTION: the next number of a fixed sequence, so every pass
+ *		             makes the same seeks
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 31 random bits
+ */
+static uint32_t rnd(void) {
+
+    seed = seed * 1103515245 + 12345;
+
+    return seed >> 1;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
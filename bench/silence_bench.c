@@ -0,0 +1,176 @@
+/* silence_bench.c - How often content hits the silence check (-z) and
+ * what it saves, on the host. Reads each WAV file period by period,
+ * checks each with meter_silent as the player does, and counts the
+ * periods found silent, the bytes copied into the halves and skipped
+ * because the half already held silence, and with the DMA pausing after
+ * 2 and 8 silent periods, the interrupts avoided and the silence cut
+ * short. Also times the check on silent periods and on audible ones.
+ *   silence_bench album.wav hidden.wav ...
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "meter.h"
+#include "port.h"
+#include "wav.h"
+
+#define POLICIES            3
+#define KB                  1024
+#define PCT                 100
+
+static wav_t wav;
+static int8_t half[PORT_HALF_SIZE];
+
+/* silent periods in a row before the DMA pauses; 0 never pauses */
+static const uint32_t policy[POLICIES] = { 0, 2, 8 };
+
+typedef struct tally {
+    uint32_t periods;
+    uint32_t silent;
+    uint32_t longest;       /* longest run of silent periods */
+    uint64_t copied;
+    uint64_t skipped;
+    uint32_t irqs_avoided;
+    double silent_ns;       /* host time checking silent periods */
+    double audible_ns;
+} tally_t;
+
+
+/* local function definitions */
+static int32_t run(const char* name, uint32_t pause_after, tally_t* t);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs each file under each policy
+ *		INPUTS: argv[1...] -- 16-bit WAV files
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file opened, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    tally_t t;
+    double period_s;
+    int32_t i, p;
+
+    if (argc < 2) {
+        printf("usage: silence_bench album.wav hidden.wav ...\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc; i++) {
+        for (p = 0; p < POLICIES; p++) {
+            if (run(argv[i], policy[p], &t) == -1) {
+                printf("%s: can't open\n", argv[i]);
+                return 1;
+            }
+            period_s = (double)PORT_HALF_SIZE / wav.block_align / wav.sample_rate;
+
+            if (!p) {
+                printf("%s: %u periods, %u silent (%.1f%%), longest run %u; check %.0f host ns "
+                       "a silent period, %.0f an audible one\n", argv[i], t.periods, t.silent,
+                       (double)t.silent / t.periods * PCT, t.longest,
+                       t.silent ? t.silent_ns / t.silent : 0,
+                       t.periods > t.silent ? t.audible_ns / (t.periods - t.silent) : 0);
+            }
+            printf("  -z %u: %llu KB copied, %llu KB skipped (%.1f%%), %u interrupts avoided, "
+                   "%.1f s cut\n", policy[p], (unsigned long long)(t.copied / KB),
+                   (unsigned long long)(t.skipped / KB),
+                   (double)t.skipped / (t.copied + t.skipped) * PCT, t.irqs_avoided,
+                   t.irqs_avoided * period_s);
+        }
+    }
+
+    return 0;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: plays a file through the player's silence handling
+ *		             without the card: the first two periods fill both
+ *		             halves, then each period refills the half the DMA
+ *		             has freed, and while paused the player reads on into
+ *		             the same half with no interrupts until sound returns
+ *		INPUTS: name -- WAV file
+ *		        pause_after -- silent periods before pausing, 0 never
+ *		OUTPUTS: t -- counts
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t run(const char* name, uint32_t pause_after, tally_t* t) {
+
+    struct timespec a, b;
+    int32_t half_silent[2] = { 0, 0 };
+    uint32_t run_len = 0, silent_run = 0, cur = 0, paused = 0;
+    int32_t n, quiet;
+
+    memset(t, 0, sizeof(*t));
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) return -1;
+
+    while ((n = wav_fill(&wav, half, PORT_HALF_SIZE)) > 0) {
+        if (n < PORT_HALF_SIZE) memset(half + n, 0, PORT_HALF_SIZE - n);
+
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        quiet = meter_silent((int16_t*)half, PORT_HALF_WORDS);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+
+        t->periods++;
+        if (quiet) {
+            t->silent++;
+            t->silent_ns += host_ns(&a, &b);
+            if (++run_len > t->longest) t->longest = run_len;
+        } else {
+            t->audible_ns += host_ns(&a, &b);
+            run_len = 0;
+        }
+
+        /* zeros already in the half stay there */
+        if (quiet && half_silent[cur]) t->skipped += PORT_HALF_SIZE;
+        else t->copied += PORT_HALF_SIZE;
+        half_silent[cur] = quiet;
+
+        /* paused, the same half is refilled until sound returns, and the
+         * DMA then moves on from it */
+        if (paused) {
+            t->irqs_avoided++;
+            if (!quiet) {
+                paused = 0;
+                silent_run = 0;
+                cur = !cur;
+            }
+            continue;
+        }
+
+        /* the two fills before the start don't count towards a pause */
+        if (t->periods > 2) {
+            silent_run = quiet ? silent_run + 1 : 0;
+            if (pause_after && silent_run >= pause_after) {
+                paused = 1;
+                continue;
+            }
+        }
+        cur = !cur;
+    }
+    wav_close(&wav);
+
+    return 0;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,144 @@
+/* standby_bench.c - Standby (-w, -y) on the driver and the card model.
+ * Plays a few periods of a WAV file, shuts down with each standby policy
+ * and lets 30 s pass idle, counting the interrupts the card takes while
+ * warm and the port accesses they make, which is the CPU standby costs.
+ * Then checks that a stream resumes on a card still warm and is told to
+ * reset one that has run out.
+ *   standby_bench pcm.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ece391syscall.h"
+#include "port.h"
+#include "wav.h"
+
+#define IDLE_SECS           30
+#define PLAY_HALVES         4
+#define STBY_OFF            (-1)
+#define POLICIES            5
+#define PCT                 100
+
+static wav_t wav;
+static int8_t* buf[2];
+
+/* periods to stay warm; 0 is until the next stream */
+static const int32_t policy[POLICIES] = { 4, 16, 64, 256, 0 };
+
+
+/* local function definitions */
+static int32_t run(const char* name, int32_t periods);
+static void fill(int32_t half);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs each policy
+ *		INPUTS: argv[1] -- 16-bit WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every stream resumed as it should, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t i, ok = 1;
+
+    if (argc < 2) {
+        printf("usage: standby_bench pcm.wav\n");
+        return 1;
+    }
+
+    for (i = 0; i < POLICIES; i++) ok &= run(argv[1], policy[i]);
+
+    return ok ? 0 : 1;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: plays, goes idle warm for IDLE_SECS under a policy
+ *		             and resumes
+ *		INPUTS: name -- WAV file
+ *		        periods -- the policy
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if the resume found the card as it should be
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t run(const char* name, int32_t periods) {
+
+    port_stats_t before, after;
+    uint64_t half_ns, warm_ns, io, idle_ns = IDLE_SECS * NS_PER_SEC;
+    uint32_t irqs, i;
+    int32_t init, h, cur, warm, want;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0 ||
+            (init = ece391_audio_open()) == -1) {
+        printf("%s: can't play\n", name);
+        return 0;
+    }
+    buf[0] = (int8_t*)init;
+    buf[1] = buf[0] + PORT_HALF_SIZE;
+    fill(0);
+    fill(1);
+    if (ece391_audio_start(wav.info_block) == -1) {
+        printf("%s: can't start\n", name);
+        wav_close(&wav);
+        return 0;
+    }
+    cur = ece391_audio_cstatus();
+    for (i = 0; i < PLAY_HALVES; i++) {
+        if ((h = ece391_audio_wait(cur)) == -1) break;
+        fill(h);
+        cur = h;
+    }
+
+    ece391_audio_standby(periods);
+    ece391_audio_shutdown();
+
+    port_stats(&before);
+    irqs = ece391_audio_standby_irqs();
+    port_advance(idle_ns);
+    port_stats(&after);
+    irqs = ece391_audio_standby_irqs() - irqs;
+
+    /* a policy that ran out within the idle time leaves the card cold */
+    half_ns = NS_PER_SEC * PORT_HALF_SIZE / wav.block_align / wav.sample_rate;
+    warm_ns = periods ? periods * half_ns : idle_ns;
+    want = warm_ns >= idle_ns;
+    if (want) warm_ns = idle_ns;
+    warm = ece391_audio_resume(wav.info_block) != -1;
+
+    io = after.io - before.io;
+    printf("%3d periods: warm %4.1f s of %d, %4u interrupts, %.1f a second, %.1f port us "
+           "each, %.3f%% of the CPU while warm; resume %s%s\n", periods, warm_ns / 1e9,
+           IDLE_SECS, irqs, irqs * 1e9 / warm_ns, irqs ? (double)io / irqs : 0,
+           io * (double)PORT_IO_NS / warm_ns * PCT, warm ? "warm" : "cold",
+           warm == want ? "" : ", WRONG");
+
+    /* leave the card reset for the next policy */
+    ece391_audio_standby(STBY_OFF);
+    if (warm) ece391_audio_shutdown();
+    wav_close(&wav);
+
+    return warm == want;
+}
+
+
+/* fill
+ *
+ * 		DESCRIPTION: fills a half of the driver's buffer from the file,
+ *		             with silence past its end
+ *		INPUTS: half -- which half
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: reads the file
+ */
+static void fill(int32_t half) {
+
+    int32_t n = wav_fill(&wav, buf[half], PORT_HALF_SIZE);
+
+    if (n < 0) n = 0;
+    memset(buf[half] + n, 0, PORT_HALF_SIZE - n);
+}
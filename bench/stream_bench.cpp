@@ -0,0 +1,283 @@
+/* stream_bench.cpp - sb16::Sb16Stream (sb16_stream.hpp) on the driver and
+ * the card model. Checks that streams of every length, written in spans
+ * of any size or filled in place, play back exactly and release the
+ * card, then times the wrapper's fill paths against the plain C loop of
+ * waiting for a half and copying into it. Nothing here should reach
+ * operator new, and the bench counts the calls to make sure.
+ *   stream_bench
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sb16_stream.hpp"
+
+extern "C" {
+#include "port.h"
+
+/* the driver's state the checks look at */
+extern volatile int32_t in_use;
+}
+
+#define PERIODS             5000
+#define REPEATS             15
+#define SOURCE_HALVES       8
+#define HEADER_SIZE         44
+#define CHECK_SAMPLES       (48000 * 2 * 3)
+
+static const size_t kHalf = sb16::Sb16Stream::kHalfSamples;
+
+static int16_t src[kHalf * SOURCE_HALVES];
+static int16_t check[CHECK_SAMPLES];
+static long news = 0;
+
+
+/* operator new
+ *
+ * 		DESCRIPTION: counts heap allocations, which there should be none of
+ *		INPUTS: n -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the memory
+ *		SIDE EFFECTS: none
+ */
+void* operator new(size_t n) {
+
+    news++;
+    return malloc(n);
+}
+
+
+void operator delete(void* p) noexcept {
+
+    free(p);
+}
+
+
+void operator delete(void* p, size_t) noexcept {
+
+    free(p);
+}
+
+
+/* header
+ *
+ * 		DESCRIPTION: makes the WAV header of a 48 kHz 16-bit stereo stream
+ *		INPUTS: none
+ *		OUTPUTS: h -- the header
+ *		RETURN VALUE: none
+ */
+static void header(uint8_t* h) {
+
+    static const uint8_t wav[HEADER_SIZE] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0,
+        0x80, 0xBB, 0, 0, 0x00, 0xEE, 0x02, 0, 4, 0, 16, 0,
+        'd', 'a', 't', 'a', 0, 0, 0, 0
+    };
+
+    for (size_t i = 0; i < HEADER_SIZE; i++) h[i] = wav[i];
+}
+
+
+/* exact
+ *
+ * 		DESCRIPTION: streams len samples of the check pattern, in spans of
+ *		             chunk samples or in place for a chunk of 0, drains,
+ *		             moves the stream and checks what the DMA played
+ *		INPUTS: len -- samples
+ *		        chunk -- samples a write, or 0
+ *		OUTPUTS: none
+ *		RETURN VALUE: true if it played exactly and the card was released
+ */
+static bool exact(size_t len, size_t chunk) {
+
+    uint8_t h[HEADER_SIZE];
+    uint64_t n;
+    int16_t* rec;
+
+    header(h);
+    port_record(1);
+    {
+        sb16::Sb16Stream s(h);
+        if (!s.ok()) return false;
+
+        if (chunk) {
+            for (size_t off = 0; off < len; off += chunk) {
+                size_t k = len - off < chunk ? len - off : chunk;
+                if (s.write(sb16::Span<const int16_t>(check + off, k)) != k) return false;
+            }
+        } else {
+            for (size_t off = 0; off < len;) {
+                sb16::Span<int16_t> d = s.free_half();
+                size_t k = len - off < d.size() ? len - off : d.size();
+                for (size_t i = 0; i < d.size(); i++) d[i] = i < k ? check[off + i] : 0;
+                off += k;
+            }
+        }
+        if (!s.drain()) return false;
+
+        /* the card goes with the stream */
+        sb16::Sb16Stream moved(static_cast<sb16::Sb16Stream&&>(s));
+        if (s.ok() || !moved.ok()) return false;
+    }
+    port_record(0);
+
+    rec = port_recorded(&n);
+    if (n < len || in_use) return false;
+    for (uint64_t i = 0; i < n; i++) {
+        if (rec[i] != (i < len ? check[i] : 0)) return false;
+    }
+
+    return true;
+}
+
+
+/* raw
+ *
+ * 		DESCRIPTION: the C loop the wrapper replaces: wait for a half and
+ *		             copy a period into it
+ *		INPUTS: base -- the driver's buffer
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+__attribute__((noinline)) static void raw(int16_t* base) {
+
+    int32_t filled = 1, h;
+
+    for (long p = 0; p < PERIODS; p++) {
+        h = ece391_audio_wait(filled);
+        const int16_t* s = src + (p % SOURCE_HALVES) * kHalf / SOURCE_HALVES;
+        for (size_t i = 0; i < kHalf; i++) base[h * kHalf + i] = s[i];
+        filled = h;
+    }
+}
+
+
+/* spans
+ *
+ * 		DESCRIPTION: the same periods through write(), in spans of chunk
+ *		             samples
+ *		INPUTS: h -- WAV header
+ *		        chunk -- samples a write
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+__attribute__((noinline)) static void spans(const uint8_t* h, size_t chunk) {
+
+    sb16::Sb16Stream s(h);
+
+    for (long p = 0; p < PERIODS; p++) {
+        const int16_t* from = src + (p % SOURCE_HALVES) * kHalf / SOURCE_HALVES;
+        for (size_t o = 0; o < kHalf; o += chunk)
+            s.write(sb16::Span<const int16_t>(from + o, chunk));
+    }
+}
+
+
+/* in_place
+ *
+ * 		DESCRIPTION: the same periods copied into free_half()
+ *		INPUTS: h -- WAV header
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ */
+__attribute__((noinline)) static void in_place(const uint8_t* h) {
+
+    sb16::Sb16Stream s(h);
+
+    for (long p = 0; p < PERIODS; p++) {
+        sb16::Span<int16_t> d = s.free_half();
+        const int16_t* from = src + (p % SOURCE_HALVES) * kHalf / SOURCE_HALVES;
+        int16_t* to = d.data();
+        for (size_t i = 0; i < kHalf; i++) to[i] = from[i];
+    }
+}
+
+
+/* now
+ *
+ * 		DESCRIPTION: host time
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double now() {
+
+    timespec t;
+
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the checks, then the timings, keeping the best
+ *		             of each over the repeats
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every check passed, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main() {
+
+    static const size_t lens[] = { 100, kHalf, kHalf * 2, kHalf * 2 + 1, kHalf * 7 - 3, CHECK_SAMPLES };
+    static const size_t chunks[] = { 0, 32, 1000, kHalf, 65536 };
+    static const char* names[] = { "C loop", "write, one span", "write, 1024-sample spans",
+                                   "write, 64-sample spans", "free_half" };
+    double best[5] = { 1e18, 1e18, 1e18, 1e18, 1e18 };
+    uint8_t h[HEADER_SIZE];
+    int16_t* base;
+    int bad = 0;
+
+    for (size_t i = 0; i < CHECK_SAMPLES; i++) check[i] = (int16_t)(i * 13 + 5);
+    for (size_t i = 0; i < kHalf * SOURCE_HALVES; i++) src[i] = (int16_t)i;
+
+    for (size_t len : lens) {
+        for (size_t chunk : chunks) {
+            if (!exact(len, chunk)) {
+                printf("WRONG: %zu samples in %s %zu\n", len, chunk ? "spans of" : "place", chunk);
+                bad++;
+            }
+        }
+    }
+    printf("%zu lengths from 100 samples to 3 s, in spans of 32 to 65536 samples and in place: %s\n",
+           sizeof(lens) / sizeof(lens[0]), bad ? "failures" : "all exact");
+
+    header(h);
+    for (int rep = 0; rep < REPEATS; rep++) {
+        double t, v[5];
+
+        /* the C loop takes the card as user_level_program.c does */
+        base = reinterpret_cast<int16_t*>(static_cast<uintptr_t>(static_cast<uint32_t>(ece391_audio_open())));
+        for (size_t i = 0; i < kHalf * 2; i++) base[i] = 0;
+        ece391_audio_start(h);
+        t = now();
+        raw(base);
+        v[0] = now() - t;
+        ece391_audio_shutdown();
+
+        t = now();
+        spans(h, kHalf);
+        v[1] = now() - t;
+        t = now();
+        spans(h, 1024);
+        v[2] = now() - t;
+        t = now();
+        spans(h, 64);
+        v[3] = now() - t;
+        t = now();
+        in_place(h);
+        v[4] = now() - t;
+
+        for (int k = 0; k < 5; k++) if (v[k] < best[k]) best[k] = v[k];
+    }
+
+    printf("host ns a period of %zu samples, best of %d runs of %d:\n", kHalf, REPEATS, PERIODS);
+    for (int k = 0; k < 5; k++) printf("  %-26s %6.0f\n", names[k], best[k] / PERIODS);
+    printf("operator new calls: %ld\n", news);
+
+    return bad ? 1 : 0;
+}
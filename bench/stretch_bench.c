@@ -0,0 +1,127 @@
+/* stretch_bench.c - The time-stretcher (stretch.c) on the host. Plays a
+ * WAV file through to its end at speeds from half to double, best of
+ * three, and times a period of output against the audio it stands for,
+ * beside the same file filled straight.
+ *   stretch_bench pcm.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "port.h"
+#include "stretch.h"
+#include "wav.h"
+
+#define REPEATS             3
+#define PCT                 100
+#define FIRST_PCT           50
+#define LAST_PCT            200
+#define STEP_PCT            25
+#define LABEL_LEN           16
+
+static wav_t wav;
+static stretch_t ts;
+static int8_t half[PORT_HALF_SIZE];
+
+
+/* local function definitions */
+static int32_t play(const char* name, uint32_t pct, double* ns, uint32_t* periods);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each speed
+ *		INPUTS: argv[1] -- 16-bit WAV file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if the file played at every speed, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    double ns, best, period_ns;
+    char label[LABEL_LEN];
+    uint32_t pct, periods;
+    int32_t r;
+
+    if (argc < 2) {
+        printf("usage: stretch_bench pcm.wav\n");
+        return 1;
+    }
+
+    /* 0 is the straight fill */
+    for (pct = 0; pct <= LAST_PCT; pct = pct ? pct + STEP_PCT : FIRST_PCT) {
+        for (best = 0, r = 0; r < REPEATS; r++) {
+            if (play(argv[1], pct, &ns, &periods) == -1) {
+                printf("%s: can't play at %u%%\n", argv[1], pct);
+                return 1;
+            }
+            if (!r || ns < best) best = ns;
+        }
+
+        period_ns = (double)NS_PER_SEC * PORT_HALF_SIZE / wav.block_align / wav.sample_rate;
+        if (pct) snprintf(label, sizeof(label), "%u%%", pct);
+        else snprintf(label, sizeof(label), "straight");
+        printf("%-8s %u periods, %.0f host us a period, %.0fx real time\n",
+               label, periods, best / NS_PER_US, period_ns / best);
+    }
+
+    return 0;
+}
+
+
+/* play
+ *
+ * 		DESCRIPTION: fills periods from a file to its end at a speed
+ *		INPUTS: name -- WAV file
+ *		        pct -- speed in percent, 0 to fill straight
+ *		OUTPUTS: ns -- host ns a full period
+ *		         periods -- full periods filled
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t play(const char* name, uint32_t pct, double* ns, uint32_t* periods) {
+
+    struct timespec a, b;
+    double sum = 0;
+    int32_t n;
+
+    if (wav_open(&wav, (const uint8_t*)name, 0) != 0) return -1;
+    if (pct && stretch_init(&ts, (uint64_t)pct * TS_UNITY / PCT, wav.sample_rate,
+                            wav.nchannels) == -1) {
+        wav_close(&wav);
+        return -1;
+    }
+
+    *periods = 0;
+    do {
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        n = pct ? stretch_fill(&ts, &wav, half, PORT_HALF_SIZE) :
+                  wav_fill(&wav, half, PORT_HALF_SIZE);
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        if (n == PORT_HALF_SIZE) {
+            sum += host_ns(&a, &b);
+            (*periods)++;
+        }
+    } while (n == PORT_HALF_SIZE);
+    wav_close(&wav);
+
+    if (!*periods) return -1;
+    *ns = sum / *periods;
+
+    return 0;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
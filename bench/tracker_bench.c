@@ -0,0 +1,126 @@
+/* tracker_bench.c - The module player (tracker.c) on the host. Renders
+ * each module given for 20 s of audio, best of three, and times it
+ * against how many channels it has sounding, then fits a line through
+ * the results to find what a channel costs and how many fit in real time
+ * at 44.1 kHz on one core of this machine.
+ *   tracker_bench mod4.mod mod8.mod...
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "tracker.h"
+
+#define RENDER_SECS         20
+#define READ_FRAMES         2048
+#define MAX_FILES           16
+#define REPEATS             3
+#define PCT                 100
+
+static tracker_t tr;
+static int16_t buf[READ_FRAMES * 2];
+
+
+/* local function definitions */
+static double render(const char* name, uint32_t* on);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each file, then fits the cost per channel
+ *		INPUTS: argv[1...] -- modules
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file opened, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    double x[MAX_FILES], y[MAX_FILES];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, slope, base, ns, best;
+    uint32_t on;
+    int32_t i, r, n = 0;
+
+    if (argc < 2) {
+        printf("usage: tracker_bench mod4.mod mod8.mod...\n");
+        return 1;
+    }
+
+    for (i = 1; i < argc && n < MAX_FILES; i++) {
+        for (best = 0, r = 0; r < REPEATS; r++) {
+            if ((ns = render(argv[i], &on)) < 0) {
+                printf("%s: can't open\n", argv[i]);
+                return 1;
+            }
+            if (!r || ns < best) best = ns;
+        }
+
+        printf("%s: %u channels sounding, %.1f host ns a frame, %.2f%% of a core, "
+               "%.0fx real time\n", argv[i], on, best, best * TRK_RATE / 1e9 * PCT,
+               1e9 / TRK_RATE / best);
+        x[n] = on;
+        y[n++] = best;
+    }
+
+    if (n < 2) return 0;
+
+    for (i = 0; i < n; i++) {
+        sx += x[i];
+        sy += y[i];
+        sxx += x[i] * x[i];
+        sxy += x[i] * y[i];
+    }
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    base = (sy - slope * sx) / n;
+    printf("%.2f host ns a channel a frame on %.1f ns a frame of mixing and sequencing: "
+           "%.0f channels in real time on one core, against a cap of %d\n",
+           slope, base, (1e9 / TRK_RATE - base) / slope, TRK_MAX_CHANNELS);
+
+    return 0;
+}
+
+
+/* render
+ *
+ * 		DESCRIPTION: renders a module for RENDER_SECS, looping the song
+ *		INPUTS: name -- module
+ *		OUTPUTS: on -- channels sounding once the first row has played
+ *		RETURN VALUE: host ns a frame, or -1 if it won't open
+ *		SIDE EFFECTS: none
+ */
+static double render(const char* name, uint32_t* on) {
+
+    struct timespec a, b;
+    uint64_t frames;
+    uint32_t c;
+    int32_t got;
+
+    if (tracker_open(&tr, (const uint8_t*)name, 1) != 0) return -1;
+
+    /* every channel keys a note on the first row */
+    tracker_read(&tr, (int8_t*)buf, sizeof(buf));
+    for (*on = 0, c = 0; c < tr.nchannels; c++) *on += tr.v_on[c] != 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (frames = 0; frames < (uint64_t)RENDER_SECS * TRK_RATE; frames += got / TRK_FRAME_SIZE) {
+        if ((got = tracker_read(&tr, (int8_t*)buf, sizeof(buf))) <= 0) break;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    tracker_close(&tr);
+
+    return host_ns(&a, &b) / frames;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,456 @@
+/* uart_bench.c - The MPU-401 driver and the MIDI scheduler (mpu.c) on the
+ * card model. Sends a MIDI file out the UART alongside a PCM stream, the
+ * way the player does with -u, and checks every event reached the wire
+ * intact and in order. Then reports the throughput, what running status
+ * saved, and how late each event started against its stamp and against
+ * a wire that sends each message the moment it's due or free; a keyboard
+ * can be played into the UART at the same time. -cpu times the scheduler
+ * and the driver's queueing on the host with the ports made free.
+ *   uart_bench file.mid [fill_us] [rx_bytes_per_s]
+ *   uart_bench -cpu file.mid
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ece391syscall.h"
+#include "fixmath.h"
+#include "midi.h"
+#include "mpu.h"
+#include "port.h"
+
+#define RATE                48000
+#define HEADER_SIZE         44
+#define US_PER_SEC          1000000
+#define PCT                 100
+#define STATUS_BIT          0x80
+
+/* the player's scheduling: the sequencer steps a millisecond at a time
+ * and keeps the queue 50 ms ahead of the card */
+#define UART_STEP           1000
+#define UART_AHEAD_MS       50
+#define UART_ROOM           64
+#define Q32_SHIFT           32
+
+/* a fill of a period, while the events wait */
+#define DEFAULT_FILL_US     2000
+#define DRAIN_NS            (2 * NS_PER_SEC)
+#define DRAIN_STEP          (100 * NS_PER_US)
+#define MAX_EVENTS          (1 << 17)
+#define RX_CHORD            3
+#define RX_MAX              (1 << 18)
+#define CPU_REPEATS         20
+
+/* the driver's count of bytes its receive ring had no room for */
+extern volatile uint32_t rx_lost;
+
+/* an event the file should put on the wire, and when, from the DMA start */
+typedef struct expect {
+    uint64_t t;
+    uint32_t len;
+    uint8_t msg[MPU_MSG_MAX];
+} expect_t;
+
+static midi_t midi;
+static mpu_t mpu;
+static mpu_t ref;
+static expect_t ex[MAX_EVENTS];
+static uint32_t nex = 0;
+static uint64_t at[MAX_EVENTS];
+static uint64_t late[MAX_EVENTS];
+static uint32_t uart_k;
+static int32_t uart_ahead;
+static int32_t uart_done;
+
+
+/* local function definitions */
+static int32_t uart_frame(uint32_t us);
+static void uart_work(void);
+static void header(uint8_t* h);
+static void expected(void);
+static int32_t play(uint64_t fill_ns, uint32_t rx_rate);
+static uint32_t match(uint64_t start, uint64_t w0, uint64_t* bytes);
+static void report(uint32_t matched, uint64_t bytes);
+static void cpu(void);
+static int cmp64(const void* a, const void* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: runs the bench
+ *		INPUTS: argv -- as the usage line
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every event reached the wire intact, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    int32_t fast = 0;
+
+    if (argc > 1 && !strcmp(argv[1], "-cpu")) {
+        fast = 1;
+        argv++;
+        argc--;
+    }
+    if (argc < 2) {
+        printf("usage: uart_bench [-cpu] file.mid [fill_us] [rx_bytes_per_s]\n");
+        return 1;
+    }
+    if (midi_open(&midi, (const uint8_t*)argv[1]) != 0) {
+        printf("%s: not a MIDI file\n", argv[1]);
+        return 1;
+    }
+
+    uart_k = (uint32_t)fix_qdiv((int64_t)RATE << 16, (int64_t)US_PER_SEC << 16, Q32_SHIFT);
+    uart_ahead = RATE * UART_AHEAD_MS / 1000;
+
+    if (fast) {
+        cpu();
+        return 0;
+    }
+
+    expected();
+    return play((argc > 2 ? (uint64_t)atol(argv[2]) : DEFAULT_FILL_US) * NS_PER_US,
+                argc > 3 ? (uint32_t)atol(argv[3]) : 0);
+}
+
+
+/* uart_frame
+ *
+ * 		DESCRIPTION: converts a time in the MIDI file to the frame of the
+ *		             PCM stream it plays at
+ *		INPUTS: us -- microseconds from the start of the song
+ *		OUTPUTS: none
+ *		RETURN VALUE: frame
+ */
+static int32_t uart_frame(uint32_t us) {
+
+    return (int32_t)(((uint64_t)us * uart_k) >> Q32_SHIFT);
+}
+
+
+/* uart_work
+ *
+ * 		DESCRIPTION: the player's uart_work: keeps the queue stocked ahead
+ *		             of the card and sends what the card has reached
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sends MIDI bytes
+ */
+static void uart_work(void) {
+
+    midi_event_t ev;
+    int32_t now, ret;
+
+    if (ece391_audio_clock(&now) == -1) return;
+
+    while (!uart_done && mpu_room(&mpu) >= UART_ROOM &&
+            uart_frame(midi.clock) < now + uart_ahead) {
+        midi_advance(&midi, UART_STEP);
+        while ((ret = midi_next(&midi, &ev)) > 0)
+            mpu_post(&mpu, uart_frame(midi_position(&midi)), &ev);
+        if (ret == -1) uart_done = 1;
+    }
+
+    mpu_dispatch(&mpu, now);
+}
+
+
+/* header
+ *
+ * 		DESCRIPTION: makes the WAV header of a 48 kHz 16-bit stereo stream
+ *		INPUTS: none
+ *		OUTPUTS: h -- the header
+ *		RETURN VALUE: none
+ */
+static void header(uint8_t* h) {
+
+    static const uint8_t wav[HEADER_SIZE] = {
+        'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E',
+        'f', 'm', 't', ' ', 16, 0, 0, 0, 1, 0, 2, 0,
+        0x80, 0xBB, 0, 0, 0x00, 0xEE, 0x02, 0, 4, 0, 16, 0,
+        'd', 'a', 't', 'a', 0, 0, 0, 0
+    };
+    uint32_t i;
+
+    for (i = 0; i < HEADER_SIZE; i++) h[i] = wav[i];
+}
+
+
+/* expected
+ *
+ * 		DESCRIPTION: lists the messages the file should put on the wire
+ *		             and their stamps, encoded by a queue of its own
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: rewinds the file
+ */
+static void expected(void) {
+
+    midi_event_t ev;
+    mpu_event_t* e;
+    int32_t ret;
+
+    mpu_init(&ref);
+    do {
+        midi_advance(&midi, UART_STEP);
+        while ((ret = midi_next(&midi, &ev)) > 0 && nex < MAX_EVENTS) {
+            if (mpu_post(&ref, uart_frame(midi_position(&midi)), &ev) == -1) continue;
+            e = &ref.event[ref.tail];
+            ex[nex].t = (uint64_t)e->frame * NS_PER_SEC / RATE;
+            ex[nex].len = e->len;
+            memcpy(ex[nex].msg, e->msg, e->len);
+            ref.tail = ref.head;
+            nex++;
+        }
+    } while (ret != -1);
+
+    midi_rewind(&midi);
+}
+
+
+/* play
+ *
+ * 		DESCRIPTION: plays the file out the UART over a silent PCM stream,
+ *		             running the player's loop: poll the status, fill a
+ *		             period when it changes, and see to the events either
+ *		             way; a keyboard's notes arrive meanwhile if asked for
+ *		INPUTS: fill_ns -- time a fill takes
+ *		        rx_rate -- bytes a second coming in, 0 for none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every event reached the wire intact, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+static int32_t play(uint64_t fill_ns, uint32_t rx_rate) {
+
+    static uint8_t keys[RX_MAX];
+    uint8_t h[HEADER_SIZE], rb[MPU_OUT_MAX];
+    uint64_t w0, start, stop, rx_n = 0, rx_got = 0, rx_bad = 0, sent, overrun, bytes;
+    int8_t* base;
+    int32_t status, prev = 1, frames, n, i;
+    uint32_t matched;
+
+    header(h);
+    if ((base = (int8_t*)ece391_audio_open()) == (int8_t*)-1) return 1;
+    for (i = 0; i < PORT_HALF_SIZE * 2; i++) base[i] = 0;
+    if (ece391_audio_midi_open() == -1) return 1;
+    mpu_init(&mpu);
+    uart_done = 0;
+
+    if (rx_rate) {
+        rx_n = rx_rate * (ex[nex - 1].t / NS_PER_SEC + 1);
+        if (rx_n > sizeof(keys)) rx_n = sizeof(keys);
+        for (i = 0; i < (int32_t)rx_n; i++)
+            keys[i] = i % RX_CHORD ? (uint8_t)(i * 7 % STATUS_BIT) : MIDI_NOTE_ON;
+        port_uart_feed(keys, rx_n, NS_PER_SEC / rx_rate);
+    }
+
+    w0 = port_uart_wire(NULL, NULL);
+    ece391_audio_start(h);
+    start = port_dma_start();
+
+    while (!uart_done || mpu.tail != mpu.head || mpu.out_pos < mpu.out_len) {
+        if ((status = ece391_audio_cstatus()) != prev) {
+            port_advance(fill_ns);
+            prev = status;
+        }
+        uart_work();
+
+        if (rx_rate) {
+            n = ece391_audio_midi_read(rb, sizeof(rb));
+            for (i = 0; i < n; i++) {
+                if (rb[i] != keys[rx_got]) rx_bad++;
+                rx_got++;
+            }
+        }
+    }
+
+    /* the driver sends from its ring as the clock is read */
+    stop = port_now + DRAIN_NS;
+    while (port_now < stop) {
+        port_advance(DRAIN_STEP);
+        ece391_audio_clock(&frames);
+    }
+
+    matched = match(start, w0, &bytes);
+    report(matched, bytes);
+    if (rx_rate) {
+        port_uart_rx(&sent, &overrun);
+        printf("  rx at %u bytes/s: sent %llu, got %llu, wrong %llu, FIFO overruns %llu, "
+               "ring lost %u\n", rx_rate, (unsigned long long)sent, (unsigned long long)rx_got,
+               (unsigned long long)rx_bad, (unsigned long long)overrun, rx_lost);
+    }
+
+    ece391_audio_midi_close();
+    ece391_audio_shutdown();
+
+    return matched == nex && (!rx_rate || (rx_got == sent && !rx_bad)) ? 0 : 1;
+}
+
+
+/* match
+ *
+ * 		DESCRIPTION: reads the wire back, undoing running status, and
+ *		             matches it to the expected messages in order
+ *		INPUTS: start -- when the DMA started
+ *		        w0 -- bytes on the wire before the song
+ *		OUTPUTS: at -- when each message's first byte started
+ *		         bytes -- bytes the song put on the wire
+ *		RETURN VALUE: messages matched before the first mismatch
+ */
+static uint32_t match(uint64_t start, uint64_t w0, uint64_t* bytes) {
+
+    const uint8_t* wire;
+    const uint64_t* times;
+    uint64_t n, w = w0;
+    uint32_t i, k;
+    uint8_t running = 0;
+
+    n = port_uart_wire(&wire, &times);
+    *bytes = n - w0;
+
+    for (i = 0; i < nex && w < n; i++) {
+        at[i] = times[w] - start;
+
+        /* a data byte first carries on the last status */
+        k = 0;
+        if (wire[w] < STATUS_BIT) {
+            if (ex[i].msg[0] != running) return i;
+            k = 1;
+        } else {
+            running = wire[w] < MIDI_SYSEX ? wire[w] : 0;
+        }
+
+        for (; k < ex[i].len; k++, w++) {
+            if (w >= n || wire[w] != ex[i].msg[k]) return i;
+        }
+    }
+
+    return i;
+}
+
+
+/* report
+ *
+ * 		DESCRIPTION: prints what the wire carried and how late; the ideal
+ *		             wire sends each message, with the same running
+ *		             status, at its stamp or as soon as the last is out
+ *		INPUTS: matched -- messages matched
+ *		        bytes -- bytes on the wire
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the results
+ */
+static void report(uint32_t matched, uint64_t bytes) {
+
+    uint64_t full = 0, free_at = 0, ideal, lmax = 0;
+    int64_t d, dmin = 0, dmax = 0;
+    double song, lsum = 0, dsum = 0;
+    uint32_t i, len;
+    uint8_t running = 0;
+
+    for (i = 0; i < matched; i++) {
+        len = ex[i].len;
+        full += len;
+        if (ex[i].msg[0] < MIDI_SYSEX && ex[i].msg[0] == running) len--;
+        running = ex[i].msg[0] < MIDI_SYSEX ? ex[i].msg[0] : 0;
+
+        ideal = ex[i].t > free_at ? ex[i].t : free_at;
+        free_at = ideal + len * UART_BYTE_NS;
+
+        late[i] = at[i] > ex[i].t ? at[i] - ex[i].t : 0;
+        lsum += late[i];
+        if (late[i] > lmax) lmax = late[i];
+
+        d = (int64_t)at[i] - (int64_t)ideal;
+        dsum += d;
+        if (d < dmin) dmin = d;
+        if (d > dmax) dmax = d;
+    }
+    qsort(late, matched, sizeof(late[0]), cmp64);
+
+    song = (double)ex[nex - 1].t / NS_PER_SEC;
+    printf("%u events over %.1f s, %.0f events/s; %u on the wire intact and in order, "
+           "%u dropped by the queue\n", nex, song, nex / song, matched, mpu.dropped);
+    if (!matched) return;
+    printf("  %llu bytes on the wire, %llu without running status: %.1f%% saved, "
+           "%.2f bytes an event, so the wire tops out at %.0f events/s\n",
+           (unsigned long long)bytes, (unsigned long long)full,
+           PCT * (double)(full - bytes) / full, (double)bytes / matched,
+           (double)NS_PER_SEC / UART_BYTE_NS * matched / bytes);
+    printf("  first byte after the stamp: mean %.0f us, median %.0f us, 99th %.0f us, "
+           "max %.0f us\n", lsum / matched / NS_PER_US, (double)late[matched / 2] / NS_PER_US,
+           (double)late[(uint64_t)matched * 99 / PCT] / NS_PER_US, (double)lmax / NS_PER_US);
+    printf("  after the ideal wire: mean %.0f us, min %.0f us, max %.0f us\n",
+           dsum / matched / NS_PER_US, (double)dmin / NS_PER_US, (double)dmax / NS_PER_US);
+}
+
+
+/* cpu
+ *
+ * 		DESCRIPTION: times posting every event of the file and dispatching
+ *		             it into the driver's ring, with the clock stepping a
+ *		             frame a dispatch and the UART taking bytes at once
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: prints the result
+ */
+static void cpu(void) {
+
+    struct timespec a, b;
+    midi_event_t ev;
+    uint64_t events = 0;
+    int32_t now = 0, ret, rep;
+    double ns;
+
+    port_fast = 1;
+    if (ece391_audio_midi_open() == -1) return;
+    mpu_init(&mpu);
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (rep = 0; rep < CPU_REPEATS; rep++) {
+        midi_rewind(&midi);
+        uart_done = 0;
+        while (!uart_done) {
+            while (!uart_done && mpu_room(&mpu) >= UART_ROOM) {
+                midi_advance(&midi, UART_STEP);
+                while ((ret = midi_next(&midi, &ev)) > 0) {
+                    mpu_post(&mpu, now, &ev);
+                    events++;
+                }
+                if (ret == -1) uart_done = 1;
+            }
+            mpu_dispatch(&mpu, now++);
+        }
+        while (mpu.tail != mpu.head) mpu_dispatch(&mpu, now);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+
+    ece391_audio_midi_close();
+    port_fast = 0;
+
+    ns = (b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec);
+    printf("cpu: %llu events, %.1f host ns an event to post, dispatch and queue in the driver\n",
+           (unsigned long long)events, ns / events);
+}
+
+
+/* cmp64
+ *
+ * 		DESCRIPTION: orders two 64-bit counts for qsort
+ *		INPUTS: a, b -- counts
+ *		OUTPUTS: none
+ *		RETURN VALUE: negative, zero or positive
+ */
+static int cmp64(const void* a, const void* b) {
+
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+
+    return x < y ? -1 : x > y;
+}
@@ -0,0 +1,103 @@
+/* wt_bench.c - The wavetable synthesizer (wavetable.c) on the host.
+ * Renders each MIDI file given for 20 s of audio and times it against
+ * how many voices it holds, then fits a line through the results to
+ * find what a voice costs and how many fit in real time at 44.1 kHz on
+ * one core of this machine.
+ *   wt_bench bank.sf2 file.mid...
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "wavetable.h"
+
+#define RENDER_SECS         20
+#define READ_FRAMES         2048
+#define MAX_FILES           16
+#define PCT                 100
+
+static wavetable_t wt;
+static int16_t buf[READ_FRAMES * 2];
+
+
+/* local function definitions */
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times each file, then fits the cost per voice
+ *		INPUTS: argv[1] -- sound bank
+ *		        argv[2...] -- MIDI files
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if every file opened, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    struct timespec a, b;
+    double x[MAX_FILES], y[MAX_FILES];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0, slope, base, ns;
+    uint64_t frames;
+    uint32_t v, on;
+    int32_t i, got, n = 0;
+
+    if (argc < 3) {
+        printf("usage: wt_bench bank.sf2 file.mid...\n");
+        return 1;
+    }
+
+    for (i = 2; i < argc && n < MAX_FILES; i++) {
+        if (wt_open(&wt, (const uint8_t*)argv[i], (const uint8_t*)argv[1], 1) != 0) {
+            printf("%s: can't open with %s\n", argv[i], argv[1]);
+            return 1;
+        }
+
+        /* the notes all start in the first block */
+        wt_read(&wt, (int8_t*)buf, sizeof(buf));
+        for (on = 0, v = 0; v < WT_MAX_VOICES; v++) on += wt.v_on[v] != 0;
+
+        clock_gettime(CLOCK_MONOTONIC, &a);
+        for (frames = 0; frames < (uint64_t)RENDER_SECS * WT_RATE; frames += got / WT_FRAME_SIZE) {
+            if ((got = wt_read(&wt, (int8_t*)buf, sizeof(buf))) <= 0) break;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &b);
+        wt_close(&wt);
+
+        ns = host_ns(&a, &b) / frames;
+        printf("%s: %u voices, %.1f host ns a frame, %.2f%% of a core\n", argv[i], on, ns,
+               ns * WT_RATE / 1e9 * PCT);
+        x[n] = on;
+        y[n++] = ns;
+    }
+
+    if (n < 2) return 0;
+
+    for (i = 0; i < n; i++) {
+        sx += x[i];
+        sy += y[i];
+        sxx += x[i] * x[i];
+        sxy += x[i] * y[i];
+    }
+    slope = (n * sxy - sx * sy) / (n * sxx - sx * sx);
+    base = (sy - slope * sx) / n;
+    printf("%.2f host ns a voice a frame on %.1f ns a frame of mixing and sequencing: "
+           "%.0f voices in real time on one core, against a cap of %d\n",
+           slope, base, (1e9 / WT_RATE - base) / slope, WT_MAX_VOICES);
+
+    return 0;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,162 @@
+/* xfade_bench.c - Crossfades (xfade.c) in the player's fill path, on the
+ * host. Times a period of a track filled three ways: read straight into
+ * the half, read through the mix bus and packed back, and read through
+ * the bus with the next track read alongside and faded in. The last two
+ * differ by what a crossfade adds to a period.
+ *   xfade_bench a.wav b.wav
+ * Written by Soumithri Bala. */
+
+
+#include <stdio.h>
+#include <time.h>
+
+#include "fixmath.h"
+#include "port.h"
+#include "wav.h"
+#include "xfade.h"
+
+#define REPEATS             5
+#define GAIN_UNITY          (1 << 16)
+#define PCT                 100
+
+#define FILL_STRAIGHT       0
+#define FILL_BUS            1
+#define FILL_FADE           2
+#define FILL_MODES          3
+
+static wav_t wav;
+static wav_t next;
+static xfade_t xf;
+static int8_t half[PORT_HALF_SIZE];
+static int8_t stage[PORT_HALF_SIZE];
+static int8_t xbuf[PORT_HALF_SIZE];
+static int32_t bus[PORT_HALF_WORDS];
+
+
+/* local function definitions */
+static int32_t fill(int32_t mode);
+static double run(int32_t mode, const char* a, const char* b, uint32_t* periods);
+static double host_ns(const struct timespec* a, const struct timespec* b);
+
+
+/* main
+ *
+ * 		DESCRIPTION: times the three fills, keeping the best of the repeats
+ *		INPUTS: argv[1] -- outgoing track
+ *		        argv[2] -- incoming track, of the same format
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if the tracks opened, else 1
+ *		SIDE EFFECTS: prints the results
+ */
+int main(int argc, char** argv) {
+
+    static const char* names[FILL_MODES] = { "straight", "through the bus", "crossfading" };
+    double best[FILL_MODES], ns, period_ns;
+    uint32_t periods = 0;
+    int32_t mode, rep;
+
+    if (argc < 3) {
+        printf("usage: xfade_bench a.wav b.wav\n");
+        return 1;
+    }
+
+    for (mode = 0; mode < FILL_MODES; mode++) {
+        for (rep = 0; rep < REPEATS; rep++) {
+            if ((ns = run(mode, argv[1], argv[2], &periods)) < 0) return 1;
+            if (!rep || ns < best[mode]) best[mode] = ns;
+        }
+    }
+
+    period_ns = (double)PORT_HALF_WORDS / wav.nchannels * 1e9 / wav.sample_rate;
+    printf("host ns a period of %u frames at %u Hz, best of %d runs of %u periods:\n",
+           PORT_HALF_WORDS / wav.nchannels, wav.sample_rate, REPEATS, periods);
+    for (mode = 0; mode < FILL_MODES; mode++)
+        printf("  %-16s %8.0f\n", names[mode], best[mode]);
+    printf("a crossfade adds %.0f ns a period, %.4f%% of the period's %.1f ms\n",
+           best[FILL_FADE] - best[FILL_BUS],
+           (best[FILL_FADE] - best[FILL_BUS]) / period_ns * PCT, period_ns / 1e6);
+
+    return 0;
+}
+
+
+/* fill
+ *
+ * 		DESCRIPTION: fills a period as fill_half does: straight, or widened
+ *		             onto the bus with the track's gain, the next track
+ *		             faded in if crossfading, and packed back to 16 bits
+ *		INPUTS: mode -- FILL_STRAIGHT, FILL_BUS or FILL_FADE
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes read from the outgoing track
+ *		SIDE EFFECTS: reads the tracks
+ */
+static int32_t fill(int32_t mode) {
+
+    int32_t n, m, i;
+
+    if (mode == FILL_STRAIGHT) return wav_fill(&wav, half, PORT_HALF_SIZE);
+
+    n = wav_fill(&wav, stage, PORT_HALF_SIZE);
+    for (i = 0; i < n / 2; i++)
+        bus[i] = (int32_t)(((int64_t)((int16_t*)stage)[i] * GAIN_UNITY) >> 16);
+
+    if (mode == FILL_FADE && n) {
+        m = wav_fill(&next, xbuf, n);
+        while (m < n) xbuf[m++] = 0;
+        xfade_mix(&xf, bus, (int16_t*)xbuf, n / wav.block_align, wav.nchannels, GAIN_UNITY);
+    }
+
+    for (i = 0; i < n / 2; i++) ((int16_t*)half)[i] = fix_sat16(bus[i]);
+
+    return n;
+}
+
+
+/* run
+ *
+ * 		DESCRIPTION: fills every whole period of the outgoing track, with
+ *		             a crossfade lasting the whole track if fading
+ *		INPUTS: mode -- FILL_STRAIGHT, FILL_BUS or FILL_FADE
+ *		        a, b -- outgoing and incoming tracks
+ *		OUTPUTS: periods -- periods timed
+ *		RETURN VALUE: host ns a period, or -1 if a track didn't open
+ */
+static double run(int32_t mode, const char* a, const char* b, uint32_t* periods) {
+
+    struct timespec t0, t1;
+    uint32_t p;
+
+    if (wav_open(&wav, (const uint8_t*)a, 0) != 0) {
+        printf("%s: not a WAV file\n", a);
+        return -1;
+    }
+    if (wav_open(&next, (const uint8_t*)b, 0) != 0 || next.sample_rate != wav.sample_rate ||
+            next.nchannels != wav.nchannels) {
+        printf("%s: not a WAV file of the same format\n", b);
+        return -1;
+    }
+    xfade_start(&xf, wav.data_size / wav.block_align);
+
+    *periods = wav.data_size / PORT_HALF_SIZE;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (p = 0; p < *periods; p++) fill(mode);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    wav_close(&next);
+    wav_close(&wav);
+
+    return host_ns(&t0, &t1) / *periods;
+}
+
+
+/* host_ns
+ *
+ * 		DESCRIPTION: host time between two readings
+ *		INPUTS: a, b -- readings
+ *		OUTPUTS: none
+ *		RETURN VALUE: nanoseconds
+ */
+static double host_ns(const struct timespec* a, const struct timespec* b) {
+
+    return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
@@ -0,0 +1,236 @@
+/* eq.c - Parametric equalizer applied to the stream before it reaches
+ * the DMA buffer.
+ * Written by Soumithri Bala. */
+
+
+#include "eq.h"
+#include "fixmath.h"
+
+
+/* local function definitions */
+static void eq_design(const eq_band_t* band, uint32_t rate, eq_coef_t* coef);
+static void eq_design_all(eq_t* eq);
+
+
+/* eq_init
+ *
+ * 		DESCRIPTION: clears the chain to no bands
+ *		INPUTS: eq -- equalizer state
+ *		OUTPUTS: eq -- empty chain
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void eq_init(eq_t* eq) {
+
+    int32_t b, c;
+
+    eq->nbands = 0;
+    eq->rate = 0;
+    eq->active = 0;
+    eq->pending = 0;
+
+    for (b = 0; b < EQ_MAX_BANDS; b++) {
+        for (c = 0; c < EQ_MAX_CHANNELS; c++) {
+            eq->s1[b][c] = 0;
+            eq->s2[b][c] = 0;
+        }
+    }
+}
+
+
+/* eq_set_band
+ *
+ * 		DESCRIPTION: sets one band; the new coefficients go into the idle
+ *		             set and are swapped in at the start of the next
+ *		             period, so this is safe to call while playing
+ *		INPUTS: eq -- equalizer state
+ *		        idx -- band number
+ *		        type -- EQ_PEAK, EQ_LOW_SHELF or EQ_HIGH_SHELF
+ *		        freq -- centre or corner frequency in Hz
+ *		        gain -- gain in tenths of a dB
+ *		        q -- Q in hundredths
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: redesigns the idle coefficient set
+ */
+int32_t eq_set_band(eq_t* eq, int32_t idx, int32_t type, uint32_t freq,
+                    int32_t gain, uint32_t q) {
+
+    if (idx < 0 || idx >= EQ_MAX_BANDS || type < EQ_PEAK || type > EQ_HIGH_SHELF ||
+            !freq || !q)
+        return -1;
+
+    /* keep the largest coefficients inside Q27 */
+    if (gain > EQ_MAX_GAIN) gain = EQ_MAX_GAIN;
+    if (gain < -EQ_MAX_GAIN) gain = -EQ_MAX_GAIN;
+
+    eq->band[idx].type = type;
+    eq->band[idx].freq = freq;
+    eq->band[idx].gain = gain;
+    eq->band[idx].q = q;
+
+    /* bands in between start flat */
+    while (eq->nbands < idx) {
+        eq->band[eq->nbands].type = EQ_PEAK;
+        eq->band[eq->nbands].freq = 1000;
+        eq->band[eq->nbands].gain = 0;
+        eq->band[eq->nbands].q = 100;
+        eq->nbands++;
+    }
+    if (eq->nbands <= idx) eq->nbands = idx + 1;
+
+    if (eq->rate) eq_design_all(eq);
+
+    return 0;
+}
+
+
+/* eq_process
+ *
+ * 		DESCRIPTION: runs the bands over one period as cascaded transposed
+ *		             direct form II biquads, both channels of a frame
+ *		             side by side, with 8 guard bits carried between bands
+ *		INPUTS: eq -- equalizer state
+ *		        bus -- interleaved 32-bit mix bus
+ *		        frames -- number of frames
+ *		        channels -- samples per frame
+ *		        rate -- sample rate of this period
+ *		OUTPUTS: bus -- filtered samples
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: swaps in new coefficients at the period boundary
+ */
+void eq_process(eq_t* eq, int32_t* bus, uint32_t frames, uint32_t channels,
+                uint32_t rate) {
+
+    const eq_coef_t* coef;
+    int64_t* s1;
+    int64_t* s2;
+    int32_t x, y;
+    uint32_t i, c;
+    int32_t b;
+
+    if (!eq->nbands || !frames || channels > EQ_MAX_CHANNELS) return;
+
+    /* a new track rate needs new coefficients right away */
+    if (rate != eq->rate) {
+        eq->rate = rate;
+        eq_design_all(eq);
+    }
+
+    if (eq->pending) {
+        eq->active = !eq->active;
+        eq->pending = 0;
+    }
+    coef = eq->coef[eq->active];
+
+    for (i = 0; i < frames; i++) {
+        for (c = 0; c < channels; c++) {
+            /* the bus has headroom, but not past the guard bits */
+            x = *bus;
+            if (x > EQ_BUS_MAX) x = EQ_BUS_MAX;
+            if (x < -EQ_BUS_MAX) x = -EQ_BUS_MAX;
+            x *= 1 << EQ_GUARD_SHIFT;
+            for (b = 0; b < eq->nbands; b++) {
+                s1 = &eq->s1[b][c];
+                s2 = &eq->s2[b][c];
+                y = (int32_t)(((int64_t)coef[b].b0 * x + *s1) >> EQ_COEF_SHIFT);
+                *s1 = (int64_t)coef[b].b1 * x - (int64_t)coef[b].a1 * y + *s2;
+                *s2 = (int64_t)coef[b].b2 * x - (int64_t)coef[b].a2 * y;
+                x = y;
+            }
+            *bus++ = (x + (1 << (EQ_GUARD_SHIFT - 1))) >> EQ_GUARD_SHIFT;
+        }
+    }
+}
+
+
+/* eq_design_all
+ *
+ * 		DESCRIPTION: designs every band into the idle coefficient set and
+ *		             marks it ready to swap in
+ *		INPUTS: eq -- equalizer state
+ *		OUTPUTS: eq -- idle coefficient set
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void eq_design_all(eq_t* eq) {
+
+    eq_coef_t* coef = eq->coef[!eq->active];
+    int32_t b;
+
+    for (b = 0; b < eq->nbands; b++)
+        eq_design(&eq->band[b], eq->rate, &coef[b]);
+
+    eq->pending = 1;
+}
+
+
+/* eq_design
+ *
+ * 		DESCRIPTION: computes one band's coefficients with the RBJ cookbook
+ *		             formulas, in Q28 with 64-bit intermediates
+ *		INPUTS: band -- band settings
+ *		        rate -- sample rate in Hz
+ *		OUTPUTS: coef -- normalized coefficients in Q27
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void eq_design(const eq_band_t* band, uint32_t rate, eq_coef_t* coef) {
+
+    const int64_t one = (int64_t)1 << EQ_DESIGN_SHIFT;
+    int64_t a, sqa, sn, cs, alpha, t, ap1, am1;
+    int64_t b0, b1, b2, a0, a1, a2;
+    int32_t sin_val, cos_val;
+    uint32_t freq = band->freq;
+
+    /* stay below Nyquist */
+    if (freq >= rate / 2) freq = rate / 2 - 1;
+
+    /* A = 10^(dB / 40) and its square root */
+    a = (int64_t)fix_db_gain(band->gain / 2) << (EQ_DESIGN_SHIFT - Q16_SHIFT);
+    sqa = (int64_t)fix_db_gain(band->gain / 4) << (EQ_DESIGN_SHIFT - Q16_SHIFT);
+
+    /* w0 = 2 pi f / fs, as a fraction of a turn */
+    fix_sincos((uint32_t)fix_qdiv(freq, rate, 32), &sin_val, &cos_val);
+    sn = sin_val >> (Q30_SHIFT - EQ_DESIGN_SHIFT);
+    cs = cos_val >> (Q30_SHIFT - EQ_DESIGN_SHIFT);
+
+    /* alpha = sin(w0) / 2Q, with Q in hundredths */
+    alpha = fix_qdiv(sn * 100, 2 * (int64_t)band->q, 0);
+
+    if (band->type == EQ_PEAK) {
+        t = (alpha * a) >> EQ_DESIGN_SHIFT;
+        b0 = one + t;
+        b1 = -2 * cs;
+        b2 = one - t;
+        t = fix_qdiv(alpha, a, EQ_DESIGN_SHIFT);
+        a0 = one + t;
+        a1 = -2 * cs;
+        a2 = one - t;
+    } else {
+        ap1 = a + one;
+        am1 = a - one;
+        t = (((2 * sqa * alpha) >> EQ_DESIGN_SHIFT));
+        if (band->type == EQ_LOW_SHELF) {
+            b0 = (a * (ap1 - ((am1 * cs) >> EQ_DESIGN_SHIFT) + t)) >> EQ_DESIGN_SHIFT;
+            b1 = (2 * a * (am1 - ((ap1 * cs) >> EQ_DESIGN_SHIFT))) >> EQ_DESIGN_SHIFT;
+            b2 = (a * (ap1 - ((am1 * cs) >> EQ_DESIGN_SHIFT) - t)) >> EQ_DESIGN_SHIFT;
+            a0 = ap1 + ((am1 * cs) >> EQ_DESIGN_SHIFT) + t;
+            a1 = -2 * (am1 + ((ap1 * cs) >> EQ_DESIGN_SHIFT));
+            a2 = ap1 + ((am1 * cs) >> EQ_DESIGN_SHIFT) - t;
+        } else {
+            b0 = (a * (ap1 + ((am1 * cs) >> EQ_DESIGN_SHIFT) + t)) >> EQ_DESIGN_SHIFT;
+            b1 = (-2 * a * (am1 + ((ap1 * cs) >> EQ_DESIGN_SHIFT))) >> EQ_DESIGN_SHIFT;
+            b2 = (a * (ap1 + ((am1 * cs) >> EQ_DESIGN_SHIFT) - t)) >> EQ_DESIGN_SHIFT;
+            a0 = ap1 - ((am1 * cs) >> EQ_DESIGN_SHIFT) + t;
+            a1 = 2 * (am1 - ((ap1 * cs) >> EQ_DESIGN_SHIFT));
+            a2 = ap1 - ((am1 * cs) >> EQ_DESIGN_SHIFT) - t;
+        }
+    }
+
+    coef->b0 = (int32_t)fix_qdiv(b0, a0, EQ_COEF_SHIFT);
+    coef->b1 = (int32_t)fix_qdiv(b1, a0, EQ_COEF_SHIFT);
+    coef->b2 = (int32_t)fix_qdiv(b2, a0, EQ_COEF_SHIFT);
+    coef->a1 = (int32_t)fix_qdiv(a1, a0, EQ_COEF_SHIFT);
+    coef->a2 = (int32_t)fix_qdiv(a2, a0, EQ_COEF_SHIFT);
+}
@@ -0,0 +1,61 @@
+/* eq.h - Parametric equalizer definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _EQ_H
+#define _EQ_H
+
+#include <stdint.h>
+
+#define EQ_MAX_BANDS        8
+#define EQ_MAX_CHANNELS     2
+#define EQ_MAX_GAIN         180
+#define EQ_COEF_SHIFT       27
+#define EQ_DESIGN_SHIFT     28
+#define EQ_GUARD_SHIFT      8
+#define EQ_BUS_MAX          ((1 << 23) - 1)
+
+#define EQ_PEAK             0
+#define EQ_LOW_SHELF        1
+#define EQ_HIGH_SHELF       2
+
+/* one band as the user set it */
+typedef struct eq_band {
+    int32_t type;
+    uint32_t freq;      /* centre or corner frequency in Hz */
+    int32_t gain;       /* tenths of a dB */
+    uint32_t q;         /* hundredths */
+} eq_band_t;
+
+/* normalized biquad coefficients in Q27 */
+typedef struct eq_coef {
+    int32_t b0, b1, b2, a1, a2;
+} eq_coef_t;
+
+/* equalizer chain; coefficients are double-buffered so bands can be
+ * changed while playing */
+typedef struct eq {
+    int32_t nbands;
+    uint32_t rate;
+    eq_band_t band[EQ_MAX_BANDS];
+    eq_coef_t coef[2][EQ_MAX_BANDS];
+    volatile int32_t active;
+    volatile int32_t pending;
+    int64_t s1[EQ_MAX_BANDS][EQ_MAX_CHANNELS];
+    int64_t s2[EQ_MAX_BANDS][EQ_MAX_CHANNELS];
+} eq_t;
+
+
+/* clears the chain */
+void eq_init(eq_t* eq);
+
+/* sets a band, taking effect at the start of the next period */
+int32_t eq_set_band(eq_t* eq, int32_t idx, int32_t type, uint32_t freq,
+                    int32_t gain, uint32_t q);
+
+/* filters one period of the mix bus in place */
+void eq_process(eq_t* eq, int32_t* bus, uint32_t frames, uint32_t channels,
+                uint32_t rate);
+
+
+#endif
@@ -0,0 +1,332 @@
+/* fixmath.c - Fixed-point math helpers for the user-level audio path.
+ * Written by Soumithri Bala.
+ *
+ * The kernel doesn't save FPU state across switches, so everything the
+ * fill path computes is done in integers. */
+
+
+#include "fixmath.h"
+
+
+/* first quarter of a sine wave in Q15, with the end point for
+ * interpolation */
+static const int16_t sin_tab[SIN_TAB_SIZE + 1] = {
+        0,   201,   402,   603,   804,  1005,  1206,  1407,
+     1608,  1809,  2009,  2210,  2410,  2611,  2811,  3012,
+     3212,  3412,  3612,  3811,  4011,  4210,  4410,  4609,
+     4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,
+     6393,  6590,  6786,  6983,  7179,  7375,  7571,  7767,
+     7962,  8157,  8351,  8545,  8739,  8933,  9126,  9319,
+     9512,  9704,  9896, 10087, 10278, 10469, 10659, 10849,
+    11039, 11228, 11417, 11605, 11793, 11980, 12167, 12353,
+    12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+    14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269,
+    15446, 15623, 15800, 15976, 16151, 16325, 16499, 16673,
+    16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+    18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357,
+    19519, 19680, 19841, 20000, 20159, 20317, 20475, 20631,
+    20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+    22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027,
+    23170, 23311, 23452, 23592, 23731, 23870, 24007, 24143,
+    24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+    25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198,
+    26319, 26438, 26556, 26674, 26790, 26905, 27019, 27133,
+    27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+    28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803,
+    28898, 28992, 29085, 29177, 29268, 29358, 29447, 29534,
+    29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+    30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783,
+    30852, 30919, 30985, 31050, 31113, 31176, 31237, 31297,
+    31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+    31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098,
+    32137, 32176, 32213, 32250, 32285, 32318, 32351, 32382,
+    32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+    32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717,
+    32728, 32737, 32745, 32752, 32757, 32761, 32765, 32766,
+    32767
+};
+
+
+/* CORDIC rotation angles atan(2^-i), as phases */
+static const int32_t atan_tab[CORDIC_STEPS] = {
+    536870912, 316933406, 167458907, 85004756, 42667331, 21354465,
+    10679838, 5340245, 2670163, 1335087, 667544, 333772,
+    166886, 83443, 41722, 20861, 10430, 5215,
+    2608, 1304, 652, 326, 163, 81,
+    41, 20, 10, 5, 3, 1
+};
+
+/* 2^(i/64) in Q30, with the end point for interpolation */
+static const uint32_t pow2_tab[POW2_TAB_SIZE + 1] = {
+    1073741824U, 1085434106U, 1097253708U, 1109202018U, 1121280436U,
+    1133490379U, 1145833280U, 1158310587U, 1170923762U, 1183674286U,
+    1196563654U, 1209593378U, 1222764986U, 1236080024U, 1249540052U,
+    1263146652U, 1276901417U, 1290805962U, 1304861917U, 1319070932U,
+    1333434672U, 1347954824U, 1362633090U, 1377471191U, 1392470869U,
+    1407633882U, 1422962010U, 1438457051U, 1454120821U, 1469955159U,
+    1485961921U, 1502142985U, 1518500250U, 1535035634U, 1551751076U,
+    1568648537U, 1585730000U, 1602997467U, 1620452965U, 1638098541U,
+    1655936265U, 1673968228U, 1692196547U, 1710623359U, 1729250827U,
+    1748081133U, 1767116489U, 1786359126U, 1805811301U, 1825475297U,
+    1845353420U, 1865448001U, 1885761398U, 1906295993U, 1927054196U,
+    1948038440U, 1969251188U, 1990694927U, 2012372174U, 2034285470U,
+    2056437387U, 2078830522U, 2101467502U, 2124350982U, 2147483648U
+};
+
+
+/* log2(1 + i/64) in Q16, with the end point for interpolation */
+static const uint32_t log2_tab[LOG2_TAB_SIZE + 1] = {
+        0,  1466,  2909,  4331,  5732,  7112,  8473,  9814,
+    11136, 12440, 13727, 14996, 16248, 17484, 18704, 19909,
+    21098, 22272, 23433, 24579, 25711, 26830, 27936, 29029,
+    30109, 31178, 32234, 33279, 34312, 35334, 36346, 37346,
+    38336, 39316, 40286, 41246, 42196, 43137, 44068, 44990,
+    45904, 46809, 47705, 48593, 49472, 50344, 51207, 52063,
+    52911, 53751, 54584, 55410, 56229, 57040, 57845, 58643,
+    59434, 60219, 60997, 61769, 62534, 63294, 64047, 64794,
+    65536
+};
+
+
+/* fix_sin
+ *
+ * 		DESCRIPTION: sine of a phase, from the quarter-wave table with
+ *		             linear interpolation
+ *		INPUTS: phase -- fraction of a full turn, 2^32 per turn
+ *		OUTPUTS: none
+ *		RETURN VALUE: sine in Q15
+ *		SIDE EFFECTS: none
+ */
+int32_t fix_sin(uint32_t phase) {
+
+    uint32_t quad = phase >> 30;
+    uint32_t pos = phase & (PHASE_QUARTER - 1);
+    uint32_t idx, frac;
+    int32_t val;
+
+    /* second and fourth quarters run the table backwards */
+    if (quad & 1) pos = PHASE_QUARTER - pos;
+
+    idx = pos >> (30 - SIN_TAB_BITS);
+    frac = (pos >> (30 - SIN_TAB_BITS - 16)) & 0xFFFF;
+    if (idx >= SIN_TAB_SIZE) {
+        idx = SIN_TAB_SIZE - 1;
+        frac = 0x10000;
+    }
+
+    val = sin_tab[idx] + (((sin_tab[idx + 1] - sin_tab[idx]) * (int32_t)frac) >> 16);
+
+    /* second half of the turn is negative */
+    return (quad & 2) ? -val : val;
+}
+
+
+/* fix_cos
+ *
+ * 		DESCRIPTION: cosine of a phase
+ *		INPUTS: phase -- fraction of a full turn, 2^32 per turn
+ *		OUTPUTS: none
+ *		RETURN VALUE: cosine in Q15
+ *		SIDE EFFECTS: none
+ */
+int32_t fix_cos(uint32_t phase) {
+
+    return fix_sin(phase + PHASE_QUARTER);
+}
+
+
+/* fix_sincos
+ *
+ * 		DESCRIPTION: sine and cosine of a phase by CORDIC rotation, precise
+ *		             enough for filter coefficients near DC where the
+ *		             table lookup isn't
+ *		INPUTS: phase -- fraction of a full turn, 2^32 per turn
+ *		OUTPUTS: sin_val -- sine in Q30
+ *		         cos_val -- cosine in Q30
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void fix_sincos(uint32_t phase, int32_t* sin_val, int32_t* cos_val) {
+
+    int32_t x = CORDIC_GAIN;
+    int32_t y = 0;
+    int32_t z = (int32_t)phase;
+    int32_t flip = 0;
+    int32_t i, dx;
+
+    /* CORDIC only converges within a quarter turn of zero */
+    if (z > (int32_t)PHASE_QUARTER || z < -(int32_t)PHASE_QUARTER) {
+        z += (int32_t)PHASE_HALF;
+        flip = 1;
+    }
+
+    for (i = 0; i < CORDIC_STEPS; i++) {
+        dx = x >> i;
+        if (z >= 0) {
+            x -= y >> i;
+            y += dx;
+            z -= atan_tab[i];
+        } else {
+            x += y >> i;
+            y -= dx;
+            z += atan_tab[i];
+        }
+    }
+
+    *sin_val = flip ? -y : y;
+    *cos_val = flip ? -x : x;
+}
+
+
+/* fix_pow2
+ *
+ * 		DESCRIPTION: two to the power of an exponent, from a table of the
+ *		             fractional part with linear interpolation
+ *		INPUTS: exp -- exponent in Q16, between -16 and 15
+ *		OUTPUTS: none
+ *		RETURN VALUE: result in Q16
+ *		SIDE EFFECTS: none
+ */
+uint32_t fix_pow2(int32_t exp) {
+
+    int32_t whole = exp >> Q16_SHIFT;
+    uint32_t frac = exp & 0xFFFF;
+    uint32_t idx = frac >> (Q16_SHIFT - POW2_TAB_BITS);
+    uint32_t sub = frac & ((1 << (Q16_SHIFT - POW2_TAB_BITS)) - 1);
+    uint32_t mant;
+
+    /* mantissa in Q30, between 1 and 2 */
+    mant = pow2_tab[idx] + (uint32_t)(((uint64_t)(pow2_tab[idx + 1] - pow2_tab[idx]) * sub)
+            >> (Q16_SHIFT - POW2_TAB_BITS));
+
+    if (whole >= Q30_SHIFT - Q16_SHIFT) return mant << (whole - (Q30_SHIFT - Q16_SHIFT));
+    if (whole <= -Q16_SHIFT) return 0;
+
+    return mant >> ((Q30_SHIFT - Q16_SHIFT) - whole);
+}
+
+
+/* fix_log2
+ *
+ * 		DESCRIPTION: base-2 logarithm, from the position of the top bit and
+ *		             a table of the mantissa with linear interpolation
+ *		INPUTS: val -- value to take the logarithm of
+ *		OUTPUTS: none
+ *		RETURN VALUE: logarithm in Q16, -64 for 0
+ *		SIDE EFFECTS: none
+ */
+int32_t fix_log2(uint64_t val) {
+
+    int32_t top = 63;
+    uint32_t mant, idx, sub;
+
+    if (!val) return -64 * (1 << Q16_SHIFT);
+
+    while (!(val >> top)) top--;
+
+    /* mantissa in Q30, between 1 and 2 */
+    mant = top >= Q30_SHIFT ? (uint32_t)(val >> (top - Q30_SHIFT))
+                            : (uint32_t)val << (Q30_SHIFT - top);
+    mant -= 1 << Q30_SHIFT;
+    idx = mant >> (Q30_SHIFT - LOG2_TAB_BITS);
+    sub = (mant >> (Q30_SHIFT - LOG2_TAB_BITS - Q16_SHIFT)) & 0xFFFF;
+
+    return (top << Q16_SHIFT) + log2_tab[idx] +
+           (((log2_tab[idx + 1] - log2_tab[idx]) * sub) >> Q16_SHIFT);
+}
+
+
+/* fix_db_gain
+ *
+ * 		DESCRIPTION: converts a gain in dB to an amplitude ratio
+ *		INPUTS: tenths -- gain in tenths of a dB, within +-90 dB
+ *		OUTPUTS: none
+ *		RETURN VALUE: 10^(tenths / 200) in Q16
+ *		SIDE EFFECTS: none
+ */
+uint32_t fix_db_gain(int32_t tenths) {
+
+    return fix_pow2((tenths * DB_TO_LOG2) >> DB_TO_LOG2_SHIFT);
+}
+
+
+/* fix_qdiv
+ *
+ * 		DESCRIPTION: divides by shift and subtract, since there's no 64-bit
+ *		             division in user space; only used off the hot path
+ *		INPUTS: num -- dividend
+ *		        den -- divisor
+ *		        shift -- fractional bits to add to the quotient
+ *		OUTPUTS: none
+ *		RETURN VALUE: (num << shift) / den, 0 if den is 0
+ *		SIDE EFFECTS: none
+ */
+int64_t fix_qdiv(int64_t num, int64_t den, int32_t shift) {
+
+    uint64_t n, d, q = 0, r = 0;
+    int32_t neg = (num < 0) != (den < 0);
+    int32_t i;
+
+    if (!den) return 0;
+
+    n = num < 0 ? -num : num;
+    d = den < 0 ? -den : den;
+
+    /* long division over the dividend's bits followed by shift zeros */
+    for (i = 63 + shift; i >= 0; i--) {
+        r = (r << 1) | (i >= shift ? (n >> (i - shift)) & 1 : 0);
+        q <<= 1;
+        if (r >= d) {
+            r -= d;
+            q |= 1;
+        }
+    }
+
+    return neg ? -(int64_t)q : (int64_t)q;
+}
+
+
+/* fix_sqrt
+ *
+ * 		DESCRIPTION: integer square root, a bit at a time
+ *		INPUTS: val -- value to take the root of
+ *		OUTPUTS: none
+ *		RETURN VALUE: floor of the square root
+ *		SIDE EFFECTS: none
+ */
+uint32_t fix_sqrt(uint64_t val) {
+
+    uint64_t root = 0;
+    uint64_t bit = (uint64_t)1 << 62;
+
+    while (bit > val) bit >>= 2;
+
+    while (bit) {
+        if (val >= root + bit) {
+            val -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
+
+
+/* fix_sat16
+ *
+ * 		DESCRIPTION: clamps a value to the signed 16-bit range
+ *		INPUTS: val -- value to clamp
+ *		OUTPUTS: none
+ *		RETURN VALUE: clamped value
+ *		SIDE EFFECTS: none
+ */
+int16_t fix_sat16(int32_t val) {
+
+    if (val > S16_MAX) return S16_MAX;
+    if (val < S16_MIN) return S16_MIN;
+
+    return val;
+}
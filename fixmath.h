@@ -0,0 +1,65 @@
+/* fixmath.h - Fixed-point math helper definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _FIXMATH_H
+#define _FIXMATH_H
+
+#include <stdint.h>
+
+#define Q15_SHIFT           15
+#define Q15_ONE             32767
+#define S16_MAX             32767
+#define S16_MIN             (-32768)
+
+#define SIN_TAB_BITS        8
+#define SIN_TAB_SIZE        (1 << SIN_TAB_BITS)
+
+/* phases are fractions of a full turn in 32 bits */
+#define PHASE_QUARTER       0x40000000U
+#define PHASE_HALF          0x80000000U
+
+#define Q16_SHIFT           16
+#define Q30_SHIFT           30
+#define CORDIC_STEPS        30
+#define CORDIC_GAIN         652032874
+#define POW2_TAB_BITS       6
+#define POW2_TAB_SIZE       (1 << POW2_TAB_BITS)
+#define LOG2_TAB_BITS       6
+#define LOG2_TAB_SIZE       (1 << LOG2_TAB_BITS)
+
+/* log2(10) / 200 in Q16, times 512, to turn tenths of a dB into a
+ * base-2 exponent */
+#define DB_TO_LOG2          557322
+#define DB_TO_LOG2_SHIFT    9
+
+
+/* sine of a phase, in Q15 */
+int32_t fix_sin(uint32_t phase);
+
+/* cosine of a phase, in Q15 */
+int32_t fix_cos(uint32_t phase);
+
+/* sine and cosine of a phase, in Q30, for filter design */
+void fix_sincos(uint32_t phase, int32_t* sin_val, int32_t* cos_val);
+
+/* two to the power of a Q16 exponent, in Q16 */
+uint32_t fix_pow2(int32_t exp);
+
+/* base-2 logarithm of an integer, in Q16 */
+int32_t fix_log2(uint64_t val);
+
+/* amplitude ratio for a gain in tenths of a dB, in Q16 */
+uint32_t fix_db_gain(int32_t tenths);
+
+/* (num << shift) / den without library division */
+int64_t fix_qdiv(int64_t num, int64_t den, int32_t shift);
+
+/* integer square root */
+uint32_t fix_sqrt(uint64_t val);
+
+/* clamps a value to the signed 16-bit range */
+int16_t fix_sat16(int32_t val);
+
+
+#endif
@@ -0,0 +1,781 @@
+/* fm.c - OPL3 FM synthesizer implementation file. MIDI events are turned
+ * into register writes for the card's OPL3, with General MIDI patches from
+ * a DMX GENMIDI bank or a small built-in set.
+ * Written by Soumithri Bala. */
+
+
+#include "fm.h"
+#include "fixmath.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* per-channel registers, at the channel's index in its bank */
+#define FM_REG_FNUM         0xA0
+#define FM_REG_KEY          0xB0
+#define FM_REG_FEEDBACK     0xC0
+
+/* per-operator registers, at the operator's offset */
+#define FM_REG_CHR          0x20
+#define FM_REG_LEVEL        0x40
+#define FM_REG_ATTACK       0x60
+#define FM_REG_SUSTAIN      0x80
+#define FM_REG_WAVE         0xE0
+#define FM_CAR_OFFSET       3
+
+#define FM_KEY_ON           0x20
+#define FM_BLOCK_SHIFT      2
+#define FM_MAX_BLOCK        7
+#define FM_FNUM_BITS        10
+#define FM_FNUM_LO          0xFF
+#define FM_WAVE_MASK        0x07
+#define FM_LEVEL_MASK       0x3F
+#define FM_KSL_MASK         0xC0
+#define FM_MAX_ATTEN        0x3F
+#define FM_ADDITIVE         0x01
+#define FM_FEEDBACK_MASK    0x0F
+#define FM_LEFT             0x10
+#define FM_RIGHT            0x20
+
+/* F-number of A4 in block 0, Q8: 440 Hz * 2^20 / (14.318 MHz / 288) */
+#define FM_FNUM_A4          2375731
+#define FM_NOTE_A4          69
+#define FM_MAX_NOTE         127
+#define SEMITONES           12
+#define FNUM_FRAC_BITS      8
+
+/* velocity, volume and expression each follow 40 log10, which is 16.055
+ * steps of 0.75 dB per halving; Q8 */
+#define FM_FULL_SCALE       (127 * 127 * 127)
+#define FM_ATTEN_PER_LOG2   4110
+#define FM_ATTEN_SHIFT      24
+#define FM_ATTEN_RANGE      (4 << Q16_SHIFT)
+
+/* controller defaults, and the hard left and right thirds of the pan */
+#define FM_DEF_VOLUME       100
+#define FM_DEF_PAN          64
+#define FM_DEF_BEND_RANGE   2
+#define FM_MAX_BEND_RANGE   24
+#define FM_PAN_LEFT         43
+#define FM_PAN_RIGHT        85
+#define FM_PEDAL_DOWN       64
+#define FM_RPN_NONE         0x3FFF
+#define FM_RPN_BEND_RANGE   0
+#define FM_BEND_SHIFT       13
+#define MIDI_MAX            127
+
+/* the second layer's finetune is in 64ths of a semitone from 128 */
+#define FM_FINETUNE_NONE    128
+#define FM_FINETUNE_SHIFT   10
+
+/* DMX GENMIDI: a signature, then 36 bytes a patch */
+#define OP2_ID              "#OPL_II#"
+#define OP2_ID_LEN          8
+#define OP2_PATCH_SIZE      36
+#define OP2_LAYER_OFFSET    4
+#define OP2_LAYER_SIZE      16
+#define OP2_CAR_OFFSET      7
+#define OP2_NOTE_OFFSET     14
+
+/* built-in bank: one patch for each family of eight programs, and a few
+ * drum sounds played at fixed notes */
+#define FM_FAMILY_SHIFT     3
+#define FM_FAMILIES         16
+#define DRUM_KICK           0
+#define DRUM_SNARE          1
+#define DRUM_HAT            2
+#define DRUM_OPEN_HAT       3
+#define DRUM_TOM            4
+#define DRUM_CRASH          5
+#define DRUM_RIDE           6
+#define DRUM_BLOCK          7
+#define FM_DRUM_KINDS       8
+
+
+/* operator offsets of the first operator of each channel in a bank */
+static const uint8_t op_offset[FM_BANK_VOICES] = {0, 1, 2, 8, 9, 10, 16, 17, 18};
+
+/* chr, attack, sustain, wave, ksl, level for the modulator, feedback and
+ * connection, then the carrier's */
+static const fm_layer_t family_tab[FM_FAMILIES] = {
+    {{0x01, 0xF2, 0x53, 0x00, 0x40, 0x1A}, 0x06, {0x11, 0xF2, 0x44, 0x00, 0x00, 0x00}, 0},   /* piano */
+    {{0x07, 0xF4, 0x46, 0x00, 0x40, 0x28}, 0x04, {0x01, 0xF4, 0x45, 0x00, 0x00, 0x00}, 0},   /* chromatic percussion */
+    {{0x22, 0xF0, 0x07, 0x00, 0x00, 0x08}, 0x01, {0x21, 0xF0, 0x07, 0x00, 0x00, 0x00}, 0},   /* organ */
+    {{0x03, 0xF5, 0x66, 0x00, 0x40, 0x1E}, 0x0C, {0x01, 0xF3, 0x55, 0x00, 0x00, 0x00}, 0},   /* guitar */
+    {{0x01, 0xF4, 0x54, 0x00, 0x40, 0x14}, 0x0A, {0x01, 0xF3, 0x48, 0x00, 0x00, 0x00}, 0},   /* bass */
+    {{0x61, 0x71, 0x13, 0x00, 0x40, 0x1C}, 0x0C, {0x61, 0x62, 0x14, 0x00, 0x00, 0x00}, 0},   /* strings */
+    {{0x61, 0x51, 0x13, 0x00, 0x00, 0x20}, 0x0A, {0x61, 0x52, 0x15, 0x00, 0x00, 0x00}, 0},   /* ensemble */
+    {{0x21, 0x83, 0x15, 0x00, 0x00, 0x16}, 0x0C, {0x21, 0x84, 0x16, 0x00, 0x00, 0x00}, 0},   /* brass */
+    {{0x22, 0x83, 0x15, 0x00, 0x00, 0x1C}, 0x06, {0x21, 0x75, 0x16, 0x00, 0x00, 0x00}, 0},   /* reed */
+    {{0x61, 0x73, 0x15, 0x00, 0x00, 0x2C}, 0x0E, {0x61, 0x74, 0x15, 0x00, 0x00, 0x00}, 0},   /* pipe */
+    {{0x21, 0xF1, 0x0F, 0x00, 0x00, 0x14}, 0x0E, {0x21, 0xF1, 0x07, 0x00, 0x00, 0x00}, 0},   /* synth lead */
+    {{0x62, 0x31, 0x13, 0x00, 0x00, 0x24}, 0x05, {0x61, 0x32, 0x14, 0x00, 0x00, 0x00}, 0},   /* synth pad */
+    {{0x65, 0x41, 0x24, 0x00, 0x00, 0x22}, 0x08, {0x61, 0x42, 0x25, 0x00, 0x00, 0x00}, 0},   /* synth effects */
+    {{0x04, 0xF5, 0x55, 0x01, 0x40, 0x18}, 0x0A, {0x01, 0xF4, 0x56, 0x00, 0x00, 0x00}, 0},   /* ethnic */
+    {{0x05, 0xF8, 0x68, 0x00, 0x40, 0x1C}, 0x08, {0x01, 0xF6, 0x77, 0x00, 0x00, 0x00}, 0},   /* percussive */
+    {{0x0F, 0xF3, 0x35, 0x00, 0x00, 0x08}, 0x0E, {0x01, 0xF3, 0x35, 0x00, 0x00, 0x00}, 0}    /* sound effects */
+};
+
+static const fm_layer_t drum_tab[FM_DRUM_KINDS] = {
+    {{0x00, 0xF8, 0xF8, 0x00, 0x00, 0x0D}, 0x0C, {0x00, 0xF6, 0x68, 0x00, 0x00, 0x00}, 0},   /* kick */
+    {{0x0F, 0xF8, 0xF7, 0x00, 0x00, 0x00}, 0x0E, {0x00, 0xF7, 0x77, 0x00, 0x00, 0x00}, 0},   /* snare */
+    {{0x0F, 0xFA, 0xF9, 0x00, 0x00, 0x00}, 0x0E, {0x0C, 0xF9, 0xF9, 0x00, 0x00, 0x04}, 0},   /* closed hat */
+    {{0x0F, 0xF6, 0x56, 0x00, 0x00, 0x00}, 0x0E, {0x0C, 0xF6, 0x56, 0x00, 0x00, 0x04}, 0},   /* open hat */
+    {{0x01, 0xF7, 0x88, 0x00, 0x00, 0x12}, 0x08, {0x00, 0xF5, 0x76, 0x00, 0x00, 0x00}, 0},   /* tom */
+    {{0x0F, 0xF4, 0x34, 0x00, 0x00, 0x00}, 0x0E, {0x0E, 0xF3, 0x34, 0x00, 0x00, 0x00}, 0},   /* crash */
+    {{0x0E, 0xF5, 0x45, 0x00, 0x00, 0x10}, 0x0A, {0x07, 0xF4, 0x45, 0x00, 0x00, 0x00}, 0},   /* ride */
+    {{0x06, 0xF9, 0xF9, 0x00, 0x00, 0x10}, 0x0A, {0x01, 0xF8, 0x88, 0x00, 0x00, 0x00}, 0}    /* block */
+};
+
+/* sound and fixed note of each drum from 35 to 81 */
+static const uint8_t drum_map[FM_PATCHES - FM_PROGRAMS][2] = {
+    {DRUM_KICK, 22}, {DRUM_KICK, 24}, {DRUM_BLOCK, 72}, {DRUM_SNARE, 60},
+    {DRUM_SNARE, 66}, {DRUM_SNARE, 62}, {DRUM_TOM, 36}, {DRUM_HAT, 96},
+    {DRUM_TOM, 40}, {DRUM_HAT, 92}, {DRUM_TOM, 43}, {DRUM_OPEN_HAT, 96},
+    {DRUM_TOM, 47}, {DRUM_TOM, 50}, {DRUM_CRASH, 88}, {DRUM_TOM, 53},
+    {DRUM_RIDE, 84}, {DRUM_CRASH, 84}, {DRUM_RIDE, 88}, {DRUM_HAT, 100},
+    {DRUM_CRASH, 92}, {DRUM_BLOCK, 79}, {DRUM_CRASH, 90}, {DRUM_OPEN_HAT, 80},
+    {DRUM_RIDE, 82}, {DRUM_TOM, 64}, {DRUM_TOM, 60}, {DRUM_TOM, 62},
+    {DRUM_TOM, 60}, {DRUM_TOM, 55}, {DRUM_TOM, 66}, {DRUM_TOM, 60},
+    {DRUM_BLOCK, 86}, {DRUM_BLOCK, 81}, {DRUM_HAT, 104}, {DRUM_HAT, 108},
+    {DRUM_BLOCK, 96}, {DRUM_BLOCK, 93}, {DRUM_HAT, 90}, {DRUM_OPEN_HAT, 88},
+    {DRUM_BLOCK, 84}, {DRUM_BLOCK, 77}, {DRUM_BLOCK, 72}, {DRUM_TOM, 70},
+    {DRUM_TOM, 65}, {DRUM_RIDE, 100}, {DRUM_RIDE, 100}
+};
+
+
+/* local function definitions */
+static void fm_builtin(fm_t* fm);
+static int32_t fm_bank_load(fm_t* fm, const uint8_t* name);
+static void fm_op_read(fm_op_t* op, const uint8_t* p);
+static void fm_note_on(fm_t* fm, uint32_t chan, uint32_t key, uint32_t velocity);
+static void fm_note_off(fm_t* fm, uint32_t chan, uint32_t key);
+static void fm_control(fm_t* fm, uint32_t chan, uint32_t cc, uint32_t val);
+static void fm_release(fm_t* fm, uint32_t chan, uint32_t held_only);
+static uint32_t fm_alloc(fm_t* fm);
+static void fm_program(fm_t* fm, uint32_t v);
+static void fm_key_off(fm_t* fm, uint32_t v);
+static void fm_pitch(fm_t* fm, uint32_t v);
+static void fm_level(fm_t* fm, uint32_t v);
+static void fm_pan(fm_t* fm, uint32_t v);
+static void fm_out(fm_t* fm, uint32_t reg, uint8_t val);
+static uint32_t fm_chan_reg(uint32_t v);
+static uint32_t fm_op_reg(uint32_t v);
+
+
+/* fm_init
+ *
+ * 		DESCRIPTION: sets up the synthesizer for a chip the driver has just
+ *		             cleared. The built-in patches are replaced by a GENMIDI
+ *		             bank's if the file is there.
+ *		INPUTS: fm -- synthesizer state
+ *		        bank_name -- name of the bank file, or 0 for none
+ *		OUTPUTS: fm -- idle voices and default controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void fm_init(fm_t* fm, const uint8_t* bank_name) {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_REGS; i++) fm->shadow[i] = 0;
+    for (i = 0; i < FM_VOICES; i++) {
+        fm->voice[i].on = 0;
+        fm->voice[i].held = 0;
+        fm->voice[i].age = 0;
+        fm->voice[i].layer = 0;
+    }
+    fm->nwrites = 0;
+    fm->clock = 0;
+
+    fm_builtin(fm);
+    if (bank_name) fm_bank_load(fm, bank_name);
+
+    fm_reset(fm);
+}
+
+
+/* fm_reset
+ *
+ * 		DESCRIPTION: releases every voice and puts every channel back to
+ *		             program 0 with default controllers, as at the start of
+ *		             a song
+ *		INPUTS: fm -- synthesizer state
+ *		OUTPUTS: fm -- released voices and default controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues key-off writes
+ */
+void fm_reset(fm_t* fm) {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_VOICES; i++) {
+        if (fm->voice[i].on) fm_key_off(fm, i);
+        fm->voice[i].held = 0;
+    }
+
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        fm->chan[i].program = 0;
+        fm->chan[i].volume = FM_DEF_VOLUME;
+        fm->chan[i].expression = MIDI_MAX;
+        fm->chan[i].pan = FM_DEF_PAN;
+        fm->chan[i].sustain = 0;
+        fm->chan[i].rpn = FM_RPN_NONE;
+        fm->chan[i].bend = 0;
+        fm->chan[i].bend_range = FM_DEF_BEND_RANGE;
+    }
+}
+
+
+/* fm_event
+ *
+ * 		DESCRIPTION: plays one MIDI event; system exclusive and pressure
+ *		             are ignored
+ *		INPUTS: fm -- synthesizer state
+ *		        ev -- the event
+ *		OUTPUTS: fm -- voices and controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes, flushing them if the queue
+ *		              fills
+ */
+void fm_event(fm_t* fm, const midi_event_t* ev) {
+
+    uint32_t type = ev->status & MIDI_TYPE_MASK;
+    uint32_t chan = ev->status & MIDI_CHAN_MASK;
+    fm_chan_t* ch = &fm->chan[chan];
+    uint32_t i;
+
+    if (ev->status >= MIDI_SYSEX) return;
+
+    if (type == MIDI_NOTE_ON && ev->data2) {
+        fm_note_on(fm, chan, ev->data1, ev->data2);
+    } else if (type == MIDI_NOTE_ON || type == MIDI_NOTE_OFF) {
+        fm_note_off(fm, chan, ev->data1);
+    } else if (type == MIDI_CONTROL) {
+        fm_control(fm, chan, ev->data1, ev->data2);
+    } else if (type == MIDI_PROGRAM) {
+        ch->program = ev->data1;
+    } else if (type == MIDI_PITCH_BEND) {
+        /* a full bend is the range in semitones, and the centre is Q13 */
+        ch->bend = ((int32_t)(ev->data1 | (ev->data2 << 7)) - MIDI_BEND_CENTRE) *
+                   (int32_t)ch->bend_range * (1 << (Q16_SHIFT - FM_BEND_SHIFT));
+        for (i = 0; i < FM_VOICES; i++) {
+            if (fm->voice[i].layer && fm->voice[i].chan == chan) fm_pitch(fm, i);
+        }
+    }
+}
+
+
+/* fm_flush
+ *
+ * 		DESCRIPTION: sends the queued register writes to the chip
+ *		INPUTS: fm -- synthesizer state
+ *		OUTPUTS: fm -- empty queue
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: programs the OPL3
+ */
+int32_t fm_flush(fm_t* fm) {
+
+    int32_t ret = 0;
+
+    if (fm->nwrites) ret = ece391_audio_fm_write(fm->writes, fm->nwrites);
+    fm->nwrites = 0;
+
+    return ret == -1 ? -1 : 0;
+}
+
+
+/* fm_builtin
+ *
+ * 		DESCRIPTION: fills the bank with the built-in patches: each program
+ *		             gets its family's sound, and each drum a fixed note of
+ *		             one of a few drum sounds
+ *		INPUTS: fm -- synthesizer state
+ *		OUTPUTS: fm -- the bank
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void fm_builtin(fm_t* fm) {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_PATCHES; i++) {
+        fm->bank[i].finetune = FM_FINETUNE_NONE;
+        if (i < FM_PROGRAMS) {
+            fm->bank[i].flags = 0;
+            fm->bank[i].note = 0;
+            fm->bank[i].layer[0] = family_tab[i >> FM_FAMILY_SHIFT];
+        } else {
+            fm->bank[i].flags = FM_FIXED;
+            fm->bank[i].note = drum_map[i - FM_PROGRAMS][1];
+            fm->bank[i].layer[0] = drum_tab[drum_map[i - FM_PROGRAMS][0]];
+        }
+        fm->bank[i].layer[1] = fm->bank[i].layer[0];
+    }
+}
+
+
+/* fm_bank_load
+ *
+ * 		DESCRIPTION: reads a DMX GENMIDI bank, as Doom and many DOS games
+ *		             shipped it, over the built-in patches
+ *		INPUTS: fm -- synthesizer state
+ *		        name -- name of the bank file
+ *		OUTPUTS: fm -- the bank
+ *		RETURN VALUE: 0 on success, -1 if there is no whole bank there
+ *		SIDE EFFECTS: none
+ */
+static int32_t fm_bank_load(fm_t* fm, const uint8_t* name) {
+
+    uint8_t buf[OP2_PATCH_SIZE];
+    const uint8_t* p;
+    fm_layer_t* l;
+    int32_t fd, n;
+    uint32_t i, j, got;
+
+    if ((fd = ece391_open(name)) == -1) return -1;
+
+    if (ece391_read(fd, buf, OP2_ID_LEN) != OP2_ID_LEN ||
+        ece391_strncmp(buf, (uint8_t*)OP2_ID, OP2_ID_LEN)) {
+        ece391_close(fd);
+        return -1;
+    }
+
+    for (i = 0; i < FM_PATCHES; i++) {
+        for (got = 0; got < OP2_PATCH_SIZE; got += n) {
+            if ((n = ece391_read(fd, buf + got, OP2_PATCH_SIZE - got)) <= 0) {
+                ece391_close(fd);
+                fm_builtin(fm);
+                return -1;
+            }
+        }
+
+        fm->bank[i].flags = buf[0] | (buf[1] << 8);
+        fm->bank[i].finetune = buf[2];
+        fm->bank[i].note = buf[3];
+        for (j = 0; j < 2; j++) {
+            p = buf + OP2_LAYER_OFFSET + j * OP2_LAYER_SIZE;
+            l = &fm->bank[i].layer[j];
+            fm_op_read(&l->mod, p);
+            l->feedback = p[6];
+            fm_op_read(&l->car, p + OP2_CAR_OFFSET);
+            l->offset = (int16_t)(p[OP2_NOTE_OFFSET] | (p[OP2_NOTE_OFFSET + 1] << 8));
+        }
+    }
+
+    ece391_close(fd);
+
+    return 0;
+}
+
+
+/* fm_op_read
+ *
+ * 		DESCRIPTION: reads one operator of a GENMIDI patch
+ *		INPUTS: p -- its six bytes
+ *		OUTPUTS: op -- the operator
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void fm_op_read(fm_op_t* op, const uint8_t* p) {
+
+    op->chr = p[0];
+    op->attack = p[1];
+    op->sustain = p[2];
+    op->wave = p[3];
+    op->ksl = p[4] & FM_KSL_MASK;
+    op->level = p[5] & FM_LEVEL_MASK;
+}
+
+
+/* fm_note_on
+ *
+ * 		DESCRIPTION: starts a note on one voice, or two for a double-voice
+ *		             patch. Drums outside the kit are ignored, and a key
+ *		             already sounding on the channel is released first.
+ *		INPUTS: fm -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        key -- note number
+ *		        velocity -- 1 to 127
+ *		OUTPUTS: fm -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_note_on(fm_t* fm, uint32_t chan, uint32_t key, uint32_t velocity) {
+
+    const fm_patch_t* patch;
+    fm_voice_t* vc;
+    uint32_t i, v, layers;
+    int32_t note;
+
+    if (chan == MIDI_DRUMS) {
+        if (key < FM_DRUM_FIRST || key > FM_DRUM_LAST) return;
+        patch = &fm->bank[FM_PROGRAMS + key - FM_DRUM_FIRST];
+    } else {
+        patch = &fm->bank[fm->chan[chan].program];
+    }
+
+    for (i = 0; i < FM_VOICES; i++) {
+        if (fm->voice[i].on && fm->voice[i].chan == chan && fm->voice[i].key == key)
+            fm_key_off(fm, i);
+    }
+
+    layers = (patch->flags & FM_DOUBLE) ? 2 : 1;
+    for (i = 0; i < layers; i++) {
+        v = fm_alloc(fm);
+        vc = &fm->voice[v];
+
+        note = (patch->flags & FM_FIXED) ? patch->note : key;
+        note += patch->layer[i].offset;
+        vc->pitch = note * (1 << Q16_SHIFT);
+        if (i) vc->pitch += ((int32_t)patch->finetune - FM_FINETUNE_NONE) * (1 << FM_FINETUNE_SHIFT);
+
+        vc->chan = chan;
+        vc->key = key;
+        vc->velocity = velocity;
+        vc->layer = &patch->layer[i];
+        vc->held = 0;
+
+        fm_program(fm, v);
+        vc->on = 1;
+        vc->age = fm->clock++;
+        fm_pitch(fm, v);
+    }
+}
+
+
+/* fm_note_off
+ *
+ * 		DESCRIPTION: releases the voices playing a key, or marks them to be
+ *		             released when the sustain pedal comes up
+ *		INPUTS: fm -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        key -- note number
+ *		OUTPUTS: fm -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_note_off(fm_t* fm, uint32_t chan, uint32_t key) {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_VOICES; i++) {
+        if (!fm->voice[i].on || fm->voice[i].chan != chan || fm->voice[i].key != key)
+            continue;
+        if (fm->chan[chan].sustain) fm->voice[i].held = 1;
+        else fm_key_off(fm, i);
+    }
+}
+
+
+/* fm_control
+ *
+ * 		DESCRIPTION: applies a controller change: volume, expression and
+ *		             pan update the channel's voices as they sound, and
+ *		             the pitch bend range is set through RPN 0
+ *		INPUTS: fm -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        cc -- controller number
+ *		        val -- its value
+ *		OUTPUTS: fm -- the channel and its voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_control(fm_t* fm, uint32_t chan, uint32_t cc, uint32_t val) {
+
+    fm_chan_t* ch = &fm->chan[chan];
+    uint32_t i;
+
+    if (cc == MIDI_CC_VOLUME || cc == MIDI_CC_EXPRESSION) {
+        if (cc == MIDI_CC_VOLUME) ch->volume = val;
+        else ch->expression = val;
+        for (i = 0; i < FM_VOICES; i++) {
+            if (fm->voice[i].layer && fm->voice[i].chan == chan) fm_level(fm, i);
+        }
+    } else if (cc == MIDI_CC_PAN) {
+        ch->pan = val;
+        for (i = 0; i < FM_VOICES; i++) {
+            if (fm->voice[i].layer && fm->voice[i].chan == chan) fm_pan(fm, i);
+        }
+    } else if (cc == MIDI_CC_SUSTAIN) {
+        ch->sustain = val >= FM_PEDAL_DOWN;
+        if (!ch->sustain) fm_release(fm, chan, 1);
+    } else if (cc == MIDI_CC_RPN_HI) {
+        ch->rpn = (ch->rpn & 0x7F) | (val << 7);
+    } else if (cc == MIDI_CC_RPN_LO) {
+        ch->rpn = (ch->rpn & (0x7F << 7)) | val;
+    } else if (cc == MIDI_CC_NRPN_HI || cc == MIDI_CC_NRPN_LO) {
+        ch->rpn = FM_RPN_NONE;
+    } else if (cc == MIDI_CC_DATA) {
+        if (ch->rpn == FM_RPN_BEND_RANGE)
+            ch->bend_range = val > FM_MAX_BEND_RANGE ? FM_MAX_BEND_RANGE : val;
+    } else if (cc == MIDI_CC_RESET) {
+        ch->expression = MIDI_MAX;
+        ch->sustain = 0;
+        ch->rpn = FM_RPN_NONE;
+        ch->bend = 0;
+        fm_release(fm, chan, 1);
+        for (i = 0; i < FM_VOICES; i++) {
+            if (fm->voice[i].layer && fm->voice[i].chan == chan) {
+                fm_level(fm, i);
+                fm_pitch(fm, i);
+            }
+        }
+    } else if (cc == MIDI_CC_SOUND_OFF || cc == MIDI_CC_NOTES_OFF) {
+        fm_release(fm, chan, 0);
+    }
+}
+
+
+/* fm_release
+ *
+ * 		DESCRIPTION: releases a channel's voices
+ *		INPUTS: fm -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        held_only -- 1 for only those the pedal was holding
+ *		OUTPUTS: fm -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_release(fm_t* fm, uint32_t chan, uint32_t held_only) {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_VOICES; i++) {
+        if (!fm->voice[i].on || fm->voice[i].chan != chan) continue;
+        if (held_only && !fm->voice[i].held) continue;
+        fm_key_off(fm, i);
+    }
+}
+
+
+/* fm_alloc
+ *
+ * 		DESCRIPTION: picks a voice for a new note: the one released longest
+ *		             ago, since its tail has had the most time to fade,
+ *		             then the oldest one the pedal holds, then the oldest
+ *		             one still keyed
+ *		INPUTS: fm -- synthesizer state
+ *		OUTPUTS: none
+ *		RETURN VALUE: the voice
+ *		SIDE EFFECTS: none
+ */
+static uint32_t fm_alloc(fm_t* fm) {
+
+    uint32_t i, rank, best = 0, best_rank = 3;
+
+    for (i = 0; i < FM_VOICES; i++) {
+        rank = !fm->voice[i].on ? 0 : fm->voice[i].held ? 1 : 2;
+        if (rank < best_rank || (rank == best_rank && fm->voice[i].age < fm->voice[best].age)) {
+            best = i;
+            best_rank = rank;
+        }
+    }
+
+    return best;
+}
+
+
+/* fm_program
+ *
+ * 		DESCRIPTION: loads a voice's operators with its patch layer, keying
+ *		             it off first so the new note starts its attack
+ *		INPUTS: fm -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_program(fm_t* fm, uint32_t v) {
+
+    const fm_layer_t* l = fm->voice[v].layer;
+    uint32_t key = FM_REG_KEY + fm_chan_reg(v);
+    uint32_t mod = fm_op_reg(v);
+    uint32_t car = mod + FM_CAR_OFFSET;
+
+    fm_out(fm, key, fm->shadow[key] & ~FM_KEY_ON);
+
+    fm_out(fm, FM_REG_CHR + mod, l->mod.chr);
+    fm_out(fm, FM_REG_ATTACK + mod, l->mod.attack);
+    fm_out(fm, FM_REG_SUSTAIN + mod, l->mod.sustain);
+    fm_out(fm, FM_REG_WAVE + mod, l->mod.wave & FM_WAVE_MASK);
+    fm_out(fm, FM_REG_CHR + car, l->car.chr);
+    fm_out(fm, FM_REG_ATTACK + car, l->car.attack);
+    fm_out(fm, FM_REG_SUSTAIN + car, l->car.sustain);
+    fm_out(fm, FM_REG_WAVE + car, l->car.wave & FM_WAVE_MASK);
+
+    fm_level(fm, v);
+    fm_pan(fm, v);
+}
+
+
+/* fm_key_off
+ *
+ * 		DESCRIPTION: releases a voice, which rings out at its release rate
+ *		INPUTS: fm -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: fm -- the voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues a register write
+ */
+static void fm_key_off(fm_t* fm, uint32_t v) {
+
+    uint32_t key = FM_REG_KEY + fm_chan_reg(v);
+
+    fm->voice[v].on = 0;
+    fm->voice[v].held = 0;
+    fm->voice[v].age = fm->clock++;
+    fm_out(fm, key, fm->shadow[key] & ~FM_KEY_ON);
+}
+
+
+/* fm_pitch
+ *
+ * 		DESCRIPTION: sets a voice's F-number and block for its note and the
+ *		             channel's bend; the F-number at block 0 is A4's scaled
+ *		             by 2^(semitones / 12), halved into the highest block
+ *		             that keeps it in 10 bits
+ *		INPUTS: fm -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_pitch(fm_t* fm, uint32_t v) {
+
+    fm_voice_t* vc = &fm->voice[v];
+    uint32_t reg = fm_chan_reg(v);
+    int32_t pitch = vc->pitch;
+    uint64_t fnum;
+    uint32_t block = 0;
+
+    /* drums ignore the bend */
+    if (vc->chan != MIDI_DRUMS) pitch += fm->chan[vc->chan].bend;
+    if (pitch < 0) pitch = 0;
+    if (pitch > FM_MAX_NOTE << Q16_SHIFT) pitch = FM_MAX_NOTE << Q16_SHIFT;
+
+    fnum = ((uint64_t)FM_FNUM_A4 * fix_pow2((pitch - (FM_NOTE_A4 << Q16_SHIFT)) / SEMITONES))
+           >> Q16_SHIFT;
+    while (fnum >= (1 << (FM_FNUM_BITS + FNUM_FRAC_BITS)) && block < FM_MAX_BLOCK) {
+        fnum >>= 1;
+        block++;
+    }
+    fnum = (fnum + (1 << (FNUM_FRAC_BITS - 1))) >> FNUM_FRAC_BITS;
+    if (fnum >= (1 << FM_FNUM_BITS)) fnum = (1 << FM_FNUM_BITS) - 1;
+
+    fm_out(fm, FM_REG_FNUM + reg, fnum & FM_FNUM_LO);
+    fm_out(fm, FM_REG_KEY + reg, (vc->on ? FM_KEY_ON : 0) | (block << FM_BLOCK_SHIFT) |
+                                 (fnum >> 8));
+}
+
+
+/* fm_level
+ *
+ * 		DESCRIPTION: sets a voice's loudness from its velocity and the
+ *		             channel's volume and expression, as attenuation added
+ *		             to the patch's; in FM the carrier alone sets the
+ *		             loudness, and in additive mode both operators do
+ *		INPUTS: fm -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues register writes
+ */
+static void fm_level(fm_t* fm, uint32_t v) {
+
+    fm_voice_t* vc = &fm->voice[v];
+    const fm_layer_t* l = vc->layer;
+    fm_chan_t* ch = &fm->chan[vc->chan];
+    uint32_t mod = fm_op_reg(v);
+    uint32_t scale, atten, car_level, mod_level;
+    int32_t diff;
+
+    scale = vc->velocity * ch->volume * ch->expression;
+    diff = fix_log2(FM_FULL_SCALE) - fix_log2(scale);
+    if (!scale || diff >= FM_ATTEN_RANGE) atten = FM_MAX_ATTEN;
+    else atten = ((int64_t)diff * FM_ATTEN_PER_LOG2) >> FM_ATTEN_SHIFT;
+
+    car_level = l->car.level + atten;
+    if (car_level > FM_MAX_ATTEN) car_level = FM_MAX_ATTEN;
+    mod_level = l->mod.level;
+    if (l->feedback & FM_ADDITIVE) mod_level += atten;
+    if (mod_level > FM_MAX_ATTEN) mod_level = FM_MAX_ATTEN;
+
+    fm_out(fm, FM_REG_LEVEL + mod, (l->mod.ksl & FM_KSL_MASK) | mod_level);
+    fm_out(fm, FM_REG_LEVEL + mod + FM_CAR_OFFSET, (l->car.ksl & FM_KSL_MASK) | car_level);
+}
+
+
+/* fm_pan
+ *
+ * 		DESCRIPTION: sets a voice's feedback and connection, and which of
+ *		             the OPL3's outputs it goes to; the chip has no finer
+ *		             pan, so the middle third of the range plays on both
+ *		INPUTS: fm -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: queues a register write
+ */
+static void fm_pan(fm_t* fm, uint32_t v) {
+
+    uint32_t pan = fm->chan[fm->voice[v].chan].pan;
+    uint8_t out = 0;
+
+    if (pan <= FM_PAN_RIGHT) out |= FM_LEFT;
+    if (pan >= FM_PAN_LEFT) out |= FM_RIGHT;
+
+    fm_out(fm, FM_REG_FEEDBACK + fm_chan_reg(v),
+           (fm->voice[v].layer->feedback & FM_FEEDBACK_MASK) | out);
+}
+
+
+/* fm_out
+ *
+ * 		DESCRIPTION: queues a register write, unless the chip already holds
+ *		             the value
+ *		INPUTS: fm -- synthesizer state
+ *		        reg -- register, with FM_BANK set for the second bank
+ *		        val -- value
+ *		OUTPUTS: fm -- the queue
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: flushes the queue if it's full
+ */
+static void fm_out(fm_t* fm, uint32_t reg, uint8_t val) {
+
+    if (fm->shadow[reg] == val) return;
+    fm->shadow[reg] = val;
+
+    if (fm->nwrites == FM_MAX_WRITES) fm_flush(fm);
+    fm->writes[fm->nwrites++] = (reg << 8) | val;
+}
+
+
+/* fm_chan_reg
+ *
+ * 		DESCRIPTION: finds the channel register offset of a voice
+ *		INPUTS: v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: offset, with FM_BANK set for the second bank
+ *		SIDE EFFECTS: none
+ */
+static uint32_t fm_chan_reg(uint32_t v) {
+
+    return v < FM_BANK_VOICES ? v : FM_BANK + v - FM_BANK_VOICES;
+}
+
+
+/* fm_op_reg
+ *
+ * 		DESCRIPTION: finds the register offset of a voice's modulator; its
+ *		             carrier is FM_CAR_OFFSET past it
+ *		INPUTS: v -- voice
+ *		OUTPUTS: none
+ *		RETURN VALUE: offset, with FM_BANK set for the second bank
+ *		SIDE EFFECTS: none
+ */
+static uint32_t fm_op_reg(uint32_t v) {
+
+    return v < FM_BANK_VOICES ? op_offset[v] : FM_BANK + op_offset[v - FM_BANK_VOICES];
+}
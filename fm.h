@@ -0,0 +1,103 @@
+/* fm.h - OPL3 FM synthesizer definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _FM_H
+#define _FM_H
+
+#include <stdint.h>
+#include "midi.h"
+
+/* OPL3 mode has 18 two-operator voices over two register banks */
+#define FM_VOICES           18
+#define FM_BANK_VOICES      9
+#define FM_BANK             0x100
+#define FM_REGS             0x200
+
+/* General MIDI programs, then the drum kit from note 35 to 81, as laid
+ * out in a DMX GENMIDI bank */
+#define FM_PROGRAMS         128
+#define FM_DRUM_FIRST       35
+#define FM_DRUM_LAST        81
+#define FM_PATCHES          (FM_PROGRAMS + FM_DRUM_LAST - FM_DRUM_FIRST + 1)
+#define FM_BANK_FILE        "genmidi.op2"
+
+/* patch flags */
+#define FM_FIXED            0x1
+#define FM_DOUBLE           0x4
+
+/* register writes queued for the driver, each (register << 8) | value */
+#define FM_MAX_WRITES       512
+
+/* one operator's registers */
+typedef struct fm_op {
+    uint8_t chr;            /* 0x20: tremolo, vibrato, sustain, KSR, multiple */
+    uint8_t attack;         /* 0x60: attack and decay rates */
+    uint8_t sustain;        /* 0x80: sustain level and release rate */
+    uint8_t wave;           /* 0xE0 */
+    uint8_t ksl;            /* top bits of 0x40 */
+    uint8_t level;          /* attenuation, bottom bits of 0x40 */
+} fm_op_t;
+
+/* a two-operator voice of a patch */
+typedef struct fm_layer {
+    fm_op_t mod;
+    uint8_t feedback;       /* 0xC0: feedback and connection */
+    fm_op_t car;
+    int16_t offset;         /* notes added to the key played */
+} fm_layer_t;
+
+typedef struct fm_patch {
+    uint16_t flags;
+    uint8_t finetune;       /* the second layer's detune, 128 for none */
+    uint8_t note;           /* note of a fixed-pitch patch */
+    fm_layer_t layer[2];
+} fm_patch_t;
+
+typedef struct fm_chan {
+    uint32_t program;
+    uint32_t volume;
+    uint32_t expression;
+    uint32_t pan;
+    uint32_t sustain;       /* 1 while the pedal is down */
+    uint32_t rpn;           /* registered parameter selected, 0x3FFF for none */
+    int32_t bend;           /* Q16 semitones */
+    uint32_t bend_range;    /* semitones */
+} fm_chan_t;
+
+typedef struct fm_voice {
+    uint32_t on;            /* 1 while the key is held */
+    uint32_t held;          /* 1 if released while the pedal was down */
+    uint32_t chan;
+    uint32_t key;           /* note as played, for its note off */
+    uint32_t velocity;
+    int32_t pitch;          /* note sounded in Q16, before the bend */
+    uint32_t age;           /* when it was last keyed on or off */
+    const fm_layer_t* layer;
+} fm_voice_t;
+
+typedef struct fm {
+    fm_patch_t bank[FM_PATCHES];
+    fm_chan_t chan[MIDI_CHANNELS];
+    fm_voice_t voice[FM_VOICES];
+    uint32_t clock;
+    uint8_t shadow[FM_REGS];    /* what the chip holds, to skip rewrites */
+    uint32_t nwrites;
+    uint32_t writes[FM_MAX_WRITES];
+} fm_t;
+
+
+/* sets up the voices, with the bank file's patches if there is one */
+void fm_init(fm_t* fm, const uint8_t* bank_name);
+
+/* releases every voice and resets the controllers */
+void fm_reset(fm_t* fm);
+
+/* plays one MIDI event */
+void fm_event(fm_t* fm, const midi_event_t* ev);
+
+/* sends the queued register writes to the chip */
+int32_t fm_flush(fm_t* fm);
+
+
+#endif
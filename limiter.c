@@ -0,0 +1,142 @@
+/* limiter.c - Look-ahead brickwall limiter run on the mix bus before it
+ * is packed to 16 bits.
+ * Written by Soumithri Bala. */
+
+
+#include "limiter.h"
+#include "fixmath.h"
+
+
+#define DQ_MASK             (LIM_DQ_SIZE - 1)
+#define MS_PER_SEC          1000
+
+
+/* lim_init
+ *
+ * 		DESCRIPTION: sets the look-ahead and clears the limiter to unity gain
+ *		INPUTS: lim -- limiter state
+ *		        lookahead -- look-ahead in frames
+ *		        channels -- samples per frame
+ *		        rate -- sample rate in Hz
+ *		OUTPUTS: lim -- cleared state
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t lim_init(limiter_t* lim, uint32_t lookahead, uint32_t channels,
+                 uint32_t rate) {
+
+    uint32_t i;
+
+    if (lookahead < 2 || lookahead > LIM_MAX_LOOKAHEAD ||
+            !channels || channels > LIM_MAX_CHANNELS || !rate)
+        return -1;
+
+    lim->lookahead = lookahead;
+    lim->channels = channels;
+    lim->inv_lookahead = 0xFFFFFFFFU / lookahead + 1;
+    lim->release = LIM_UNITY / (rate * LIM_RELEASE_MS / MS_PER_SEC + 1);
+    if (!lim->release) lim->release = 1;
+    lim->n = 0;
+    lim->pos = 0;
+    lim->rel = LIM_UNITY;
+    lim->gain_sum = lookahead * LIM_UNITY;
+    lim->dq_head = 0;
+    lim->dq_tail = 0;
+
+    for (i = 0; i < lookahead; i++)
+        lim->gain_ring[i] = LIM_UNITY;
+    for (i = 0; i < lookahead * channels; i++)
+        lim->delay[i] = 0;
+
+    return 0;
+}
+
+
+/* lim_process
+ *
+ * 		DESCRIPTION: limits frames to the threshold and packs them to 16
+ *		             bits. The target gain comes from a sliding max of the
+ *		             peaks over lookahead + 1 frames, kept in a monotonic
+ *		             deque. That gain falls instantly, recovers at the
+ *		             release rate, and is then averaged over lookahead
+ *		             frames. Output is delayed by lookahead frames, so every
+ *		             gain averaged into a peak's frame already covers that
+ *		             peak and nothing gets past the threshold. The output
+ *		             is metered as it's packed, as meter_pack does.
+ *		INPUTS: lim -- limiter state
+ *		        bus -- interleaved 32-bit mix bus
+ *		        out -- interleaved 16-bit output
+ *		        frames -- number of frames
+ *		        meter -- meter for the output, 0 for none
+ *		OUTPUTS: out -- limited samples, lookahead frames behind bus
+ *		         meter -- their levels added
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void lim_process(limiter_t* lim, const int32_t* bus, int16_t* out,
+                 uint32_t frames, meter_t* meter) {
+
+    int32_t hi[LIM_MAX_CHANNELS] = {0, 0};
+    int32_t lo[LIM_MAX_CHANNELS] = {0, 0};
+    uint64_t sum[LIM_MAX_CHANNELS] = {0, 0};
+    uint32_t i, c, peak, mag, target, gain;
+    int32_t step, v;
+    int32_t* delay;
+
+    for (i = 0; i < frames; i++) {
+
+        /* peak of this frame across channels */
+        peak = 0;
+        for (c = 0; c < lim->channels; c++) {
+            mag = bus[c] < 0 ? 0u - (uint32_t)bus[c] : (uint32_t)bus[c];
+            if (mag > peak) peak = mag;
+        }
+
+        /* push it, dropping smaller peaks it outlasts, then drop the front
+         * once it leaves the window */
+        while (lim->dq_tail != lim->dq_head &&
+                lim->dq_peak[(lim->dq_tail - 1) & DQ_MASK] <= peak)
+            lim->dq_tail--;
+        lim->dq_peak[lim->dq_tail & DQ_MASK] = peak;
+        lim->dq_frame[lim->dq_tail & DQ_MASK] = lim->n;
+        lim->dq_tail++;
+        if (lim->n - lim->dq_frame[lim->dq_head & DQ_MASK] > lim->lookahead)
+            lim->dq_head++;
+
+        /* gain that brings the loudest peak in the window to threshold */
+        peak = lim->dq_peak[lim->dq_head & DQ_MASK];
+        target = peak > LIM_THRESHOLD ? ((uint32_t)LIM_THRESHOLD << 16) / peak : LIM_UNITY;
+
+        /* attack at once, release slowly; the step is at least 1, or it
+         * would round to nothing short of the target and never get there */
+        if ((int32_t)target < lim->rel) {
+            lim->rel = target;
+        } else if ((int32_t)target > lim->rel) {
+            step = (int32_t)(((int64_t)(target - lim->rel) * lim->release) >> 16);
+            lim->rel += step ? step : 1;
+        }
+
+        /* running mean smooths the attack over the look-ahead */
+        lim->gain_sum += lim->rel - lim->gain_ring[lim->pos];
+        lim->gain_ring[lim->pos] = lim->rel;
+        gain = (uint32_t)(((uint64_t)lim->gain_sum * lim->inv_lookahead) >> 32);
+
+        /* swap the frame through the delay line and apply the gain */
+        delay = &lim->delay[lim->pos * lim->channels];
+        for (c = 0; c < lim->channels; c++) {
+            v = fix_sat16((int32_t)(((int64_t)delay[c] * gain) >> 16));
+            *out++ = v;
+            delay[c] = *bus++;
+            if (meter) {
+                hi[c] = v > hi[c] ? v : hi[c];
+                lo[c] = v < lo[c] ? v : lo[c];
+                sum[c] += (uint32_t)(v * v);
+            }
+        }
+
+        if (++lim->pos == lim->lookahead) lim->pos = 0;
+        lim->n++;
+    }
+
+    if (meter) meter_add(meter, hi, lo, sum, frames);
+}
@@ -0,0 +1,48 @@
+/* limiter.h - Look-ahead peak limiter definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _LIMITER_H
+#define _LIMITER_H
+
+#include <stdint.h>
+
+#include "meter.h"
+
+#define LIM_MAX_LOOKAHEAD   2048
+#define LIM_DQ_SIZE         (2 * LIM_MAX_LOOKAHEAD)
+#define LIM_MAX_CHANNELS    2
+#define LIM_THRESHOLD       31650
+#define LIM_RELEASE_MS      80
+#define LIM_UNITY           (1 << 16)
+
+/* limiter on the 32-bit mix bus; gains are Q16 */
+typedef struct limiter {
+    uint32_t lookahead;         /* frames, also the delay through the limiter */
+    uint32_t channels;
+    uint32_t inv_lookahead;     /* 2^32 / lookahead rounded up, for the
+                                 * running mean, so unity comes out whole */
+    uint32_t release;           /* Q16 step towards unity per frame */
+    uint32_t n;                 /* frames seen */
+    uint32_t pos;               /* slot in the rings for frame n */
+    int32_t rel;                /* released gain */
+    uint32_t gain_sum;          /* sum of the last lookahead released gains */
+    uint32_t dq_head, dq_tail;  /* sliding-max deque, as ring indices */
+    uint32_t dq_peak[LIM_DQ_SIZE];
+    uint32_t dq_frame[LIM_DQ_SIZE];
+    int32_t gain_ring[LIM_MAX_LOOKAHEAD];
+    int32_t delay[LIM_MAX_LOOKAHEAD * LIM_MAX_CHANNELS];
+} limiter_t;
+
+
+/* sets the look-ahead and clears the limiter */
+int32_t lim_init(limiter_t* lim, uint32_t lookahead, uint32_t channels,
+                 uint32_t rate);
+
+/* limits frames from the mix bus and packs them to 16 bits, metering
+ * them on the way if given a meter */
+void lim_process(limiter_t* lim, const int32_t* bus, int16_t* out,
+                 uint32_t frames, meter_t* meter);
+
+
+#endif
@@ -0,0 +1,392 @@
+/* loudness.c - Gated integrated loudness (EBU R128 / BS.1770) of a WAV
+ * file in one streaming pass, and a per-file cache of the results.
+ * Written by Soumithri Bala. */
+
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "loudness.h"
+#include "fixmath.h"
+#include "wav.h"
+
+
+/* results of earlier scans, by file name */
+static loud_entry_t cache[LOUD_CACHE_MAX];
+static int32_t ncache = 0;
+
+
+/* local function definitions */
+static void loud_design(eq_coef_t* coef, uint32_t rate, uint32_t mhz, int32_t shelf);
+static int32_t loud_level(uint64_t energy, uint64_t frames, int32_t shift);
+static int32_t loud_bin(int32_t level);
+static void loud_cache_add(const uint8_t* fname, int32_t lufs);
+
+
+/* loud_init
+ *
+ * 		DESCRIPTION: clears a scan and designs the two K-weighting stages
+ *		             for its sample rate
+ *		INPUTS: loud -- scan state
+ *		        rate -- sample rate in Hz
+ *		        channels -- samples per frame
+ *		OUTPUTS: loud -- empty scan
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t loud_init(loudness_t* loud, uint32_t rate, uint32_t channels) {
+
+    int32_t i, c;
+
+    if (!channels || channels > LOUD_MAX_CHANNELS || rate < 2 * LOUD_SHELF_MHZ / 1000)
+        return -1;
+
+    loud->rate = rate;
+    loud->channels = channels;
+    loud->hop = (rate + 5) / 10;
+    loud->hop_pos = 0;
+    loud->nsub = 0;
+    loud->acc = 0;
+
+    for (i = 0; i < 2; i++) {
+        for (c = 0; c < LOUD_MAX_CHANNELS; c++) {
+            loud->s1[i][c] = 0;
+            loud->s2[i][c] = 0;
+        }
+    }
+    for (i = 0; i < LOUD_BINS; i++) {
+        loud->count[i] = 0;
+        loud->energy[i] = 0;
+    }
+
+    loud_design(&loud->coef[0], rate, LOUD_SHELF_MHZ, 1);
+    loud_design(&loud->coef[1], rate, LOUD_HPF_MHZ, 0);
+
+    return 0;
+}
+
+
+/* loud_feed
+ *
+ * 		DESCRIPTION: K-weights frames, both channels side by side, and sums
+ *		             their energy in 100 ms sub-blocks; every sub-block
+ *		             closes a 400 ms block overlapping the last by 75%,
+ *		             which goes into the histogram if it passes the
+ *		             absolute gate
+ *		INPUTS: loud -- scan state
+ *		        pcm -- interleaved 16-bit frames
+ *		        frames -- number of frames
+ *		OUTPUTS: loud -- updated scan
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void loud_feed(loudness_t* loud, const int16_t* pcm, uint32_t frames) {
+
+    const eq_coef_t* coef = loud->coef;
+    uint64_t block;
+    int32_t x, y, level, bin, b;
+    uint32_t i, c;
+
+    for (i = 0; i < frames; i++) {
+        for (c = 0; c < loud->channels; c++) {
+            x = *pcm++ * (1 << EQ_GUARD_SHIFT);
+            for (b = 0; b < 2; b++) {
+                y = (int32_t)(((int64_t)coef[b].b0 * x + loud->s1[b][c]) >> EQ_COEF_SHIFT);
+                loud->s1[b][c] = (int64_t)coef[b].b1 * x - (int64_t)coef[b].a1 * y + loud->s2[b][c];
+                loud->s2[b][c] = (int64_t)coef[b].b2 * x - (int64_t)coef[b].a2 * y;
+                x = y;
+            }
+            /* surround weights are all 1 for mono and stereo */
+            x >>= LOUD_SAMPLE_SHIFT;
+            loud->acc += (int64_t)x * x;
+        }
+
+        if (++loud->hop_pos < loud->hop) continue;
+
+        /* sub-block done */
+        loud->sub[loud->nsub % LOUD_SUBBLOCKS] = loud->acc;
+        loud->acc = 0;
+        loud->hop_pos = 0;
+        if (++loud->nsub < LOUD_SUBBLOCKS) continue;
+
+        block = 0;
+        for (b = 0; b < LOUD_SUBBLOCKS; b++) block += loud->sub[b];
+
+        level = loud_level(block, LOUD_SUBBLOCKS * loud->hop, 0);
+        if (level <= LOUD_ABS_GATE * (1 << Q16_SHIFT)) continue;
+
+        bin = loud_bin(level);
+        loud->count[bin]++;
+        loud->energy[bin] += block >> LOUD_ENERGY_SHIFT;
+    }
+}
+
+
+/* loud_result
+ *
+ * 		DESCRIPTION: integrated loudness over the blocks that pass both
+ *		             gates; the relative gate is placed from the mean of
+ *		             everything above the absolute one, and falls on a
+ *		             0.1 LU bin edge
+ *		INPUTS: loud -- scan state
+ *		OUTPUTS: none
+ *		RETURN VALUE: loudness in tenths of LUFS, LOUD_SILENT if no block
+ *		              passed the absolute gate
+ *		SIDE EFFECTS: none
+ */
+int32_t loud_result(const loudness_t* loud) {
+
+    uint64_t blocks = 0, energy = 0;
+    int32_t level, bin, i;
+
+    for (i = 0; i < LOUD_BINS; i++) {
+        blocks += loud->count[i];
+        energy += loud->energy[i];
+    }
+    if (!blocks) return LOUD_SILENT;
+
+    level = loud_level(energy, blocks * LOUD_SUBBLOCKS * loud->hop, LOUD_ENERGY_SHIFT) -
+            (LOUD_REL_GATE << Q16_SHIFT);
+    bin = level > LOUD_ABS_GATE * (1 << Q16_SHIFT) ? loud_bin(level) : 0;
+
+    blocks = 0;
+    energy = 0;
+    for (i = bin; i < LOUD_BINS; i++) {
+        blocks += loud->count[i];
+        energy += loud->energy[i];
+    }
+
+    level = loud_level(energy, blocks * LOUD_SUBBLOCKS * loud->hop, LOUD_ENERGY_SHIFT);
+
+    return (int32_t)(((int64_t)level * 10 + (1 << (Q16_SHIFT - 1))) >> Q16_SHIFT);
+}
+
+
+/* loud_scan
+ *
+ * 		DESCRIPTION: reads a WAV file through once and measures it
+ *		INPUTS: loud -- scan state to use
+ *		        fname -- name of the file
+ *		OUTPUTS: lufs -- loudness in tenths of LUFS
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: opens and closes the file
+ */
+int32_t loud_scan(loudness_t* loud, const uint8_t* fname, int32_t* lufs) {
+
+    wav_t wav;
+    int8_t buf[SCRATCH_SIZE];
+    int32_t n;
+
+    if (-1 == wav_open(&wav, fname, 0)) return -1;
+
+    if (wav.bits != 16 || -1 == loud_init(loud, wav.sample_rate, wav.nchannels)) {
+        wav_close(&wav);
+        return -1;
+    }
+
+    while ((n = wav_fill(&wav, buf, sizeof(buf) - sizeof(buf) % wav.block_align)) > 0)
+        loud_feed(loud, (int16_t*)buf, n / wav.block_align);
+
+    wav_close(&wav);
+    *lufs = loud_result(loud);
+
+    return 0;
+}
+
+
+/* loud_cache_load
+ *
+ * 		DESCRIPTION: reads the cache file, one "<tenths of LUFS> <name>"
+ *		             line per file, as printed by the player's scan mode.
+ *		             The filesystem is read-only, so the file is put in
+ *		             the image when it is built.
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: number of entries loaded, -1 if there is no cache file
+ *		SIDE EFFECTS: adds the entries to the cache
+ */
+int32_t loud_cache_load(void) {
+
+    static uint8_t text[LOUD_CACHE_TEXT + 1];
+    uint8_t* p = text;
+    uint8_t* name;
+    int32_t fd, len, lufs, neg, found = 0;
+
+    if (-1 == (fd = ece391_open((uint8_t*)LOUD_CACHE_FILE))) return -1;
+    len = ece391_read(fd, text, LOUD_CACHE_TEXT);
+    ece391_close(fd);
+    if (len < 0) len = 0;
+    text[len] = '\0';
+
+    while (*p) {
+        neg = (*p == '-');
+        if (neg) p++;
+        for (lufs = 0; *p >= '0' && *p <= '9'; p++) lufs = lufs * 10 + (*p - '0');
+        if (neg) lufs = -lufs;
+
+        while (*p == ' ') p++;
+        name = p;
+        while (*p && *p != '\n') p++;
+        if (*p) *p++ = '\0';
+
+        if (*name) {
+            loud_cache_add(name, lufs);
+            found++;
+        }
+    }
+
+    return found;
+}
+
+
+/* loud_lookup
+ *
+ * 		DESCRIPTION: finds a file's loudness in the cache, and scans it once
+ *		             if it isn't there
+ *		INPUTS: loud -- scan state to use on a miss
+ *		        fname -- name of the file
+ *		OUTPUTS: lufs -- loudness in tenths of LUFS
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: may read the whole file and add it to the cache
+ */
+int32_t loud_lookup(loudness_t* loud, const uint8_t* fname, int32_t* lufs) {
+
+    int32_t i;
+
+    for (i = 0; i < ncache; i++) {
+        if (!ece391_strncmp(cache[i].name, fname, LOUD_NAME_LEN + 1)) {
+            *lufs = cache[i].lufs;
+            return 0;
+        }
+    }
+
+    if (-1 == loud_scan(loud, fname, lufs)) return -1;
+    loud_cache_add(fname, *lufs);
+
+    return 0;
+}
+
+
+/* loud_gain
+ *
+ * 		DESCRIPTION: gain that brings a measured loudness to the target,
+ *		             held within LOUD_MAX_GAIN either way; silence is left
+ *		             alone
+ *		INPUTS: lufs -- loudness in tenths of LUFS
+ *		        target -- wanted loudness in tenths of LUFS
+ *		OUTPUTS: none
+ *		RETURN VALUE: gain in tenths of a dB
+ *		SIDE EFFECTS: none
+ */
+int32_t loud_gain(int32_t lufs, int32_t target) {
+
+    int32_t gain = target - lufs;
+
+    if (lufs <= LOUD_SILENT) return 0;
+    if (gain > LOUD_MAX_GAIN) gain = LOUD_MAX_GAIN;
+    if (gain < -LOUD_MAX_GAIN) gain = -LOUD_MAX_GAIN;
+
+    return gain;
+}
+
+
+/* loud_design
+ *
+ * 		DESCRIPTION: computes one K-weighting stage by the bilinear
+ *		             transform BS.1770 specifies, in Q28 with 64-bit
+ *		             intermediates, so any sample rate gets exact filters
+ *		INPUTS: rate -- sample rate in Hz
+ *		        mhz -- corner frequency in mHz
+ *		        shelf -- 1 for the high shelf, 0 for the high-pass
+ *		OUTPUTS: coef -- normalized coefficients in Q27
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void loud_design(eq_coef_t* coef, uint32_t rate, uint32_t mhz, int32_t shelf) {
+
+    const int64_t one = (int64_t)1 << LOUD_DESIGN_SHIFT;
+    int64_t k, k2, kq, a0, b0, b1, b2;
+    int32_t sin_val, cos_val;
+
+    /* K = tan(pi f / fs), and pi f / fs is f / 2fs of a turn */
+    fix_sincos((uint32_t)fix_qdiv(mhz, (int64_t)rate * 1000, 31), &sin_val, &cos_val);
+    k = fix_qdiv(sin_val, cos_val, LOUD_DESIGN_SHIFT);
+    k2 = (k * k) >> LOUD_DESIGN_SHIFT;
+    kq = (k * (shelf ? LOUD_SHELF_INVQ : LOUD_HPF_INVQ)) >> LOUD_DESIGN_SHIFT;
+    a0 = one + kq + k2;
+
+    if (shelf) {
+        b0 = LOUD_SHELF_VH + ((LOUD_SHELF_VB * kq) >> LOUD_DESIGN_SHIFT) + k2;
+        b1 = 2 * (k2 - LOUD_SHELF_VH);
+        b2 = LOUD_SHELF_VH - ((LOUD_SHELF_VB * kq) >> LOUD_DESIGN_SHIFT) + k2;
+        coef->b0 = (int32_t)fix_qdiv(b0, a0, EQ_COEF_SHIFT);
+        coef->b1 = (int32_t)fix_qdiv(b1, a0, EQ_COEF_SHIFT);
+        coef->b2 = (int32_t)fix_qdiv(b2, a0, EQ_COEF_SHIFT);
+    } else {
+        /* the high-pass numerator is left unnormalized, as in the standard */
+        coef->b0 = 1 << EQ_COEF_SHIFT;
+        coef->b1 = -2 * (1 << EQ_COEF_SHIFT);
+        coef->b2 = 1 << EQ_COEF_SHIFT;
+    }
+
+    coef->a1 = (int32_t)fix_qdiv(2 * (k2 - one), a0, EQ_COEF_SHIFT);
+    coef->a2 = (int32_t)fix_qdiv(one - kq + k2, a0, EQ_COEF_SHIFT);
+}
+
+
+/* loud_level
+ *
+ * 		DESCRIPTION: loudness of a mean square, -0.691 + 10 log10(z), taken
+ *		             through log2 so there's no division
+ *		INPUTS: energy -- summed squares of K-weighted samples
+ *		        frames -- number of frames summed
+ *		        shift -- bits the energy was scaled down by
+ *		OUTPUTS: none
+ *		RETURN VALUE: loudness in Q16 LUFS
+ *		SIDE EFFECTS: none
+ */
+static int32_t loud_level(uint64_t energy, uint64_t frames, int32_t shift) {
+
+    int32_t lg = fix_log2(energy) - fix_log2(frames) +
+                 (shift - LOUD_FS_LOG2) * (1 << Q16_SHIFT);
+
+    return (int32_t)(((int64_t)lg * LOUD_TEN_LOG10_2) >> Q16_SHIFT) - LOUD_K_OFFSET;
+}
+
+
+/* loud_bin
+ *
+ * 		DESCRIPTION: histogram bin of a block above the absolute gate
+ *		INPUTS: level -- loudness in Q16 LUFS
+ *		OUTPUTS: none
+ *		RETURN VALUE: bin index
+ *		SIDE EFFECTS: none
+ */
+static int32_t loud_bin(int32_t level) {
+
+    int32_t bin = (int32_t)((((int64_t)level - (LOUD_ABS_GATE * (1 << Q16_SHIFT))) * 10) >> Q16_SHIFT);
+
+    return bin < LOUD_BINS ? bin : LOUD_BINS - 1;
+}
+
+
+/* loud_cache_add
+ *
+ * 		DESCRIPTION: remembers a file's loudness, dropping it if the cache
+ *		             is full
+ *		INPUTS: fname -- name of the file
+ *		        lufs -- loudness in tenths of LUFS
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: adds to the cache
+ */
+static void loud_cache_add(const uint8_t* fname, int32_t lufs) {
+
+    int32_t i;
+
+    if (ncache >= LOUD_CACHE_MAX) return;
+
+    for (i = 0; i < LOUD_NAME_LEN && fname[i]; i++) cache[ncache].name[i] = fname[i];
+    cache[ncache].name[i] = '\0';
+    cache[ncache].lufs = lufs;
+    ncache++;
+}
@@ -0,0 +1,92 @@
+/* loudness.h - Integrated loudness scanner definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _LOUDNESS_H
+#define _LOUDNESS_H
+
+#include <stdint.h>
+
+#include "eq.h"
+
+#define LOUD_MAX_CHANNELS   2
+#define LOUD_SUBBLOCKS      4
+#define LOUD_ENERGY_SHIFT   16
+#define LOUD_SAMPLE_SHIFT   4
+#define LOUD_FS_LOG2        (2 * (15 + LOUD_SAMPLE_SHIFT))
+
+/* BS.1770 K-weighting: corners in mHz, gains and 1/Q in Q28 */
+#define LOUD_DESIGN_SHIFT   28
+#define LOUD_SHELF_MHZ      1681974
+#define LOUD_SHELF_VH       425433879
+#define LOUD_SHELF_VB       337885327
+#define LOUD_SHELF_INVQ     379588314
+#define LOUD_HPF_MHZ        38135
+#define LOUD_HPF_INVQ       536519988
+
+/* 10 log10(2) and the -0.691 dB K-weighting offset, in Q16 */
+#define LOUD_TEN_LOG10_2    197283
+#define LOUD_K_OFFSET       45285
+
+/* block loudness histogram from the absolute gate up, in 0.1 LU bins */
+#define LOUD_ABS_GATE       (-70)
+#define LOUD_REL_GATE       10
+#define LOUD_TOP            5
+#define LOUD_BINS           ((LOUD_TOP - LOUD_ABS_GATE) * 10)
+
+/* ReplayGain 2.0 reference level, and the most gain it may add or take */
+#define LOUD_TARGET         (-180)
+#define LOUD_MAX_GAIN       200
+#define LOUD_SILENT         (LOUD_ABS_GATE * 10)
+
+#define LOUD_CACHE_FILE     "loudness.cache"
+#define LOUD_CACHE_MAX      64
+#define LOUD_NAME_LEN       32
+#define LOUD_CACHE_TEXT     (LOUD_CACHE_MAX * (LOUD_NAME_LEN + 8))
+
+/* one streaming scan; holds nothing global, so scans can run side by side */
+typedef struct loudness {
+    uint32_t rate;
+    uint32_t channels;
+    uint32_t hop;               /* frames per 100 ms sub-block */
+    uint32_t hop_pos;           /* frames into the current sub-block */
+    uint32_t nsub;              /* sub-blocks finished */
+    uint64_t acc;               /* energy of the current sub-block */
+    uint64_t sub[LOUD_SUBBLOCKS];
+    eq_coef_t coef[2];          /* K-weighting: high shelf then high-pass */
+    int64_t s1[2][LOUD_MAX_CHANNELS];
+    int64_t s2[2][LOUD_MAX_CHANNELS];
+    uint32_t count[LOUD_BINS];  /* 400 ms blocks per bin */
+    uint64_t energy[LOUD_BINS]; /* their summed energy */
+} loudness_t;
+
+/* a cached result */
+typedef struct loud_entry {
+    uint8_t name[LOUD_NAME_LEN + 1];
+    int32_t lufs;               /* tenths of LUFS */
+} loud_entry_t;
+
+
+/* clears a scan and designs the K-weighting for its rate */
+int32_t loud_init(loudness_t* loud, uint32_t rate, uint32_t channels);
+
+/* adds interleaved 16-bit frames to a scan */
+void loud_feed(loudness_t* loud, const int16_t* pcm, uint32_t frames);
+
+/* gated integrated loudness of a scan, in tenths of LUFS */
+int32_t loud_result(const loudness_t* loud);
+
+/* scans a whole WAV file in one pass */
+int32_t loud_scan(loudness_t* loud, const uint8_t* fname, int32_t* lufs);
+
+/* loads the cache file of earlier scans */
+int32_t loud_cache_load(void);
+
+/* finds a file's loudness, scanning and caching it if it isn't known */
+int32_t loud_lookup(loudness_t* loud, const uint8_t* fname, int32_t* lufs);
+
+/* gain in tenths of a dB that brings a loudness to the target */
+int32_t loud_gain(int32_t lufs, int32_t target);
+
+
+#endif
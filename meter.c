@@ -0,0 +1,279 @@
+/* meter.c - Peak and RMS levels of each period, taken in the same loop
+ * that writes it to the buffer.
+ * Written by Soumithri Bala. */
+
+
+#include "meter.h"
+#include "fixmath.h"
+
+
+/* local function definitions */
+static void meter_fold(meter_t* meter, const int32_t* hi, const int32_t* lo,
+                       uint32_t frames);
+
+
+/* meter_start
+ *
+ * 		DESCRIPTION: clears the levels for a new period
+ *		INPUTS: meter -- meter state
+ *		        channels -- samples per frame
+ *		OUTPUTS: meter -- empty meter
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void meter_start(meter_t* meter, uint32_t channels) {
+
+    int32_t c;
+
+    meter->channels = channels < METER_MAX_CHANNELS ? channels : METER_MAX_CHANNELS;
+    meter->frames = 0;
+
+    for (c = 0; c < METER_MAX_CHANNELS; c++) {
+        meter->peak[c] = 0;
+        meter->sum[c] = 0;
+    }
+}
+
+
+/* meter_pack
+ *
+ * 		DESCRIPTION: saturates the mix bus to 16 bits and tracks each
+ *		             channel's extremes and sum of squares in the same
+ *		             pass. Extremes are kept as a running max and min,
+ *		             which compile to conditional moves, and folded into
+ *		             a peak once at the end.
+ *		INPUTS: meter -- meter state
+ *		        bus -- interleaved 32-bit mix bus
+ *		        frames -- number of frames
+ *		OUTPUTS: out -- packed 16-bit frames
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void meter_pack(meter_t* meter, const int32_t* bus, int16_t* out, uint32_t frames) {
+
+    int32_t hi[METER_MAX_CHANNELS] = {0, 0};
+    int32_t lo[METER_MAX_CHANNELS] = {0, 0};
+    uint64_t sum0 = meter->sum[0], sum1 = meter->sum[1];
+    uint32_t i;
+    int32_t v, w;
+
+    if (meter->channels == 1) {
+        for (i = 0; i < frames; i++) {
+            v = *bus++;
+            if (v > S16_MAX) v = S16_MAX;
+            if (v < S16_MIN) v = S16_MIN;
+            *out++ = v;
+            hi[0] = v > hi[0] ? v : hi[0];
+            lo[0] = v < lo[0] ? v : lo[0];
+            sum0 += (uint32_t)(v * v);
+        }
+    } else {
+        for (i = 0; i < frames; i++) {
+            v = *bus++;
+            w = *bus++;
+            if (v > S16_MAX) v = S16_MAX;
+            if (v < S16_MIN) v = S16_MIN;
+            if (w > S16_MAX) w = S16_MAX;
+            if (w < S16_MIN) w = S16_MIN;
+            *out++ = v;
+            *out++ = w;
+            hi[0] = v > hi[0] ? v : hi[0];
+            lo[0] = v < lo[0] ? v : lo[0];
+            hi[1] = w > hi[1] ? w : hi[1];
+            lo[1] = w < lo[1] ? w : lo[1];
+            sum0 += (uint32_t)(v * v);
+            sum1 += (uint32_t)(w * w);
+        }
+    }
+
+    meter->sum[0] = sum0;
+    meter->sum[1] = sum1;
+    meter_fold(meter, hi, lo, frames);
+}
+
+
+/* meter_scan
+ *
+ * 		DESCRIPTION: tracks extremes and sum of squares of frames the
+ *		             player didn't copy itself, read straight into the
+ *		             buffer
+ *		INPUTS: meter -- meter state
+ *		        pcm -- interleaved 16-bit frames
+ *		        frames -- number of frames
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void meter_scan(meter_t* meter, const int16_t* pcm, uint32_t frames) {
+
+    int32_t hi[METER_MAX_CHANNELS] = {0, 0};
+    int32_t lo[METER_MAX_CHANNELS] = {0, 0};
+    uint64_t sum0 = meter->sum[0], sum1 = meter->sum[1];
+    uint32_t i;
+    int32_t v, w;
+
+    if (meter->channels == 1) {
+        for (i = 0; i < frames; i++) {
+            v = *pcm++;
+            hi[0] = v > hi[0] ? v : hi[0];
+            lo[0] = v < lo[0] ? v : lo[0];
+            sum0 += (uint32_t)(v * v);
+        }
+    } else {
+        for (i = 0; i < frames; i++) {
+            v = *pcm++;
+            w = *pcm++;
+            hi[0] = v > hi[0] ? v : hi[0];
+            lo[0] = v < lo[0] ? v : lo[0];
+            hi[1] = w > hi[1] ? w : hi[1];
+            lo[1] = w < lo[1] ? w : lo[1];
+            sum0 += (uint32_t)(v * v);
+            sum1 += (uint32_t)(w * w);
+        }
+    }
+
+    meter->sum[0] = sum0;
+    meter->sum[1] = sum1;
+    meter_fold(meter, hi, lo, frames);
+}
+
+
+/* meter_add
+ *
+ * 		DESCRIPTION: adds a run of frames metered by another loop
+ *		INPUTS: meter -- meter state
+ *		        hi -- largest sample per channel
+ *		        lo -- smallest sample per channel
+ *		        sum -- sum of squares per channel
+ *		        frames -- number of frames in the run
+ *		OUTPUTS: meter -- updated levels
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void meter_add(meter_t* meter, const int32_t* hi, const int32_t* lo,
+               const uint64_t* sum, uint32_t frames) {
+
+    int32_t c;
+
+    for (c = 0; c < METER_MAX_CHANNELS; c++) meter->sum[c] += sum[c];
+    meter_fold(meter, hi, lo, frames);
+}
+
+
+/* meter_quiet
+ *
+ * 		DESCRIPTION: checks the peaks metered so far against the silence
+ *		             level, so a metered period needs no pass of its own to
+ *		             find silence
+ *		INPUTS: meter -- meter state
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every sample was within METER_SILENCE, else 0
+ *		SIDE EFFECTS: none
+ */
+int32_t meter_quiet(const meter_t* meter) {
+
+    int32_t c;
+
+    for (c = 0; c < METER_MAX_CHANNELS; c++) {
+        if (meter->peak[c] > METER_SILENCE) return 0;
+    }
+
+    return 1;
+}
+
+
+/* meter_silent
+ *
+ * 		DESCRIPTION: checks for silence, with one unsigned compare per
+ *		             sample; stops at the first audible one, so music costs
+ *		             next to nothing and only silence is read through
+ *		INPUTS: pcm -- 16-bit samples
+ *		        samples -- number of samples
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every sample is within METER_SILENCE, else 0
+ *		SIDE EFFECTS: none
+ */
+int32_t meter_silent(const int16_t* pcm, uint32_t samples) {
+
+    uint32_t i;
+
+    /* exact zeros four samples at a time, then the level sample by sample */
+    for (i = 0; i + 3 < samples &&
+                !(pcm[i] | pcm[i + 1] | pcm[i + 2] | pcm[i + 3]); i += 4);
+
+    for (; i < samples; i++) {
+        if ((uint32_t)(pcm[i] + METER_SILENCE) > 2 * METER_SILENCE) return 0;
+    }
+
+    return 1;
+}
+
+
+/* meter_silent_bus
+ *
+ * 		DESCRIPTION: checks the mix bus for silence, stopping at the first
+ *		             audible sample
+ *		INPUTS: bus -- 32-bit mix bus samples
+ *		        samples -- number of samples
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if every sample is within METER_SILENCE, else 0
+ *		SIDE EFFECTS: none
+ */
+int32_t meter_silent_bus(const int32_t* bus, uint32_t samples) {
+
+    uint32_t i;
+
+    for (i = 0; i < samples; i++) {
+        if ((uint32_t)(bus[i] + METER_SILENCE) > 2 * METER_SILENCE) return 0;
+    }
+
+    return 1;
+}
+
+
+/* meter_finish
+ *
+ * 		DESCRIPTION: turns the running values into the period's levels
+ *		INPUTS: meter -- meter state
+ *		OUTPUTS: stats -- peak and RMS per channel, on the 16-bit scale
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void meter_finish(const meter_t* meter, meter_stats_t* stats) {
+
+    uint32_t c;
+
+    stats->period = 0;
+    stats->channels = meter->channels;
+
+    for (c = 0; c < METER_MAX_CHANNELS; c++) {
+        stats->peak[c] = meter->peak[c];
+        stats->rms[c] = meter->frames ?
+                fix_sqrt(fix_qdiv(meter->sum[c], meter->frames, 0)) : 0;
+    }
+}
+
+
+/* meter_fold
+ *
+ * 		DESCRIPTION: folds one run's extremes into the period's peaks
+ *		INPUTS: meter -- meter state
+ *		        hi -- largest sample per channel
+ *		        lo -- smallest sample per channel
+ *		        frames -- number of frames in the run
+ *		OUTPUTS: meter -- updated peaks and frame count
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void meter_fold(meter_t* meter, const int32_t* hi, const int32_t* lo,
+                       uint32_t frames) {
+
+    int32_t c;
+
+    for (c = 0; c < METER_MAX_CHANNELS; c++) {
+        if ((uint32_t)hi[c] > meter->peak[c]) meter->peak[c] = hi[c];
+        if ((uint32_t)-lo[c] > meter->peak[c]) meter->peak[c] = -lo[c];
+    }
+
+    meter->frames += frames;
+}
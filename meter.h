@@ -0,0 +1,58 @@
+/* meter.h - Peak and RMS level meter definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _METER_H
+#define _METER_H
+
+#include <stdint.h>
+
+#define METER_MAX_CHANNELS  2
+/* largest magnitude still counted as silence, about -72 dBFS */
+#define METER_SILENCE       8
+
+/* levels of one period; laid out as the driver's sb16_meter_t */
+typedef struct meter_stats {
+    uint32_t period;            /* stamped by the driver when it plays */
+    uint32_t channels;
+    uint16_t peak[METER_MAX_CHANNELS];
+    uint16_t rms[METER_MAX_CHANNELS];
+} meter_stats_t;
+
+/* running levels of the period being filled */
+typedef struct meter {
+    uint32_t channels;
+    uint32_t frames;
+    uint32_t peak[METER_MAX_CHANNELS];
+    uint64_t sum[METER_MAX_CHANNELS];   /* sum of squares */
+} meter_t;
+
+
+/* starts a period */
+void meter_start(meter_t* meter, uint32_t channels);
+
+/* packs frames from the mix bus to 16 bits, metering them on the way */
+void meter_pack(meter_t* meter, const int32_t* bus, int16_t* out, uint32_t frames);
+
+/* meters frames that were written without passing through the player */
+void meter_scan(meter_t* meter, const int16_t* pcm, uint32_t frames);
+
+/* adds a run's extremes and sums of squares, taken by a loop that wrote
+ * the samples for some other reason */
+void meter_add(meter_t* meter, const int32_t* hi, const int32_t* lo,
+               const uint64_t* sum, uint32_t frames);
+
+/* checks whether the period so far is all within the silence level */
+int32_t meter_quiet(const meter_t* meter);
+
+/* checks whether 16-bit samples are all within the silence level */
+int32_t meter_silent(const int16_t* pcm, uint32_t samples);
+
+/* checks whether mix bus samples are all within the silence level */
+int32_t meter_silent_bus(const int32_t* bus, uint32_t samples);
+
+/* peak and RMS of the period */
+void meter_finish(const meter_t* meter, meter_stats_t* stats);
+
+
+#endif
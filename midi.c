@@ -0,0 +1,402 @@
+/* midi.c - Standard MIDI File sequencer implementation file. Formats 0
+ * and 1 are read into memory whole, and their tracks are merged into one
+ * stream of events as time is let pass.
+ * Written by Soumithri Bala. */
+
+
+#include "midi.h"
+#include "fixmath.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+#define SMF_MTHD            0x4D546864
+#define SMF_MTRK            0x4D54726B
+#define SMF_CHUNK_HDR       8
+#define SMF_HDR_SIZE        6
+#define SMF_SMPTE           0x8000
+#define SMF_DROP_FRAME      29
+#define SMF_VARLEN_BYTES    4
+#define SMF_DIV_OFFSET      12
+
+/* status bytes and varlen continuations have the top bit set */
+#define STATUS_BIT          0x80
+
+/* drop-frame SMPTE runs at 29.97 frames a second */
+#define DROP_FRAME_RATE     2997
+#define PERCENT             100
+
+#define META_END_OF_TRACK   0x2F
+#define META_TEMPO          0x51
+#define META_TEMPO_LEN      3
+#define DEFAULT_TEMPO       500000
+#define US_PER_SEC          1000000
+
+
+/* local function definitions */
+static midi_track_t* midi_due(midi_t* md);
+static int32_t midi_varlen(midi_track_t* tr, uint32_t* val);
+static void midi_delta(midi_track_t* tr);
+static uint32_t rd32be(const uint8_t* p);
+static uint16_t rd16be(const uint8_t* p);
+
+
+/* midi_open
+ *
+ * 		DESCRIPTION: reads a Standard MIDI File into memory and finds its
+ *		             tracks. Files that don't start with an MThd chunk are
+ *		             left alone without a message, so the caller can try
+ *		             other formats.
+ *		INPUTS: md -- sequencer state
+ *		        fname -- name of the file
+ *		OUTPUTS: md -- the song, positioned at its start
+ *		RETURN VALUE: 0 on success, MIDI_NOT_SMF if it isn't a MIDI file,
+ *		              -1 if it is one that can't be played
+ *		SIDE EFFECTS: none
+ */
+int32_t midi_open(midi_t* md, const uint8_t* fname) {
+
+    int32_t fd, n;
+    uint32_t pos, len, div, fps;
+    const uint8_t* hdr = md->file;
+
+    if ((fd = ece391_open(fname)) == -1) return MIDI_NOT_SMF;
+
+    /* check the signature before reading the rest */
+    md->size = 0;
+    while (md->size < SMF_CHUNK_HDR + SMF_HDR_SIZE &&
+           (n = ece391_read(fd, md->file + md->size, SMF_CHUNK_HDR + SMF_HDR_SIZE - md->size)) > 0)
+        md->size += n;
+    if (md->size < SMF_CHUNK_HDR + SMF_HDR_SIZE || rd32be(hdr) != SMF_MTHD) {
+        ece391_close(fd);
+        return MIDI_NOT_SMF;
+    }
+
+    while (md->size < MIDI_FILE_SIZE &&
+           (n = ece391_read(fd, md->file + md->size, MIDI_FILE_SIZE - md->size)) > 0)
+        md->size += n;
+    ece391_close(fd);
+
+    if (md->size == MIDI_FILE_SIZE) {
+        ece391_fdputs(1, (uint8_t*)"midi file too large\n");
+        return -1;
+    }
+
+    md->format = rd16be(hdr + SMF_CHUNK_HDR);
+    div = rd16be(hdr + SMF_DIV_OFFSET);
+    if (md->format > 1 || !div) {
+        ece391_fdputs(1, (uint8_t*)"unsupported midi file\n");
+        return -1;
+    }
+
+    /* SMPTE divisions give frames a second, negated, and ticks a frame */
+    md->smpte = (div & SMF_SMPTE) ? 1 : 0;
+    if (md->smpte) {
+        fps = (uint8_t)(-(int8_t)(div >> 8));
+        md->rate = fps == SMF_DROP_FRAME ? DROP_FRAME_RATE * (div & 0xFF) / PERCENT
+                                         : fps * (div & 0xFF);
+        if (!md->rate) md->rate = 1;
+    } else {
+        md->rate = div;
+    }
+
+    /* track chunks follow the header; anything else is skipped, and a
+     * chunk cut short by the end of the file keeps what's there */
+    md->ntracks = 0;
+    if ((len = rd32be(hdr + 4)) > md->size) len = md->size;
+    pos = SMF_CHUNK_HDR + len;
+    while (pos + SMF_CHUNK_HDR <= md->size && md->ntracks < MIDI_MAX_TRACKS) {
+        len = rd32be(md->file + pos + 4);
+        if (rd32be(md->file + pos) == SMF_MTRK) {
+            md->track[md->ntracks].start = md->file + pos + SMF_CHUNK_HDR;
+            md->track[md->ntracks].end = len > md->size - pos - SMF_CHUNK_HDR ?
+                                         md->file + md->size :
+                                         md->file + pos + SMF_CHUNK_HDR + len;
+            md->ntracks++;
+        }
+        if (len > md->size - pos - SMF_CHUNK_HDR) break;
+        pos += SMF_CHUNK_HDR + len;
+    }
+
+    if (!md->ntracks) {
+        ece391_fdputs(1, (uint8_t*)"unsupported midi file\n");
+        return -1;
+    }
+
+    midi_rewind(md);
+
+    return 0;
+}
+
+
+/* midi_rewind
+ *
+ * 		DESCRIPTION: goes back to the start of the song, at the default
+ *		             tempo of 120 quarters a minute
+ *		INPUTS: md -- sequencer state
+ *		OUTPUTS: md -- every track at its first event
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void midi_rewind(midi_t* md) {
+
+    uint32_t i;
+
+    for (i = 0; i < md->ntracks; i++) {
+        md->track[i].pos = md->track[i].start;
+        md->track[i].tick = 0;
+        md->track[i].status = 0;
+        md->track[i].done = 0;
+        midi_delta(&md->track[i]);
+    }
+
+    md->tempo = DEFAULT_TEMPO;
+    md->tick = 0;
+    md->budget = 0;
+    md->clock = 0;
+}
+
+
+/* midi_advance
+ *
+ * 		DESCRIPTION: lets time pass; the events it covers become due, and
+ *		             are taken with midi_next
+ *		INPUTS: md -- sequencer state
+ *		        us -- microseconds
+ *		OUTPUTS: md -- time to play
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void midi_advance(midi_t* md, uint32_t us) {
+
+    md->budget += (uint64_t)us * md->rate;
+    md->clock += us;
+}
+
+
+/* midi_next
+ *
+ * 		DESCRIPTION: takes the next event that is due, from whichever track
+ *		             has the earliest one. Time moves to each event as it's
+ *		             taken, so a tempo change costs the ticks after it at
+ *		             the new rate. Tempo changes are applied here and other
+ *		             meta events are dropped; channel messages and system
+ *		             exclusive come out with running status expanded.
+ *		INPUTS: md -- sequencer state
+ *		OUTPUTS: ev -- the event
+ *		RETURN VALUE: 1 if there was an event, 0 if none is due yet, -1 at
+ *		              the end of the song
+ *		SIDE EFFECTS: none
+ */
+int32_t midi_next(midi_t* md, midi_event_t* ev) {
+
+    midi_track_t* tr;
+    uint64_t cost;
+    uint32_t len, type;
+    uint8_t status;
+
+    while (1) {
+        if (!(tr = midi_due(md))) return -1;
+
+        /* a tick costs a tempo's worth of budget, or a second's for SMPTE */
+        if (tr->tick > md->tick) {
+            cost = (uint64_t)(tr->tick - md->tick) * (md->smpte ? US_PER_SEC : md->tempo);
+            if (md->budget < cost) return 0;
+            md->budget -= cost;
+            md->tick = tr->tick;
+        }
+
+        if (tr->pos >= tr->end) {
+            tr->done = 1;
+            continue;
+        }
+
+        /* a data byte continues the last status */
+        status = *tr->pos;
+        if (status & STATUS_BIT) tr->pos++;
+        else status = tr->status;
+        if (!status) {
+            tr->done = 1;
+            continue;
+        }
+
+        if (status == MIDI_META) {
+            if (tr->end - tr->pos < 1) {
+                tr->done = 1;
+                continue;
+            }
+            type = *tr->pos++;
+            if (midi_varlen(tr, &len) == -1 || len > (uint32_t)(tr->end - tr->pos)) {
+                tr->done = 1;
+                continue;
+            }
+            if (type == META_END_OF_TRACK) {
+                tr->done = 1;
+                continue;
+            }
+            if (type == META_TEMPO && len == META_TEMPO_LEN) {
+                md->tempo = (tr->pos[0] << 16) | (tr->pos[1] << 8) | tr->pos[2];
+                if (!md->tempo) md->tempo = 1;
+            }
+            tr->pos += len;
+            midi_delta(tr);
+            continue;
+        }
+
+        if (status == MIDI_SYSEX || status == MIDI_SYSEX_CONT) {
+            if (midi_varlen(tr, &len) == -1 || len > (uint32_t)(tr->end - tr->pos)) {
+                tr->done = 1;
+                continue;
+            }
+            ev->status = status;
+            ev->data1 = ev->data2 = 0;
+            ev->data = tr->pos;
+            ev->len = len;
+            tr->pos += len;
+            midi_delta(tr);
+            return 1;
+        }
+
+        /* other system messages have no place in a file */
+        if (status > MIDI_SYSEX) {
+            tr->done = 1;
+            continue;
+        }
+
+        /* program change and channel pressure take one data byte */
+        tr->status = status;
+        type = status & MIDI_TYPE_MASK;
+        len = (type == MIDI_PROGRAM || type == MIDI_CHAN_PRESSURE) ? 1 : 2;
+        if ((uint32_t)(tr->end - tr->pos) < len) {
+            tr->done = 1;
+            continue;
+        }
+        ev->status = status;
+        ev->data1 = tr->pos[0] & 0x7F;
+        ev->data2 = len == 2 ? tr->pos[1] & 0x7F : 0;
+        ev->data = 0;
+        ev->len = 0;
+        tr->pos += len;
+        midi_delta(tr);
+        return 1;
+    }
+}
+
+
+/* midi_due
+ *
+ * 		DESCRIPTION: finds the track with the earliest next event; on a tie
+ *		             the first track wins, so format 1 files play their
+ *		             tempo track's changes before the notes that share them
+ *		INPUTS: md -- sequencer state
+ *		OUTPUTS: none
+ *		RETURN VALUE: the track, or 0 once every track is done
+ *		SIDE EFFECTS: none
+ */
+static midi_track_t* midi_due(midi_t* md) {
+
+    midi_track_t* best = 0;
+    uint32_t i;
+
+    for (i = 0; i < md->ntracks; i++) {
+        if (md->track[i].done) continue;
+        if (!best || md->track[i].tick < best->tick) best = &md->track[i];
+    }
+
+    return best;
+}
+
+
+/* midi_varlen
+ *
+ * 		DESCRIPTION: reads a variable-length quantity, seven bits a byte
+ *		             with the top bit set on all but the last
+ *		INPUTS: tr -- track
+ *		OUTPUTS: val -- the value
+ *		RETURN VALUE: 0 on success, -1 if the track ends or the value runs
+ *		              over four bytes
+ *		SIDE EFFECTS: moves the track past the value
+ */
+static int32_t midi_varlen(midi_track_t* tr, uint32_t* val) {
+
+    uint32_t i;
+    uint8_t b;
+
+    *val = 0;
+    for (i = 0; i < SMF_VARLEN_BYTES; i++) {
+        if (tr->pos >= tr->end) return -1;
+        b = *tr->pos++;
+        *val = (*val << 7) | (b & 0x7F);
+        if (!(b & STATUS_BIT)) return 0;
+    }
+
+    return -1;
+}
+
+
+/* midi_delta
+ *
+ * 		DESCRIPTION: reads the delta time ahead of a track's next event,
+ *		             ending the track if it's cut short
+ *		INPUTS: tr -- track
+ *		OUTPUTS: tr -- tick of the next event
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void midi_delta(midi_track_t* tr) {
+
+    uint32_t delta;
+
+    if (midi_varlen(tr, &delta) == -1) tr->done = 1;
+    else tr->tick += delta;
+}
+
+
+/* rd32be
+ *
+ * 		DESCRIPTION: reads a big-endian 32-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd32be(const uint8_t* p) {
+
+    return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+
+/* rd16be
+ *
+ * 		DESCRIPTION: reads a big-endian 16-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint16_t rd16be(const uint8_t* p) {
+
+    return (p[0] << 8) | p[1];
+}
+
+
+/* midi_position
+ *
+ * 		DESCRIPTION: tells how far into the song the sequencer is; after
+ *		             midi_next returns an event this is exactly when it
+ *		             was due, whatever step time was let pass in
+ *		INPUTS: md -- sequencer state
+ *		OUTPUTS: none
+ *		RETURN VALUE: microseconds from the start of the song
+ *		SIDE EFFECTS: none
+ */
+uint32_t midi_position(const midi_t* md) {
+
+    /* what's left over is under one advance, which fits in 32 bits for any
+     * sensible step */
+    if (!(md->budget >> 32))
+        return md->clock - (uint32_t)md->budget / md->rate;
+
+    return md->clock - (uint32_t)fix_qdiv(md->budget, md->rate, 0);
+}
@@ -0,0 +1,104 @@
+/* midi.h - Standard MIDI File sequencer definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _MIDI_H
+#define _MIDI_H
+
+#include <stdint.h>
+
+/* returned by midi_open for a file with no MThd chunk */
+#define MIDI_NOT_SMF        (-2)
+
+/* whole files are read in; songs are rarely more than a few hundred KB */
+#define MIDI_FILE_SIZE      (1 << 19)
+#define MIDI_MAX_TRACKS     64
+#define MIDI_CHANNELS       16
+#define MIDI_DRUMS          9
+
+/* channel messages, in the top nibble of the status byte */
+#define MIDI_NOTE_OFF       0x80
+#define MIDI_NOTE_ON        0x90
+#define MIDI_KEY_PRESSURE   0xA0
+#define MIDI_CONTROL        0xB0
+#define MIDI_PROGRAM        0xC0
+#define MIDI_CHAN_PRESSURE  0xD0
+#define MIDI_PITCH_BEND     0xE0
+#define MIDI_SYSEX          0xF0
+#define MIDI_SYSEX_CONT     0xF7
+#define MIDI_META           0xFF
+#define MIDI_TYPE_MASK      0xF0
+#define MIDI_CHAN_MASK      0x0F
+
+/* controllers */
+#define MIDI_CC_MOD         1
+#define MIDI_CC_DATA        6
+#define MIDI_CC_VOLUME      7
+#define MIDI_CC_PAN         10
+#define MIDI_CC_EXPRESSION  11
+#define MIDI_CC_DATA_LO     38
+#define MIDI_CC_SUSTAIN     64
+#define MIDI_CC_NRPN_LO     98
+#define MIDI_CC_NRPN_HI     99
+#define MIDI_CC_RPN_LO      100
+#define MIDI_CC_RPN_HI      101
+#define MIDI_CC_SOUND_OFF   120
+#define MIDI_CC_RESET       121
+#define MIDI_CC_NOTES_OFF   123
+
+/* pitch bend is 14 bits, centred here */
+#define MIDI_BEND_CENTRE    8192
+
+/* one message due now; data and len are only set for system exclusive */
+typedef struct midi_event {
+    uint8_t status;
+    uint8_t data1;
+    uint8_t data2;
+    const uint8_t* data;
+    uint32_t len;
+} midi_event_t;
+
+typedef struct midi_track {
+    const uint8_t* start;   /* first delta time */
+    const uint8_t* pos;     /* next event, past its delta time */
+    const uint8_t* end;
+    uint32_t tick;          /* when the next event is due */
+    uint8_t status;         /* running status */
+    uint8_t done;
+} midi_track_t;
+
+/* parsed file and its playback position; time is kept in ticks, with
+ * what's left of the last advance counted in microseconds times rate,
+ * so tempo changes take effect on the tick they're on */
+typedef struct midi {
+    uint32_t format;
+    uint32_t ntracks;
+    uint32_t rate;          /* ticks per quarter, or per second for SMPTE */
+    uint32_t smpte;         /* 1 if rate is per second */
+    uint32_t tempo;         /* microseconds per quarter */
+    uint32_t tick;
+    uint64_t budget;        /* microseconds not yet played, times rate */
+    uint32_t clock;         /* microseconds played */
+    uint32_t size;
+    midi_track_t track[MIDI_MAX_TRACKS];
+    uint8_t file[MIDI_FILE_SIZE];
+} midi_t;
+
+
+/* reads a file and positions it at the start of the song */
+int32_t midi_open(midi_t* md, const uint8_t* fname);
+
+/* goes back to the start of the song */
+void midi_rewind(midi_t* md);
+
+/* lets time pass, making the events in it due */
+void midi_advance(midi_t* md, uint32_t us);
+
+/* takes the next event that is due */
+int32_t midi_next(midi_t* md, midi_event_t* ev);
+
+/* tells when the last event taken was due, in microseconds */
+uint32_t midi_position(const midi_t* md);
+
+
+#endif
@@ -0,0 +1,394 @@
+/* mp3.c - MPEG audio Layer III stream reader: frame sync, headers and a
+ * frame-offset index for seeking.
+ * Written by Soumithri Bala. */
+
+
+#include "mp3.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* Layer III bitrates in kbps by version, index 0 (free format) and 15
+ * are not supported */
+static const uint16_t bitrates[2][16] = {
+    {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0},
+    {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0}
+};
+static const uint32_t sample_rates[3] = {44100, 48000, 32000};
+
+
+/* local function definitions */
+static int32_t mp3_sync(mp3_t* mp3);
+static int32_t mp3_read(mp3_t* mp3);
+static int32_t mp3_skip(mp3_t* mp3, uint32_t len);
+static int32_t mp3_is_xing(mp3_t* mp3);
+static uint32_t rd_be(const uint8_t* p, int32_t bytes);
+
+
+/* mp3_header
+ *
+ * 		DESCRIPTION: decodes a frame header
+ *		INPUTS: p -- the four header bytes
+ *		OUTPUTS: hdr -- version, rate, channels and sizes of the frame
+ *		RETURN VALUE: 0 on success, -1 if not a Layer III header
+ *		SIDE EFFECTS: none
+ */
+int32_t mp3_header(const uint8_t* p, mp3_header_t* hdr) {
+
+    uint32_t word = rd_be(p, MP3_HDR_SIZE);
+    uint32_t version = (word >> 19) & 3;
+    uint32_t layer = (word >> 17) & 3;
+    uint32_t rate_idx = (word >> 10) & 3;
+    uint32_t v1;
+
+    /* version 1 is reserved, and layer 1 is Layer III */
+    if ((word & MP3_SYNC) != MP3_SYNC || version == 1 || layer != 1 || rate_idx == 3)
+        return -1;
+
+    hdr->version = version == 3 ? MPEG1 : version == 2 ? MPEG2 : MPEG25;
+    v1 = hdr->version == MPEG1;
+
+    hdr->bitrate = bitrates[!v1][(word >> 12) & 0xF];
+    if (!hdr->bitrate) return -1;
+
+    hdr->sample_rate = sample_rates[rate_idx] >> (hdr->version - 1);
+    hdr->crc = !((word >> 16) & 1);
+    hdr->mode = (word >> 6) & 3;
+    hdr->channels = hdr->mode == MP3_MODE_MONO ? 1 : 2;
+    hdr->samples = v1 ? MP3_SAMPLES_V1 : MP3_SAMPLES_V2;
+
+    /* bytes are samples / 8 times the bitrate over the rate */
+    hdr->size = (hdr->samples / 8) * hdr->bitrate * 1000 / hdr->sample_rate +
+                ((word >> 9) & 1);
+
+    if (v1)
+        hdr->side_size = hdr->channels == 1 ? MP3_SIDE_V1_MONO : MP3_SIDE_V1;
+    else
+        hdr->side_size = hdr->channels == 1 ? MP3_SIDE_V2_MONO : MP3_SIDE_V2;
+
+    return 0;
+}
+
+
+/* mp3_open
+ *
+ * 		DESCRIPTION: opens a stream, steps over an ID3v2 tag and a Xing or
+ *		             Info frame, and takes the seek index this process
+ *		             already has for the file, if any
+ *		INPUTS: mp3 -- stream state to fill in
+ *		        fname -- name of the file
+ *		OUTPUTS: mp3 -- format of the first frame, and the length if the
+ *		                Xing frame or an earlier scan gave it
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: opens a file descriptor
+ */
+int32_t mp3_open(mp3_t* mp3, const uint8_t* fname) {
+
+    uint32_t tag;
+    int32_t found;
+
+    mp3->fname = fname;
+    mp3->offset = 0;
+    mp3->sample = 0;
+    mp3->total = 0;
+    mp3->hdr.sample_rate = 0;
+
+    if (-1 == (mp3->fd = ece391_open(fname))) return -1;
+
+    if (ece391_read(mp3->fd, mp3->frame, ID3_HDR_SIZE) != ID3_HDR_SIZE) {
+        ece391_close(mp3->fd);
+        return -1;
+    }
+    mp3->have = ID3_HDR_SIZE;
+
+    /* the tag size is syncsafe, seven bits to a byte */
+    if (rd_be(mp3->frame, 3) == ID3_ID) {
+        tag = ((mp3->frame[6] & 0x7F) << 21) | ((mp3->frame[7] & 0x7F) << 14) |
+              ((mp3->frame[8] & 0x7F) << 7) | (mp3->frame[9] & 0x7F);
+        if (mp3->frame[5] & ID3_FOOTER) tag += ID3_HDR_SIZE;
+        if (mp3_skip(mp3, tag) == -1) {
+            ece391_close(mp3->fd);
+            return -1;
+        }
+        mp3->offset = ID3_HDR_SIZE + tag;
+        mp3->have = 0;
+    }
+
+    if (!mp3_read(mp3)) {
+        ece391_close(mp3->fd);
+        return -1;
+    }
+
+    mp3->idx = seek_cache_get(fname, MP3_INDEX_FRAMES * mp3->hdr.samples, &found);
+    if (found) mp3->total = mp3->idx->total;
+    mp3->idx->rate = mp3->hdr.sample_rate;
+
+    /* an encoder's summary frame carries no audio */
+    if (mp3_is_xing(mp3)) {
+        mp3->offset += mp3->hdr.size;
+        mp3->have = 0;
+    }
+    mp3->first = mp3->offset;
+
+    return 0;
+}
+
+
+/* mp3_next
+ *
+ * 		DESCRIPTION: reads the next frame into the frame buffer, and notes
+ *		             where it starts in the seek index, so the index fills
+ *		             in as the stream plays
+ *		INPUTS: mp3 -- stream state
+ *		OUTPUTS: mp3 -- hdr and frame hold the frame
+ *		RETURN VALUE: bytes in the frame, 0 at the end of the stream
+ *		SIDE EFFECTS: advances the file
+ */
+int32_t mp3_next(mp3_t* mp3) {
+
+    if (!mp3_read(mp3)) return 0;
+
+    seek_add(mp3->idx, mp3->sample, mp3->offset);
+
+    mp3->sample += mp3->hdr.samples;
+    mp3->offset += mp3->hdr.size;
+    mp3->have = 0;
+
+    return mp3->hdr.size;
+}
+
+
+/* mp3_seek
+ *
+ * 		DESCRIPTION: moves to the frame holding a sample. Starts from the
+ *		             nearest indexed frame before it, or from where the
+ *		             stream is if that is nearer, and reads headers forward
+ *		             from there. There's no seek call, so going back
+ *		             reopens the file and skips to the frame.
+ *		INPUTS: mp3 -- stream state
+ *		        sample -- sample wanted
+ *		OUTPUTS: mp3 -- positioned so the next frame holds the sample
+ *		RETURN VALUE: 0 on success, -1 if the stream ends first
+ *		SIDE EFFECTS: may reopen the file
+ */
+int32_t mp3_seek(mp3_t* mp3, uint32_t sample) {
+
+    seek_point_t pt;
+
+    if (seek_find(mp3->idx, sample, &pt) == -1) {
+        pt.sample = 0;
+        pt.offset = mp3->first;
+    }
+
+    if (pt.sample > mp3->sample || mp3->sample > sample) {
+        if (pt.offset >= mp3->offset + mp3->have) {
+            if (mp3_skip(mp3, pt.offset - mp3->offset - mp3->have) == -1) return -1;
+        } else {
+            ece391_close(mp3->fd);
+            if (-1 == (mp3->fd = ece391_open(mp3->fname)) || mp3_skip(mp3, pt.offset) == -1)
+                return -1;
+        }
+        mp3->offset = pt.offset;
+        mp3->sample = pt.sample;
+        mp3->have = 0;
+    }
+
+    while (mp3->sample + mp3->hdr.samples <= sample) {
+        if (!mp3_next(mp3)) return -1;
+    }
+
+    return 0;
+}
+
+
+/* mp3_scan
+ *
+ * 		DESCRIPTION: reads every frame to the end, which gives the length
+ *		             of a stream without a Xing frame and leaves a full
+ *		             index for later seeks
+ *		INPUTS: mp3 -- stream state
+ *		OUTPUTS: mp3 -- total
+ *		RETURN VALUE: samples in the stream
+ *		SIDE EFFECTS: leaves the stream at its end
+ */
+int32_t mp3_scan(mp3_t* mp3) {
+
+    while (mp3_next(mp3));
+
+    mp3->total = mp3->idx->total = mp3->sample;
+
+    return mp3->total;
+}
+
+
+/* mp3_main_data_begin
+ *
+ * 		DESCRIPTION: reads how far back in earlier frames the main data of
+ *		             the frame last read starts; a seek has to begin that
+ *		             many bytes of main data early to fill the reservoir
+ *		INPUTS: mp3 -- stream state
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes back from the end of the side information
+ *		SIDE EFFECTS: none
+ */
+uint32_t mp3_main_data_begin(const mp3_t* mp3) {
+
+    const uint8_t* side = mp3->frame + MP3_HDR_SIZE + (mp3->hdr.crc ? MP3_CRC_SIZE : 0);
+
+    /* nine bits in MPEG-1, eight in MPEG-2 and 2.5 */
+    if (mp3->hdr.version == MPEG1) return (side[0] << 1) | (side[1] >> 7);
+
+    return side[0];
+}
+
+
+/* mp3_close
+ *
+ * 		DESCRIPTION: closes the stream; its seek index stays cached
+ *		INPUTS: mp3 -- stream state
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: closes a file descriptor
+ */
+void mp3_close(mp3_t* mp3) {
+
+    ece391_close(mp3->fd);
+}
+
+
+/* mp3_sync
+ *
+ * 		DESCRIPTION: finds the next frame header, moving a byte at a time
+ *		             past anything that isn't one. Once the stream's format
+ *		             is known, a header must match it, which stops stray
+ *		             sync patterns in tags or damaged data from passing.
+ *		INPUTS: mp3 -- stream state, with have bytes from offset buffered
+ *		OUTPUTS: mp3 -- header at the start of the frame buffer, hdr set
+ *		RETURN VALUE: 0 on success, -1 at the end of the stream
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t mp3_sync(mp3_t* mp3) {
+
+    mp3_header_t hdr;
+    uint32_t skipped, i;
+    int32_t got;
+
+    for (skipped = 0; skipped < MP3_RESYNC; skipped++) {
+        if (mp3->have < MP3_HDR_SIZE) {
+            got = ece391_read(mp3->fd, mp3->frame + mp3->have, MP3_HDR_SIZE - mp3->have);
+            if (got <= 0) return -1;
+            mp3->have += got;
+            if (mp3->have < MP3_HDR_SIZE) return -1;
+        }
+
+        if (mp3_header(mp3->frame, &hdr) != -1 &&
+                (!mp3->hdr.sample_rate || (hdr.sample_rate == mp3->hdr.sample_rate &&
+                                           hdr.version == mp3->hdr.version))) {
+            mp3->hdr = hdr;
+            return 0;
+        }
+
+        for (i = 1; i < mp3->have; i++) mp3->frame[i - 1] = mp3->frame[i];
+        mp3->have--;
+        mp3->offset++;
+    }
+
+    return -1;
+}
+
+
+/* mp3_read
+ *
+ * 		DESCRIPTION: syncs to the next frame and reads all of it into the
+ *		             frame buffer, without moving past it
+ *		INPUTS: mp3 -- stream state
+ *		OUTPUTS: mp3 -- frame and hdr, have set to the frame size
+ *		RETURN VALUE: bytes in the frame, 0 at the end of the stream
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t mp3_read(mp3_t* mp3) {
+
+    uint32_t want;
+    int32_t got;
+
+    if (mp3_sync(mp3) == -1) return 0;
+
+    while (mp3->have < mp3->hdr.size) {
+        want = mp3->hdr.size - mp3->have;
+        if ((got = ece391_read(mp3->fd, mp3->frame + mp3->have, want)) <= 0) return 0;
+        mp3->have += got;
+    }
+
+    return mp3->hdr.size;
+}
+
+
+/* mp3_skip
+ *
+ * 		DESCRIPTION: discards bytes from the file with no seek available,
+ *		             using the frame buffer as scratch
+ *		INPUTS: mp3 -- stream state
+ *		        len -- number of bytes to skip
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the file ended first
+ *		SIDE EFFECTS: advances the file, clobbers the frame buffer
+ */
+static int32_t mp3_skip(mp3_t* mp3, uint32_t len) {
+
+    int32_t got;
+
+    while (len) {
+        got = ece391_read(mp3->fd, mp3->frame, len < MP3_MAX_FRAME ? len : MP3_MAX_FRAME);
+        if (got <= 0) return -1;
+        len -= got;
+    }
+
+    return 0;
+}
+
+
+/* mp3_is_xing
+ *
+ * 		DESCRIPTION: checks whether the frame just read is a Xing or Info
+ *		             frame, taking the stream length from it if it has one
+ *		INPUTS: mp3 -- stream state, with a frame read
+ *		OUTPUTS: mp3 -- total, if the frame counts its stream
+ *		RETURN VALUE: 1 for a Xing or Info frame, else 0
+ *		SIDE EFFECTS: none
+ */
+static int32_t mp3_is_xing(mp3_t* mp3) {
+
+    const uint8_t* p = mp3->frame + MP3_HDR_SIZE + (mp3->hdr.crc ? MP3_CRC_SIZE : 0) +
+                       mp3->hdr.side_size;
+    uint32_t id;
+
+    if (p + 3 * sizeof(uint32_t) > mp3->frame + mp3->hdr.size) return 0;
+
+    id = rd_be(p, sizeof(uint32_t));
+    if (id != XING_ID && id != INFO_ID) return 0;
+
+    if (rd_be(p + 4, sizeof(uint32_t)) & XING_FRAMES)
+        mp3->total = rd_be(p + 8, sizeof(uint32_t)) * mp3->hdr.samples;
+
+    return 1;
+}
+
+
+/* rd_be
+ *
+ * 		DESCRIPTION: reads a big-endian value of up to four bytes
+ *		INPUTS: p -- pointer to bytes
+ *		        bytes -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: value read
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd_be(const uint8_t* p, int32_t bytes) {
+
+    uint32_t val = 0;
+
+    while (bytes--) val = (val << 8) | *p++;
+
+    return val;
+}
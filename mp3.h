@@ -0,0 +1,89 @@
+/* mp3.h - MPEG audio Layer III stream definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _MP3_H
+#define _MP3_H
+
+#include <stdint.h>
+
+#include "seekidx.h"
+
+#define MP3_HDR_SIZE        4
+#define MP3_CRC_SIZE        2
+#define MP3_MAX_FRAME       1441
+#define MP3_RESYNC          4096
+#define MP3_SYNC            0xFFE00000
+#define MP3_INDEX_FRAMES    16
+
+#define MPEG1               1
+#define MPEG2               2
+#define MPEG25              3
+
+#define MP3_MODE_MONO       3
+#define MP3_SAMPLES_V1      1152
+#define MP3_SAMPLES_V2      576
+#define MP3_SIDE_V1_MONO    17
+#define MP3_SIDE_V1         32
+#define MP3_SIDE_V2_MONO    9
+#define MP3_SIDE_V2         17
+
+#define ID3_HDR_SIZE        10
+#define ID3_FOOTER          0x10
+#define ID3_ID              0x494433
+#define XING_ID             0x58696E67
+#define INFO_ID             0x496E666F
+#define XING_FRAMES         0x1
+
+/* one frame header */
+typedef struct mp3_header {
+    uint32_t version;       /* MPEG1, MPEG2 or MPEG25 */
+    uint32_t crc;           /* 1 if a CRC follows the header */
+    uint32_t bitrate;       /* kbps */
+    uint32_t sample_rate;
+    uint32_t mode;
+    uint32_t channels;
+    uint32_t size;          /* bytes in the frame, header included */
+    uint32_t samples;       /* samples per channel */
+    uint32_t side_size;     /* bytes of side information */
+} mp3_header_t;
+
+/* open stream, positioned at a frame boundary */
+typedef struct mp3 {
+    int32_t fd;
+    const uint8_t* fname;   /* kept for reopening on a backward seek */
+    mp3_header_t hdr;       /* of the frame last read */
+    uint32_t first;         /* file offset of the first audio frame */
+    uint32_t offset;        /* file offset of the next frame */
+    uint32_t have;          /* bytes from offset already in frame */
+    uint32_t sample;        /* first sample of the next frame */
+    uint32_t total;         /* samples in the stream, 0 if not yet known */
+    seek_index_t* idx;
+    uint8_t frame[MP3_MAX_FRAME];
+} mp3_t;
+
+
+/* decodes a frame header */
+int32_t mp3_header(const uint8_t* p, mp3_header_t* hdr);
+
+/* opens a stream and positions it at its first audio frame */
+int32_t mp3_open(mp3_t* mp3, const uint8_t* fname);
+
+/* reads the next frame into the frame buffer */
+int32_t mp3_next(mp3_t* mp3);
+
+/* moves to the frame holding a sample */
+int32_t mp3_seek(mp3_t* mp3, uint32_t sample);
+
+/* reads to the end, counting the samples and indexing every frame */
+int32_t mp3_scan(mp3_t* mp3);
+
+/* offset in the main data of the bit reservoir's start, back from this
+ * frame */
+uint32_t mp3_main_data_begin(const mp3_t* mp3);
+
+/* closes the stream */
+void mp3_close(mp3_t* mp3);
+
+
+#endif
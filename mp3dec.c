@@ -0,0 +1,1863 @@
+/* mp3dec.c - MPEG-1, 2 and 2.5 Layer III decoder: side information, the
+ * bit reservoir, Huffman decoding, requantization, stereo, the hybrid
+ * filterbank and polyphase synthesis, all in fixed point.
+ * Written by Soumithri Bala. */
+
+
+#include "mp3dec.h"
+#include "fixmath.h"
+
+
+#define FIFO_MASK           (MP3_FIFO_FRAMES - 1)
+#define VAL_MAX             0x7FFFFFFF
+#define MODE_JOINT          1
+#define MODE_EXT_IS         0x1
+#define MODE_EXT_MS         0x2
+#define BLOCK_SHORT         2
+#define MAX_BIG_VALUES      288
+#define GAIN_BIAS           210
+#define LINBITS_ESC         15
+#define MIXED_SHORT_SFB     3
+#define WARM_GRANULES       2
+#define LAST_LONG_SF        20
+#define IS_POSITIONS        7
+#define Q30_ONE             (1 << Q30_SHIFT)
+#define Q30_HALF            (1 << (Q30_SHIFT - 1))
+#define INV_SQRT2           759250125
+#define ALIAS_LINES         8
+#define SHORT_IMDCT         12
+#define LONG_IMDCT          36
+#define SYNTH_WIN_SIZE      512
+#define SYNTH_WIN_HALF      256
+#define SYNTH_WIN_PERIOD    64
+
+/* Huffman decode tables, by table select, then table 16 and table 24 with
+ * their escapes, then count1 table A. A leaf is (bits << 8) | (x << 4) | y;
+ * a link is HUFF_LINK | (bits << 12) and the subtable's offset from the
+ * table's root. */
+#define HUFF_TABLES         19
+#define HUFF_T16            16
+#define HUFF_T24            17
+#define HUFF_QUAD           18
+#define HUFF_ROOT_BITS      6
+#define HUFF_SUB_BITS       4
+#define HUFF_LINK           0x8000
+/* what the tables build to, 5.2 KB; the largest, table 13, spans 436
+ * entries, well inside a link's 12-bit offset */
+#define HUFF_SIZE           2670
+
+/* x^(4/3) for the table's range in Q20; larger values are interpolated */
+#define POW43_SIZE          257
+#define POW43_SHIFT         20
+/* Q20 times Q30 to the Q26 spectrum */
+#define REQ_SHIFT           (POW43_SHIFT + Q30_SHIFT - MP3_SPEC_SHIFT)
+/* the spectrum is clamped to the filterbank's headroom */
+#define SPEC_MAX            ((1 << 30) - 1)
+/* inverse MDCT cosines are Q28, so a full sum of clamped lines fits */
+#define IMDCT_SHIFT         28
+#define IMDCT_HALF          (1 << (IMDCT_SHIFT - 1))
+/* Q26 subband samples to the Q22 synthesis input */
+#define SYNTH_IN_SHIFT      (MP3_SPEC_SHIFT - MP3_SYNTH_SHIFT)
+/* the synthesis window is Q16; Q22 times Q16 to 16 bits */
+#define SYNTH_OUT_SHIFT     (MP3_SYNTH_SHIFT + Q16_SHIFT - Q15_SHIFT)
+
+
+/* where each Huffman table's codes start in huff_code and huff_len, how
+ * many there are and how many values of y to each x */
+typedef struct huff_src {
+    uint16_t at;
+    uint16_t n;
+    uint16_t dim;
+} huff_src_t;
+
+/* tables built on the first open */
+static uint16_t huff_dec[HUFF_SIZE];
+static uint16_t huff_base[HUFF_TABLES];
+static uint8_t huff_bits[HUFF_TABLES];
+static int32_t imdct_long[MP3_SB_LINES][MP3_SB_LINES];
+static int32_t imdct_short[MP3_SHORT_LINES][MP3_SHORT_LINES];
+static int32_t imdct_win[4][LONG_IMDCT];
+static int32_t dct32_odd[16][16];
+static int32_t dct16_odd[8][8];
+static int32_t dct8[8][8];
+static int32_t synth_win[SYNTH_WIN_SIZE];
+static int32_t tables_ready = 0;
+
+static const uint32_t base_rates[3] = {44100, 48000, 32000};
+
+static const huff_src_t huff_src[HUFF_TABLES] = {
+    {0, 0, 0}, {0, 4, 2}, {4, 9, 3}, {13, 9, 3}, {0, 0, 0}, {22, 16, 4}, {38, 16, 4},
+    {54, 36, 6}, {90, 36, 6}, {126, 36, 6}, {162, 64, 8}, {226, 64, 8}, {290, 64, 8},
+    {354, 256, 16}, {0, 0, 0}, {610, 256, 16}, {866, 256, 16}, {1122, 256, 16},
+    {1378, 16, 16}
+};
+
+/* escape bits of big values by table select */
+static const uint8_t linbits[32] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 2, 3, 4, 6, 8, 10, 13, 4, 5, 6, 7, 8, 9, 11, 13
+};
+
+/* codewords of the big value tables 1 to 13, 15, 16 and 24 in x, y order,
+ * then of count1 table A by vwxy */
+static const uint16_t huff_code[1394] = {
+    1, 1, 1, 0, 1, 2, 1, 3, 1, 1, 3, 2, 0, 3, 2, 1,
+    1, 1, 1, 3, 2, 0, 1, 2, 6, 5, 3, 1, 4, 4, 7, 5,
+    7, 1, 6, 1, 1, 0, 7, 3, 5, 1, 6, 2, 3, 2, 5, 4,
+    4, 1, 3, 3, 2, 0, 1, 2, 10, 19, 16, 10, 3, 3, 7, 10,
+    5, 3, 11, 4, 13, 17, 8, 4, 12, 11, 18, 15, 11, 2, 7, 6,
+    9, 14, 3, 1, 6, 4, 5, 3, 2, 0, 3, 4, 6, 18, 12, 5,
+    5, 1, 2, 16, 9, 3, 7, 3, 5, 14, 7, 3, 19, 17, 15, 13,
+    10, 4, 13, 5, 8, 11, 5, 1, 12, 4, 4, 1, 1, 0, 7, 5,
+    9, 14, 15, 7, 6, 4, 5, 5, 6, 7, 7, 6, 8, 8, 8, 5,
+    15, 6, 9, 10, 5, 1, 11, 7, 9, 6, 4, 1, 14, 4, 6, 2,
+    6, 0, 1, 2, 10, 23, 35, 30, 12, 17, 3, 3, 8, 12, 18, 21,
+    12, 7, 11, 9, 15, 21, 32, 40, 19, 6, 14, 13, 22, 34, 46, 23,
+    18, 7, 20, 19, 33, 47, 27, 22, 9, 3, 31, 22, 41, 26, 21, 20,
+    5, 3, 14, 13, 10, 11, 16, 6, 5, 1, 9, 8, 7, 8, 4, 4,
+    2, 0, 3, 4, 10, 24, 34, 33, 21, 15, 5, 3, 4, 10, 32, 17,
+    11, 10, 11, 7, 13, 18, 30, 31, 20, 5, 25, 11, 19, 59, 27, 18,
+    12, 5, 35, 33, 31, 58, 30, 16, 7, 5, 28, 26, 32, 19, 17, 15,
+    8, 14, 14, 12, 9, 13, 14, 9, 4, 1, 11, 4, 6, 6, 6, 3,
+    2, 0, 9, 6, 16, 33, 41, 39, 38, 26, 7, 5, 6, 9, 23, 16,
+    26, 11, 17, 7, 11, 14, 21, 30, 10, 7, 17, 10, 15, 12, 18, 28,
+    14, 5, 32, 13, 22, 19, 18, 16, 9, 5, 40, 17, 31, 29, 17, 13,
+    4, 2, 27, 12, 11, 15, 10, 7, 4, 1, 27, 12, 8, 12, 6, 3,
+    1, 0, 1, 5, 14, 21, 34, 51, 46, 71, 42, 52, 68, 52, 67, 44,
+    43, 19, 3, 4, 12, 19, 31, 26, 44, 33, 31, 24, 32, 24, 31, 35,
+    22, 14, 15, 13, 23, 36, 59, 49, 77, 65, 29, 40, 30, 40, 27, 33,
+    42, 16, 22, 20, 37, 61, 56, 79, 73, 64, 43, 76, 56, 37, 26, 31,
+    25, 14, 35, 16, 60, 57, 97, 75, 114, 91, 54, 73, 55, 41, 48, 53,
+    23, 24, 58, 27, 50, 96, 76, 70, 93, 84, 77, 58, 79, 29, 74, 49,
+    41, 17, 47, 45, 78, 74, 115, 94, 90, 79, 69, 83, 71, 50, 59, 38,
+    36, 15, 72, 34, 56, 95, 92, 85, 91, 90, 86, 73, 77, 65, 51, 44,
+    43, 42, 43, 20, 30, 44, 55, 78, 72, 87, 78, 61, 46, 54, 37, 30,
+    20, 16, 53, 25, 41, 37, 44, 59, 54, 81, 66, 76, 57, 54, 37, 18,
+    39, 11, 35, 33, 31, 57, 42, 82, 72, 80, 47, 58, 55, 21, 22, 26,
+    38, 22, 53, 25, 23, 38, 70, 60, 51, 36, 55, 26, 34, 23, 27, 14,
+    9, 7, 34, 32, 28, 39, 49, 75, 30, 52, 48, 40, 52, 28, 18, 17,
+    9, 5, 45, 21, 34, 64, 56, 50, 49, 45, 31, 19, 12, 15, 10, 7,
+    6, 3, 48, 23, 20, 39, 36, 35, 53, 21, 16, 23, 13, 10, 6, 1,
+    4, 2, 16, 15, 17, 27, 25, 20, 29, 11, 17, 12, 16, 8, 1, 1,
+    0, 1, 7, 12, 18, 53, 47, 76, 124, 108, 89, 123, 108, 119, 107, 81,
+    122, 63, 13, 5, 16, 27, 46, 36, 61, 51, 42, 70, 52, 83, 65, 41,
+    59, 36, 19, 17, 15, 24, 41, 34, 59, 48, 40, 64, 50, 78, 62, 80,
+    56, 33, 29, 28, 25, 43, 39, 63, 55, 93, 76, 59, 93, 72, 54, 75,
+    50, 29, 52, 22, 42, 40, 67, 57, 95, 79, 72, 57, 89, 69, 49, 66,
+    46, 27, 77, 37, 35, 66, 58, 52, 91, 74, 62, 48, 79, 63, 90, 62,
+    40, 38, 125, 32, 60, 56, 50, 92, 78, 65, 55, 87, 71, 51, 73, 51,
+    70, 30, 109, 53, 49, 94, 88, 75, 66, 122, 91, 73, 56, 42, 64, 44,
+    21, 25, 90, 43, 41, 77, 73, 63, 56, 92, 77, 66, 47, 67, 48, 53,
+    36, 20, 71, 34, 67, 60, 58, 49, 88, 76, 67, 106, 71, 54, 38, 39,
+    23, 15, 109, 53, 51, 47, 90, 82, 58, 57, 48, 72, 57, 41, 23, 27,
+    62, 9, 86, 42, 40, 37, 70, 64, 52, 43, 70, 55, 42, 25, 29, 18,
+    11, 11, 118, 68, 30, 55, 50, 46, 74, 65, 49, 39, 24, 16, 22, 13,
+    14, 7, 91, 44, 39, 38, 34, 63, 52, 45, 31, 52, 28, 19, 14, 8,
+    9, 3, 123, 60, 58, 53, 47, 43, 32, 22, 37, 24, 17, 12, 15, 10,
+    2, 1, 71, 37, 34, 30, 28, 20, 17, 26, 21, 16, 10, 6, 8, 6,
+    2, 0, 1, 5, 14, 44, 74, 63, 110, 93, 172, 149, 138, 242, 225, 195,
+    376, 17, 3, 4, 12, 20, 35, 62, 53, 47, 83, 75, 68, 119, 201, 107,
+    207, 9, 15, 13, 23, 38, 67, 58, 103, 90, 161, 72, 127, 117, 110, 209,
+    206, 16, 45, 21, 39, 69, 64, 114, 99, 87, 158, 140, 252, 212, 199, 387,
+    365, 26, 75, 36, 68, 65, 115, 101, 179, 164, 155, 264, 246, 226, 395, 382,
+    362, 9, 66, 30, 59, 56, 102, 185, 173, 265, 142, 253, 232, 400, 388, 378,
+    445, 16, 111, 54, 52, 100, 184, 178, 160, 133, 257, 244, 228, 217, 385, 366,
+    715, 10, 98, 48, 91, 88, 165, 157, 148, 261, 248, 407, 397, 372, 380, 889,
+    884, 8, 85, 84, 81, 159, 156, 143, 260, 249, 427, 401, 392, 383, 727, 713,
+    708, 7, 154, 76, 73, 141, 131, 256, 245, 426, 406, 394, 384, 735, 359, 710,
+    352, 11, 139, 129, 67, 125, 247, 233, 229, 219, 393, 743, 737, 720, 885, 882,
+    439, 4, 243, 120, 118, 115, 227, 223, 396, 746, 742, 736, 721, 712, 706, 223,
+    436, 6, 202, 224, 222, 218, 216, 389, 386, 381, 364, 888, 443, 707, 440, 437,
+    1728, 4, 747, 211, 210, 208, 370, 379, 734, 723, 714, 1735, 883, 877, 876, 3459,
+    865, 2, 377, 369, 102, 187, 726, 722, 358, 711, 709, 866, 1734, 871, 3458, 870,
+    434, 0, 12, 10, 7, 11, 10, 17, 11, 9, 13, 12, 10, 7, 5, 3,
+    1, 3, 15, 13, 46, 80, 146, 262, 248, 434, 426, 669, 653, 649, 621, 517,
+    1032, 88, 14, 12, 21, 38, 71, 130, 122, 216, 209, 198, 327, 345, 319, 297,
+    279, 42, 47, 22, 41, 74, 68, 128, 120, 221, 207, 194, 182, 340, 315, 295,
+    541, 18, 81, 39, 75, 70, 134, 125, 116, 220, 204, 190, 178, 325, 311, 293,
+    271, 16, 147, 72, 69, 135, 127, 118, 112, 210, 200, 188, 352, 323, 306, 285,
+    540, 14, 263, 66, 129, 126, 119, 114, 214, 202, 192, 180, 341, 317, 301, 281,
+    262, 12, 249, 123, 121, 117, 113, 215, 206, 195, 185, 347, 330, 308, 291, 272,
+    520, 10, 435, 115, 111, 109, 211, 203, 196, 187, 353, 332, 313, 298, 283, 531,
+    381, 17, 427, 212, 208, 205, 201, 193, 186, 177, 169, 320, 303, 286, 268, 514,
+    377, 16, 335, 199, 197, 191, 189, 181, 174, 333, 321, 305, 289, 275, 521, 379,
+    371, 11, 668, 184, 183, 179, 175, 344, 331, 314, 304, 290, 277, 530, 383, 373,
+    366, 10, 652, 346, 171, 168, 164, 318, 309, 299, 287, 276, 263, 513, 375, 368,
+    362, 6, 648, 322, 316, 312, 307, 302, 292, 284, 269, 261, 512, 376, 370, 364,
+    359, 4, 620, 300, 296, 294, 288, 282, 273, 266, 515, 380, 374, 369, 365, 361,
+    357, 2, 1033, 280, 278, 274, 267, 264, 259, 382, 378, 372, 367, 363, 360, 358,
+    356, 0, 43, 20, 19, 17, 15, 13, 11, 9, 7, 6, 4, 7, 5, 3,
+    1, 3, 1, 5, 4, 5, 6, 5, 4, 4, 7, 3, 6, 0, 7, 2,
+    3, 1
+};
+
+static const uint8_t huff_len[1394] = {
+    1, 3, 2, 3, 1, 3, 6, 3, 3, 5, 5, 5, 6, 2, 2, 6, 3, 2, 5, 5, 5, 6, 1, 3,
+    6, 7, 3, 3, 6, 7, 6, 6, 7, 8, 7, 6, 7, 8, 3, 3, 5, 7, 3, 2, 4, 5, 4, 4,
+    5, 6, 6, 5, 6, 7, 1, 3, 6, 8, 8, 9, 3, 4, 6, 7, 7, 8, 6, 5, 7, 8, 8, 9,
+    7, 7, 8, 9, 9, 9, 7, 7, 8, 9, 9, 10, 8, 8, 9, 10, 10, 10, 2, 3, 6, 8, 8, 9,
+    3, 2, 4, 8, 8, 8, 6, 4, 6, 8, 8, 9, 8, 8, 8, 9, 9, 10, 8, 7, 8, 9, 10, 10,
+    9, 8, 9, 9, 11, 11, 3, 3, 5, 6, 8, 9, 3, 3, 4, 5, 6, 8, 4, 4, 5, 6, 7, 8,
+    6, 5, 6, 7, 7, 8, 7, 6, 7, 7, 8, 9, 8, 7, 8, 8, 9, 9, 1, 3, 6, 8, 9, 9,
+    9, 10, 3, 4, 6, 7, 8, 9, 8, 8, 6, 6, 7, 8, 9, 10, 9, 9, 7, 7, 8, 9, 10, 10,
+    9, 10, 8, 8, 9, 10, 10, 10, 10, 10, 9, 9, 10, 10, 11, 11, 10, 11, 8, 8, 9, 10, 10, 10,
+    11, 11, 9, 8, 9, 10, 10, 11, 11, 11, 2, 3, 5, 7, 8, 9, 8, 9, 3, 3, 4, 6, 8, 8,
+    7, 8, 5, 5, 6, 7, 8, 9, 8, 8, 7, 6, 7, 9, 8, 10, 8, 9, 8, 8, 8, 9, 9, 10,
+    9, 10, 8, 8, 9, 10, 10, 11, 10, 11, 8, 7, 7, 8, 9, 10, 10, 10, 8, 7, 8, 9, 10, 10,
+    10, 10, 4, 3, 5, 7, 8, 9, 9, 9, 3, 3, 4, 5, 7, 7, 8, 8, 5, 4, 5, 6, 7, 8,
+    7, 8, 6, 5, 6, 6, 7, 8, 8, 8, 7, 6, 7, 7, 8, 8, 8, 9, 8, 7, 8, 8, 8, 9,
+    8, 9, 8, 7, 7, 8, 8, 9, 9, 10, 9, 8, 8, 9, 9, 9, 9, 10, 1, 4, 6, 7, 8, 9,
+    9, 10, 9, 10, 11, 11, 12, 12, 13, 13, 3, 4, 6, 7, 8, 8, 9, 9, 9, 9, 10, 10, 11, 12,
+    12, 12, 6, 6, 7, 8, 9, 9, 10, 10, 9, 10, 10, 11, 11, 12, 13, 13, 7, 7, 8, 9, 9, 10,
+    10, 10, 10, 11, 11, 11, 11, 12, 13, 13, 8, 7, 9, 9, 10, 10, 11, 11, 10, 11, 11, 12, 12, 13,
+    13, 14, 9, 8, 9, 10, 10, 10, 11, 11, 11, 11, 12, 11, 13, 13, 14, 14, 9, 9, 10, 10, 11, 11,
+    11, 11, 11, 12, 12, 12, 13, 13, 14, 14, 10, 9, 10, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 14,
+    16, 16, 9, 8, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 14, 15, 15, 10, 9, 10, 10, 11, 11,
+    11, 13, 12, 13, 13, 14, 14, 14, 16, 15, 10, 10, 10, 11, 11, 12, 12, 13, 12, 13, 14, 13, 14, 15,
+    16, 17, 11, 10, 10, 11, 12, 12, 12, 12, 13, 13, 13, 14, 15, 15, 15, 16, 11, 11, 11, 12, 12, 13,
+    12, 13, 14, 14, 15, 15, 15, 16, 16, 16, 12, 11, 12, 13, 13, 13, 14, 14, 14, 14, 14, 15, 16, 15,
+    16, 16, 13, 12, 12, 13, 13, 13, 15, 14, 14, 17, 15, 15, 15, 17, 16, 16, 12, 12, 13, 14, 14, 14,
+    15, 14, 15, 15, 16, 16, 19, 18, 19, 16, 3, 4, 5, 7, 7, 8, 9, 9, 9, 10, 10, 11, 11, 11,
+    12, 13, 4, 3, 5, 6, 7, 7, 8, 8, 8, 9, 9, 10, 10, 10, 11, 11, 5, 5, 5, 6, 7, 7,
+    8, 8, 8, 9, 9, 10, 10, 11, 11, 11, 6, 6, 6, 7, 7, 8, 8, 9, 9, 9, 10, 10, 10, 11,
+    11, 11, 7, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 8, 7, 7, 8, 8, 8,
+    9, 9, 9, 9, 10, 10, 11, 11, 11, 12, 9, 7, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11,
+    12, 12, 9, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 12, 9, 8, 8, 9, 9, 9,
+    9, 10, 10, 10, 10, 11, 11, 12, 12, 12, 9, 8, 9, 9, 9, 9, 10, 10, 10, 11, 11, 11, 11, 12,
+    12, 12, 10, 9, 9, 9, 10, 10, 10, 10, 10, 11, 11, 11, 11, 12, 13, 12, 10, 9, 9, 9, 10, 10,
+    10, 10, 11, 11, 11, 11, 12, 12, 12, 13, 11, 10, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 12, 12,
+    13, 13, 11, 10, 10, 10, 10, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13, 12, 11, 11, 11, 11, 11,
+    11, 11, 12, 12, 12, 12, 13, 13, 12, 13, 12, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 12, 13, 13,
+    13, 13, 1, 4, 6, 8, 9, 9, 10, 10, 11, 11, 11, 12, 12, 12, 13, 9, 3, 4, 6, 7, 8, 9,
+    9, 9, 10, 10, 10, 11, 12, 11, 12, 8, 6, 6, 7, 8, 9, 9, 10, 10, 11, 10, 11, 11, 11, 12,
+    12, 9, 8, 7, 8, 9, 9, 10, 10, 10, 11, 11, 12, 12, 12, 13, 13, 10, 9, 8, 9, 9, 10, 10,
+    11, 11, 11, 12, 12, 12, 13, 13, 13, 9, 9, 8, 9, 9, 10, 11, 11, 12, 11, 12, 12, 13, 13, 13,
+    14, 10, 10, 9, 9, 10, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 14, 10, 10, 9, 10, 10, 11, 11,
+    11, 12, 12, 13, 13, 13, 13, 15, 15, 10, 10, 10, 10, 11, 11, 11, 12, 12, 13, 13, 13, 13, 14, 14,
+    14, 10, 11, 10, 10, 11, 11, 12, 12, 13, 13, 13, 13, 14, 13, 14, 13, 11, 11, 11, 10, 11, 12, 12,
+    12, 12, 13, 14, 14, 14, 15, 15, 14, 10, 12, 11, 11, 11, 12, 12, 13, 14, 14, 14, 14, 14, 14, 13,
+    14, 11, 12, 12, 12, 12, 12, 13, 13, 13, 13, 15, 14, 14, 14, 14, 16, 11, 14, 12, 12, 12, 13, 13,
+    14, 14, 14, 16, 15, 15, 15, 17, 15, 11, 13, 13, 11, 12, 14, 14, 13, 14, 14, 15, 16, 15, 17, 15,
+    14, 11, 9, 8, 8, 9, 9, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 8, 4, 4, 6, 7, 8, 9,
+    9, 10, 10, 11, 11, 11, 11, 11, 12, 9, 4, 4, 5, 6, 7, 8, 8, 9, 9, 9, 10, 10, 10, 10,
+    10, 8, 6, 5, 6, 7, 7, 8, 8, 9, 9, 9, 9, 10, 10, 10, 11, 7, 7, 6, 7, 7, 8, 8,
+    8, 9, 9, 9, 9, 10, 10, 10, 10, 7, 8, 7, 7, 8, 8, 8, 8, 9, 9, 9, 10, 10, 10, 10,
+    11, 7, 9, 7, 8, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 7, 9, 8, 8, 8, 8, 9,
+    9, 9, 9, 10, 10, 10, 10, 10, 11, 7, 10, 8, 8, 8, 9, 9, 9, 9, 10, 10, 10, 10, 10, 11,
+    11, 8, 10, 9, 9, 9, 9, 9, 9, 9, 9, 10, 10, 10, 10, 11, 11, 8, 10, 9, 9, 9, 9, 9,
+    9, 10, 10, 10, 10, 10, 11, 11, 11, 8, 11, 9, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11,
+    11, 8, 11, 10, 9, 9, 9, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 8, 11, 10, 10, 10, 10, 10,
+    10, 10, 10, 10, 11, 11, 11, 11, 11, 8, 11, 10, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11,
+    11, 8, 12, 10, 10, 10, 10, 10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 8, 8, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 8, 8, 8, 8, 4, 1, 4, 4, 5, 4, 6, 5, 6, 4, 5, 5, 6, 5, 6,
+    6, 6
+};
+
+/* scalefactor band starts in lines, by rate: 44.1, 48 and 32 kHz, then
+ * half and a quarter of each */
+static const uint16_t sfb_long_tab[9][MP3_LONG_BANDS + 1] = {
+    {
+        0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 52, 62,
+        74, 90, 110, 134, 162, 196, 238, 288, 342, 418, 576
+    },
+    {
+        0, 4, 8, 12, 16, 20, 24, 30, 36, 42, 50, 60,
+        72, 88, 106, 128, 156, 190, 230, 276, 330, 384, 576
+    },
+    {
+        0, 4, 8, 12, 16, 20, 24, 30, 36, 44, 54, 66,
+        82, 102, 126, 156, 194, 240, 296, 364, 448, 550, 576
+    },
+    {
+        0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96,
+        116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576
+    },
+    {
+        0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96,
+        114, 136, 162, 194, 232, 278, 332, 394, 464, 540, 576
+    },
+    {
+        0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96,
+        116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576
+    },
+    {
+        0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96,
+        116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576
+    },
+    {
+        0, 6, 12, 18, 24, 30, 36, 44, 54, 66, 80, 96,
+        116, 140, 168, 200, 238, 284, 336, 396, 464, 522, 576
+    },
+    {
+        0, 12, 24, 36, 48, 60, 72, 88, 108, 132, 160, 192,
+        232, 280, 336, 400, 476, 566, 568, 570, 572, 574, 576
+    }
+};
+
+static const uint16_t sfb_short_tab[9][MP3_SHORT_BANDS + 1] = {
+    {
+        0, 4, 8, 12, 16, 22, 30, 40, 52, 66, 84, 106, 136, 192
+    },
+    {
+        0, 4, 8, 12, 16, 22, 28, 38, 50, 64, 80, 100, 126, 192
+    },
+    {
+        0, 4, 8, 12, 16, 22, 30, 42, 58, 78, 104, 138, 180, 192
+    },
+    {
+        0, 4, 8, 12, 18, 24, 32, 42, 56, 74, 100, 132, 174, 192
+    },
+    {
+        0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 136, 180, 192
+    },
+    {
+        0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192
+    },
+    {
+        0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192
+    },
+    {
+        0, 4, 8, 12, 18, 26, 36, 48, 62, 80, 104, 134, 174, 192
+    },
+    {
+        0, 8, 16, 24, 36, 52, 72, 96, 124, 160, 162, 164, 166, 192
+    }
+};
+
+static const uint8_t pretab[MP3_LONG_BANDS] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3, 3, 2, 0
+};
+
+/* MPEG-1 scalefactor widths by scalefac_compress */
+static const uint8_t slen1[16] = {0, 0, 0, 0, 3, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4};
+static const uint8_t slen2[16] = {0, 1, 2, 3, 0, 1, 2, 3, 1, 2, 3, 1, 2, 3, 2, 3};
+
+/* MPEG-1 scalefactor groups shared between granules */
+static const uint8_t scfsi_band[5] = {0, 6, 11, 16, 21};
+
+/* MPEG-2 scalefactors in each of four groups, by how the widths are coded
+ * and long, short and mixed blocks */
+static const uint8_t lsf_nsf[6][3][4] = {
+    {{6, 5, 5, 5}, {9, 9, 9, 9}, {6, 9, 9, 9}},
+    {{6, 5, 7, 3}, {9, 9, 12, 6}, {6, 9, 12, 6}},
+    {{11, 10, 0, 0}, {18, 18, 0, 0}, {15, 18, 0, 0}},
+    {{7, 7, 7, 0}, {12, 12, 12, 0}, {6, 15, 12, 0}},
+    {{6, 6, 6, 3}, {12, 9, 9, 6}, {6, 12, 9, 6}},
+    {{8, 8, 5, 0}, {15, 12, 9, 0}, {6, 18, 9, 0}}
+};
+
+/* n^(4/3) in Q20 */
+static const uint32_t pow43[POW43_SIZE] = {
+    0U, 1048576U, 2642246U, 4536925U, 6658043U, 8965199U,
+    11432334U, 14040976U, 16777216U, 19630134U, 22590885U, 25652134U,
+    28807677U, 32052191U, 35381043U, 38790162U, 42275935U, 45835131U,
+    49464838U, 53162417U, 56925463U, 60751775U, 64639326U, 68586245U,
+    72590798U, 76651371U, 80766459U, 84934656U, 89154641U, 93425173U,
+    97745083U, 102113267U, 106528681U, 110990336U, 115497292U, 120048657U,
+    124643580U, 129281251U, 133960896U, 138681774U, 143443179U, 148244431U,
+    153084881U, 157963902U, 162880896U, 167835283U, 172826508U, 177854036U,
+    182917348U, 188015947U, 193149351U, 198317093U, 203518724U, 208753808U,
+    214021922U, 219322657U, 224655618U, 230020418U, 235416684U, 240844054U,
+    246302175U, 251790705U, 257309309U, 262857665U, 268435456U, 274042375U,
+    279678122U, 285342405U, 291034939U, 296755448U, 302503660U, 308279310U,
+    314082140U, 319911899U, 325768339U, 331651219U, 337560304U, 343495364U,
+    349456173U, 355442511U, 361454162U, 367490913U, 373552560U, 379638897U,
+    385749728U, 391884856U, 398044091U, 404227247U, 410434138U, 416664585U,
+    422918412U, 429195444U, 435495511U, 441818447U, 448164086U, 454532268U,
+    460922835U, 467335629U, 473770499U, 480227294U, 486705865U, 493206069U,
+    499727760U, 506270800U, 512835049U, 519420372U, 526026633U, 532653703U,
+    539301449U, 545969745U, 552658465U, 559367485U, 566096683U, 572845938U,
+    579615132U, 586404148U, 593212871U, 600041188U, 606888987U, 613756157U,
+    620642590U, 627548179U, 634472818U, 641416403U, 648378831U, 655360000U,
+    662359811U, 669378164U, 676414963U, 683470111U, 690543513U, 697635075U,
+    704744705U, 711872311U, 719017804U, 726181094U, 733362093U, 740560714U,
+    747776872U, 755010481U, 762261457U, 769529719U, 776815184U, 784117771U,
+    791437400U, 798773993U, 806127471U, 813497757U, 820884774U, 828288448U,
+    835708704U, 843145467U, 850598666U, 858068227U, 865554080U, 873056153U,
+    880574377U, 888108684U, 895659003U, 903225269U, 910807413U, 918405370U,
+    926019075U, 933648461U, 941293466U, 948954025U, 956630076U, 964321556U,
+    972028404U, 979750558U, 987487958U, 995240545U, 1003008259U, 1010791041U,
+    1018588834U, 1026401579U, 1034229220U, 1042071700U, 1049928963U, 1057800955U,
+    1065687619U, 1073588901U, 1081504748U, 1089435107U, 1097379924U, 1105339146U,
+    1113312723U, 1121300602U, 1129302732U, 1137319064U, 1145349546U, 1153394129U,
+    1161452763U, 1169525401U, 1177611993U, 1185712491U, 1193826849U, 1201955018U,
+    1210096952U, 1218252604U, 1226421930U, 1234604882U, 1242801415U, 1251011486U,
+    1259235049U, 1267472060U, 1275722476U, 1283986253U, 1292263347U, 1300553717U,
+    1308857320U, 1317174114U, 1325504057U, 1333847107U, 1342203224U, 1350572367U,
+    1358954496U, 1367349570U, 1375757550U, 1384178395U, 1392612068U, 1401058529U,
+    1409517739U, 1417989660U, 1426474254U, 1434971484U, 1443481311U, 1452003699U,
+    1460538611U, 1469086010U, 1477645860U, 1486218124U, 1494802767U, 1503399753U,
+    1512009047U, 1520630614U, 1529264419U, 1537910426U, 1546568603U, 1555238915U,
+    1563921327U, 1572615807U, 1581322321U, 1590040836U, 1598771318U, 1607513735U,
+    1616268055U, 1625034246U, 1633812274U, 1642602109U, 1651403719U, 1660217071U,
+    1669042137U, 1677878883U, 1686727279U, 1695587295U, 1704458901U
+};
+
+/* 2^(k/4) and 2^(k/3) in Q30 */
+static const uint32_t frac4[4] = {1073741824U, 1276901417U, 1518500250U, 1805811301U};
+static const uint32_t cbrt2[3] = {1073741824U, 1352829926U, 1704458901U};
+
+/* alias reduction butterflies in Q30 */
+static const int32_t alias_cs[ALIAS_LINES] = {
+    920726018, 946763260, 1019655998, 1055826004,
+    1068929116, 1072840480, 1073633586, 1073734474
+};
+static const int32_t alias_ca[ALIAS_LINES] = {
+    -552435611, -506518344, -336486479, -195327811,
+    -101548266, -43986460, -15245597, -3972818
+};
+
+/* MPEG-1 intensity stereo, the left share of a line by position in Q30 */
+static const int32_t is_left[IS_POSITIONS] = {
+    0, 226908346, 393016785, 536870912, 680725039, 846833478, 1073741824
+};
+
+/* first half of the synthesis window in Q16; the rest mirrors it */
+static const int32_t synth_half[SYNTH_WIN_HALF + 1] = {
+    0, -1, -1, -1, -1, -1, -1, -2,
+    -2, -2, -2, -3, -3, -4, -4, -5,
+    -5, -6, -7, -7, -8, -9, -10, -11,
+    -13, -14, -16, -17, -19, -21, -24, -26,
+    -29, -31, -35, -38, -41, -45, -49, -53,
+    -58, -63, -68, -73, -79, -85, -91, -97,
+    -104, -111, -117, -125, -132, -139, -147, -154,
+    -161, -169, -176, -183, -190, -196, -202, -208,
+    213, 218, 222, 225, 227, 228, 228, 227,
+    224, 221, 215, 208, 200, 189, 177, 163,
+    146, 127, 106, 83, 57, 29, -2, -36,
+    -72, -111, -153, -197, -244, -294, -347, -401,
+    -459, -519, -581, -645, -711, -779, -848, -919,
+    -991, -1064, -1137, -1210, -1283, -1356, -1428, -1498,
+    -1567, -1634, -1698, -1759, -1817, -1870, -1919, -1962,
+    -2001, -2032, -2057, -2075, -2085, -2087, -2080, -2063,
+    2037, 2000, 1952, 1893, 1822, 1739, 1644, 1535,
+    1414, 1280, 1131, 970, 794, 605, 402, 185,
+    -45, -288, -545, -814, -1095, -1388, -1692, -2006,
+    -2330, -2663, -3004, -3351, -3705, -4063, -4425, -4788,
+    -5153, -5517, -5879, -6237, -6589, -6935, -7271, -7597,
+    -7910, -8209, -8491, -8755, -8998, -9219, -9416, -9585,
+    -9727, -9838, -9916, -9959, -9966, -9935, -9863, -9750,
+    -9592, -9389, -9139, -8840, -8492, -8092, -7640, -7134,
+    6574, 5959, 5288, 4561, 3776, 2935, 2037, 1082,
+    70, -998, -2122, -3300, -4533, -5818, -7154, -8540,
+    -9975, -11455, -12980, -14548, -16155, -17799, -19478, -21189,
+    -22929, -24694, -26482, -28289, -30112, -31947, -33791, -35640,
+    -37489, -39336, -41176, -43006, -44821, -46617, -48390, -50137,
+    -51853, -53534, -55178, -56778, -58333, -59838, -61289, -62684,
+    -64019, -65290, -66494, -67629, -68692, -69679, -70590, -71420,
+    -72169, -72835, -73415, -73908, -74313, -74630, -74856, -74992,
+    75038
+};
+
+
+/* local function definitions */
+static void mp3_tables(void);
+static uint32_t huff_level(const huff_src_t* src, uint32_t base, uint32_t at, uint32_t prefix,
+                           uint32_t plen, uint32_t bits);
+static void mp3_restart(mp3dec_t* dec);
+static void mp3_unit(mp3dec_t* dec);
+static int32_t mp3_frame(mp3dec_t* dec);
+static int32_t mp3_side(mp3dec_t* dec);
+static void mp3_granule(mp3dec_t* dec);
+static void mp3_scalefac(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr);
+static void mp3_scalefac_lsf(mp3dec_t* dec, uint32_t ch, mp3_gr_t* gr);
+static void mp3_huffman(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr, uint32_t end);
+static uint32_t mp3_huff_sym(mp3dec_t* dec, uint32_t id);
+static int32_t mp3_big_value(mp3dec_t* dec, uint32_t v, uint32_t lin);
+static void mp3_requantize(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr);
+static int32_t mp3_pow43(int32_t v, int32_t exp4);
+static void mp3_stereo(mp3dec_t* dec);
+static void mp3_stereo_band(mp3dec_t* dec, uint32_t i, uint32_t end, int32_t is, uint32_t pos);
+static int32_t mp3_any(const int32_t* x, uint32_t i, uint32_t end);
+static void mp3_reorder(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr);
+static void mp3_antialias(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr);
+static void mp3_hybrid(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr);
+static void mp3_imdct36(const int32_t* x, int32_t* y, const int32_t* win);
+static void mp3_imdct12(const int32_t* x, int32_t* y);
+static void mp3_synth(mp3dec_t* dec, uint32_t ch);
+static void mp3_dct32(const int32_t* s, int32_t* x);
+static void mp3_commit(mp3dec_t* dec);
+static uint32_t bits_peek(const uint8_t* buf, uint32_t size, uint32_t pos);
+static uint32_t bits_get(const uint8_t* buf, uint32_t size, uint32_t* pos, uint32_t n);
+static int32_t sat32(int64_t val);
+static int32_t spec_clamp(int64_t val);
+
+
+/* mp3dec_open
+ *
+ * 		DESCRIPTION: opens a Layer III stream and builds the decoder's
+ *		             tables on the first open
+ *		INPUTS: dec -- decoder state
+ *		        fname -- name of the file
+ *		OUTPUTS: dec -- rate and channels of the first frame, ready to
+ *		                decode it
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: opens a file descriptor, takes the file's seek index
+ */
+int32_t mp3dec_open(mp3dec_t* dec, const uint8_t* fname) {
+
+    const mp3_header_t* hdr = &dec->mp3.hdr;
+    uint32_t r, b;
+
+    if (!tables_ready) {
+        mp3_tables();
+        tables_ready = 1;
+    }
+
+    if (mp3_open(&dec->mp3, fname) == -1) return -1;
+
+    dec->channels = hdr->channels;
+    dec->sample_rate = hdr->sample_rate;
+    dec->lsf = hdr->version != MPEG1;
+    dec->ngr = dec->lsf ? 1 : 2;
+
+    for (r = 0; r < 2 && base_rates[r] != hdr->sample_rate << (hdr->version - 1); r++);
+    r += 3 * (hdr->version - 1);
+    dec->sfb_long = sfb_long_tab[r];
+    dec->sfb_short = sfb_short_tab[r];
+
+    /* a mixed block's long part reaches the start of the fourth short band */
+    dec->mixed_end = MP3_WINDOWS * dec->sfb_short[MIXED_SHORT_SFB];
+    for (b = 0; dec->sfb_long[b] < dec->mixed_end; b++);
+    dec->mixed_long = b;
+
+    mp3_restart(dec);
+
+    return 0;
+}
+
+
+/* mp3dec_read
+ *
+ * 		DESCRIPTION: copies decoded PCM out of the FIFO, decoding granules
+ *		             only when it runs dry
+ *		INPUTS: dec -- decoder state
+ *		        dst -- destination
+ *		        len -- bytes wanted, in whole frames
+ *		OUTPUTS: dst -- interleaved 16-bit PCM
+ *		RETURN VALUE: bytes copied, fewer than len only at the end of the
+ *		              stream
+ *		SIDE EFFECTS: reads ahead in the file
+ */
+int32_t mp3dec_read(mp3dec_t* dec, int8_t* dst, uint32_t len) {
+
+    uint32_t ch = dec->channels;
+    uint32_t frames = len / (ch * sizeof(int16_t));
+    uint32_t done = 0, n, i;
+    int16_t* out = (int16_t*)dst;
+    const int16_t* src;
+
+    while (done < frames) {
+        if (!dec->count) {
+            if (dec->stage == MP3_END) break;
+            mp3_unit(dec);
+            continue;
+        }
+
+        /* up to the wrap of the ring */
+        n = frames - done;
+        if (n > dec->count) n = dec->count;
+        if (n > MP3_FIFO_FRAMES - dec->head) n = MP3_FIFO_FRAMES - dec->head;
+
+        src = dec->fifo + dec->head * ch;
+        for (i = 0; i < n * ch; i++) out[done * ch + i] = src[i];
+
+        dec->head = (dec->head + n) & FIFO_MASK;
+        dec->count -= n;
+        dec->out_pos += n;
+        done += n;
+    }
+
+    return done * ch * sizeof(int16_t);
+}
+
+
+/* mp3dec_work
+ *
+ * 		DESCRIPTION: decodes one granule ahead of the reads, so the caller
+ *		             can spread the decode over the time between refills;
+ *		             only while the FIFO has room for all of it
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: dec -- FIFO topped up
+ *		RETURN VALUE: 1 if a granule was decoded, 0 if there was nothing
+ *		              to do
+ *		SIDE EFFECTS: reads ahead in the file
+ */
+int32_t mp3dec_work(mp3dec_t* dec) {
+
+    if (dec->stage == MP3_END || MP3_FIFO_FRAMES - dec->count < MP3_GRANULE) return 0;
+
+    mp3_unit(dec);
+
+    return 1;
+}
+
+
+/* mp3dec_seek
+ *
+ * 		DESCRIPTION: moves to a frame. A frame still in the FIFO is reached
+ *		             by dropping what comes before it. Otherwise decoding
+ *		             restarts some stream frames short of the one holding
+ *		             it, if that is ahead of where decoding is or the frame
+ *		             is behind; else it carries on from there. Stream
+ *		             frames up to two granules before the frame's only
+ *		             fill the bit reservoir, and those two are decoded in
+ *		             full so the first granule out is exact.
+ *		INPUTS: dec -- decoder state
+ *		        frame -- frame to go to
+ *		OUTPUTS: dec -- positioned at the frame
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: may reopen the file
+ */
+int32_t mp3dec_seek(mp3dec_t* dec, uint32_t frame) {
+
+    uint32_t spf = dec->mp3.hdr.samples;
+    uint32_t f = frame / spf, start, prime, n;
+
+    if (frame >= dec->out_pos && frame <= dec->out_pos + dec->count) {
+        n = frame - dec->out_pos;
+        dec->head = (dec->head + n) & FIFO_MASK;
+        dec->count -= n;
+        dec->out_pos = frame;
+        return 0;
+    }
+
+    /* two granules warm up the overlap, then the synthesis vectors */
+    prime = f * spf > WARM_GRANULES * MP3_GRANULE ? f * spf - WARM_GRANULES * MP3_GRANULE : 0;
+    start = prime > MP3_SEEK_FRAMES * spf ? prime - MP3_SEEK_FRAMES * spf : 0;
+    if (frame < dec->out_pos || start > dec->decoded) {
+        if (mp3_seek(&dec->mp3, start) == -1) return -1;
+        mp3_restart(dec);
+        dec->decoded = start;
+    }
+    dec->prime_end = prime;
+
+    /* empty the FIFO up to where the next granule will write */
+    dec->head = (dec->head + dec->count) & FIFO_MASK;
+    dec->count = 0;
+    dec->out_pos = frame;
+    dec->target = frame;
+
+    return 0;
+}
+
+
+/* mp3dec_close
+ *
+ * 		DESCRIPTION: closes the stream
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: closes a file descriptor
+ */
+void mp3dec_close(mp3dec_t* dec) {
+
+    mp3_close(&dec->mp3);
+}
+
+
+/* mp3_tables
+ *
+ * 		DESCRIPTION: builds the Huffman decode tables, the inverse MDCT
+ *		             and DCT cosines, the block windows and the synthesis
+ *		             window, all small enough to stay in the cache
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: fills the static tables
+ */
+static void mp3_tables(void) {
+
+    uint32_t id, at = 0, i, k, bits, maxlen;
+    int32_t s, c;
+
+    for (id = 0; id < HUFF_TABLES; id++) {
+        huff_base[id] = at;
+        if (!huff_src[id].n) continue;
+        for (maxlen = 0, i = 0; i < huff_src[id].n; i++)
+            if (huff_len[huff_src[id].at + i] > maxlen) maxlen = huff_len[huff_src[id].at + i];
+        bits = maxlen < HUFF_ROOT_BITS ? maxlen : HUFF_ROOT_BITS;
+        huff_bits[id] = bits;
+        at = huff_level(&huff_src[id], at, at, 0, 0, bits);
+    }
+
+    /* y[9..26] of the 36-point transform and y[3..8] of the 12-point one;
+     * the rest follow by symmetry */
+    for (i = 0; i < MP3_SB_LINES; i++) {
+        for (k = 0; k < MP3_SB_LINES; k++) {
+            fix_sincos(fix_qdiv((2 * (i + 9) + 19) * (2 * k + 1) % 144, 144, 32), &s, &c);
+            imdct_long[i][k] = (c + 2) >> (Q30_SHIFT - IMDCT_SHIFT);
+        }
+    }
+    for (i = 0; i < MP3_SHORT_LINES; i++) {
+        for (k = 0; k < MP3_SHORT_LINES; k++) {
+            fix_sincos(fix_qdiv((2 * (i + 3) + 7) * (2 * k + 1) % 48, 48, 32), &s, &c);
+            imdct_short[i][k] = (c + 2) >> (Q30_SHIFT - IMDCT_SHIFT);
+        }
+    }
+
+    /* normal, start, short and stop windows */
+    for (i = 0; i < LONG_IMDCT; i++) {
+        fix_sincos(fix_qdiv(2 * i + 1, 144, 32), &imdct_win[0][i], &c);
+        imdct_win[1][i] = imdct_win[3][i] = imdct_win[0][i];
+    }
+    for (i = 0; i < SHORT_IMDCT; i++) fix_sincos(fix_qdiv(2 * i + 1, 48, 32), &imdct_win[2][i], &c);
+    for (i = 0; i < 6; i++) {
+        imdct_win[1][18 + i] = imdct_win[3][12 + i] = Q30_ONE;
+        imdct_win[1][24 + i] = imdct_win[2][6 + i];
+        imdct_win[3][6 + i] = imdct_win[2][i];
+        imdct_win[1][30 + i] = imdct_win[3][i] = 0;
+    }
+
+    /* cos((2k + 1) m pi / 64) for odd m, then the same split of the even
+     * half into a 16-point odd and an 8-point transform */
+    for (i = 0; i < 16; i++)
+        for (k = 0; k < 16; k++) fix_sincos(((2 * k + 1) * (2 * i + 1)) << 25, &s, &dct32_odd[i][k]);
+    for (i = 0; i < 8; i++) {
+        for (k = 0; k < 8; k++) {
+            fix_sincos(((2 * k + 1) * (2 * i + 1)) << 26, &s, &dct16_odd[i][k]);
+            fix_sincos(((2 * k + 1) * i) << 27, &s, &dct8[i][k]);
+        }
+    }
+
+    /* the window's second half is its first reversed, negated except at
+     * the ends of each period */
+    for (i = 0; i <= SYNTH_WIN_HALF; i++) synth_win[i] = synth_half[i];
+    for (i = 1; i < SYNTH_WIN_HALF; i++)
+        synth_win[SYNTH_WIN_SIZE - i] = i % SYNTH_WIN_PERIOD ? -synth_half[i] : synth_half[i];
+}
+
+
+/* huff_level
+ *
+ * 		DESCRIPTION: fills one level of a Huffman decode table for the
+ *		             codewords under a prefix, then the subtables it
+ *		             links to after it
+ *		INPUTS: src -- codewords of the table
+ *		        base -- where the table's root is
+ *		        at -- where this level goes
+ *		        prefix -- bits already decoded to reach this level
+ *		        plen -- number of them
+ *		        bits -- bits this level decodes
+ *		OUTPUTS: none
+ *		RETURN VALUE: where the next table can go
+ *		SIDE EFFECTS: writes huff_dec
+ */
+static uint32_t huff_level(const huff_src_t* src, uint32_t base, uint32_t at, uint32_t prefix,
+                           uint32_t plen, uint32_t bits) {
+
+    uint32_t size = 1 << bits, next = at + size;
+    uint32_t s, len, code, rest, idx, j, sub;
+
+    for (j = 0; j < size; j++) huff_dec[at + j] = 0;
+
+    for (s = 0; s < src->n; s++) {
+        len = huff_len[src->at + s];
+        code = huff_code[src->at + s];
+        if (len <= plen || code >> (len - plen) != prefix) continue;
+
+        rest = len - plen;
+        if (rest <= bits) {
+            idx = (code & ((1 << rest) - 1)) << (bits - rest);
+            for (j = 0; j < 1U << (bits - rest); j++)
+                huff_dec[at + idx + j] = (rest << 8) | ((s / src->dim) << 4) | (s % src->dim);
+        } else {
+            /* marked for a subtable as long as the longest codeword under it */
+            idx = (code >> (rest - bits)) & (size - 1);
+            sub = rest - bits < HUFF_SUB_BITS ? rest - bits : HUFF_SUB_BITS;
+            if (!(huff_dec[at + idx] & HUFF_LINK) || sub > ((huff_dec[at + idx] >> 12) & 7))
+                huff_dec[at + idx] = HUFF_LINK | (sub << 12);
+        }
+    }
+
+    for (idx = 0; idx < size; idx++) {
+        if (!(huff_dec[at + idx] & HUFF_LINK)) continue;
+        sub = (huff_dec[at + idx] >> 12) & 7;
+        huff_dec[at + idx] |= next - base;
+        next = huff_level(src, base, next, (prefix << bits) | idx, plen + bits, sub);
+    }
+
+    return next;
+}
+
+
+/* mp3_restart
+ *
+ * 		DESCRIPTION: starts decoding afresh, with an empty reservoir and
+ *		             silent filterbanks
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: dec -- empty, at position 0
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_restart(mp3dec_t* dec) {
+
+    uint32_t c, i, j;
+
+    dec->stage = MP3_GRANULES;
+    dec->gr = dec->ngr;
+    dec->res_len = 0;
+
+    for (c = 0; c < MP3_MAX_CHANNELS; c++) {
+        for (i = 0; i < MP3_SUBBANDS; i++)
+            for (j = 0; j < MP3_SB_LINES; j++) dec->overlap[c][i][j] = 0;
+        for (i = 0; i < MP3_SYNTH_VECS; i++)
+            for (j = 0; j < MP3_SYNTH_VEC; j++) dec->vec[c][i][j] = 0;
+    }
+    dec->vec_pos = 0;
+
+    dec->decoded = 0;
+    dec->prime_end = 0;
+    dec->target = 0;
+    dec->head = 0;
+    dec->count = 0;
+    dec->out_pos = 0;
+}
+
+
+/* mp3_unit
+ *
+ * 		DESCRIPTION: decodes the next granule, reading a frame first once
+ *		             the last one's granules are done
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: dec -- a granule added to the FIFO, or the end reached
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may advance the file
+ */
+static void mp3_unit(mp3dec_t* dec) {
+
+    if (dec->gr >= dec->ngr && mp3_frame(dec) == -1) return;
+
+    mp3_granule(dec);
+}
+
+
+/* mp3_frame
+ *
+ * 		DESCRIPTION: reads the next frame, parses its side information and
+ *		             adds its main data to the bit reservoir. Frames before
+ *		             the end of a seek's priming only add their main data.
+ *		             A frame whose main data starts further back than the
+ *		             reservoir goes, or whose side information is bad,
+ *		             decodes as silence.
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: dec -- side information, reservoir and the bit its first
+ *		                granule starts at
+ *		RETURN VALUE: 0 on success, -1 at the end of the stream
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t mp3_frame(mp3dec_t* dec) {
+
+    const mp3_header_t* hdr = &dec->mp3.hdr;
+    const uint8_t* md;
+    uint32_t at, len, begin, prime, bits, g, c, i;
+    int32_t ok = 0;
+
+    while (mp3_next(&dec->mp3)) {
+        at = MP3_HDR_SIZE + (hdr->crc ? MP3_CRC_SIZE : 0) + hdr->side_size;
+        len = hdr->size > at ? hdr->size - at : 0;
+        md = dec->mp3.frame + at;
+        prime = dec->decoded + hdr->samples <= dec->prime_end;
+        if (!prime) ok = mp3_side(dec) != -1;
+
+        /* keep only what later frames can reach back to */
+        if (dec->res_len > MP3_RES_BACK) {
+            for (i = 0; i < MP3_RES_BACK; i++)
+                dec->res[i] = dec->res[dec->res_len - MP3_RES_BACK + i];
+            dec->res_len = MP3_RES_BACK;
+        }
+        begin = mp3_main_data_begin(&dec->mp3);
+        dec->frame_ok = ok && begin <= dec->res_len;
+        dec->part_pos = (dec->res_len - (dec->frame_ok ? begin : 0)) * 8;
+
+        for (i = 0; i < len; i++) dec->res[dec->res_len + i] = md[i];
+        dec->res_len += len;
+
+        if (prime) {
+            dec->decoded += hdr->samples;
+            continue;
+        }
+
+        for (bits = 0, g = 0; g < dec->ngr; g++)
+            for (c = 0; c < hdr->channels; c++) bits += dec->side[g][c].part2_3_length;
+        if (dec->part_pos + bits > dec->res_len * 8) dec->frame_ok = 0;
+
+        dec->gr = 0;
+        return 0;
+    }
+
+    dec->stage = MP3_END;
+
+    return -1;
+}
+
+
+/* mp3_side
+ *
+ * 		DESCRIPTION: parses the side information of the frame just read:
+ *		             the scalefactor sharing, and each granule's part
+ *		             lengths, gain, block type, Huffman tables and regions
+ *		INPUTS: dec -- decoder state, with a frame read
+ *		OUTPUTS: dec -- mode extension, scfsi and side
+ *		RETURN VALUE: 0 on success, -1 if the side information is bad
+ *		SIDE EFFECTS: none
+ */
+static int32_t mp3_side(mp3dec_t* dec) {
+
+    const mp3_header_t* hdr = &dec->mp3.hdr;
+    const uint8_t* p = dec->mp3.frame;
+    uint32_t pos = (MP3_HDR_SIZE + (hdr->crc ? MP3_CRC_SIZE : 0)) * 8;
+    uint32_t nch = hdr->channels, g, c, i, r0, r1, bv2;
+    mp3_gr_t* gr;
+
+    dec->mode_ext = hdr->mode == MODE_JOINT ? (p[3] >> 4) & 3 : 0;
+
+    /* main_data_begin, then private bits */
+    if (dec->lsf) {
+        pos += 8 + (nch == 1 ? 1 : 2);
+    } else {
+        pos += 9 + (nch == 1 ? 5 : 3);
+        for (c = 0; c < nch; c++) dec->scfsi[c] = bits_get(p, MP3_MAX_FRAME, &pos, 4);
+    }
+
+    for (g = 0; g < dec->ngr; g++) {
+        for (c = 0; c < nch; c++) {
+            gr = &dec->side[g][c];
+            gr->part2_3_length = bits_get(p, MP3_MAX_FRAME, &pos, 12);
+            gr->big_values = bits_get(p, MP3_MAX_FRAME, &pos, 9);
+            gr->global_gain = bits_get(p, MP3_MAX_FRAME, &pos, 8);
+            gr->scalefac_compress = bits_get(p, MP3_MAX_FRAME, &pos, dec->lsf ? 9 : 4);
+            if (gr->big_values > MAX_BIG_VALUES) return -1;
+
+            if (bits_get(p, MP3_MAX_FRAME, &pos, 1)) {
+                gr->block_type = bits_get(p, MP3_MAX_FRAME, &pos, 2);
+                gr->mixed = bits_get(p, MP3_MAX_FRAME, &pos, 1);
+                if (!gr->block_type) return -1;
+                for (i = 0; i < 2; i++) gr->table_select[i] = bits_get(p, MP3_MAX_FRAME, &pos, 5);
+                gr->table_select[2] = 0;
+                for (i = 0; i < MP3_WINDOWS; i++)
+                    gr->subblock_gain[i] = bits_get(p, MP3_MAX_FRAME, &pos, 3);
+                /* region 1 starts at the fourth short band, or the
+                 * ninth long one; 36 lines at MPEG-1 rates, more at 8 kHz */
+                gr->region1_start = gr->block_type == BLOCK_SHORT ? dec->mixed_end :
+                                    dec->sfb_long[8];
+                gr->region2_start = MP3_GRANULE;
+            } else {
+                gr->block_type = 0;
+                gr->mixed = 0;
+                for (i = 0; i < 3; i++) gr->table_select[i] = bits_get(p, MP3_MAX_FRAME, &pos, 5);
+                for (i = 0; i < MP3_WINDOWS; i++) gr->subblock_gain[i] = 0;
+                r0 = bits_get(p, MP3_MAX_FRAME, &pos, 4);
+                r1 = bits_get(p, MP3_MAX_FRAME, &pos, 3);
+                gr->region1_start = dec->sfb_long[r0 + 1];
+                gr->region2_start = dec->sfb_long[r0 + r1 + 2 < MP3_LONG_BANDS ? r0 + r1 + 2 :
+                                                  MP3_LONG_BANDS];
+            }
+
+            /* MPEG-2 takes the preflag from scalefac_compress */
+            gr->preflag = dec->lsf ? 0 : bits_get(p, MP3_MAX_FRAME, &pos, 1);
+            gr->scalefac_scale = bits_get(p, MP3_MAX_FRAME, &pos, 1);
+            gr->count1_table = bits_get(p, MP3_MAX_FRAME, &pos, 1);
+
+            bv2 = gr->big_values * 2;
+            if (gr->region2_start > bv2) gr->region2_start = bv2;
+            if (gr->region1_start > gr->region2_start) gr->region1_start = gr->region2_start;
+        }
+    }
+
+    return 0;
+}
+
+
+/* mp3_granule
+ *
+ * 		DESCRIPTION: decodes a granule of every channel: scalefactors and
+ *		             Huffman data from the reservoir, requantization and
+ *		             stereo, then each channel through the hybrid
+ *		             filterbank and synthesis into the FIFO
+ *		INPUTS: dec -- decoder state, with a frame read
+ *		OUTPUTS: dec -- a granule more in the FIFO
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_granule(mp3dec_t* dec) {
+
+    uint32_t nch = dec->mp3.hdr.channels, c, i, end;
+    mp3_gr_t* gr;
+
+    for (c = 0; c < nch; c++) {
+        gr = &dec->side[dec->gr][c];
+        if (!dec->frame_ok) {
+            gr->block_type = 0;
+            gr->mixed = 0;
+            dec->nonzero[c] = 0;
+            for (i = 0; i < MP3_GRANULE; i++) dec->xr[c][i] = 0;
+            continue;
+        }
+
+        dec->bit_pos = dec->part_pos;
+        end = dec->part_pos + gr->part2_3_length;
+        if (dec->lsf)
+            mp3_scalefac_lsf(dec, c, gr);
+        else
+            mp3_scalefac(dec, c, gr);
+        mp3_huffman(dec, c, gr, end);
+        dec->part_pos = end;
+
+        mp3_requantize(dec, c, gr);
+    }
+
+    if (nch == 2 && dec->mode_ext && dec->frame_ok) mp3_stereo(dec);
+
+    /* a mono frame in a stereo stream plays on both sides */
+    if (nch < dec->channels) {
+        dec->side[dec->gr][1] = dec->side[dec->gr][0];
+        dec->nonzero[1] = dec->nonzero[0];
+        for (i = 0; i < MP3_GRANULE; i++) dec->xr[1][i] = dec->xr[0][i];
+    }
+
+    for (c = 0; c < dec->channels; c++) {
+        gr = &dec->side[dec->gr][c];
+        if (gr->block_type == BLOCK_SHORT) mp3_reorder(dec, c, gr);
+        mp3_antialias(dec, c, gr);
+        mp3_hybrid(dec, c, gr);
+        mp3_synth(dec, c);
+    }
+    dec->vec_pos = (dec->vec_pos - MP3_SB_LINES) & (MP3_SYNTH_VECS - 1);
+
+    mp3_commit(dec);
+    dec->gr++;
+}
+
+
+/* mp3_scalefac
+ *
+ * 		DESCRIPTION: reads a channel's MPEG-1 scalefactors. Short blocks
+ *		             have three to a band, after the long bands of a mixed
+ *		             block; long blocks can keep groups of bands from the
+ *		             first granule.
+ *		INPUTS: dec -- decoder state, at the start of the channel's part
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- scalefac
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_scalefac(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr) {
+
+    uint8_t* sf = dec->scalefac[ch];
+    uint32_t s1 = slen1[gr->scalefac_compress], s2 = slen2[gr->scalefac_compress];
+    uint32_t k = 0, n, g;
+
+    if (gr->block_type == BLOCK_SHORT) {
+        n = gr->mixed ? dec->mixed_long + 3 * (6 - MIXED_SHORT_SFB) : 3 * 6;
+        while (k < n) sf[k++] = bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, s1);
+        for (n = k + 3 * 6; k < n; k++) sf[k] = bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, s2);
+        while (k < MP3_SCALEFACS) sf[k++] = 0;
+        return;
+    }
+
+    for (g = 0; g < 4; g++) {
+        if (dec->gr && (dec->scfsi[ch] >> (3 - g)) & 1) continue;
+        for (k = scfsi_band[g]; k < scfsi_band[g + 1]; k++)
+            sf[k] = bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, g < 2 ? s1 : s2);
+    }
+    sf[MP3_LONG_BANDS - 1] = 0;
+}
+
+
+/* mp3_scalefac_lsf
+ *
+ * 		DESCRIPTION: reads a channel's MPEG-2 scalefactors, in four groups
+ *		             whose sizes and widths scalefac_compress codes; the
+ *		             right channel of intensity stereo codes them its own
+ *		             way
+ *		INPUTS: dec -- decoder state, at the start of the channel's part
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- scalefac
+ *		         gr -- preflag
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_scalefac_lsf(mp3dec_t* dec, uint32_t ch, mp3_gr_t* gr) {
+
+    uint8_t* sf = dec->scalefac[ch];
+    uint32_t sfc = gr->scalefac_compress, slen[4], tab, row, i, j, k = 0;
+
+    slen[2] = slen[3] = 0;
+    if ((dec->mode_ext & MODE_EXT_IS) && ch == 1) {
+        sfc >>= 1;
+        if (sfc < 180) {
+            slen[0] = sfc / 36;
+            slen[1] = sfc % 36 / 6;
+            slen[2] = sfc % 6;
+            tab = 3;
+        } else if (sfc < 244) {
+            sfc -= 180;
+            slen[0] = (sfc & 63) >> 4;
+            slen[1] = (sfc & 15) >> 2;
+            slen[2] = sfc & 3;
+            tab = 4;
+        } else {
+            sfc -= 244;
+            slen[0] = sfc / 3;
+            slen[1] = sfc % 3;
+            tab = 5;
+        }
+    } else if (sfc < 400) {
+        slen[0] = (sfc >> 4) / 5;
+        slen[1] = (sfc >> 4) % 5;
+        slen[2] = (sfc & 15) >> 2;
+        slen[3] = sfc & 3;
+        tab = 0;
+    } else if (sfc < 500) {
+        sfc -= 400;
+        slen[0] = (sfc >> 2) / 5;
+        slen[1] = (sfc >> 2) % 5;
+        slen[2] = sfc & 3;
+        tab = 1;
+    } else {
+        sfc -= 500;
+        slen[0] = sfc / 3;
+        slen[1] = sfc % 3;
+        tab = 2;
+        gr->preflag = 1;
+    }
+
+    row = gr->block_type != BLOCK_SHORT ? 0 : gr->mixed ? 2 : 1;
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < lsf_nsf[tab][row][i]; j++)
+            sf[k++] = bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, slen[i]);
+    while (k < MP3_SCALEFACS) sf[k++] = 0;
+}
+
+
+/* mp3_huffman
+ *
+ * 		DESCRIPTION: decodes a channel's lines: pairs in three regions each
+ *		             with its own table up to big_values, then quadruples
+ *		             of small values up to the end of the part. A quadruple
+ *		             running past the end is dropped.
+ *		INPUTS: dec -- decoder state, past the channel's scalefactors
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		        end -- bit the part ends at
+ *		OUTPUTS: dec -- xr holding the quantized lines, nonzero
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_huffman(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr, uint32_t end) {
+
+    int32_t* xr = dec->xr[ch];
+    uint32_t region[3], i = 0, r, sel, id, lin, e, k;
+    int32_t q[4];
+
+    region[0] = gr->region1_start;
+    region[1] = gr->region2_start;
+    region[2] = gr->big_values * 2;
+
+    for (r = 0; r < 3; r++) {
+        sel = gr->table_select[r];
+        id = sel < HUFF_T16 ? sel : sel < HUFF_T16 + 8 ? HUFF_T16 : HUFF_T24;
+        lin = linbits[sel];
+        for (; i < region[r]; i += 2) {
+            if (!huff_src[id].n) {
+                xr[i] = xr[i + 1] = 0;
+                continue;
+            }
+            e = mp3_huff_sym(dec, id);
+            xr[i] = mp3_big_value(dec, e >> 4, lin);
+            xr[i + 1] = mp3_big_value(dec, e & 15, lin);
+        }
+    }
+
+    while (i + 4 <= MP3_GRANULE && dec->bit_pos < end) {
+        e = gr->count1_table ? ~bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, 4) & 15 :
+                               mp3_huff_sym(dec, HUFF_QUAD);
+        for (k = 0; k < 4; k++) {
+            q[k] = (e >> (3 - k)) & 1;
+            if (q[k] && bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, 1)) q[k] = -1;
+        }
+        if (dec->bit_pos > end) break;
+        for (k = 0; k < 4; k++) xr[i++] = q[k];
+    }
+
+    dec->nonzero[ch] = i;
+    for (; i < MP3_GRANULE; i++) xr[i] = 0;
+}
+
+
+/* mp3_huff_sym
+ *
+ * 		DESCRIPTION: decodes a codeword, a level of the table at a time
+ *		INPUTS: dec -- decoder state
+ *		        id -- table
+ *		OUTPUTS: dec -- read position past the codeword
+ *		RETURN VALUE: (x << 4) | y, or vwxy for count1 table A
+ *		SIDE EFFECTS: none
+ */
+static uint32_t mp3_huff_sym(mp3dec_t* dec, uint32_t id) {
+
+    const uint16_t* tab = huff_dec + huff_base[id];
+    uint32_t bits = huff_bits[id];
+    uint32_t w = bits_peek(dec->res, MP3_RES_SIZE, dec->bit_pos);
+    uint32_t e = tab[w >> (32 - bits)];
+
+    while (e & HUFF_LINK) {
+        dec->bit_pos += bits;
+        w <<= bits;
+        bits = (e >> 12) & 7;
+        e = tab[(e & 0xFFF) + (w >> (32 - bits))];
+    }
+    dec->bit_pos += (e >> 8) & 0xF;
+
+    return e & 0xFF;
+}
+
+
+/* mp3_big_value
+ *
+ * 		DESCRIPTION: reads the escape and sign bits of a decoded value
+ *		INPUTS: dec -- decoder state
+ *		        v -- value from the table
+ *		        lin -- escape bits of the table, 0 if none
+ *		OUTPUTS: dec -- read position past them
+ *		RETURN VALUE: signed value
+ *		SIDE EFFECTS: none
+ */
+static int32_t mp3_big_value(mp3dec_t* dec, uint32_t v, uint32_t lin) {
+
+    if (lin && v == LINBITS_ESC) v += bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, lin);
+    if (v && bits_get(dec->res, MP3_RES_SIZE, &dec->bit_pos, 1)) return -(int32_t)v;
+
+    return v;
+}
+
+
+/* mp3_requantize
+ *
+ * 		DESCRIPTION: scales a channel's quantized lines band by band by the
+ *		             global gain and the scalefactors, and for short blocks
+ *		             the window's gain
+ *		INPUTS: dec -- decoder state
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- xr holding the Q26 spectrum
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_requantize(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr) {
+
+    const uint16_t* sl = dec->sfb_long;
+    const uint16_t* ss = dec->sfb_short;
+    const uint8_t* sf = dec->scalefac[ch];
+    int32_t* xr = dec->xr[ch];
+    uint32_t n = dec->nonzero[ch], shift = 1 + gr->scalefac_scale, nlong, b, sfb, w, i, end, width;
+    uint32_t k;
+    int32_t gain = (int32_t)gr->global_gain - GAIN_BIAS, exp4;
+
+    /* exponents are in quarter powers of two */
+    nlong = gr->block_type != BLOCK_SHORT ? MP3_LONG_BANDS : gr->mixed ? dec->mixed_long : 0;
+    for (b = 0; b < nlong && sl[b] < n; b++) {
+        exp4 = gain - (int32_t)((sf[b] + (gr->preflag ? pretab[b] : 0)) << shift);
+        for (i = sl[b], end = sl[b + 1]; i < end; i++) xr[i] = mp3_pow43(xr[i], exp4);
+    }
+
+    if (gr->block_type != BLOCK_SHORT) return;
+
+    k = nlong;
+    for (sfb = gr->mixed ? MIXED_SHORT_SFB : 0; sfb < MP3_SHORT_BANDS && 3 * ss[sfb] < n; sfb++) {
+        width = ss[sfb + 1] - ss[sfb];
+        for (w = 0; w < MP3_WINDOWS; w++, k++) {
+            exp4 = gain - (int32_t)(8 * gr->subblock_gain[w] + (sf[k] << shift));
+            for (i = 3 * ss[sfb] + w * width, end = i + width; i < end; i++)
+                xr[i] = mp3_pow43(xr[i], exp4);
+        }
+    }
+}
+
+
+/* mp3_pow43
+ *
+ * 		DESCRIPTION: requantizes a line, |v|^(4/3) * 2^(exp4 / 4). Values
+ *		             past the table are scaled into it by a power of two
+ *		             and interpolated, which is good to better than 1e-5.
+ *		INPUTS: v -- quantized line
+ *		        exp4 -- exponent in quarters
+ *		OUTPUTS: none
+ *		RETURN VALUE: line in Q26, clamped
+ *		SIDE EFFECTS: none
+ */
+static int32_t mp3_pow43(int32_t v, int32_t exp4) {
+
+    uint32_t n = v < 0 ? -v : v, s = 0, idx;
+    uint64_t m;
+    int32_t shift;
+
+    if (!n) return 0;
+
+    if (n < POW43_SIZE) {
+        m = pow43[n];
+    } else {
+        while (n >> s >= POW43_SIZE - 1) s++;
+        idx = n >> s;
+        m = pow43[idx] + (((pow43[idx + 1] - pow43[idx]) * (n & ((1 << s) - 1))) >> s);
+        /* times 2^(4s/3) */
+        m = (m * cbrt2[4 * s % 3] + Q30_HALF) >> Q30_SHIFT;
+        exp4 += 4 * (4 * s / 3);
+    }
+
+    m *= frac4[exp4 & 3];
+    shift = REQ_SHIFT - (exp4 >> 2);
+    if (shift <= 0) {
+        m = SPEC_MAX;
+    } else if (shift >= 64) {
+        m = 0;
+    } else {
+        m = (m + (1ULL << (shift - 1))) >> shift;
+        if (m > SPEC_MAX) m = SPEC_MAX;
+    }
+
+    return v < 0 ? -(int32_t)m : (int32_t)m;
+}
+
+
+/* mp3_stereo
+ *
+ * 		DESCRIPTION: undoes joint stereo. With intensity stereo, the bands
+ *		             above the last nonzero line of the right channel, each
+ *		             window's own for short blocks, carry only the left
+ *		             channel and a position that splits it between the two.
+ *		             Other bands are mid and side if that is on, or already
+ *		             left and right.
+ *		INPUTS: dec -- decoder state, with both channels requantized
+ *		OUTPUTS: dec -- xr holding left and right
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_stereo(mp3dec_t* dec) {
+
+    const mp3_gr_t* gr = &dec->side[dec->gr][1];
+    const uint16_t* sl = dec->sfb_long;
+    const uint16_t* ss = dec->sfb_short;
+    const uint8_t* sf = dec->scalefac[1];
+    const int32_t* r = dec->xr[1];
+    uint32_t bound[MP3_WINDOWS], n, last, b, lbound, nlong, first, sfb, w, width, i, k;
+    int32_t is = dec->mode_ext & MODE_EXT_IS;
+
+    n = dec->nonzero[0] > dec->nonzero[1] ? dec->nonzero[0] : dec->nonzero[1];
+
+    if (gr->block_type != BLOCK_SHORT) {
+        for (last = dec->nonzero[1]; last && !r[last - 1]; last--);
+        for (lbound = 0; sl[lbound] < last; lbound++);
+        for (b = 0; b < MP3_LONG_BANDS && sl[b] < n; b++)
+            mp3_stereo_band(dec, sl[b], sl[b + 1], is && b >= lbound,
+                            sf[b < LAST_LONG_SF ? b : LAST_LONG_SF]);
+    } else {
+        nlong = gr->mixed ? dec->mixed_long : 0;
+        first = gr->mixed ? MIXED_SHORT_SFB : 0;
+
+        for (w = 0; w < MP3_WINDOWS; w++) {
+            for (sfb = MP3_SHORT_BANDS; sfb > first; sfb--) {
+                width = ss[sfb] - ss[sfb - 1];
+                i = 3 * ss[sfb - 1] + w * width;
+                if (mp3_any(r, i, i + width)) break;
+            }
+            bound[w] = sfb;
+        }
+
+        /* a mixed block's long bands only if every window is clear */
+        lbound = nlong;
+        if (nlong && bound[0] == first && bound[1] == first && bound[2] == first) {
+            for (last = dec->mixed_end; last && !r[last - 1]; last--);
+            for (lbound = 0; sl[lbound] < last; lbound++);
+        }
+        for (b = 0; b < nlong; b++) mp3_stereo_band(dec, sl[b], sl[b + 1], is && b >= lbound, sf[b]);
+
+        /* the last band takes the position of the one before */
+        k = nlong;
+        for (sfb = first; sfb < MP3_SHORT_BANDS; sfb++) {
+            width = ss[sfb + 1] - ss[sfb];
+            for (w = 0; w < MP3_WINDOWS; w++, k++) {
+                i = 3 * ss[sfb] + w * width;
+                mp3_stereo_band(dec, i, i + width, is && sfb >= bound[w],
+                                sf[sfb < MP3_SHORT_BANDS - 1 ? k : k - MP3_WINDOWS]);
+            }
+        }
+    }
+
+    dec->nonzero[0] = dec->nonzero[1] = n;
+}
+
+
+/* mp3_stereo_band
+ *
+ * 		DESCRIPTION: turns a band back into left and right. An intensity
+ *		             band scales the left channel by the position's share
+ *		             for each side; MPEG-1's position 7 and up aren't
+ *		             intensity, and fall back to mid and side if it is on.
+ *		INPUTS: dec -- decoder state
+ *		        i, end -- lines of the band
+ *		        is -- 1 if the band is intensity coded
+ *		        pos -- its intensity position
+ *		OUTPUTS: dec -- xr
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_stereo_band(mp3dec_t* dec, uint32_t i, uint32_t end, int32_t is, uint32_t pos) {
+
+    int32_t* l = dec->xr[0];
+    int32_t* r = dec->xr[1];
+    int32_t kl, kr, m, e;
+
+    if (is && (dec->lsf || pos < IS_POSITIONS)) {
+        if (!dec->lsf) {
+            kl = is_left[pos];
+            kr = Q30_ONE - kl;
+        } else {
+            /* MPEG-2 attenuates one side by 2^(-1/4) or 2^(-1/2) a step */
+            e = -(int32_t)((dec->side[dec->gr][1].scalefac_compress & 1) + 1) * ((pos + 1) >> 1);
+            kl = kr = Q30_ONE;
+            if (pos & 1)
+                kl = frac4[e & 3] >> -(e >> 2);
+            else
+                kr = frac4[e & 3] >> -(e >> 2);
+        }
+        for (; i < end; i++) {
+            m = l[i];
+            l[i] = ((int64_t)m * kl + Q30_HALF) >> Q30_SHIFT;
+            r[i] = ((int64_t)m * kr + Q30_HALF) >> Q30_SHIFT;
+        }
+    } else if (dec->mode_ext & MODE_EXT_MS) {
+        for (; i < end; i++) {
+            m = l[i];
+            l[i] = spec_clamp(((int64_t)(m + r[i]) * INV_SQRT2 + Q30_HALF) >> Q30_SHIFT);
+            r[i] = spec_clamp(((int64_t)(m - r[i]) * INV_SQRT2 + Q30_HALF) >> Q30_SHIFT);
+        }
+    }
+}
+
+
+/* mp3_any
+ *
+ * 		DESCRIPTION: checks lines for a nonzero one
+ *		INPUTS: x -- lines
+ *		        i, end -- range to check
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if any is nonzero, else 0
+ *		SIDE EFFECTS: none
+ */
+static int32_t mp3_any(const int32_t* x, uint32_t i, uint32_t end) {
+
+    for (; i < end; i++)
+        if (x[i]) return 1;
+
+    return 0;
+}
+
+
+/* mp3_reorder
+ *
+ * 		DESCRIPTION: puts a short block's lines in subband order, each
+ *		             subband's six lines of the first window, then of the
+ *		             second and the third, as the transform takes them
+ *		INPUTS: dec -- decoder state
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- xr reordered, nonzero
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_reorder(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr) {
+
+    const uint16_t* ss = dec->sfb_short;
+    int32_t* xr = dec->xr[ch];
+    uint32_t sfb = gr->mixed ? MIXED_SHORT_SFB : 0, start = 3 * ss[sfb];
+    uint32_t hi = gr->mixed ? dec->mixed_end : 0, width, w, j, src, dst, sub, line;
+
+    for (; sfb < MP3_SHORT_BANDS; sfb++) {
+        width = ss[sfb + 1] - ss[sfb];
+        src = 3 * ss[sfb];
+        for (w = 0; w < MP3_WINDOWS; w++) {
+            sub = ss[sfb] / MP3_SHORT_LINES;
+            line = ss[sfb] % MP3_SHORT_LINES;
+            for (j = 0; j < width; j++, src++) {
+                dst = sub * MP3_SB_LINES + w * MP3_SHORT_LINES + line;
+                dec->tmp[dst] = xr[src];
+                if (xr[src] && dst >= hi) hi = dst + 1;
+                if (++line == MP3_SHORT_LINES) {
+                    line = 0;
+                    sub++;
+                }
+            }
+        }
+    }
+
+    for (j = start; j < MP3_GRANULE; j++) xr[j] = dec->tmp[j];
+    dec->nonzero[ch] = hi;
+}
+
+
+/* mp3_antialias
+ *
+ * 		DESCRIPTION: reduces the aliasing between neighbouring subbands
+ *		             with butterflies across each boundary, for long blocks
+ *		             and the long part of mixed ones
+ *		INPUTS: dec -- decoder state
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- xr, nonzero covering the lines spread into
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_antialias(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr) {
+
+    int32_t* xr = dec->xr[ch];
+    uint32_t sb, i, n;
+    int32_t a, b;
+
+    if (gr->block_type != BLOCK_SHORT) {
+        n = (dec->nonzero[ch] + MP3_SB_LINES - 1) / MP3_SB_LINES + 1;
+        if (n > MP3_SUBBANDS) n = MP3_SUBBANDS;
+        dec->nonzero[ch] = n * MP3_SB_LINES;
+    } else {
+        n = gr->mixed ? dec->mixed_end / MP3_SB_LINES : 0;
+    }
+
+    for (sb = 1; sb < n; sb++) {
+        for (i = 0; i < ALIAS_LINES; i++) {
+            a = xr[sb * MP3_SB_LINES - 1 - i];
+            b = xr[sb * MP3_SB_LINES + i];
+            xr[sb * MP3_SB_LINES - 1 - i] =
+                spec_clamp(((int64_t)a * alias_cs[i] - (int64_t)b * alias_ca[i] + Q30_HALF) >> Q30_SHIFT);
+            xr[sb * MP3_SB_LINES + i] =
+                spec_clamp(((int64_t)b * alias_cs[i] + (int64_t)a * alias_ca[i] + Q30_HALF) >> Q30_SHIFT);
+        }
+    }
+}
+
+
+/* mp3_hybrid
+ *
+ * 		DESCRIPTION: runs each subband's lines through the inverse MDCT and
+ *		             its window, adds the last granule's second half, and
+ *		             inverts the frequency of every other sample of the odd
+ *		             subbands. Subbands above the last nonzero line only
+ *		             give out their overlap.
+ *		INPUTS: dec -- decoder state
+ *		        ch -- channel
+ *		        gr -- its side information
+ *		OUTPUTS: dec -- sb holding 18 Q26 samples of each subband, overlap
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_hybrid(mp3dec_t* dec, uint32_t ch, const mp3_gr_t* gr) {
+
+    int32_t y[LONG_IMDCT];
+    uint32_t nsb = (dec->nonzero[ch] + MP3_SB_LINES - 1) / MP3_SB_LINES, sb, t, nlong;
+    int32_t* ov;
+    int32_t v;
+
+    nlong = gr->block_type != BLOCK_SHORT ? MP3_SUBBANDS :
+            gr->mixed ? dec->mixed_end / MP3_SB_LINES : 0;
+
+    for (sb = 0; sb < MP3_SUBBANDS; sb++) {
+        ov = dec->overlap[ch][sb];
+        if (sb < nsb) {
+            if (sb < nlong)
+                mp3_imdct36(dec->xr[ch] + sb * MP3_SB_LINES, y,
+                            imdct_win[gr->block_type == BLOCK_SHORT ? 0 : gr->block_type]);
+            else
+                mp3_imdct12(dec->xr[ch] + sb * MP3_SB_LINES, y);
+        } else {
+            for (t = 0; t < LONG_IMDCT; t++) y[t] = 0;
+        }
+
+        for (t = 0; t < MP3_SB_LINES; t++) {
+            v = sat32((int64_t)y[t] + ov[t]);
+            ov[t] = y[MP3_SB_LINES + t];
+            dec->sb[t][sb] = sb & t & 1 ? -v : v;
+        }
+    }
+}
+
+
+/* mp3_imdct36
+ *
+ * 		DESCRIPTION: 36-point inverse MDCT of a subband's 18 lines, with a
+ *		             long window. Half the outputs are computed; the rest
+ *		             are the same or negated.
+ *		INPUTS: x -- lines, Q26
+ *		        win -- window, Q30
+ *		OUTPUTS: y -- windowed outputs, Q26
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_imdct36(const int32_t* x, int32_t* y, const int32_t* win) {
+
+    int32_t t[MP3_SB_LINES];
+    uint32_t i, k;
+    int64_t acc;
+
+    for (i = 0; i < MP3_SB_LINES; i++) {
+        acc = 0;
+        for (k = 0; k < MP3_SB_LINES; k++) acc += (int64_t)x[k] * imdct_long[i][k];
+        t[i] = sat32((acc + IMDCT_HALF) >> IMDCT_SHIFT);
+    }
+
+    for (i = 0; i < 9; i++) {
+        y[i] = -t[8 - i];
+        y[27 + i] = t[17 - i];
+    }
+    for (i = 0; i < MP3_SB_LINES; i++) y[9 + i] = t[i];
+
+    for (i = 0; i < LONG_IMDCT; i++) y[i] = ((int64_t)y[i] * win[i] + Q30_HALF) >> Q30_SHIFT;
+}
+
+
+/* mp3_imdct12
+ *
+ * 		DESCRIPTION: three 12-point inverse MDCTs of a subband's windows,
+ *		             each with the short window and overlapped at a
+ *		             quarter of the 36 outputs
+ *		INPUTS: x -- six lines of each window, Q26
+ *		OUTPUTS: y -- outputs, Q26
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_imdct12(const int32_t* x, int32_t* y) {
+
+    int32_t t[MP3_SHORT_LINES], z[SHORT_IMDCT];
+    uint32_t w, i, k;
+    int64_t acc;
+
+    for (i = 0; i < LONG_IMDCT; i++) y[i] = 0;
+
+    for (w = 0; w < MP3_WINDOWS; w++, x += MP3_SHORT_LINES) {
+        for (i = 0; i < MP3_SHORT_LINES; i++) {
+            acc = 0;
+            for (k = 0; k < MP3_SHORT_LINES; k++) acc += (int64_t)x[k] * imdct_short[i][k];
+            t[i] = sat32((acc + IMDCT_HALF) >> IMDCT_SHIFT);
+        }
+        for (i = 0; i < 3; i++) {
+            z[i] = -t[2 - i];
+            z[9 + i] = t[5 - i];
+        }
+        for (i = 0; i < MP3_SHORT_LINES; i++) z[3 + i] = t[i];
+
+        for (i = 0; i < SHORT_IMDCT; i++)
+            y[6 + 6 * w + i] = sat32(y[6 + 6 * w + i] + (((int64_t)z[i] *
+                                     imdct_win[BLOCK_SHORT][i] + Q30_HALF) >> Q30_SHIFT));
+    }
+}
+
+
+/* mp3_synth
+ *
+ * 		DESCRIPTION: the polyphase synthesis filterbank: each time slot's
+ *		             32 subband samples go through a DCT into the newest of
+ *		             16 vectors, and 32 output samples are windowed sums
+ *		             across them
+ *		INPUTS: dec -- decoder state
+ *		        ch -- channel
+ *		OUTPUTS: dec -- the channel's samples in pcm, vec
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_synth(mp3dec_t* dec, uint32_t ch) {
+
+    int32_t s[MP3_SUBBANDS], x[MP3_SUBBANDS];
+    int64_t acc[MP3_SUBBANDS];
+    uint32_t t, i, j, pos, nch = dec->channels;
+    const int32_t* v0;
+    const int32_t* v1;
+    const int32_t* d;
+    int32_t* v;
+    int16_t* out;
+
+    for (t = 0; t < MP3_SB_LINES; t++) {
+        pos = (dec->vec_pos - 1 - t) & (MP3_SYNTH_VECS - 1);
+
+        for (j = 0; j < MP3_SUBBANDS; j++) s[j] = dec->sb[t][j] >> SYNTH_IN_SHIFT;
+        mp3_dct32(s, x);
+
+        /* the 64-entry vector is the DCT's 32 outputs, mirrored */
+        v = dec->vec[ch][pos];
+        for (i = 0; i < 16; i++) v[i] = x[16 + i];
+        v[16] = 0;
+        for (i = 17; i < 49; i++) v[i] = -x[48 - i];
+        for (i = 49; i < MP3_SYNTH_VEC; i++) v[i] = -x[i - 48];
+
+        for (j = 0; j < MP3_SUBBANDS; j++) acc[j] = 0;
+        for (i = 0; i < 8; i++) {
+            v0 = dec->vec[ch][(pos + 2 * i) & (MP3_SYNTH_VECS - 1)];
+            v1 = dec->vec[ch][(pos + 2 * i + 1) & (MP3_SYNTH_VECS - 1)] + 32;
+            d = synth_win + SYNTH_WIN_PERIOD * i;
+            for (j = 0; j < MP3_SUBBANDS; j++)
+                acc[j] += (int64_t)v0[j] * d[j] + (int64_t)v1[j] * d[32 + j];
+        }
+
+        out = dec->pcm + t * MP3_SUBBANDS * nch + ch;
+        for (j = 0; j < MP3_SUBBANDS; j++)
+            out[j * nch] = fix_sat16((acc[j] + (1 << (SYNTH_OUT_SHIFT - 1))) >> SYNTH_OUT_SHIFT);
+    }
+}
+
+
+/* mp3_dct32
+ *
+ * 		DESCRIPTION: x[m] = sum of s[k] cos((2k + 1) m pi / 64). The odd
+ *		             outputs come from the differences of mirrored inputs,
+ *		             and the even ones split the same way again, which
+ *		             takes 384 multiplies instead of 1024.
+ *		INPUTS: s -- subband samples, Q22
+ *		OUTPUTS: x -- outputs, Q22
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_dct32(const int32_t* s, int32_t* x) {
+
+    int32_t a[16], d[16], b[8], c[8];
+    uint32_t p, k;
+    int64_t acc;
+
+    for (k = 0; k < 16; k++) {
+        a[k] = s[k] + s[31 - k];
+        d[k] = s[k] - s[31 - k];
+    }
+    for (p = 0; p < 16; p++) {
+        acc = 0;
+        for (k = 0; k < 16; k++) acc += (int64_t)d[k] * dct32_odd[p][k];
+        x[2 * p + 1] = sat32((acc + Q30_HALF) >> Q30_SHIFT);
+    }
+
+    for (k = 0; k < 8; k++) {
+        b[k] = a[k] + a[15 - k];
+        c[k] = a[k] - a[15 - k];
+    }
+    for (p = 0; p < 8; p++) {
+        acc = 0;
+        for (k = 0; k < 8; k++) acc += (int64_t)c[k] * dct16_odd[p][k];
+        x[4 * p + 2] = sat32((acc + Q30_HALF) >> Q30_SHIFT);
+
+        acc = 0;
+        for (k = 0; k < 8; k++) acc += (int64_t)b[k] * dct8[p][k];
+        x[4 * p] = sat32((acc + Q30_HALF) >> Q30_SHIFT);
+    }
+}
+
+
+/* mp3_commit
+ *
+ * 		DESCRIPTION: adds the granule in pcm to the FIFO, dropping what
+ *		             comes before a seek's target
+ *		INPUTS: dec -- decoder state
+ *		OUTPUTS: dec -- FIFO, decoded moved on
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void mp3_commit(mp3dec_t* dec) {
+
+    uint32_t ch = dec->channels, drop = 0, wr, i, c;
+
+    /* only while the FIFO is empty, so the dropped frames are its head */
+    if (dec->target > dec->decoded)
+        drop = dec->target - dec->decoded < MP3_GRANULE ? dec->target - dec->decoded : MP3_GRANULE;
+
+    wr = (dec->head + dec->count) & FIFO_MASK;
+    for (i = drop; i < MP3_GRANULE; i++) {
+        for (c = 0; c < ch; c++) dec->fifo[wr * ch + c] = dec->pcm[i * ch + c];
+        wr = (wr + 1) & FIFO_MASK;
+    }
+
+    dec->count += MP3_GRANULE - drop;
+    dec->decoded += MP3_GRANULE;
+}
+
+
+/* bits_peek
+ *
+ * 		DESCRIPTION: looks at the next 32 bits of a buffer, first bit
+ *		             highest; past its end they read as zeros
+ *		INPUTS: buf -- bytes
+ *		        size -- bytes in the buffer
+ *		        pos -- bit position
+ *		OUTPUTS: none
+ *		RETURN VALUE: the bits
+ *		SIDE EFFECTS: none
+ */
+static uint32_t bits_peek(const uint8_t* buf, uint32_t size, uint32_t pos) {
+
+    uint32_t byte = pos >> 3, shift = pos & 7, w = 0, i;
+    const uint8_t* p = buf + byte;
+
+    if (byte + 5 <= size) {
+        w = ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+        return shift ? (w << shift) | (p[4] >> (8 - shift)) : w;
+    }
+
+    for (i = 0; i < 4; i++) w = (w << 8) | (byte + i < size ? p[i] : 0);
+
+    return w << shift;
+}
+
+
+/* bits_get
+ *
+ * 		DESCRIPTION: reads a field of a buffer
+ *		INPUTS: buf -- bytes
+ *		        size -- bytes in the buffer
+ *		        pos -- bit position
+ *		        n -- width of the field, up to 24 bits
+ *		OUTPUTS: pos -- moved past the field
+ *		RETURN VALUE: the field, 0 if n is 0
+ *		SIDE EFFECTS: none
+ */
+static uint32_t bits_get(const uint8_t* buf, uint32_t size, uint32_t* pos, uint32_t n) {
+
+    uint32_t w;
+
+    if (!n) return 0;
+
+    w = bits_peek(buf, size, *pos);
+    *pos += n;
+
+    return w >> (32 - n);
+}
+
+
+/* sat32
+ *
+ * 		DESCRIPTION: clamps a value to 32 bits, symmetrically so it can be
+ *		             negated
+ *		INPUTS: val -- value to clamp
+ *		OUTPUTS: none
+ *		RETURN VALUE: clamped value
+ *		SIDE EFFECTS: none
+ */
+static int32_t sat32(int64_t val) {
+
+    if (val > VAL_MAX) return VAL_MAX;
+    if (val < -VAL_MAX) return -VAL_MAX;
+
+    return val;
+}
+
+
+/* spec_clamp
+ *
+ * 		DESCRIPTION: clamps a line of the spectrum to the filterbank's
+ *		             headroom
+ *		INPUTS: val -- line
+ *		OUTPUTS: none
+ *		RETURN VALUE: clamped line
+ *		SIDE EFFECTS: none
+ */
+static int32_t spec_clamp(int64_t val) {
+
+    if (val > SPEC_MAX) return SPEC_MAX;
+    if (val < -SPEC_MAX) return -SPEC_MAX;
+
+    return val;
+}
@@ -0,0 +1,136 @@
+/* mp3dec.h - MPEG audio Layer III decoder definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _MP3DEC_H
+#define _MP3DEC_H
+
+#include <stdint.h>
+
+#include "mp3.h"
+
+#define MP3_MAX_CHANNELS    2
+#define MP3_GRANULE         576
+#define MP3_SUBBANDS        32
+#define MP3_SB_LINES        18
+#define MP3_SHORT_LINES     6
+#define MP3_WINDOWS         3
+#define MP3_LONG_BANDS      22
+#define MP3_SHORT_BANDS     13
+#define MP3_SCALEFACS       39
+#define MP3_SYNTH_VECS      16
+#define MP3_SYNTH_VEC       64
+
+/* the reservoir reaches back at most 511 bytes of main data, and another
+ * frame's worth is added to it; the last bytes are slack for the bit
+ * reader to look ahead into */
+#define MP3_RES_BACK        511
+#define MP3_RES_SLACK       4
+#define MP3_RES_SIZE        (MP3_RES_BACK + MP3_MAX_FRAME + MP3_RES_SLACK)
+
+/* frames of main data read ahead of a seek; at 32 kbps and 48 kHz that
+ * is the 511 bytes the reservoir can reach back */
+#define MP3_SEEK_FRAMES     9
+
+/* decoded PCM waiting to be read, in frames; a power of two holding a
+ * mono period and a granule */
+#define MP3_FIFO_FRAMES     32768
+
+/* the spectrum and the filterbank's input are Q26, which leaves 5 bits
+ * of headroom over full scale; the synthesis vectors are Q22 */
+#define MP3_SPEC_SHIFT      26
+#define MP3_SYNTH_SHIFT     22
+
+/* decode stages; a granule is one unit of work */
+#define MP3_GRANULES        0
+#define MP3_END             1
+
+/* side information of one granule of one channel */
+typedef struct mp3_gr {
+    uint32_t part2_3_length;
+    uint32_t big_values;
+    uint32_t global_gain;
+    uint32_t scalefac_compress;
+    uint32_t block_type;        /* 0 without window switching */
+    uint32_t mixed;
+    uint32_t table_select[3];
+    uint32_t subblock_gain[3];
+    uint32_t region1_start;     /* in lines */
+    uint32_t region2_start;
+    uint32_t preflag;
+    uint32_t scalefac_scale;
+    uint32_t count1_table;
+} mp3_gr_t;
+
+/* open stream; positions are in frames from the start of the stream */
+typedef struct mp3dec {
+    mp3_t mp3;
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint32_t lsf;               /* 1 for MPEG-2 and 2.5 */
+    uint32_t ngr;               /* granules in a frame */
+    const uint16_t* sfb_long;   /* band starts in lines, by rate */
+    const uint16_t* sfb_short;
+    uint32_t mixed_end;         /* lines of a mixed block's long part */
+    uint32_t mixed_long;        /* long bands in them */
+
+    /* frame being decoded */
+    uint32_t stage;
+    uint32_t gr;                /* next granule of the frame */
+    uint32_t mode_ext;
+    uint32_t frame_ok;          /* 0 if its main data reaches back past
+                                 * what the reservoir holds */
+    uint32_t main_data_begin;
+    uint32_t scfsi[MP3_MAX_CHANNELS];
+    mp3_gr_t side[2][MP3_MAX_CHANNELS];
+    uint32_t part_pos;          /* bit of the next granule's main data */
+
+    /* bit reservoir of main data, and the reader over it */
+    uint32_t res_len;
+    uint8_t res[MP3_RES_SIZE];
+    uint32_t bit_pos;
+
+    /* granule being decoded */
+    uint8_t scalefac[MP3_MAX_CHANNELS][MP3_SCALEFACS];
+    uint32_t nonzero[MP3_MAX_CHANNELS];     /* lines up to the last nonzero */
+    int32_t xr[MP3_MAX_CHANNELS][MP3_GRANULE];
+    int32_t tmp[MP3_GRANULE];
+    int32_t sb[MP3_SB_LINES][MP3_SUBBANDS];
+
+    /* state carried from granule to granule */
+    int32_t overlap[MP3_MAX_CHANNELS][MP3_SUBBANDS][MP3_SB_LINES];
+    int32_t vec[MP3_MAX_CHANNELS][MP3_SYNTH_VECS][MP3_SYNTH_VEC];
+    uint32_t vec_pos;
+    int16_t pcm[MP3_GRANULE * MP3_MAX_CHANNELS];
+
+    /* positions */
+    uint32_t decoded;           /* first frame of the next granule out */
+    uint32_t prime_end;         /* frames before this only fill the
+                                 * reservoir, after a seek */
+    uint32_t target;            /* output before this is dropped */
+
+    /* decoded PCM, interleaved, from frame out_pos */
+    uint32_t head;
+    uint32_t count;
+    uint32_t out_pos;
+    int16_t fifo[MP3_FIFO_FRAMES * MP3_MAX_CHANNELS];
+} mp3dec_t;
+
+
+/* opens a stream at its first audio frame */
+int32_t mp3dec_open(mp3dec_t* dec, const uint8_t* fname);
+
+/* copies the next len bytes of 16-bit PCM, decoding as needed */
+int32_t mp3dec_read(mp3dec_t* dec, int8_t* dst, uint32_t len);
+
+/* decodes a granule ahead of the reads, if there is room */
+int32_t mp3dec_work(mp3dec_t* dec);
+
+/* moves to a frame, so the next read starts there */
+int32_t mp3dec_seek(mp3dec_t* dec, uint32_t frame);
+
+/* closes the stream */
+void mp3dec_close(mp3dec_t* dec);
+
+
+#endif
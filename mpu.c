@@ -0,0 +1,195 @@
+/* mpu.c - MIDI event scheduler implementation file. Events are stamped
+ * with the frame of the PCM stream they belong to and handed to the
+ * MPU-401 driver once the card's sample clock reaches them, so external
+ * synths stay locked to the audio whatever the system's timer does.
+ * Written by Soumithri Bala. */
+
+
+#include "mpu.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* local function definitions */
+static uint32_t mpu_encode(const midi_event_t* ev, uint8_t* msg);
+
+
+/* mpu_init
+ *
+ * 		DESCRIPTION: empties the queue and clears the counts
+ *		INPUTS: mpu -- scheduler state
+ *		OUTPUTS: mpu -- an empty queue
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void mpu_init(mpu_t* mpu) {
+
+    mpu->head = mpu->tail = 0;
+    mpu->out_len = mpu->out_pos = 0;
+    mpu->sent = 0;
+    mpu->dropped = 0;
+    mpu->late_max = 0;
+    mpu->late_sum = 0;
+}
+
+
+/* mpu_post
+ *
+ * 		DESCRIPTION: queues an event to go out at a frame. Events usually
+ *		             come in order, so the place is found from the newest
+ *		             end; ones for the same frame go out in the order they
+ *		             were posted
+ *		INPUTS: mpu -- scheduler state
+ *		        frame -- frame of the PCM stream it's due at
+ *		        ev -- the event, from the sequencer
+ *		OUTPUTS: mpu -- the event, queued
+ *		RETURN VALUE: 0 on success, -1 if the queue is full or the message
+ *		              is too long
+ *		SIDE EFFECTS: none
+ */
+int32_t mpu_post(mpu_t* mpu, int32_t frame, const midi_event_t* ev) {
+
+    uint8_t msg[MPU_MSG_MAX];
+    uint32_t i, prev, len;
+
+    if (!mpu_room(mpu) || !(len = mpu_encode(ev, msg))) {
+        mpu->dropped++;
+        return -1;
+    }
+
+    /* open a slot after the last event due no later than this one */
+    i = mpu->head;
+    while (i != mpu->tail) {
+        prev = (i - 1) & MPU_EVENT_MASK;
+        if (mpu->event[prev].frame <= frame) break;
+        mpu->event[i] = mpu->event[prev];
+        i = prev;
+    }
+
+    mpu->event[i].frame = frame;
+    mpu->event[i].len = len;
+    while (len--) mpu->event[i].msg[len] = msg[len];
+    mpu->head = (mpu->head + 1) & MPU_EVENT_MASK;
+
+    return 0;
+}
+
+
+/* mpu_notes_off
+ *
+ * 		DESCRIPTION: queues all notes off and the sustain pedal up on every
+ *		             channel, so nothing is left hanging on the synth
+ *		INPUTS: mpu -- scheduler state
+ *		        frame -- frame to send them at
+ *		OUTPUTS: mpu -- the events, queued
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void mpu_notes_off(mpu_t* mpu, int32_t frame) {
+
+    midi_event_t ev;
+    uint32_t i;
+
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        ev.status = MIDI_CONTROL | i;
+        ev.data2 = 0;
+        ev.data1 = MIDI_CC_SUSTAIN;
+        mpu_post(mpu, frame, &ev);
+        ev.data1 = MIDI_CC_NOTES_OFF;
+        mpu_post(mpu, frame, &ev);
+    }
+}
+
+
+/* mpu_dispatch
+ *
+ * 		DESCRIPTION: hands the driver every event due by a frame, in one
+ *		             system call; what the driver's ring can't take yet
+ *		             is kept and goes first next time
+ *		INPUTS: mpu -- scheduler state
+ *		        now -- frames the card has played
+ *		OUTPUTS: mpu -- the events sent, taken off the queue
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sends MIDI bytes
+ */
+int32_t mpu_dispatch(mpu_t* mpu, int32_t now) {
+
+    mpu_event_t* ev;
+    int32_t ret;
+    uint32_t i;
+
+    /* finish the last batch before starting another, so nothing is sent
+     * out of order */
+    if (mpu->out_pos < mpu->out_len) {
+        ret = ece391_audio_midi_write(mpu->out + mpu->out_pos, mpu->out_len - mpu->out_pos);
+        if (ret == -1) return -1;
+        mpu->out_pos += ret;
+        if (mpu->out_pos < mpu->out_len) return 0;
+    }
+    mpu->out_len = mpu->out_pos = 0;
+
+    while (mpu->tail != mpu->head) {
+        ev = &mpu->event[mpu->tail];
+        if (ev->frame > now || mpu->out_len + ev->len > MPU_OUT_MAX) break;
+
+        for (i = 0; i < ev->len; i++) mpu->out[mpu->out_len++] = ev->msg[i];
+
+        mpu->sent++;
+        mpu->late_sum += now - ev->frame;
+        if ((uint32_t)(now - ev->frame) > mpu->late_max)
+            mpu->late_max = now - ev->frame;
+        mpu->tail = (mpu->tail + 1) & MPU_EVENT_MASK;
+    }
+
+    if (!mpu->out_len) return 0;
+    if ((ret = ece391_audio_midi_write(mpu->out, mpu->out_len)) == -1) return -1;
+    mpu->out_pos = ret;
+
+    return 0;
+}
+
+
+/* mpu_room
+ *
+ * 		DESCRIPTION: tells how many more events fit in the queue
+ *		INPUTS: mpu -- scheduler state
+ *		OUTPUTS: none
+ *		RETURN VALUE: free slots
+ *		SIDE EFFECTS: none
+ */
+uint32_t mpu_room(const mpu_t* mpu) {
+
+    return (mpu->tail - mpu->head - 1) & MPU_EVENT_MASK;
+}
+
+
+/* mpu_encode
+ *
+ * 		DESCRIPTION: lays out an event as the bytes that go on the wire,
+ *		             with its status byte in full; the driver drops the
+ *		             ones running status makes unneeded
+ *		INPUTS: ev -- the event
+ *		OUTPUTS: msg -- its bytes
+ *		RETURN VALUE: number of bytes, 0 if it doesn't fit
+ *		SIDE EFFECTS: none
+ */
+static uint32_t mpu_encode(const midi_event_t* ev, uint8_t* msg) {
+
+    uint32_t i, type, len = 0;
+
+    if (ev->status < MIDI_SYSEX) {
+        type = ev->status & MIDI_TYPE_MASK;
+        msg[len++] = ev->status;
+        msg[len++] = ev->data1;
+        if (type != MIDI_PROGRAM && type != MIDI_CHAN_PRESSURE) msg[len++] = ev->data2;
+        return len;
+    }
+
+    /* system exclusive carries its own F7; an escape is sent as it is */
+    if (ev->status == MIDI_SYSEX) msg[len++] = MIDI_SYSEX;
+    if (len + ev->len > MPU_MSG_MAX) return 0;
+    for (i = 0; i < ev->len; i++) msg[len++] = ev->data[i];
+
+    return len;
+}
@@ -0,0 +1,60 @@
+/* mpu.h - MIDI event scheduler definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _MPU_H
+#define _MPU_H
+
+#include <stdint.h>
+#include "midi.h"
+
+/* events waiting to be sent, a power of two */
+#define MPU_EVENTS          512
+#define MPU_EVENT_MASK      (MPU_EVENTS - 1)
+
+/* longest message kept; system exclusive past this is dropped */
+#define MPU_MSG_MAX         12
+
+/* bytes handed to the driver in one call */
+#define MPU_OUT_MAX         256
+
+/* one message and the frame of the PCM stream it's due at */
+typedef struct mpu_event {
+    int32_t frame;
+    uint32_t len;
+    uint8_t msg[MPU_MSG_MAX];
+} mpu_event_t;
+
+/* events in frame order, oldest at tail, and bytes the driver hasn't taken
+ * yet; lateness is how far past its frame an event was handed over */
+typedef struct mpu {
+    mpu_event_t event[MPU_EVENTS];
+    uint32_t head;
+    uint32_t tail;
+    uint8_t out[MPU_OUT_MAX];
+    uint32_t out_len;
+    uint32_t out_pos;
+    uint32_t sent;          /* events handed over */
+    uint32_t dropped;       /* events too long or with the queue full */
+    uint32_t late_max;      /* frames */
+    uint32_t late_sum;
+} mpu_t;
+
+
+/* empties the queue and clears the counts */
+void mpu_init(mpu_t* mpu);
+
+/* queues an event for a frame */
+int32_t mpu_post(mpu_t* mpu, int32_t frame, const midi_event_t* ev);
+
+/* queues all notes off on every channel */
+void mpu_notes_off(mpu_t* mpu, int32_t frame);
+
+/* sends what's due by a frame */
+int32_t mpu_dispatch(mpu_t* mpu, int32_t now);
+
+/* tells how many more events fit */
+uint32_t mpu_room(const mpu_t* mpu);
+
+
+#endif
@@ -0,0 +1,147 @@
+/* pull.c - Pull-model audio stream. The client hands over a fill function
+ * instead of watching the interrupt status; each period the driver puts
+ * the process to sleep until a half is free, and the fill is called with
+ * that half and the frames it holds.
+ * Written by Soumithri Bala. */
+
+
+#include "pull.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* local function definitions */
+static void pull_fill(pull_t* p, int32_t half);
+
+
+/* pull_open
+ *
+ * 		DESCRIPTION: opens the stream, has the client fill both halves
+ *		             while the card resets, and starts the DMA
+ *		INPUTS: p -- stream state
+ *		        info_block -- WAV header of the stream
+ *		        fill -- called for each period
+ *		        ctx -- passed to fill
+ *		OUTPUTS: p -- a running stream
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: takes the SB16; fill is called twice
+ */
+int32_t pull_open(pull_t* p, const uint8_t* info_block, pull_fill_t fill,
+                  void* ctx) {
+
+    int32_t buf;
+
+    p->fill = fill;
+    p->ctx = ctx;
+    p->frame_size = info_block[PULL_BLOCK_ALIGN] | (info_block[PULL_BLOCK_ALIGN + 1] << 8);
+    /* a period has to hold whole frames for the halves to stay aligned */
+    if (!fill || !p->frame_size || PULL_HALF_SIZE % p->frame_size) return -1;
+    p->frames = PULL_HALF_SIZE / p->frame_size;
+
+    /* 8-bit samples are unsigned */
+    p->zero = info_block[PULL_BITS] == 8 ? 0x80 : 0;
+
+    if ((buf = ece391_audio_open()) == -1) return -1;
+    p->half[0] = (int8_t*)buf;
+    p->half[1] = (int8_t*)buf + PULL_HALF_SIZE;
+
+    p->ending = 0;
+    p->periods = 0;
+    pull_fill(p, 0);
+    pull_fill(p, 1);
+
+    if (ece391_audio_start(info_block) == -1) {
+        ece391_audio_shutdown();
+        return -1;
+    }
+
+    /* the DMA starts in half 0, so half 1 counts as the last one handed out */
+    p->filled = 1;
+
+    return 0;
+}
+
+
+/* pull_step
+ *
+ * 		DESCRIPTION: sleeps until the DMA is done with a half and has the
+ *		             client fill it; once the client has run dry this
+ *		             waits for the half it ended in to play and closes the
+ *		             stream
+ *		INPUTS: p -- stream state
+ *		OUTPUTS: p -- one more period filled
+ *		RETURN VALUE: 1 while the stream runs, 0 once it has ended, -1 on
+ *		              fail
+ *		SIDE EFFECTS: releases the SB16 when the stream ends or fails
+ */
+int32_t pull_step(pull_t* p) {
+
+    int32_t half;
+
+    half = ece391_audio_wait(p->filled);
+    if (half == -1) {
+        ece391_audio_shutdown();
+        return -1;
+    }
+
+    if (p->ending && half == p->end_half) {
+        ece391_audio_shutdown();
+        return 0;
+    }
+
+    pull_fill(p, half);
+    p->filled = half;
+
+    return 1;
+}
+
+
+/* pull_run
+ *
+ * 		DESCRIPTION: hands each period to the client until it ends the
+ *		             stream
+ *		INPUTS: p -- an open stream
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 when the stream has played out, -1 on fail
+ *		SIDE EFFECTS: releases the SB16
+ */
+int32_t pull_run(pull_t* p) {
+
+    int32_t ret;
+
+    while ((ret = pull_step(p)) == 1);
+
+    return ret;
+}
+
+
+/* pull_fill
+ *
+ * 		DESCRIPTION: has the client fill a half, padding what it leaves
+ *		             with silence; after the client runs dry the half is
+ *		             only silence
+ *		INPUTS: p -- stream state
+ *		        half -- half to fill
+ *		OUTPUTS: p -- ending set if the client came up short
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes the half
+ */
+static void pull_fill(pull_t* p, int32_t half) {
+
+    int8_t* dst = p->half[half];
+    uint32_t n = 0;
+    uint32_t i;
+
+    if (!p->ending) {
+        n = p->fill(p->ctx, dst, p->frames);
+        if (n > p->frames) n = p->frames;
+        if (n < p->frames) {
+            p->ending = 1;
+            p->end_half = half;
+        }
+        p->periods++;
+    }
+
+    for (i = n * p->frame_size; i < PULL_HALF_SIZE; i++) dst[i] = p->zero;
+}
@@ -0,0 +1,47 @@
+/* pull.h - Pull-model audio stream definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _PULL_H
+#define _PULL_H
+
+#include <stdint.h>
+
+/* halves of the driver's buffer, each one period */
+#define PULL_HALVES         2
+#define PULL_HALF_SIZE      (65536 / PULL_HALVES)
+
+/* where the WAV header keeps the frame size and sample width */
+#define PULL_BLOCK_ALIGN    32
+#define PULL_BITS           34
+
+/* called once a period to fill dst with up to frames frames; returning
+ * fewer ends the stream once what it wrote has played */
+typedef uint32_t (*pull_fill_t)(void* ctx, int8_t* dst, uint32_t frames);
+
+typedef struct pull {
+    pull_fill_t fill;
+    void* ctx;
+    int8_t* half[PULL_HALVES];
+    uint32_t frame_size;
+    uint32_t frames;        /* per period */
+    uint8_t zero;           /* silence in a byte of the stream's samples */
+    int32_t filled;         /* half handed to the client last */
+    uint32_t ending;        /* 1 once the client has run dry */
+    int32_t end_half;       /* half it ran dry in */
+    uint32_t periods;       /* periods filled */
+} pull_t;
+
+
+/* opens the stream and has the client fill both halves before starting */
+int32_t pull_open(pull_t* p, const uint8_t* info_block, pull_fill_t fill,
+                  void* ctx);
+
+/* sleeps until a period is free and has the client fill it */
+int32_t pull_step(pull_t* p);
+
+/* runs the stream until the client ends it */
+int32_t pull_run(pull_t* p);
+
+
+#endif
@@ -9,19 +9,104 @@
 volatile int32_t in_use = 0;
 /* global flag to keep track of interrupt status */
 volatile int32_t int_flag = 1;
+/* global flag set while a clip loops in hardware */
+volatile int32_t loop_mode = 0;
+/* sample rate and mode the DSP is currently set to */
+volatile int32_t cur_rate = 0;
+volatile uint8_t cur_bmode = DSP_BMODE;
+/* rate and mode to switch to at the next half boundary */
+volatile int32_t pending_rate = 0;
+volatile uint8_t pending_bmode = DSP_BMODE;
+/* standby policy for after the current stream: -1 off, 0 stay warm
+ * forever, else periods to stay warm; the stream's shutdown clears it, so
+ * it never outlives the process that set it */
+volatile int32_t standby_periods = STANDBY_OFF;
+/* global flag set while DMA runs silence between streams */
+volatile int32_t standby = 0;
+/* policy the card is warm under, and periods spent warm since the last
+ * stream or policy change */
+volatile int32_t standby_limit = STANDBY_OFF;
+volatile int32_t standby_ticks = 0;
+/* interrupts taken while warm, i.e. the CPU cost of standby */
+volatile uint32_t standby_irqs = 0;
+/* progress of an asynchronous open */
+volatile int32_t open_state = OPEN_IDLE;
 /* buffer from which DMA reads */
 int8_t buffer[BUF_DIM][BUF_SIZE];
+/* levels of what each half holds, and of the half now playing */
+sb16_meter_t half_meter[BUF_DIM];
+sb16_meter_t meter_block;
+/* 1 while DMA is paused over silence */
+volatile int32_t paused = 0;
+/* periods played since boot */
+volatile uint32_t meter_periods = 0;
+/* global flag to keep track of FM synthesizer usage */
+volatile int32_t fm_in_use = 0;
+/* global flag to keep track of MPU-401 usage */
+volatile int32_t midi_in_use = 0;
+/* bytes waiting for the UART, and bytes it has received; each ring is
+ * written at its head and read at its tail */
+uint8_t midi_tx[MPU_RING_SIZE];
+uint8_t midi_rx[MPU_RING_SIZE];
+volatile uint32_t tx_head = 0;
+volatile uint32_t tx_tail = 0;
+volatile uint32_t rx_head = 0;
+volatile uint32_t rx_tail = 0;
+/* status byte the receiver last saw from us, for running status */
+volatile uint8_t tx_status = 0;
+/* bytes received with the ring full */
+volatile uint32_t rx_lost = 0;
+/* frames played in whole halves since the stream started */
+volatile int32_t clock_frames = 0;
+/* where writes to the audio device file have got to, and the header
+ * they started with */
+volatile int32_t fd_state = FD_CLOSED;
+uint8_t fd_header[IBLOCK_SIZE];
+uint32_t fd_align = FRAME_SIZE;
+/* bytes written to the file and not yet copied into the buffer; written
+ * at fd_head, read at fd_tail, both counting bytes since the header */
+uint8_t fd_ring[FD_RING_SIZE];
+volatile uint32_t fd_head = 0;
+volatile uint32_t fd_tail = 0;
+/* half the interrupt freed for the ring to refill, or -1; fd_busy is set
+ * while the refill runs */
+volatile int32_t fd_pending = -1;
+volatile int32_t fd_busy = 0;
+/* refills in a row that found the ring empty, and refills that came up
+ * short while the file was still being written */
+volatile int32_t fd_empty = 0;
+volatile uint32_t fd_underruns = 0;
+volatile int32_t fd_closing = 0;
 
 
 /* local function definitions */
 int32_t sb16_reset();
+int32_t wav_header_check(const uint8_t* info_block);
+uint8_t wav_header_mode(const uint8_t* info_block);
+void dma_buffer_init(uint16_t buf_length);
 uint8_t dsp_read();
 void dsp_write(uint8_t command);
+int32_t dsp_try_write(uint8_t command);
+int32_t dsp_retune(uint16_t sample_rate, uint8_t bmode);
 void dsp_init(uint16_t sample_rate, uint8_t bcommand, uint8_t bmode, uint16_t block_length);
 void dma_init(uint16_t buf_offset, uint16_t buf_length, uint8_t buf_page);
 void sb16_interrupt(void);
 uint8_t lo_byte(uint16_t word);
 uint8_t hi_byte(uint16_t word);
+int32_t fm_detect();
+void fm_clear();
+void fm_out(uint32_t reg, uint8_t val);
+void half_done();
+int32_t half_frames(uint8_t bmode);
+int32_t dma_frames();
+int32_t mpu_command(uint8_t cmd);
+void mpu_receive();
+void mpu_send();
+uint32_t fd_put(const uint8_t* buf, uint32_t nbytes);
+uint32_t fd_take(int32_t half);
+int32_t fd_start();
+int32_t fd_wait(uint32_t room);
+void fd_work();
 
 
 /* sb16_init
@@ -34,9 +119,8 @@ uint8_t hi_byte(uint16_t word);
  */
 int32_t sb16_init(const uint8_t* info_block) {
 
-    uint8_t buf_page;
-    uint8_t wav_check[FOUR_B + 1] = {0, 0, 0, 0, 0};
-    uint16_t sample_rate, buf_offset;
+    int32_t sample_rate, warm;
+    uint8_t bmode;
 
     /* enable interrupts from the SB16 */
     enable_irq(SB16_IRQ_LINE);
@@ -47,62 +131,412 @@ int32_t sb16_init(const uint8_t* info_block) {
         return -1;
     }
 
+    /* DMA is already running silence; skip the reset and hand over the
+     * buffer, so the stream starts in the next free half */
+    if (standby && (warm = sb16_resume(info_block)) != -1) return warm;
+
     /* check if soundcard gets initialized properly */
     if (sb16_reset() == -1) {
         printf("SB16 initialization failed. Check hardware.\n");
         return -1;
     }
 
-    /* check file */
-    if (!info_block) {
-        printf("Info block invalid.\n");
+    /* check file and load sample rate */
+    if ((sample_rate = wav_header_check(info_block)) == -1) return -1;
+    bmode = wav_header_mode(info_block);
+    cur_rate = sample_rate;
+    cur_bmode = bmode;
+    pending_rate = 0;
+    loop_mode = 0;
+
+    /* initialize dma */
+    dma_buffer_init((BUF_SIZE) - 1);
+
+    /* initialize dsp */
+    dsp_init(sample_rate, DSP_BCOMMAND, bmode, (BUF_SIZE / BUF_DIM) - 1);
+
+    /* set flags high */
+    in_use = 1;
+    int_flag = 1;
+    clock_frames = 0;
+
+    /* return pointer to buffer */
+    return (int32_t)buffer;
+}
+
+
+/* sb16_resume
+ *
+ * 		DESCRIPTION: takes over the SB16 while standby is running silence,
+ *		             so a stream can start in the next free half without
+ *		             a reset. The check and the claim are made with
+ *		             interrupts off, so standby can't run out in between
+ *		INPUTS: info_block -- WAV header block with file data
+ *		OUTPUTS: none
+ *		RETURN VALUE: buffer -- address of buffer, or -1 if the card isn't
+ *		              warm, the header is bad or the card is in use
+ *		SIDE EFFECTS: sb16_interrupt reprograms the DSP at the next boundary
+ *		              if the rate or mode changes
+ */
+int32_t sb16_resume(const uint8_t* info_block) {
+
+    int32_t sample_rate;
+    uint8_t bmode;
+
+    if ((sample_rate = wav_header_check(info_block)) == -1) return -1;
+    bmode = wav_header_mode(info_block);
+
+    cli();
+    if (in_use || !standby) {
+        sti();
         return -1;
     }
+    standby = 0;
+    in_use = 1;
 
-    /* copy and reverse wav magic numbers because format is big endian */
-    memcpy(wav_check, (info_block + WAV_MAGIC_LOC), FOUR_B);
-    strrev((int8_t*)wav_check);
+    /* the half playing is standby's silence in the old format; the free
+     * half holds the stream's first data, so the change takes effect as
+     * the DMA crosses into it, as sb16_reconfigure's does */
+    if (bmode != cur_bmode || sample_rate != cur_rate) {
+        pending_bmode = bmode;
+        pending_rate = sample_rate;
+    } else {
+        pending_rate = 0;
+    }
 
-    /* check if valid */
-    if (*((uint32_t*)wav_check) != WAV_MAGIC) {
-        printf("Not a wav file.\n");
+    /* the stream's first frame plays once the current half is done */
+    clock_frames = -half_frames(cur_bmode);
+    sti();
+
+    return (int32_t)buffer;
+}
+
+
+/* sb16_open
+ *
+ * 		DESCRIPTION: reserves the SB16 and starts its reset without waiting
+ *		             for the DSP, so the caller can fill the buffer while
+ *		             the card comes up
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: buffer -- address of buffer, or -1 on fail
+ *		SIDE EFFECTS: starts resetting the SB16
+ */
+int32_t sb16_open() {
+
+    int i;
+
+    /* enable interrupts from the SB16 */
+    enable_irq(SB16_IRQ_LINE);
+
+    /* check if the card is already in use */
+    if (in_use) {
+        printf("Another process is using the SB16. Terminate it and try again.\n");
         return -1;
     }
 
-    /* check if audio is compressed */
-    if (*((uint16_t*)(info_block + WAV_FORMAT_LOC)) != 1) {
-        printf("Only uncompressed music is supported.\n");
+    /* reserve the card; this open resets it whatever state it was in */
+    in_use = 1;
+    standby = 0;
+    loop_mode = 0;
+    pending_rate = 0;
+
+    /* the reset pulse only needs 3us; each ISA write takes about 1us */
+    outb(1, SB16_RESET_PORT);
+    for (i = 0; i < RESET_DELAY; i++) outb(0, IO_DELAY_PORT);
+    outb(0, SB16_RESET_PORT);
+
+    open_state = OPEN_RESET;
+
+    /* return pointer to buffer */
+    return (int32_t)buffer;
+}
+
+
+/* sb16_open_status
+ *
+ * 		DESCRIPTION: checks, without blocking, whether the DSP has answered
+ *		             the reset started by sb16_open
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if ready, 0 if still resetting, -1 on fail
+ *		SIDE EFFECTS: consumes the DSP's reset reply
+ */
+int32_t sb16_open_status() {
+
+    if (open_state == OPEN_READY) return 1;
+    if (open_state != OPEN_RESET) return -1;
+
+    /* nothing to read yet */
+    if (!(inb(SB16_POLL_PORT) & BUF_RDY_VAL)) return 0;
+
+    if (inb(SB16_READ_PORT) != SUCCESS_VAL) {
+        open_state = OPEN_FAILED;
         return -1;
     }
 
-    /* check if audio is stereo */
-    if ((*((uint16_t*)(info_block + WAV_NCHANNELS_LOC)) != NCHANNELS) ||
-            (*((uint16_t*)(info_block + BPSAMPLE_LOC)) != _16BITS)) {
-        printf("Only 16-bit stereo audio is supported.\n");
+    open_state = OPEN_READY;
+    return 1;
+}
+
+
+/* sb16_start
+ *
+ * 		DESCRIPTION: finishes an asynchronous open and starts playback of
+ *		             whatever the caller has put in the buffer
+ *		INPUTS: info_block -- WAV header block with file data
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sets SB16 and DMA settings
+ */
+int32_t sb16_start(const uint8_t* info_block) {
+
+    int32_t sample_rate, ready;
+    uint8_t bmode;
+    int i = TWOTO16;
+
+    /* only valid after sb16_open */
+    if (open_state == OPEN_IDLE) return -1;
+
+    /* the caller's reads have usually covered the reset already */
+    while (!(ready = sb16_open_status()) && i--);
+
+    /* check if soundcard got initialized properly */
+    if (ready != 1) {
+        printf("SB16 initialization failed. Check hardware.\n");
+        open_state = OPEN_IDLE;
+        in_use = 0;
         return -1;
     }
 
-    /* load sample rate */
-    sample_rate = *((uint16_t*)(info_block + SAMPLE_RATE_LOC));
+    /* check file and load sample rate */
+    if ((sample_rate = wav_header_check(info_block)) == -1) {
+        open_state = OPEN_IDLE;
+        in_use = 0;
+        return -1;
+    }
+    bmode = wav_header_mode(info_block);
+    cur_rate = sample_rate;
+    cur_bmode = bmode;
+    open_state = OPEN_IDLE;
 
-    /* calculate buffer offset; align to 64KB page */
-    buf_offset = ((uint32_t)buffer >> 1) % TWOTO16;
+    /* initialize dma */
+    dma_buffer_init((BUF_SIZE) - 1);
 
-    /* find buffer page */
-    buf_page = (uint32_t)buffer >> _16BITS;
+    /* initialize dsp */
+    dsp_init(sample_rate, DSP_BCOMMAND, bmode, (BUF_SIZE / BUF_DIM) - 1);
+
+    int_flag = 1;
+    clock_frames = 0;
+
+    return 0;
+}
+
+
+/* sb16_reconfigure
+ *
+ * 		DESCRIPTION: queues a new rate and format to take effect when the
+ *		             DMA crosses into the next half, without a reset
+ *		INPUTS: info_block -- WAV header block of the new content
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sb16_interrupt reprograms the DSP at the next boundary
+ */
+int32_t sb16_reconfigure(const uint8_t* info_block) {
+
+    int32_t sample_rate;
+
+    /* a looped clip has no half boundaries */
+    if (!in_use || loop_mode) return -1;
+
+    /* check file and load sample rate */
+    if ((sample_rate = wav_header_check(info_block)) == -1) return -1;
+
+    pending_bmode = wav_header_mode(info_block);
+    pending_rate = sample_rate;
+
+    return 0;
+}
+
+
+/* sb16_loop
+ *
+ * 		DESCRIPTION: copies a short clip into the buffer once and lets
+ *		             auto-init DMA repeat it with no refills
+ *		INPUTS: info_block -- WAV header block with file data
+ *		        clip -- PCM data of the clip
+ *		        length -- length of clip in bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sets SB16 and DMA settings, overwrites buffer
+ */
+int32_t sb16_loop(const uint8_t* info_block, const int8_t* clip, uint32_t length) {
+
+    int32_t sample_rate;
+    uint32_t reps, i, align;
+    uint16_t loop_length;
+
+    /* enable interrupts from the SB16 */
+    enable_irq(SB16_IRQ_LINE);
+
+    /* check if the card is already in use */
+    if (in_use) {
+        printf("Another process is using the SB16. Terminate it and try again.\n");
+        return -1;
+    }
+
+    /* check file and load sample rate */
+    if ((sample_rate = wav_header_check(info_block)) == -1) return -1;
+
+    /* clip must be whole frames of its own format and fit in the DMA
+     * window; a mono frame is half a stereo one */
+    align = *((uint16_t*)(info_block + BLOCK_ALIGN_LOC));
+    if (!align) align = FRAME_SIZE;
+    if (!clip || !length || (length % align) || length > BUF_DIM * BUF_SIZE) {
+        printf("Loop clip must be whole frames and at most 64KB.\n");
+        return -1;
+    }
+
+    /* loop lengths differ from the standby layout, so always reset */
+    standby = 0;
+
+    /* check if soundcard gets initialized properly */
+    if (sb16_reset() == -1) {
+        printf("SB16 initialization failed. Check hardware.\n");
+        return -1;
+    }
+
+    cur_rate = sample_rate;
+    cur_bmode = wav_header_mode(info_block);
+    pending_rate = 0;
+
+    /* repeat the clip as many whole times as fit, so short clips don't
+     * interrupt more often than needed */
+    reps = (BUF_DIM * BUF_SIZE) / length;
+    for (i = 0; i < reps; i++)
+        memcpy((int8_t*)buffer + i * length, clip, length);
+
+    /* DMA count and DSP block length are both in 16-bit words; matching
+     * them to the clip makes the wraparound land exactly on the loop point */
+    loop_length = (uint16_t)((reps * length) / _16B_MODE - 1);
 
     /* initialize dma */
-    dma_init(buf_offset, (BUF_SIZE) - 1, buf_page);
+    dma_buffer_init(loop_length);
 
-    /* initialize dsp */
-    dsp_init(sample_rate, DSP_BCOMMAND, DSP_BMODE, (BUF_SIZE / BUF_DIM) - 1);
+    /* initialize dsp with one block per pass of the window */
+    dsp_init(sample_rate, DSP_BCOMMAND, cur_bmode, loop_length);
 
     /* set flags high */
     in_use = 1;
     int_flag = 1;
+    loop_mode = 1;
 
-    /* return pointer to buffer */
-    return (int32_t)buffer;
+    return 0;
+}
+
+
+/* sb16_meter_post
+ *
+ * 		DESCRIPTION: takes the levels of a half the producer just filled;
+ *		             they're published when the DMA reaches that half
+ *		INPUTS: half -- index of the half that was filled
+ *		        stats -- its levels
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_meter_post(int32_t half, const sb16_meter_t* stats) {
+
+    if (!in_use || !stats || half < 0 || half >= BUF_DIM) return -1;
+
+    memcpy(&half_meter[half], stats, sizeof(sb16_meter_t));
+
+    return 0;
+}
+
+
+/* sb16_meter_read
+ *
+ * 		DESCRIPTION: copies out the levels of the half now playing, which
+ *		             any process may read
+ *		INPUTS: none
+ *		OUTPUTS: stats -- levels, stamped with the period they started
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_meter_read(sb16_meter_t* stats) {
+
+    if (!stats) return -1;
+
+    /* the interrupt handler rewrites the block at each boundary */
+    cli();
+    memcpy(stats, &meter_block, sizeof(sb16_meter_t));
+    sti();
+
+    return 0;
+}
+
+
+/* sb16_pause
+ *
+ * 		DESCRIPTION: pauses or resumes 16-bit DMA where it is, so a long
+ *		             silence costs no interrupts
+ *		INPUTS: on -- 1 to pause, 0 to resume
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: stops or restarts the DSP's DMA requests
+ */
+int32_t sb16_pause(int32_t on) {
+
+    /* only a started stream has DMA to pause */
+    if (!in_use || loop_mode || open_state != OPEN_IDLE) return -1;
+
+    if (on && !paused) dsp_write(DSP_PAUSE_16);
+    if (!on && paused) dsp_write(DSP_RESUME_16);
+    paused = on ? 1 : 0;
+
+    return 0;
+}
+
+
+/* sb16_restart
+ *
+ * 		DESCRIPTION: restarts playback from the top of the buffer, for a
+ *		             seek; the caller pauses with sb16_pause, refills both
+ *		             halves and calls this, and the DMA and DSP are
+ *		             reprogrammed without a reset
+ *		INPUTS: info_block -- WAV header block of the new content
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sets SB16 and DMA settings
+ */
+int32_t sb16_restart(const uint8_t* info_block) {
+
+    int32_t sample_rate;
+
+    if (!in_use || loop_mode || open_state != OPEN_IDLE) return -1;
+    if ((sample_rate = wav_header_check(info_block)) == -1) return -1;
+
+    /* stop where it is, if the caller didn't already */
+    if (!paused) dsp_write(DSP_PAUSE_16);
+
+    /* the clock carries on from where the DMA stopped */
+    cli();
+    clock_frames += dma_frames();
+    sti();
+
+    cur_rate = sample_rate;
+    cur_bmode = wav_header_mode(info_block);
+    pending_rate = 0;
+
+    /* the new block command starts over from the first half */
+    dma_buffer_init((BUF_SIZE) - 1);
+    dsp_init(cur_rate, DSP_BCOMMAND, cur_bmode, (BUF_SIZE / BUF_DIM) - 1);
+
+    int_flag = 1;
+    paused = 0;
+
+    return 0;
 }
 
 
@@ -116,59 +550,675 @@ int32_t sb16_init(const uint8_t* info_block) {
  */
 int32_t sb16_copy_status() {
 
-    return int_flag;
+    return int_flag;
+}
+
+
+/* sb16_shutdown
+ *
+ * 		DESCRIPTION: calls reset and flags, or leaves DMA running silence
+ *		             if standby is enabled
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success
+ *		SIDE EFFECTS: resets the SB16, or zeroes buffer
+ */
+int32_t sb16_shutdown() {
+
+    int32_t periods = standby_periods;
+
+    pending_rate = 0;
+
+    /* the policy was set for this stream only */
+    standby_periods = STANDBY_OFF;
+
+    /* nothing more is posted, so publish silence from here on */
+    memset(half_meter, 0, sizeof(half_meter));
+
+    /* standby needs DMA running */
+    if (paused) {
+        dsp_write(DSP_RESUME_16);
+        paused = 0;
+    }
+
+    /* keep the card warm; looped clips use their own DMA layout, and an
+     * open that never started has no DMA running */
+    if (periods >= 0 && !loop_mode && open_state == OPEN_IDLE) {
+        memset(buffer, 0, sizeof(buffer));
+        standby_limit = periods;
+        standby_ticks = 0;
+        standby = 1;
+        in_use = 0;
+        return 0;
+    }
+
+    /* call reset to clear SB16 values */
+    sb16_reset();
+
+    /* set flags to original values */
+    in_use = 0;
+    int_flag = 1;
+    standby = 0;
+    open_state = OPEN_IDLE;
+
+    return 0;
+}
+
+
+/* sb16_standby
+ *
+ * 		DESCRIPTION: sets how long the card stays warm after the next
+ *		             shutdown
+ *		INPUTS: periods -- -1 to turn standby off, 0 to stay warm until
+ *		                   the next stream, else periods to stay warm;
+ *		                   STANDBY_QUERY leaves the policy as is
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if DMA is currently running silence, else 0
+ *		SIDE EFFECTS: a new policy restarts the standby countdown under
+ *		              it; turning standby off may stop the SB16
+ */
+int32_t sb16_standby(int32_t periods) {
+
+    if (periods == STANDBY_QUERY) return standby;
+
+    if (periods != standby_periods) {
+        standby_periods = periods;
+        standby_limit = periods;
+        standby_ticks = 0;
+    }
+
+    /* turning standby off while warm stops the card */
+    if (periods == STANDBY_OFF && standby && !in_use) {
+        sb16_reset();
+        int_flag = 1;
+        standby = 0;
+    }
+
+    return standby;
+}
+
+
+/* sb16_standby_irqs
+ *
+ * 		DESCRIPTION: reports the interrupts taken while warm, i.e. the CPU
+ *		             cost of standby
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: interrupts taken in standby since boot
+ *		SIDE EFFECTS: none
+ */
+uint32_t sb16_standby_irqs() {
+
+    return standby_irqs;
+}
+
+
+/* sb16_fm_open
+ *
+ * 		DESCRIPTION: reserves the OPL3, which plays alongside the DSP and
+ *		             needs no DMA, and clears it in OPL3 mode with all 18
+ *		             two-operator voices
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: resets the OPL3
+ */
+int32_t sb16_fm_open() {
+
+    if (fm_in_use) {
+        printf("Another process is using the FM synthesizer.\n");
+        return -1;
+    }
+
+    if (fm_detect() == -1) {
+        printf("No OPL3 found. Check hardware.\n");
+        return -1;
+    }
+
+    /* the second bank only answers in OPL3 mode */
+    fm_in_use = 1;
+    fm_out(FM_REG_OPL3, 1);
+    fm_clear();
+
+    return 0;
+}
+
+
+/* sb16_fm_write
+ *
+ * 		DESCRIPTION: writes a batch of OPL3 registers, so a tick's changes
+ *		             cost one system call
+ *		INPUTS: writes -- each (register << 8) | value, with 0x100 set in
+ *		                  the register for the second bank
+ *		        n -- number of writes, at most FM_MAX_WRITES
+ *		OUTPUTS: none
+ *		RETURN VALUE: number written on success, -1 on fail
+ *		SIDE EFFECTS: programs the OPL3
+ */
+int32_t sb16_fm_write(const uint32_t* writes, uint32_t n) {
+
+    uint32_t i;
+
+    if (!fm_in_use || !writes || n > FM_MAX_WRITES) return -1;
+
+    for (i = 0; i < n; i++)
+        fm_out((writes[i] >> 8) & FM_REG_MASK, writes[i] & 0xFF);
+
+    return n;
+}
+
+
+/* sb16_fm_close
+ *
+ * 		DESCRIPTION: silences the OPL3, puts it back in OPL2 mode and
+ *		             releases it
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: resets the OPL3
+ */
+int32_t sb16_fm_close() {
+
+    if (!fm_in_use) return -1;
+
+    fm_clear();
+    fm_out(FM_REG_OPL3, 0);
+    fm_in_use = 0;
+
+    return 0;
+}
+
+
+/* sb16_midi_open
+ *
+ * 		DESCRIPTION: reserves the MPU-401 and puts it in UART mode, where
+ *		             bytes pass straight through to and from the MIDI port
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: resets the MPU-401, empties both rings
+ */
+int32_t sb16_midi_open() {
+
+    int32_t ok;
+
+    /* the MPU-401 raises the SB16's own IRQ */
+    enable_irq(SB16_IRQ_LINE);
+
+    if (midi_in_use) {
+        printf("Another process is using the MIDI port.\n");
+        return -1;
+    }
+
+    /* the acknowledgements come back through the data port, so keep the
+     * interrupt handler from taking them; a UART already in UART mode
+     * doesn't acknowledge the reset, so it gets a second one */
+    cli();
+    ok = mpu_command(MPU_RESET) != -1 || mpu_command(MPU_RESET) != -1;
+    ok = ok && mpu_command(MPU_UART_MODE) != -1;
+    tx_head = tx_tail = 0;
+    rx_head = rx_tail = 0;
+    tx_status = 0;
+    rx_lost = 0;
+    sti();
+
+    if (!ok) {
+        printf("No MPU-401 found. Check hardware.\n");
+        return -1;
+    }
+
+    midi_in_use = 1;
+
+    return 0;
+}
+
+
+/* sb16_midi_read
+ *
+ * 		DESCRIPTION: takes the bytes received so far
+ *		INPUTS: buf -- where to put them
+ *		        n -- most to take
+ *		OUTPUTS: buf -- bytes received, oldest first
+ *		RETURN VALUE: number taken on success, -1 on fail
+ *		SIDE EFFECTS: sends queued bytes the UART has room for
+ */
+int32_t sb16_midi_read(uint8_t* buf, uint32_t n) {
+
+    uint32_t i;
+
+    if (!midi_in_use || !buf) return -1;
+
+    cli();
+    for (i = 0; i < n && rx_tail != rx_head; i++) {
+        buf[i] = midi_rx[rx_tail];
+        rx_tail = (rx_tail + 1) & MPU_RING_MASK;
+    }
+    mpu_send();
+    sti();
+
+    return i;
+}
+
+
+/* sb16_midi_write
+ *
+ * 		DESCRIPTION: queues bytes for the UART, dropping each channel status
+ *		             byte that repeats the last one sent so the receiver
+ *		             plays it with running status; at 31250 baud every
+ *		             byte is 320us, and a repeated status is a third of
+ *		             a note message
+ *		INPUTS: buf -- MIDI bytes, whole messages or not
+ *		        n -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: number taken on success, which is less than n once
+ *		              the ring is full, -1 on fail
+ *		SIDE EFFECTS: sends queued bytes the UART has room for
+ */
+int32_t sb16_midi_write(const uint8_t* buf, uint32_t n) {
+
+    uint32_t i;
+    uint8_t byte;
+
+    if (!midi_in_use || !buf) return -1;
+
+    cli();
+    for (i = 0; i < n; i++) {
+        byte = buf[i];
+
+        /* real-time bytes may go between any two others and leave running
+         * status alone; other system messages cancel it */
+        if (byte >= MIDI_STATUS_BIT && byte < MIDI_REALTIME) {
+            if (byte == tx_status) continue;
+            tx_status = (byte < MIDI_SYSTEM) ? byte : 0;
+        }
+
+        if (((tx_head + 1) & MPU_RING_MASK) == tx_tail) {
+            /* the caller sends this status again with the rest */
+            if (byte >= MIDI_STATUS_BIT && byte < MIDI_SYSTEM) tx_status = 0;
+            break;
+        }
+        midi_tx[tx_head] = byte;
+        tx_head = (tx_head + 1) & MPU_RING_MASK;
+    }
+    mpu_send();
+    sti();
+
+    return i;
+}
+
+
+/* sb16_midi_close
+ *
+ * 		DESCRIPTION: waits for the queued bytes to go out, then resets the
+ *		             MPU-401 and releases it
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: resets the MPU-401
+ */
+int32_t sb16_midi_close() {
+
+    int i = MPU_DRAIN_WAIT;
+
+    if (!midi_in_use) return -1;
+
+    while (tx_tail != tx_head && i--) {
+        cli();
+        mpu_send();
+        sti();
+        outb(0, IO_DELAY_PORT);
+    }
+
+    cli();
+    mpu_command(MPU_RESET);
+    tx_head = tx_tail = 0;
+    midi_in_use = 0;
+    sti();
+
+    return 0;
+}
+
+
+/* sb16_clock
+ *
+ * 		DESCRIPTION: tells how many frames of the stream have played, from
+ *		             the DMA's place in the buffer, so MIDI can be timed
+ *		             against the audio; it's negative until a stream that
+ *		             started warm reaches its first frame
+ *		INPUTS: frames -- where to put the count
+ *		OUTPUTS: frames -- frames played
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: sends queued MIDI bytes the UART has room for
+ */
+int32_t sb16_clock(int32_t* frames) {
+
+    /* the UART raises no interrupt when it can take a byte, so callers
+     * that keep time also keep it fed */
+    if (midi_in_use) {
+        cli();
+        mpu_send();
+        sti();
+    }
+
+    if (!frames || !in_use || loop_mode || open_state != OPEN_IDLE) return -1;
+
+    cli();
+    *frames = clock_frames + dma_frames();
+    sti();
+
+    return 0;
+}
+
+
+/* sb16_wait
+ *
+ * 		DESCRIPTION: sleeps until the DMA is done with a half other than the
+ *		             one the caller filled last, so a client can be handed
+ *		             each period in turn instead of polling the status; the
+ *		             CPU halts between interrupts
+ *		INPUTS: half -- the half the caller filled last
+ *		OUTPUTS: none
+ *		RETURN VALUE: the half that is free to fill, or -1 if there's no
+ *		              running stream to wait on or it stops while waiting
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_wait(int32_t half) {
+
+    int32_t free_half;
+
+    if (!in_use || loop_mode || paused || open_state != OPEN_IDLE) return -1;
+
+    cli();
+    while (int_flag == half && in_use && !paused) {
+        /* sti holds interrupts off for one more instruction, so one that
+         * comes after the check still wakes the hlt */
+        asm volatile("sti; hlt; cli" : : : "memory");
+    }
+    free_half = (in_use && !paused) ? int_flag : -1;
+    sti();
+
+    return free_half;
+}
+
+
+/* sb16_fd_open
+ *
+ * 		DESCRIPTION: opens the SB16 as a file to be written; the card is
+ *		             only taken once the header comes
+ *		INPUTS: filename -- ignored
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the card or the file is in use
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_fd_open(const uint8_t* filename) {
+
+    (void)filename;
+
+    if (in_use || fd_state != FD_CLOSED) return -1;
+
+    fd_state = FD_HEADER;
+
+    return 0;
+}
+
+
+/* sb16_fd_read
+ *
+ * 		DESCRIPTION: sleeps until a period is writable, that is until the
+ *		             ring has room for a period, so a read is the file's
+ *		             wait for its next period, as a read of the RTC is for
+ *		             its next tick
+ *		INPUTS: fd -- ignored
+ *		        buf -- ignored
+ *		        nbytes -- ignored
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 once a period is writable, -1 if the stream stopped
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_fd_read(int32_t fd, void* buf, int32_t nbytes) {
+
+    (void)fd;
+    (void)buf;
+    (void)nbytes;
+
+    if (fd_state == FD_CLOSED) return -1;
+
+    /* until the DMA starts the ring is never full */
+    if (fd_state != FD_RUN) return 0;
+
+    return fd_wait(BUF_SIZE);
+}
+
+
+/* sb16_fd_write
+ *
+ * 		DESCRIPTION: the first write is the stream's WAV header, which
+ *		             starts the card's reset; the samples after it go into
+ *		             a ring several periods deep, in writes of any size,
+ *		             and the interrupt copies a period at a time from it
+ *		             into each half as the DMA frees it. The DMA starts
+ *		             once two periods are in, and a write only sleeps while
+ *		             the ring is full
+ *		INPUTS: fd -- ignored
+ *		        buf -- header, or samples
+ *		        nbytes -- bytes in buf
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes taken, which is all of them unless the stream
+ *		              stops, or -1 on fail
+ *		SIDE EFFECTS: may start the SB16
+ */
+int32_t sb16_fd_write(int32_t fd, const void* buf, int32_t nbytes) {
+
+    int32_t done = 0;
+
+    (void)fd;
+
+    if (!buf || nbytes < 0 || fd_state == FD_CLOSED) return -1;
+
+    if (fd_state == FD_HEADER) {
+        if (nbytes < IBLOCK_SIZE || wav_header_check(buf) == -1) return -1;
+        memcpy(fd_header, buf, IBLOCK_SIZE);
+        fd_align = *((uint16_t*)(fd_header + BLOCK_ALIGN_LOC));
+        if (!fd_align) fd_align = FRAME_SIZE;
+        if (sb16_open() == -1) return -1;
+        fd_head = fd_tail = 0;
+        fd_pending = -1;
+        fd_empty = 0;
+        fd_underruns = 0;
+        fd_closing = 0;
+        fd_state = FD_PRIME;
+        return IBLOCK_SIZE;
+    }
+
+    while (done < nbytes) {
+        done += fd_put((const uint8_t*)buf + done, nbytes - done);
+
+        /* both halves are filled from the ring while the card resets */
+        if (fd_state == FD_PRIME && fd_head - fd_tail >= BUF_SIZE * BUF_DIM) {
+            if (fd_start() == -1) return -1;
+        }
+
+        if (done < nbytes && fd_wait(1) == -1) break;
+    }
+
+    return done ? done : -1;
+}
+
+
+/* sb16_fd_poll
+ *
+ * 		DESCRIPTION: tells without blocking whether a period is writable,
+ *		             for a wait on several files; the SB16's interrupt is
+ *		             what wakes such a wait when a refill makes room
+ *		INPUTS: fd -- ignored
+ *		OUTPUTS: none
+ *		RETURN VALUE: SB16_POLL_OUT if a period's write won't block, else
+ *		              0; -1 if the stream stopped
+ *		SIDE EFFECTS: none
+ */
+int32_t sb16_fd_poll(int32_t fd) {
+
+    (void)fd;
+
+    if (fd_state == FD_CLOSED) return -1;
+    if (fd_state != FD_RUN) return SB16_POLL_OUT;
+    if (!in_use || paused) return -1;
+
+    return FD_RING_SIZE - (fd_head - fd_tail) >= BUF_SIZE ? SB16_POLL_OUT : 0;
+}
+
+
+/* sb16_fd_close
+ *
+ * 		DESCRIPTION: lets what was written play out, then releases the
+ *		             card; a stream too short to have started is started
+ *		             first
+ *		INPUTS: fd -- ignored
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0
+ *		SIDE EFFECTS: sleeps until the last period has played, stops the
+ *		              SB16
+ */
+int32_t sb16_fd_close(int32_t fd) {
+
+    (void)fd;
+
+    fd_closing = 1;
+
+    if (fd_state == FD_PRIME && fd_head != fd_tail) fd_start();
+
+    /* the half the ring emptied into has played once the refill after it
+     * comes up empty as well */
+    if (fd_state == FD_RUN) {
+        cli();
+        while (fd_empty < BUF_DIM && in_use && !paused)
+            asm volatile("sti; hlt; cli" : : : "memory");
+        sti();
+    }
+
+    if (fd_state != FD_HEADER && fd_state != FD_CLOSED) sb16_shutdown();
+    fd_state = FD_CLOSED;
+
+    return 0;
+}
+
+
+/* sb16_reset
+ *
+ * 		DESCRIPTION: sends reset signal and waits
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 or above on success, -1 on fail
+ *		SIDE EFFECTS: resets the SB16
+ */
+int32_t sb16_reset() {
+
+    int i;
+
+    /* write 1 to reset port */
+    outb(1, SB16_RESET_PORT);
+
+    /* make system wait */
+    for (i = 0; i < TWOTO16; i++) asm volatile("");
+
+    /* write 0 to reset port */
+    outb(0, SB16_RESET_PORT);
+
+    /* check if read port returned success */
+    i = WAITLOOP;
+    while ((dsp_read() != SUCCESS_VAL) && i--);
+    i--;
+
+    /* returns -1 on failure, 0 or above on success */
+    return i;
+}
+
+
+/* wav_header_check
+ *
+ * 		DESCRIPTION: validates a WAV header block
+ *		INPUTS: info_block -- WAV header block with file data
+ *		OUTPUTS: none
+ *		RETURN VALUE: sample rate on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t wav_header_check(const uint8_t* info_block) {
+
+    uint8_t wav_check[FOUR_B + 1] = {0, 0, 0, 0, 0};
+
+    /* check file */
+    if (!info_block) {
+        printf("Info block invalid.\n");
+        return -1;
+    }
+
+    /* copy and reverse wav magic numbers because format is big endian */
+    memcpy(wav_check, (info_block + WAV_MAGIC_LOC), FOUR_B);
+    strrev((int8_t*)wav_check);
+
+    /* check if valid */
+    if (*((uint32_t*)wav_check) != WAV_MAGIC) {
+        printf("Not a wav file.\n");
+        return -1;
+    }
+
+    /* check if audio is compressed */
+    if (*((uint16_t*)(info_block + WAV_FORMAT_LOC)) != 1) {
+        printf("Only uncompressed music is supported.\n");
+        return -1;
+    }
+
+    /* check if audio is 16-bit mono or stereo */
+    if ((*((uint16_t*)(info_block + WAV_NCHANNELS_LOC)) != NCHANNELS &&
+            *((uint16_t*)(info_block + WAV_NCHANNELS_LOC)) != MONO) ||
+            (*((uint16_t*)(info_block + BPSAMPLE_LOC)) != _16BITS)) {
+        printf("Only 16-bit mono or stereo audio is supported.\n");
+        return -1;
+    }
+
+    /* load sample rate */
+    return *((uint16_t*)(info_block + SAMPLE_RATE_LOC));
 }
 
 
-/* sb16_shutdown
+/* wav_header_mode
  *
- * 		DESCRIPTION: calls reset and flags
- *		INPUTS: none
+ * 		DESCRIPTION: picks the DSP mode for a checked WAV header block
+ *		INPUTS: info_block -- WAV header block with file data
  *		OUTPUTS: none
- *		RETURN VALUE: 0 on success
- *		SIDE EFFECTS: resets the SB16
+ *		RETURN VALUE: DSP mode byte for signed mono or stereo
+ *		SIDE EFFECTS: none
  */
-int32_t sb16_shutdown() {
-
-    /* call reset to clear SB16 values */
-    sb16_reset();
+uint8_t wav_header_mode(const uint8_t* info_block) {
 
-    /* set flags to original values */
-    in_use = 0;
-    int_flag = 1;
+    if (*((uint16_t*)(info_block + WAV_NCHANNELS_LOC)) == MONO)
+        return DSP_BMODE_MONO;
 
-    return 0;
+    return DSP_BMODE;
 }
 
 
-/* sb16_reset
+/* dma_buffer_init
  *
- * 		DESCRIPTION: sends reset signal and waits
- *		INPUTS: none
+ * 		DESCRIPTION: points the DMA at buffer
+ *		INPUTS: buf_length -- length of buffer to be played, in words, minus one
  *		OUTPUTS: none
- *		RETURN VALUE: 0 or above on success, -1 on fail
- *		SIDE EFFECTS: resets the SB16
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sets values in and initializes DMA
  */
-int32_t sb16_reset() {
+void dma_buffer_init(uint16_t buf_length) {
 
-    int i;
-
-    /* write 1 to reset port */
-    outb(1, SB16_RESET_PORT);
-
-    /* make system wait */
-    for (i = 0; i < TWOTO16; i++) asm volatile("");
+    uint8_t buf_page;
+    uint16_t buf_offset;
 
-    /* write 0 to reset port */
-    outb(0, SB16_RESET_PORT);
+    /* calculate buffer offset; align to 64KB page */
+    buf_offset = ((uint32_t)buffer >> 1) % TWOTO16;
 
-    /* check if read port returned success */
-    i = WAITLOOP;
-    while ((dsp_read() != SUCCESS_VAL) && i--);
-    i--;
+    /* find buffer page */
+    buf_page = (uint32_t)buffer >> _16BITS;
 
-    /* returns -1 on failure, 0 or above on success */
-    return i;
+    /* initialize dma */
+    dma_init(buf_offset, buf_length, buf_page);
 }
 
 
@@ -208,6 +1258,54 @@ void dsp_write(uint8_t command) {
 }
 
 
+/* dsp_try_write
+ *
+ * 		DESCRIPTION: writes to DSP, giving up if it stays busy; for the
+ *		             interrupt handler, which can't spin on a hung card
+ *		INPUTS: command -- command to be written
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the DSP never became ready
+ *		SIDE EFFECTS: sets commands in DSP
+ */
+int32_t dsp_try_write(uint8_t command) {
+
+    int i = DSP_ISR_WAIT;
+
+    while ((inb(SB16_WRITE_PORT) & BUF_RDY_VAL) && i--);
+    if (i < 0) return -1;
+    outb(command, SB16_WRITE_PORT);
+
+    return 0;
+}
+
+
+/* dsp_retune
+ *
+ * 		DESCRIPTION: sends the rate and block command of dsp_init with
+ *		             bounded waits, from the interrupt handler
+ *		INPUTS: sample_rate -- sample rate of the next half
+ *		        bmode -- DSP mode of the next half
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the DSP stopped taking bytes
+ *		SIDE EFFECTS: sets values in DSP
+ */
+int32_t dsp_retune(uint16_t sample_rate, uint8_t bmode) {
+
+    uint16_t block_length = (BUF_SIZE / BUF_DIM) - 1;
+
+    if (dsp_try_write(DSP_OUT_RATE_CMD) == -1 ||
+        dsp_try_write(hi_byte(sample_rate)) == -1 ||
+        dsp_try_write(lo_byte(sample_rate)) == -1 ||
+        dsp_try_write(DSP_BCOMMAND) == -1 ||
+        dsp_try_write(bmode) == -1 ||
+        dsp_try_write(lo_byte(block_length)) == -1 ||
+        dsp_try_write(hi_byte(block_length)) == -1)
+        return -1;
+
+    return 0;
+}
+
+
 /* dsp_init
  *
  * 		DESCRIPTION: initializes the DSP with correct values
@@ -291,23 +1389,38 @@ void dma_init(uint16_t buf_offset, uint16_t buf_length, uint8_t buf_page) {
  *		INPUTS: none
  *		OUTPUTS: none
  *		RETURN VALUE: none
- *		SIDE EFFECTS: reverses flag and acknowledges interrupt
+ *		SIDE EFFECTS: reverses flag and acknowledges interrupt, takes MIDI
+ *		              bytes received
  */
 void sb16_interrupt(void) {
 
+    uint8_t status;
+
     /* interrupt setup */
     asm volatile("pushal");
     cli();
 
-    /* toggle flag */
-    int_flag = !int_flag;
+    /* see which of the DSP and the MPU-401 raised it; a mixer that
+     * doesn't say is taken to mean the DSP */
+    outb(MIXR_IRQ_STATUS, SB16_MIXR_PORT);
+    status = inb(SB16_MIXR_DATA_PORT);
+
+    if (status & IRQ_MPU401) mpu_receive();
+    if (midi_in_use) mpu_send();
 
-    /* acknowledge interrupt */
-    inb(SB16_POLL_PORT_16);
+    if ((status & IRQ_DMA16) || !(status & IRQ_MPU401)) {
+        half_done();
+
+        /* acknowledge interrupt */
+        inb(SB16_POLL_PORT_16);
+    }
 
     /* eoi routine */
     send_eoi(SB16_IRQ_LINE);
     sti();
+
+    /* deferred work, with interrupts on */
+    fd_work();
     asm volatile("          \n\
                   popal     \n\
                   leave     \n\
@@ -316,6 +1429,419 @@ void sb16_interrupt(void) {
 }
 
 
+/* fm_detect
+ *
+ * 		DESCRIPTION: checks for an OPL3 by running its first timer, which
+ *		             only a real chip sets the status bits for; an OPL2
+ *		             also sets bits the OPL3 leaves clear
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 if there is an OPL3, -1 if not
+ *		SIDE EFFECTS: stops the chip's timers
+ */
+int32_t fm_detect() {
+
+    uint8_t before, after;
+    int i;
+
+    /* stop both timers and clear their flags */
+    fm_out(FM_REG_TIMER_CTRL, FM_TIMER_MASK);
+    fm_out(FM_REG_TIMER_CTRL, FM_IRQ_RESET);
+    before = inb(FM_STATUS_PORT);
+
+    /* timer 1 overflows 80us after starting at 0xFF */
+    fm_out(FM_REG_TIMER1, FM_TIMER1_FAST);
+    fm_out(FM_REG_TIMER_CTRL, FM_TIMER1_START);
+    for (i = 0; i < FM_TIMER_WAIT; i++) outb(0, IO_DELAY_PORT);
+    after = inb(FM_STATUS_PORT);
+
+    fm_out(FM_REG_TIMER_CTRL, FM_TIMER_MASK);
+    fm_out(FM_REG_TIMER_CTRL, FM_IRQ_RESET);
+
+    if ((before & FM_STATUS_MASK) || (after & FM_STATUS_MASK) != FM_TIMER1_FIRED)
+        return -1;
+    if (after & FM_OPL2_BITS) return -1;
+
+    return 0;
+}
+
+
+/* fm_clear
+ *
+ * 		DESCRIPTION: keys off every channel of both banks, then zeroes their
+ *		             operator and channel registers
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: silences the OPL3
+ */
+void fm_clear() {
+
+    uint32_t i;
+
+    for (i = 0; i < FM_CHANNELS; i++) {
+        fm_out(FM_REG_KEY + i, 0);
+        fm_out(FM_BANK + FM_REG_KEY + i, 0);
+    }
+
+    fm_out(FM_REG_4OP, 0);
+    for (i = FM_FIRST_REG; i < FM_BANK_REGS; i++) {
+        fm_out(i, 0);
+        fm_out(FM_BANK + i, 0);
+    }
+}
+
+
+/* fm_out
+ *
+ * 		DESCRIPTION: writes an OPL3 register; the chip needs about 2us
+ *		             between writes, and each ISA write takes about 1us
+ *		INPUTS: reg -- register, with FM_BANK set for the second bank
+ *		        val -- value
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sets the register
+ */
+void fm_out(uint32_t reg, uint8_t val) {
+
+    int i;
+
+    if (reg & FM_BANK) {
+        outb(reg & 0xFF, FM_ADDR2_PORT);
+        for (i = 0; i < FM_WRITE_DELAY; i++) outb(0, IO_DELAY_PORT);
+        outb(val, FM_DATA2_PORT);
+    } else {
+        outb(reg, FM_ADDR_PORT);
+        for (i = 0; i < FM_WRITE_DELAY; i++) outb(0, IO_DELAY_PORT);
+        outb(val, FM_DATA_PORT);
+    }
+    for (i = 0; i < FM_WRITE_DELAY; i++) outb(0, IO_DELAY_PORT);
+}
+
+
+/* half_done
+ *
+ * 		DESCRIPTION: moves playback on to the next half once the DSP has
+ *		             finished one
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: reverses flag, may reprogram the DSP
+ */
+void half_done() {
+
+    /* toggle flag */
+    int_flag = !int_flag;
+
+    /* the ring refills the half just freed once the interrupt is done */
+    if (fd_state == FD_RUN) fd_pending = int_flag;
+
+    /* the half just finished played in the format it was filled in */
+    clock_frames += half_frames(cur_bmode);
+
+    /* publish the levels of the half the DMA has just moved into */
+    meter_periods++;
+    memcpy(&meter_block, &half_meter[!int_flag], sizeof(sb16_meter_t));
+    meter_block.period = meter_periods;
+
+    /* the DMA has just crossed into the next half, which holds the first
+     * data in the new format; reprogram rate and block command only. A
+     * DSP that stops taking bytes has hung, so the change is dropped
+     * rather than spinning here with the system waiting */
+    if (pending_rate) {
+        if (dsp_retune(pending_rate, pending_bmode) == 0) {
+            cur_rate = pending_rate;
+            cur_bmode = pending_bmode;
+        }
+        pending_rate = 0;
+    }
+
+    /* count the cost of standby, and stop auto-init DMA once it runs out */
+    if (standby) {
+        standby_irqs++;
+        if (standby_limit && ++standby_ticks >= standby_limit) {
+            dsp_try_write(EXIT_AUTO_DMA);
+            standby = 0;
+        }
+    }
+}
+
+
+/* half_frames
+ *
+ * 		DESCRIPTION: returns how many frames a half holds in a mode
+ *		INPUTS: bmode -- DSP mode of the half
+ *		OUTPUTS: none
+ *		RETURN VALUE: frames in one half
+ *		SIDE EFFECTS: none
+ */
+int32_t half_frames(uint8_t bmode) {
+
+    /* the DMA counts 16-bit words, and a stereo frame is two */
+    if (bmode == DSP_BMODE_MONO) return BUF_SIZE / BUF_DIM;
+    return BUF_SIZE / BUF_DIM / NCHANNELS;
+}
+
+
+/* dma_frames
+ *
+ * 		DESCRIPTION: returns how far the DMA is into the half that is
+ *		             playing, counting a half it finished whose interrupt
+ *		             hasn't been taken yet; called with interrupts off
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: frames played since clock_frames was last counted
+ *		SIDE EFFECTS: none
+ */
+int32_t dma_frames() {
+
+    uint16_t count;
+    uint8_t hi;
+    int32_t done, half, frames;
+
+    /* words left in the pass, less one; the count isn't latched, so read
+     * it again until the high byte holds still across a read */
+    outb(0, DMA_CLR_PTR_PORT);
+    count = inb(DMA_COUNT_PORT);
+    count |= inb(DMA_COUNT_PORT) << 8;
+    do {
+        hi = hi_byte(count);
+        count = inb(DMA_COUNT_PORT);
+        count |= inb(DMA_COUNT_PORT) << 8;
+    } while (hi_byte(count) != hi);
+
+    done = (BUF_SIZE - 1) - count;
+    half = done / (BUF_SIZE / BUF_DIM);
+    done %= BUF_SIZE / BUF_DIM;
+    if (cur_bmode != DSP_BMODE_MONO) done /= NCHANNELS;
+
+    frames = done;
+    if (half != !int_flag) frames += half_frames(cur_bmode);
+
+    return frames;
+}
+
+
+/* mpu_command
+ *
+ * 		DESCRIPTION: sends the MPU-401 a command and waits for it to be
+ *		             acknowledged; called with interrupts off
+ *		INPUTS: cmd -- command
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: runs the command
+ */
+int32_t mpu_command(uint8_t cmd) {
+
+    int i = MPU_WAIT;
+
+    while ((inb(MPU_STAT_PORT) & MPU_DRR) && i--);
+    if (i < 0) return -1;
+    outb(cmd, MPU_CMD_PORT);
+
+    /* MIDI bytes may arrive ahead of the acknowledgement */
+    i = MPU_WAIT;
+    while (i--) {
+        if (!(inb(MPU_STAT_PORT) & MPU_DSR) && inb(MPU_DATA_PORT) == MPU_ACK)
+            return 0;
+    }
+
+    return -1;
+}
+
+
+/* mpu_receive
+ *
+ * 		DESCRIPTION: moves what the UART has received into the ring; called
+ *		             with interrupts off
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: counts bytes lost to a full ring
+ */
+void mpu_receive() {
+
+    uint8_t byte;
+
+    while (!(inb(MPU_STAT_PORT) & MPU_DSR)) {
+        byte = inb(MPU_DATA_PORT);
+        if (((rx_head + 1) & MPU_RING_MASK) == rx_tail) {
+            rx_lost++;
+            continue;
+        }
+        midi_rx[rx_head] = byte;
+        rx_head = (rx_head + 1) & MPU_RING_MASK;
+    }
+}
+
+
+/* mpu_send
+ *
+ * 		DESCRIPTION: hands the UART as many queued bytes as it has room
+ *		             for; called with interrupts off
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sends MIDI bytes
+ */
+void mpu_send() {
+
+    while (tx_tail != tx_head && !(inb(MPU_STAT_PORT) & MPU_DRR)) {
+        outb(midi_tx[tx_tail], MPU_DATA_PORT);
+        tx_tail = (tx_tail + 1) & MPU_RING_MASK;
+    }
+}
+
+
+/* fd_put
+ *
+ * 		DESCRIPTION: copies as much of a write into the ring as there is
+ *		             room for
+ *		INPUTS: buf -- samples
+ *		        nbytes -- bytes in buf
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes copied
+ *		SIDE EFFECTS: advances fd_head, so close waits for them to play
+ */
+uint32_t fd_put(const uint8_t* buf, uint32_t nbytes) {
+
+    uint32_t head = fd_head & FD_RING_MASK;
+    uint32_t n = FD_RING_SIZE - (fd_head - fd_tail);
+    uint32_t first;
+
+    if (n > nbytes) n = nbytes;
+    first = FD_RING_SIZE - head;
+    if (first > n) first = n;
+
+    memcpy(fd_ring + head, buf, first);
+    memcpy(fd_ring, buf + first, n - first);
+
+    /* the refill only reads up to fd_head, so it moves after the copy */
+    fd_head += n;
+    if (n) fd_empty = 0;
+
+    return n;
+}
+
+
+/* fd_take
+ *
+ * 		DESCRIPTION: copies up to a period of whole frames from the ring
+ *		             into a half and pads the rest of it with silence
+ *		INPUTS: half -- half to fill
+ *		OUTPUTS: none
+ *		RETURN VALUE: bytes taken from the ring
+ *		SIDE EFFECTS: writes the DMA buffer, advances fd_tail
+ */
+uint32_t fd_take(int32_t half) {
+
+    uint32_t tail = fd_tail & FD_RING_MASK;
+    uint32_t n = fd_head - fd_tail;
+    uint32_t first;
+
+    if (n > BUF_SIZE) n = BUF_SIZE;
+    n -= n % fd_align;
+    first = FD_RING_SIZE - tail;
+    if (first > n) first = n;
+
+    memcpy(buffer[half], fd_ring + tail, first);
+    memcpy(buffer[half] + first, fd_ring, n - first);
+    memset(buffer[half] + n, 0, BUF_SIZE - n);
+
+    fd_tail += n;
+
+    return n;
+}
+
+
+/* fd_start
+ *
+ * 		DESCRIPTION: fills both halves from the ring and starts the DMA
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: starts the SB16
+ */
+int32_t fd_start() {
+
+    fd_take(0);
+    fd_take(1);
+
+    if (sb16_start(fd_header) == -1) {
+        fd_state = FD_HEADER;
+        return -1;
+    }
+
+    fd_state = FD_RUN;
+
+    return 0;
+}
+
+
+/* fd_wait
+ *
+ * 		DESCRIPTION: sleeps until the ring has room for a number of bytes
+ *		INPUTS: room -- bytes wanted
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 once there's room, -1 if the stream stopped
+ *		SIDE EFFECTS: none
+ */
+int32_t fd_wait(uint32_t room) {
+
+    int32_t ret;
+
+    cli();
+    while (FD_RING_SIZE - (fd_head - fd_tail) < room && in_use && !paused)
+        asm volatile("sti; hlt; cli" : : : "memory");
+    ret = (in_use && !paused) ? 0 : -1;
+    sti();
+
+    return ret;
+}
+
+
+/* fd_work
+ *
+ * 		DESCRIPTION: refills the half the interrupt freed from the ring;
+ *		             run at the end of the interrupt with interrupts back
+ *		             on, so the copy doesn't hold up the rest of the system
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes the DMA buffer
+ */
+void fd_work() {
+
+    int32_t half;
+    uint32_t n;
+
+    /* an interrupt that lands during a copy leaves its half to the copy
+     * already running, which takes it before finishing */
+    cli();
+    if (fd_busy) {
+        sti();
+        return;
+    }
+    fd_busy = 1;
+
+    while ((half = fd_pending) >= 0) {
+        fd_pending = -1;
+        sti();
+
+        n = fd_take(half);
+        fd_empty = n ? 0 : fd_empty + 1;
+
+        /* the writer fell behind, so the half was padded with silence */
+        if (n < BUF_SIZE && !fd_closing) fd_underruns++;
+
+        cli();
+    }
+
+    fd_busy = 0;
+    sti();
+}
+
+
 /* lo_byte
  *
  * 		DESCRIPTION: returns low byte of input word
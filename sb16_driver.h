@@ -23,7 +23,10 @@
 #define DSP_OUT_RATE_CMD    0x41
 #define DSP_BCOMMAND        0xB6
 #define DSP_BMODE           0x30
+#define DSP_BMODE_MONO      0x10
 #define EXIT_AUTO_DMA       0xD9
+#define DSP_PAUSE_16        0xD5
+#define DSP_RESUME_16       0xD6
 
 #define DMA_BASE_ADDR       0xC4
 #define DMA_COUNT_PORT      0xC6
@@ -41,14 +44,24 @@
 #define _16B_MODE           0x2
 #define SAMPLE_RATE_OUT_CMD 0x41
 #define WAITLOOP            100
+#define DSP_ISR_WAIT        64
+#define IO_DELAY_PORT       0x80
+#define RESET_DELAY         4
+
+#define OPEN_IDLE           0
+#define OPEN_RESET          1
+#define OPEN_READY          2
+#define OPEN_FAILED         3
 
 #define WAV_MAGIC_LOC       8
 #define WAV_FORMAT_LOC      20
 #define WAV_NCHANNELS_LOC   22
 #define SAMPLE_RATE_LOC     24
+#define BLOCK_ALIGN_LOC     32
 #define BPSAMPLE_LOC        34
 #define WAV_MAGIC           0x57415645
 #define NCHANNELS           2
+#define MONO                1
 #define _16BITS             16
 
 #define IBLOCK_SIZE         44
@@ -56,16 +69,141 @@
 #define BUF_DIM             2
 #define BUF_SIZE            (65536 / 2)
 
+#define FRAME_SIZE          4
+#define STANDBY_OFF         (-1)
+#define STANDBY_QUERY       (-2)
+
+/* audio device file: the WAV header is written first, then samples in
+ * writes of any size; the DMA starts once two periods are in */
+#define FD_CLOSED           0
+#define FD_HEADER           1
+#define FD_PRIME            2
+#define FD_RUN              3
+/* samples written to the file wait in a ring of a few periods */
+#define FD_RING_PERIODS     4
+#define FD_RING_SIZE        (BUF_SIZE * FD_RING_PERIODS)
+#define FD_RING_MASK        (FD_RING_SIZE - 1)
+/* readiness reported by the file's poll hook */
+#define SB16_POLL_OUT       0x01
+
+/* OPL3 FM synthesizer; the second register bank has its own address and
+ * data ports */
+#define FM_ADDR_PORT        0x388
+#define FM_DATA_PORT        0x389
+#define FM_ADDR2_PORT       0x38A
+#define FM_DATA2_PORT       0x38B
+#define FM_STATUS_PORT      0x388
+#define FM_BANK             0x100
+#define FM_REG_MASK         0x1FF
+#define FM_BANK_REGS        0x100
+#define FM_MAX_WRITES       512
+#define FM_CHANNELS         9
+#define FM_REG_TIMER1       0x02
+#define FM_REG_TIMER_CTRL   0x04
+#define FM_REG_KEY          0xB0
+#define FM_REG_4OP          0x104
+#define FM_REG_OPL3         0x105
+#define FM_TIMER_MASK       0x60
+#define FM_IRQ_RESET        0x80
+#define FM_TIMER1_START     0x21
+#define FM_TIMER1_FAST      0xFF
+#define FM_STATUS_MASK      0xE0
+#define FM_TIMER1_FIRED     0xC0
+#define FM_OPL2_BITS        0x06
+#define FM_FIRST_REG        0x20
+#define FM_TIMER_WAIT       100
+#define FM_WRITE_DELAY      2
+
+/* the DSP and the MPU-401 share the IRQ line; the mixer's interrupt status
+ * register says which raised it */
+#define SB16_MIXR_DATA_PORT 0x225
+#define MIXR_IRQ_STATUS     0x82
+#define IRQ_DMA16           0x02
+#define IRQ_MPU401          0x04
+
+/* MPU-401 UART */
+#define MPU_DATA_PORT       0x330
+#define MPU_STAT_PORT       0x331
+#define MPU_CMD_PORT        0x331
+#define MPU_DRR             0x40
+#define MPU_DSR             0x80
+#define MPU_RESET           0xFF
+#define MPU_UART_MODE       0x3F
+#define MPU_ACK             0xFE
+#define MPU_WAIT            TWOTO16
+#define MPU_DRAIN_WAIT      (TWOTO16 * 8)
+#define MPU_RING_SIZE       1024
+#define MPU_RING_MASK       (MPU_RING_SIZE - 1)
+#define MIDI_STATUS_BIT     0x80
+#define MIDI_SYSTEM         0xF0
+#define MIDI_REALTIME       0xF8
+
+/* levels of one period, as the producer measured them */
+typedef struct sb16_meter {
+    uint32_t period;            /* periods played when this one started */
+    uint32_t channels;
+    uint16_t peak[NCHANNELS];   /* largest magnitude */
+    uint16_t rms[NCHANNELS];
+} sb16_meter_t;
+
 
 /* initialization function */
 int32_t sb16_init(const uint8_t* info_block);
 
+/* asynchronous initialization functions */
+int32_t sb16_resume(const uint8_t* info_block);
+int32_t sb16_open();
+int32_t sb16_open_status();
+int32_t sb16_start(const uint8_t* info_block);
+
+/* period-boundary rate and format change */
+int32_t sb16_reconfigure(const uint8_t* info_block);
+
+/* hardware loop function */
+int32_t sb16_loop(const uint8_t* info_block, const int8_t* clip, uint32_t length);
+
+/* level metering functions */
+int32_t sb16_meter_post(int32_t half, const sb16_meter_t* stats);
+int32_t sb16_meter_read(sb16_meter_t* stats);
+
+/* DMA pause and restart functions */
+int32_t sb16_pause(int32_t on);
+int32_t sb16_restart(const uint8_t* info_block);
+
 /* interrupt status check */
 int32_t sb16_copy_status();
 
+/* FM synthesizer functions */
+int32_t sb16_fm_open();
+int32_t sb16_fm_write(const uint32_t* writes, uint32_t n);
+int32_t sb16_fm_close();
+
+/* MPU-401 functions */
+int32_t sb16_midi_open();
+int32_t sb16_midi_read(uint8_t* buf, uint32_t n);
+int32_t sb16_midi_write(const uint8_t* buf, uint32_t n);
+int32_t sb16_midi_close();
+
+/* sample clock function */
+int32_t sb16_clock(int32_t* frames);
+
+/* period wait function */
+int32_t sb16_wait(int32_t half);
+
+/* audio device file operations */
+int32_t sb16_fd_open(const uint8_t* filename);
+int32_t sb16_fd_read(int32_t fd, void* buf, int32_t nbytes);
+int32_t sb16_fd_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t sb16_fd_poll(int32_t fd);
+int32_t sb16_fd_close(int32_t fd);
+
 /* shutdown function */
 int32_t sb16_shutdown();
 
+/* standby configuration functions */
+int32_t sb16_standby(int32_t periods);
+uint32_t sb16_standby_irqs();
+
 /* interrupt function */
 void sb16_interrupt(void);
 
@@ -0,0 +1,205 @@
+/* sb16_stream.hpp - C++ wrapper over the audio system calls. A stream
+ * owns the card from construction to destruction, and is filled either
+ * half by half in place or through writes of any length, with no heap
+ * use anywhere.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _SB16_STREAM_HPP
+#define _SB16_STREAM_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+#include "ece391support.h"
+#include "ece391syscall.h"
+}
+
+namespace sb16 {
+
+/* a view of contiguous elements, as std::span is in C++20 */
+template <typename T>
+class Span {
+public:
+    constexpr Span() : data_(nullptr), size_(0) {}
+    constexpr Span(T* data, size_t size) : data_(data), size_(size) {}
+    template <size_t N>
+    constexpr Span(T (&array)[N]) : data_(array), size_(N) {}
+
+    /* a span of T converts to a span of const T */
+    template <typename U>
+    constexpr Span(const Span<U>& other) : data_(other.data()), size_(other.size()) {}
+
+    constexpr T* data() const { return data_; }
+    constexpr size_t size() const { return size_; }
+    constexpr bool empty() const { return size_ == 0; }
+    constexpr T* begin() const { return data_; }
+    constexpr T* end() const { return data_ + size_; }
+    constexpr T& operator[](size_t i) const { return data_[i]; }
+
+    constexpr Span first(size_t n) const { return Span(data_, n); }
+    constexpr Span subspan(size_t offset) const { return Span(data_ + offset, size_ - offset); }
+
+private:
+    T* data_;
+    size_t size_;
+};
+
+
+/* a stream on the card; the card is opened by the constructor, filled
+ * while it resets, started once both halves are in, and released by the
+ * destructor */
+class Sb16Stream {
+public:
+    /* the driver's buffer, as in user_level_program.c */
+    static constexpr size_t kHalves = 2;
+    static constexpr size_t kHalfBytes = 65536 / kHalves;
+    static constexpr size_t kHalfSamples = kHalfBytes / sizeof(int16_t);
+    static constexpr size_t kHeaderSize = 44;
+
+    /* opens the card for a stream in the format of a WAV header; check
+     * ok() before using it */
+    explicit Sb16Stream(const uint8_t* info_block) {
+        int32_t buf;
+
+        for (size_t i = 0; i < kHeaderSize; i++) header_[i] = info_block[i];
+        buf = ece391_audio_open();
+        if (buf != -1)
+            base_ = reinterpret_cast<int16_t*>(static_cast<uintptr_t>(static_cast<uint32_t>(buf)));
+    }
+
+    ~Sb16Stream() { release(); }
+
+    Sb16Stream(const Sb16Stream&) = delete;
+    Sb16Stream& operator=(const Sb16Stream&) = delete;
+
+    Sb16Stream(Sb16Stream&& other) { take(other); }
+    Sb16Stream& operator=(Sb16Stream&& other) {
+        if (this != &other) {
+            release();
+            take(other);
+        }
+        return *this;
+    }
+
+    /* true while the stream holds the card */
+    bool ok() const { return base_ != nullptr; }
+
+    /* the next half to fill in place: both halves in turn while the card
+     * resets, then each half as the DMA frees it, sleeping until it does.
+     * An empty span means the stream has stopped */
+    Span<int16_t> free_half() {
+        int32_t h;
+
+        if (!ok()) return Span<int16_t>();
+
+        if (primed_ < kHalves) {
+            h = static_cast<int32_t>(primed_++);
+        } else {
+            if (!started_ && !start()) return Span<int16_t>();
+            if ((h = ece391_audio_wait(filled_)) == -1) return Span<int16_t>();
+        }
+        filled_ = h;
+
+        /* writes carry on in the half after this one */
+        cur_ = half(h);
+        pos_ = cur_.size();
+
+        return cur_;
+    }
+
+    /* copies samples into the halves in order, sleeping for each one to
+     * free up; returns how many were taken, all of them unless the stream
+     * stopped */
+    size_t write(Span<const int16_t> samples) {
+        size_t done = 0;
+        size_t n, i;
+
+        while (done < samples.size()) {
+            if (pos_ == cur_.size()) {
+                if (free_half().empty()) break;
+                pos_ = 0;
+            }
+            n = cur_.size() - pos_;
+            if (n > samples.size() - done) n = samples.size() - done;
+            for (i = 0; i < n; i++) cur_[pos_ + i] = samples[done + i];
+            pos_ += n;
+            done += n;
+        }
+
+        return done;
+    }
+
+    /* pads the last half with silence and sleeps until it has played;
+     * the card is still held until the stream is destroyed */
+    bool drain() {
+        int32_t h;
+
+        if (!ok() || primed_ == 0) return ok();
+
+        for (; pos_ < cur_.size(); pos_++) cur_[pos_] = 0;
+
+        /* a stream of one half still needs the other before it starts */
+        if (primed_ < kHalves) {
+            Span<int16_t> rest = half(1);
+            for (size_t i = 0; i < rest.size(); i++) rest[i] = 0;
+            primed_ = kHalves;
+        }
+        if (!started_ && !start()) return false;
+
+        /* once the DMA reaches the last half, silence the other so nothing
+         * stale plays, then wait out the last one */
+        if ((h = ece391_audio_wait(filled_)) == -1) return false;
+        Span<int16_t> other = half(h);
+        for (size_t i = 0; i < other.size(); i++) other[i] = 0;
+        return ece391_audio_wait(h) != -1;
+    }
+
+    /* one half of the buffer */
+    Span<int16_t> half(int32_t h) const {
+        return Span<int16_t>(base_ + h * kHalfSamples, kHalfSamples);
+    }
+
+private:
+    bool start() {
+        if (ece391_audio_start(header_) == -1) {
+            release();
+            return false;
+        }
+        started_ = true;
+        return true;
+    }
+
+    void release() {
+        if (base_) ece391_audio_shutdown();
+        base_ = nullptr;
+        cur_ = Span<int16_t>();
+        pos_ = 0;
+    }
+
+    void take(Sb16Stream& other) {
+        for (size_t i = 0; i < kHeaderSize; i++) header_[i] = other.header_[i];
+        base_ = other.base_;
+        primed_ = other.primed_;
+        started_ = other.started_;
+        filled_ = other.filled_;
+        cur_ = other.cur_;
+        pos_ = other.pos_;
+        other.base_ = nullptr;
+        other.cur_ = Span<int16_t>();
+        other.pos_ = 0;
+    }
+
+    uint8_t header_[kHeaderSize];
+    int16_t* base_ = nullptr;
+    size_t primed_ = 0;         /* halves filled before the start */
+    bool started_ = false;
+    int32_t filled_ = 0;        /* half handed out last */
+    Span<int16_t> cur_;         /* half writes are going into */
+    size_t pos_ = 0;
+};
+
+}
+
+#endif
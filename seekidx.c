@@ -0,0 +1,353 @@
+/* seekidx.c - Frame-offset index for seeking in compressed streams,
+ * built up as the stream plays or read from the cache file.
+ * Written by Soumithri Bala. */
+
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+#include "seekidx.h"
+
+
+/* indexes of recently opened files, replaced oldest first */
+static seek_index_t cache[SEEK_CACHE_FILES];
+static uint8_t cache_name[SEEK_CACHE_FILES][SEEK_NAME_LEN + 1];
+static uint32_t cache_used[SEEK_CACHE_FILES];
+static uint32_t cache_clock = 0;
+
+/* the cache file, read a block at a time */
+static struct {
+    int32_t fd;
+    int32_t len;
+    int32_t pos;
+    uint8_t buf[SEEK_READ_SIZE];
+} rd;
+
+
+/* local function definitions */
+static void seek_decimate(seek_index_t* idx);
+static int32_t seek_upper(const seek_index_t* idx, uint32_t sample);
+static int32_t seek_cache_load(const uint8_t* fname, seek_index_t* idx);
+static int32_t rd_char(void);
+static uint32_t rd_word(uint8_t* word, uint32_t max);
+static int32_t rd_num(uint32_t* val);
+static void seek_putnum(uint32_t val, const uint8_t* after);
+
+
+/* seek_init
+ *
+ * 		DESCRIPTION: clears an index
+ *		INPUTS: idx -- index
+ *		        spacing -- fewest samples between two points, usually
+ *		                   about half a second
+ *		OUTPUTS: idx -- empty index
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void seek_init(seek_index_t* idx, uint32_t spacing) {
+
+    idx->npoints = 0;
+    idx->spacing = spacing ? spacing : 1;
+    idx->rate = 0;
+    idx->total = 0;
+    idx->data_offset = 0;
+}
+
+
+/* seek_add
+ *
+ * 		DESCRIPTION: records where a frame starts. Decoders call this for
+ *		             every frame they pass, so the index fills in as the
+ *		             stream plays; points closer than the spacing to one
+ *		             already held are ignored, which also makes replays
+ *		             of the same stretch free.
+ *		INPUTS: idx -- index
+ *		        sample -- first sample of the frame
+ *		        offset -- file offset of the frame
+ *		OUTPUTS: idx -- index with the point added
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may thin out the index
+ */
+void seek_add(seek_index_t* idx, uint32_t sample, uint32_t offset) {
+
+    int32_t pos, i;
+
+    pos = seek_upper(idx, sample);
+    if (pos > 0 && sample - idx->pt[pos - 1].sample < idx->spacing) return;
+    if (pos < (int32_t)idx->npoints && idx->pt[pos].sample - sample < idx->spacing) return;
+
+    if (idx->npoints == SEEK_MAX_POINTS) {
+        seek_decimate(idx);
+        seek_add(idx, sample, offset);
+        return;
+    }
+
+    for (i = idx->npoints; i > pos; i--) idx->pt[i] = idx->pt[i - 1];
+    idx->pt[pos].sample = sample;
+    idx->pt[pos].offset = offset;
+    idx->npoints++;
+}
+
+
+/* seek_find
+ *
+ * 		DESCRIPTION: finds the point to start decoding from to reach a
+ *		             sample, by binary search
+ *		INPUTS: idx -- index
+ *		        sample -- sample wanted
+ *		OUTPUTS: point -- last point at or before the sample
+ *		RETURN VALUE: 0 on success, -1 if no point comes before it
+ *		SIDE EFFECTS: none
+ */
+int32_t seek_find(const seek_index_t* idx, uint32_t sample, seek_point_t* point) {
+
+    int32_t pos = seek_upper(idx, sample);
+
+    if (!pos) return -1;
+
+    *point = idx->pt[pos - 1];
+
+    return 0;
+}
+
+
+/* seek_cache_get
+ *
+ * 		DESCRIPTION: finds the index this process keeps for a file, so a
+ *		             stream played or seeked again starts with all the
+ *		             points found so far. A file this process hasn't seen
+ *		             starts from its index in the cache file, if it has
+ *		             one; the filesystem is read-only, so the cache file
+ *		             is made with -k when the image is built.
+ *		INPUTS: fname -- name of the file
+ *		        spacing -- spacing for a new index
+ *		OUTPUTS: found -- 1 if the file already had an index, else 0
+ *		RETURN VALUE: the file's index
+ *		SIDE EFFECTS: may replace the least recently used index, may read
+ *		              the cache file
+ */
+seek_index_t* seek_cache_get(const uint8_t* fname, uint32_t spacing, int32_t* found) {
+
+    int32_t i, slot = 0;
+
+    for (i = 0; i < SEEK_CACHE_FILES; i++) {
+        if (cache_used[i] && !ece391_strncmp(cache_name[i], fname, SEEK_NAME_LEN)) {
+            cache_used[i] = ++cache_clock;
+            *found = 1;
+            return &cache[i];
+        }
+        if (cache_used[i] < cache_used[slot]) slot = i;
+    }
+
+    for (i = 0; i < SEEK_NAME_LEN && fname[i]; i++) cache_name[slot][i] = fname[i];
+    cache_name[slot][i] = '\0';
+    cache_used[slot] = ++cache_clock;
+    *found = seek_cache_load(fname, &cache[slot]);
+    if (!*found) seek_init(&cache[slot], spacing);
+
+    return &cache[slot];
+}
+
+
+/* seek_print
+ *
+ * 		DESCRIPTION: prints an index as lines of the cache file
+ *		INPUTS: fname -- name of the file
+ *		        idx -- its index
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes to the terminal
+ */
+void seek_print(const uint8_t* fname, const seek_index_t* idx) {
+
+    uint32_t i;
+
+    ece391_fdputs(1, fname);
+    ece391_fdputs(1, (uint8_t*)" ");
+    seek_putnum(idx->spacing, (uint8_t*)" ");
+    seek_putnum(idx->rate, (uint8_t*)" ");
+    seek_putnum(idx->total, (uint8_t*)" ");
+    seek_putnum(idx->data_offset, (uint8_t*)" ");
+    seek_putnum(idx->npoints, (uint8_t*)"\n");
+    for (i = 0; i < idx->npoints; i++) {
+        seek_putnum(idx->pt[i].sample, (uint8_t*)" ");
+        seek_putnum(idx->pt[i].offset, (uint8_t*)"\n");
+    }
+}
+
+
+/* seek_decimate
+ *
+ * 		DESCRIPTION: drops every other point and doubles the spacing, so a
+ *		             long stream keeps an even index in fixed memory
+ *		INPUTS: idx -- index
+ *		OUTPUTS: idx -- half as many points
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void seek_decimate(seek_index_t* idx) {
+
+    uint32_t i;
+
+    for (i = 0; 2 * i < idx->npoints; i++) idx->pt[i] = idx->pt[2 * i];
+    idx->npoints = i;
+    idx->spacing *= 2;
+}
+
+
+/* seek_upper
+ *
+ * 		DESCRIPTION: binary search for the first point after a sample
+ *		INPUTS: idx -- index
+ *		        sample -- sample to look for
+ *		OUTPUTS: none
+ *		RETURN VALUE: index of the first point with a later sample
+ *		SIDE EFFECTS: none
+ */
+static int32_t seek_upper(const seek_index_t* idx, uint32_t sample) {
+
+    int32_t lo = 0, hi = idx->npoints, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (idx->pt[mid].sample <= sample)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+/* seek_cache_load
+ *
+ * 		DESCRIPTION: looks for a file's index in the cache file, passing
+ *		             over the points of the files before it
+ *		INPUTS: fname -- name of the file
+ *		OUTPUTS: idx -- the index, if the file has one
+ *		RETURN VALUE: 1 if it was found, else 0
+ *		SIDE EFFECTS: reads the cache file
+ */
+static int32_t seek_cache_load(const uint8_t* fname, seek_index_t* idx) {
+
+    uint8_t name[SEEK_NAME_LEN + 1];
+    uint32_t head[SEEK_HEAD_FIELDS], sample, offset, i;
+    int32_t found = 0, bad = 0;
+
+    if (-1 == (rd.fd = ece391_open((uint8_t*)SEEK_CACHE_FILE))) return 0;
+    rd.len = rd.pos = 0;
+
+    while (!found && !bad && rd_word(name, SEEK_NAME_LEN)) {
+        for (i = 0; i < SEEK_HEAD_FIELDS && !bad; i++) bad = rd_num(&head[i]);
+        if (bad) break;
+
+        found = !ece391_strncmp(name, fname, SEEK_NAME_LEN);
+        if (found) seek_init(idx, head[0]);
+        for (i = 0; i < head[4] && !bad; i++) {
+            bad = rd_num(&sample);
+            if (!bad) bad = rd_num(&offset);
+            if (found && !bad) seek_add(idx, sample, offset);
+        }
+        if (found) {
+            idx->rate = head[1];
+            idx->total = head[2];
+            idx->data_offset = head[3];
+        }
+    }
+    ece391_close(rd.fd);
+
+    return found;
+}
+
+
+/* rd_char
+ *
+ * 		DESCRIPTION: reads the next byte of the cache file
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: the byte, or -1 at the end
+ *		SIDE EFFECTS: reads the next block when the last one runs out
+ */
+static int32_t rd_char(void) {
+
+    if (rd.pos == rd.len) {
+        rd.len = ece391_read(rd.fd, rd.buf, SEEK_READ_SIZE);
+        rd.pos = 0;
+        if (rd.len <= 0) {
+            rd.len = 0;
+            return -1;
+        }
+    }
+
+    return rd.buf[rd.pos++];
+}
+
+
+/* rd_word
+ *
+ * 		DESCRIPTION: reads the next word of the cache file, skipping the
+ *		             spaces and line ends before it
+ *		INPUTS: max -- most characters to keep; more are dropped
+ *		OUTPUTS: word -- the word, NUL-terminated
+ *		RETURN VALUE: characters in the word, 0 at the end
+ *		SIDE EFFECTS: advances the file
+ */
+static uint32_t rd_word(uint8_t* word, uint32_t max) {
+
+    int32_t c;
+    uint32_t n = 0;
+
+    while ((c = rd_char()) == ' ' || c == '\n' || c == '\r');
+    while (c != -1 && c != ' ' && c != '\n' && c != '\r') {
+        if (n < max) word[n] = c;
+        n++;
+        c = rd_char();
+    }
+    word[n < max ? n : max] = '\0';
+
+    return n;
+}
+
+
+/* rd_num
+ *
+ * 		DESCRIPTION: reads the next word of the cache file as a decimal
+ *		             number
+ *		INPUTS: none
+ *		OUTPUTS: val -- the number
+ *		RETURN VALUE: 0 on success, 1 if it's missing or not a number
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t rd_num(uint32_t* val) {
+
+    uint8_t word[SEEK_NUM_LEN + 1];
+    uint32_t n, i;
+
+    if (!(n = rd_word(word, SEEK_NUM_LEN)) || n > SEEK_NUM_LEN) return 1;
+
+    *val = 0;
+    for (i = 0; i < n; i++) {
+        if (word[i] < '0' || word[i] > '9') return 1;
+        *val = *val * SEEK_RADIX + (word[i] - '0');
+    }
+
+    return 0;
+}
+
+
+/* seek_putnum
+ *
+ * 		DESCRIPTION: prints a number in decimal and what follows it
+ *		INPUTS: val -- number
+ *		        after -- separator to print after it
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes to the terminal
+ */
+static void seek_putnum(uint32_t val, const uint8_t* after) {
+
+    uint8_t num[SEEK_NUM_LEN];
+
+    ece391_fdputs(1, ece391_itoa(val, num, SEEK_RADIX));
+    ece391_fdputs(1, after);
+}
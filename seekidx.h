@@ -0,0 +1,58 @@
+/* seekidx.h - Seek index definitions for compressed streams.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _SEEKIDX_H
+#define _SEEKIDX_H
+
+#include <stdint.h>
+
+#define SEEK_MAX_POINTS     1024
+#define SEEK_CACHE_FILES    4
+#define SEEK_NAME_LEN       32
+
+/* indexes printed by the player's -k, put in the image when it's built:
+ * a "<name> <spacing> <rate> <total> <data offset> <points>" line, then a
+ * "<sample> <offset>" line a point */
+#define SEEK_CACHE_FILE     "seek.cache"
+#define SEEK_HEAD_FIELDS    5
+#define SEEK_READ_SIZE      4096
+#define SEEK_NUM_LEN        12
+#define SEEK_RADIX          10
+
+/* first sample of a frame and where the frame starts in the file */
+typedef struct seek_point {
+    uint32_t sample;
+    uint32_t offset;
+} seek_point_t;
+
+/* sorted seek points, added as the stream plays;
+ * when full, every other point is dropped and the spacing doubles */
+typedef struct seek_index {
+    uint32_t npoints;
+    uint32_t spacing;       /* fewest samples between two points */
+    uint32_t rate;          /* from the stream header, 0 if unknown */
+    uint32_t total;         /* samples in the stream, 0 if unknown */
+    uint32_t data_offset;   /* file offset of the first frame */
+    seek_point_t pt[SEEK_MAX_POINTS];
+} seek_index_t;
+
+
+/* clears an index */
+void seek_init(seek_index_t* idx, uint32_t spacing);
+
+/* records where a frame starts, unless a point is already close by */
+void seek_add(seek_index_t* idx, uint32_t sample, uint32_t offset);
+
+/* finds the last point at or before a sample */
+int32_t seek_find(const seek_index_t* idx, uint32_t sample, seek_point_t* point);
+
+/* the index kept for a file in this process, from the cache file or
+ * cleared if it's new */
+seek_index_t* seek_cache_get(const uint8_t* fname, uint32_t spacing, int32_t* found);
+
+/* prints an index as lines of the cache file */
+void seek_print(const uint8_t* fname, const seek_index_t* idx);
+
+
+#endif
@@ -0,0 +1,318 @@
+/* stretch.c - WSOLA time-stretch, changing the speed of playback without
+ * changing its pitch.
+ * Written by Soumithri Bala. */
+
+
+#include "stretch.h"
+#include "fixmath.h"
+
+
+#define MS_PER_SEC          1000
+
+
+/* local function definitions */
+static void ts_read(stretch_t* ts, wav_t* wav, uint32_t need);
+static uint32_t ts_search(const stretch_t* ts);
+static int64_t ts_corr(const stretch_t* ts, const int16_t* seg, uint32_t step);
+static void ts_set_tail(stretch_t* ts, const int16_t* seg);
+static uint32_t ts_hop(stretch_t* ts, wav_t* wav);
+
+
+/* stretch_init
+ *
+ * 		DESCRIPTION: sets the speed and format, and builds the crossfade
+ *		             between segments, a raised cosine a hop long
+ *		INPUTS: ts -- stretch state
+ *		        speed -- input frames per output frame, Q16
+ *		        rate -- sample rate in Hz
+ *		        channels -- samples per frame
+ *		OUTPUTS: ts -- cleared state
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+int32_t stretch_init(stretch_t* ts, uint32_t speed, uint32_t rate,
+                     uint32_t channels) {
+
+    uint32_t i, step;
+
+    if (speed < TS_MIN_SPEED || speed > TS_MAX_SPEED || !rate ||
+            rate > TS_MAX_RATE || !channels || channels > TS_MAX_CHANNELS)
+        return -1;
+
+    ts->speed = speed;
+    ts->channels = channels;
+    ts->hop = rate * TS_HOP_MS / MS_PER_SEC;
+    ts->search = ts->hop / 2;
+
+    step = PHASE_HALF / ts->hop;
+    for (i = 0; i < ts->hop; i++)
+        ts->fade[i] = (Q15_ONE + 1 - fix_cos(i * step)) >> 1;
+
+    stretch_reset(ts);
+
+    return 0;
+}
+
+
+/* stretch_reset
+ *
+ * 		DESCRIPTION: drops everything buffered, so the next fill starts
+ *		             fresh from wherever the file is now
+ *		INPUTS: ts -- stretch state
+ *		OUTPUTS: ts -- empty state
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void stretch_reset(stretch_t* ts) {
+
+    ts->state = TS_START;
+    ts->eof = 0;
+    ts->avail = 0;
+    ts->nom = 0;
+    ts->frac = 0;
+    ts->ready = 0;
+    ts->ready_pos = 0;
+}
+
+
+/* stretch_fill
+ *
+ * 		DESCRIPTION: copies the next len bytes of the track played at the
+ *		             set speed, a hop at a time. Each hop costs the same
+ *		             however fast the track plays, so a period's work is
+ *		             bounded by its length.
+ *		INPUTS: ts -- stretch state
+ *		        wav -- open track
+ *		        dst -- destination
+ *		        len -- bytes wanted, in whole frames
+ *		OUTPUTS: dst -- stretched PCM
+ *		RETURN VALUE: bytes copied, fewer than len only at the end of the
+ *		              track
+ *		SIDE EFFECTS: reads ahead in the track
+ */
+int32_t stretch_fill(stretch_t* ts, wav_t* wav, int8_t* dst, uint32_t len) {
+
+    uint32_t ch = ts->channels;
+    uint32_t frames = len / (ch * sizeof(int16_t));
+    uint32_t done = 0, n, i;
+    int16_t* out = (int16_t*)dst;
+    const int16_t* src;
+
+    while (done < frames) {
+        if (!ts->ready && !ts_hop(ts, wav)) break;
+
+        n = frames - done < ts->ready ? frames - done : ts->ready;
+        src = ts->out + ts->ready_pos * ch;
+        for (i = 0; i < n * ch; i++) out[done * ch + i] = src[i];
+
+        ts->ready -= n;
+        ts->ready_pos += n;
+        done += n;
+    }
+
+    return done * ch * sizeof(int16_t);
+}
+
+
+/* ts_read
+ *
+ * 		DESCRIPTION: makes sure the input holds need frames. Frames before
+ *		             the earliest a segment can still start from are
+ *		             dropped only when the buffer would overflow, so most
+ *		             hops read and move nothing.
+ *		INPUTS: ts -- stretch state
+ *		        wav -- open track
+ *		        need -- frames wanted in the input
+ *		OUTPUTS: ts -- input topped up
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sets eof at the end of the track
+ */
+static void ts_read(stretch_t* ts, wav_t* wav, uint32_t need) {
+
+    uint32_t ch = ts->channels;
+    uint32_t keep, want, i;
+    int32_t n;
+
+    if (need > TS_IN_FRAMES) {
+        keep = ts->nom > ts->search ? ts->nom - ts->search : 0;
+        /* past the end of the track, nom can be beyond the input */
+        if (keep > ts->avail) keep = ts->avail;
+        for (i = 0; i < (ts->avail - keep) * ch; i++)
+            ts->in[i] = ts->in[keep * ch + i];
+        ts->avail -= keep;
+        ts->nom -= keep;
+    }
+
+    if (ts->avail >= need || ts->eof) return;
+
+    want = (TS_IN_FRAMES - ts->avail) * ch * sizeof(int16_t);
+    n = wav_fill(wav, (int8_t*)(ts->in + ts->avail * ch), want);
+    ts->avail += n / (ch * sizeof(int16_t));
+    if ((uint32_t)n < want) ts->eof = 1;
+}
+
+
+/* ts_search
+ *
+ * 		DESCRIPTION: finds where near the nominal position the next segment
+ *		             best continues the tail it will be faded over, by
+ *		             cross-correlating mono mixes. Every TS_DECIM-th lag is
+ *		             tried on every TS_DECIM-th sample, then the lags around
+ *		             the best of those on every sample, which keeps the
+ *		             search to a small fixed cost per hop.
+ *		INPUTS: ts -- stretch state
+ *		OUTPUTS: none
+ *		RETURN VALUE: start of the segment in the input
+ *		SIDE EFFECTS: none
+ */
+static uint32_t ts_search(const stretch_t* ts) {
+
+    int32_t lo, hi, lag, best, first, last;
+    int64_t corr, max;
+    const int16_t* base = ts->in + ts->nom * ts->channels;
+
+    lo = ts->nom < ts->search ? -(int32_t)ts->nom : -(int32_t)ts->search;
+    hi = ts->search;
+
+    best = 0;
+    max = ts_corr(ts, base, TS_DECIM);
+    for (lag = lo; lag <= hi; lag += TS_DECIM) {
+        corr = ts_corr(ts, base + lag * (int32_t)ts->channels, TS_DECIM);
+        if (corr > max) {
+            max = corr;
+            best = lag;
+        }
+    }
+
+    first = best - TS_DECIM + 1 > lo ? best - TS_DECIM + 1 : lo;
+    last = best + TS_DECIM - 1 < hi ? best + TS_DECIM - 1 : hi;
+    max = ts_corr(ts, base + best * (int32_t)ts->channels, 1);
+    for (lag = first; lag <= last; lag++) {
+        corr = ts_corr(ts, base + lag * (int32_t)ts->channels, 1);
+        if (corr > max) {
+            max = corr;
+            best = lag;
+        }
+    }
+
+    return ts->nom + best;
+}
+
+
+/* ts_corr
+ *
+ * 		DESCRIPTION: correlates the head of a candidate segment with the
+ *		             tail, both mixed to mono
+ *		INPUTS: ts -- stretch state
+ *		        seg -- candidate segment
+ *		        step -- frames between the samples compared
+ *		OUTPUTS: none
+ *		RETURN VALUE: sum of products
+ *		SIDE EFFECTS: none
+ */
+static int64_t ts_corr(const stretch_t* ts, const int16_t* seg, uint32_t step) {
+
+    int64_t sum = 0;
+    uint32_t i;
+
+    if (ts->channels == 2) {
+        for (i = 0; i < ts->hop; i += step)
+            sum += (int64_t)ts->ref[i] * (seg[2 * i] + seg[2 * i + 1]);
+    } else {
+        for (i = 0; i < ts->hop; i += step)
+            sum += (int64_t)ts->ref[i] * seg[i];
+    }
+
+    return sum;
+}
+
+
+/* ts_set_tail
+ *
+ * 		DESCRIPTION: keeps the second hop of a segment to fade out under
+ *		             the next one, with its mono mix for the search
+ *		INPUTS: ts -- stretch state
+ *		        seg -- segment just used
+ *		OUTPUTS: ts -- new tail
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void ts_set_tail(stretch_t* ts, const int16_t* seg) {
+
+    uint32_t ch = ts->channels;
+    uint32_t i;
+
+    seg += ts->hop * ch;
+    for (i = 0; i < ts->hop * ch; i++) ts->tail[i] = seg[i];
+
+    for (i = 0; i < ts->hop; i++)
+        ts->ref[i] = (ch == 2) ? ts->tail[2 * i] + ts->tail[2 * i + 1] : ts->tail[i];
+}
+
+
+/* ts_hop
+ *
+ * 		DESCRIPTION: makes the next hop of output. The first segment of a
+ *		             stream goes out as it is; after that, each segment
+ *		             starts a hop's worth of input times the speed after
+ *		             the last, moved by the search to line up with the tail,
+ *		             and its head is crossfaded with the tail. Past the end
+ *		             of the track the input reads as silence, and the last
+ *		             tail goes out once no input is left.
+ *		INPUTS: ts -- stretch state
+ *		        wav -- open track
+ *		OUTPUTS: ts -- hop in out
+ *		RETURN VALUE: frames made, 0 at the end of the stream
+ *		SIDE EFFECTS: reads ahead in the track
+ */
+static uint32_t ts_hop(stretch_t* ts, wav_t* wav) {
+
+    uint32_t ch = ts->channels;
+    uint32_t hop = ts->hop;
+    uint32_t need, pos, i, c, s;
+    const int16_t* seg;
+    int32_t f;
+
+    if (ts->state == TS_DONE) return 0;
+
+    need = ts->nom + ts->search + 2 * hop;
+    ts_read(ts, wav, need);
+
+    if (ts->eof && ts->nom >= ts->avail) {
+        if (ts->state == TS_START) return 0;
+        for (i = 0; i < hop * ch; i++) ts->out[i] = ts->tail[i];
+        ts->state = TS_DONE;
+        ts->ready = hop;
+        ts->ready_pos = 0;
+        return hop;
+    }
+
+    for (i = ts->avail * ch; i < ts->nom * ch + (ts->search + 2 * hop) * ch; i++)
+        ts->in[i] = 0;
+
+    if (ts->state == TS_START) {
+        seg = ts->in + ts->nom * ch;
+        for (i = 0; i < hop * ch; i++) ts->out[i] = seg[i];
+        ts->state = TS_RUN;
+    } else {
+        pos = ts_search(ts);
+        seg = ts->in + pos * ch;
+        for (i = 0; i < hop; i++) {
+            f = ts->fade[i];
+            for (c = 0; c < ch; c++) {
+                s = i * ch + c;
+                ts->out[s] = ts->tail[s] + ((((int32_t)seg[s] - ts->tail[s]) * f) >> Q15_SHIFT);
+            }
+        }
+    }
+    ts_set_tail(ts, seg);
+
+    ts->frac += ts->speed * hop;
+    ts->nom += ts->frac >> Q16_SHIFT;
+    ts->frac &= (1 << Q16_SHIFT) - 1;
+
+    ts->ready = hop;
+    ts->ready_pos = 0;
+
+    return hop;
+}
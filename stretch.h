@@ -0,0 +1,65 @@
+/* stretch.h - WSOLA time-stretch definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _STRETCH_H
+#define _STRETCH_H
+
+#include <stdint.h>
+
+#include "wav.h"
+
+#define TS_MAX_CHANNELS     2
+#define TS_MAX_RATE         48000
+#define TS_HOP_MS           10
+#define TS_MAX_HOP          (TS_MAX_RATE * TS_HOP_MS / 1000)
+#define TS_IN_FRAMES        4096
+
+/* speeds are Q16, from half to double */
+#define TS_UNITY            (1 << 16)
+#define TS_MIN_SPEED        (TS_UNITY / 2)
+#define TS_MAX_SPEED        (TS_UNITY * 2)
+
+/* the search looks at every TS_DECIM-th lag and sample, then refines
+ * around the best one */
+#define TS_DECIM            4
+
+/* stream states */
+#define TS_START            0
+#define TS_RUN              1
+#define TS_DONE             2
+
+/* one stream being stretched; output goes out a hop at a time, each hop
+ * the faded-out tail of the last segment over the head of the next */
+typedef struct stretch {
+    uint32_t speed;         /* input frames per output frame, Q16 */
+    uint32_t channels;
+    uint32_t hop;           /* output frames per segment step */
+    uint32_t search;        /* frames either side of the nominal position */
+    uint32_t state;
+    uint32_t eof;           /* 1 once the track has nothing more to read */
+    uint32_t avail;         /* frames held in in */
+    uint32_t nom;           /* nominal start of the next segment in in */
+    uint32_t frac;          /* Q16 fraction of nom */
+    uint32_t ready;         /* frames of out not yet handed on */
+    uint32_t ready_pos;
+    int16_t fade[TS_MAX_HOP];                       /* Q15 fade-in */
+    int32_t ref[TS_MAX_HOP];                        /* tail, mixed to mono */
+    int16_t tail[TS_MAX_HOP * TS_MAX_CHANNELS];
+    int16_t out[TS_MAX_HOP * TS_MAX_CHANNELS];
+    int16_t in[TS_IN_FRAMES * TS_MAX_CHANNELS];
+} stretch_t;
+
+
+/* sets the speed and format, and clears the stream */
+int32_t stretch_init(stretch_t* ts, uint32_t speed, uint32_t rate,
+                     uint32_t channels);
+
+/* drops everything buffered, for a seek */
+void stretch_reset(stretch_t* ts);
+
+/* fills like wav_fill, with the track played at the set speed */
+int32_t stretch_fill(stretch_t* ts, wav_t* wav, int8_t* dst, uint32_t len);
+
+
+#endif
@@ -0,0 +1,2396 @@
+/* tracker.c - MOD/S3M/XM module player implementation file.
+ * Written by Soumithri Bala. */
+
+
+#include "tracker.h"
+#include "fixmath.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* ProTracker and compatibles: 31 sample headers, the order list and a
+ * signature naming the channel count */
+#define MOD_SAMPLES         31
+#define MOD_SMP_OFFSET      20
+#define MOD_SMP_SIZE        30
+#define MOD_LEN_OFFSET      950
+#define MOD_ORDER_OFFSET    952
+#define MOD_ORDERS          128
+#define MOD_SIG_OFFSET      1080
+#define MOD_HDR_SIZE        1084
+#define MOD_ROWS            64
+#define MOD_CELL_SIZE       4
+#define MOD_MIN_PERIOD      113
+#define MOD_MAX_PERIOD      856
+
+/* Scream Tracker 3; offsets in the file are in 16-byte paragraphs */
+#define S3M_ID_OFFSET       0x2C
+#define S3M_ID              0x4D524353
+#define S3M_HDR_SIZE        0x60
+#define S3M_INS_SIZE        0x50
+#define S3M_ROWS            64
+#define S3M_PARA            16
+#define S3M_ORDER_SKIP      254
+#define S3M_ORDER_END       255
+#define S3M_NOTE_CUT        254
+#define S3M_NOTE_NONE       255
+#define S3M_PAN_TABLE       252
+#define S3M_CHAN_OFF        16
+#define S3M_UNSIGNED        2
+#define S3M_STEREO          0x80
+#define S3M_NORDERS         0x20
+#define S3M_NINS            0x22
+#define S3M_NPATTERNS       0x24
+#define S3M_FFI             0x2A
+#define S3M_GVOL            0x30
+#define S3M_SPEED           0x31
+#define S3M_TEMPO           0x32
+#define S3M_MASTER          0x33
+#define S3M_DEF_PAN         0x35
+#define S3M_SETTINGS        0x40
+#define S3M_RIGHT           8
+#define S3M_PAN_LEFT        0x33
+#define S3M_PAN_RIGHT       0xCC
+#define S3M_PAN_SET         0x20
+#define S3M_PAN_SCALE       17
+
+/* S3M sample headers */
+#define S3M_SMP_SAMPLE      1
+#define S3M_SMP_SEG         0x0D
+#define S3M_SMP_LEN         0x10
+#define S3M_SMP_LOOP        0x14
+#define S3M_SMP_LOOP_END    0x18
+#define S3M_SMP_VOL         0x1C
+#define S3M_SMP_FLAGS       0x1F
+#define S3M_SMP_C2SPD       0x20
+#define S3M_LOOPED          0x1
+#define S3M_16BIT           0x4
+
+/* S3M pattern packing: a byte naming the channel and what follows, and
+ * 0 at the end of a row */
+#define S3M_CHAN_MASK       0x1F
+#define S3M_HAS_NOTE        0x20
+#define S3M_HAS_VOL         0x40
+#define S3M_HAS_FX          0x80
+#define S3M_EMPTY           0xFF
+
+/* FastTracker 2 */
+#define XM_ID_LEN           17
+#define XM_HDR_OFFSET       60
+#define XM_HDR_SIZE         336
+#define XM_PAT_HDR_SIZE     9
+#define XM_INS_HDR_SIZE     29
+#define XM_INS_EXT_SIZE     214
+#define XM_SMP_HDR_SIZE     40
+#define XM_PACKED           0x80
+#define XM_LINEAR           0x1
+#define XM_SMP_16BIT        0x10
+#define XM_NOTE_OFF         97
+#define XM_HDR_LEN          60
+#define XM_NORDERS          64
+#define XM_RESTART          66
+#define XM_NCHANNELS        68
+#define XM_NPATTERNS        70
+#define XM_NINS             72
+#define XM_FLAGS            74
+#define XM_SPEED            76
+#define XM_TEMPO            78
+#define XM_ORDERS           80
+#define XM_MAX_SAMPLES      16
+
+/* offsets in the instrument header past its first 29 bytes */
+#define XM_KEYMAP           4
+#define XM_VOL_ENV          100
+#define XM_PAN_ENV          148
+#define XM_ENV_COUNTS       196
+#define XM_ENV_FORMS        198
+#define XM_ENV_TYPES        204
+#define XM_VIB              206
+#define XM_FADEOUT          210
+#define XM_ENV_POINT_SIZE   4
+
+/* offsets in the sample header */
+#define XM_SMP_LOOP         4
+#define XM_SMP_LOOP_LEN     8
+#define XM_SMP_VOL          12
+#define XM_SMP_FINETUNE     13
+#define XM_SMP_TYPE         14
+#define XM_SMP_PAN          15
+#define XM_SMP_RELNOTE      16
+#define XM_LOOP_MASK        0x3
+
+/* finetune is 128 to a semitone, so 1536 to the octave */
+#define XM_FINETUNE_OCTAVE  1536
+#define XM_FADE_SCALE       2
+
+#define LOAD_BUF_SIZE       4096
+
+/* sample data as stored */
+#define SMP_16BIT           0x1
+#define SMP_UNSIGNED        0x2
+#define SMP_DELTA           0x4
+
+/* periods are four times the Amiga's, so a note at C-4 on a sample
+ * playing at c2spd has period 8363 * 1712 / c2spd; linear periods are 64
+ * to a semitone with C-4 at 4608 */
+#define C4_RATE             8363
+#define C4_PERIOD           1712
+#define AMIGA_CLOCK         (C4_RATE * C4_PERIOD)
+#define PERIOD_SCALE        4
+#define LINEAR_C4           4608
+#define LINEAR_SEMITONE     64
+#define LINEAR_OCTAVE       768
+#define MIN_PERIOD          32
+#define MAX_PERIOD          (C4_PERIOD * 32)
+#define SEMITONES           12
+#define FINETUNES           16
+
+#define MAX_VOLUME          64
+#define MAX_PAN             255
+#define CENTRE_PAN          128
+#define MOD_LEFT            0x40
+#define MOD_RIGHT           0xC0
+#define FADE_UNITY          65536
+#define DEFAULT_SPEED       6
+#define DEFAULT_TEMPO       125
+#define MIN_TEMPO           32
+
+/* a tick lasts 2.5 / tempo seconds */
+#define TICK_NUM            5
+#define TICK_DEN            2
+
+/* gains: channel volume times global volume is Q12, voices mix in Q10,
+ * and the master gain scales the sum by sqrt(2 / channels) in Q8 */
+#define VOL_SHIFT           2
+#define ENV_SHIFT           6
+#define FADE_SHIFT          4
+#define MIX_SHIFT           10
+#define AMP_SHIFT           8
+#define AMP_TWO             (2 << AMP_SHIFT)
+
+/* effects, numbered as in XM, then the S3M ones that differ */
+#define FX_ARPEGGIO         0x00
+#define FX_PORTA_UP         0x01
+#define FX_PORTA_DOWN       0x02
+#define FX_TONE             0x03
+#define FX_VIBRATO          0x04
+#define FX_TONE_VSLIDE      0x05
+#define FX_VIB_VSLIDE       0x06
+#define FX_TREMOLO          0x07
+#define FX_PAN              0x08
+#define FX_OFFSET           0x09
+#define FX_VSLIDE           0x0A
+#define FX_JUMP             0x0B
+#define FX_VOLUME           0x0C
+#define FX_BREAK            0x0D
+#define FX_EXTENDED         0x0E
+#define FX_SPEED_TEMPO      0x0F
+#define FX_GVOL             0x10
+#define FX_GVSLIDE          0x11
+#define FX_KEY_OFF          0x14
+#define FX_ENV_POS          0x15
+#define FX_PSLIDE           0x19
+#define FX_RETRIG           0x1B
+#define FX_TREMOR           0x1D
+#define FX_XFINE            0x21
+#define FX_SPEED            0x24
+#define FX_TEMPO            0x25
+#define FX_S3M_VSLIDE       0x26
+#define FX_S3M_DOWN         0x27
+#define FX_S3M_UP           0x28
+#define FX_S3M_VIB_VSLIDE   0x29
+#define FX_S3M_TONE_VSLIDE  0x2A
+#define FX_FINE_VIB         0x2B
+#define FX_NONE             0xFF
+
+/* E sub-effects, and the S3M S sub-effects they stand in for */
+#define EXT_FINE_UP         0x1
+#define EXT_FINE_DOWN       0x2
+#define EXT_VIB_WAVE        0x4
+#define EXT_FINETUNE        0x5
+#define EXT_LOOP            0x6
+#define EXT_TREM_WAVE       0x7
+#define EXT_PAN             0x8
+#define EXT_RETRIG          0x9
+#define EXT_FINE_VUP        0xA
+#define EXT_FINE_VDOWN      0xB
+#define EXT_CUT             0xC
+#define EXT_DELAY           0xD
+#define EXT_PATTERN_DELAY   0xE
+
+/* XM volume column; 0x10-0x50 sets the volume */
+#define VCOL_VOLUME         0x10
+#define VCOL_VOLUME_END     0x50
+#define VCOL_SLIDE_DOWN     0x60
+#define VCOL_SLIDE_UP       0x70
+#define VCOL_FINE_DOWN      0x80
+#define VCOL_FINE_UP        0x90
+#define VCOL_VIB_SPEED      0xA0
+#define VCOL_VIBRATO        0xB0
+#define VCOL_PAN            0xC0
+#define VCOL_PAN_LEFT       0xD0
+#define VCOL_PAN_RIGHT      0xE0
+#define VCOL_TONE           0xF0
+
+/* effect parameters and their halves */
+#define NIBBLE              4
+#define NIBBLE_MASK         0xF
+#define SLIDE_SCALE         4
+#define OFFSET_SHIFT        8
+#define TEMPO_PARAM         32
+#define VIB_SHIFT           5
+#define FINE_VIB_SHIFT      7
+#define TREM_SHIFT          6
+#define AVIB_SHIFT          16
+#define WAVE_RETRIG         4
+
+/* the ProTracker sine, a half cycle in 32 steps */
+#define WAVE_STEPS          64
+#define WAVE_HALF           32
+static const uint8_t sine_tab[WAVE_HALF] = {
+    0, 24, 49, 74, 97, 120, 141, 161, 180, 197, 212, 224, 235, 244, 250, 253,
+    255, 253, 250, 244, 235, 224, 212, 197, 180, 161, 141, 120, 97, 74, 49, 24
+};
+
+/* C-0 to B-0 periods, times 16 */
+static const uint16_t period_tab[SEMITONES] = {
+    27392, 25856, 24384, 23040, 21696, 20480, 19328, 18240, 17216, 16256, 15360, 14496
+};
+
+/* c2spd of the sixteen MOD finetunes, 0 to 7 then -8 to -1 */
+static const uint16_t finetune_tab[FINETUNES] = {
+    8363, 8413, 8463, 8529, 8581, 8651, 8723, 8757,
+    7895, 7941, 7985, 8046, 8107, 8169, 8232, 8280
+};
+
+/* volume changes of the retrigger effect; 6, 7, E and F scale instead */
+static const int8_t retrig_add[FINETUNES] = {
+    0, -1, -2, -4, -8, -16, 0, 0, 0, 1, 2, 4, 8, 16, 0, 0
+};
+
+/* file bytes on their way into the arena */
+static uint8_t load_buf[LOAD_BUF_SIZE];
+
+
+/* local function definitions */
+static int32_t trk_fread(tracker_t* tr, void* buf, uint32_t len);
+static int32_t trk_fseek(tracker_t* tr, uint32_t offset);
+static void* trk_alloc(tracker_t* tr, uint32_t size);
+static void trk_zero(void* p, uint32_t len);
+static int32_t trk_match(const uint8_t* p, const char* s, uint32_t len);
+static uint32_t trk_mod_channels(const uint8_t* sig);
+static int32_t trk_load_mod(tracker_t* tr, const uint8_t* hdr);
+static uint32_t trk_mod_note(uint32_t period);
+static int32_t trk_load_s3m(tracker_t* tr, const uint8_t* hdr);
+static int32_t trk_s3m_pattern(tracker_t* tr, uint32_t p, uint32_t offset,
+                               const int8_t* chan_map);
+static void trk_s3m_fx(trk_cell_t* cell, uint32_t cmd, uint32_t info);
+static int32_t trk_load_xm(tracker_t* tr, const uint8_t* hdr);
+static int32_t trk_xm_pattern(tracker_t* tr, uint32_t p);
+static int32_t trk_xm_instrument(tracker_t* tr, uint32_t i);
+static void trk_env_read(trk_env_t* env, const uint8_t* pts, uint32_t n, uint32_t sus,
+                         uint32_t ls, uint32_t le, uint32_t type);
+static int32_t trk_sample_read(tracker_t* tr, trk_sample_t* s, uint32_t len,
+                               uint32_t loop_start, uint32_t loop_end, uint32_t loop,
+                               uint32_t flags);
+static void trk_sample_map(tracker_t* tr);
+static void trk_restart(tracker_t* tr);
+static void trk_order(tracker_t* tr, uint32_t order, uint32_t row);
+static void trk_tick(tracker_t* tr);
+static void trk_next_row(tracker_t* tr);
+static void trk_row(tracker_t* tr);
+static void trk_cell(tracker_t* tr, uint32_t c);
+static void trk_trigger(tracker_t* tr, uint32_t c, uint32_t offset);
+static void trk_instrument(tracker_t* tr, uint32_t c, uint32_t ins);
+static void trk_key_off(tracker_t* tr, uint32_t c);
+static void trk_vcol(tracker_t* tr, uint32_t c, uint32_t tick);
+static void trk_fx_row(tracker_t* tr, uint32_t c);
+static void trk_fx_tick(tracker_t* tr, uint32_t c, uint32_t tick);
+static void trk_extended(tracker_t* tr, uint32_t c, uint32_t tick);
+static void trk_vslide(trk_chan_t* ch, uint32_t param);
+static void trk_s3m_vslide(trk_chan_t* ch, uint32_t param, uint32_t tick);
+static void trk_porta(tracker_t* tr, trk_chan_t* ch, int32_t delta);
+static void trk_tone(trk_chan_t* ch);
+static void trk_vibrato(trk_chan_t* ch, uint32_t shift);
+static void trk_tremolo(trk_chan_t* ch);
+static void trk_retrig(tracker_t* tr, uint32_t c, uint32_t param);
+static int32_t trk_wave(uint32_t wave, uint32_t pos);
+static int32_t trk_clamp(int32_t val, int32_t lo, int32_t hi);
+static int32_t trk_period(const tracker_t* tr, const trk_chan_t* ch, uint32_t note);
+static void trk_voice(tracker_t* tr, uint32_t c);
+static int32_t trk_env(const trk_env_t* env, uint32_t* pos, uint32_t key_on);
+static uint32_t trk_step(const tracker_t* tr, int32_t period);
+static void trk_mix(tracker_t* tr, int16_t* dst, uint32_t frames);
+static void trk_mix_voice(tracker_t* tr, uint32_t v, uint32_t frames);
+static void trk_advance(tracker_t* tr, uint32_t v, uint32_t frames);
+static uint32_t rd32(const uint8_t* p);
+static uint16_t rd16(const uint8_t* p);
+static uint16_t rd16be(const uint8_t* p);
+
+
+/* tracker_open
+ *
+ * 		DESCRIPTION: loads a MOD, S3M or XM module. Patterns are unpacked
+ *		             and samples converted to 16-bit into the arena, so
+ *		             the file is closed once the module is in memory.
+ *		INPUTS: tr -- module state
+ *		        fname -- name of the file
+ *		        loop -- 1 to play the song forever, 0 to end it where it
+ *		                first goes back to an order already played
+ *		OUTPUTS: tr -- the module, positioned at the start of the song
+ *		RETURN VALUE: 0 on success, TRK_NOT_MODULE if the file has no
+ *		              module signature, -1 on fail
+ *		SIDE EFFECTS: reads the whole file
+ */
+int32_t tracker_open(tracker_t* tr, const uint8_t* fname, int32_t loop) {
+
+    uint8_t hdr[MOD_HDR_SIZE];
+    uint32_t i;
+    int32_t ret;
+
+    trk_zero(tr, (uint8_t*)tr->mix - (uint8_t*)tr);
+    for (i = 0; i < TRK_MAX_PATTERNS; i++) tr->rows[i] = MOD_ROWS;
+    tr->fname = fname;
+    tr->loop = loop ? 1 : 0;
+    tr->arena_used = 0;
+    if (-1 == (tr->fd = ece391_open(fname))) return -1;
+
+    /* XM and S3M are told apart by their first 96 bytes, and whatever
+     * is left of the first 1084 is a MOD if its signature is known */
+    ret = TRK_NOT_MODULE;
+    if (trk_fread(tr, hdr, S3M_HDR_SIZE) == 0) {
+        if (trk_match(hdr, "Extended Module: ", XM_ID_LEN)) {
+            ret = trk_fread(tr, hdr + S3M_HDR_SIZE, XM_HDR_SIZE - S3M_HDR_SIZE) == 0 ?
+                  trk_load_xm(tr, hdr) : -1;
+        } else if (rd32(hdr + S3M_ID_OFFSET) == S3M_ID) {
+            ret = trk_load_s3m(tr, hdr);
+        } else if (trk_fread(tr, hdr + S3M_HDR_SIZE, MOD_HDR_SIZE - S3M_HDR_SIZE) == 0 &&
+                   trk_mod_channels(hdr + MOD_SIG_OFFSET)) {
+            ret = trk_load_mod(tr, hdr);
+        }
+    }
+    ece391_close(tr->fd);
+    tr->fd = -1;
+
+    if (ret != 0) {
+        if (ret == -1) ece391_fdputs(1, (uint8_t*)"unsupported module\n");
+        return ret;
+    }
+
+    if (tr->format != TRK_XM) trk_sample_map(tr);
+    tr->amp = fix_sqrt((AMP_TWO << AMP_SHIFT) / tr->nchannels);
+    trk_restart(tr);
+
+    return 0;
+}
+
+
+/* tracker_read
+ *
+ * 		DESCRIPTION: renders the song a tick at a time, mixing at most
+ *		             TRK_MIX_FRAMES frames at once
+ *		INPUTS: tr -- module state
+ *		        dst -- destination
+ *		        len -- number of bytes
+ *		OUTPUTS: dst -- 16-bit stereo
+ *		RETURN VALUE: bytes rendered, less than len at the end of the song
+ *		SIDE EFFECTS: advances the song
+ */
+int32_t tracker_read(tracker_t* tr, int8_t* dst, uint32_t len) {
+
+    int16_t* out = (int16_t*)dst;
+    uint32_t frames = len / TRK_FRAME_SIZE;
+    uint32_t done = 0;
+    uint32_t n;
+
+    while (done < frames) {
+        if (!tr->tick_left) {
+            if (tr->end) break;
+            trk_tick(tr);
+        }
+
+        n = frames - done;
+        if (n > tr->tick_left) n = tr->tick_left;
+        if (n > TRK_MIX_FRAMES) n = TRK_MIX_FRAMES;
+        trk_mix(tr, out + done * 2, n);
+
+        tr->tick_left -= n;
+        tr->frame += n;
+        done += n;
+    }
+
+    return done * TRK_FRAME_SIZE;
+}
+
+
+/* tracker_seek
+ *
+ * 		DESCRIPTION: plays the song up to a frame without mixing it, from
+ *		             the start if the frame is behind. The voices move as
+ *		             they would have in the mix, so reading on from the
+ *		             frame gives the same samples as having read up to it.
+ *		INPUTS: tr -- module state
+ *		        frame -- frame of the song
+ *		OUTPUTS: tr -- song position
+ *		RETURN VALUE: 0
+ *		SIDE EFFECTS: none
+ */
+int32_t tracker_seek(tracker_t* tr, uint32_t frame) {
+
+    uint32_t n, v;
+
+    if (frame < tr->frame) trk_restart(tr);
+
+    while (tr->frame < frame) {
+        if (!tr->tick_left) {
+            if (tr->end) break;
+            trk_tick(tr);
+        }
+
+        n = frame - tr->frame;
+        if (n > tr->tick_left) n = tr->tick_left;
+        for (v = 0; v < tr->nchannels; v++) {
+            if (tr->v_on[v]) trk_advance(tr, v, n);
+        }
+
+        tr->tick_left -= n;
+        tr->frame += n;
+    }
+
+    return 0;
+}
+
+
+/* tracker_close
+ *
+ * 		DESCRIPTION: releases the module; its file was closed on load
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- emptied
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void tracker_close(tracker_t* tr) {
+
+    tr->arena_used = 0;
+    tr->end = 1;
+}
+
+
+/* trk_fread
+ *
+ * 		DESCRIPTION: reads exactly len bytes of the module file
+ *		INPUTS: tr -- module state
+ *		        buf -- destination
+ *		        len -- number of bytes
+ *		OUTPUTS: buf -- bytes read
+ *		RETURN VALUE: 0 on success, -1 if the file ended first
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t trk_fread(tracker_t* tr, void* buf, uint32_t len) {
+
+    uint8_t* p = buf;
+    int32_t got;
+
+    while (len) {
+        if ((got = ece391_read(tr->fd, p, len)) <= 0) return -1;
+        p += got;
+        len -= got;
+        tr->file_pos += got;
+    }
+
+    return 0;
+}
+
+
+/* trk_fseek
+ *
+ * 		DESCRIPTION: moves to an offset of the module file, reading up to
+ *		             it, or reopening the file first if it is behind
+ *		INPUTS: tr -- module state
+ *		        offset -- byte offset in the file
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the file is shorter
+ *		SIDE EFFECTS: overwrites load_buf
+ */
+static int32_t trk_fseek(tracker_t* tr, uint32_t offset) {
+
+    uint32_t n;
+
+    if (offset < tr->file_pos) {
+        ece391_close(tr->fd);
+        if (-1 == (tr->fd = ece391_open(tr->fname))) return -1;
+        tr->file_pos = 0;
+    }
+
+    while (tr->file_pos < offset) {
+        n = offset - tr->file_pos;
+        if (n > LOAD_BUF_SIZE) n = LOAD_BUF_SIZE;
+        if (trk_fread(tr, load_buf, n) == -1) return -1;
+    }
+
+    return 0;
+}
+
+
+/* trk_alloc
+ *
+ * 		DESCRIPTION: takes zeroed, word-aligned space from the module's
+ *		             arena
+ *		INPUTS: tr -- module state
+ *		        size -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the space, or 0 if the arena is full
+ *		SIDE EFFECTS: none
+ */
+static void* trk_alloc(tracker_t* tr, uint32_t size) {
+
+    void* p;
+
+    size = (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    if (size > TRK_ARENA_SIZE - tr->arena_used) return 0;
+
+    p = tr->arena + tr->arena_used;
+    tr->arena_used += size;
+    trk_zero(p, size);
+
+    return p;
+}
+
+
+/* trk_zero
+ *
+ * 		DESCRIPTION: clears memory
+ *		INPUTS: p -- memory
+ *		        len -- number of bytes
+ *		OUTPUTS: p -- zeros
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_zero(void* p, uint32_t len) {
+
+    uint8_t* b = p;
+
+    while (len--) *b++ = 0;
+}
+
+
+/* trk_match
+ *
+ * 		DESCRIPTION: compares bytes of a file with a signature
+ *		INPUTS: p -- bytes
+ *		        s -- signature
+ *		        len -- number of bytes to compare
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if they match, else 0
+ *		SIDE EFFECTS: none
+ */
+static int32_t trk_match(const uint8_t* p, const char* s, uint32_t len) {
+
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (p[i] != (uint8_t)s[i]) return 0;
+    }
+
+    return 1;
+}
+
+
+/* trk_mod_channels
+ *
+ * 		DESCRIPTION: reads the channel count from a MOD signature: M.K.
+ *		             and its variants for four, nCHN and nnCH for others.
+ *		             FLT8's split patterns and 15-sample MODs, which have
+ *		             no signature, aren't supported.
+ *		INPUTS: sig -- the four bytes at 1080
+ *		OUTPUTS: none
+ *		RETURN VALUE: channels, 0 if the signature isn't known
+ *		SIDE EFFECTS: none
+ */
+static uint32_t trk_mod_channels(const uint8_t* sig) {
+
+    uint32_t n;
+
+    if (trk_match(sig, "M.K.", 4) || trk_match(sig, "M!K!", 4) ||
+        trk_match(sig, "FLT4", 4)) return 4;
+    if (trk_match(sig, "CD81", 4) || trk_match(sig, "OKTA", 4)) return 8;
+
+    if (trk_match(sig + 1, "CHN", 3) && sig[0] >= '1' && sig[0] <= '9') {
+        n = sig[0] - '0';
+    } else if (trk_match(sig + 2, "CH", 2) && sig[0] >= '1' && sig[0] <= '3' &&
+               sig[1] >= '0' && sig[1] <= '9') {
+        n = (sig[0] - '0') * 10 + sig[1] - '0';
+    } else {
+        return 0;
+    }
+
+    return n <= TRK_MAX_CHANNELS ? n : 0;
+}
+
+
+/* trk_load_mod
+ *
+ * 		DESCRIPTION: loads a 31-sample MOD: the patterns follow the
+ *		             header, and the sample data follows the patterns in
+ *		             the order of the sample headers. Channels are panned
+ *		             left, right, right, left as on the Amiga.
+ *		INPUTS: tr -- module state
+ *		        hdr -- the first 1084 bytes of the file
+ *		OUTPUTS: tr -- the module
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_load_mod(tracker_t* tr, const uint8_t* hdr) {
+
+    const uint8_t* h;
+    const uint8_t* b;
+    trk_cell_t* cell;
+    uint32_t i, p, r, c, len, loop_start, loop_len, row_size;
+
+    tr->format = TRK_MOD;
+    tr->amiga_limits = 1;
+    tr->nchannels = trk_mod_channels(hdr + MOD_SIG_OFFSET);
+    tr->norders = hdr[MOD_LEN_OFFSET];
+    tr->restart = hdr[MOD_LEN_OFFSET + 1];
+    if (!tr->norders || tr->norders > MOD_ORDERS) return -1;
+    if (tr->restart >= tr->norders) tr->restart = 0;
+
+    /* every entry of the order list counts, used or not */
+    for (i = 0; i < MOD_ORDERS; i++) {
+        tr->orders[i] = hdr[MOD_ORDER_OFFSET + i];
+        if (tr->orders[i] >= tr->npatterns) tr->npatterns = tr->orders[i] + 1;
+    }
+    if (tr->npatterns > TRK_MAX_PATTERNS / 2) return -1;
+
+    for (c = 0; c < tr->nchannels; c++) {
+        tr->init_pan[c] = ((c & 3) == 0 || (c & 3) == 3) ? MOD_LEFT : MOD_RIGHT;
+    }
+    tr->init_speed = DEFAULT_SPEED;
+    tr->init_tempo = DEFAULT_TEMPO;
+    tr->init_gvol = MAX_VOLUME;
+
+    row_size = tr->nchannels * MOD_CELL_SIZE;
+    for (p = 0; p < tr->npatterns; p++) {
+        if (!(cell = trk_alloc(tr, MOD_ROWS * tr->nchannels * sizeof(trk_cell_t)))) return -1;
+        tr->patterns[p] = cell;
+        for (r = 0; r < MOD_ROWS; r++) {
+            if (trk_fread(tr, load_buf, row_size) == -1) return -1;
+            for (c = 0, b = load_buf; c < tr->nchannels; c++, b += MOD_CELL_SIZE, cell++) {
+                cell->note = trk_mod_note(((b[0] & NIBBLE_MASK) << 8) | b[1]);
+                cell->ins = (b[0] & 0xF0) | (b[2] >> NIBBLE);
+                cell->vol = 0;
+                cell->fx = b[2] & NIBBLE_MASK;
+                cell->param = b[3];
+            }
+        }
+    }
+
+    /* lengths and loops are in words; a loop of one word is none */
+    tr->nsamples = MOD_SAMPLES;
+    for (i = 0; i < MOD_SAMPLES; i++) {
+        h = hdr + MOD_SMP_OFFSET + i * MOD_SMP_SIZE;
+        len = rd16be(h + 22) * 2;
+        loop_start = rd16be(h + 26) * 2;
+        loop_len = rd16be(h + 28) * 2;
+        tr->smp[i].c2spd = finetune_tab[h[24] & NIBBLE_MASK];
+        tr->smp[i].volume = h[25] < MAX_VOLUME ? h[25] : MAX_VOLUME;
+        tr->smp[i].pan = CENTRE_PAN;
+        if (trk_sample_read(tr, &tr->smp[i], len, loop_start, loop_start + loop_len,
+                            loop_len > 2 ? TRK_LOOP_FORWARD : TRK_LOOP_NONE, 0) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* trk_mod_note
+ *
+ * 		DESCRIPTION: finds the note nearest an Amiga period, with
+ *		             ProTracker's C-2 (428) at C-4
+ *		INPUTS: period -- Amiga period, 0 for no note
+ *		OUTPUTS: none
+ *		RETURN VALUE: note, 0 for none
+ *		SIDE EFFECTS: none
+ */
+static uint32_t trk_mod_note(uint32_t period) {
+
+    uint32_t n, best, p;
+    int32_t d, best_d;
+
+    if (!period) return 0;
+
+    period *= PERIOD_SCALE;
+    best = 0;
+    best_d = 0x7FFFFFFF;
+    for (n = 0; n < TRK_NOTES; n++) {
+        p = period_tab[n % SEMITONES] >> (n / SEMITONES);
+        d = (int32_t)p - (int32_t)period;
+        if (d < 0) d = -d;
+        if (d < best_d) {
+            best_d = d;
+            best = n + 1;
+        }
+    }
+
+    return best;
+}
+
+
+/* trk_load_s3m
+ *
+ * 		DESCRIPTION: loads a Scream Tracker 3 module. Its instruments and
+ *		             patterns are found through offsets after the order
+ *		             list; order list markers are dropped, and disabled
+ *		             and AdLib channels are left out.
+ *		INPUTS: tr -- module state
+ *		        hdr -- the first 96 bytes of the file
+ *		OUTPUTS: tr -- the module
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_load_s3m(tracker_t* tr, const uint8_t* hdr) {
+
+    uint16_t ins_para[TRK_MAX_INSTRUMENTS];
+    uint16_t pat_para[TRK_MAX_PATTERNS];
+    uint32_t smp_off[TRK_MAX_INSTRUMENTS];
+    uint32_t smp_end[TRK_MAX_INSTRUMENTS];
+    int8_t chan_map[TRK_MAX_CHANNELS];
+    const uint8_t* b;
+    trk_sample_t* s;
+    uint32_t i, c, n, nins, npat, unsigned_data, flags, setting;
+
+    tr->format = TRK_S3M;
+    tr->st3 = 1;
+    n = rd16(hdr + S3M_NORDERS);
+    nins = rd16(hdr + S3M_NINS);
+    npat = rd16(hdr + S3M_NPATTERNS);
+    unsigned_data = rd16(hdr + S3M_FFI) == S3M_UNSIGNED;
+    if (n > TRK_MAX_ORDERS || nins > TRK_MAX_INSTRUMENTS || npat > TRK_MAX_PATTERNS) return -1;
+
+    tr->init_gvol = hdr[S3M_GVOL] < MAX_VOLUME ? hdr[S3M_GVOL] : MAX_VOLUME;
+    tr->init_speed = hdr[S3M_SPEED] ? hdr[S3M_SPEED] : DEFAULT_SPEED;
+    tr->init_tempo = hdr[S3M_TEMPO] >= MIN_TEMPO ? hdr[S3M_TEMPO] : DEFAULT_TEMPO;
+
+    /* settings below 8 are left channels and 8 to 15 right ones */
+    for (c = 0; c < TRK_MAX_CHANNELS; c++) {
+        setting = hdr[S3M_SETTINGS + c];
+        chan_map[c] = -1;
+        if (setting >= S3M_CHAN_OFF) continue;
+        chan_map[c] = tr->nchannels;
+        tr->init_pan[tr->nchannels++] = setting < S3M_RIGHT ? S3M_PAN_LEFT : S3M_PAN_RIGHT;
+    }
+    if (!tr->nchannels) return -1;
+
+    if (trk_fread(tr, load_buf, n + (nins + npat) * 2) == -1) return -1;
+    for (i = 0; i < n && load_buf[i] != S3M_ORDER_END; i++) {
+        if (load_buf[i] != S3M_ORDER_SKIP) tr->orders[tr->norders++] = load_buf[i];
+    }
+    if (!tr->norders) return -1;
+    for (i = 0, b = load_buf + n; i < nins; i++, b += 2) ins_para[i] = rd16(b);
+    for (i = 0; i < npat; i++, b += 2) pat_para[i] = rd16(b);
+
+    if (hdr[S3M_DEF_PAN] == S3M_PAN_TABLE) {
+        if (trk_fread(tr, load_buf, TRK_MAX_CHANNELS) == -1) return -1;
+        for (c = 0; c < TRK_MAX_CHANNELS; c++) {
+            if (chan_map[c] >= 0 && (load_buf[c] & S3M_PAN_SET)) {
+                tr->init_pan[(uint32_t)chan_map[c]] = (load_buf[c] & NIBBLE_MASK) * S3M_PAN_SCALE;
+            }
+        }
+    }
+    if (!(hdr[S3M_MASTER] & S3M_STEREO)) {
+        for (c = 0; c < tr->nchannels; c++) tr->init_pan[c] = CENTRE_PAN;
+    }
+
+    /* instrument headers, then patterns, then sample data, each usually
+     * in file order */
+    tr->nsamples = nins;
+    for (i = 0; i < nins; i++) {
+        s = &tr->smp[i];
+        smp_off[i] = 0;
+        if (trk_fseek(tr, ins_para[i] * S3M_PARA) == -1 ||
+            trk_fread(tr, load_buf, S3M_INS_SIZE) == -1) return -1;
+        if (load_buf[0] != S3M_SMP_SAMPLE) continue;
+
+        smp_off[i] = ((load_buf[S3M_SMP_SEG] << 16) | rd16(load_buf + S3M_SMP_SEG + 1)) * S3M_PARA;
+        s->len = rd32(load_buf + S3M_SMP_LEN);
+        s->loop_start = rd32(load_buf + S3M_SMP_LOOP);
+        smp_end[i] = rd32(load_buf + S3M_SMP_LOOP_END);
+        flags = load_buf[S3M_SMP_FLAGS];
+        s->loop = (flags & S3M_LOOPED) ? TRK_LOOP_FORWARD : TRK_LOOP_NONE;
+        s->volume = load_buf[S3M_SMP_VOL] < MAX_VOLUME ? load_buf[S3M_SMP_VOL] : MAX_VOLUME;
+        s->c2spd = rd32(load_buf + S3M_SMP_C2SPD);
+        if (!s->c2spd || s->c2spd > 0xFFFF) s->c2spd = C4_RATE;
+        s->pan = CENTRE_PAN;
+        s->finetune = (flags & S3M_16BIT) ? SMP_16BIT : 0;
+        if (unsigned_data) s->finetune |= SMP_UNSIGNED;
+    }
+
+    for (i = 0; i < npat; i++) {
+        if (pat_para[i] && trk_s3m_pattern(tr, i, pat_para[i] * S3M_PARA, chan_map) == -1) {
+            return -1;
+        }
+    }
+    tr->npatterns = npat;
+
+    /* the sample flags were kept in finetune until the data is read */
+    for (i = 0; i < nins; i++) {
+        s = &tr->smp[i];
+        flags = s->finetune;
+        s->finetune = 0;
+        if (!smp_off[i]) continue;
+        if (trk_fseek(tr, smp_off[i]) == -1 ||
+            trk_sample_read(tr, s, s->len, s->loop_start, smp_end[i], s->loop, flags) == -1) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+
+/* trk_s3m_pattern
+ *
+ * 		DESCRIPTION: unpacks an S3M pattern: 64 rows of packed cells, each
+ *		             row ended by a 0
+ *		INPUTS: tr -- module state
+ *		        p -- pattern number
+ *		        offset -- its offset in the file
+ *		        chan_map -- module channel of each S3M channel, -1 if off
+ *		OUTPUTS: tr -- the pattern
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_s3m_pattern(tracker_t* tr, uint32_t p, uint32_t offset,
+                               const int8_t* chan_map) {
+
+    trk_cell_t* cells;
+    trk_cell_t* cell;
+    trk_cell_t skip;
+    const uint8_t* b;
+    const uint8_t* end;
+    uint8_t* packed;
+    uint32_t row, what, note, size, mark;
+
+    if (!(cells = trk_alloc(tr, S3M_ROWS * tr->nchannels * sizeof(trk_cell_t)))) return -1;
+    tr->patterns[p] = cells;
+
+    /* the packed data is read into the arena past the cells and given
+     * back once they're unpacked */
+    if (trk_fseek(tr, offset) == -1 || trk_fread(tr, load_buf, 2) == -1) return -1;
+    size = rd16(load_buf);
+    size = size > 2 ? size - 2 : 0;
+    mark = tr->arena_used;
+    if (!(packed = trk_alloc(tr, size))) return -1;
+    if (trk_fread(tr, packed, size) == -1) size = 0;
+
+    b = packed;
+    end = packed + size;
+    for (row = 0; row < S3M_ROWS && b < end; row++) {
+        while (b < end && (what = *b++) != 0) {
+            cell = chan_map[what & S3M_CHAN_MASK] >= 0 ?
+                   cells + row * tr->nchannels + chan_map[what & S3M_CHAN_MASK] : &skip;
+            if (what & S3M_HAS_NOTE) {
+                if (end - b < 2) break;
+                note = b[0];
+                if (note == S3M_NOTE_CUT) {
+                    cell->note = TRK_NOTE_CUT;
+                } else if (note != S3M_NOTE_NONE) {
+                    cell->note = (note >> NIBBLE) * SEMITONES + (note & NIBBLE_MASK) + 1;
+                    if (cell->note > TRK_NOTES) cell->note = 0;
+                }
+                cell->ins = b[1];
+                b += 2;
+            }
+            if (what & S3M_HAS_VOL) {
+                if (end - b < 1) break;
+                if (*b <= MAX_VOLUME) cell->vol = VCOL_VOLUME + *b;
+                b++;
+            }
+            if (what & S3M_HAS_FX) {
+                if (end - b < 2) break;
+                trk_s3m_fx(cell, b[0], b[1]);
+                b += 2;
+            }
+        }
+    }
+
+    tr->arena_used = mark;
+
+    return 0;
+}
+
+
+/* trk_s3m_fx
+ *
+ * 		DESCRIPTION: converts an S3M effect to the XM numbering, or to an
+ *		             S3M effect where the two behave differently. S
+ *		             sub-effects become the E ones that do the same.
+ *		INPUTS: cell -- the cell
+ *		        cmd -- effect letter, 1 for A
+ *		        info -- its parameter
+ *		OUTPUTS: cell -- effect and parameter, none if not supported
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_s3m_fx(trk_cell_t* cell, uint32_t cmd, uint32_t info) {
+
+    static const uint8_t fx_map[] = {
+        FX_NONE, FX_SPEED, FX_JUMP, FX_BREAK, FX_S3M_VSLIDE, FX_S3M_DOWN,
+        FX_S3M_UP, FX_TONE, FX_VIBRATO, FX_TREMOR, FX_ARPEGGIO,
+        FX_S3M_VIB_VSLIDE, FX_S3M_TONE_VSLIDE, FX_NONE, FX_NONE, FX_OFFSET,
+        FX_NONE, FX_RETRIG, FX_TREMOLO, FX_EXTENDED, FX_TEMPO, FX_FINE_VIB,
+        FX_GVOL, FX_NONE, FX_PAN
+    };
+    static const uint8_t ext_map[] = {
+        0, 0x3, EXT_FINETUNE, EXT_VIB_WAVE, EXT_TREM_WAVE, 0, 0, 0, EXT_PAN,
+        0, 0, EXT_LOOP, EXT_CUT, EXT_DELAY, EXT_PATTERN_DELAY, 0
+    };
+
+    cell->fx = 0;
+    cell->param = 0;
+    if (cmd >= sizeof(fx_map) || fx_map[cmd] == FX_NONE) return;
+
+    cell->fx = fx_map[cmd];
+    cell->param = info;
+    if (cell->fx == FX_EXTENDED) {
+        cell->param = (ext_map[info >> NIBBLE] << NIBBLE) | (info & NIBBLE_MASK);
+        if (!ext_map[info >> NIBBLE]) cell->fx = 0;
+    } else if (cell->fx == FX_PAN) {
+        cell->param = info * 2 < MAX_PAN ? info * 2 : MAX_PAN;
+    }
+}
+
+
+/* trk_load_xm
+ *
+ * 		DESCRIPTION: loads a FastTracker 2 module: its patterns, then its
+ *		             instruments, each followed by its sample headers and
+ *		             the sample data
+ *		INPUTS: tr -- module state
+ *		        hdr -- the first 336 bytes of the file
+ *		OUTPUTS: tr -- the module
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_load_xm(tracker_t* tr, const uint8_t* hdr) {
+
+    uint32_t i;
+
+    tr->format = TRK_XM;
+    tr->norders = rd16(hdr + XM_NORDERS);
+    tr->restart = rd16(hdr + XM_RESTART);
+    tr->nchannels = rd16(hdr + XM_NCHANNELS);
+    tr->npatterns = rd16(hdr + XM_NPATTERNS);
+    tr->ninstruments = rd16(hdr + XM_NINS);
+    tr->linear = rd16(hdr + XM_FLAGS) & XM_LINEAR;
+    tr->init_speed = rd16(hdr + XM_SPEED);
+    tr->init_tempo = rd16(hdr + XM_TEMPO);
+    tr->init_gvol = MAX_VOLUME;
+    if (!tr->norders || tr->norders > TRK_MAX_ORDERS || !tr->nchannels ||
+        tr->nchannels > TRK_MAX_CHANNELS || tr->npatterns > TRK_MAX_PATTERNS ||
+        tr->ninstruments > TRK_MAX_INSTRUMENTS) return -1;
+    if (tr->restart >= tr->norders) tr->restart = 0;
+    if (!tr->init_speed || tr->init_speed >= TEMPO_PARAM) tr->init_speed = DEFAULT_SPEED;
+    if (tr->init_tempo < MIN_TEMPO || tr->init_tempo > 0xFF) tr->init_tempo = DEFAULT_TEMPO;
+
+    for (i = 0; i < tr->norders; i++) tr->orders[i] = hdr[XM_ORDERS + i];
+    for (i = 0; i < tr->nchannels; i++) tr->init_pan[i] = CENTRE_PAN;
+
+    if (trk_fseek(tr, XM_HDR_OFFSET + rd32(hdr + XM_HDR_OFFSET)) == -1) return -1;
+    for (i = 0; i < tr->npatterns; i++) {
+        if (trk_xm_pattern(tr, i) == -1) return -1;
+    }
+    for (i = 0; i < tr->ninstruments; i++) {
+        if (trk_xm_instrument(tr, i) == -1) return -1;
+    }
+
+    return 0;
+}
+
+
+/* trk_xm_pattern
+ *
+ * 		DESCRIPTION: unpacks an XM pattern. A cell starting with a byte
+ *		             with its top bit set has a field for each of its low
+ *		             five bits; any other starts with the note and has all
+ *		             five.
+ *		INPUTS: tr -- module state
+ *		        p -- pattern number
+ *		OUTPUTS: tr -- the pattern
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_xm_pattern(tracker_t* tr, uint32_t p) {
+
+    trk_cell_t* cell;
+    uint8_t* packed;
+    uint8_t field[sizeof(trk_cell_t)];
+    uint32_t start, rows, size, mark, i, n, f, what;
+
+    start = tr->file_pos;
+    if (trk_fread(tr, load_buf, XM_PAT_HDR_SIZE) == -1) return -1;
+    rows = rd16(load_buf + 5);
+    size = rd16(load_buf + 7);
+    if (!rows || rows > TRK_MAX_ROWS) return -1;
+    if (trk_fseek(tr, start + rd32(load_buf)) == -1) return -1;
+
+    tr->rows[p] = rows;
+    n = rows * tr->nchannels;
+    if (!(cell = trk_alloc(tr, n * sizeof(trk_cell_t)))) return -1;
+    tr->patterns[p] = cell;
+
+    mark = tr->arena_used;
+    if (!(packed = trk_alloc(tr, size))) return -1;
+    if (trk_fread(tr, packed, size) == -1) return -1;
+
+    for (i = 0; i < size && n; n--, cell++) {
+        what = packed[i] & XM_PACKED ? packed[i++] : 0x1F;
+        for (f = 0; f < sizeof(trk_cell_t); f++) {
+            field[f] = 0;
+            if ((what & (1 << f)) && i < size) field[f] = packed[i++];
+        }
+        cell->note = field[0] <= XM_NOTE_OFF ? field[0] : 0;
+        cell->ins = field[1];
+        cell->vol = field[2] >= VCOL_VOLUME ? field[2] : 0;
+        cell->fx = field[3];
+        cell->param = field[4];
+    }
+
+    tr->arena_used = mark;
+
+    return 0;
+}
+
+
+/* trk_xm_instrument
+ *
+ * 		DESCRIPTION: loads an XM instrument. Its samples are numbered on
+ *		             from those of the instruments before it, and its
+ *		             keymap is made to name them that way.
+ *		INPUTS: tr -- module state
+ *		        i -- instrument number
+ *		OUTPUTS: tr -- the instrument and its samples
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: reads the file
+ */
+static int32_t trk_xm_instrument(tracker_t* tr, uint32_t i) {
+
+    trk_instrument_t* in = &tr->ins[i];
+    trk_sample_t* s;
+    uint8_t hdr[XM_INS_EXT_SIZE];
+    uint32_t len[XM_MAX_SAMPLES];
+    uint32_t loop_end[XM_MAX_SAMPLES];
+    uint32_t flags[XM_MAX_SAMPLES];
+    uint32_t start, size, nsmp, smp_size, base, j, k, wide;
+    static const uint8_t vib_map[] = { 0, 2, 1, 1 };
+    int32_t pow;
+
+    start = tr->file_pos;
+    if (trk_fread(tr, load_buf, XM_INS_HDR_SIZE) == -1) return -1;
+    size = rd32(load_buf);
+    nsmp = rd16(load_buf + XM_INS_HDR_SIZE - 2);
+    if (nsmp > XM_MAX_SAMPLES || tr->nsamples + nsmp > TRK_MAX_SAMPLES) return -1;
+    if (!nsmp) return trk_fseek(tr, start + (size > XM_INS_HDR_SIZE ? size : XM_INS_HDR_SIZE));
+
+    trk_zero(hdr, XM_INS_EXT_SIZE);
+    if (size < XM_INS_HDR_SIZE) size = XM_INS_HDR_SIZE;
+    if (trk_fread(tr, hdr, size - XM_INS_HDR_SIZE < XM_INS_EXT_SIZE ?
+                  size - XM_INS_HDR_SIZE : XM_INS_EXT_SIZE) == -1) return -1;
+    if (trk_fseek(tr, start + size) == -1) return -1;
+    smp_size = rd32(hdr);
+
+    base = tr->nsamples;
+    for (k = 0; k < TRK_NOTES; k++) {
+        in->keymap[k] = hdr[XM_KEYMAP + k] < nsmp ? base + hdr[XM_KEYMAP + k] + 1 : 0;
+    }
+    trk_env_read(&in->vol_env, hdr + XM_VOL_ENV, hdr[XM_ENV_COUNTS], hdr[XM_ENV_FORMS],
+                 hdr[XM_ENV_FORMS + 1], hdr[XM_ENV_FORMS + 2], hdr[XM_ENV_TYPES]);
+    trk_env_read(&in->pan_env, hdr + XM_PAN_ENV, hdr[XM_ENV_COUNTS + 1], hdr[XM_ENV_FORMS + 3],
+                 hdr[XM_ENV_FORMS + 4], hdr[XM_ENV_FORMS + 5], hdr[XM_ENV_TYPES + 1]);
+    in->vib_type = vib_map[hdr[XM_VIB] & 3];
+    in->vib_sweep = hdr[XM_VIB + 1];
+    in->vib_depth = hdr[XM_VIB + 2];
+    in->vib_rate = hdr[XM_VIB + 3];
+    in->fadeout = rd16(hdr + XM_FADEOUT) * XM_FADE_SCALE;
+
+    /* the headers of all the samples come before the data of any */
+    for (j = 0; j < nsmp; j++) {
+        s = &tr->smp[base + j];
+        start = tr->file_pos;
+        if (trk_fread(tr, load_buf, XM_SMP_HDR_SIZE) == -1) return -1;
+        if (smp_size > XM_SMP_HDR_SIZE && trk_fseek(tr, start + smp_size) == -1) return -1;
+
+        wide = load_buf[XM_SMP_TYPE] & XM_SMP_16BIT ? 1 : 0;
+        len[j] = rd32(load_buf) >> wide;
+        s->loop_start = rd32(load_buf + XM_SMP_LOOP) >> wide;
+        loop_end[j] = s->loop_start + (rd32(load_buf + XM_SMP_LOOP_LEN) >> wide);
+        s->loop = load_buf[XM_SMP_TYPE] & XM_LOOP_MASK;
+        if (s->loop > TRK_LOOP_PINGPONG) s->loop = TRK_LOOP_FORWARD;
+        flags[j] = SMP_DELTA | (wide ? SMP_16BIT : 0);
+        s->volume = load_buf[XM_SMP_VOL] < MAX_VOLUME ? load_buf[XM_SMP_VOL] : MAX_VOLUME;
+        s->finetune = (int8_t)load_buf[XM_SMP_FINETUNE];
+        s->pan = load_buf[XM_SMP_PAN];
+        s->relnote = (int8_t)load_buf[XM_SMP_RELNOTE];
+
+        /* Amiga periods fold the transpose into the rate at C-4 */
+        pow = fix_pow2((s->relnote * 128 + s->finetune) * (1 << Q16_SHIFT) / XM_FINETUNE_OCTAVE);
+        s->c2spd = ((uint64_t)C4_RATE * (uint32_t)pow) >> Q16_SHIFT;
+    }
+    tr->nsamples += nsmp;
+
+    for (j = 0; j < nsmp; j++) {
+        s = &tr->smp[base + j];
+        if (trk_sample_read(tr, s, len[j], s->loop_start, loop_end[j], s->loop,
+                            flags[j]) == -1) return -1;
+    }
+
+    return 0;
+}
+
+
+/* trk_env_read
+ *
+ * 		DESCRIPTION: reads an XM envelope, turning it off if it has no
+ *		             points and dropping sustain and loop points that it
+ *		             doesn't have. Points going backwards in time are
+ *		             moved up to the one before.
+ *		INPUTS: env -- the envelope
+ *		        pts -- twelve points, each a tick and a value, 16 bits each
+ *		        n -- points used
+ *		        sus -- sustain point
+ *		        ls -- loop start point
+ *		        le -- loop end point
+ *		        type -- TRK_ENV_ flags
+ *		OUTPUTS: env -- the envelope
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_env_read(trk_env_t* env, const uint8_t* pts, uint32_t n, uint32_t sus,
+                         uint32_t ls, uint32_t le, uint32_t type) {
+
+    uint32_t i, y;
+
+    if (n > TRK_ENV_POINTS) n = TRK_ENV_POINTS;
+    env->npoints = n;
+    env->flags = n ? type & (TRK_ENV_ON | TRK_ENV_SUSTAIN | TRK_ENV_LOOP) : 0;
+    if (sus >= n) env->flags &= ~TRK_ENV_SUSTAIN;
+    if (le >= n || ls > le) env->flags &= ~TRK_ENV_LOOP;
+    env->sustain = sus;
+    env->loop_start = ls;
+    env->loop_end = le;
+
+    for (i = 0; i < n; i++, pts += XM_ENV_POINT_SIZE) {
+        env->x[i] = rd16(pts);
+        if (i && env->x[i] < env->x[i - 1]) env->x[i] = env->x[i - 1];
+        y = rd16(pts + 2);
+        env->y[i] = y < MAX_VOLUME ? y : MAX_VOLUME;
+    }
+}
+
+
+/* trk_sample_read
+ *
+ * 		DESCRIPTION: converts a sample's data into the arena as 16-bit.
+ *		             Data past the loop end is never played and is left
+ *		             out; a ping-pong loop is followed by its body
+ *		             backwards, so it plays as a forward loop. A guard
+ *		             sample past the end holds what comes after it, for
+ *		             the interpolation. A file ending early leaves the
+ *		             rest silent.
+ *		INPUTS: tr -- module state
+ *		        s -- the sample
+ *		        len -- length in samples
+ *		        loop_start -- loop body in samples, end exclusive
+ *		        loop_end
+ *		        loop -- TRK_LOOP_ type
+ *		        flags -- SMP_ storage flags
+ *		OUTPUTS: s -- data, length and loop
+ *		RETURN VALUE: 0 on success, -1 if the arena is full
+ *		SIDE EFFECTS: reads the file; overwrites load_buf
+ */
+static int32_t trk_sample_read(tracker_t* tr, trk_sample_t* s, uint32_t len,
+                               uint32_t loop_start, uint32_t loop_end, uint32_t loop,
+                               uint32_t flags) {
+
+    int16_t* data;
+    uint32_t keep, total, body, width, n, i, done, bad, acc;
+    int32_t v;
+
+    if (loop_end > len) loop_end = len;
+    if (loop != TRK_LOOP_NONE && (loop_start >= loop_end || loop_end - loop_start < 2)) {
+        loop = TRK_LOOP_NONE;
+    }
+    keep = loop != TRK_LOOP_NONE ? loop_end : len;
+    body = loop_end - loop_start;
+    total = keep + (loop == TRK_LOOP_PINGPONG ? body - 2 : 0);
+
+    s->data = 0;
+    s->len = 0;
+    s->loop = TRK_LOOP_NONE;
+    if (!(data = trk_alloc(tr, (total + 1) * sizeof(int16_t)))) return -1;
+
+    width = flags & SMP_16BIT ? 2 : 1;
+    acc = 0;
+    bad = 0;
+    for (done = 0; done < len; done += n) {
+        n = len - done;
+        if (n > LOAD_BUF_SIZE / width) n = LOAD_BUF_SIZE / width;
+        if (!bad && trk_fread(tr, load_buf, n * width) == -1) bad = 1;
+        if (bad) trk_zero(load_buf, n * width);
+        for (i = 0; i < n && done + i < keep; i++) {
+            if (width == 2) {
+                v = rd16(load_buf + i * 2);
+                if (flags & SMP_UNSIGNED) v ^= 0x8000;
+                if (flags & SMP_DELTA) v = acc += v;
+                v = (int16_t)v;
+            } else {
+                v = load_buf[i];
+                if (flags & SMP_UNSIGNED) v ^= 0x80;
+                if (flags & SMP_DELTA) v = acc += v;
+                v = (int8_t)v * 256;
+            }
+            data[done + i] = v;
+        }
+    }
+
+    if (loop == TRK_LOOP_PINGPONG) {
+        for (i = 0; i < body - 2; i++) data[keep + i] = data[loop_end - 2 - i];
+        loop = TRK_LOOP_FORWARD;
+    }
+    data[total] = loop != TRK_LOOP_NONE ? data[loop_start] : 0;
+
+    s->data = data;
+    s->len = total;
+    s->loop_start = loop_start;
+    s->loop = loop;
+
+    return 0;
+}
+
+
+/* trk_sample_map
+ *
+ * 		DESCRIPTION: gives a MOD or S3M an instrument for each sample, so
+ *		             the player finds samples the same way as in an XM
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- instruments
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_sample_map(tracker_t* tr) {
+
+    uint32_t i, k;
+
+    tr->ninstruments = tr->nsamples;
+    for (i = 0; i < tr->nsamples; i++) {
+        for (k = 0; k < TRK_NOTES; k++) tr->ins[i].keymap[k] = i + 1;
+    }
+}
+
+
+/* trk_restart
+ *
+ * 		DESCRIPTION: goes back to the start of the song with every
+ *		             channel silent and the speed, tempo and global volume
+ *		             the module starts with
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- song position and channels
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_restart(tracker_t* tr) {
+
+    uint32_t c;
+
+    trk_zero(tr->chan, sizeof(tr->chan));
+    trk_zero(tr->visited, sizeof(tr->visited));
+    trk_zero(tr->v_on, sizeof(tr->v_on));
+    for (c = 0; c < tr->nchannels; c++) tr->chan[c].pan = tr->init_pan[c];
+
+    tr->speed = tr->init_speed;
+    tr->tempo = tr->init_tempo;
+    tr->gvol = tr->init_gvol;
+    tr->tick = 0;
+    tr->pattern_delay = 0;
+    tr->jump = 0;
+    tr->loop_jump = 0;
+    tr->tick_left = 0;
+    tr->tick_rem = 0;
+    tr->frame = 0;
+    tr->end = 0;
+    trk_order(tr, 0, 0);
+}
+
+
+/* trk_order
+ *
+ * 		DESCRIPTION: moves to a row of an order. Running off the order
+ *		             list, or coming back to an order already played, is
+ *		             the end of the song; when looping, the song goes on
+ *		             from the restart position or the order it came back
+ *		             to, and the orders played are forgotten.
+ *		INPUTS: tr -- module state
+ *		        order -- order number
+ *		        row -- row of its pattern, the first if it has fewer
+ *		OUTPUTS: tr -- song position, or end set
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_order(tracker_t* tr, uint32_t order, uint32_t row) {
+
+    if (order >= tr->norders || tr->visited[order]) {
+        if (!tr->loop) {
+            tr->end = 1;
+            return;
+        }
+        trk_zero(tr->visited, sizeof(tr->visited));
+        if (order >= tr->norders) {
+            order = tr->restart;
+            row = 0;
+        }
+    }
+
+    tr->visited[order] = 1;
+    tr->order = order;
+    tr->row = row < tr->rows[tr->orders[order]] ? row : 0;
+}
+
+
+/* trk_tick
+ *
+ * 		DESCRIPTION: plays one tick: the row's notes and effects on its
+ *		             first, the running effects on the rest, then the
+ *		             voices for all channels. A pattern delay repeats the
+ *		             row's ticks without its notes.
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- channels, voices and song position; tick_left
+ *		              set to the tick's length in frames
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_tick(tracker_t* tr) {
+
+    uint32_t c, total;
+
+    if (tr->tick == 0) {
+        trk_row(tr);
+    } else {
+        for (c = 0; c < tr->nchannels; c++) trk_fx_tick(tr, c, tr->tick);
+    }
+    for (c = 0; c < tr->nchannels; c++) trk_voice(tr, c);
+
+    total = TRK_RATE * TICK_NUM + tr->tick_rem;
+    tr->tick_left = total / (tr->tempo * TICK_DEN);
+    tr->tick_rem = total % (tr->tempo * TICK_DEN);
+
+    if (++tr->tick >= tr->speed * (tr->pattern_delay + 1)) {
+        tr->tick = 0;
+        tr->pattern_delay = 0;
+        trk_next_row(tr);
+    }
+}
+
+
+/* trk_next_row
+ *
+ * 		DESCRIPTION: moves to the next row, or where a jump, break or
+ *		             pattern loop on the row just played says
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- song position
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_next_row(tracker_t* tr) {
+
+    if (tr->jump) {
+        tr->jump = 0;
+        tr->loop_jump = 0;
+        trk_order(tr, tr->jump_order, tr->jump_row);
+    } else if (tr->loop_jump) {
+        tr->loop_jump = 0;
+        tr->row = tr->loop_row;
+    } else if (++tr->row >= tr->rows[tr->orders[tr->order]]) {
+        trk_order(tr, tr->order + 1, 0);
+    }
+}
+
+
+/* trk_row
+ *
+ * 		DESCRIPTION: starts a row, playing each channel's cell, or keeping
+ *		             it for later if its note is delayed
+ *		INPUTS: tr -- module state
+ *		OUTPUTS: tr -- channels
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_row(tracker_t* tr) {
+
+    static const trk_cell_t empty;
+    const trk_cell_t* cells = tr->patterns[tr->orders[tr->order]];
+    trk_chan_t* ch;
+    uint32_t c;
+
+    for (c = 0; c < tr->nchannels; c++) {
+        ch = &tr->chan[c];
+        ch->cell = cells ? cells[tr->row * tr->nchannels + c] : empty;
+        ch->delay = 0;
+        ch->cut = 0;
+
+        /* ST3 effects with no parameter take the channel's last one */
+        if (tr->st3 && (ch->cell.fx == FX_S3M_VSLIDE || ch->cell.fx == FX_S3M_DOWN ||
+                        ch->cell.fx == FX_S3M_UP || ch->cell.fx == FX_TREMOR ||
+                        ch->cell.fx == FX_S3M_VIB_VSLIDE || ch->cell.fx == FX_S3M_TONE_VSLIDE ||
+                        ch->cell.fx == FX_RETRIG || ch->cell.fx == FX_EXTENDED)) {
+            if (ch->cell.param) ch->mem_s3m = ch->cell.param;
+            else ch->cell.param = ch->mem_s3m;
+        }
+
+        if (ch->cell.fx == FX_EXTENDED && (ch->cell.param >> NIBBLE) == EXT_DELAY &&
+            (ch->cell.param & NIBBLE_MASK)) {
+            ch->delay = ch->cell.param & NIBBLE_MASK;
+            ch->vol_delta = ch->period_delta = ch->arp = 0;
+            continue;
+        }
+        trk_cell(tr, c);
+    }
+}
+
+
+/* trk_cell
+ *
+ * 		DESCRIPTION: plays a channel's cell: its instrument, its note,
+ *		             which starts the sample unless the note is a tone
+ *		             portamento's target, and the volume column and effect
+ *		             as they act on the row's first tick
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		OUTPUTS: tr -- channel and voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_cell(tracker_t* tr, uint32_t c) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    const trk_cell_t* cell = &ch->cell;
+    const trk_sample_t* s;
+    uint32_t note = cell->note;
+    uint32_t porta, smp, offset;
+
+    ch->vol_delta = ch->period_delta = ch->arp = 0;
+    porta = cell->fx == FX_TONE || cell->fx == FX_TONE_VSLIDE ||
+            cell->fx == FX_S3M_TONE_VSLIDE || cell->vol >= VCOL_TONE;
+
+    if (cell->ins) trk_instrument(tr, c, cell->ins);
+
+    if (note == TRK_NOTE_OFF) {
+        trk_key_off(tr, c);
+    } else if (note == TRK_NOTE_CUT) {
+        ch->volume = 0;
+        tr->v_on[c] = 0;
+    } else if (note && ch->ins) {
+        smp = tr->ins[ch->ins - 1].keymap[note - 1];
+        if (porta && tr->v_on[c]) {
+            ch->target = trk_period(tr, ch, note);
+        } else if (smp) {
+            s = &tr->smp[smp - 1];
+            ch->note = note;
+            ch->smp = smp;
+            ch->c2spd = s->c2spd;
+            ch->finetune = s->finetune;
+            ch->relnote = s->relnote;
+            ch->period = ch->target = trk_period(tr, ch, note);
+
+            offset = 0;
+            if (cell->fx == FX_OFFSET) {
+                if (cell->param) ch->mem_offset = cell->param;
+                offset = ch->mem_offset << OFFSET_SHIFT;
+            }
+            trk_trigger(tr, c, offset);
+        }
+    }
+
+    trk_vcol(tr, c, 0);
+    trk_fx_row(tr, c);
+}
+
+
+/* trk_trigger
+ *
+ * 		DESCRIPTION: starts the channel's sample on its voice and restarts
+ *		             the instrument's envelopes and the vibrato and
+ *		             tremolo waves
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        offset -- sample to start at; past the end, nothing plays
+ *		OUTPUTS: tr -- channel and voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_trigger(tracker_t* tr, uint32_t c, uint32_t offset) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    const trk_sample_t* s;
+
+    tr->v_on[c] = 0;
+    if (!ch->smp) return;
+    s = &tr->smp[ch->smp - 1];
+    if (offset >= s->len) return;
+
+    tr->v_data[c] = s->data;
+    tr->v_pos[c] = offset;
+    tr->v_frac[c] = 0;
+    tr->v_end[c] = s->len;
+    tr->v_loop_len[c] = s->loop != TRK_LOOP_NONE ? s->len - s->loop_start : 0;
+    tr->v_on[c] = 1;
+
+    if (ch->vib_wave < WAVE_RETRIG) ch->vib_pos = 0;
+    if (ch->trem_wave < WAVE_RETRIG) ch->trem_pos = 0;
+    ch->key_on = 1;
+    ch->fade = FADE_UNITY;
+    ch->venv_pos = ch->penv_pos = 0;
+    ch->avib_pos = ch->avib_ticks = 0;
+}
+
+
+/* trk_instrument
+ *
+ * 		DESCRIPTION: selects an instrument, resetting the volume, and in
+ *		             an XM the panning, to those of the sample the note, or
+ *		             the last note, plays
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        ins -- instrument, from 1; ignored if the module has none
+ *		OUTPUTS: tr -- channel
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_instrument(tracker_t* tr, uint32_t c, uint32_t ins) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    const trk_sample_t* s;
+    uint32_t note, smp;
+
+    if (ins > tr->ninstruments) return;
+    ch->ins = ins;
+
+    note = ch->cell.note && ch->cell.note <= TRK_NOTES ? ch->cell.note : ch->note;
+    smp = note ? tr->ins[ins - 1].keymap[note - 1] : 0;
+    if (smp) {
+        s = &tr->smp[smp - 1];
+        ch->volume = s->volume;
+        if (tr->format == TRK_XM) ch->pan = s->pan;
+    }
+
+    ch->key_on = 1;
+    ch->fade = FADE_UNITY;
+    ch->venv_pos = ch->penv_pos = 0;
+}
+
+
+/* trk_key_off
+ *
+ * 		DESCRIPTION: releases a channel's key, which lets its volume
+ *		             envelope past the sustain point and starts the fade
+ *		             out; with no envelope, the note stops
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		OUTPUTS: tr -- channel
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_key_off(tracker_t* tr, uint32_t c) {
+
+    trk_chan_t* ch = &tr->chan[c];
+
+    ch->key_on = 0;
+    if (!ch->ins || !(tr->ins[ch->ins - 1].vol_env.flags & TRK_ENV_ON)) ch->volume = 0;
+}
+
+
+/* trk_vcol
+ *
+ * 		DESCRIPTION: applies a channel's XM volume column: settings on the
+ *		             first tick of the row, slides on the rest
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        tick -- tick of the row
+ *		OUTPUTS: tr -- channel
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_vcol(tracker_t* tr, uint32_t c, uint32_t tick) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    uint32_t v = ch->cell.vol;
+    uint32_t type = v & 0xF0;
+    uint32_t x = v & NIBBLE_MASK;
+
+    if (v < VCOL_VOLUME) return;
+
+    if (v <= VCOL_VOLUME_END) {
+        if (!tick) ch->volume = v - VCOL_VOLUME;
+    } else if (type == VCOL_SLIDE_DOWN) {
+        if (tick) ch->volume = trk_clamp(ch->volume - x, 0, MAX_VOLUME);
+    } else if (type == VCOL_SLIDE_UP) {
+        if (tick) ch->volume = trk_clamp(ch->volume + x, 0, MAX_VOLUME);
+    } else if (type == VCOL_FINE_DOWN) {
+        if (!tick) ch->volume = trk_clamp(ch->volume - x, 0, MAX_VOLUME);
+    } else if (type == VCOL_FINE_UP) {
+        if (!tick) ch->volume = trk_clamp(ch->volume + x, 0, MAX_VOLUME);
+    } else if (type == VCOL_VIB_SPEED) {
+        if (!tick && x) ch->vib_speed = x;
+    } else if (type == VCOL_VIBRATO) {
+        if (!tick && x) ch->vib_depth = x;
+        if (tick) trk_vibrato(ch, VIB_SHIFT);
+    } else if (type == VCOL_PAN) {
+        if (!tick) ch->pan = x << NIBBLE;
+    } else if (type == VCOL_PAN_LEFT) {
+        if (tick) ch->pan = trk_clamp(ch->pan - x, 0, MAX_PAN);
+    } else if (type == VCOL_PAN_RIGHT) {
+        if (tick) ch->pan = trk_clamp(ch->pan + x, 0, MAX_PAN);
+    } else {
+        if (!tick && x) ch->mem_tone = x << NIBBLE;
+        if (tick) trk_tone(ch);
+    }
+}
+
+
+/* trk_fx_row
+ *
+ * 		DESCRIPTION: applies a channel's effect on the first tick of its
+ *		             row: settings, jumps, fine slides, and the memories of
+ *		             the effects that run on the later ticks
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		OUTPUTS: tr -- channel and song state
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_fx_row(tracker_t* tr, uint32_t c) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    uint32_t fx = ch->cell.fx;
+    uint32_t param = ch->cell.param;
+    uint32_t hi = param >> NIBBLE;
+    uint32_t lo = param & NIBBLE_MASK;
+
+    if (fx == FX_PORTA_UP) {
+        if (param) ch->mem_porta_up = param;
+    } else if (fx == FX_PORTA_DOWN) {
+        if (param) ch->mem_porta_down = param;
+    } else if (fx == FX_TONE) {
+        if (param) ch->mem_tone = param;
+    } else if (fx == FX_VIBRATO || fx == FX_FINE_VIB) {
+        if (hi) ch->vib_speed = hi;
+        if (lo) ch->vib_depth = lo;
+    } else if (fx == FX_TONE_VSLIDE || fx == FX_VIB_VSLIDE || fx == FX_VSLIDE) {
+        if (param) ch->mem_vslide = param;
+    } else if (fx == FX_TREMOLO) {
+        if (hi) ch->trem_speed = hi;
+        if (lo) ch->trem_depth = lo;
+    } else if (fx == FX_PAN) {
+        ch->pan = param;
+    } else if (fx == FX_JUMP) {
+        if (!tr->jump) tr->jump_row = 0;
+        tr->jump_order = param;
+        tr->jump = 1;
+    } else if (fx == FX_VOLUME) {
+        ch->volume = param < MAX_VOLUME ? param : MAX_VOLUME;
+    } else if (fx == FX_BREAK) {
+        if (!tr->jump) tr->jump_order = tr->order + 1;
+        tr->jump_row = hi * 10 + lo;
+        tr->jump = 1;
+    } else if (fx == FX_EXTENDED) {
+        trk_extended(tr, c, 0);
+    } else if (fx == FX_SPEED_TEMPO) {
+        if (param >= TEMPO_PARAM) tr->tempo = param;
+        else if (param) tr->speed = param;
+    } else if (fx == FX_GVOL) {
+        tr->gvol = param < MAX_VOLUME ? param : MAX_VOLUME;
+    } else if (fx == FX_GVSLIDE) {
+        if (param) ch->mem_gvslide = param;
+    } else if (fx == FX_KEY_OFF) {
+        if (!param) trk_key_off(tr, c);
+    } else if (fx == FX_ENV_POS) {
+        ch->venv_pos = param;
+    } else if (fx == FX_PSLIDE) {
+        if (param) ch->mem_pslide = param;
+    } else if (fx == FX_RETRIG) {
+        if (param) ch->mem_retrig = param;
+    } else if (fx == FX_TREMOR) {
+        if (param) ch->mem_tremor = param;
+    } else if (fx == FX_XFINE) {
+        if (hi == EXT_FINE_UP) {
+            if (lo) ch->mem_xfine_up = lo;
+            trk_porta(tr, ch, -ch->mem_xfine_up);
+        } else if (hi == EXT_FINE_DOWN) {
+            if (lo) ch->mem_xfine_down = lo;
+            trk_porta(tr, ch, ch->mem_xfine_down);
+        }
+    } else if (fx == FX_SPEED) {
+        if (param) tr->speed = param;
+    } else if (fx == FX_TEMPO) {
+        if (param >= TEMPO_PARAM) tr->tempo = param;
+    } else if (fx == FX_S3M_VSLIDE) {
+        trk_s3m_vslide(ch, param, 0);
+    } else if (fx == FX_S3M_DOWN || fx == FX_S3M_UP) {
+        /* EFx and EEx are fine and extra fine slides, done on this tick */
+        if (hi == 0xF) {
+            trk_porta(tr, ch, (fx == FX_S3M_UP ? -1 : 1) * (int32_t)lo * SLIDE_SCALE);
+        } else if (hi == 0xE) {
+            trk_porta(tr, ch, (fx == FX_S3M_UP ? -1 : 1) * (int32_t)lo);
+        }
+    } else if (fx == FX_S3M_VIB_VSLIDE || fx == FX_S3M_TONE_VSLIDE) {
+        trk_s3m_vslide(ch, param, 0);
+    }
+}
+
+
+/* trk_fx_tick
+ *
+ * 		DESCRIPTION: applies a channel's volume column and effect on the
+ *		             ticks of its row after the first, and plays a delayed
+ *		             cell on its tick
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        tick -- tick of the row
+ *		OUTPUTS: tr -- channel and voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_fx_tick(tracker_t* tr, uint32_t c, uint32_t tick) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    uint32_t fx = ch->cell.fx;
+    uint32_t param = ch->cell.param;
+    uint32_t hi = param >> NIBBLE;
+    uint32_t lo = param & NIBBLE_MASK;
+    uint32_t on;
+
+    if (ch->delay) {
+        if (tick == ch->delay) trk_cell(tr, c);
+        return;
+    }
+
+    ch->vol_delta = ch->period_delta = ch->arp = 0;
+    trk_vcol(tr, c, tick);
+
+    if (fx == FX_ARPEGGIO) {
+        if (tick % 3 == 1) ch->arp = hi;
+        else if (tick % 3 == 2) ch->arp = lo;
+    } else if (fx == FX_PORTA_UP) {
+        trk_porta(tr, ch, -(int32_t)ch->mem_porta_up * SLIDE_SCALE);
+    } else if (fx == FX_PORTA_DOWN) {
+        trk_porta(tr, ch, ch->mem_porta_down * SLIDE_SCALE);
+    } else if (fx == FX_TONE) {
+        trk_tone(ch);
+    } else if (fx == FX_VIBRATO) {
+        trk_vibrato(ch, VIB_SHIFT);
+    } else if (fx == FX_FINE_VIB) {
+        trk_vibrato(ch, FINE_VIB_SHIFT);
+    } else if (fx == FX_TONE_VSLIDE) {
+        trk_tone(ch);
+        trk_vslide(ch, ch->mem_vslide);
+    } else if (fx == FX_VIB_VSLIDE) {
+        trk_vibrato(ch, VIB_SHIFT);
+        trk_vslide(ch, ch->mem_vslide);
+    } else if (fx == FX_TREMOLO) {
+        trk_tremolo(ch);
+    } else if (fx == FX_VSLIDE) {
+        trk_vslide(ch, ch->mem_vslide);
+    } else if (fx == FX_EXTENDED) {
+        trk_extended(tr, c, tick);
+    } else if (fx == FX_GVSLIDE) {
+        tr->gvol = trk_clamp(tr->gvol + ((ch->mem_gvslide >> NIBBLE) ?
+                             (ch->mem_gvslide >> NIBBLE) : -(ch->mem_gvslide & NIBBLE_MASK)),
+                             0, MAX_VOLUME);
+    } else if (fx == FX_KEY_OFF) {
+        if (tick == param) trk_key_off(tr, c);
+    } else if (fx == FX_PSLIDE) {
+        ch->pan = trk_clamp(ch->pan + ((ch->mem_pslide >> NIBBLE) ?
+                            (ch->mem_pslide >> NIBBLE) : -(ch->mem_pslide & NIBBLE_MASK)),
+                            0, MAX_PAN);
+    } else if (fx == FX_RETRIG) {
+        trk_retrig(tr, c, ch->mem_retrig);
+    } else if (fx == FX_TREMOR) {
+        on = (ch->mem_tremor >> NIBBLE) + 1;
+        if (++ch->tremor_count >= on + (ch->mem_tremor & NIBBLE_MASK) + 1) ch->tremor_count = 0;
+        ch->tremor_off = ch->tremor_count >= on;
+        if (ch->tremor_off) ch->vol_delta = -ch->volume;
+    } else if (fx == FX_S3M_VSLIDE) {
+        trk_s3m_vslide(ch, param, tick);
+    } else if (fx == FX_S3M_DOWN) {
+        if (hi < 0xE) trk_porta(tr, ch, param * SLIDE_SCALE);
+    } else if (fx == FX_S3M_UP) {
+        if (hi < 0xE) trk_porta(tr, ch, -(int32_t)param * SLIDE_SCALE);
+    } else if (fx == FX_S3M_VIB_VSLIDE) {
+        trk_vibrato(ch, VIB_SHIFT);
+        trk_s3m_vslide(ch, param, tick);
+    } else if (fx == FX_S3M_TONE_VSLIDE) {
+        trk_tone(ch);
+        trk_s3m_vslide(ch, param, tick);
+    }
+}
+
+
+/* trk_extended
+ *
+ * 		DESCRIPTION: applies an E sub-effect on a tick of its row
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        tick -- tick of the row
+ *		OUTPUTS: tr -- channel and song state
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_extended(tracker_t* tr, uint32_t c, uint32_t tick) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    uint32_t sub = ch->cell.param >> NIBBLE;
+    uint32_t x = ch->cell.param & NIBBLE_MASK;
+
+    if (sub == EXT_FINE_UP) {
+        if (x) ch->mem_fine_up = x;
+        if (!tick) trk_porta(tr, ch, -(int32_t)ch->mem_fine_up * SLIDE_SCALE);
+    } else if (sub == EXT_FINE_DOWN) {
+        if (x) ch->mem_fine_down = x;
+        if (!tick) trk_porta(tr, ch, ch->mem_fine_down * SLIDE_SCALE);
+    } else if (sub == EXT_VIB_WAVE) {
+        ch->vib_wave = x;
+    } else if (sub == EXT_FINETUNE) {
+        if (tr->format == TRK_XM) ch->finetune = ((int32_t)x - 8) * 16;
+        else ch->c2spd = finetune_tab[x];
+    } else if (sub == EXT_LOOP) {
+        if (tick) return;
+        if (!x) {
+            ch->loop_row = tr->row;
+        } else if (!ch->loop_count) {
+            ch->loop_count = x;
+            tr->loop_jump = 1;
+            tr->loop_row = ch->loop_row;
+        } else if (--ch->loop_count) {
+            tr->loop_jump = 1;
+            tr->loop_row = ch->loop_row;
+        }
+    } else if (sub == EXT_TREM_WAVE) {
+        ch->trem_wave = x;
+    } else if (sub == EXT_PAN) {
+        ch->pan = x * S3M_PAN_SCALE;
+    } else if (sub == EXT_RETRIG) {
+        if (tick && x && tick % x == 0) trk_trigger(tr, c, 0);
+    } else if (sub == EXT_FINE_VUP) {
+        if (!tick) ch->volume = trk_clamp(ch->volume + x, 0, MAX_VOLUME);
+    } else if (sub == EXT_FINE_VDOWN) {
+        if (!tick) ch->volume = trk_clamp(ch->volume - x, 0, MAX_VOLUME);
+    } else if (sub == EXT_CUT) {
+        if (tick == x) ch->volume = 0;
+    } else if (sub == EXT_PATTERN_DELAY) {
+        if (!tick && !tr->pattern_delay) tr->pattern_delay = x;
+    }
+}
+
+
+/* trk_vslide
+ *
+ * 		DESCRIPTION: slides the volume up by the parameter's high nibble,
+ *		             or down by its low one
+ *		INPUTS: ch -- channel
+ *		        param -- slide
+ *		OUTPUTS: ch -- volume
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_vslide(trk_chan_t* ch, uint32_t param) {
+
+    if (param >> NIBBLE) ch->volume += param >> NIBBLE;
+    else ch->volume -= param & NIBBLE_MASK;
+    ch->volume = trk_clamp(ch->volume, 0, MAX_VOLUME);
+}
+
+
+/* trk_s3m_vslide
+ *
+ * 		DESCRIPTION: ST3's volume slide: DxF and DFx slide once on the
+ *		             row's first tick, others on each tick after it
+ *		INPUTS: ch -- channel
+ *		        param -- slide
+ *		        tick -- tick of the row
+ *		OUTPUTS: ch -- volume
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_s3m_vslide(trk_chan_t* ch, uint32_t param, uint32_t tick) {
+
+    uint32_t hi = param >> NIBBLE;
+    uint32_t lo = param & NIBBLE_MASK;
+
+    if (lo == NIBBLE_MASK && hi) {
+        if (!tick) ch->volume += hi;
+    } else if (hi == NIBBLE_MASK && lo) {
+        if (!tick) ch->volume -= lo;
+    } else if (tick) {
+        if (lo) ch->volume -= lo;
+        else ch->volume += hi;
+    }
+    ch->volume = trk_clamp(ch->volume, 0, MAX_VOLUME);
+}
+
+
+/* trk_porta
+ *
+ * 		DESCRIPTION: slides the period, keeping it in range
+ *		INPUTS: tr -- module state
+ *		        ch -- channel
+ *		        delta -- change of period, negative for up in pitch
+ *		OUTPUTS: ch -- period
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_porta(tracker_t* tr, trk_chan_t* ch, int32_t delta) {
+
+    if (tr->amiga_limits) {
+        ch->period = trk_clamp(ch->period + delta, MOD_MIN_PERIOD * PERIOD_SCALE,
+                               MOD_MAX_PERIOD * PERIOD_SCALE);
+    } else {
+        ch->period = trk_clamp(ch->period + delta, MIN_PERIOD, MAX_PERIOD);
+    }
+}
+
+
+/* trk_tone
+ *
+ * 		DESCRIPTION: slides the period toward the tone portamento's target
+ *		INPUTS: ch -- channel
+ *		OUTPUTS: ch -- period
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_tone(trk_chan_t* ch) {
+
+    int32_t speed = ch->mem_tone * SLIDE_SCALE;
+
+    if (!ch->target) return;
+
+    if (ch->period < ch->target) {
+        ch->period += speed;
+        if (ch->period > ch->target) ch->period = ch->target;
+    } else if (ch->period > ch->target) {
+        ch->period -= speed;
+        if (ch->period < ch->target) ch->period = ch->target;
+    }
+}
+
+
+/* trk_vibrato
+ *
+ * 		DESCRIPTION: sets this tick's period change from the vibrato wave
+ *		             and steps the wave
+ *		INPUTS: ch -- channel
+ *		        shift -- depth scale, VIB_SHIFT or FINE_VIB_SHIFT
+ *		OUTPUTS: ch -- period_delta and vib_pos
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_vibrato(trk_chan_t* ch, uint32_t shift) {
+
+    ch->period_delta = (trk_wave(ch->vib_wave, ch->vib_pos) * ch->vib_depth) >> shift;
+    ch->vib_pos = (ch->vib_pos + ch->vib_speed) & (WAVE_STEPS - 1);
+}
+
+
+/* trk_tremolo
+ *
+ * 		DESCRIPTION: sets this tick's volume change from the tremolo wave
+ *		             and steps the wave
+ *		INPUTS: ch -- channel
+ *		OUTPUTS: ch -- vol_delta and trem_pos
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_tremolo(trk_chan_t* ch) {
+
+    ch->vol_delta = (trk_wave(ch->trem_wave, ch->trem_pos) * ch->trem_depth) >> TREM_SHIFT;
+    ch->trem_pos = (ch->trem_pos + ch->trem_speed) & (WAVE_STEPS - 1);
+}
+
+
+/* trk_retrig
+ *
+ * 		DESCRIPTION: restarts the sample every few ticks, changing the
+ *		             volume each time
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		        param -- volume change in the high nibble, ticks in the low
+ *		OUTPUTS: tr -- channel and voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_retrig(tracker_t* tr, uint32_t c, uint32_t param) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    uint32_t change = param >> NIBBLE;
+    int32_t v = ch->volume;
+
+    if (!(param & NIBBLE_MASK) || ++ch->retrig_count < (param & NIBBLE_MASK)) return;
+    ch->retrig_count = 0;
+
+    if (change == 6) v = v * 2 / 3;
+    else if (change == 7) v >>= 1;
+    else if (change == 0xE) v = v * 3 / 2;
+    else if (change == 0xF) v *= 2;
+    else v += retrig_add[change];
+    ch->volume = trk_clamp(v, 0, MAX_VOLUME);
+
+    trk_trigger(tr, c, 0);
+}
+
+
+/* trk_wave
+ *
+ * 		DESCRIPTION: reads a vibrato or tremolo wave: 0 sine, 1 ramp down,
+ *		             2 square. Random, 3, is played as a sine. Adding 4
+ *		             keeps the wave running across notes.
+ *		INPUTS: wave -- waveform
+ *		        pos -- position, 64 to a cycle
+ *		OUTPUTS: none
+ *		RETURN VALUE: the wave, -255 to 255
+ *		SIDE EFFECTS: none
+ */
+static int32_t trk_wave(uint32_t wave, uint32_t pos) {
+
+    int32_t v;
+
+    pos &= WAVE_STEPS - 1;
+    wave &= 3;
+
+    if (wave == 1) return 255 - (int32_t)pos * 8;
+    if (wave == 2) return pos < WAVE_HALF ? 255 : -255;
+
+    v = sine_tab[pos & (WAVE_HALF - 1)];
+    return pos < WAVE_HALF ? v : -v;
+}
+
+
+/* trk_clamp
+ *
+ * 		DESCRIPTION: limits a value to a range
+ *		INPUTS: val -- value
+ *		        lo -- least
+ *		        hi -- greatest
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value in range
+ *		SIDE EFFECTS: none
+ */
+static int32_t trk_clamp(int32_t val, int32_t lo, int32_t hi) {
+
+    return val < lo ? lo : val > hi ? hi : val;
+}
+
+
+/* trk_period
+ *
+ * 		DESCRIPTION: finds the period of a note on the channel's sample.
+ *		             Linear periods fall 64 to a semitone with the
+ *		             sample's transpose and finetune; Amiga ones come from
+ *		             the table, an octave down per halving, and scale with
+ *		             the sample's rate at C-4.
+ *		INPUTS: tr -- module state
+ *		        ch -- channel
+ *		        note -- note, from 1
+ *		OUTPUTS: none
+ *		RETURN VALUE: period
+ *		SIDE EFFECTS: none
+ */
+static int32_t trk_period(const tracker_t* tr, const trk_chan_t* ch, uint32_t note) {
+
+    uint32_t n = note - 1;
+
+    if (tr->linear) {
+        return LINEAR_C4 + LINEAR_OCTAVE * 4 - ((int32_t)n + ch->relnote) * LINEAR_SEMITONE -
+               ch->finetune / 2;
+    }
+
+    return (period_tab[n % SEMITONES] * C4_RATE / (ch->c2spd ? ch->c2spd : C4_RATE)) >>
+           (n / SEMITONES);
+}
+
+
+/* trk_voice
+ *
+ * 		DESCRIPTION: sets a voice's step and gains from its channel for
+ *		             the tick: the period with arpeggio, vibrato and the
+ *		             instrument's auto-vibrato, and the volume with tremolo,
+ *		             global volume, envelopes and fade out
+ *		INPUTS: tr -- module state
+ *		        c -- channel
+ *		OUTPUTS: tr -- voice step and gains; envelopes and fade move on
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_voice(tracker_t* tr, uint32_t c) {
+
+    trk_chan_t* ch = &tr->chan[c];
+    const trk_instrument_t* in;
+    int32_t period, gain, pan, depth, e;
+
+    if (!tr->v_on[c]) return;
+    in = ch->ins ? &tr->ins[ch->ins - 1] : 0;
+
+    period = ch->period + ch->period_delta;
+    if (ch->arp) {
+        if (tr->linear) {
+            period -= ch->arp * LINEAR_SEMITONE;
+        } else {
+            period = ((uint64_t)period *
+                      fix_pow2(-ch->arp * (1 << Q16_SHIFT) / SEMITONES)) >> Q16_SHIFT;
+        }
+    }
+    if (in && in->vib_depth) {
+        depth = in->vib_depth << 8;
+        if (ch->avib_ticks < in->vib_sweep) {
+            depth = depth * (int32_t)ch->avib_ticks / (int32_t)in->vib_sweep;
+            ch->avib_ticks++;
+        }
+        period += (trk_wave(in->vib_type, ch->avib_pos >> 2) * depth) >> AVIB_SHIFT;
+        ch->avib_pos = (ch->avib_pos + in->vib_rate) & 0xFF;
+    }
+    tr->v_step[c] = trk_step(tr, trk_clamp(period, MIN_PERIOD, MAX_PERIOD));
+
+    /* channel and global volume make Q12, then envelope and fade scale
+     * it down */
+    gain = trk_clamp(ch->volume + ch->vol_delta, 0, MAX_VOLUME) * tr->gvol;
+    pan = ch->pan;
+    if (in && (in->vol_env.flags & TRK_ENV_ON)) {
+        gain = (gain * trk_env(&in->vol_env, &ch->venv_pos, ch->key_on)) >> ENV_SHIFT;
+    }
+    if (in && !ch->key_on) {
+        gain = (gain * (int32_t)(ch->fade >> FADE_SHIFT)) >> (Q16_SHIFT - FADE_SHIFT);
+        ch->fade = ch->fade > in->fadeout ? ch->fade - in->fadeout : 0;
+    }
+    if (in && (in->pan_env.flags & TRK_ENV_ON)) {
+        e = trk_env(&in->pan_env, &ch->penv_pos, ch->key_on) - MAX_VOLUME / 2;
+        pan += (e * (CENTRE_PAN - (pan < CENTRE_PAN ? CENTRE_PAN - pan : pan - CENTRE_PAN))) /
+               (MAX_VOLUME / 2);
+        pan = trk_clamp(pan, 0, MAX_PAN);
+    }
+
+    gain >>= VOL_SHIFT;
+    tr->v_vol_l[c] = (gain * (MAX_PAN + 1 - pan)) >> 8;
+    tr->v_vol_r[c] = (gain * pan) >> 8;
+}
+
+
+/* trk_env
+ *
+ * 		DESCRIPTION: reads an envelope at a tick and moves the tick on,
+ *		             holding at the sustain point while the key is down and
+ *		             going round the loop
+ *		INPUTS: env -- the envelope
+ *		        pos -- tick
+ *		        key_on -- 1 while the key is down
+ *		OUTPUTS: pos -- next tick
+ *		RETURN VALUE: value, 0-64
+ *		SIDE EFFECTS: none
+ */
+static int32_t trk_env(const trk_env_t* env, uint32_t* pos, uint32_t key_on) {
+
+    uint32_t x = *pos;
+    uint32_t i, dx;
+    int32_t y;
+
+    for (i = 0; i + 1 < env->npoints && x >= env->x[i + 1]; i++);
+    if (i + 1 >= env->npoints) {
+        y = env->y[env->npoints - 1];
+    } else {
+        dx = env->x[i + 1] - env->x[i];
+        y = env->y[i];
+        if (dx) y += ((int32_t)env->y[i + 1] - y) * (int32_t)(x - env->x[i]) / (int32_t)dx;
+    }
+
+    if ((env->flags & TRK_ENV_SUSTAIN) && key_on && x == env->x[env->sustain]) return y;
+    x++;
+    if ((env->flags & TRK_ENV_LOOP) && x >= env->x[env->loop_end]) x = env->x[env->loop_start];
+    *pos = x;
+
+    return y;
+}
+
+
+/* trk_step
+ *
+ * 		DESCRIPTION: finds how far a voice moves through its sample per
+ *		             output frame at a period. Linear periods give the rate
+ *		             as 8363 Hz times two to the power of octaves from
+ *		             C-4; Amiga ones divide it into the clock.
+ *		INPUTS: tr -- module state
+ *		        period -- period
+ *		OUTPUTS: none
+ *		RETURN VALUE: step, Q16 samples per frame
+ *		SIDE EFFECTS: none
+ */
+static uint32_t trk_step(const tracker_t* tr, int32_t period) {
+
+    uint32_t pow;
+
+    if (tr->linear) {
+        pow = fix_pow2((LINEAR_C4 - period) * (1 << Q16_SHIFT) / LINEAR_OCTAVE);
+        return fix_qdiv((int64_t)C4_RATE * pow, TRK_RATE, 0);
+    }
+
+    return fix_qdiv(AMIGA_CLOCK, (int64_t)period * TRK_RATE, Q16_SHIFT);
+}
+
+
+/* trk_mix
+ *
+ * 		DESCRIPTION: mixes the voices for part of a tick and scales the sum
+ *		             for the channel count
+ *		INPUTS: tr -- module state
+ *		        dst -- destination
+ *		        frames -- number of frames, at most TRK_MIX_FRAMES
+ *		OUTPUTS: dst -- 16-bit stereo
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: advances the voices
+ */
+static void trk_mix(tracker_t* tr, int16_t* dst, uint32_t frames) {
+
+    int32_t* mix = tr->mix;
+    uint32_t i, v;
+
+    trk_zero(mix, frames * 2 * sizeof(int32_t));
+    for (v = 0; v < tr->nchannels; v++) {
+        if (!tr->v_on[v]) continue;
+        if (tr->v_vol_l[v] || tr->v_vol_r[v]) trk_mix_voice(tr, v, frames);
+        else trk_advance(tr, v, frames);
+    }
+
+    for (i = 0; i < frames * 2; i++) {
+        dst[i] = fix_sat16(((mix[i] >> MIX_SHIFT) * (int32_t)tr->amp) >> AMP_SHIFT);
+    }
+}
+
+
+/* trk_mix_voice
+ *
+ * 		DESCRIPTION: adds a voice into the mix, interpolating linearly
+ *		             between samples. At the end of the sample the voice
+ *		             goes back by the loop's length, or stops.
+ *		INPUTS: tr -- module state
+ *		        v -- voice
+ *		        frames -- number of frames
+ *		OUTPUTS: tr -- mix, and the voice's position
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_mix_voice(tracker_t* tr, uint32_t v, uint32_t frames) {
+
+    const int16_t* data = tr->v_data[v];
+    int32_t* out = tr->mix;
+    uint32_t pos = tr->v_pos[v];
+    uint32_t frac = tr->v_frac[v];
+    uint32_t step = tr->v_step[v];
+    uint32_t end = tr->v_end[v];
+    uint32_t loop_len = tr->v_loop_len[v];
+    int32_t vol_l = tr->v_vol_l[v];
+    int32_t vol_r = tr->v_vol_r[v];
+    int32_t a, s;
+
+    while (frames--) {
+        a = data[pos];
+        s = a + (((data[pos + 1] - a) * (int32_t)(frac >> 1)) >> (Q16_SHIFT - 1));
+        out[0] += s * vol_l;
+        out[1] += s * vol_r;
+        out += 2;
+
+        frac += step;
+        pos += frac >> Q16_SHIFT;
+        frac &= (1 << Q16_SHIFT) - 1;
+        if (pos >= end) {
+            if (!loop_len) {
+                tr->v_on[v] = 0;
+                break;
+            }
+            while (pos >= end) pos -= loop_len;
+        }
+    }
+
+    tr->v_pos[v] = pos;
+    tr->v_frac[v] = frac;
+}
+
+
+/* trk_advance
+ *
+ * 		DESCRIPTION: moves a voice on as trk_mix_voice would without
+ *		             mixing it, for silent voices and seeking
+ *		INPUTS: tr -- module state
+ *		        v -- voice
+ *		        frames -- number of frames
+ *		OUTPUTS: tr -- the voice's position
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void trk_advance(tracker_t* tr, uint32_t v, uint32_t frames) {
+
+    uint64_t total = (uint64_t)tr->v_step[v] * frames + tr->v_frac[v];
+    uint64_t pos = tr->v_pos[v] + (total >> Q16_SHIFT);
+    uint32_t end = tr->v_end[v];
+    uint32_t loop_len = tr->v_loop_len[v];
+
+    tr->v_frac[v] = total & ((1 << Q16_SHIFT) - 1);
+    if (pos >= end) {
+        if (!loop_len) {
+            tr->v_on[v] = 0;
+            return;
+        }
+        pos = end - loop_len + (uint32_t)(pos - end) % loop_len;
+    }
+    tr->v_pos[v] = pos;
+}
+
+
+/* rd32
+ *
+ * 		DESCRIPTION: reads a little-endian 32-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd32(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/* rd16
+ *
+ * 		DESCRIPTION: reads a little-endian 16-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint16_t rd16(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8);
+}
+
+
+/* rd16be
+ *
+ * 		DESCRIPTION: reads a big-endian 16-bit value, as the Amiga stored
+ *		             them
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint16_t rd16be(const uint8_t* p) {
+
+    return (p[0] << 8) | p[1];
+}
@@ -0,0 +1,232 @@
+/* tracker.h - MOD/S3M/XM module player definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _TRACKER_H
+#define _TRACKER_H
+
+#include <stdint.h>
+
+/* modules are rendered as 16-bit stereo at one rate */
+#define TRK_RATE            44100
+#define TRK_FRAME_SIZE      4
+
+#define TRK_MOD             1
+#define TRK_S3M             2
+#define TRK_XM              3
+
+/* returned by tracker_open for a file with no module signature */
+#define TRK_NOT_MODULE      (-2)
+
+#define TRK_MAX_CHANNELS    32
+#define TRK_MAX_ORDERS      256
+#define TRK_MAX_PATTERNS    256
+#define TRK_MAX_INSTRUMENTS 128
+#define TRK_MAX_SAMPLES     256
+#define TRK_MAX_ROWS        256
+#define TRK_NOTES           96
+#define TRK_ENV_POINTS      12
+
+/* patterns and sample data, unpacked as they're loaded */
+#define TRK_ARENA_SIZE      (1 << 21)
+
+/* frames mixed at a time */
+#define TRK_MIX_FRAMES      4096
+
+/* notes are numbered from C-0 = 1, with C-4 at the sample's own rate */
+#define TRK_NOTE_OFF        97
+#define TRK_NOTE_CUT        98
+
+/* sample loops; ping-pong loops are unrolled to forward ones on load */
+#define TRK_LOOP_NONE       0
+#define TRK_LOOP_FORWARD    1
+#define TRK_LOOP_PINGPONG   2
+
+/* envelope flags */
+#define TRK_ENV_ON          0x1
+#define TRK_ENV_SUSTAIN     0x2
+#define TRK_ENV_LOOP        0x4
+
+/* one pattern cell; effects are numbered as in XM, with S3M's that have
+ * no XM equivalent after them */
+typedef struct trk_cell {
+    uint8_t note;
+    uint8_t ins;
+    uint8_t vol;            /* volume column, XM encoding, 0 if empty */
+    uint8_t fx;
+    uint8_t param;
+} trk_cell_t;
+
+typedef struct trk_sample {
+    const int16_t* data;    /* with one guard sample past the end */
+    uint32_t len;
+    uint32_t loop_start;
+    uint32_t loop;          /* TRK_LOOP_NONE or TRK_LOOP_FORWARD */
+    uint32_t c2spd;         /* rate at C-4, for Amiga periods */
+    int32_t relnote;        /* XM transpose and finetune, for linear ones */
+    int32_t finetune;
+    uint32_t volume;        /* 0-64 */
+    uint32_t pan;           /* 0-255 */
+} trk_sample_t;
+
+typedef struct trk_env {
+    uint32_t flags;
+    uint32_t npoints;
+    uint32_t sustain;
+    uint32_t loop_start;
+    uint32_t loop_end;
+    uint16_t x[TRK_ENV_POINTS];     /* ticks */
+    uint8_t y[TRK_ENV_POINTS];      /* 0-64 */
+} trk_env_t;
+
+typedef struct trk_instrument {
+    uint8_t keymap[TRK_NOTES];      /* sample of each note, 0 for none */
+    trk_env_t vol_env;
+    trk_env_t pan_env;
+    uint32_t fadeout;               /* per tick, of 65536 */
+    uint32_t vib_type;
+    uint32_t vib_sweep;
+    uint32_t vib_depth;
+    uint32_t vib_rate;
+} trk_instrument_t;
+
+/* playback state of a channel, updated once a tick */
+typedef struct trk_chan {
+    trk_cell_t cell;        /* the row's cell, kept for a delayed note */
+    uint32_t ins;           /* 1-based, 0 for none */
+    uint32_t smp;           /* 1-based, 0 for none */
+    uint32_t note;
+    int32_t period;
+    int32_t target;         /* tone portamento target */
+    int32_t volume;         /* 0-64 */
+    int32_t pan;            /* 0-255 */
+    uint32_t c2spd;
+    int32_t finetune;       /* XM, with the sample's transpose in notes */
+    int32_t relnote;
+
+    /* this tick's changes on top of the above */
+    int32_t vol_delta;
+    int32_t period_delta;
+    int32_t arp;            /* semitones */
+
+    /* effect memories */
+    uint8_t mem_porta_up;
+    uint8_t mem_porta_down;
+    uint8_t mem_tone;
+    uint8_t mem_vslide;
+    uint8_t mem_fine_up;
+    uint8_t mem_fine_down;
+    uint8_t mem_xfine_up;
+    uint8_t mem_xfine_down;
+    uint8_t mem_offset;
+    uint8_t mem_retrig;
+    uint8_t mem_pslide;
+    uint8_t mem_gvslide;
+    uint8_t mem_tremor;
+    uint8_t mem_s3m;        /* ST3 shares one memory over most effects */
+    uint8_t vib_speed;
+    uint8_t vib_depth;
+    uint8_t vib_pos;
+    uint8_t vib_wave;
+    uint8_t trem_speed;
+    uint8_t trem_depth;
+    uint8_t trem_pos;
+    uint8_t trem_wave;
+    uint8_t vcol_vib;       /* vibrato came from the volume column */
+
+    uint32_t loop_row;
+    uint32_t loop_count;
+    uint32_t retrig_count;
+    uint32_t tremor_count;
+    uint32_t tremor_off;
+    uint32_t delay;         /* tick of a delayed note, 0 for none */
+    uint32_t cut;           /* tick of a note cut, 0 for none */
+
+    /* instrument state */
+    uint32_t key_on;
+    uint32_t fade;          /* 65536 down to 0 after the key is released */
+    uint32_t venv_pos;      /* envelope positions in ticks */
+    uint32_t penv_pos;
+    uint32_t avib_pos;
+    uint32_t avib_ticks;
+} trk_chan_t;
+
+/* loaded module and its playback position; the voices the mixer reads
+ * are kept as one array per field, so the mix loop walks them in order */
+typedef struct tracker {
+    int32_t fd;
+    const uint8_t* fname;
+    uint32_t file_pos;
+    uint32_t format;
+    uint32_t loop;          /* 1 to play the song forever */
+    uint32_t linear;        /* 1 for XM linear periods */
+    uint32_t st3;           /* 1 for S3M effect semantics */
+    uint32_t amiga_limits;  /* 1 to keep periods in ProTracker's range */
+    uint32_t nchannels;
+    uint32_t norders;
+    uint32_t restart;
+    uint32_t npatterns;
+    uint32_t ninstruments;
+    uint32_t nsamples;
+    uint32_t init_speed;
+    uint32_t init_tempo;
+    uint32_t init_gvol;
+    uint32_t amp;           /* master gain for the channel count, Q8 */
+    uint8_t orders[TRK_MAX_ORDERS];
+    uint8_t init_pan[TRK_MAX_CHANNELS];
+    uint16_t rows[TRK_MAX_PATTERNS];
+    trk_cell_t* patterns[TRK_MAX_PATTERNS];
+    trk_instrument_t ins[TRK_MAX_INSTRUMENTS];
+    trk_sample_t smp[TRK_MAX_SAMPLES];
+
+    /* song position */
+    uint32_t order;
+    uint32_t row;
+    uint32_t tick;
+    uint32_t speed;
+    uint32_t tempo;
+    int32_t gvol;
+    uint32_t pattern_delay;
+    uint32_t jump;          /* 1 if jump_order and jump_row are pending */
+    uint32_t jump_order;
+    uint32_t jump_row;
+    uint32_t loop_jump;     /* 1 if a pattern loop goes back to loop_row */
+    uint32_t loop_row;
+    uint32_t tick_left;     /* frames left in the tick */
+    uint32_t tick_rem;      /* remainder carried between tick lengths */
+    uint32_t frame;         /* frames rendered since the start */
+    uint32_t end;
+    uint8_t visited[TRK_MAX_ORDERS];
+    trk_chan_t chan[TRK_MAX_CHANNELS];
+
+    /* voices */
+    const int16_t* v_data[TRK_MAX_CHANNELS];
+    uint32_t v_pos[TRK_MAX_CHANNELS];
+    uint32_t v_frac[TRK_MAX_CHANNELS];      /* Q16 */
+    uint32_t v_step[TRK_MAX_CHANNELS];      /* Q16 samples per frame */
+    uint32_t v_end[TRK_MAX_CHANNELS];
+    uint32_t v_loop_len[TRK_MAX_CHANNELS];  /* 0 if the sample stops */
+    int32_t v_vol_l[TRK_MAX_CHANNELS];      /* Q10 */
+    int32_t v_vol_r[TRK_MAX_CHANNELS];
+    uint32_t v_on[TRK_MAX_CHANNELS];
+
+    int32_t mix[TRK_MIX_FRAMES * 2];
+    uint32_t arena_used;
+    uint8_t arena[TRK_ARENA_SIZE];
+} tracker_t;
+
+
+/* loads a module and positions it at the start of the song */
+int32_t tracker_open(tracker_t* tr, const uint8_t* fname, int32_t loop);
+
+/* renders the next len bytes of 16-bit stereo */
+int32_t tracker_read(tracker_t* tr, int8_t* dst, uint32_t len);
+
+/* moves to a frame of the song, so the next read starts there */
+int32_t tracker_seek(tracker_t* tr, uint32_t frame);
+
+/* releases the module */
+void tracker_close(tracker_t* tr);
+
+
+#endif
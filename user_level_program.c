@@ -6,70 +6,1064 @@
 
 #include "ece391support.h"
 #include "ece391syscall.h"
+#include "wav.h"
+#include "xfade.h"
+#include "eq.h"
+#include "limiter.h"
+#include "loudness.h"
+#include "meter.h"
+#include "stretch.h"
+#include "midi.h"
+#include "fm.h"
+#include "mpu.h"
+#include "fixmath.h"
 
 
 #define BUF_SIZE    (65536 / 2)
 #define BUF_DIM     2
 #define COPY_LEN    1024
-#define IBLOCK_SIZE 44
 #define TWO_B       2
 #define FOUR_B      4
 #define EIGHT_B     8
 #define RADIX       10
 #define _4KB        4096
+#define _1KB        1024
+#define FLAG_LEN    3
+#define LOOP_FLAG   "-l "
+#define STBY_FLAG   "-w "
+#define WARM_FLAG   "-y "
+#define XFADE_FLAG  "-x "
+#define EQ_FLAG     "-e "
+#define GAIN_FLAG   "-g "
+#define LIM_FLAG    "-p "
+#define NORM_FLAG   "-n "
+#define SCAN_FLAG   "-s "
+#define INDEX_FLAG  "-k "
+#define METER_FLAG  "-m "
+#define QUIET_FLAG  "-z "
+#define START_FLAG  "-t "
+#define JUMP_FLAG   "-j "
+#define SPEED_FLAG  "-r "
+#define UART_FLAG   "-u "
+#define MS_PER_SEC  1000
+#define STBY_PERIODS 16
+#define STBY_QUERY  (-2)
+#define MAX_TRACKS  16
+#define NUM_LEN     12
+#define PERCENT     100
+#define US_PER_MS   1000
+#define US_PER_SEC  1000000
+#define RTC_NAME    "rtc"
+#define MIDI_HZ     512
+#define MIDI_TAIL   (MIDI_HZ / 2)
+#define UART_STEP   1000
+#define UART_AHEAD  50
+#define UART_ROOM   64
+#define UART_DRAIN  65536
+#define Q32_SHIFT   32
+
+
+/* clip storage for hardware looping */
+static int8_t clip[BUF_DIM * BUF_SIZE];
+
+/* playlist, split out of the argument string */
+static uint8_t* tracks[MAX_TRACKS];
+static int32_t ntracks = 0;
+static int32_t cur_track = 0;
+static wav_t wav;
+
+/* crossfade length in seconds, 0 for none */
+static uint32_t xfade_secs = 0;
+/* 1 while crossfading into next, -1 if this boundary can't crossfade */
+static int32_t fading = 0;
+static wav_t next;
+static xfade_t xf;
+/* read-ahead of the incoming track, one period at most */
+static int8_t xbuf[BUF_SIZE];
+
+/* per-room tone correction */
+static eq_t eq;
+
+/* 32-bit mix bus for one half, so gain and mixing don't clip before the
+ * limiter */
+static int32_t bus[BUF_SIZE / TWO_B];
+/* software gain in tenths of a dB, and with each track's loudness
+ * correction added in Q16 */
+static int32_t gain_db = 0;
+static uint32_t track_gain[MAX_TRACKS];
+/* loudness scan state, for files the cache doesn't have */
+static loudness_t loud;
+/* limiter look-ahead in ms, 0 for none, and the format it was set up for */
+static uint32_t lim_ms = 0;
+static uint32_t lim_rate = 0;
+static uint16_t lim_channels = 0;
+static limiter_t lim;
+
+/* 1 to bring every track to the same loudness, and the level it's brought to
+ * in tenths of LUFS */
+static int32_t normalize = 0;
+static int32_t norm_target = LOUD_TARGET;
+
+/* 1 to meter each period and post its levels to the driver */
+static int32_t metering = 0;
+static meter_t meter;
+static meter_stats_t levels;
+
+/* 1 to find silent periods, and how many in a row pause the DMA, 0 for
+ * never */
+static int32_t silence = 0;
+static int32_t pause_after = 0;
+/* which halves hold nothing but silence, and whether the last fill was
+ * silent */
+static int32_t half_silent[BUF_DIM] = {0, 0};
+static int32_t quiet = 0;
+/* reads land here while the half they're for already holds silence */
+static int8_t stage[BUF_SIZE];
+/* bytes written to and left alone in the buffer, and periods that played
+ * no interrupt */
+static uint32_t bytes_copied = 0;
+static uint32_t bytes_skipped = 0;
+static uint32_t irqs_avoided = 0;
+
+/* where the first track starts, and a jump in it once playback reaches
+ * jump_at, all in ms; 0 for none */
+static uint32_t start_ms = 0;
+static uint32_t jump_at = 0;
+static uint32_t jump_to = 0;
+/* track and frame each half starts at */
+static int32_t half_track[BUF_DIM];
+static uint32_t half_frame[BUF_DIM];
+
+/* playback speed in Q16, 0 to play as recorded */
+static uint32_t speed = 0;
+static stretch_t ts;
+
+/* MIDI files play on the card's FM synthesizer instead of through PCM */
+static midi_t midi;
+static fm_t fm;
+
+/* a MIDI file sent out the MPU-401 alongside the PCM, timed by the card's
+ * sample clock; events are stamped from where the song starts, with frames
+ * per microsecond in Q32, and kept UART_AHEAD ms ahead of the card */
+static uint8_t* uart_name = 0;
+static mpu_t mpu;
+static uint32_t uart_base;
+static uint32_t uart_k;
+static int32_t uart_ahead;
+static int32_t uart_done = 0;
+
+/* set when the half just filled starts content in a new format */
+static int32_t reconfig = 0;
+/* set when the next half must start the new format */
+static int32_t switch_next = 0;
+
+
+/* split_tracks
+ *
+ * 		DESCRIPTION: splits the argument string into file names
+ *		INPUTS: names -- space-separated file names
+ *		OUTPUTS: tracks -- pointers to each name
+ *		RETURN VALUE: number of names found
+ *		SIDE EFFECTS: terminates each name in place
+ */
+static int32_t split_tracks(uint8_t* names) {
+
+    while (*names && ntracks < MAX_TRACKS) {
+        while (*names == ' ') *names++ = '\0';
+        if (!*names) break;
+        tracks[ntracks++] = names;
+        while (*names && *names != ' ') names++;
+    }
+
+    return ntracks;
+}
+
+
+/* parse_num
+ *
+ * 		DESCRIPTION: reads a signed decimal number from an argument string
+ *		INPUTS: str -- pointer to the string position
+ *		OUTPUTS: str -- moved past the number
+ *		RETURN VALUE: number read
+ *		SIDE EFFECTS: none
+ */
+static int32_t parse_num(uint8_t** str) {
+
+    int32_t val = 0;
+    int32_t neg = (**str == '-');
+
+    if (neg) (*str)++;
+    while (**str >= '0' && **str <= '9')
+        val = val * RADIX + (*(*str)++ - '0');
+
+    return neg ? -val : val;
+}
+
+
+/* parse_band
+ *
+ * 		DESCRIPTION: reads an EQ band as [l|h]freq:gain:q, with gain in
+ *		             tenths of a dB and Q in hundredths, and adds it
+ *		INPUTS: str -- pointer to the string position
+ *		OUTPUTS: str -- moved past the band
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: adds a band to the equalizer
+ */
+static int32_t parse_band(uint8_t** str) {
+
+    int32_t type = EQ_PEAK;
+    int32_t freq, gain, q;
+
+    if (**str == 'l') type = EQ_LOW_SHELF;
+    if (**str == 'h') type = EQ_HIGH_SHELF;
+    if (type != EQ_PEAK) (*str)++;
+
+    freq = parse_num(str);
+    if (*(*str)++ != ':') return -1;
+    gain = parse_num(str);
+    if (*(*str)++ != ':') return -1;
+    q = parse_num(str);
+
+    return eq_set_band(&eq, eq.nbands, type, freq, gain, q);
+}
+
+
+/* ms_to_frames
+ *
+ * 		DESCRIPTION: converts a time to frames without overflowing or
+ *		             needing 64-bit division
+ *		INPUTS: ms -- time in ms
+ *		        rate -- sample rate in Hz
+ *		OUTPUTS: none
+ *		RETURN VALUE: number of frames
+ *		SIDE EFFECTS: none
+ */
+static uint32_t ms_to_frames(uint32_t ms, uint32_t rate) {
+
+    return (ms / MS_PER_SEC) * rate + (ms % MS_PER_SEC) * rate / MS_PER_SEC;
+}
+
+
+/* print_loudness
+ *
+ * 		DESCRIPTION: prints a file's loudness as a line of the cache file
+ *		INPUTS: name -- name of the file
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may scan the whole file, writes to the terminal
+ */
+static void print_loudness(uint8_t* name) {
+
+    uint8_t num[NUM_LEN];
+    int32_t lufs;
+
+    if (-1 == loud_lookup(&loud, name, &lufs)) {
+        ece391_fdputs (1, (uint8_t*)"could not scan ");
+    } else {
+        if (lufs < 0) ece391_fdputs (1, (uint8_t*)"-");
+        ece391_itoa(lufs < 0 ? -lufs : lufs, num, RADIX);
+        ece391_fdputs (1, num);
+        ece391_fdputs (1, (uint8_t*)" ");
+    }
+    ece391_fdputs (1, name);
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+
+/* print_index
+ *
+ * 		DESCRIPTION: prints a compressed file's whole seek index as lines
+ *		             of seek.cache; a WAV file needs no index, so it
+ *		             prints nothing
+ *		INPUTS: name -- name of the file
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: reads the whole file, writes to the terminal
+ */
+static void print_index(uint8_t* name) {
+
+    seek_index_t* idx;
+
+    if (-1 == wav_open(&wav, name, 0)) {
+        ece391_fdputs (1, (uint8_t*)"could not index ");
+        ece391_fdputs (1, name);
+        ece391_fdputs (1, (uint8_t*)"\n");
+        return;
+    }
+    if ((idx = wav_index(&wav)) != 0) seek_print(name, idx);
+    wav_close(&wav);
+}
+
+
+/* play_midi
+ *
+ * 		DESCRIPTION: plays a MIDI file on the OPL3. The RTC paces the
+ *		             sequencer at MIDI_HZ, and each tick's register writes
+ *		             go to the driver in one call, so no PCM is streamed.
+ *		             A start position is reached by playing everything but
+ *		             the notes before it, and the speed scales the clock.
+ *		INPUTS: name -- name of the file
+ *		        loop -- 1 to play the song forever
+ *		OUTPUTS: none
+ *		RETURN VALUE: MIDI_NOT_SMF if it isn't a MIDI file, else the
+ *		              program's exit status
+ *		SIDE EFFECTS: programs the OPL3
+ */
+static int32_t play_midi(uint8_t* name, int32_t loop) {
+
+    midi_event_t ev;
+    int32_t rtc, ret, hz = MIDI_HZ;
+    uint32_t us, carry = 0, tail;
+
+    if ((ret = midi_open(&midi, name)) != 0) return ret == MIDI_NOT_SMF ? ret : 2;
+
+    if ((rtc = ece391_open((uint8_t*)RTC_NAME)) == -1 ||
+        ece391_write(rtc, &hz, FOUR_B) == -1) {
+        ece391_fdputs (1, (uint8_t*)"no timer\n");
+        return 2;
+    }
+    if (ece391_audio_fm_open() == -1) {
+        ece391_close(rtc);
+        return 0;
+    }
+    fm_init(&fm, (uint8_t*)FM_BANK_FILE);
+
+    /* controllers and programs before the start still apply; notes on
+     * the start itself are left to play */
+    if (start_ms) {
+        midi_advance(&midi, start_ms * US_PER_MS - 1);
+        while (midi_next(&midi, &ev) > 0) {
+            if ((ev.status & MIDI_TYPE_MASK) != MIDI_NOTE_ON) fm_event(&fm, &ev);
+        }
+    }
+
+    while (1) {
+        if (fm_flush(&fm) == -1) break;
+        ece391_read(rtc, &hz, FOUR_B);
+
+        /* the RTC's period isn't a whole number of microseconds */
+        carry += US_PER_SEC;
+        us = carry / MIDI_HZ;
+        carry -= us * MIDI_HZ;
+        if (speed) us = ((uint64_t)us * speed) >> Q16_SHIFT;
+        midi_advance(&midi, us);
+
+        while ((ret = midi_next(&midi, &ev)) > 0) fm_event(&fm, &ev);
+        if (ret == -1) {
+            if (!loop) break;
+            midi_rewind(&midi);
+            fm_reset(&fm);
+        }
+    }
+
+    /* let the last notes ring out */
+    fm_reset(&fm);
+    fm_flush(&fm);
+    for (tail = 0; tail < MIDI_TAIL; tail++) ece391_read(rtc, &hz, FOUR_B);
+
+    ece391_audio_fm_close();
+    ece391_close(rtc);
+
+    return 0;
+}
+
+
+/* uart_frame
+ *
+ * 		DESCRIPTION: converts a time in the MIDI file to the frame of the
+ *		             PCM stream it plays at
+ *		INPUTS: us -- microseconds from the start of the song
+ *		OUTPUTS: none
+ *		RETURN VALUE: frame
+ *		SIDE EFFECTS: none
+ */
+static int32_t uart_frame(uint32_t us) {
+
+    return (int32_t)(((uint64_t)(us - uart_base) * uart_k) >> Q32_SHIFT);
+}
+
+
+/* uart_open
+ *
+ * 		DESCRIPTION: opens the MIDI file and the MPU-401, and queues the
+ *		             controllers and programs before the start position
+ *		INPUTS: rate -- sample rate of the PCM stream
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: resets the MPU-401
+ */
+static int32_t uart_open(uint32_t rate) {
+
+    midi_event_t ev;
+
+    if (midi_open(&midi, uart_name) != 0) {
+        ece391_fdputs (1, (uint8_t*)"not a MIDI file\n");
+        return -1;
+    }
+    if (ece391_audio_midi_open() == -1) return -1;
+    mpu_init(&mpu);
+
+    /* a stretched stream plays the song in more or fewer frames */
+    uart_k = (uint32_t)fix_qdiv((int64_t)rate << Q16_SHIFT,
+                                (int64_t)US_PER_SEC * (speed ? speed : TS_UNITY), Q32_SHIFT);
+    uart_ahead = ms_to_frames(UART_AHEAD, rate);
+    uart_base = start_ms * US_PER_MS;
+
+    if (start_ms) {
+        midi_advance(&midi, uart_base - 1);
+        while (midi_next(&midi, &ev) > 0) {
+            if ((ev.status & MIDI_TYPE_MASK) == MIDI_NOTE_ON) continue;
+            while (!mpu_room(&mpu)) mpu_dispatch(&mpu, 0);
+            mpu_post(&mpu, 0, &ev);
+        }
+
+        /* the clock is stamped from here on, so it mustn't be behind */
+        midi_advance(&midi, 1);
+    }
+
+    return 0;
+}
+
+
+/* uart_work
+ *
+ * 		DESCRIPTION: keeps the queue stocked ahead of the card and sends
+ *		             what the card has reached; the sequencer is stepped a
+ *		             millisecond at a time, but each event is stamped with
+ *		             the exact time it's due
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: sends MIDI bytes
+ */
+static void uart_work(void) {
+
+    midi_event_t ev;
+    int32_t now, ret;
+
+    if (!uart_name || ece391_audio_clock(&now) == -1) return;
+
+    while (!uart_done && mpu_room(&mpu) >= UART_ROOM &&
+            uart_frame(midi.clock) < now + uart_ahead) {
+        midi_advance(&midi, UART_STEP);
+        while ((ret = midi_next(&midi, &ev)) > 0)
+            mpu_post(&mpu, uart_frame(midi_position(&midi)), &ev);
+        if (ret == -1) uart_done = 1;
+    }
+
+    mpu_dispatch(&mpu, now);
+}
+
+
+/* uart_close
+ *
+ * 		DESCRIPTION: cuts off the song where the PCM ended, with every note
+ *		             released, and reports how well the events kept time
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: resets the MPU-401, writes to the terminal
+ */
+static void uart_close(void) {
+
+    uint8_t num[NUM_LEN];
+    uint32_t i = UART_DRAIN;
+
+    if (!uart_name) return;
+
+    /* what's still queued is past the end, so only the releases go out */
+    mpu.tail = mpu.head;
+    mpu_notes_off(&mpu, 0);
+    while ((mpu.tail != mpu.head || mpu.out_pos < mpu.out_len) && i--)
+        mpu_dispatch(&mpu, 0);
+    ece391_audio_midi_close();
+
+    ece391_fdputs (1, (uint8_t*)"midi ");
+    ece391_fdputs (1, ece391_itoa(mpu.sent, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" events, late ");
+    ece391_fdputs (1, ece391_itoa(mpu.sent ? mpu.late_sum / mpu.sent : 0, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" avg ");
+    ece391_fdputs (1, ece391_itoa(mpu.late_max, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" max frames, dropped ");
+    ece391_fdputs (1, ece391_itoa(mpu.dropped, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)"\n");
+    uart_name = 0;
+}
+
+
+/* print_silence
+ *
+ * 		DESCRIPTION: reports what silence detection saved
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes to the terminal
+ */
+static void print_silence(void) {
+
+    uint8_t num[NUM_LEN];
+
+    if (!silence) return;
+
+    ece391_fdputs (1, (uint8_t*)"copied ");
+    ece391_fdputs (1, ece391_itoa(bytes_copied / _1KB, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" KB, skipped ");
+    ece391_fdputs (1, ece391_itoa(bytes_skipped / _1KB, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" KB, avoided ");
+    ece391_fdputs (1, ece391_itoa(irqs_avoided, num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" interrupts\n");
+}
+
+
+/* print_standby
+ *
+ * 		DESCRIPTION: reports the interrupts the card has taken while warm
+ *		             between streams
+ *		INPUTS: none
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: writes to the terminal
+ */
+static void print_standby(void) {
+
+    uint8_t num[NUM_LEN];
+
+    ece391_fdputs (1, (uint8_t*)"standby cost ");
+    ece391_fdputs (1, ece391_itoa(ece391_audio_standby_irqs(), num, RADIX));
+    ece391_fdputs (1, (uint8_t*)" interrupts so far\n");
+}
+
+
+/* fill_half
+ *
+ * 		DESCRIPTION: fills one half of the buffer from the playlist, running
+ *		             gaplessly into the next track when its format matches
+ *		             and starting it on a fresh half when it doesn't.
+ *		             Anything beyond a straight copy goes through the 32-bit
+ *		             mix bus and is packed back by the limiter. A silent
+ *		             period is written as zeros once, and not at all while
+ *		             the half still holds them.
+ *		INPUTS: dst -- half of the buffer to fill
+ *		        half -- index of that half
+ *		OUTPUTS: dst -- PCM data, zero padded after the last track
+ *		RETURN VALUE: size of the half, 0 when the playlist is done
+ *		SIDE EFFECTS: moves through the playlist, sets reconfig and quiet
+ */
+static int32_t fill_half(int8_t* dst, int32_t half) {
+
+    uint32_t done = 0;
+    uint32_t prev_rate, rate = 0;
+    uint16_t prev_channels, channels = 0, align = 1;
+    int32_t n, m, i;
+    /* straight copies skip the mix bus */
+    int32_t mixing = xfade_secs || eq.nbands || lim_ms || normalize || gain_db;
+    /* a half of silence is only overwritten once the data turns out not
+     * to be silent */
+    int8_t* out = (silence && half_silent[half]) ? stage : dst;
+
+    /* playlist is done */
+    if (cur_track >= ntracks) return 0;
+
+    half_track[half] = cur_track;
+    half_frame[half] = wav.pos / wav.block_align;
+
+    reconfig = switch_next;
+    switch_next = 0;
+
+    /* open the next track once the current one is within the fade */
+    if (xfade_secs && !speed && !fading && !wav.loop_end && cur_track + 1 < ntracks &&
+            wav.data_size - wav.pos <= xfade_secs * wav.sample_rate * wav.block_align) {
+        fading = -1;
+        if (-1 != wav_open(&next, tracks[cur_track + 1], 0)) {
+            if (next.sample_rate == wav.sample_rate && next.nchannels == wav.nchannels) {
+                xfade_start(&xf, (wav.data_size - wav.pos) / wav.block_align);
+                fading = 1;
+            } else {
+                wav_close(&next);
+            }
+        }
+    }
+
+    while (done < BUF_SIZE) {
+        n = speed ? stretch_fill(&ts, &wav, out + done, BUF_SIZE - done) :
+                    wav_fill(&wav, out + done, BUF_SIZE - done);
+
+        /* widen onto the bus with the software gain applied */
+        if (mixing) {
+            for (i = 0; i < n / TWO_B; i++)
+                bus[done / TWO_B + i] = (int32_t)(((int64_t)((int16_t*)(out + done))[i] *
+                        track_gain[cur_track]) >> 16);
+        }
+
+        /* mix in the same amount of the next track */
+        if (fading == 1 && n) {
+            m = wav_fill(&next, xbuf, n);
+            while (m < n) xbuf[m++] = 0;
+            xfade_mix(&xf, bus + done / TWO_B, (int16_t*)xbuf,
+                      n / wav.block_align, wav.nchannels, track_gain[cur_track + 1]);
+        }
+
+        /* a half holds a single format, whichever track wrote it */
+        if (n) {
+            rate = wav.sample_rate;
+            channels = wav.nchannels;
+            align = wav.block_align;
+        }
+
+        done += n;
+        if (done == BUF_SIZE) break;
+
+        /* track ended; move on to the next one */
+        prev_rate = wav.sample_rate;
+        prev_channels = wav.nchannels;
+        wav_close(&wav);
+
+        /* the faded-in track carries on from where the fade left it */
+        if (fading == 1) {
+            wav = next;
+            cur_track++;
+            fading = 0;
+            continue;
+        }
+        fading = 0;
+
+        if (++cur_track >= ntracks || -1 == wav_open(&wav, tracks[cur_track], 0)) {
+            cur_track = ntracks;
+            break;
+        }
+        if (speed && -1 == stretch_init(&ts, speed, wav.sample_rate, wav.nchannels))
+            speed = 0;
+
+        if (wav.sample_rate == prev_rate && wav.nchannels == prev_channels)
+            continue;
+
+        /* a half plays at one rate, so pad this one out and switch on the
+         * next boundary */
+        if (done) {
+            switch_next = 1;
+            break;
+        }
+        reconfig = 1;
+    }
+
+    if (!done) return 0;
+
+    if (mixing) {
+        /* tone correction on what was read, before any padding */
+        eq_process(&eq, bus, done / align, channels, rate);
+
+        /* silence after the end of the track, which also drains the
+         * limiter's delay line */
+        for (i = done / TWO_B; i < BUF_SIZE / TWO_B; i++) bus[i] = 0;
+
+        /* pack back into the half, through the limiter if there is one */
+        if (lim_ms && (rate != lim_rate || channels != lim_channels)) {
+            lim_rate = rate;
+            lim_channels = channels;
+            n = lim_ms * rate / MS_PER_SEC;
+            if (-1 == lim_init(&lim, n < LIM_MAX_LOOKAHEAD ? n : LIM_MAX_LOOKAHEAD,
+                        channels, rate))
+                lim_ms = 0;
+        }
+        if (metering) meter_start(&meter, channels);
+        if (lim_ms) {
+            /* the limiter's delay line keeps running through silence, and
+             * meters what it packs */
+            lim_process(&lim, bus, (int16_t*)dst, BUF_SIZE / align, metering ? &meter : 0);
+            quiet = silence && (metering ? meter_quiet(&meter) :
+                                meter_silent((int16_t*)dst, BUF_SIZE / TWO_B));
+        } else if ((quiet = silence && meter_silent_bus(bus, BUF_SIZE / TWO_B))) {
+            /* nothing to pack */
+        } else if (metering) {
+            meter_pack(&meter, bus, (int16_t*)dst, BUF_SIZE / align);
+        } else {
+            for (i = 0; i < BUF_SIZE / TWO_B; i++) ((int16_t*)dst)[i] = fix_sat16(bus[i]);
+        }
+    } else {
+        /* silence after the end of the track */
+        while (done % BUF_SIZE) out[done++] = 0;
+
+        /* the file went straight into the half, so there was no copy to
+         * meter in; one pass meters it and finds whether it's silent */
+        if (metering) {
+            meter_start(&meter, channels);
+            meter_scan(&meter, (int16_t*)out, BUF_SIZE / align);
+            quiet = silence && meter_quiet(&meter);
+        } else {
+            quiet = silence && meter_silent((int16_t*)out, BUF_SIZE / TWO_B);
+        }
+        if (!quiet && out != dst) {
+            for (i = 0; i < BUF_SIZE / FOUR_B; i++) ((int32_t*)dst)[i] = ((int32_t*)out)[i];
+        }
+    }
+
+    /* below the silence level counts as zeros, which stay in the half
+     * until something audible replaces them */
+    if (quiet && half_silent[half] && !lim_ms) {
+        bytes_skipped += BUF_SIZE;
+    } else {
+        if (quiet) {
+            for (i = 0; i < BUF_SIZE / FOUR_B; i++) ((int32_t*)dst)[i] = 0;
+        }
+        bytes_copied += BUF_SIZE;
+    }
+    half_silent[half] = quiet;
+
+    if (metering) meter_finish(&meter, &levels);
+
+    return BUF_SIZE;
+}
+
+
+/* seek_playback
+ *
+ * 		DESCRIPTION: seeks in the current track with the lowest latency:
+ *		             stops the DMA where it is, refills both halves from
+ *		             the new position and restarts from the first half,
+ *		             without resetting the card
+ *		INPUTS: frame -- frame of the current track to go to
+ *		        buf_val -- addresses of the two halves
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: restarts the DMA, drops a crossfade in progress
+ */
+static int32_t seek_playback(uint32_t frame, const uint32_t* buf_val) {
+
+    uint8_t info_block[IBLOCK_SIZE];
+    int32_t i;
+
+    if (ece391_audio_pause(1) == -1 || wav_seek(&wav, frame) == -1) return -1;
+
+    /* nothing buffered carries over, including the limiter's delay line */
+    if (fading == 1) wav_close(&next);
+    fading = 0;
+    lim_rate = 0;
+    half_silent[0] = half_silent[1] = 0;
+    if (speed) stretch_reset(&ts);
+
+    /* the fills may move on to the next track, so keep this header */
+    for (i = 0; i < IBLOCK_SIZE; i++) info_block[i] = wav.info_block[i];
+    for (i = 0; i < BUF_DIM; i++) {
+        fill_half((int8_t*)buf_val[i], i);
+        if (metering) ece391_audio_meter_post(i, &levels);
+    }
+    if (ece391_audio_restart(info_block) == -1) return -1;
+    if (reconfig) ece391_audio_reconfigure(wav.info_block);
+
+    return 0;
+}
 
 
 int main() {
 
-    int32_t fd;
     uint32_t buf_val[BUF_DIM];
-    uint8_t fname[COPY_LEN];
+    uint8_t args[COPY_LEN];
+    uint8_t* fname = args;
     uint8_t info_block[IBLOCK_SIZE];
     int32_t init_retval;
+    int32_t loop = 0;
+    int32_t standby = STBY_QUERY;
+    int32_t warm;
+    int32_t scan = 0;
+    int32_t indexing = 0;
+    int32_t lufs, i, ret;
+    int32_t paused = 0;
+    int32_t silent_run = 0;
+    uint32_t clip_size;
     volatile int prev_cstatus = 0;
     volatile int temp = 0;
 
     /* get file name */
-    if (0 != ece391_getargs (fname, COPY_LEN)) {
+    if (0 != ece391_getargs (args, COPY_LEN)) {
         ece391_fdputs (1, (uint8_t*)"could not read arguments\n");
         return 3;
     }
 
-    /* check if filename is valid */
-    if (-1 == (fd = ece391_open (fname))) {
+    eq_init(&eq);
+
+    /* check for flags ahead of the file names */
+    while (1) {
+        if (!ece391_strncmp(fname, (uint8_t*)LOOP_FLAG, FLAG_LEN))
+            loop = 1;
+        else if (!ece391_strncmp(fname, (uint8_t*)STBY_FLAG, FLAG_LEN))
+            standby = STBY_PERIODS;
+        else if (!ece391_strncmp(fname, (uint8_t*)WARM_FLAG, FLAG_LEN)) {
+            /* periods to stay warm follow the flag, 0 until the next stream */
+            fname += FLAG_LEN;
+            standby = 0;
+            while (*fname >= '0' && *fname <= '9')
+                standby = standby * RADIX + (*fname++ - '0');
+            if (*fname == ' ') fname++;
+            continue;
+        }
+        else if (!ece391_strncmp(fname, (uint8_t*)XFADE_FLAG, FLAG_LEN)) {
+            /* fade length in seconds follows the flag */
+            fname += FLAG_LEN;
+            while (*fname >= '0' && *fname <= '9')
+                xfade_secs = xfade_secs * RADIX + (*fname++ - '0');
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)GAIN_FLAG, FLAG_LEN)) {
+            /* gain in tenths of a dB follows the flag */
+            fname += FLAG_LEN;
+            gain_db = parse_num(&fname);
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)NORM_FLAG, FLAG_LEN)) {
+            /* target loudness in tenths of LUFS follows the flag */
+            fname += FLAG_LEN;
+            normalize = 1;
+            norm_target = parse_num(&fname);
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)SCAN_FLAG, FLAG_LEN))
+            scan = 1;
+        else if (!ece391_strncmp(fname, (uint8_t*)INDEX_FLAG, FLAG_LEN))
+            indexing = 1;
+        else if (!ece391_strncmp(fname, (uint8_t*)METER_FLAG, FLAG_LEN))
+            metering = 1;
+        else if (!ece391_strncmp(fname, (uint8_t*)START_FLAG, FLAG_LEN)) {
+            /* start position in ms follows the flag */
+            fname += FLAG_LEN;
+            start_ms = parse_num(&fname);
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)JUMP_FLAG, FLAG_LEN)) {
+            /* jump as at:to in ms follows the flag */
+            fname += FLAG_LEN;
+            jump_at = parse_num(&fname);
+            if (*fname++ != ':') {
+                ece391_fdputs (1, (uint8_t*)"bad jump\n");
+                return 3;
+            }
+            jump_to = parse_num(&fname);
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)SPEED_FLAG, FLAG_LEN)) {
+            /* speed in percent follows the flag */
+            fname += FLAG_LEN;
+            speed = (uint32_t)parse_num(&fname) * TS_UNITY / PERCENT;
+            if (speed == TS_UNITY) speed = 0;
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)UART_FLAG, FLAG_LEN)) {
+            /* a MIDI file for the MPU-401 follows the flag */
+            fname += FLAG_LEN;
+            uart_name = fname;
+            while (*fname && *fname != ' ') fname++;
+            if (*fname == ' ') *fname++ = '\0';
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)QUIET_FLAG, FLAG_LEN)) {
+            /* silent periods before the DMA pauses follow the flag; both
+             * halves must be silent, so it takes at least two */
+            fname += FLAG_LEN;
+            silence = 1;
+            pause_after = parse_num(&fname);
+            if (pause_after == 1) pause_after = BUF_DIM;
+            if (*fname == ' ') fname++;
+            continue;
+        }
+        else if (!ece391_strncmp(fname, (uint8_t*)LIM_FLAG, FLAG_LEN)) {
+            /* limiter look-ahead in ms follows the flag */
+            fname += FLAG_LEN;
+            lim_ms = parse_num(&fname);
+            if (*fname == ' ') fname++;
+            continue;
+        } else if (!ece391_strncmp(fname, (uint8_t*)EQ_FLAG, FLAG_LEN)) {
+            fname += FLAG_LEN;
+            if (parse_band(&fname) == -1) {
+                ece391_fdputs (1, (uint8_t*)"bad eq band\n");
+                return 3;
+            }
+            if (*fname == ' ') fname++;
+            continue;
+        } else
+            break;
+        fname += FLAG_LEN;
+    }
+
+    if (!split_tracks(fname)) {
         ece391_fdputs (1, (uint8_t*)"file not found\n");
         return 2;
     }
 
-    /* read first 44 blocks of file */
-    ece391_read(fd, info_block, IBLOCK_SIZE);
+    /* print each file's loudness in the cache file's format */
+    if (scan) {
+        for (i = 0; i < ntracks; i++) print_loudness(tracks[i]);
+        return 0;
+    }
 
-    /* get retval from init, which should be a ptr if successful */
-    init_retval = ece391_audio_init(info_block);
-    /* terminate program if init was unsuccessful */
-    if (init_retval == -1) return 0;
+    /* print each compressed file's seek index in the cache file's format */
+    if (indexing) {
+        for (i = 0; i < ntracks; i++) print_index(tracks[i]);
+        return 0;
+    }
+
+    /* per-track gain, with loudness from the cache or scanned before
+     * playback starts */
+    for (i = 0; i < ntracks; i++) track_gain[i] = fix_db_gain(gain_db);
+    if (normalize) {
+        loud_cache_load();
+        for (i = 0; i < ntracks; i++) {
+            if (-1 != loud_lookup(&loud, tracks[i], &lufs))
+                track_gain[i] = fix_db_gain(gain_db + loud_gain(lufs, norm_target));
+        }
+    }
+
+    /* MIDI files are rendered like modules if there's a sound bank, and
+     * otherwise play on the FM synthesizer, on their own */
+    if (-1 != (ret = ece391_open((uint8_t*)WT_BANK_FILE))) ece391_close(ret);
+    else if (MIDI_NOT_SMF != (ret = play_midi(tracks[0], loop))) return ret;
+
+    /* check if filename is valid, and walk to the data chunk */
+    if (-1 == wav_open (&wav, tracks[0], loop)) {
+        ece391_fdputs (1, (uint8_t*)"file not found\n");
+        return 2;
+    }
+
+    /* whole-file loops that fit in the DMA buffer loop in hardware with no
+     * refills, unless they have to be stretched */
+    if (loop && !speed && !wav.loop_start && wav.loop_end == wav.data_size &&
+            wav.data_size <= sizeof(clip)) {
+        wav.loop_end = 0;
+        clip_size = wav_fill(&wav, clip, wav.data_size);
+        wav_close(&wav);
+        if (ece391_audio_loop(wav.info_block, clip, clip_size) == -1) return 0;
+
+        /* sleep on the terminal until the user stops playback */
+        ece391_fdputs (1, (uint8_t*)"looping, press enter to stop\n");
+        ece391_read(0, args, COPY_LEN);
+        ece391_audio_shutdown();
+        return 0;
+    }
+
+    /* frames are whole blocks, so the start is exact to the sample */
+    if (start_ms && wav_seek(&wav, ms_to_frames(start_ms, wav.sample_rate)) == -1) {
+        ece391_fdputs (1, (uint8_t*)"could not seek\n");
+        return 2;
+    }
+
+    if (speed && -1 == stretch_init(&ts, speed, wav.sample_rate, wav.nchannels)) {
+        ece391_fdputs (1, (uint8_t*)"speed must be 50 to 200\n");
+        return 3;
+    }
+
+    /* the MIDI file follows the first track's clock */
+    if (uart_name && -1 == uart_open(wav.sample_rate)) return 2;
+
+    /* set the standby policy for after this stream */
+    if (standby != STBY_QUERY) {
+        ece391_audio_standby(standby);
+        print_standby();
+    }
+
+    /* take the card over if it's still warm from the last stream; the
+     * check and the claim are one call, so standby can't run out between
+     * them and leave the card stopped with the player filling one half */
+    init_retval = ece391_audio_resume(wav.info_block);
+    warm = init_retval != -1;
+    if (!warm) {
+        /* start the reset and get the buffer without waiting for the DSP */
+        init_retval = ece391_audio_open();
+        if (init_retval == -1) return 0;
+    }
 
     /* calculate and load pointer values */
     buf_val[0] = (uint32_t)init_retval;
     buf_val[1] = (uint32_t)init_retval + BUF_SIZE;
 
-    /* copy first chunks into buffer */
-    ece391_read(fd, (int8_t*)buf_val[0], BUF_SIZE);
-    ece391_read(fd, (int8_t*)buf_val[1], BUF_SIZE);
+    /* a warm card is already playing one half, so start in the free one;
+     * a cold one starts from the top of the buffer once the reset is done,
+     * and these reads overlap with it */
+    if (warm) {
+        /* standby left the buffer zeroed */
+        half_silent[0] = half_silent[1] = 1;
+        prev_cstatus = ece391_audio_cstatus();
+        fill_half((int8_t*)buf_val[prev_cstatus], prev_cstatus);
+        if (metering) ece391_audio_meter_post(prev_cstatus, &levels);
+        if (reconfig) ece391_audio_reconfigure(wav.info_block);
+    } else {
+        /* the fills may move on to the next track, so keep this header */
+        for (temp = 0; temp < IBLOCK_SIZE; temp++)
+            info_block[temp] = wav.info_block[temp];
+        fill_half((int8_t*)buf_val[0], 0);
+        if (metering) ece391_audio_meter_post(0, &levels);
+        fill_half((int8_t*)buf_val[1], 1);
+        if (metering) ece391_audio_meter_post(1, &levels);
+        if (reconfig) ece391_audio_reconfigure(wav.info_block);
+        if (ece391_audio_start(info_block) == -1) return 0;
+        prev_cstatus = ece391_audio_cstatus();
+    }
 
     while(1) {
+        /* with DMA paused there are no interrupts to wait for, so read on
+         * into the free half until the silence ends, then let the DMA
+         * finish the silent half it stopped in and carry on */
+        if (paused) {
+            if (!fill_half((int8_t*)buf_val[prev_cstatus], prev_cstatus)) {
+                print_silence();
+                uart_close();
+                ece391_audio_shutdown();
+                return 0;
+            }
+            irqs_avoided++;
+            if (reconfig) ece391_audio_reconfigure(wav.info_block);
+            if (!quiet) {
+                if (metering) ece391_audio_meter_post(prev_cstatus, &levels);
+                ece391_audio_pause(0);
+                paused = 0;
+                silent_run = 0;
+            }
+            continue;
+        }
+
         /* record interrupt status */
         temp = ece391_audio_cstatus();
         /* check if status changed */
         if (prev_cstatus != temp) {
             /* copy block into correct buffer region, and terminate program if
              * finished */
-            if (!ece391_read(fd, (int8_t*)buf_val[temp], BUF_SIZE)) {
+            if (!fill_half((int8_t*)buf_val[temp], temp)) {
+                print_silence();
+                uart_close();
                 ece391_audio_shutdown();
                 return 0;
             }
+            /* levels go out when the DMA reaches this half */
+            if (metering) ece391_audio_meter_post(temp, &levels);
+            /* switch rate as the DMA reaches the half just filled */
+            if (reconfig) ece391_audio_reconfigure(wav.info_block);
             /* record current status */
             prev_cstatus = temp;
+            /* the fill may have held up events that are due */
+            uart_work();
+
+            /* the other half has just started playing; once it's past the
+             * jump point in the first track, go */
+            if (jump_at && cur_track == 0 && half_track[!temp] == 0 &&
+                    half_frame[!temp] >= ms_to_frames(jump_at, wav.sample_rate)) {
+                jump_at = 0;
+                if (-1 == seek_playback(ms_to_frames(jump_to, wav.sample_rate), buf_val)) {
+                    uart_close();
+                    ece391_audio_shutdown();
+                    return 0;
+                }
+                prev_cstatus = ece391_audio_cstatus();
+                continue;
+            }
+
+            /* both halves hold silence once the run is two long, so the
+             * DMA can stop anywhere */
+            silent_run = quiet ? silent_run + 1 : 0;
+            if (pause_after && silent_run >= pause_after && ece391_audio_pause(1) != -1)
+                paused = 1;
+        } else {
+            /* decode ahead while the card plays, so a compressed track's
+             * next half is mostly ready when it's needed; with nothing
+             * left to do, sleep until the half is free rather than spin
+             * on the status, unless there are MIDI events to keep sending */
+            if (!wav_work(&wav) && !uart_name) ece391_audio_wait(prev_cstatus);
+            uart_work();
         }
     }
 
@@ -0,0 +1,1954 @@
+/* vorbis.c - Ogg Vorbis decoder: Ogg pages, the three Vorbis headers,
+ * floor 1, residues 0 to 2 and the inverse MDCT, all in fixed point.
+ * Written by Soumithri Bala. */
+
+
+#include "vorbis.h"
+#include "fixmath.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+#define PKT_IDENT           1
+#define PKT_COMMENT         3
+#define PKT_SETUP           5
+#define PKT_HDR_SIZE        7
+#define VORBIS_STR_LEN      6
+#define BOOK_SYNC           0x564342
+#define CRC_POLY            0x04C11DB7
+#define END_UNKNOWN         0xFFFFFFFF
+#define MIN_BLOCK           64
+#define LEN_BITS            5
+#define LEN_MASK            ((1 << LEN_BITS) - 1)
+#define FIFO_MASK           (VORBIS_FIFO_FRAMES - 1)
+#define VAL_MAX             0x7FFFFFFF
+/* the spectrum is clamped to the inverse MDCT's headroom */
+#define SPEC_MAX            (1 << 30)
+/* products are rounded, not truncated; over the FFT's passes truncation
+ * biases the output by tens of LSBs */
+#define Q30_HALF            (1 << (Q30_SHIFT - 1))
+/* residue times floor to the spectrum; rounded too, as a bias in every
+ * bin comes out as a click in the middle of the block */
+#define FLOOR_SHIFT         (VB_RES_SHIFT + VB_FLOOR_SHIFT - VB_SPEC_SHIFT)
+#define FLOOR_HALF          (1 << (FLOOR_SHIFT - 1))
+/* Q20 output to 16 bits */
+#define OUT_SHIFT           (VB_SPEC_SHIFT - Q15_SHIFT)
+
+
+/* CRC of Ogg pages, built on the first open */
+static uint32_t crc_tab[256];
+static int32_t crc_ready = 0;
+
+static const uint8_t vorbis_str[VORBIS_STR_LEN] = {'v', 'o', 'r', 'b', 'i', 's'};
+
+/* floor 1 amplitude range by multiplier */
+static const uint32_t floor1_range[4] = {256, 128, 86, 64};
+
+/* floor 1 amplitudes, 0.546875 dB apart up to unity, in Q30 */
+static const uint32_t inv_db[256] = {
+    114U, 122U, 130U, 138U, 147U, 157U,
+    167U, 178U, 189U, 202U, 215U, 229U,
+    243U, 259U, 276U, 294U, 313U, 333U,
+    355U, 378U, 403U, 429U, 457U, 487U,
+    518U, 552U, 588U, 626U, 667U, 710U,
+    756U, 805U, 858U, 913U, 973U, 1036U,
+    1103U, 1175U, 1251U, 1332U, 1419U, 1511U,
+    1609U, 1714U, 1825U, 1944U, 2070U, 2205U,
+    2348U, 2501U, 2663U, 2836U, 3021U, 3217U,
+    3426U, 3649U, 3886U, 4138U, 4407U, 4694U,
+    4999U, 5324U, 5670U, 6038U, 6430U, 6848U,
+    7293U, 7767U, 8272U, 8810U, 9382U, 9992U,
+    10641U, 11333U, 12069U, 12854U, 13689U, 14578U,
+    15526U, 16535U, 17609U, 18754U, 19972U, 21270U,
+    22653U, 24125U, 25692U, 27362U, 29140U, 31034U,
+    33051U, 35199U, 37486U, 39922U, 42516U, 45279U,
+    48222U, 51356U, 54693U, 58247U, 62032U, 66064U,
+    70357U, 74929U, 79798U, 84984U, 90507U, 96388U,
+    102652U, 109323U, 116428U, 123994U, 132052U, 140633U,
+    149772U, 159505U, 169871U, 180910U, 192666U, 205187U,
+    218521U, 232722U, 247846U, 263952U, 281105U, 299373U,
+    318828U, 339547U, 361613U, 385112U, 410139U, 436792U,
+    465177U, 495407U, 527602U, 561888U, 598403U, 637290U,
+    678705U, 722811U, 769784U, 819808U, 873084U, 929822U,
+    990247U, 1054599U, 1123133U, 1196120U, 1273851U, 1356633U,
+    1444795U, 1538686U, 1638678U, 1745169U, 1858579U, 1979360U,
+    2107990U, 2244979U, 2390871U, 2546243U, 2711712U, 2887935U,
+    3075609U, 3275479U, 3488338U, 3715030U, 3956454U, 4213567U,
+    4487388U, 4779004U, 5089570U, 5420319U, 5772562U, 6147696U,
+    6547208U, 6972682U, 7425806U, 7908377U, 8422308U, 8969637U,
+    9552535U, 10173312U, 10834431U, 11538514U, 12288351U, 13086918U,
+    13937379U, 14843109U, 15807698U, 16834971U, 17929002U, 19094130U,
+    20334974U, 21656455U, 23063814U, 24562630U, 26158848U, 27858798U,
+    29669219U, 31597292U, 33650663U, 35837472U, 38166393U, 40646660U,
+    43288110U, 46101215U, 49097132U, 52287740U, 55685692U, 59304462U,
+    63158400U, 67262789U, 71633904U, 76289079U, 81246773U, 86526646U,
+    92149635U, 98138038U, 104515600U, 111307613U, 118541009U, 126244472U,
+    134448549U, 143185773U, 152490792U, 162400503U, 172954203U, 184193742U,
+    196163689U, 208911511U, 222487758U, 236946266U, 252344370U, 268743129U,
+    286207572U, 304806953U, 324615027U, 345710341U, 368176547U, 392102733U,
+    417583779U, 444720726U, 473621185U, 504399758U, 537178497U, 572087383U,
+    609264845U, 648858308U, 691024778U, 735931462U, 783756436U, 834689345U,
+    888932163U, 946699984U, 1008221884U, 1073741824U
+};
+
+
+/* local function definitions */
+static int32_t ogg_read(vorbis_t* vb, uint8_t* buf, uint32_t len);
+static int32_t ogg_skip(vorbis_t* vb, uint32_t len);
+static int32_t ogg_jump(vorbis_t* vb, uint32_t offset);
+static int32_t ogg_page(vorbis_t* vb);
+static int32_t ogg_packet(vorbis_t* vb);
+static uint32_t ogg_crc(uint32_t crc, const uint8_t* p, uint32_t len);
+static uint32_t vb_peek(const vorbis_t* vb);
+static uint32_t vb_bits(vorbis_t* vb, uint32_t n);
+static int32_t vb_eop(const vorbis_t* vb);
+static uint32_t vb_ilog(uint32_t x);
+static uint32_t vb_reverse(uint32_t x);
+static void* vb_alloc(vorbis_t* vb, uint32_t size);
+static int32_t vb_header(vorbis_t* vb, uint32_t type);
+static int32_t vb_headers(vorbis_t* vb);
+static int32_t vb_ident(vorbis_t* vb);
+static int32_t vb_setup(vorbis_t* vb);
+static int32_t vb_book_read(vorbis_t* vb, vb_book_t* bk);
+static int32_t vb_book_build(vorbis_t* vb, vb_book_t* bk, const uint8_t* len);
+static int32_t vb_book_vq(vorbis_t* vb, vb_book_t* bk, uint32_t lookup);
+static uint32_t vb_lookup1(uint32_t entries, uint32_t dims);
+static int32_t vb_float(uint32_t x);
+static void vb_sort(uint32_t* key, uint32_t* val, uint32_t n);
+static int32_t vb_floor_read(vorbis_t* vb, vb_floor_t* fl);
+static int32_t vb_residue_read(vorbis_t* vb, vb_residue_t* r);
+static int32_t vb_mapping_read(vorbis_t* vb, vb_mapping_t* map);
+static void vb_tables(vorbis_t* vb);
+static void vb_restart(vorbis_t* vb);
+static void vb_unit(vorbis_t* vb);
+static int32_t vb_decode(vorbis_t* vb, const vb_book_t* bk);
+static void vb_packet(vorbis_t* vb);
+static int32_t vb_floor_decode(vorbis_t* vb, const vb_floor_t* fl, int32_t* y);
+static void vb_residue_decode(vorbis_t* vb, const vb_residue_t* r, const uint32_t* chans,
+                              uint32_t nch, const uint32_t* nonzero);
+static int32_t vb_residue_part(vorbis_t* vb, const vb_residue_t* r, const vb_book_t* bk,
+                               const uint32_t* chans, uint32_t nch, uint32_t j,
+                               uint32_t off);
+static void vb_couple(vorbis_t* vb, const vb_mapping_t* map);
+static void vb_synth(vorbis_t* vb, uint32_t c);
+static void vb_floor_curve(const vb_floor_t* fl, int32_t* y, int32_t* spec, uint32_t n2);
+static void vb_render_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                           int32_t* spec, uint32_t n2);
+static void vb_imdct(vorbis_t* vb, const int32_t* x, int32_t* y);
+static void vb_fft(const vorbis_t* vb, int32_t* a, uint32_t q);
+static void vb_window(vorbis_t* vb, int32_t* y);
+static void vb_commit(vorbis_t* vb);
+static uint32_t rd32(const uint8_t* p);
+
+
+/* vorbis_open
+ *
+ * 		DESCRIPTION: opens an Ogg Vorbis stream, reads its identification,
+ *		             comment and setup headers, and builds the codebooks
+ *		             and transform tables
+ *		INPUTS: vb -- decoder state
+ *		        fname -- name of the file
+ *		OUTPUTS: vb -- rate, channels and setup, ready for the first
+ *		               audio packet
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: opens a file descriptor, takes the file's seek index
+ */
+int32_t vorbis_open(vorbis_t* vb, const uint8_t* fname) {
+
+    uint32_t i, j, crc;
+    int32_t found;
+
+    if (!crc_ready) {
+        for (i = 0; i < 256; i++) {
+            crc = i << 24;
+            for (j = 0; j < 8; j++) crc = (crc & 0x80000000) ? (crc << 1) ^ CRC_POLY : crc << 1;
+            crc_tab[i] = crc;
+        }
+        crc_ready = 1;
+    }
+
+    vb->fname = fname;
+    vb->serial_known = 0;
+    vb->page_seq = 0;
+    vb->seg = vb->nsegs = 0;
+    vb->file_pos = 0;
+    if (-1 == (vb->fd = ece391_open(fname))) return -1;
+
+    if (vb_headers(vb) == -1) {
+        ece391_close(vb->fd);
+        return -1;
+    }
+
+    /* the headers end a page, and audio starts on the next */
+    vb->first_page = vb->file_pos;
+    vb->idx = seek_cache_get(fname, vb->sample_rate / VORBIS_INDEX_RATE, &found);
+    vb->idx->rate = vb->sample_rate;
+    vb->idx->data_offset = vb->first_page;
+
+    vb_tables(vb);
+    vb_restart(vb);
+
+    return 0;
+}
+
+
+/* vorbis_read
+ *
+ * 		DESCRIPTION: copies decoded PCM out of the FIFO, running units of
+ *		             decoding only when it runs dry
+ *		INPUTS: vb -- decoder state
+ *		        dst -- destination
+ *		        len -- bytes wanted, in whole frames
+ *		OUTPUTS: dst -- interleaved 16-bit PCM
+ *		RETURN VALUE: bytes copied, fewer than len only at the end of the
+ *		              stream
+ *		SIDE EFFECTS: reads ahead in the file
+ */
+int32_t vorbis_read(vorbis_t* vb, int8_t* dst, uint32_t len) {
+
+    uint32_t ch = vb->channels;
+    uint32_t frames = len / (ch * sizeof(int16_t));
+    uint32_t done = 0, n, i;
+    int16_t* out = (int16_t*)dst;
+    const int16_t* src;
+
+    while (done < frames) {
+        if (!vb->count) {
+            if (vb->stage == VB_END) break;
+            vb_unit(vb);
+            continue;
+        }
+
+        /* up to the wrap of the ring */
+        n = frames - done;
+        if (n > vb->count) n = vb->count;
+        if (n > VORBIS_FIFO_FRAMES - vb->head) n = VORBIS_FIFO_FRAMES - vb->head;
+
+        src = vb->fifo + vb->head * ch;
+        for (i = 0; i < n * ch; i++) out[done * ch + i] = src[i];
+
+        vb->head = (vb->head + n) & FIFO_MASK;
+        vb->count -= n;
+        vb->out_pos += n;
+        done += n;
+    }
+
+    return done * ch * sizeof(int16_t);
+}
+
+
+/* vorbis_work
+ *
+ * 		DESCRIPTION: does one unit of decoding, either parsing a packet or
+ *		             synthesizing one of its channels, so the caller can
+ *		             spread the decode over the time between refills. A
+ *		             new packet is only started while the FIFO has room for
+ *		             all of its output.
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- FIFO topped up
+ *		RETURN VALUE: 1 if a unit was done, 0 if there was nothing to do
+ *		SIDE EFFECTS: reads ahead in the file
+ */
+int32_t vorbis_work(vorbis_t* vb) {
+
+    if (vb->stage == VB_END) return 0;
+    if (vb->stage == VB_PACKET && VORBIS_FIFO_FRAMES - vb->count < vb->blocksize[1] / 2)
+        return 0;
+
+    vb_unit(vb);
+
+    return 1;
+}
+
+
+/* vorbis_seek
+ *
+ * 		DESCRIPTION: moves to a frame. A frame still in the FIFO is reached
+ *		             by dropping what comes before it. Otherwise decoding
+ *		             restarts at the last indexed page at least a long
+ *		             block short of the frame, or at the first audio page,
+ *		             if that is behind the frame or ahead of where decoding
+ *		             is; else it carries on from there. Packets well short
+ *		             of the frame are then only read far enough to learn
+ *		             their block size, and the block just before it is
+ *		             decoded in full so the first frame out overlaps
+ *		             correctly.
+ *		INPUTS: vb -- decoder state
+ *		        frame -- frame to go to
+ *		OUTPUTS: vb -- positioned at the frame
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: may reopen the file
+ */
+int32_t vorbis_seek(vorbis_t* vb, uint32_t frame) {
+
+    seek_point_t pt;
+    uint32_t n, back;
+
+    if (frame >= vb->out_pos && frame <= vb->out_pos + vb->count) {
+        n = frame - vb->out_pos;
+        vb->head = (vb->head + n) & FIFO_MASK;
+        vb->count -= n;
+        vb->out_pos = frame;
+        return 0;
+    }
+
+    /* the packet before the frame's can give at most half a long block
+     * of output, and has to be decoded for the overlap */
+    back = frame > vb->blocksize[1] / 2 ? frame - vb->blocksize[1] / 2 : 0;
+    if (seek_find(vb->idx, back, &pt) == -1) {
+        pt.sample = 0;
+        pt.offset = vb->first_page;
+    }
+
+    /* decoding only goes forward, and skips ahead when a point is past it */
+    if (frame < vb->out_pos || pt.sample > vb->decoded || vb->resync) {
+        if (ogg_jump(vb, pt.offset) == -1) return -1;
+        vb_restart(vb);
+        vb->decoded = pt.sample;
+        vb->resync = (pt.sample != 0);
+    }
+
+    /* empty the FIFO up to where a packet in progress will write */
+    vb->head = (vb->head + vb->count) & FIFO_MASK;
+    vb->count = 0;
+    vb->out_pos = frame;
+    vb->target = frame;
+
+    return 0;
+}
+
+
+/* vorbis_close
+ *
+ * 		DESCRIPTION: closes the file
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: closes a file descriptor
+ */
+void vorbis_close(vorbis_t* vb) {
+
+    ece391_close(vb->fd);
+}
+
+
+/* ogg_read
+ *
+ * 		DESCRIPTION: reads exactly len bytes
+ *		INPUTS: vb -- decoder state
+ *		        buf -- destination
+ *		        len -- number of bytes
+ *		OUTPUTS: buf -- bytes read
+ *		RETURN VALUE: 0 on success, -1 if the file ended first
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t ogg_read(vorbis_t* vb, uint8_t* buf, uint32_t len) {
+
+    int32_t got;
+
+    while (len) {
+        if ((got = ece391_read(vb->fd, buf, len)) <= 0) return -1;
+        buf += got;
+        len -= got;
+        vb->file_pos += got;
+    }
+
+    return 0;
+}
+
+
+/* ogg_skip
+ *
+ * 		DESCRIPTION: reads past bytes of the file, a page body at a time
+ *		INPUTS: vb -- decoder state
+ *		        len -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the file ended first
+ *		SIDE EFFECTS: advances the file, overwrites the page body
+ */
+static int32_t ogg_skip(vorbis_t* vb, uint32_t len) {
+
+    uint32_t n;
+
+    while (len) {
+        n = len < OGG_MAX_BODY ? len : OGG_MAX_BODY;
+        if (ogg_read(vb, vb->body, n) == -1) return -1;
+        len -= n;
+    }
+
+    return 0;
+}
+
+
+/* ogg_jump
+ *
+ * 		DESCRIPTION: moves to the start of a page. There's no seek call, so
+ *		             going back reopens the file, and either way the bytes
+ *		             before the page are read past without being parsed.
+ *		INPUTS: vb -- decoder state
+ *		        offset -- file offset of the page
+ *		OUTPUTS: vb -- next page read is the one at offset
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: may reopen the file
+ */
+static int32_t ogg_jump(vorbis_t* vb, uint32_t offset) {
+
+    if (offset < vb->file_pos) {
+        ece391_close(vb->fd);
+        if (-1 == (vb->fd = ece391_open(vb->fname))) return -1;
+        vb->file_pos = 0;
+    }
+
+    if (ogg_skip(vb, offset - vb->file_pos) == -1) return -1;
+    vb->seg = vb->nsegs = 0;
+
+    return 0;
+}
+
+
+/* ogg_page
+ *
+ * 		DESCRIPTION: reads the next page of the stream. Damage is skipped:
+ *		             the capture pattern is searched for a byte at a time,
+ *		             and pages failing their CRC or of another logical
+ *		             stream are passed over.
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- page flags, granule, offset, segment table and body
+ *		RETURN VALUE: 0 on success, -1 at the end of the file
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t ogg_page(vorbis_t* vb) {
+
+    uint8_t hdr[OGG_HDR_SIZE];
+    uint32_t i, size, stored, crc, start;
+
+    while (1) {
+        if (ogg_read(vb, hdr, sizeof(uint32_t)) == -1) return -1;
+        while (rd32(hdr) != OGG_ID) {
+            hdr[0] = hdr[1];
+            hdr[1] = hdr[2];
+            hdr[2] = hdr[3];
+            if (ogg_read(vb, hdr + 3, 1) == -1) return -1;
+        }
+        start = vb->file_pos - sizeof(uint32_t);
+
+        if (ogg_read(vb, hdr + sizeof(uint32_t), OGG_HDR_SIZE - sizeof(uint32_t)) == -1 ||
+                ogg_read(vb, vb->segs, hdr[26]) == -1)
+            return -1;
+        for (i = 0, size = 0; i < hdr[26]; i++) size += vb->segs[i];
+        if (ogg_read(vb, vb->body, size) == -1) return -1;
+
+        /* the CRC is taken with its own field zeroed */
+        stored = rd32(hdr + 22);
+        for (i = 22; i < 26; i++) hdr[i] = 0;
+        crc = ogg_crc(0, hdr, OGG_HDR_SIZE);
+        crc = ogg_crc(crc, vb->segs, hdr[26]);
+        crc = ogg_crc(crc, vb->body, size);
+        if (crc != stored) continue;
+
+        if (!vb->serial_known) {
+            vb->serial = rd32(hdr + 14);
+            vb->serial_known = 1;
+        } else if (rd32(hdr + 14) != vb->serial) {
+            continue;
+        }
+
+        /* a gap in the sequence means a page was lost */
+        vb->page_lost = (rd32(hdr + 18) != vb->page_seq);
+        vb->page_seq = rd32(hdr + 18) + 1;
+        vb->page_flags = hdr[5];
+        vb->page_granule = rd32(hdr + 6);
+        vb->page_offset = start;
+        vb->nsegs = hdr[26];
+        vb->seg = 0;
+        vb->body_pos = 0;
+        return 0;
+    }
+}
+
+
+/* ogg_packet
+ *
+ * 		DESCRIPTION: puts the next packet together from its segments,
+ *		             across pages as needed. A packet whose pages didn't
+ *		             all arrive is dropped, as is the tail of one that
+ *		             started before the stream was picked up.
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- packet, its length, whether it ended the page and
+ *		               whether it began on an earlier one
+ *		RETURN VALUE: 0 on success, -1 at the end of the file
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t ogg_packet(vorbis_t* vb) {
+
+    uint32_t len = 0, l, n, i;
+    int32_t started = 0, skipping = 0, split = 0;
+
+    while (1) {
+        while (vb->seg == vb->nsegs) {
+            if (ogg_page(vb) == -1) return -1;
+            split = started;
+
+            /* a packet broken by a lost page is dropped, and so is the
+             * rest of one that started before the stream was picked up */
+            if (started && (vb->page_lost || !(vb->page_flags & OGG_CONTINUED))) {
+                len = 0;
+                started = 0;
+                split = 0;
+            }
+            if (!started && (vb->page_flags & OGG_CONTINUED)) skipping = 1;
+        }
+
+        l = vb->segs[vb->seg++];
+        if (!skipping) {
+            /* anything past the buffer is cut off */
+            n = l < VORBIS_PACKET_SIZE - len ? l : VORBIS_PACKET_SIZE - len;
+            for (i = 0; i < n; i++) vb->packet[len + i] = vb->body[vb->body_pos + i];
+            len += n;
+            started = 1;
+        }
+        vb->body_pos += l;
+
+        if (l < OGG_SEG_SIZE) {
+            if (skipping) {
+                skipping = 0;
+                continue;
+            }
+            vb->packet_len = len;
+            vb->packet_last = (vb->seg == vb->nsegs);
+            vb->packet_split = split;
+            return 0;
+        }
+    }
+}
+
+
+/* ogg_crc
+ *
+ * 		DESCRIPTION: runs bytes through the Ogg CRC
+ *		INPUTS: crc -- CRC so far
+ *		        p -- bytes
+ *		        len -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: updated CRC
+ *		SIDE EFFECTS: none
+ */
+static uint32_t ogg_crc(uint32_t crc, const uint8_t* p, uint32_t len) {
+
+    while (len--) crc = (crc << 8) ^ crc_tab[(crc >> 24) ^ *p++];
+
+    return crc;
+}
+
+
+/* vb_peek
+ *
+ * 		DESCRIPTION: looks at the next 32 bits of the packet, first bit
+ *		             lowest, reading zeros past its end
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: none
+ *		RETURN VALUE: the bits
+ *		SIDE EFFECTS: none
+ */
+static uint32_t vb_peek(const vorbis_t* vb) {
+
+    uint32_t byte = vb->bit_pos >> 3;
+    uint32_t shift = vb->bit_pos & 7;
+    const uint8_t* p = vb->packet + byte;
+    uint32_t lo, hi, i;
+
+    if (byte + sizeof(uint32_t) < vb->packet_len) {
+        lo = rd32(p);
+        hi = p[4];
+    } else {
+        lo = hi = 0;
+        for (i = 0; i < sizeof(uint32_t) && byte + i < vb->packet_len; i++)
+            lo |= (uint32_t)p[i] << (8 * i);
+    }
+
+    return shift ? (lo >> shift) | (hi << (32 - shift)) : lo;
+}
+
+
+/* vb_bits
+ *
+ * 		DESCRIPTION: reads a field of the packet
+ *		INPUTS: vb -- decoder state
+ *		        n -- width of the field, up to 32 bits
+ *		OUTPUTS: vb -- read position moved on
+ *		RETURN VALUE: the field
+ *		SIDE EFFECTS: none
+ */
+static uint32_t vb_bits(vorbis_t* vb, uint32_t n) {
+
+    uint32_t val = vb_peek(vb);
+
+    vb->bit_pos += n;
+
+    return n < 32 ? val & ((1U << n) - 1) : val;
+}
+
+
+/* vb_eop
+ *
+ * 		DESCRIPTION: checks for reads past the end of the packet
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if the packet has run out, else 0
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_eop(const vorbis_t* vb) {
+
+    return vb->bit_pos > vb->packet_len * 8;
+}
+
+
+/* vb_ilog
+ *
+ * 		DESCRIPTION: bits needed to hold a value
+ *		INPUTS: x -- value
+ *		OUTPUTS: none
+ *		RETURN VALUE: position of the highest set bit, counting from 1
+ *		SIDE EFFECTS: none
+ */
+static uint32_t vb_ilog(uint32_t x) {
+
+    uint32_t r = 0;
+
+    while (x) {
+        r++;
+        x >>= 1;
+    }
+
+    return r;
+}
+
+
+/* vb_reverse
+ *
+ * 		DESCRIPTION: reverses the bits of a word
+ *		INPUTS: x -- word
+ *		OUTPUTS: none
+ *		RETURN VALUE: reversed word
+ *		SIDE EFFECTS: none
+ */
+static uint32_t vb_reverse(uint32_t x) {
+
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0F0F0F0F) | ((x & 0x0F0F0F0F) << 4);
+    x = ((x >> 8) & 0x00FF00FF) | ((x & 0x00FF00FF) << 8);
+
+    return (x >> 16) | (x << 16);
+}
+
+
+/* vb_alloc
+ *
+ * 		DESCRIPTION: takes word-aligned space for the setup from the arena
+ *		INPUTS: vb -- decoder state
+ *		        size -- bytes wanted
+ *		OUTPUTS: vb -- arena used
+ *		RETURN VALUE: the space, 0 if the arena is full
+ *		SIDE EFFECTS: none
+ */
+static void* vb_alloc(vorbis_t* vb, uint32_t size) {
+
+    void* p;
+
+    size = (size + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+    if (size > VORBIS_ARENA_SIZE - vb->arena_used) return 0;
+
+    p = vb->arena + vb->arena_used;
+    vb->arena_used += size;
+
+    return p;
+}
+
+
+/* vb_header
+ *
+ * 		DESCRIPTION: reads the next packet and checks it's a header of the
+ *		             type expected
+ *		INPUTS: vb -- decoder state
+ *		        type -- header packet type
+ *		OUTPUTS: vb -- packet, read position past the common header
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t vb_header(vorbis_t* vb, uint32_t type) {
+
+    uint32_t i;
+
+    if (ogg_packet(vb) == -1 || vb->packet_len < PKT_HDR_SIZE || vb->packet[0] != type)
+        return -1;
+    for (i = 0; i < VORBIS_STR_LEN; i++) {
+        if (vb->packet[i + 1] != vorbis_str[i]) return -1;
+    }
+    vb->bit_pos = PKT_HDR_SIZE * 8;
+
+    return 0;
+}
+
+
+/* vb_headers
+ *
+ * 		DESCRIPTION: reads the three header packets; the comments are
+ *		             skipped
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- format and setup
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t vb_headers(vorbis_t* vb) {
+
+    if (vb_header(vb, PKT_IDENT) == -1 || vb_ident(vb) == -1 ||
+            vb_header(vb, PKT_COMMENT) == -1 ||
+            vb_header(vb, PKT_SETUP) == -1 || vb_setup(vb) == -1)
+        return -1;
+
+    return 0;
+}
+
+
+/* vb_ident
+ *
+ * 		DESCRIPTION: reads the identification header
+ *		INPUTS: vb -- decoder state, at the header's fields
+ *		OUTPUTS: vb -- channels, rate and block sizes
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_ident(vorbis_t* vb) {
+
+    if (vb_bits(vb, 32) != 0) return -1;
+    vb->channels = vb_bits(vb, 8);
+    vb->sample_rate = vb_bits(vb, 32);
+    vb_bits(vb, 32);
+    vb_bits(vb, 32);
+    vb_bits(vb, 32);
+    vb->blocksize[0] = 1 << vb_bits(vb, 4);
+    vb->blocksize[1] = 1 << vb_bits(vb, 4);
+
+    if (!vb->channels || vb->channels > VORBIS_MAX_CHANNELS || !vb->sample_rate ||
+            vb->blocksize[0] < MIN_BLOCK || vb->blocksize[1] > VORBIS_MAX_BLOCK ||
+            vb->blocksize[0] > vb->blocksize[1] || !vb_bits(vb, 1) || vb_eop(vb))
+        return -1;
+
+    return 0;
+}
+
+
+/* vb_setup
+ *
+ * 		DESCRIPTION: reads the setup header: codebooks, time-domain
+ *		             transforms (placeholders), floors, residues, mappings
+ *		             and modes. Only floor 1 is taken; floor 0 has not been
+ *		             written by an encoder in a long time.
+ *		INPUTS: vb -- decoder state, at the header's fields
+ *		OUTPUTS: vb -- setup
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: fills the arena
+ */
+static int32_t vb_setup(vorbis_t* vb) {
+
+    uint32_t i, n;
+
+    vb->arena_used = 0;
+
+    vb->nbooks = vb_bits(vb, 8) + 1;
+    for (i = 0; i < vb->nbooks; i++) {
+        if (vb_book_read(vb, &vb->book[i]) == -1) return -1;
+    }
+
+    n = vb_bits(vb, 6) + 1;
+    for (i = 0; i < n; i++) {
+        if (vb_bits(vb, 16) != 0) return -1;
+    }
+
+    vb->nfloors = vb_bits(vb, 6) + 1;
+    for (i = 0; i < vb->nfloors; i++) {
+        if (vb_bits(vb, 16) != 1 || vb_floor_read(vb, &vb->floor[i]) == -1) return -1;
+    }
+
+    vb->nresidues = vb_bits(vb, 6) + 1;
+    for (i = 0; i < vb->nresidues; i++) {
+        if (vb_residue_read(vb, &vb->residue[i]) == -1) return -1;
+    }
+
+    vb->nmappings = vb_bits(vb, 6) + 1;
+    for (i = 0; i < vb->nmappings; i++) {
+        if (vb_bits(vb, 16) != 0 || vb_mapping_read(vb, &vb->mapping[i]) == -1) return -1;
+    }
+
+    vb->nmodes = vb_bits(vb, 6) + 1;
+    for (i = 0; i < vb->nmodes; i++) {
+        vb->mode[i].blockflag = vb_bits(vb, 1);
+        if (vb_bits(vb, 16) != 0 || vb_bits(vb, 16) != 0) return -1;
+        if ((vb->mode[i].mapping = vb_bits(vb, 8)) >= vb->nmappings) return -1;
+    }
+
+    if (!vb_bits(vb, 1) || vb_eop(vb)) return -1;
+
+    return 0;
+}
+
+
+/* vb_book_read
+ *
+ * 		DESCRIPTION: reads a codebook: its codeword lengths, in any of the
+ *		             three ways they can be packed, and its VQ lookup
+ *		INPUTS: vb -- decoder state, at the codebook
+ *		        bk -- codebook to fill in
+ *		OUTPUTS: bk -- decoding tables and vectors
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: fills the arena
+ */
+static int32_t vb_book_read(vorbis_t* vb, vb_book_t* bk) {
+
+    uint8_t* len;
+    uint32_t i, n, cur, l, sparse, lookup;
+
+    if (vb_bits(vb, 24) != BOOK_SYNC) return -1;
+    bk->dims = vb_bits(vb, 16);
+    bk->entries = vb_bits(vb, 24);
+    if (!bk->dims || !bk->entries || !(len = vb_alloc(vb, bk->entries))) return -1;
+
+    if (!vb_bits(vb, 1)) {
+        /* each entry's length, or whether it is used at all */
+        sparse = vb_bits(vb, 1);
+        for (i = 0; i < bk->entries; i++)
+            len[i] = (!sparse || vb_bits(vb, 1)) ? vb_bits(vb, 5) + 1 : 0;
+    } else {
+        /* runs of entries of each length, shortest first */
+        l = vb_bits(vb, 5) + 1;
+        for (cur = 0; cur < bk->entries; cur += n, l++) {
+            n = vb_bits(vb, vb_ilog(bk->entries - cur));
+            if (l > 32 || n > bk->entries - cur) return -1;
+            for (i = 0; i < n; i++) len[cur + i] = l;
+        }
+    }
+    if (vb_eop(vb) || vb_book_build(vb, bk, len) == -1) return -1;
+
+    bk->vq = 0;
+    if (!(lookup = vb_bits(vb, 4))) return 0;
+    if (lookup > 2) return -1;
+
+    return vb_book_vq(vb, bk, lookup);
+}
+
+
+/* vb_book_build
+ *
+ * 		DESCRIPTION: assigns codewords from their lengths, each the lowest
+ *		             free one of its length in entry order, as the format
+ *		             lays down. Codewords up to VB_FAST_BITS long fill every
+ *		             slot of a table indexed by the next bits of the packet
+ *		             that starts with them; longer ones go in a list sorted
+ *		             by codeword for a binary search. A book with a single
+ *		             entry decodes to it whatever the bits.
+ *		INPUTS: vb -- decoder state
+ *		        bk -- codebook
+ *		        len -- codeword length of each entry, 0 if unused
+ *		OUTPUTS: bk -- decoding tables
+ *		RETURN VALUE: 0 on success, -1 if the lengths overflow the tree
+ *		SIDE EFFECTS: fills the arena
+ */
+static int32_t vb_book_build(vorbis_t* vb, vb_book_t* bk, const uint8_t* len) {
+
+    uint32_t marker[33];
+    uint32_t i, j, l, code, next, used = 0, last = 0, nlong = 0;
+
+    for (i = 0; i < bk->entries; i++) {
+        if (!len[i]) continue;
+        used++;
+        last = i;
+        if (len[i] > VB_FAST_BITS) nlong++;
+    }
+
+    if (!(bk->fast = vb_alloc(vb, VB_FAST_SIZE * sizeof(int32_t))) ||
+            !(bk->long_code = vb_alloc(vb, nlong * sizeof(uint32_t))) ||
+            !(bk->long_entry = vb_alloc(vb, nlong * sizeof(uint32_t))))
+        return -1;
+
+    bk->nlong = 0;
+    for (i = 0; i < VB_FAST_SIZE; i++)
+        bk->fast[i] = (used == 1) ? (int32_t)((last << LEN_BITS) | len[last]) : -1;
+    if (used <= 1) return 0;
+
+    for (i = 0; i < 33; i++) marker[i] = 0;
+
+    for (i = 0; i < bk->entries; i++) {
+        if (!(l = len[i])) continue;
+
+        code = marker[l];
+        if (l < 32 && (code >> l)) return -1;
+
+        /* take the codeword, and move every length's next free one past
+         * the branch it used */
+        for (j = l; j > 0; j--) {
+            if (marker[j] & 1) {
+                if (j == 1) marker[1]++;
+                else marker[j] = marker[j - 1] << 1;
+                break;
+            }
+            marker[j]++;
+        }
+        next = code;
+        for (j = l + 1; j < 33; j++) {
+            if ((marker[j] >> 1) != next) break;
+            next = marker[j];
+            marker[j] = marker[j - 1] << 1;
+        }
+
+        if (l <= VB_FAST_BITS) {
+            for (j = vb_reverse(code) >> (32 - l); j < VB_FAST_SIZE; j += 1 << l)
+                bk->fast[j] = (i << LEN_BITS) | l;
+        } else {
+            bk->long_code[bk->nlong] = code << (32 - l);
+            bk->long_entry[bk->nlong++] = (i << LEN_BITS) | l;
+        }
+    }
+
+    vb_sort(bk->long_code, bk->long_entry, bk->nlong);
+
+    return 0;
+}
+
+
+/* vb_book_vq
+ *
+ * 		DESCRIPTION: reads a codebook's VQ lookup and expands it to a vector
+ *		             per entry. Type 1 lattices are spread out here so
+ *		             decoding never divides.
+ *		INPUTS: vb -- decoder state, at the lookup
+ *		        bk -- codebook
+ *		        lookup -- lookup type, 1 or 2
+ *		OUTPUTS: bk -- vectors in Q8
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: fills the arena
+ */
+static int32_t vb_book_vq(vorbis_t* vb, vb_book_t* bk, uint32_t lookup) {
+
+    uint16_t* mult;
+    int32_t min, delta;
+    int64_t val, last;
+    uint32_t nvals, width, seq, e, d, div, off, i;
+
+    min = vb_float(vb_bits(vb, 32));
+    delta = vb_float(vb_bits(vb, 32));
+    width = vb_bits(vb, 4) + 1;
+    seq = vb_bits(vb, 1);
+
+    if (bk->entries > VORBIS_ARENA_SIZE / sizeof(int32_t) / bk->dims) return -1;
+    nvals = (lookup == 1) ? vb_lookup1(bk->entries, bk->dims) : bk->entries * bk->dims;
+
+    if (!(mult = vb_alloc(vb, nvals * sizeof(uint16_t)))) return -1;
+    for (i = 0; i < nvals; i++) mult[i] = vb_bits(vb, width);
+    if (vb_eop(vb) || !(bk->vq = vb_alloc(vb, bk->entries * bk->dims * sizeof(int32_t))))
+        return -1;
+
+    for (e = 0; e < bk->entries; e++) {
+        last = 0;
+        div = 1;
+        for (d = 0; d < bk->dims; d++) {
+            if (lookup == 1) {
+                off = (e / div) % nvals;
+                if (div <= bk->entries) div *= nvals;
+            } else {
+                off = e * bk->dims + d;
+            }
+            val = (int64_t)mult[off] * delta + min + last;
+            if (val > VAL_MAX) val = VAL_MAX;
+            if (val < -VAL_MAX) val = -VAL_MAX;
+            if (seq) last = val;
+            bk->vq[e * bk->dims + d] = val;
+        }
+    }
+
+    return 0;
+}
+
+
+/* vb_lookup1
+ *
+ * 		DESCRIPTION: number of values per dimension of a type 1 lattice,
+ *		             the largest whose dims-th power fits in the entries
+ *		INPUTS: entries -- entries in the codebook
+ *		        dims -- dimensions of each vector
+ *		OUTPUTS: none
+ *		RETURN VALUE: values per dimension
+ *		SIDE EFFECTS: none
+ */
+static uint32_t vb_lookup1(uint32_t entries, uint32_t dims) {
+
+    uint32_t r = 1, i;
+    uint64_t p;
+
+    while (1) {
+        for (i = 0, p = 1; i < dims && p <= entries; i++) p *= r + 1;
+        if (p > entries) return r;
+        r++;
+    }
+}
+
+
+/* vb_float
+ *
+ * 		DESCRIPTION: unpacks one of the setup's 32-bit floats, a 21-bit
+ *		             mantissa and a biased exponent, to Q8
+ *		INPUTS: x -- packed float
+ *		OUTPUTS: none
+ *		RETURN VALUE: value in Q8, saturated
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_float(uint32_t x) {
+
+    int32_t mant = x & 0x1FFFFF;
+    int32_t exp = (int32_t)((x >> 21) & 0x3FF) - 788 + VB_RES_SHIFT;
+
+    if (exp > 9) mant = VAL_MAX;
+    else if (exp >= 0) mant <<= exp;
+    else if (exp > -32) mant >>= -exp;
+    else mant = 0;
+
+    return (x & 0x80000000) ? -mant : mant;
+}
+
+
+/* vb_sort
+ *
+ * 		DESCRIPTION: Shell sort of keys, carrying values along
+ *		INPUTS: key -- keys
+ *		        val -- values
+ *		        n -- number of pairs
+ *		OUTPUTS: key, val -- in ascending order of key
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_sort(uint32_t* key, uint32_t* val, uint32_t n) {
+
+    uint32_t gap, i, j, k, v;
+
+    for (gap = n / 2; gap; gap /= 2) {
+        for (i = gap; i < n; i++) {
+            k = key[i];
+            v = val[i];
+            for (j = i; j >= gap && key[j - gap] > k; j -= gap) {
+                key[j] = key[j - gap];
+                val[j] = val[j - gap];
+            }
+            key[j] = k;
+            val[j] = v;
+        }
+    }
+}
+
+
+/* vb_floor_read
+ *
+ * 		DESCRIPTION: reads a floor 1 and works out the order of its points
+ *		             along the spectrum and each point's neighbours
+ *		INPUTS: vb -- decoder state, at the floor
+ *		        fl -- floor to fill in
+ *		OUTPUTS: fl -- partitions, classes and points
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_floor_read(vorbis_t* vb, vb_floor_t* fl) {
+
+    uint32_t i, j, c, p, rb, lo, hi;
+    uint32_t classes = 0;
+
+    fl->parts = vb_bits(vb, 5);
+    for (p = 0; p < fl->parts; p++) {
+        fl->part_class[p] = vb_bits(vb, 4);
+        if (fl->part_class[p] >= classes) classes = fl->part_class[p] + 1;
+    }
+
+    for (c = 0; c < classes; c++) {
+        fl->class_dims[c] = vb_bits(vb, 3) + 1;
+        fl->class_subs[c] = vb_bits(vb, 2);
+        if (fl->class_subs[c] && (fl->class_book[c] = vb_bits(vb, 8)) >= vb->nbooks) return -1;
+        for (j = 0; j < (1U << fl->class_subs[c]); j++) {
+            fl->sub_book[c][j] = (int16_t)vb_bits(vb, 8) - 1;
+            if (fl->sub_book[c][j] >= (int32_t)vb->nbooks) return -1;
+        }
+    }
+
+    fl->mult = vb_bits(vb, 2) + 1;
+    rb = vb_bits(vb, 4);
+    fl->x[0] = 0;
+    fl->x[1] = 1 << rb;
+    fl->values = 2;
+    for (p = 0; p < fl->parts; p++) {
+        for (j = 0; j < fl->class_dims[fl->part_class[p]]; j++) {
+            if (fl->values == FLOOR1_MAX_VALUES) return -1;
+            fl->x[fl->values++] = vb_bits(vb, rb);
+        }
+    }
+
+    /* sorted by x, which must not repeat */
+    for (i = 0; i < fl->values; i++) {
+        for (j = i; j > 0 && fl->x[fl->sorted[j - 1]] > fl->x[i]; j--)
+            fl->sorted[j] = fl->sorted[j - 1];
+        fl->sorted[j] = i;
+    }
+    for (i = 1; i < fl->values; i++) {
+        if (fl->x[fl->sorted[i]] == fl->x[fl->sorted[i - 1]]) return -1;
+    }
+
+    /* each point is predicted from the closest earlier points either
+     * side of it */
+    for (i = 2; i < fl->values; i++) {
+        lo = 0;
+        hi = 1;
+        for (j = 2; j < i; j++) {
+            if (fl->x[j] < fl->x[i] && fl->x[j] > fl->x[lo]) lo = j;
+            if (fl->x[j] > fl->x[i] && fl->x[j] < fl->x[hi]) hi = j;
+        }
+        fl->lo[i] = lo;
+        fl->hi[i] = hi;
+    }
+
+    return vb_eop(vb) ? -1 : 0;
+}
+
+
+/* vb_residue_read
+ *
+ * 		DESCRIPTION: reads a residue setup, with the books of each class
+ *		             and pass
+ *		INPUTS: vb -- decoder state, at the residue
+ *		        r -- residue to fill in
+ *		OUTPUTS: r -- range, partitions and books
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_residue_read(vorbis_t* vb, vb_residue_t* r) {
+
+    uint8_t cascade[RESIDUE_MAX_CLASSES];
+    uint32_t c, pass, b;
+
+    if ((r->type = vb_bits(vb, 16)) > 2) return -1;
+    r->begin = vb_bits(vb, 24);
+    r->end = vb_bits(vb, 24);
+    r->psize = vb_bits(vb, 24) + 1;
+    r->classes = vb_bits(vb, 6) + 1;
+    if ((r->classbook = vb_bits(vb, 8)) >= vb->nbooks) return -1;
+
+    for (c = 0; c < r->classes; c++) {
+        cascade[c] = vb_bits(vb, 3);
+        if (vb_bits(vb, 1)) cascade[c] |= vb_bits(vb, 5) << 3;
+    }
+
+    for (c = 0; c < r->classes; c++) {
+        for (pass = 0; pass < RESIDUE_PASSES; pass++) {
+            r->book[c][pass] = -1;
+            if (!(cascade[c] & (1 << pass))) continue;
+            /* a residue book has to have vectors */
+            if ((b = vb_bits(vb, 8)) >= vb->nbooks || !vb->book[b].vq) return -1;
+            r->book[c][pass] = b;
+        }
+    }
+
+    return vb_eop(vb) ? -1 : 0;
+}
+
+
+/* vb_mapping_read
+ *
+ * 		DESCRIPTION: reads a mapping: the channel coupling steps and which
+ *		             floor and residue each submap uses
+ *		INPUTS: vb -- decoder state, at the mapping
+ *		        map -- mapping to fill in
+ *		OUTPUTS: map -- coupling and submaps
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_mapping_read(vorbis_t* vb, vb_mapping_t* map) {
+
+    uint32_t i, bits = vb_ilog(vb->channels - 1);
+
+    map->submaps = vb_bits(vb, 1) ? vb_bits(vb, 4) + 1 : 1;
+
+    map->coupling = 0;
+    if (vb_bits(vb, 1)) {
+        if ((map->coupling = vb_bits(vb, 8) + 1) > VORBIS_MAX_COUPLING) return -1;
+        for (i = 0; i < map->coupling; i++) {
+            map->mag[i] = vb_bits(vb, bits);
+            map->ang[i] = vb_bits(vb, bits);
+            if (map->mag[i] == map->ang[i] || map->mag[i] >= vb->channels ||
+                    map->ang[i] >= vb->channels)
+                return -1;
+        }
+    }
+
+    if (vb_bits(vb, 2) != 0) return -1;
+
+    for (i = 0; i < vb->channels; i++) {
+        map->mux[i] = (map->submaps > 1) ? vb_bits(vb, 4) : 0;
+        if (map->mux[i] >= map->submaps) return -1;
+    }
+
+    for (i = 0; i < map->submaps; i++) {
+        vb_bits(vb, 8);
+        if ((map->floor[i] = vb_bits(vb, 8)) >= vb->nfloors ||
+                (map->residue[i] = vb_bits(vb, 8)) >= vb->nresidues)
+            return -1;
+    }
+
+    return vb_eop(vb) ? -1 : 0;
+}
+
+
+/* vb_tables
+ *
+ * 		DESCRIPTION: builds the transform tables for both block sizes: the
+ *		             twiddles either side of the quarter-length FFT, the
+ *		             FFT's own, and the window slope
+ *		             sin(pi/2 sin^2((i + 1/2) / L pi/2)) over half a block
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- tables in Q30
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_tables(vorbis_t* vb) {
+
+    uint32_t b, k, n, lg;
+    int32_t s, c;
+
+    for (b = 0; b < 2; b++) {
+        n = vb->blocksize[b];
+        lg = vb_ilog(n) - 1;
+
+        /* exp(-j 2 pi (k + 1/8) / n) */
+        for (k = 0; k < n / 4; k++)
+            fix_sincos((8 * k + 1) << (29 - lg), &vb->pre_sin[b][k], &vb->pre_cos[b][k]);
+
+        /* exp(-j 2 pi k / (n / 4)) */
+        for (k = 0; k < n / 8; k++)
+            fix_sincos(k << (34 - lg), &vb->fft_sin[b][k], &vb->fft_cos[b][k]);
+
+        /* the squared sine is already in quarter turns */
+        for (k = 0; k < n / 2; k++) {
+            fix_sincos((2 * k + 1) << (30 - lg), &s, &c);
+            fix_sincos((uint32_t)(((int64_t)s * s) >> Q30_SHIFT), &vb->slope[b][k], &c);
+        }
+    }
+}
+
+
+/* vb_restart
+ *
+ * 		DESCRIPTION: starts decoding afresh at the first audio packet
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- empty, at position 0
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_restart(vorbis_t* vb) {
+
+    vb->stage = VB_PACKET;
+    vb->last_n = 0;
+    vb->have_overlap = 0;
+    vb->decoded = 0;
+    vb->resync = 0;
+    vb->target = 0;
+    vb->end = END_UNKNOWN;
+    vb->head = 0;
+    vb->count = 0;
+    vb->out_pos = 0;
+}
+
+
+/* vb_unit
+ *
+ * 		DESCRIPTION: does the next unit of decoding: reading and parsing a
+ *		             packet, or synthesizing one channel of it and, after
+ *		             the last, handing its output to the FIFO
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- next stage
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: may advance the file
+ */
+static void vb_unit(vorbis_t* vb) {
+
+    if (vb->stage == VB_PACKET) {
+        vb_packet(vb);
+    } else if (vb->stage == VB_SYNTH) {
+        vb_synth(vb, vb->chan);
+        if (++vb->chan == vb->channels) {
+            vb_commit(vb);
+            vb->stage = VB_PACKET;
+        }
+    }
+}
+
+
+/* vb_decode
+ *
+ * 		DESCRIPTION: decodes one codeword. Short ones are a table lookup on
+ *		             the next bits; for longer ones, the next 32 bits are
+ *		             turned round to read as a codeword and the last listed
+ *		             codeword not above them is the only one that can match.
+ *		INPUTS: vb -- decoder state
+ *		        bk -- codebook
+ *		OUTPUTS: vb -- read position past the codeword
+ *		RETURN VALUE: entry, -1 if invalid or past the end of the packet
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_decode(vorbis_t* vb, const vb_book_t* bk) {
+
+    uint32_t x = vb_peek(vb);
+    int32_t e = bk->fast[x & (VB_FAST_SIZE - 1)];
+    int32_t lo, hi, mid;
+    uint32_t len;
+
+    if (e < 0) {
+        if (!bk->nlong) return -1;
+        x = vb_reverse(x);
+        lo = 0;
+        hi = bk->nlong - 1;
+        while (lo < hi) {
+            mid = (lo + hi + 1) >> 1;
+            if (bk->long_code[mid] <= x) lo = mid;
+            else hi = mid - 1;
+        }
+        len = bk->long_entry[lo] & LEN_MASK;
+        if ((x ^ bk->long_code[lo]) >> (32 - len)) return -1;
+        e = bk->long_entry[lo];
+    }
+
+    vb->bit_pos += e & LEN_MASK;
+
+    return vb_eop(vb) ? -1 : e >> LEN_BITS;
+}
+
+
+/* vb_packet
+ *
+ * 		DESCRIPTION: reads the next audio packet and decodes everything but
+ *		             the synthesis: block size and window shape, each
+ *		             channel's floor, the residues and the channel
+ *		             coupling. While seeking, a packet whose output is all
+ *		             short of the target, and the next one's too, is only
+ *		             read as far as its block size.
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- spectra and floors, or VB_END at the end of the file
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: advances the file
+ */
+static void vb_packet(vorbis_t* vb) {
+
+    const vb_mapping_t* map;
+    uint32_t chans[VORBIS_MAX_CHANNELS], nonzero[VORBIS_MAX_CHANNELS];
+    uint32_t m, n, c, s, i, nch, after;
+
+    if (ogg_packet(vb) == -1) {
+        vb->stage = VB_END;
+        return;
+    }
+    vb->bit_pos = 0;
+
+    /* the last page's granule position is the length of the stream */
+    if (vb->packet_last && (vb->page_flags & OGG_EOS)) vb->end = vb->page_granule;
+
+    /* headers and empty packets have no audio */
+    if (!vb->packet_len || vb_bits(vb, 1)) return;
+    if ((m = vb_bits(vb, vb_ilog(vb->nmodes - 1))) >= vb->nmodes) return;
+
+    vb->blockflag = vb->mode[m].blockflag;
+    vb->map = vb->mode[m].mapping;
+    n = vb->blocksize[vb->blockflag];
+    vb->prev_long = vb->next_long = 0;
+    if (vb->blockflag) {
+        vb->prev_long = vb_bits(vb, 1);
+        vb->next_long = vb_bits(vb, 1);
+    }
+
+    /* after a jump to an indexed page, packets are only read for their
+     * block size up to the one that ends it, where the index point is */
+    if (vb->resync) {
+        vb->last_n = n;
+        if (vb->packet_last && !vb->packet_split) vb->resync = 0;
+        return;
+    }
+
+    /* a block's output runs from the middle of the one before to its own
+     * middle, and the first block has none */
+    after = vb->last_n ? vb->decoded + vb->last_n / 4 + n / 4 : 0;
+
+    /* a packet that begins and ends a page is read again by a jump to the
+     * page, so its end is a point to seek from */
+    if (vb->packet_last && !vb->packet_split) seek_add(vb->idx, after, vb->page_offset);
+    if (vb->target >= after + n / 4 + vb->blocksize[1] / 4) {
+        vb->decoded = after;
+        vb->last_n = n;
+        vb->have_overlap = 0;
+        return;
+    }
+
+    vb->n = n;
+    vb->out_start = vb->decoded;
+    vb->out_len = vb->have_overlap ? after - vb->decoded : 0;
+    vb->decoded = after;
+    vb->wr = (vb->head + vb->count) & FIFO_MASK;
+
+    map = &vb->mapping[vb->map];
+
+    for (c = 0; c < vb->channels; c++) {
+        vb->floor_used[c] = vb_floor_decode(vb, &vb->floor[map->floor[map->mux[c]]],
+                                            vb->floor_y[c]);
+        nonzero[c] = vb->floor_used[c];
+        for (i = 0; i < n / 2; i++) vb->res[c][i] = 0;
+    }
+
+    /* coupled channels are decoded if either has a floor */
+    for (i = 0; i < map->coupling; i++) {
+        if (nonzero[map->mag[i]] || nonzero[map->ang[i]])
+            nonzero[map->mag[i]] = nonzero[map->ang[i]] = 1;
+    }
+
+    for (s = 0; s < map->submaps; s++) {
+        for (c = 0, nch = 0; c < vb->channels; c++) {
+            if (map->mux[c] == s) {
+                nonzero[nch] = nonzero[c];
+                chans[nch++] = c;
+            }
+        }
+        vb_residue_decode(vb, &vb->residue[map->residue[s]], chans, nch, nonzero);
+    }
+
+    vb_couple(vb, map);
+
+    vb->stage = VB_SYNTH;
+    vb->chan = 0;
+}
+
+
+/* vb_floor_decode
+ *
+ * 		DESCRIPTION: reads a channel's floor 1 points
+ *		INPUTS: vb -- decoder state
+ *		        fl -- floor setup
+ *		        y -- point values
+ *		OUTPUTS: y -- values as coded, before prediction
+ *		RETURN VALUE: 1 if the channel is used, 0 if it is silent or its
+ *		              floor was cut off
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_floor_decode(vorbis_t* vb, const vb_floor_t* fl, int32_t* y) {
+
+    uint32_t bits = vb_ilog(floor1_range[fl->mult - 1] - 1);
+    uint32_t p, c, j, cbits, off = 2;
+    int32_t cval, b;
+
+    if (!vb_bits(vb, 1)) return 0;
+
+    y[0] = vb_bits(vb, bits);
+    y[1] = vb_bits(vb, bits);
+
+    for (p = 0; p < fl->parts; p++) {
+        c = fl->part_class[p];
+        cbits = fl->class_subs[c];
+        cval = 0;
+        if (cbits && (cval = vb_decode(vb, &vb->book[fl->class_book[c]])) < 0) return 0;
+        for (j = 0; j < fl->class_dims[c]; j++) {
+            b = fl->sub_book[c][cval & ((1 << cbits) - 1)];
+            cval >>= cbits;
+            if (b < 0) y[off++] = 0;
+            else if ((y[off++] = vb_decode(vb, &vb->book[b])) < 0) return 0;
+        }
+    }
+
+    return !vb_eop(vb);
+}
+
+
+/* vb_residue_decode
+ *
+ * 		DESCRIPTION: decodes a residue into the channels of a submap. Each
+ *		             partition's class comes from the class book, several
+ *		             partitions to a codeword, and each of up to eight
+ *		             passes adds the vectors of that class's book for the
+ *		             pass. Type 2 codes the channels interleaved as one
+ *		             vector. Running out of packet ends the decode with
+ *		             whatever has been added so far.
+ *		INPUTS: vb -- decoder state
+ *		        r -- residue setup
+ *		        chans -- channels of the submap
+ *		        nch -- number of them, 1 or 2
+ *		        nonzero -- 1 for each of them that is coded
+ *		OUTPUTS: vb -- residues added in
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_residue_decode(vorbis_t* vb, const vb_residue_t* r, const uint32_t* chans,
+                              uint32_t nch, const uint32_t* nonzero) {
+
+    const vb_book_t* cb = &vb->book[r->classbook];
+    uint32_t size = (r->type == 2) ? vb->n / 2 * nch : vb->n / 2;
+    uint32_t vecs = (r->type == 2) ? 1 : nch;
+    uint32_t begin = r->begin < size ? r->begin : size;
+    uint32_t end = r->end < size ? r->end : size;
+    uint32_t parts = (end - begin) / r->psize;
+    uint32_t coded[VORBIS_MAX_CHANNELS];
+    uint32_t pass, pc, i, j, k;
+    int32_t t, b;
+
+    for (j = 0; j < nch; j++) coded[j] = nonzero[j];
+    /* one vector, coded if any of its channels is */
+    if (r->type == 2) {
+        for (j = 1; j < nch; j++) coded[0] |= coded[j];
+    }
+
+    for (pass = 0; pass < RESIDUE_PASSES; pass++) {
+        for (pc = 0; pc < parts;) {
+            if (!pass) {
+                for (j = 0; j < vecs; j++) {
+                    if (!coded[j]) continue;
+                    if ((t = vb_decode(vb, cb)) < 0) return;
+                    for (i = cb->dims; i-- > 0;) {
+                        if (pc + i < parts) vb->cls[j][pc + i] = t % r->classes;
+                        t /= r->classes;
+                    }
+                }
+            }
+            for (k = 0; k < cb->dims && pc < parts; k++, pc++) {
+                for (j = 0; j < vecs; j++) {
+                    if (!coded[j] || (b = r->book[vb->cls[j][pc]][pass]) < 0) continue;
+                    if (vb_residue_part(vb, r, &vb->book[b], chans, nch, j,
+                                        begin + pc * r->psize) == -1)
+                        return;
+                }
+            }
+        }
+    }
+}
+
+
+/* vb_residue_part
+ *
+ * 		DESCRIPTION: adds one partition's vectors into a residue. Type 0
+ *		             spreads each vector's values a step apart through the
+ *		             partition; types 1 and 2 lay them end to end. With
+ *		             two channels, type 2's even positions are the first
+ *		             channel and its odd ones the second.
+ *		INPUTS: vb -- decoder state
+ *		        r -- residue setup
+ *		        bk -- book of the partition's class and pass
+ *		        chans -- channels of the submap
+ *		        nch -- number of them
+ *		        j -- vector being decoded
+ *		        off -- start of the partition in it
+ *		OUTPUTS: vb -- residue added to
+ *		RETURN VALUE: 0 on success, -1 when the packet runs out
+ *		SIDE EFFECTS: none
+ */
+static int32_t vb_residue_part(vorbis_t* vb, const vb_residue_t* r, const vb_book_t* bk,
+                               const uint32_t* chans, uint32_t nch, uint32_t j,
+                               uint32_t off) {
+
+    uint32_t dims = bk->dims, psize = r->psize;
+    uint32_t i, d, p, step, shift = nch - 1;
+    int32_t* dst = vb->res[chans[j]];
+    const int32_t* v;
+    int32_t e;
+
+    if (r->type == 0) {
+        step = psize / dims;
+        for (i = 0; i < step; i++) {
+            if ((e = vb_decode(vb, bk)) < 0) return -1;
+            v = bk->vq + e * dims;
+            for (d = 0; d < dims; d++) dst[off + i + d * step] += v[d];
+        }
+    } else if (r->type == 1) {
+        for (i = 0; i < psize;) {
+            if ((e = vb_decode(vb, bk)) < 0) return -1;
+            v = bk->vq + e * dims;
+            for (d = 0; d < dims && i < psize; d++) dst[off + i++] += v[d];
+        }
+    } else {
+        for (i = 0; i < psize;) {
+            if ((e = vb_decode(vb, bk)) < 0) return -1;
+            v = bk->vq + e * dims;
+            for (d = 0; d < dims && i < psize; d++) {
+                p = off + i++;
+                vb->res[chans[p & shift]][p >> shift] += v[d];
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+/* vb_couple
+ *
+ * 		DESCRIPTION: undoes the square polar coupling of channel pairs,
+ *		             last step first
+ *		INPUTS: vb -- decoder state
+ *		        map -- mapping of the packet
+ *		OUTPUTS: vb -- residues of each channel
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_couple(vorbis_t* vb, const vb_mapping_t* map) {
+
+    uint32_t i, k;
+    int32_t* mag;
+    int32_t* ang;
+    int32_t m, a;
+
+    for (i = map->coupling; i-- > 0;) {
+        mag = vb->res[map->mag[i]];
+        ang = vb->res[map->ang[i]];
+        for (k = 0; k < vb->n / 2; k++) {
+            m = mag[k];
+            a = ang[k];
+            if (m > 0) {
+                if (a > 0) ang[k] = m - a;
+                else { ang[k] = m; mag[k] = m + a; }
+            } else {
+                if (a > 0) ang[k] = m + a;
+                else { ang[k] = m; mag[k] = m - a; }
+            }
+        }
+    }
+}
+
+
+/* vb_synth
+ *
+ * 		DESCRIPTION: turns one channel of the packet into PCM: the floor
+ *		             curve times the residue gives the spectrum, the inverse
+ *		             MDCT and window give the block, and its first half
+ *		             overlapped with the last block's second half goes into
+ *		             the FIFO. The second half is kept for the next block.
+ *		INPUTS: vb -- decoder state
+ *		        c -- channel
+ *		OUTPUTS: vb -- channel's output in the FIFO past what's committed
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_synth(vorbis_t* vb, uint32_t c) {
+
+    const vb_mapping_t* map = &vb->mapping[vb->map];
+    uint32_t n = vb->n, ch = vb->channels;
+    uint32_t prev = vb->last_n / 2;
+    int32_t st = (int32_t)(n / 4) - (int32_t)(vb->last_n / 4);
+    int32_t* spec = vb->res[c];
+    int32_t* y = vb->buf;
+    int32_t* ov = vb->overlap[c];
+    int32_t p, s;
+    uint32_t j;
+
+    if (vb->floor_used[c]) {
+        vb_floor_curve(&vb->floor[map->floor[map->mux[c]]], vb->floor_y[c], spec, n / 2);
+    } else {
+        for (j = 0; j < n / 2; j++) spec[j] = 0;
+    }
+
+    vb_imdct(vb, spec, y);
+    vb_window(vb, y);
+
+    for (j = 0; j < vb->out_len; j++) {
+        s = j < prev ? ov[j] : 0;
+        p = st + (int32_t)j;
+        if (p >= 0 && p < (int32_t)n) s += y[p];
+        vb->fifo[((vb->wr + j) & FIFO_MASK) * ch + c] =
+            fix_sat16((s + (1 << (OUT_SHIFT - 1))) >> OUT_SHIFT);
+    }
+
+    for (j = 0; j < n / 2; j++) ov[j] = y[n / 2 + j];
+}
+
+
+/* vb_floor_curve
+ *
+ * 		DESCRIPTION: synthesizes a floor 1 curve and multiplies it into the
+ *		             residue. Each point is coded as an offset from the
+ *		             line between its neighbours; points that moved, and
+ *		             the neighbours they moved from, are joined with lines
+ *		             of amplitude steps, 0.55 dB each.
+ *		INPUTS: fl -- floor setup
+ *		        y -- coded point values
+ *		        spec -- residue of the channel, Q8
+ *		        n2 -- spectrum length
+ *		OUTPUTS: y -- final point values
+ *		         spec -- spectrum, Q20
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_floor_curve(const vb_floor_t* fl, int32_t* y, int32_t* spec, uint32_t n2) {
+
+    uint8_t step2[FLOOR1_MAX_VALUES];
+    int32_t range = floor1_range[fl->mult - 1];
+    int32_t lo, hi, dy, adx, off, pred, val, high, low, room;
+    int32_t lx, ly, hx, hy;
+    uint32_t i;
+
+    step2[0] = step2[1] = 1;
+    for (i = 2; i < fl->values; i++) {
+        lo = fl->lo[i];
+        hi = fl->hi[i];
+
+        dy = y[hi] - y[lo];
+        adx = fl->x[hi] - fl->x[lo];
+        off = (dy < 0 ? -dy : dy) * (fl->x[i] - fl->x[lo]) / adx;
+        pred = dy < 0 ? y[lo] - off : y[lo] + off;
+
+        val = y[i];
+        high = range - pred;
+        low = pred;
+        room = (high < low ? high : low) * 2;
+
+        step2[i] = 0;
+        if (val) {
+            step2[lo] = step2[hi] = step2[i] = 1;
+            if (val >= room) y[i] = high > low ? val - low + pred : pred - val + high - 1;
+            else y[i] = (val & 1) ? pred - (val + 1) / 2 : pred + val / 2;
+        } else {
+            y[i] = pred;
+        }
+    }
+
+    lx = 0;
+    ly = hy = y[fl->sorted[0]] * fl->mult;
+    hx = 0;
+    for (i = 1; i < fl->values; i++) {
+        if (!step2[fl->sorted[i]]) continue;
+        hx = fl->x[fl->sorted[i]];
+        hy = y[fl->sorted[i]] * fl->mult;
+        vb_render_line(lx, ly, hx, hy, spec, n2);
+        lx = hx;
+        ly = hy;
+    }
+    if ((uint32_t)hx < n2) vb_render_line(hx, hy, n2, hy, spec, n2);
+}
+
+
+/* vb_render_line
+ *
+ * 		DESCRIPTION: draws a floor line from (x0, y0) up to but not
+ *		             including x1 with the format's integer steps, and
+ *		             multiplies each amplitude into the spectrum
+ *		INPUTS: x0, y0 -- start
+ *		        x1, y1 -- end
+ *		        spec -- residue, Q8
+ *		        n2 -- spectrum length; the line stops there
+ *		OUTPUTS: spec -- Q20 over the line
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_render_line(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                           int32_t* spec, uint32_t n2) {
+
+    int32_t dy = y1 - y0, adx = x1 - x0;
+    int32_t base = dy / adx;
+    int32_t ady = (dy < 0 ? -dy : dy) - (base < 0 ? -base : base) * adx;
+    int32_t sy = dy < 0 ? base - 1 : base + 1;
+    int32_t x, y = y0, err = 0, end = x1 < (int32_t)n2 ? x1 : (int32_t)n2;
+    int64_t v;
+
+    for (x = x0; x < end; x++) {
+        if (x > x0) {
+            err += ady;
+            if (err >= adx) {
+                err -= adx;
+                y += sy;
+            } else {
+                y += base;
+            }
+        }
+        v = ((int64_t)spec[x] * inv_db[y < 0 ? 0 : (y > 255 ? 255 : y)] + FLOOR_HALF) >>
+            FLOOR_SHIFT;
+        spec[x] = v > SPEC_MAX ? SPEC_MAX : (v < -SPEC_MAX ? -SPEC_MAX : v);
+    }
+}
+
+
+/* vb_imdct
+ *
+ * 		DESCRIPTION: inverse MDCT of a block through a complex FFT a
+ *		             quarter of its length: the spectrum's even and
+ *		             reversed odd coefficients are paired into complex
+ *		             values, turned by exp(-j 2 pi (k + 1/8) / n) before
+ *		             and after the FFT, and the real and imaginary parts
+ *		             of the result unfold into the four quarters of the
+ *		             block with the signs of the transform's symmetries
+ *		INPUTS: vb -- decoder state, with the block size set
+ *		        x -- spectrum, half a block, Q20
+ *		        y -- output
+ *		OUTPUTS: y -- the block, Q20
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: uses the FFT buffer
+ */
+static void vb_imdct(vorbis_t* vb, const int32_t* x, int32_t* y) {
+
+    uint32_t b = vb->blockflag, n = vb->n;
+    uint32_t q = n / 4, h = n / 8, k, m;
+    const int32_t* c = vb->pre_cos[b];
+    const int32_t* s = vb->pre_sin[b];
+    int32_t* a = vb->fft;
+    int32_t re, im;
+
+    for (k = 0; k < q; k++) {
+        re = x[2 * k];
+        im = x[n / 2 - 1 - 2 * k];
+        a[2 * k] = ((int64_t)re * c[k] + (int64_t)im * s[k] + Q30_HALF) >> Q30_SHIFT;
+        a[2 * k + 1] = ((int64_t)im * c[k] - (int64_t)re * s[k] + Q30_HALF) >> Q30_SHIFT;
+    }
+
+    vb_fft(vb, a, q);
+
+    for (k = 0; k < q; k++) {
+        re = a[2 * k];
+        im = a[2 * k + 1];
+        a[2 * k] = ((int64_t)re * c[k] + (int64_t)im * s[k] + Q30_HALF) >> Q30_SHIFT;
+        a[2 * k + 1] = ((int64_t)im * c[k] - (int64_t)re * s[k] + Q30_HALF) >> Q30_SHIFT;
+    }
+
+    for (m = 0; m < h; m++) {
+        y[2 * m] = a[2 * (h + m)];
+        y[2 * m + 1] = -a[2 * (h - 1 - m) + 1];
+        y[q + 2 * m] = a[2 * m + 1];
+        y[q + 2 * m + 1] = -a[2 * (q - 1 - m)];
+        y[2 * q + 2 * m] = a[2 * (h + m) + 1];
+        y[2 * q + 2 * m + 1] = -a[2 * (h - 1 - m)];
+        y[3 * q + 2 * m] = -a[2 * m];
+        y[3 * q + 2 * m + 1] = a[2 * (q - 1 - m) + 1];
+    }
+}
+
+
+/* vb_fft
+ *
+ * 		DESCRIPTION: in-place radix-2 forward FFT
+ *		INPUTS: vb -- decoder state, with the block size set
+ *		        a -- interleaved complex values
+ *		        q -- number of them, a quarter of the block
+ *		OUTPUTS: a -- transform, unscaled
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_fft(const vorbis_t* vb, int32_t* a, uint32_t q) {
+
+    const int32_t* wc = vb->fft_cos[vb->blockflag];
+    const int32_t* ws = vb->fft_sin[vb->blockflag];
+    uint32_t i, j, bit, len, half, step, k;
+    int32_t t, c, s, tr, ti, *u, *v;
+
+    /* bit-reversed order */
+    for (i = 0, j = 0; i < q; i++) {
+        if (i < j) {
+            t = a[2 * i];
+            a[2 * i] = a[2 * j];
+            a[2 * j] = t;
+            t = a[2 * i + 1];
+            a[2 * i + 1] = a[2 * j + 1];
+            a[2 * j + 1] = t;
+        }
+        for (bit = q >> 1; j & bit; bit >>= 1) j ^= bit;
+        j |= bit;
+    }
+
+    for (len = 2, step = q / 2; len <= q; len <<= 1, step >>= 1) {
+        half = len / 2;
+        for (i = 0; i < q; i += len) {
+            for (k = 0; k < half; k++) {
+                u = a + 2 * (i + k);
+                v = u + 2 * half;
+                c = wc[k * step];
+                s = ws[k * step];
+                tr = ((int64_t)v[0] * c + (int64_t)v[1] * s + Q30_HALF) >> Q30_SHIFT;
+                ti = ((int64_t)v[1] * c - (int64_t)v[0] * s + Q30_HALF) >> Q30_SHIFT;
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+
+
+/* vb_window
+ *
+ * 		DESCRIPTION: applies the block's window. A long block next to a
+ *		             short one has the short slope on that side, centred
+ *		             on the quarter, with zeros outside and unity inside.
+ *		INPUTS: vb -- decoder state, with the block and flags set
+ *		        y -- block
+ *		OUTPUTS: y -- windowed block
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_window(vorbis_t* vb, int32_t* y) {
+
+    uint32_t n = vb->n, s = vb->blocksize[0] / 4;
+    uint32_t ls = 0, le = n / 2, rs = n / 2, re = n, i;
+    const int32_t* lw = vb->slope[vb->blockflag];
+    const int32_t* rw = lw;
+
+    if (vb->blockflag && !vb->prev_long) {
+        ls = n / 4 - s;
+        le = n / 4 + s;
+        lw = vb->slope[0];
+    }
+    if (vb->blockflag && !vb->next_long) {
+        rs = n * 3 / 4 - s;
+        re = n * 3 / 4 + s;
+        rw = vb->slope[0];
+    }
+
+    for (i = 0; i < ls; i++) y[i] = 0;
+    for (i = ls; i < le; i++) y[i] = ((int64_t)y[i] * lw[i - ls] + Q30_HALF) >> Q30_SHIFT;
+    for (i = rs; i < re; i++) y[i] = ((int64_t)y[i] * rw[re - 1 - i] + Q30_HALF) >> Q30_SHIFT;
+    for (i = re; i < n; i++) y[i] = 0;
+}
+
+
+/* vb_commit
+ *
+ * 		DESCRIPTION: hands a synthesized packet's output to the FIFO,
+ *		             trimmed to the stream's length and with anything short
+ *		             of a seek's target dropped
+ *		INPUTS: vb -- decoder state
+ *		OUTPUTS: vb -- FIFO grown, block kept for the overlap
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void vb_commit(vorbis_t* vb) {
+
+    uint32_t len = vb->out_len, drop = 0;
+
+    if (vb->out_start + len > vb->end)
+        len = vb->end > vb->out_start ? vb->end - vb->out_start : 0;
+
+    /* only while the FIFO is empty, so the dropped frames are its head */
+    if (vb->target > vb->out_start) {
+        drop = vb->target - vb->out_start < len ? vb->target - vb->out_start : len;
+        vb->head = (vb->wr + drop) & FIFO_MASK;
+    }
+
+    vb->count += len - drop;
+    vb->last_n = vb->n;
+    vb->have_overlap = 1;
+}
+
+
+/* rd32
+ *
+ * 		DESCRIPTION: reads a little-endian 32-bit value
+ *		INPUTS: p -- pointer to bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: value read
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd32(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
@@ -0,0 +1,221 @@
+/* vorbis.h - Ogg Vorbis decoder definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _VORBIS_H
+#define _VORBIS_H
+
+#include <stdint.h>
+
+#include "seekidx.h"
+
+/* Ogg pages */
+#define OGG_ID              0x5367674F
+#define OGG_HDR_SIZE        27
+#define OGG_MAX_SEGS        255
+#define OGG_SEG_SIZE        255
+#define OGG_MAX_BODY        (OGG_MAX_SEGS * OGG_SEG_SIZE)
+#define OGG_CONTINUED       0x1
+#define OGG_BOS             0x2
+#define OGG_EOS             0x4
+
+/* stream limits; the card plays at most two channels, and 8192 is the
+ * largest block the format allows */
+#define VORBIS_MAX_CHANNELS 2
+#define VORBIS_MAX_BLOCK    8192
+#define VORBIS_MAX_HALF     (VORBIS_MAX_BLOCK / 2)
+#define VORBIS_MAX_QUARTER  (VORBIS_MAX_BLOCK / 4)
+#define VORBIS_MAX_BOOKS    256
+#define VORBIS_MAX_FLOORS   64
+#define VORBIS_MAX_RESIDUES 64
+#define VORBIS_MAX_MAPPINGS 64
+#define VORBIS_MAX_MODES    64
+#define VORBIS_MAX_SUBMAPS  16
+#define VORBIS_MAX_COUPLING 8
+#define VORBIS_PACKET_SIZE  (1 << 16)
+#define VORBIS_ARENA_SIZE   (1 << 20)
+
+/* decoded PCM waiting to be read, in frames; a power of two holding a
+ * mono period and the output of the longest packet */
+#define VORBIS_FIFO_FRAMES  32768
+
+/* seek points are kept about this many to a second */
+#define VORBIS_INDEX_RATE   2
+
+#define FLOOR1_MAX_PARTS    31
+#define FLOOR1_MAX_CLASSES  16
+#define FLOOR1_MAX_SUBS     8
+#define FLOOR1_MAX_VALUES   65
+#define RESIDUE_MAX_CLASSES 64
+#define RESIDUE_PASSES      8
+
+/* codewords up to this long decode in one table lookup */
+#define VB_FAST_BITS        10
+#define VB_FAST_SIZE        (1 << VB_FAST_BITS)
+
+/* residue values are Q8 and the spectrum Q20, which leaves the inverse
+ * MDCT 11 bits of headroom over full scale */
+#define VB_RES_SHIFT        8
+#define VB_SPEC_SHIFT       20
+#define VB_FLOOR_SHIFT      30
+
+/* decode stages; a packet is parsed in one unit of work and each of its
+ * channels is synthesized in another */
+#define VB_PACKET           0
+#define VB_SYNTH            1
+#define VB_END              2
+
+/* one codebook: a lookup table for short codewords, a sorted list of the
+ * rest, and the expanded VQ vectors */
+typedef struct vb_book {
+    uint32_t dims;
+    uint32_t entries;
+    int32_t* fast;          /* (entry << 5) | length by reversed prefix */
+    uint32_t nlong;
+    uint32_t* long_code;    /* left-aligned codewords, ascending */
+    uint32_t* long_entry;   /* (entry << 5) | length */
+    int32_t* vq;            /* dims values per entry in Q8, 0 if scalar */
+} vb_book_t;
+
+typedef struct vb_floor {
+    uint32_t parts;
+    uint8_t part_class[FLOOR1_MAX_PARTS];
+    uint8_t class_dims[FLOOR1_MAX_CLASSES];
+    uint8_t class_subs[FLOOR1_MAX_CLASSES];
+    uint8_t class_book[FLOOR1_MAX_CLASSES];
+    int16_t sub_book[FLOOR1_MAX_CLASSES][FLOOR1_MAX_SUBS];
+    uint32_t mult;
+    uint32_t values;
+    uint16_t x[FLOOR1_MAX_VALUES];
+    uint8_t sorted[FLOOR1_MAX_VALUES];  /* values in order of x */
+    uint8_t lo[FLOOR1_MAX_VALUES];      /* nearest earlier neighbours */
+    uint8_t hi[FLOOR1_MAX_VALUES];
+} vb_floor_t;
+
+typedef struct vb_residue {
+    uint32_t type;
+    uint32_t begin;
+    uint32_t end;
+    uint32_t psize;
+    uint32_t classes;
+    uint32_t classbook;
+    int16_t book[RESIDUE_MAX_CLASSES][RESIDUE_PASSES];
+} vb_residue_t;
+
+typedef struct vb_mapping {
+    uint32_t submaps;
+    uint32_t coupling;
+    uint8_t mag[VORBIS_MAX_COUPLING];
+    uint8_t ang[VORBIS_MAX_COUPLING];
+    uint8_t mux[VORBIS_MAX_CHANNELS];
+    uint8_t floor[VORBIS_MAX_SUBMAPS];
+    uint8_t residue[VORBIS_MAX_SUBMAPS];
+} vb_mapping_t;
+
+typedef struct vb_mode {
+    uint32_t blockflag;
+    uint32_t mapping;
+} vb_mode_t;
+
+/* open stream; positions are in frames from the start of the stream */
+typedef struct vorbis {
+    int32_t fd;
+    const uint8_t* fname;   /* kept for reopening on a backward seek */
+    uint32_t channels;
+    uint32_t sample_rate;
+    uint32_t blocksize[2];
+
+    /* Ogg layer */
+    uint32_t serial;
+    uint32_t serial_known;
+    uint32_t page_seq;      /* sequence number the next page should have */
+    uint32_t page_flags;
+    uint32_t page_lost;     /* 1 if pages went missing before this one */
+    uint32_t page_granule;
+    uint32_t page_offset;   /* where the page starts in the file */
+    uint32_t file_pos;      /* bytes read from the file */
+    uint32_t first_page;    /* offset of the first audio page */
+    seek_index_t* idx;      /* ends of pages passed, and their offsets */
+    uint32_t nsegs;
+    uint32_t seg;           /* next segment of the page */
+    uint32_t body_pos;      /* its offset in the body */
+    uint32_t packet_len;
+    uint32_t packet_last;   /* 1 if the packet ended the page */
+    uint32_t packet_split;  /* 1 if it began on an earlier page */
+    uint32_t bit_pos;       /* read position in the packet */
+    uint8_t segs[OGG_MAX_SEGS];
+    uint8_t body[OGG_MAX_BODY];
+    uint8_t packet[VORBIS_PACKET_SIZE];
+
+    /* setup */
+    uint32_t nbooks, nfloors, nresidues, nmappings, nmodes;
+    vb_book_t book[VORBIS_MAX_BOOKS];
+    vb_floor_t floor[VORBIS_MAX_FLOORS];
+    vb_residue_t residue[VORBIS_MAX_RESIDUES];
+    vb_mapping_t mapping[VORBIS_MAX_MAPPINGS];
+    vb_mode_t mode[VORBIS_MAX_MODES];
+    uint32_t arena_used;
+
+    /* transform tables for both block sizes, Q30 */
+    int32_t pre_cos[2][VORBIS_MAX_QUARTER];
+    int32_t pre_sin[2][VORBIS_MAX_QUARTER];
+    int32_t fft_cos[2][VORBIS_MAX_QUARTER / 2];
+    int32_t fft_sin[2][VORBIS_MAX_QUARTER / 2];
+    int32_t slope[2][VORBIS_MAX_HALF];
+
+    /* packet being decoded */
+    uint32_t stage;
+    uint32_t chan;          /* next channel to synthesize */
+    uint32_t n;             /* block size */
+    uint32_t blockflag;
+    uint32_t map;
+    uint32_t prev_long;     /* window shape flags of a long block */
+    uint32_t next_long;
+    uint32_t last_n;        /* size of the block before, 0 at the start */
+    uint32_t have_overlap;  /* 1 if that block was decoded */
+    uint32_t out_start;     /* position of its first output frame */
+    uint32_t out_len;
+    uint32_t wr;            /* where in the FIFO that goes */
+    uint32_t floor_used[VORBIS_MAX_CHANNELS];
+    int32_t floor_y[VORBIS_MAX_CHANNELS][FLOOR1_MAX_VALUES];
+    uint8_t cls[VORBIS_MAX_CHANNELS][VORBIS_MAX_HALF * VORBIS_MAX_CHANNELS];
+    int32_t res[VORBIS_MAX_CHANNELS][VORBIS_MAX_HALF];
+    int32_t overlap[VORBIS_MAX_CHANNELS][VORBIS_MAX_HALF];
+    int32_t buf[VORBIS_MAX_BLOCK];
+    int32_t fft[VORBIS_MAX_HALF];   /* complex, a quarter block long */
+
+    /* positions */
+    uint32_t decoded;       /* end of the output of the last block */
+    uint32_t resync;        /* 1 after a jump, until the indexed page
+                             * ends */
+    uint32_t target;        /* output before this is dropped, for a seek */
+    uint32_t end;           /* length of the stream once its last page is
+                             * read, else 0xFFFFFFFF */
+
+    /* decoded PCM, interleaved, from frame out_pos */
+    uint32_t head;
+    uint32_t count;
+    uint32_t out_pos;
+    int16_t fifo[VORBIS_FIFO_FRAMES * VORBIS_MAX_CHANNELS];
+
+    uint8_t arena[VORBIS_ARENA_SIZE];
+} vorbis_t;
+
+
+/* opens a stream and reads its headers */
+int32_t vorbis_open(vorbis_t* vb, const uint8_t* fname);
+
+/* copies the next len bytes of 16-bit PCM, decoding as needed */
+int32_t vorbis_read(vorbis_t* vb, int8_t* dst, uint32_t len);
+
+/* does one unit of decoding ahead of the reads, if there is room */
+int32_t vorbis_work(vorbis_t* vb);
+
+/* moves to a frame, so the next read starts there */
+int32_t vorbis_seek(vorbis_t* vb, uint32_t frame);
+
+/* closes the stream */
+void vorbis_close(vorbis_t* vb);
+
+
+#endif
@@ -0,0 +1,890 @@
+/* wav.c - WAV file parser implementation file.
+ * Written by Soumithri Bala. */
+
+
+#include "wav.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* scratch space for skipping unneeded chunks */
+static uint8_t scratch[SCRATCH_SIZE];
+/* frames of a file being mixed down, as read */
+static uint8_t mix_in[SCRATCH_SIZE];
+/* the loop body, cached as it first plays so wraps never reread the file,
+ * or the decoder of an Ogg Vorbis, MP3, module or MIDI file. A file needs
+ * at most one, and only a file that doesn't loop crossfades into the
+ * next, so they share the space; the program has to fit its 4 MB page */
+static union {
+    int8_t loop_cache[LOOP_CACHE_SIZE];
+    vorbis_t decoder;
+    mp3dec_t mp3;
+    tracker_t module;
+    wavetable_t synth;
+} arena;
+static int32_t arena_user = ARENA_FREE;
+/* the last user; the synthesizer's sound bank is still in the arena from
+ * one MIDI file to the next if nothing else came between */
+static int32_t arena_last = ARENA_FREE;
+
+/* speaker positions of the channel mask, in bit order, with their share
+ * of left and right: BS.775 folds centre and surrounds in at -3 dB and
+ * drops the LFE */
+static const int16_t speaker_mix[][STEREO] = {
+    {MIX_UNITY, 0},                     /* front left */
+    {0, MIX_UNITY},                     /* front right */
+    {MIX_HALF_POWER, MIX_HALF_POWER},   /* front centre */
+    {0, 0},                             /* LFE */
+    {MIX_HALF_POWER, 0},                /* back left */
+    {0, MIX_HALF_POWER},                /* back right */
+    {MIX_UNITY, 0},                     /* front left of centre */
+    {0, MIX_UNITY},                     /* front right of centre */
+    {MIX_HALF, MIX_HALF},               /* back centre */
+    {MIX_HALF_POWER, 0},                /* side left */
+    {0, MIX_HALF_POWER}                 /* side right */
+};
+#define SPEAKERS            (sizeof(speaker_mix) / sizeof(speaker_mix[0]))
+
+/* usual layouts by channel count, for files without a mask */
+static const uint32_t default_mask[WAV_MAX_CHANNELS + 1] = {
+    0, 0x4, 0x3, 0x7, 0x33, 0x37, 0x3F, 0x70F, 0x63F
+};
+
+
+/* local function definitions */
+static uint32_t rd32(const uint8_t* p);
+static uint16_t rd16(const uint8_t* p);
+static void wr32(uint8_t* p, uint32_t val);
+static void wr16(uint8_t* p, uint16_t val);
+static void wav_copy(int8_t* dst, const int8_t* src, uint32_t len);
+static int32_t wav_skip(int32_t fd, uint32_t len);
+static int32_t wav_scan(wav_t* wav, int32_t past_data);
+static int32_t wav_ogg(wav_t* wav);
+static int32_t wav_mp3(wav_t* wav);
+static int32_t wav_module(wav_t* wav, int32_t want_loops);
+static int32_t wav_synth(wav_t* wav, int32_t want_loops);
+static int32_t arena_take(int32_t user);
+static void wav_smpl(wav_t* wav, uint32_t size);
+static void wav_build_header(wav_t* wav);
+static void wav_mix_init(wav_t* wav);
+static int32_t wav_read(wav_t* wav, int8_t* dst, uint32_t len);
+static void wav_downmix(const wav_t* wav, int16_t* dst, const int16_t* src,
+                        uint32_t frames);
+
+
+/* wav_open
+ *
+ * 		DESCRIPTION: opens a WAV file, walks its chunks and leaves the file
+ *		             positioned at the first byte of PCM data
+ *		INPUTS: wav -- parser state to fill in
+ *		        fname -- name of the file
+ *		        want_loops -- nonzero to look for smpl loop points after
+ *		                      the data chunk as well, or to play a
+ *		                      module's or MIDI file's song forever
+ *		OUTPUTS: wav -- format, data size, loop points and a canonical
+ *		                44-byte header block for the driver
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: opens a file descriptor
+ */
+int32_t wav_open(wav_t* wav, const uint8_t* fname, int32_t want_loops) {
+
+    int32_t found;
+
+    wav->format = 0;
+    wav->data_size = 0;
+    wav->pos = 0;
+    wav->file_pos = 0;
+    wav->loop_start = 0;
+    wav->loop_end = 0;
+    wav->loops_left = 0;
+    wav->src_channels = 0;
+    wav->channel_mask = 0;
+    wav->loop_cache = 0;
+    wav->vorbis = 0;
+    wav->mp3 = 0;
+    wav->module = 0;
+    wav->synth = 0;
+    wav->fname = fname;
+
+    if (-1 == (wav->fd = ece391_open(fname))) return -1;
+
+    /* stop at the data chunk; smpl usually comes after it, so if looping
+     * is wanted and it hasn't turned up yet, read past the data once; an
+     * Ogg or MP3 file goes to its decoder instead, and anything else may
+     * be a MIDI file or module */
+    if ((found = wav_scan(wav, 0)) != 0) {
+        ece391_close(wav->fd);
+        if (found == WAV_OGG) return wav_ogg(wav);
+        if (found == WAV_MP3) return wav_mp3(wav);
+        return found == WAV_OTHER ? wav_synth(wav, want_loops) : -1;
+    }
+
+    if (want_loops && !wav->loop_end) {
+        wav_scan(wav, 1);
+        ece391_close(wav->fd);
+
+        /* reopen and walk back to the data chunk */
+        if (-1 == (wav->fd = ece391_open(fname))) return -1;
+        if (wav_scan(wav, 0) == -1) {
+            ece391_close(wav->fd);
+            return -1;
+        }
+    }
+
+    /* more channels than the card plays are mixed down as they're read */
+    if (wav->nchannels > STEREO && wav->nchannels <= WAV_MAX_CHANNELS && wav->bits == 16)
+        wav_mix_init(wav);
+
+    /* without smpl loop points, loop the whole file */
+    if (want_loops && !wav->loop_end) wav->loop_end = wav->data_size;
+
+    /* drop loops that weren't asked for, don't lie inside the data, don't
+     * fit the cache or can't have it */
+    if (!want_loops || wav->loop_end > wav->data_size || wav->loop_start >= wav->loop_end ||
+            wav->loop_end - wav->loop_start > LOOP_CACHE_SIZE || arena_take(ARENA_LOOP) == -1)
+        wav->loop_start = wav->loop_end = 0;
+    else
+        wav->loop_cache = arena.loop_cache;
+
+    wav_build_header(wav);
+
+    return 0;
+}
+
+
+/* wav_fill
+ *
+ * 		DESCRIPTION: copies PCM into dst, wrapping from loop end to loop
+ *		             start inside the copy so there is no gap at the seam
+ *		INPUTS: wav -- parser state
+ *		        dst -- destination, usually a free half of the DMA buffer
+ *		        len -- number of bytes wanted
+ *		OUTPUTS: dst -- PCM data
+ *		RETURN VALUE: number of bytes copied, 0 at end of data
+ *		SIDE EFFECTS: advances the file, fills the loop cache on the first
+ *		              pass through the loop body
+ */
+int32_t wav_fill(wav_t* wav, int8_t* dst, uint32_t len) {
+
+    uint32_t done = 0;
+    uint32_t n, bound;
+    int32_t got;
+
+    while (done < len) {
+
+        /* wrap at the loop end, or fall through once the count runs out */
+        if (wav->loop_end && wav->pos == wav->loop_end) {
+            if (wav->loops_left == 1) {
+                wav->loop_end = 0;
+            } else {
+                if (wav->loops_left) wav->loops_left--;
+                wav->pos = wav->loop_start;
+            }
+        }
+
+        n = len - done;
+
+        /* serve the loop body from memory once it has played through */
+        if (wav->loop_end && wav->pos >= wav->loop_start &&
+                wav->pos < wav->file_pos) {
+            bound = wav->file_pos - wav->pos;
+            if (n > bound) n = bound;
+            wav_copy(dst + done, wav->loop_cache + (wav->pos - wav->loop_start), n);
+            wav->pos += n;
+            done += n;
+            continue;
+        }
+
+        /* otherwise read from the file, stopping at the next loop point */
+        bound = wav->data_size - wav->file_pos;
+        if (wav->loop_end) {
+            if (wav->file_pos < wav->loop_start)
+                bound = wav->loop_start - wav->file_pos;
+            else
+                bound = wav->loop_end - wav->file_pos;
+        }
+        if (n > bound) n = bound;
+        if (!n || (got = wav_read(wav, dst + done, n)) <= 0) break;
+
+        /* keep a copy of the loop body for later passes */
+        if (wav->loop_end && wav->file_pos >= wav->loop_start)
+            wav_copy(wav->loop_cache + (wav->file_pos - wav->loop_start), dst + done, got);
+
+        wav->file_pos += got;
+        wav->pos += got;
+        done += got;
+    }
+
+    return done;
+}
+
+
+/* wav_seek
+ *
+ * 		DESCRIPTION: moves to a frame of the data. There's no seek call, so
+ *		             going back reopens the file and skips to the data,
+ *		             and going forward reads through. Reading goes through
+ *		             the fill so the loop cache stays whole, and positions
+ *		             the cache already holds need no file access at all.
+ *		INPUTS: wav -- parser state
+ *		        frame -- frame index within the data chunk
+ *		OUTPUTS: wav -- positioned at the frame
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: may reopen the file, drops the loop if seeking past
+ *		              its end
+ */
+int32_t wav_seek(wav_t* wav, uint32_t frame) {
+
+    uint32_t target, n;
+
+    if (wav->vorbis) {
+        if (vorbis_seek(wav->vorbis, frame) == -1) return -1;
+        wav->pos = wav->file_pos = frame * wav->block_align;
+        return 0;
+    }
+    if (wav->mp3) {
+        if (mp3dec_seek(wav->mp3, frame) == -1) return -1;
+        wav->pos = wav->file_pos = frame * wav->block_align;
+        return 0;
+    }
+    if (wav->module) {
+        tracker_seek(wav->module, frame);
+        wav->pos = wav->file_pos = frame * wav->block_align;
+        return 0;
+    }
+    if (wav->synth) {
+        wt_seek(wav->synth, frame);
+        wav->pos = wav->file_pos = frame * wav->block_align;
+        return 0;
+    }
+
+    if (!wav->block_align) return -1;
+    if (frame > wav->data_size / wav->block_align) frame = wav->data_size / wav->block_align;
+    target = frame * wav->block_align;
+
+    /* past the loop body, the loop is left behind */
+    if (wav->loop_end && target >= wav->loop_end) {
+        wav->loop_start = wav->loop_end = 0;
+        if (wav->loop_cache) {
+            wav->loop_cache = 0;
+            arena_user = ARENA_FREE;
+        }
+    }
+
+    /* inside the part of the loop body already cached */
+    if (wav->loop_end && target >= wav->loop_start && target < wav->file_pos) {
+        wav->pos = target;
+        return 0;
+    }
+
+    if (target < wav->file_pos) {
+        ece391_close(wav->fd);
+        if (-1 == (wav->fd = ece391_open(wav->fname)) ||
+                wav_skip(wav->fd, wav->data_offset) == -1)
+            return -1;
+        wav->file_pos = 0;
+        wav->pos = 0;
+    }
+
+    while (wav->pos < target) {
+        n = target - wav->pos;
+        if (!(n = wav_fill(wav, (int8_t*)scratch, n < SCRATCH_SIZE ? n : SCRATCH_SIZE)))
+            return -1;
+    }
+
+    return 0;
+}
+
+
+/* wav_close
+ *
+ * 		DESCRIPTION: closes the file
+ *		INPUTS: wav -- parser state
+ *		OUTPUTS: none
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: closes a file descriptor
+ */
+void wav_close(wav_t* wav) {
+
+    if (wav->vorbis) {
+        vorbis_close(wav->vorbis);
+        arena_user = ARENA_FREE;
+        return;
+    }
+    if (wav->mp3) {
+        mp3dec_close(wav->mp3);
+        arena_user = ARENA_FREE;
+        return;
+    }
+    if (wav->module) {
+        tracker_close(wav->module);
+        arena_user = ARENA_FREE;
+        return;
+    }
+    if (wav->synth) {
+        wt_close(wav->synth);
+        arena_user = ARENA_FREE;
+        return;
+    }
+    if (wav->loop_cache) arena_user = ARENA_FREE;
+
+    ece391_close(wav->fd);
+}
+
+
+/* wav_work
+ *
+ * 		DESCRIPTION: decodes a little of an Ogg Vorbis or MP3 file ahead
+ *		             of the fills, so the work is spread over the period
+ *		             rather than all landing when a half needs refilling
+ *		INPUTS: wav -- parser state
+ *		OUTPUTS: none
+ *		RETURN VALUE: 1 if there was work to do, else 0
+ *		SIDE EFFECTS: may advance the file
+ */
+int32_t wav_work(wav_t* wav) {
+
+    if (wav->vorbis) return vorbis_work(wav->vorbis);
+
+    return wav->mp3 ? mp3dec_work(wav->mp3) : 0;
+}
+
+
+/* wav_index
+ *
+ * 		DESCRIPTION: reads an Ogg Vorbis or MP3 file through to its end,
+ *		             so its seek index covers the whole stream. An MP3
+ *		             file only has its frame headers read, and a Vorbis
+ *		             file is seeked past its end, which parses each packet
+ *		             without decoding it.
+ *		INPUTS: wav -- parser state
+ *		OUTPUTS: none
+ *		RETURN VALUE: the file's index, or 0 if it has none
+ *		SIDE EFFECTS: leaves the file at its end
+ */
+seek_index_t* wav_index(wav_t* wav) {
+
+    if (wav->mp3) {
+        mp3_scan(&wav->mp3->mp3);
+        return wav->mp3->mp3.idx;
+    }
+    if (wav->vorbis) {
+        if (vorbis_seek(wav->vorbis, OGG_DATA_SIZE / wav->block_align) == -1) return 0;
+        while (vorbis_work(wav->vorbis));
+        return wav->vorbis->idx;
+    }
+
+    return 0;
+}
+
+
+/* wav_scan
+ *
+ * 		DESCRIPTION: walks RIFF chunks from the current file position
+ *		INPUTS: wav -- parser state
+ *		        past_data -- 0 to stop at the data chunk, 1 to skip it
+ *		                     and keep walking to the end of the file
+ *		OUTPUTS: wav -- format, data size and loop points found
+ *		RETURN VALUE: 0 on success, WAV_OGG if the file is Ogg, WAV_MP3 if
+ *		              it is MPEG audio, WAV_OTHER if it isn't RIFF WAVE
+ *		              either, -1 on fail
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wav_scan(wav_t* wav, int32_t past_data) {
+
+    uint8_t hdr[FMT_MIN_SIZE];
+    uint8_t ext[FMT_EXT_SIZE];
+    mp3_header_t frame;
+    uint32_t id, size;
+    uint32_t offset = RIFF_HDR_SIZE, next;
+
+    /* RIFF header */
+    if (!past_data) {
+        /* too short to be anything this plays */
+        if (ece391_read(wav->fd, hdr, RIFF_HDR_SIZE) != RIFF_HDR_SIZE) return WAV_OTHER;
+        if (rd32(hdr) == OGG_ID) return WAV_OGG;
+        if ((uint32_t)(hdr[0] << 16 | hdr[1] << 8 | hdr[2]) == ID3_ID ||
+                mp3_header(hdr, &frame) == 0)
+            return WAV_MP3;
+        if (rd32(hdr) != RIFF_ID || rd32(hdr + 8) != WAVE_ID) return WAV_OTHER;
+    } else {
+        /* already stopped at the data chunk; step over it */
+        if (wav_skip(wav->fd, wav->data_size + (wav->data_size & 1)) == -1)
+            return 0;
+    }
+
+    while (ece391_read(wav->fd, hdr, CHUNK_HDR_SIZE) == CHUNK_HDR_SIZE) {
+        id = rd32(hdr);
+        size = rd32(hdr + 4);
+        next = offset + CHUNK_HDR_SIZE + size + (size & 1);
+
+        if (id == FMT_ID && size >= FMT_MIN_SIZE) {
+            ece391_read(wav->fd, hdr, FMT_MIN_SIZE);
+            wav->format = rd16(hdr);
+            wav->nchannels = rd16(hdr + 2);
+            wav->sample_rate = rd32(hdr + 4);
+            wav->block_align = rd16(hdr + 12);
+            wav->bits = rd16(hdr + 14);
+            size -= FMT_MIN_SIZE;
+
+            /* the extension holds the speaker mask, and the real format
+             * in the first two bytes of its GUID */
+            if (wav->format == FORMAT_EXTENSIBLE && size >= FMT_EXT_SIZE) {
+                ece391_read(wav->fd, ext, FMT_EXT_SIZE);
+                wav->channel_mask = rd32(ext + 4);
+                wav->format = rd16(ext + 8);
+                size -= FMT_EXT_SIZE;
+            }
+        } else if (id == SMPL_ID && size >= SMPL_HDR_SIZE + SMPL_LOOP_SIZE) {
+            wav_smpl(wav, size);
+            size = 0;
+        } else if (id == DATA_ID) {
+            wav->data_size = size;
+            wav->data_offset = offset + CHUNK_HDR_SIZE;
+            if (!past_data) return wav->format ? 0 : -1;
+        }
+        offset = next;
+
+        /* chunks are padded to an even length */
+        if (wav_skip(wav->fd, size + (size & 1)) == -1) break;
+    }
+
+    return past_data ? 0 : -1;
+}
+
+
+/* wav_ogg
+ *
+ * 		DESCRIPTION: opens an Ogg Vorbis file on the decoder. It reads as
+ *		             16-bit PCM of the stream's channels and rate, with a
+ *		             data size that won't run out before the stream does.
+ *		INPUTS: wav -- parser state, with the file closed
+ *		OUTPUTS: wav -- format and canonical header
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: takes the arena, opens a file descriptor
+ */
+static int32_t wav_ogg(wav_t* wav) {
+
+    if (arena_take(ARENA_OGG) == -1) return -1;
+    if (vorbis_open(&arena.decoder, wav->fname) == -1) {
+        arena_user = ARENA_FREE;
+        ece391_fdputs(1, (uint8_t*)"unsupported ogg stream\n");
+        return -1;
+    }
+
+    wav->vorbis = &arena.decoder;
+    wav->format = FORMAT_PCM;
+    wav->nchannels = arena.decoder.channels;
+    wav->sample_rate = arena.decoder.sample_rate;
+    wav->bits = sizeof(int16_t) * 8;
+    wav->block_align = arena.decoder.channels * sizeof(int16_t);
+    wav->data_size = OGG_DATA_SIZE / wav->block_align * wav->block_align;
+    wav_build_header(wav);
+
+    return 0;
+}
+
+
+/* wav_mp3
+ *
+ * 		DESCRIPTION: opens an MP3 file on the Layer III decoder. It reads
+ *		             like an Ogg Vorbis file, as 16-bit PCM of the first
+ *		             frame's channels and rate.
+ *		INPUTS: wav -- parser state, with the file closed
+ *		OUTPUTS: wav -- format and canonical header
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: takes the arena, opens a file descriptor
+ */
+static int32_t wav_mp3(wav_t* wav) {
+
+    if (arena_take(ARENA_MP3) == -1) return -1;
+    if (mp3dec_open(&arena.mp3, wav->fname) == -1) {
+        arena_user = ARENA_FREE;
+        ece391_fdputs(1, (uint8_t*)"unsupported mp3 stream\n");
+        return -1;
+    }
+
+    wav->mp3 = &arena.mp3;
+    wav->format = FORMAT_PCM;
+    wav->nchannels = arena.mp3.channels;
+    wav->sample_rate = arena.mp3.sample_rate;
+    wav->bits = sizeof(int16_t) * 8;
+    wav->block_align = arena.mp3.channels * sizeof(int16_t);
+    wav->data_size = OGG_DATA_SIZE / wav->block_align * wav->block_align;
+    wav_build_header(wav);
+
+    return 0;
+}
+
+
+/* wav_module
+ *
+ * 		DESCRIPTION: opens a MOD, S3M or XM file on the module player. It
+ *		             reads as 16-bit stereo at the player's rate, with a
+ *		             data size that won't run out before the song does.
+ *		INPUTS: wav -- parser state, with the file closed
+ *		        want_loops -- nonzero to play the song forever
+ *		OUTPUTS: wav -- format and canonical header
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: takes the arena, loads the whole file
+ */
+static int32_t wav_module(wav_t* wav, int32_t want_loops) {
+
+    int32_t ret;
+
+    if (arena_take(ARENA_MODULE) == -1) return -1;
+    if ((ret = tracker_open(&arena.module, wav->fname, want_loops)) != 0) {
+        arena_user = ARENA_FREE;
+        if (ret == TRK_NOT_MODULE) ece391_fdputs(1, (uint8_t*)"not a wav file\n");
+        return -1;
+    }
+
+    wav->module = &arena.module;
+    wav->format = FORMAT_PCM;
+    wav->nchannels = STEREO;
+    wav->sample_rate = TRK_RATE;
+    wav->bits = sizeof(int16_t) * 8;
+    wav->block_align = TRK_FRAME_SIZE;
+    wav->data_size = OGG_DATA_SIZE / wav->block_align * wav->block_align;
+    wav_build_header(wav);
+
+    return 0;
+}
+
+
+/* wav_synth
+ *
+ * 		DESCRIPTION: opens a MIDI file on the wavetable synthesizer, which
+ *		             reads like a module. A file that isn't MIDI may be a
+ *		             module; MIDI is tried first as it only reads the file
+ *		             into the arena, where a module's load would overwrite
+ *		             the sound bank.
+ *		INPUTS: wav -- parser state, with the file closed
+ *		        want_loops -- nonzero to play the song forever
+ *		OUTPUTS: wav -- format and canonical header
+ *		RETURN VALUE: 0 on success, -1 on fail
+ *		SIDE EFFECTS: takes the arena, loads the whole file, and the sound
+ *		              bank unless it's still there
+ */
+static int32_t wav_synth(wav_t* wav, int32_t want_loops) {
+
+    int32_t ret;
+
+    if (arena_take(ARENA_SYNTH) == -1) return -1;
+    if ((ret = wt_open(&arena.synth, wav->fname, (uint8_t*)WT_BANK_FILE, want_loops)) != 0) {
+        arena_user = ARENA_FREE;
+        return ret == WT_NOT_MIDI ? wav_module(wav, want_loops) : -1;
+    }
+
+    wav->synth = &arena.synth;
+    wav->format = FORMAT_PCM;
+    wav->nchannels = STEREO;
+    wav->sample_rate = WT_RATE;
+    wav->bits = sizeof(int16_t) * 8;
+    wav->block_align = WT_FRAME_SIZE;
+    wav->data_size = OGG_DATA_SIZE / wav->block_align * wav->block_align;
+    wav_build_header(wav);
+
+    return 0;
+}
+
+
+/* arena_take
+ *
+ * 		DESCRIPTION: takes the arena for the loop cache or a decoder
+ *		INPUTS: user -- ARENA_LOOP, ARENA_OGG, ARENA_MP3, ARENA_MODULE or
+ *		                ARENA_SYNTH
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if an open file already has it
+ *		SIDE EFFECTS: marks the sound bank as gone if another user had the
+ *		              arena since the synthesizer
+ */
+static int32_t arena_take(int32_t user) {
+
+    if (arena_user != ARENA_FREE) return -1;
+
+    if (user == ARENA_SYNTH && arena_last != ARENA_SYNTH) arena.synth.loaded = 0;
+    arena_user = arena_last = user;
+
+    return 0;
+}
+
+
+/* wav_smpl
+ *
+ * 		DESCRIPTION: reads the first loop of a smpl chunk
+ *		INPUTS: wav -- parser state
+ *		        size -- size of the chunk body
+ *		OUTPUTS: wav -- loop start, end and count
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: advances the file past the chunk
+ */
+static void wav_smpl(wav_t* wav, uint32_t size) {
+
+    uint8_t body[SMPL_HDR_SIZE + SMPL_LOOP_SIZE];
+    const uint8_t* loop = body + SMPL_HDR_SIZE;
+    uint32_t frame = wav->block_align;
+
+    ece391_read(wav->fd, body, sizeof(body));
+    wav_skip(wav->fd, size - sizeof(body) + (size & 1));
+
+    if (!frame || !rd32(body + 28)) return;
+
+    /* loop points are in frames and the end frame is played */
+    wav->loop_start = rd32(loop + 8) * frame;
+    wav->loop_end = (rd32(loop + 12) + 1) * frame;
+    wav->loops_left = rd32(loop + 20);
+}
+
+
+/* wav_build_header
+ *
+ * 		DESCRIPTION: builds the canonical 44-byte header the driver expects,
+ *		             whatever other chunks the file carried
+ *		INPUTS: wav -- parser state
+ *		OUTPUTS: wav -- info_block
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wav_build_header(wav_t* wav) {
+
+    uint8_t* p = wav->info_block;
+
+    wr32(p, RIFF_ID);
+    wr32(p + 4, IBLOCK_SIZE - CHUNK_HDR_SIZE + wav->data_size);
+    wr32(p + 8, WAVE_ID);
+    wr32(p + 12, FMT_ID);
+    wr32(p + 16, FMT_MIN_SIZE);
+    wr16(p + 20, wav->format);
+    wr16(p + 22, wav->nchannels);
+    wr32(p + 24, wav->sample_rate);
+    wr32(p + 28, wav->sample_rate * wav->block_align);
+    wr16(p + 32, wav->block_align);
+    wr16(p + 34, wav->bits);
+    wr32(p + 36, DATA_ID);
+    wr32(p + 40, wav->data_size);
+}
+
+
+/* wav_mix_init
+ *
+ * 		DESCRIPTION: sets up the downmix of a file with more than two
+ *		             channels. Each channel takes the left and right shares
+ *		             of its speaker, and both rows are scaled by the same
+ *		             amount so neither sums past unity, which keeps the
+ *		             balance and means the mix can't clip. From then on the
+ *		             file reads as 16-bit stereo, so its sizes and loop
+ *		             points are rescaled to stereo frames.
+ *		INPUTS: wav -- parser state, at the data chunk
+ *		OUTPUTS: wav -- stereo format and mix coefficients
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wav_mix_init(wav_t* wav) {
+
+    uint32_t mask = wav->channel_mask ? wav->channel_mask : default_mask[wav->nchannels];
+    uint32_t bit, c, side, sum[STEREO] = {0, 0}, norm;
+
+    for (c = 0; c < wav->nchannels; c++) wav->mix[0][c] = wav->mix[1][c] = 0;
+
+    /* channels come in the order of the mask's bits */
+    for (bit = 0, c = 0; bit < SPEAKERS && c < wav->nchannels; bit++) {
+        if (!(mask & (1 << bit))) continue;
+        for (side = 0; side < STEREO; side++) {
+            wav->mix[side][c] = speaker_mix[bit][side];
+            sum[side] += speaker_mix[bit][side];
+        }
+        c++;
+    }
+
+    norm = sum[0] > sum[1] ? sum[0] : sum[1];
+    if (norm > MIX_UNITY) {
+        for (c = 0; c < wav->nchannels; c++) {
+            wav->mix[0][c] = wav->mix[0][c] * MIX_UNITY / norm;
+            wav->mix[1][c] = wav->mix[1][c] * MIX_UNITY / norm;
+        }
+    }
+
+    wav->src_channels = wav->nchannels;
+    wav->src_align = wav->block_align;
+    wav->nchannels = STEREO;
+    wav->block_align = STEREO * sizeof(int16_t);
+
+    wav->data_size = wav->data_size / wav->src_align * wav->block_align;
+    wav->loop_start = wav->loop_start / wav->src_align * wav->block_align;
+    wav->loop_end = wav->loop_end / wav->src_align * wav->block_align;
+}
+
+
+/* wav_read
+ *
+ * 		DESCRIPTION: reads PCM from the file, decoding it if it's Ogg
+ *		             Vorbis or MP3, rendering it if it's a module or MIDI
+ *		             file, and mixing it down on the way if the file has
+ *		             more than two channels
+ *		INPUTS: wav -- parser state
+ *		        dst -- destination
+ *		        len -- bytes wanted, in whole frames
+ *		OUTPUTS: dst -- PCM data
+ *		RETURN VALUE: bytes read, 0 or -1 at end of file
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wav_read(wav_t* wav, int8_t* dst, uint32_t len) {
+
+    uint32_t frames;
+    int32_t got;
+
+    if (wav->vorbis) return vorbis_read(wav->vorbis, dst, len);
+    if (wav->mp3) return mp3dec_read(wav->mp3, dst, len);
+    if (wav->module) return tracker_read(wav->module, dst, len);
+    if (wav->synth) return wt_read(wav->synth, dst, len);
+    if (!wav->src_channels) return ece391_read(wav->fd, dst, len);
+
+    frames = len / wav->block_align;
+    if (frames > SCRATCH_SIZE / wav->src_align) frames = SCRATCH_SIZE / wav->src_align;
+    if ((got = ece391_read(wav->fd, mix_in, frames * wav->src_align)) <= 0) return got;
+
+    frames = got / wav->src_align;
+    wav_downmix(wav, (int16_t*)dst, (int16_t*)mix_in, frames);
+
+    return frames * wav->block_align;
+}
+
+
+/* wav_downmix
+ *
+ * 		DESCRIPTION: mixes interleaved frames of the file's channels down
+ *		             to 16-bit stereo in one pass
+ *		INPUTS: wav -- parser state
+ *		        dst -- stereo output
+ *		        src -- frames as read from the file
+ *		        frames -- number of frames
+ *		OUTPUTS: dst -- stereo frames
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wav_downmix(const wav_t* wav, int16_t* dst, const int16_t* src,
+                        uint32_t frames) {
+
+    uint32_t i, c, n = wav->src_channels;
+    int32_t l, r;
+
+    for (i = 0; i < frames; i++) {
+        l = r = 0;
+        for (c = 0; c < n; c++) {
+            l += src[c] * wav->mix[0][c];
+            r += src[c] * wav->mix[1][c];
+        }
+        dst[0] = l >> MIX_SHIFT;
+        dst[1] = r >> MIX_SHIFT;
+        src += n;
+        dst += STEREO;
+    }
+}
+
+
+/* wav_skip
+ *
+ * 		DESCRIPTION: discards bytes from a file with no seek available
+ *		INPUTS: fd -- file descriptor
+ *		        len -- number of bytes to skip
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the file ended first
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wav_skip(int32_t fd, uint32_t len) {
+
+    int32_t got;
+
+    while (len) {
+        got = ece391_read(fd, scratch, len < SCRATCH_SIZE ? len : SCRATCH_SIZE);
+        if (got <= 0) return -1;
+        len -= got;
+    }
+
+    return 0;
+}
+
+
+/* wav_copy
+ *
+ * 		DESCRIPTION: copies bytes
+ *		INPUTS: dst -- destination
+ *		        src -- source
+ *		        len -- number of bytes
+ *		OUTPUTS: dst -- copied bytes
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wav_copy(int8_t* dst, const int8_t* src, uint32_t len) {
+
+    /* periods are whole frames, so copy a word at a time where possible */
+    while (len >= 4) {
+        *((uint32_t*)dst) = *((const uint32_t*)src);
+        dst += 4;
+        src += 4;
+        len -= 4;
+    }
+    while (len--) *dst++ = *src++;
+}
+
+
+/* rd32
+ *
+ * 		DESCRIPTION: reads a little-endian 32-bit value
+ *		INPUTS: p -- pointer to bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: value read
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd32(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/* rd16
+ *
+ * 		DESCRIPTION: reads a little-endian 16-bit value
+ *		INPUTS: p -- pointer to bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: value read
+ *		SIDE EFFECTS: none
+ */
+static uint16_t rd16(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8);
+}
+
+
+/* wr32
+ *
+ * 		DESCRIPTION: writes a little-endian 32-bit value
+ *		INPUTS: p -- pointer to bytes
+ *		        val -- value to write
+ *		OUTPUTS: p -- bytes written
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wr32(uint8_t* p, uint32_t val) {
+
+    wr16(p, val & 0xFFFF);
+    wr16(p + 2, val >> 16);
+}
+
+
+/* wr16
+ *
+ * 		DESCRIPTION: writes a little-endian 16-bit value
+ *		INPUTS: p -- pointer to bytes
+ *		        val -- value to write
+ *		OUTPUTS: p -- bytes written
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wr16(uint8_t* p, uint16_t val) {
+
+    p[0] = val & 0xFF;
+    p[1] = val >> 8;
+}
@@ -0,0 +1,117 @@
+/* wav.h - WAV file parser definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _WAV_H
+#define _WAV_H
+
+#include <stdint.h>
+
+#include "vorbis.h"
+#include "mp3dec.h"
+#include "tracker.h"
+#include "wavetable.h"
+
+#define IBLOCK_SIZE         44
+#define CHUNK_HDR_SIZE      8
+#define RIFF_HDR_SIZE       12
+#define FMT_MIN_SIZE        16
+#define SMPL_HDR_SIZE       36
+#define SMPL_LOOP_SIZE      24
+#define SCRATCH_SIZE        4096
+#define LOOP_CACHE_SIZE     (1 << 20)
+
+/* users of the arena shared by the loop cache and the decoders */
+#define ARENA_FREE          0
+#define ARENA_LOOP          1
+#define ARENA_OGG           2
+#define ARENA_MODULE        3
+#define ARENA_SYNTH         4
+#define ARENA_MP3           5
+
+#define RIFF_ID             0x46464952
+#define WAVE_ID             0x45564157
+#define FMT_ID              0x20746D66
+#define DATA_ID             0x61746164
+#define SMPL_ID             0x6C706D73
+
+#define FORMAT_PCM          1
+#define FORMAT_EXTENSIBLE   0xFFFE
+#define FMT_EXT_SIZE        24
+
+/* an Ogg Vorbis file found by the scan, and the data size it reports, as
+ * its length isn't known until the last page is read; modules report it
+ * too, as a looping song has no end */
+#define WAV_OGG             1
+#define OGG_DATA_SIZE       0x7FFFFFFC
+
+/* an MPEG Layer III file, starting with an ID3 tag or a frame; it reports
+ * the same data size as Ogg */
+#define WAV_MP3             2
+
+/* a file that is none of these, which may be a module or MIDI file */
+#define WAV_OTHER           3
+
+/* files with more channels are mixed down to stereo as they are read,
+ * with Q14 coefficients */
+#define WAV_MAX_CHANNELS    8
+#define STEREO              2
+#define MIX_SHIFT           14
+#define MIX_UNITY           (1 << MIX_SHIFT)
+#define MIX_HALF_POWER      11585
+#define MIX_HALF            (MIX_UNITY / 2)
+
+/* open WAV file and its position in the data chunk */
+typedef struct wav {
+    int32_t fd;
+    const uint8_t* fname;   /* kept for reopening on a backward seek */
+    uint32_t data_offset;   /* file offset of the first byte of PCM */
+    uint16_t format;
+    uint16_t nchannels;
+    uint32_t sample_rate;
+    uint16_t block_align;
+    uint16_t bits;
+    uint16_t src_channels;  /* channels in the file when mixed down, else 0 */
+    uint16_t src_align;     /* bytes per frame in the file when mixed down */
+    uint32_t channel_mask;  /* speaker positions, 0 if the file gave none */
+    int16_t mix[STEREO][WAV_MAX_CHANNELS];
+    /* sizes and offsets below count bytes as they come out of wav_fill,
+     * so they are in stereo frames for a file that is mixed down */
+    uint32_t data_size;     /* bytes of PCM in the data chunk */
+    uint32_t pos;           /* byte offset in data of the next byte out */
+    uint32_t file_pos;      /* byte offset in data of the file pointer */
+    uint32_t loop_start;    /* loop body in bytes of data, end exclusive */
+    uint32_t loop_end;      /* 0 if not looping */
+    uint32_t loops_left;    /* wraps remaining, 0 loops forever */
+    int8_t* loop_cache;     /* copy of the loop body, 0 without loops */
+    vorbis_t* vorbis;       /* decoder of an Ogg Vorbis file, else 0 */
+    mp3dec_t* mp3;          /* decoder of an MP3 file, else 0 */
+    tracker_t* module;      /* player of a MOD, S3M or XM file, else 0 */
+    wavetable_t* synth;     /* synthesizer of a MIDI file, else 0 */
+    uint8_t info_block[IBLOCK_SIZE];
+} wav_t;
+
+
+/* opens a WAV file and positions it at the start of its PCM data; an Ogg
+ * Vorbis or MP3 file opens as 16-bit PCM decoded on the fly, and a module
+ * or MIDI file as 16-bit stereo rendered on the fly; only one open file at
+ * a time may loop or be decoded, as they share one arena */
+int32_t wav_open(wav_t* wav, const uint8_t* fname, int32_t want_loops);
+
+/* copies the next len bytes of PCM, wrapping at the loop points */
+int32_t wav_fill(wav_t* wav, int8_t* dst, uint32_t len);
+
+/* moves to a frame of the data, so the next fill starts there */
+int32_t wav_seek(wav_t* wav, uint32_t frame);
+
+/* decodes ahead while waiting for the card, if the file needs decoding */
+int32_t wav_work(wav_t* wav);
+
+/* reads a compressed file to its end, for the whole of its seek index */
+seek_index_t* wav_index(wav_t* wav);
+
+/* closes the file */
+void wav_close(wav_t* wav);
+
+
+#endif
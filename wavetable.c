@@ -0,0 +1,1465 @@
+/* wavetable.c - Sample-based General MIDI synthesizer implementation file.
+ * MIDI files are rendered to PCM from a SoundFont 2 bank: each note plays
+ * the bank's samples for its key and velocity, resampled to its pitch and
+ * shaped by a volume envelope, and the voices are mixed like a module's.
+ * Written by Soumithri Bala. */
+
+
+#include "wavetable.h"
+#include "fixmath.h"
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+
+/* RIFF chunks of a SoundFont 2 file, little-endian */
+#define SF2_RIFF_ID         0x46464952
+#define SF2_SFBK_ID         0x6B626673
+#define SF2_LIST_ID         0x5453494C
+#define SF2_SMPL_ID         0x6C706D73
+#define SF2_RIFF_HDR        12
+#define SF2_CHUNK_HDR       8
+#define SF2_ID_LEN          4
+#define SKIP_SIZE           256
+
+/* the lists of the pdta chunk, each ending in a record that only marks
+ * where the one before it ends */
+#define SF2_PHDR            0
+#define SF2_PBAG            1
+#define SF2_PGEN            2
+#define SF2_INST            3
+#define SF2_IBAG            4
+#define SF2_IGEN            5
+#define SF2_SHDR            6
+#define SF2_LISTS           7
+
+#define SF2_PHDR_SIZE       38
+#define SF2_PHDR_PRESET     20
+#define SF2_PHDR_BANK       22
+#define SF2_PHDR_BAG        24
+#define SF2_INST_SIZE       22
+#define SF2_INST_BAG        20
+#define SF2_BAG_SIZE        4
+#define SF2_GEN_SIZE        4
+#define SF2_SHDR_SIZE       46
+#define SF2_SHDR_START      20
+#define SF2_SHDR_END        24
+#define SF2_SHDR_LOOP_START 28
+#define SF2_SHDR_LOOP_END   32
+#define SF2_SHDR_RATE       36
+#define SF2_SHDR_PITCH      40
+#define SF2_SHDR_CORRECTION 41
+#define SF2_SHDR_TYPE       44
+#define SF2_ROM             0x8000
+
+/* generators, by number */
+#define GEN_START           0
+#define GEN_END             1
+#define GEN_LOOP_START      2
+#define GEN_LOOP_END        3
+#define GEN_START_COARSE    4
+#define GEN_END_COARSE      12
+#define GEN_PAN             17
+#define GEN_DELAY           33
+#define GEN_ATTACK          34
+#define GEN_HOLD            35
+#define GEN_DECAY           36
+#define GEN_SUSTAIN         37
+#define GEN_RELEASE         38
+#define GEN_KEY_HOLD        39
+#define GEN_KEY_DECAY       40
+#define GEN_INSTRUMENT      41
+#define GEN_KEY_RANGE       43
+#define GEN_VEL_RANGE       44
+#define GEN_LOOP_START_COARSE 45
+#define GEN_KEY             46
+#define GEN_ATTEN           48
+#define GEN_LOOP_END_COARSE 50
+#define GEN_COARSE_TUNE     51
+#define GEN_FINE_TUNE       52
+#define GEN_SAMPLE          53
+#define GEN_MODE            54
+#define GEN_SCALE           56
+#define GEN_EXCLUSIVE       57
+#define GEN_ROOT            58
+#define SF2_GENS            61
+#define COARSE_SHIFT        15
+#define FULL_RANGE          0x7F00
+#define SF2_MODE_MASK       3
+
+/* generator limits */
+#define TC_MIN              (-12000)
+#define TC_MAX              8000
+#define TC_KEY_MAX          1200
+#define MAX_ATTEN           1440
+#define MAX_PAN             500
+#define DEF_SCALE           100
+#define DEF_ROOT            60
+#define MIN_RATE            400
+#define MAX_RATE            200000
+
+/* an envelope runs its decay and release over 96 dB, after which a voice
+ * is silent; timecents are 1200 log2 of seconds */
+#define WT_SILENT           960
+#define TC_PER_OCTAVE       1200
+#define BLOCKS_PER_SEC      (WT_RATE / WT_BLOCK)
+#define AMP_ONE             (1 << Q16_SHIFT)
+#define CUT_BLOCKS          2
+
+/* velocity, volume and expression each follow 40 log10, which is 120.41
+ * cB per halving; Q8 */
+#define CB_PER_LOG2         30825
+#define CB_SHIFT            24
+
+/* pitch, in cents, kept within eight octaves of the sample's own */
+#define CENTS_PER_KEY       100
+#define MAX_CENTS           9600
+#define MAX_STEP            (64 << Q16_SHIFT)
+
+/* voice volumes are Q24 so ramps are smooth; the mix takes them as Q14,
+ * and one voice at full level comes out at half scale */
+#define VOL_SHIFT           24
+#define GAIN_SHIFT          10
+#define PRODUCT_SHIFT       4
+#define MIX_SHIFT           11
+
+/* controller defaults */
+#define MIDI_MAX            127
+#define DEF_VOLUME          100
+#define DEF_PAN             64
+#define DEF_BEND_RANGE      2
+#define MAX_BEND_RANGE      24
+#define PEDAL_DOWN          64
+#define RPN_NONE            0x3FFF
+#define RPN_BEND_RANGE      0
+#define BEND_SHIFT          13
+#define US_PER_SEC          1000000
+
+/* records and counts of the pdta lists, as read into the hydra */
+typedef struct wt_hydra {
+    const uint8_t* rec[SF2_LISTS];
+    uint32_t n[SF2_LISTS];
+} wt_hydra_t;
+
+static const uint32_t sf2_list_id[SF2_LISTS] = {
+    0x72646870, 0x67616270, 0x6E656770,     /* phdr, pbag, pgen */
+    0x74736E69, 0x67616269, 0x6E656769,     /* inst, ibag, igen */
+    0x72646873                              /* shdr */
+};
+
+static const uint32_t sf2_rec_size[SF2_LISTS] = {
+    SF2_PHDR_SIZE, SF2_BAG_SIZE, SF2_GEN_SIZE,
+    SF2_INST_SIZE, SF2_BAG_SIZE, SF2_GEN_SIZE,
+    SF2_SHDR_SIZE
+};
+
+
+/* local function definitions */
+static int32_t wt_bank_load(wavetable_t* wt, const uint8_t* name);
+static int32_t wt_bank_read(wavetable_t* wt, int32_t fd, wt_hydra_t* h);
+static int32_t wt_fread(int32_t fd, void* buf, uint32_t len);
+static int32_t wt_skip(int32_t fd, uint32_t len);
+static void wt_presets(wavetable_t* wt, const wt_hydra_t* h);
+static void wt_instrument(wavetable_t* wt, const wt_hydra_t* h, uint32_t inst,
+                          const int16_t* pgen);
+static void wt_region(wavetable_t* wt, const wt_hydra_t* h, const int16_t* igen,
+                      const int16_t* pgen);
+static int32_t wt_zone(const wt_hydra_t* h, uint32_t bag, uint32_t z, int16_t* gen);
+static void wt_gen_init(int16_t* gen, int32_t inst);
+static int32_t wt_clamp(int32_t val, int32_t lo, int32_t hi);
+static void wt_restart(wavetable_t* wt);
+static void wt_reset(wavetable_t* wt);
+static void wt_block(wavetable_t* wt);
+static void wt_event(wavetable_t* wt, const midi_event_t* ev);
+static void wt_note_on(wavetable_t* wt, uint32_t chan, uint32_t key, uint32_t velocity);
+static void wt_note_off(wavetable_t* wt, uint32_t chan, uint32_t key);
+static void wt_control(wavetable_t* wt, uint32_t chan, uint32_t cc, uint32_t val);
+static void wt_release(wavetable_t* wt, uint32_t chan, uint32_t held_only);
+static uint32_t wt_alloc(wavetable_t* wt);
+static void wt_start(wavetable_t* wt, uint32_t v, const wt_region_t* rg, uint32_t chan,
+                     uint32_t key, uint32_t velocity);
+static void wt_key_off(wavetable_t* wt, uint32_t v);
+static void wt_cut(wavetable_t* wt, uint32_t v);
+static void wt_pitch(wavetable_t* wt, uint32_t v);
+static void wt_pan(wavetable_t* wt, uint32_t v);
+static void wt_envelope(wavetable_t* wt, uint32_t v);
+static int32_t wt_atten(uint32_t scale, uint32_t full);
+static uint32_t wt_blocks(int32_t tc);
+static void wt_mix(wavetable_t* wt, int16_t* dst, uint32_t frames);
+static void wt_mix_voice(wavetable_t* wt, uint32_t v, uint32_t frames);
+static void wt_advance(wavetable_t* wt, uint32_t v, uint32_t frames);
+static uint32_t rd32(const uint8_t* p);
+static uint16_t rd16(const uint8_t* p);
+
+
+/* wt_open
+ *
+ * 		DESCRIPTION: opens a MIDI file on the synthesizer. The sound bank is
+ *		             read with the first song and kept, so later songs
+ *		             start without loading it again.
+ *		INPUTS: wt -- synthesizer state
+ *		        fname -- name of the MIDI file
+ *		        bank_name -- name of the SoundFont 2 bank
+ *		        loop -- 1 to play the song forever, 0 to end it once its
+ *		                last notes have rung out
+ *		OUTPUTS: wt -- the song, positioned at its start
+ *		RETURN VALUE: 0 on success, WT_NOT_MIDI if the file isn't MIDI, -1
+ *		              on fail
+ *		SIDE EFFECTS: reads the whole file, and the bank the first time
+ */
+int32_t wt_open(wavetable_t* wt, const uint8_t* fname, const uint8_t* bank_name,
+                int32_t loop) {
+
+    int32_t ret;
+
+    if ((ret = midi_open(&wt->midi, fname)) != 0)
+        return ret == MIDI_NOT_SMF ? WT_NOT_MIDI : -1;
+
+    if (!wt->loaded) {
+        if (wt_bank_load(wt, bank_name) == -1) {
+            ece391_fdputs(1, (uint8_t*)"no usable sound bank\n");
+            return -1;
+        }
+        wt->loaded = 1;
+    }
+
+    wt->loop = loop ? 1 : 0;
+    wt->cap = WT_MAX_VOICES;
+    wt_restart(wt);
+
+    return 0;
+}
+
+
+/* wt_read
+ *
+ * 		DESCRIPTION: renders the song a block at a time; events, envelopes
+ *		             and controllers change at block boundaries, and a
+ *		             read may start or stop inside a block
+ *		INPUTS: wt -- synthesizer state
+ *		        dst -- destination
+ *		        len -- bytes wanted, in whole frames
+ *		OUTPUTS: dst -- 16-bit stereo PCM
+ *		RETURN VALUE: bytes rendered, fewer than wanted once the song has
+ *		              ended
+ *		SIDE EFFECTS: none
+ */
+int32_t wt_read(wavetable_t* wt, int8_t* dst, uint32_t len) {
+
+    int16_t* out = (int16_t*)dst;
+    uint32_t frames = len / WT_FRAME_SIZE;
+    uint32_t done = 0;
+    uint32_t n;
+
+    while (done < frames) {
+        if (!wt->block_left) {
+            if (wt->end) break;
+            wt_block(wt);
+            continue;
+        }
+
+        n = frames - done;
+        if (n > wt->block_left) n = wt->block_left;
+        wt_mix(wt, out + done * 2, n);
+
+        wt->block_left -= n;
+        wt->frame += n;
+        done += n;
+    }
+
+    return done * WT_FRAME_SIZE;
+}
+
+
+/* wt_seek
+ *
+ * 		DESCRIPTION: plays the song up to a frame without mixing it, from
+ *		             the start if the frame is behind; voices move and
+ *		             ramp as they would have in the mix
+ *		INPUTS: wt -- synthesizer state
+ *		        frame -- frame of the song
+ *		OUTPUTS: wt -- song position
+ *		RETURN VALUE: 0
+ *		SIDE EFFECTS: none
+ */
+int32_t wt_seek(wavetable_t* wt, uint32_t frame) {
+
+    uint32_t n, v;
+
+    if (frame < wt->frame) wt_restart(wt);
+
+    while (wt->frame < frame) {
+        if (!wt->block_left) {
+            if (wt->end) break;
+            wt_block(wt);
+            continue;
+        }
+
+        n = frame - wt->frame;
+        if (n > wt->block_left) n = wt->block_left;
+        for (v = 0; v < WT_MAX_VOICES; v++) {
+            if (wt->v_on[v]) wt_advance(wt, v, n);
+        }
+
+        wt->block_left -= n;
+        wt->frame += n;
+    }
+
+    return 0;
+}
+
+
+/* wt_close
+ *
+ * 		DESCRIPTION: ends the song; the bank stays loaded for the next one
+ *		INPUTS: wt -- synthesizer state
+ *		OUTPUTS: wt -- ended
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void wt_close(wavetable_t* wt) {
+
+    wt->end = 1;
+    wt->block_left = 0;
+}
+
+
+/* wt_bank_load
+ *
+ * 		DESCRIPTION: reads a SoundFont 2 bank: its samples go straight into
+ *		             the sample pool, and its preset, instrument and sample
+ *		             lists are worked out into regions
+ *		INPUTS: wt -- synthesizer state
+ *		        name -- name of the bank file
+ *		OUTPUTS: wt -- samples, regions and the presets' regions
+ *		RETURN VALUE: 0 on success, -1 if there's no bank or it has nothing
+ *		              playable
+ *		SIDE EFFECTS: none
+ */
+static int32_t wt_bank_load(wavetable_t* wt, const uint8_t* name) {
+
+    wt_hydra_t h;
+    int32_t fd, ret;
+
+    if ((fd = ece391_open(name)) == -1) return -1;
+    ret = wt_bank_read(wt, fd, &h);
+    ece391_close(fd);
+    if (ret == -1) return -1;
+
+    wt_presets(wt, &h);
+
+    return wt->nregions ? 0 : -1;
+}
+
+
+/* wt_bank_read
+ *
+ * 		DESCRIPTION: walks the chunks of the bank file. The sdta and pdta
+ *		             lists are entered as if their chunks were at the top,
+ *		             and chunks that aren't needed are read past.
+ *		INPUTS: wt -- synthesizer state
+ *		        fd -- the open bank file
+ *		OUTPUTS: wt -- samples and hydra
+ *		         h -- the lists in the hydra
+ *		RETURN VALUE: 0 on success, -1 if the file isn't a whole bank or
+ *		              doesn't fit
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wt_bank_read(wavetable_t* wt, int32_t fd, wt_hydra_t* h) {
+
+    uint8_t hdr[SF2_RIFF_HDR];
+    uint32_t i, id, size, used = 0;
+
+    for (i = 0; i < SF2_LISTS; i++) h->n[i] = 0;
+    wt->nsamples = 0;
+
+    if (wt_fread(fd, hdr, SF2_RIFF_HDR) == -1 || rd32(hdr) != SF2_RIFF_ID ||
+            rd32(hdr + 2 * SF2_ID_LEN) != SF2_SFBK_ID)
+        return -1;
+
+    while (wt_fread(fd, hdr, SF2_CHUNK_HDR) == 0) {
+        id = rd32(hdr);
+        size = rd32(hdr + SF2_ID_LEN);
+
+        if (id == SF2_LIST_ID) {
+            if (wt_fread(fd, hdr, SF2_ID_LEN) == -1) return -1;
+            continue;
+        }
+        size += size & 1;
+
+        if (id == SF2_SMPL_ID) {
+            if (size / sizeof(int16_t) > WT_SAMPLE_WORDS) {
+                ece391_fdputs(1, (uint8_t*)"sound bank too large\n");
+                return -1;
+            }
+            if (wt_fread(fd, wt->samples, size) == -1) return -1;
+            wt->nsamples = size / sizeof(int16_t);
+            continue;
+        }
+
+        for (i = 0; i < SF2_LISTS && id != sf2_list_id[i]; i++);
+        if (i == SF2_LISTS) {
+            if (wt_skip(fd, size) == -1) return -1;
+            continue;
+        }
+        if (used + size > WT_HYDRA_SIZE) {
+            ece391_fdputs(1, (uint8_t*)"sound bank too large\n");
+            return -1;
+        }
+        if (wt_fread(fd, wt->hydra + used, size) == -1) return -1;
+        h->rec[i] = wt->hydra + used;
+        h->n[i] = size / sf2_rec_size[i];
+        used += size;
+    }
+
+    /* every list needs its closing record, and the sample after the last
+     * is read by the interpolation */
+    for (i = 0; i < SF2_LISTS; i++) {
+        if (h->n[i] < 2) return -1;
+    }
+    if (!wt->nsamples) return -1;
+    wt->samples[wt->nsamples] = 0;
+
+    return 0;
+}
+
+
+/* wt_fread
+ *
+ * 		DESCRIPTION: reads exactly len bytes of the bank file
+ *		INPUTS: fd -- the open file
+ *		        buf -- destination
+ *		        len -- number of bytes
+ *		OUTPUTS: buf -- the bytes
+ *		RETURN VALUE: 0 on success, -1 if the file ends first
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wt_fread(int32_t fd, void* buf, uint32_t len) {
+
+    uint8_t* p = buf;
+    int32_t got;
+
+    while (len) {
+        if ((got = ece391_read(fd, p, len)) <= 0) return -1;
+        p += got;
+        len -= got;
+    }
+
+    return 0;
+}
+
+
+/* wt_skip
+ *
+ * 		DESCRIPTION: reads past bytes of the bank file, as there's no seek
+ *		INPUTS: fd -- the open file
+ *		        len -- number of bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: 0 on success, -1 if the file ends first
+ *		SIDE EFFECTS: advances the file
+ */
+static int32_t wt_skip(int32_t fd, uint32_t len) {
+
+    uint8_t buf[SKIP_SIZE];
+    uint32_t n;
+
+    while (len) {
+        n = len < SKIP_SIZE ? len : SKIP_SIZE;
+        if (wt_fread(fd, buf, n) == -1) return -1;
+        len -= n;
+    }
+
+    return 0;
+}
+
+
+/* wt_presets
+ *
+ * 		DESCRIPTION: works out the regions of the presets General MIDI
+ *		             uses: the programs of bank 0 and the kits of bank 128.
+ *		             Each preset zone's generators, on top of its global
+ *		             zone's, apply to every region of its instrument.
+ *		INPUTS: wt -- synthesizer state
+ *		        h -- the lists
+ *		OUTPUTS: wt -- regions, in runs by preset
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_presets(wavetable_t* wt, const wt_hydra_t* h) {
+
+    int16_t glob[SF2_GENS], gen[SF2_GENS];
+    const uint8_t* ph;
+    uint32_t p, i, z, z0, z1, slot, bank, prog;
+    int32_t inst;
+
+    for (p = 0; p < WT_PRESETS; p++) wt->preset_count[p] = 0;
+    wt->nregions = 0;
+
+    for (p = 0; p + 1 < h->n[SF2_PHDR]; p++) {
+        ph = h->rec[SF2_PHDR] + p * SF2_PHDR_SIZE;
+        prog = rd16(ph + SF2_PHDR_PRESET);
+        bank = rd16(ph + SF2_PHDR_BANK);
+        if (prog >= WT_PROGRAMS || (bank && bank != WT_DRUM_BANK)) continue;
+        slot = bank ? WT_PROGRAMS + prog : prog;
+        if (wt->preset_count[slot]) continue;
+
+        z0 = rd16(ph + SF2_PHDR_BAG);
+        z1 = rd16(ph + SF2_PHDR_SIZE + SF2_PHDR_BAG);
+        if (z0 > z1 || z1 >= h->n[SF2_PBAG]) continue;
+
+        /* a first zone with no instrument is the global zone */
+        wt->preset_first[slot] = wt->nregions;
+        wt_gen_init(glob, 0);
+        for (z = z0; z < z1; z++) {
+            for (i = 0; i < SF2_GENS; i++) gen[i] = glob[i];
+            if ((inst = wt_zone(h, SF2_PBAG, z, gen)) != -1) {
+                wt_instrument(wt, h, inst, gen);
+            } else if (z == z0) {
+                for (i = 0; i < SF2_GENS; i++) glob[i] = gen[i];
+            }
+        }
+        wt->preset_count[slot] = wt->nregions - wt->preset_first[slot];
+    }
+}
+
+
+/* wt_instrument
+ *
+ * 		DESCRIPTION: adds a region for each zone of an instrument, with the
+ *		             instrument's global zone under the zone's own
+ *		             generators and the preset zone's added on top
+ *		INPUTS: wt -- synthesizer state
+ *		        h -- the lists
+ *		        inst -- instrument number
+ *		        pgen -- the preset zone's generators
+ *		OUTPUTS: wt -- regions
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_instrument(wavetable_t* wt, const wt_hydra_t* h, uint32_t inst,
+                          const int16_t* pgen) {
+
+    int16_t glob[SF2_GENS], gen[SF2_GENS];
+    const uint8_t* in;
+    uint32_t i, z, z0, z1;
+
+    if (inst + 1 >= h->n[SF2_INST]) return;
+    in = h->rec[SF2_INST] + inst * SF2_INST_SIZE;
+    z0 = rd16(in + SF2_INST_BAG);
+    z1 = rd16(in + SF2_INST_SIZE + SF2_INST_BAG);
+    if (z0 > z1 || z1 >= h->n[SF2_IBAG]) return;
+
+    wt_gen_init(glob, 1);
+    for (z = z0; z < z1; z++) {
+        for (i = 0; i < SF2_GENS; i++) gen[i] = glob[i];
+        if (wt_zone(h, SF2_IBAG, z, gen) != -1) {
+            wt_region(wt, h, gen, pgen);
+        } else if (z == z0) {
+            for (i = 0; i < SF2_GENS; i++) glob[i] = gen[i];
+        }
+    }
+}
+
+
+/* wt_region
+ *
+ * 		DESCRIPTION: adds a region from an instrument zone and the preset
+ *		             zone it's played through. Ranges are intersected, and
+ *		             pitch, level, pan and envelope generators add; the
+ *		             sample and its offsets come from the instrument alone.
+ *		             Regions whose sample doesn't lie in the pool are left
+ *		             out, as are loops that don't lie in their sample.
+ *		INPUTS: wt -- synthesizer state
+ *		        h -- the lists
+ *		        igen -- the instrument zone's generators
+ *		        pgen -- the preset zone's generators
+ *		OUTPUTS: wt -- the region
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_region(wavetable_t* wt, const wt_hydra_t* h, const int16_t* igen,
+                      const int16_t* pgen) {
+
+    wt_region_t* rg = &wt->region[wt->nregions];
+    const uint8_t* sh;
+    uint32_t s = (uint16_t)igen[GEN_SAMPLE];
+    uint32_t lo, hi, vlo, vhi;
+
+    if (wt->nregions == WT_MAX_REGIONS || s + 1 >= h->n[SF2_SHDR]) return;
+    sh = h->rec[SF2_SHDR] + s * SF2_SHDR_SIZE;
+    if (rd16(sh + SF2_SHDR_TYPE) & SF2_ROM) return;
+
+    /* ranges are low in the first byte, high in the second */
+    lo = igen[GEN_KEY_RANGE] & 0xFF;
+    if (lo < (pgen[GEN_KEY_RANGE] & 0xFF)) lo = pgen[GEN_KEY_RANGE] & 0xFF;
+    hi = (igen[GEN_KEY_RANGE] >> 8) & 0xFF;
+    if (hi > ((pgen[GEN_KEY_RANGE] >> 8) & 0xFF)) hi = (pgen[GEN_KEY_RANGE] >> 8) & 0xFF;
+    vlo = igen[GEN_VEL_RANGE] & 0xFF;
+    if (vlo < (pgen[GEN_VEL_RANGE] & 0xFF)) vlo = pgen[GEN_VEL_RANGE] & 0xFF;
+    vhi = (igen[GEN_VEL_RANGE] >> 8) & 0xFF;
+    if (vhi > ((pgen[GEN_VEL_RANGE] >> 8) & 0xFF)) vhi = (pgen[GEN_VEL_RANGE] >> 8) & 0xFF;
+    if (lo > hi || vlo > vhi || hi > MIDI_MAX || vhi > MIDI_MAX) return;
+
+    rg->start = rd32(sh + SF2_SHDR_START) + igen[GEN_START] +
+                igen[GEN_START_COARSE] * (1 << COARSE_SHIFT);
+    rg->end = rd32(sh + SF2_SHDR_END) + igen[GEN_END] +
+              igen[GEN_END_COARSE] * (1 << COARSE_SHIFT);
+    rg->loop_start = rd32(sh + SF2_SHDR_LOOP_START) + igen[GEN_LOOP_START] +
+                     igen[GEN_LOOP_START_COARSE] * (1 << COARSE_SHIFT);
+    rg->loop_end = rd32(sh + SF2_SHDR_LOOP_END) + igen[GEN_LOOP_END] +
+                   igen[GEN_LOOP_END_COARSE] * (1 << COARSE_SHIFT);
+    rg->rate = rd32(sh + SF2_SHDR_RATE);
+    if (rg->start >= rg->end || rg->end > wt->nsamples ||
+            rg->rate < MIN_RATE || rg->rate > MAX_RATE)
+        return;
+
+    rg->mode = igen[GEN_MODE] & SF2_MODE_MASK;
+    if (rg->mode != WT_LOOP_ON && rg->mode != WT_LOOP_RELEASE) rg->mode = WT_LOOP_NONE;
+    if (rg->loop_start < rg->start || rg->loop_start >= rg->loop_end ||
+            rg->loop_end > rg->end)
+        rg->mode = WT_LOOP_NONE;
+
+    rg->key_lo = lo;
+    rg->key_hi = hi;
+    rg->vel_lo = vlo;
+    rg->vel_hi = vhi;
+    rg->root = igen[GEN_ROOT];
+    if (rg->root < 0 || rg->root > MIDI_MAX) rg->root = sh[SF2_SHDR_PITCH];
+    if (rg->root > MIDI_MAX) rg->root = DEF_ROOT;
+    rg->key = igen[GEN_KEY] <= MIDI_MAX ? igen[GEN_KEY] : -1;
+    rg->tune = (igen[GEN_COARSE_TUNE] + pgen[GEN_COARSE_TUNE]) * CENTS_PER_KEY +
+               igen[GEN_FINE_TUNE] + pgen[GEN_FINE_TUNE] + (int8_t)sh[SF2_SHDR_CORRECTION];
+    rg->scale = igen[GEN_SCALE] + pgen[GEN_SCALE];
+    rg->atten = wt_clamp(igen[GEN_ATTEN] + pgen[GEN_ATTEN], 0, MAX_ATTEN);
+    rg->pan = wt_clamp(igen[GEN_PAN] + pgen[GEN_PAN], -MAX_PAN, MAX_PAN);
+    rg->exclusive = igen[GEN_EXCLUSIVE] > 0 ? igen[GEN_EXCLUSIVE] : 0;
+    rg->delay = wt_clamp(igen[GEN_DELAY] + pgen[GEN_DELAY], TC_MIN, TC_MAX);
+    rg->attack = wt_clamp(igen[GEN_ATTACK] + pgen[GEN_ATTACK], TC_MIN, TC_MAX);
+    rg->hold = wt_clamp(igen[GEN_HOLD] + pgen[GEN_HOLD], TC_MIN, TC_MAX);
+    rg->decay = wt_clamp(igen[GEN_DECAY] + pgen[GEN_DECAY], TC_MIN, TC_MAX);
+    rg->sustain = wt_clamp(igen[GEN_SUSTAIN] + pgen[GEN_SUSTAIN], 0, WT_SILENT);
+    rg->release = wt_clamp(igen[GEN_RELEASE] + pgen[GEN_RELEASE], TC_MIN, TC_MAX);
+    rg->key_hold = wt_clamp(igen[GEN_KEY_HOLD] + pgen[GEN_KEY_HOLD], -TC_KEY_MAX, TC_KEY_MAX);
+    rg->key_decay = wt_clamp(igen[GEN_KEY_DECAY] + pgen[GEN_KEY_DECAY], -TC_KEY_MAX,
+                             TC_KEY_MAX);
+
+    wt->nregions++;
+}
+
+
+/* wt_zone
+ *
+ * 		DESCRIPTION: applies a zone's generators over those given, up to the
+ *		             instrument or sample generator that must end it
+ *		INPUTS: h -- the lists
+ *		        bag -- SF2_PBAG for a preset zone, SF2_IBAG for an
+ *		               instrument's
+ *		        z -- zone number
+ *		        gen -- generators so far
+ *		OUTPUTS: gen -- with the zone's applied
+ *		RETURN VALUE: the instrument or sample the zone plays, -1 for a
+ *		              zone with none, which is global if it comes first
+ *		SIDE EFFECTS: none
+ */
+static int32_t wt_zone(const wt_hydra_t* h, uint32_t bag, uint32_t z, int16_t* gen) {
+
+    const uint8_t* b = h->rec[bag] + z * SF2_BAG_SIZE;
+    const uint8_t* g;
+    uint32_t last = bag == SF2_PBAG ? GEN_INSTRUMENT : GEN_SAMPLE;
+    uint32_t i, oper, g0 = rd16(b), g1 = rd16(b + SF2_BAG_SIZE);
+
+    if (g0 > g1 || g1 >= h->n[bag + 1]) return -1;
+
+    for (i = g0; i < g1; i++) {
+        g = h->rec[bag + 1] + i * SF2_GEN_SIZE;
+        oper = rd16(g);
+        if (oper >= SF2_GENS) continue;
+        gen[oper] = (int16_t)rd16(g + 2);
+        if (oper == last) return (uint16_t)gen[oper];
+    }
+
+    return -1;
+}
+
+
+/* wt_gen_init
+ *
+ * 		DESCRIPTION: sets generators to their defaults; at the preset level
+ *		             they add to the instrument's, so all but the ranges
+ *		             are 0
+ *		INPUTS: inst -- 1 for an instrument zone, 0 for a preset zone
+ *		OUTPUTS: gen -- the generators
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_gen_init(int16_t* gen, int32_t inst) {
+
+    uint32_t i;
+
+    for (i = 0; i < SF2_GENS; i++) gen[i] = 0;
+    gen[GEN_KEY_RANGE] = FULL_RANGE;
+    gen[GEN_VEL_RANGE] = FULL_RANGE;
+    if (!inst) return;
+
+    for (i = GEN_DELAY; i <= GEN_RELEASE; i++) {
+        if (i != GEN_SUSTAIN) gen[i] = TC_MIN;
+    }
+    gen[GEN_SCALE] = DEF_SCALE;
+    gen[GEN_KEY] = -1;
+    gen[GEN_ROOT] = -1;
+}
+
+
+/* wt_clamp
+ *
+ * 		DESCRIPTION: keeps a value within a range
+ *		INPUTS: val -- the value
+ *		        lo, hi -- the range
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value, clamped
+ *		SIDE EFFECTS: none
+ */
+static int32_t wt_clamp(int32_t val, int32_t lo, int32_t hi) {
+
+    return val < lo ? lo : val > hi ? hi : val;
+}
+
+
+/* wt_restart
+ *
+ * 		DESCRIPTION: goes back to the start of the song with every voice
+ *		             silent
+ *		INPUTS: wt -- synthesizer state
+ *		OUTPUTS: wt -- song position, voices and controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_restart(wavetable_t* wt) {
+
+    uint32_t v;
+
+    midi_rewind(&wt->midi);
+    for (v = 0; v < WT_MAX_VOICES; v++) wt->v_on[v] = 0;
+    wt_reset(wt);
+
+    wt->clock = 0;
+    wt->carry = 0;
+    wt->block_left = 0;
+    wt->frame = 0;
+    wt->ending = 0;
+    wt->end = 0;
+}
+
+
+/* wt_reset
+ *
+ * 		DESCRIPTION: releases every voice and puts every channel back to
+ *		             program 0 with default controllers, as at the start of
+ *		             a song
+ *		INPUTS: wt -- synthesizer state
+ *		OUTPUTS: wt -- released voices and default controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_reset(wavetable_t* wt) {
+
+    wt_chan_t* ch;
+    uint32_t i;
+
+    for (i = 0; i < WT_MAX_VOICES; i++) {
+        if (wt->v_on[i]) wt_key_off(wt, i);
+    }
+
+    for (i = 0; i < MIDI_CHANNELS; i++) {
+        ch = &wt->chan[i];
+        ch->program = 0;
+        ch->volume = DEF_VOLUME;
+        ch->expression = MIDI_MAX;
+        ch->pan = DEF_PAN;
+        ch->sustain = 0;
+        ch->rpn = RPN_NONE;
+        ch->bend = 0;
+        ch->bend_range = DEF_BEND_RANGE;
+        ch->atten = wt_atten(ch->volume * ch->expression, MIDI_MAX * MIDI_MAX);
+    }
+}
+
+
+/* wt_block
+ *
+ * 		DESCRIPTION: starts a block: the song moves on by its length, with
+ *		             the microseconds that don't make a whole one carried,
+ *		             the events that fall due are played, and each voice's
+ *		             envelope sets the volume it ramps to. When the song
+ *		             runs out it starts over if looping; otherwise its
+ *		             notes are released and it ends once they're silent.
+ *		INPUTS: wt -- synthesizer state
+ *		OUTPUTS: wt -- voices, and a block to mix or the end
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_block(wavetable_t* wt) {
+
+    midi_event_t ev;
+    uint32_t us, v, sounding = 0;
+    int32_t ret;
+
+    wt->carry += WT_BLOCK * US_PER_SEC;
+    us = wt->carry / WT_RATE;
+    wt->carry -= us * WT_RATE;
+
+    if (!wt->ending) {
+        midi_advance(&wt->midi, us);
+        while ((ret = midi_next(&wt->midi, &ev)) == 1) wt_event(wt, &ev);
+        if (ret == -1 && wt->loop) {
+            midi_rewind(&wt->midi);
+            wt_reset(wt);
+        } else if (ret == -1) {
+            wt->ending = 1;
+            for (v = 0; v < MIDI_CHANNELS; v++) wt_release(wt, v, 0);
+        }
+    }
+
+    for (v = 0; v < WT_MAX_VOICES; v++) {
+        if (!wt->v_on[v]) continue;
+        wt_envelope(wt, v);
+        sounding |= wt->v_on[v];
+    }
+
+    if (wt->ending && !sounding) {
+        wt->end = 1;
+        return;
+    }
+    wt->block_left = WT_BLOCK;
+}
+
+
+/* wt_event
+ *
+ * 		DESCRIPTION: plays one MIDI event; system exclusive and pressure
+ *		             are ignored
+ *		INPUTS: wt -- synthesizer state
+ *		        ev -- the event
+ *		OUTPUTS: wt -- voices and controllers
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_event(wavetable_t* wt, const midi_event_t* ev) {
+
+    uint32_t type = ev->status & MIDI_TYPE_MASK;
+    uint32_t chan = ev->status & MIDI_CHAN_MASK;
+    wt_chan_t* ch = &wt->chan[chan];
+    uint32_t i;
+
+    if (ev->status >= MIDI_SYSEX) return;
+
+    if (type == MIDI_NOTE_ON && ev->data2) {
+        wt_note_on(wt, chan, ev->data1, ev->data2);
+    } else if (type == MIDI_NOTE_ON || type == MIDI_NOTE_OFF) {
+        wt_note_off(wt, chan, ev->data1);
+    } else if (type == MIDI_CONTROL) {
+        wt_control(wt, chan, ev->data1, ev->data2);
+    } else if (type == MIDI_PROGRAM) {
+        ch->program = ev->data1;
+    } else if (type == MIDI_PITCH_BEND) {
+        /* a full bend is the range in semitones, and the centre is Q13 */
+        ch->bend = (((int32_t)(ev->data1 | (ev->data2 << 7)) - MIDI_BEND_CENTRE) *
+                    (int32_t)ch->bend_range * CENTS_PER_KEY) >> BEND_SHIFT;
+        for (i = 0; i < WT_MAX_VOICES; i++) {
+            if (wt->v_on[i] && wt->voice[i].chan == chan) wt_pitch(wt, i);
+        }
+    }
+}
+
+
+/* wt_note_on
+ *
+ * 		DESCRIPTION: starts a voice for each region of the channel's preset
+ *		             that covers the key and velocity. Channel 10 plays the
+ *		             kits of bank 128, and a program the bank lacks falls
+ *		             back to the piano or standard kit. A key already
+ *		             sounding on the channel is released first, and a
+ *		             region with an exclusive class cuts off the channel's
+ *		             earlier voices of that class, as an open hi-hat is
+ *		             choked by a closed one.
+ *		INPUTS: wt -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        key -- note number
+ *		        velocity -- 1 to 127
+ *		OUTPUTS: wt -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_note_on(wavetable_t* wt, uint32_t chan, uint32_t key, uint32_t velocity) {
+
+    const wt_region_t* rg;
+    uint32_t i, r, slot, first, count;
+    uint32_t base = chan == MIDI_DRUMS ? WT_PROGRAMS : 0;
+    uint32_t age = wt->clock;
+
+    slot = base + wt->chan[chan].program;
+    if (!wt->preset_count[slot]) slot = base;
+    first = wt->preset_first[slot];
+    count = wt->preset_count[slot];
+
+    for (i = 0; i < WT_MAX_VOICES; i++) {
+        if (wt->v_on[i] && wt->voice[i].down && wt->voice[i].chan == chan &&
+                wt->voice[i].key == key)
+            wt_key_off(wt, i);
+    }
+
+    for (r = first; r < first + count; r++) {
+        rg = &wt->region[r];
+        if (key < rg->key_lo || key > rg->key_hi ||
+                velocity < rg->vel_lo || velocity > rg->vel_hi)
+            continue;
+
+        if (rg->exclusive) {
+            for (i = 0; i < WT_MAX_VOICES; i++) {
+                if (wt->v_on[i] && wt->voice[i].chan == chan && wt->voice[i].age < age &&
+                        wt->voice[i].rg->exclusive == rg->exclusive)
+                    wt_cut(wt, i);
+            }
+        }
+
+        wt_start(wt, wt_alloc(wt), rg, chan, key, velocity);
+    }
+}
+
+
+/* wt_note_off
+ *
+ * 		DESCRIPTION: releases the voices playing a key, or marks them to be
+ *		             released when the sustain pedal comes up
+ *		INPUTS: wt -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        key -- note number
+ *		OUTPUTS: wt -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_note_off(wavetable_t* wt, uint32_t chan, uint32_t key) {
+
+    uint32_t i;
+
+    for (i = 0; i < WT_MAX_VOICES; i++) {
+        if (!wt->v_on[i] || !wt->voice[i].down || wt->voice[i].chan != chan ||
+                wt->voice[i].key != key)
+            continue;
+        if (wt->chan[chan].sustain) wt->voice[i].held = 1;
+        else wt_key_off(wt, i);
+    }
+}
+
+
+/* wt_control
+ *
+ * 		DESCRIPTION: applies a controller change: volume and expression
+ *		             take effect at the next block, pan moves the channel's
+ *		             voices as they sound, and the pitch bend range is set
+ *		             through RPN 0
+ *		INPUTS: wt -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        cc -- controller number
+ *		        val -- its value
+ *		OUTPUTS: wt -- the channel and its voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_control(wavetable_t* wt, uint32_t chan, uint32_t cc, uint32_t val) {
+
+    wt_chan_t* ch = &wt->chan[chan];
+    uint32_t i;
+
+    if (cc == MIDI_CC_VOLUME || cc == MIDI_CC_EXPRESSION) {
+        if (cc == MIDI_CC_VOLUME) ch->volume = val;
+        else ch->expression = val;
+        ch->atten = wt_atten(ch->volume * ch->expression, MIDI_MAX * MIDI_MAX);
+    } else if (cc == MIDI_CC_PAN) {
+        ch->pan = val;
+        for (i = 0; i < WT_MAX_VOICES; i++) {
+            if (wt->v_on[i] && wt->voice[i].chan == chan) wt_pan(wt, i);
+        }
+    } else if (cc == MIDI_CC_SUSTAIN) {
+        ch->sustain = val >= PEDAL_DOWN;
+        if (!ch->sustain) wt_release(wt, chan, 1);
+    } else if (cc == MIDI_CC_RPN_HI) {
+        ch->rpn = (ch->rpn & 0x7F) | (val << 7);
+    } else if (cc == MIDI_CC_RPN_LO) {
+        ch->rpn = (ch->rpn & (0x7F << 7)) | val;
+    } else if (cc == MIDI_CC_NRPN_HI || cc == MIDI_CC_NRPN_LO) {
+        ch->rpn = RPN_NONE;
+    } else if (cc == MIDI_CC_DATA) {
+        if (ch->rpn == RPN_BEND_RANGE)
+            ch->bend_range = val > MAX_BEND_RANGE ? MAX_BEND_RANGE : val;
+    } else if (cc == MIDI_CC_RESET) {
+        ch->expression = MIDI_MAX;
+        ch->sustain = 0;
+        ch->rpn = RPN_NONE;
+        ch->bend = 0;
+        ch->atten = wt_atten(ch->volume * ch->expression, MIDI_MAX * MIDI_MAX);
+        wt_release(wt, chan, 1);
+        for (i = 0; i < WT_MAX_VOICES; i++) {
+            if (wt->v_on[i] && wt->voice[i].chan == chan) wt_pitch(wt, i);
+        }
+    } else if (cc == MIDI_CC_SOUND_OFF) {
+        for (i = 0; i < WT_MAX_VOICES; i++) {
+            if (wt->v_on[i] && wt->voice[i].chan == chan) wt_cut(wt, i);
+        }
+    } else if (cc == MIDI_CC_NOTES_OFF) {
+        wt_release(wt, chan, 0);
+    }
+}
+
+
+/* wt_release
+ *
+ * 		DESCRIPTION: releases a channel's keyed voices
+ *		INPUTS: wt -- synthesizer state
+ *		        chan -- MIDI channel
+ *		        held_only -- 1 for only those the pedal was holding
+ *		OUTPUTS: wt -- the voices
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_release(wavetable_t* wt, uint32_t chan, uint32_t held_only) {
+
+    uint32_t i;
+
+    for (i = 0; i < WT_MAX_VOICES; i++) {
+        if (!wt->v_on[i] || !wt->voice[i].down || wt->voice[i].chan != chan) continue;
+        if (held_only && !wt->voice[i].held) continue;
+        wt_key_off(wt, i);
+    }
+}
+
+
+/* wt_alloc
+ *
+ * 		DESCRIPTION: picks a voice for a new note from those under the cap:
+ *		             a silent one, else the quietest released one, else the
+ *		             oldest one the pedal holds, then the oldest one keyed
+ *		INPUTS: wt -- synthesizer state
+ *		OUTPUTS: none
+ *		RETURN VALUE: the voice
+ *		SIDE EFFECTS: none
+ */
+static uint32_t wt_alloc(wavetable_t* wt) {
+
+    const wt_voice_t* vc;
+    uint32_t i, rank, best = 0, best_rank = 3;
+
+    for (i = 0; i < wt->cap; i++) {
+        if (!wt->v_on[i]) return i;
+
+        vc = &wt->voice[i];
+        rank = !vc->down ? 0 : vc->held ? 1 : 2;
+        if (rank < best_rank ||
+                (rank == best_rank && (rank ? vc->age < wt->voice[best].age
+                                            : vc->env > wt->voice[best].env))) {
+            best = i;
+            best_rank = rank;
+        }
+    }
+
+    return best;
+}
+
+
+/* wt_start
+ *
+ * 		DESCRIPTION: starts a voice on a region's sample. The envelope's
+ *		             stage lengths are worked out now, with hold and decay
+ *		             scaled by the key; the voice comes in from silence at
+ *		             the next block.
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		        rg -- the region
+ *		        chan -- MIDI channel
+ *		        key -- note number
+ *		        velocity -- 1 to 127
+ *		OUTPUTS: wt -- the voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_start(wavetable_t* wt, uint32_t v, const wt_region_t* rg, uint32_t chan,
+                     uint32_t key, uint32_t velocity) {
+
+    wt_voice_t* vc = &wt->voice[v];
+    int32_t note = rg->key >= 0 ? rg->key : (int32_t)key;
+
+    vc->rg = rg;
+    vc->chan = chan;
+    vc->key = key;
+    vc->down = 1;
+    vc->held = 0;
+    vc->age = wt->clock++;
+    vc->atten = wt_atten(velocity, MIDI_MAX);
+
+    vc->stage = WT_ENV_DELAY;
+    vc->left = rg->delay > TC_MIN ? wt_blocks(rg->delay) : 0;
+    vc->amp = 0;
+    vc->amp_step = AMP_ONE / wt_blocks(rg->attack);
+    vc->hold_blocks = wt_blocks(rg->hold + (DEF_ROOT - note) * rg->key_hold);
+    vc->env = 0;
+    vc->decay_step = (WT_SILENT << Q16_SHIFT) /
+                     wt_blocks(rg->decay + (DEF_ROOT - note) * rg->key_decay);
+    vc->release_step = (WT_SILENT << Q16_SHIFT) / wt_blocks(rg->release);
+    vc->sustain = rg->sustain << Q16_SHIFT;
+
+    wt->v_on[v] = 1;
+    wt->v_pos[v] = rg->start;
+    wt->v_frac[v] = 0;
+    wt->v_end[v] = rg->mode != WT_LOOP_NONE ? rg->loop_end : rg->end;
+    wt->v_loop_len[v] = rg->mode != WT_LOOP_NONE ? rg->loop_end - rg->loop_start : 0;
+    wt->v_vol_l[v] = wt->v_vol_r[v] = 0;
+    wt->v_dvol_l[v] = wt->v_dvol_r[v] = 0;
+
+    wt_pitch(wt, v);
+    wt_pan(wt, v);
+}
+
+
+/* wt_key_off
+ *
+ * 		DESCRIPTION: moves a voice to its release; a sample that loops only
+ *		             while the key is down plays on to its end
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: wt -- the voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_key_off(wavetable_t* wt, uint32_t v) {
+
+    wt_voice_t* vc = &wt->voice[v];
+
+    vc->down = 0;
+    vc->held = 0;
+    if (vc->stage < WT_ENV_RELEASE) vc->stage = WT_ENV_RELEASE;
+    if (vc->rg->mode == WT_LOOP_RELEASE) {
+        wt->v_end[v] = vc->rg->end;
+        wt->v_loop_len[v] = 0;
+    }
+}
+
+
+/* wt_cut
+ *
+ * 		DESCRIPTION: releases a voice over a couple of blocks, whatever its
+ *		             own release, for exclusive classes and sound off
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: wt -- the voice
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_cut(wavetable_t* wt, uint32_t v) {
+
+    wt_key_off(wt, v);
+    wt->voice[v].release_step = (WT_SILENT << Q16_SHIFT) / CUT_BLOCKS;
+}
+
+
+/* wt_pitch
+ *
+ * 		DESCRIPTION: sets a voice's step through its sample for its note,
+ *		             tuning and the channel's bend; the sample's rate is
+ *		             scaled by 2^(cents / 1200) and taken to the output's
+ *		             rate
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: wt -- the voice's step
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_pitch(wavetable_t* wt, uint32_t v) {
+
+    const wt_voice_t* vc = &wt->voice[v];
+    const wt_region_t* rg = vc->rg;
+    int32_t note = rg->key >= 0 ? rg->key : (int32_t)vc->key;
+    int32_t cents = (note - rg->root) * rg->scale + rg->tune;
+    uint32_t ratio;
+    int64_t step;
+
+    /* drums ignore the bend */
+    if (vc->chan != MIDI_DRUMS) cents += wt->chan[vc->chan].bend;
+    cents = wt_clamp(cents, -MAX_CENTS, MAX_CENTS);
+
+    ratio = fix_pow2(cents * (1 << Q16_SHIFT) / TC_PER_OCTAVE);
+    step = fix_qdiv((uint64_t)ratio * rg->rate, WT_RATE, 0);
+    wt->v_step[v] = step > MAX_STEP ? MAX_STEP : step;
+}
+
+
+/* wt_pan
+ *
+ * 		DESCRIPTION: sets a voice's share of left and right from the
+ *		             region's pan and the channel's, with equal power
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: wt -- the voice's pan
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_pan(wavetable_t* wt, uint32_t v) {
+
+    wt_voice_t* vc = &wt->voice[v];
+    int32_t pan = vc->rg->pan + ((int32_t)wt->chan[vc->chan].pan - DEF_PAN) * MAX_PAN / DEF_PAN;
+    uint32_t phase;
+
+    pan = wt_clamp(pan, -MAX_PAN, MAX_PAN);
+    phase = (uint32_t)(pan + MAX_PAN) * (PHASE_QUARTER / (2 * MAX_PAN));
+    vc->pan_l = fix_cos(phase);
+    vc->pan_r = fix_sin(phase);
+}
+
+
+/* wt_envelope
+ *
+ * 		DESCRIPTION: moves a voice's envelope on by a block and sets the
+ *		             volumes it ramps to across the block. The attack
+ *		             climbs in amplitude; decay and release fall in cB, at
+ *		             96 dB over the stage's time, and a voice is done once
+ *		             they reach it, ramping to silence over one more block.
+ *		             Its level adds the region's, the velocity's and the
+ *		             channel's attenuation to the envelope's.
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		OUTPUTS: wt -- the voice's envelope and volume ramp
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: turns the voice off if it was done
+ */
+static void wt_envelope(wavetable_t* wt, uint32_t v) {
+
+    wt_voice_t* vc = &wt->voice[v];
+    uint32_t gain = 0;
+    int32_t atten, target_l, target_r;
+
+    if (vc->stage == WT_ENV_DONE) {
+        wt->v_on[v] = 0;
+        return;
+    }
+
+    if (vc->stage == WT_ENV_DELAY) {
+        if (vc->left) vc->left--;
+        else vc->stage = WT_ENV_ATTACK;
+    }
+    if (vc->stage == WT_ENV_ATTACK) {
+        vc->amp += vc->amp_step;
+        if (vc->amp >= AMP_ONE) {
+            vc->amp = AMP_ONE;
+            vc->stage = WT_ENV_HOLD;
+            vc->left = vc->hold_blocks;
+        }
+    } else if (vc->stage == WT_ENV_HOLD) {
+        if (vc->left) vc->left--;
+        else vc->stage = WT_ENV_DECAY;
+    } else if (vc->stage == WT_ENV_DECAY) {
+        vc->env += vc->decay_step;
+        if (vc->env >= vc->sustain) {
+            vc->env = vc->sustain;
+            vc->stage = WT_ENV_SUSTAIN;
+        }
+    } else if (vc->stage == WT_ENV_RELEASE) {
+        vc->env += vc->release_step;
+    }
+    if (vc->env >= WT_SILENT << Q16_SHIFT) vc->stage = WT_ENV_DONE;
+
+    atten = vc->rg->atten + vc->atten + wt->chan[vc->chan].atten + (vc->env >> Q16_SHIFT);
+    if (vc->stage != WT_ENV_DONE && atten < WT_SILENT)
+        gain = ((uint64_t)fix_db_gain(-atten) * vc->amp) >> Q16_SHIFT;
+
+    target_l = ((uint64_t)gain * vc->pan_l) >> (Q16_SHIFT + Q15_SHIFT - VOL_SHIFT);
+    target_r = ((uint64_t)gain * vc->pan_r) >> (Q16_SHIFT + Q15_SHIFT - VOL_SHIFT);
+    wt->v_dvol_l[v] = (target_l - wt->v_vol_l[v]) >> WT_BLOCK_BITS;
+    wt->v_dvol_r[v] = (target_r - wt->v_vol_r[v]) >> WT_BLOCK_BITS;
+}
+
+
+/* wt_atten
+ *
+ * 		DESCRIPTION: turns a velocity, or a product of controllers, into
+ *		             attenuation at 40 log10 of its fraction of full scale
+ *		INPUTS: scale -- the value
+ *		        full -- its full scale
+ *		OUTPUTS: none
+ *		RETURN VALUE: attenuation in cB, WT_SILENT for 0
+ *		SIDE EFFECTS: none
+ */
+static int32_t wt_atten(uint32_t scale, uint32_t full) {
+
+    int32_t diff;
+
+    if (!scale) return WT_SILENT;
+    diff = fix_log2(full) - fix_log2(scale);
+
+    return ((int64_t)diff * CB_PER_LOG2) >> CB_SHIFT;
+}
+
+
+/* wt_blocks
+ *
+ * 		DESCRIPTION: converts an envelope time to blocks
+ *		INPUTS: tc -- time in timecents
+ *		OUTPUTS: none
+ *		RETURN VALUE: number of blocks, at least 1
+ *		SIDE EFFECTS: none
+ */
+static uint32_t wt_blocks(int32_t tc) {
+
+    uint32_t n;
+
+    tc = wt_clamp(tc, TC_MIN, TC_MAX);
+    n = ((uint64_t)fix_pow2(tc * (1 << Q16_SHIFT) / TC_PER_OCTAVE) * BLOCKS_PER_SEC) >>
+        Q16_SHIFT;
+
+    return n ? n : 1;
+}
+
+
+/* wt_mix
+ *
+ * 		DESCRIPTION: mixes the sounding voices into part of a block.
+ *		             Voices ramping from and to silence aren't mixed, only
+ *		             moved on.
+ *		INPUTS: wt -- synthesizer state
+ *		        dst -- destination
+ *		        frames -- number of frames, no more than are left in the
+ *		                  block
+ *		OUTPUTS: dst -- 16-bit stereo PCM
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_mix(wavetable_t* wt, int16_t* dst, uint32_t frames) {
+
+    int32_t* mix = wt->mix;
+    uint32_t i, v;
+
+    for (i = 0; i < frames * 2; i++) mix[i] = 0;
+    for (v = 0; v < WT_MAX_VOICES; v++) {
+        if (!wt->v_on[v]) continue;
+        if (wt->v_vol_l[v] || wt->v_vol_r[v] || wt->v_dvol_l[v] || wt->v_dvol_r[v])
+            wt_mix_voice(wt, v, frames);
+        else
+            wt_advance(wt, v, frames);
+    }
+
+    for (i = 0; i < frames * 2; i++) dst[i] = fix_sat16(mix[i] >> MIX_SHIFT);
+}
+
+
+/* wt_mix_voice
+ *
+ * 		DESCRIPTION: adds a voice into the mix, interpolating linearly
+ *		             between samples and stepping its volumes along their
+ *		             ramps. At the end of the sample the voice goes back by
+ *		             the loop's length, or stops.
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		        frames -- number of frames
+ *		OUTPUTS: wt -- mix, and the voice's position and volumes
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_mix_voice(wavetable_t* wt, uint32_t v, uint32_t frames) {
+
+    const int16_t* data = wt->samples;
+    int32_t* out = wt->mix;
+    uint32_t pos = wt->v_pos[v];
+    uint32_t frac = wt->v_frac[v];
+    uint32_t step = wt->v_step[v];
+    uint32_t end = wt->v_end[v];
+    uint32_t loop_len = wt->v_loop_len[v];
+    int32_t vol_l = wt->v_vol_l[v];
+    int32_t vol_r = wt->v_vol_r[v];
+    int32_t dvol_l = wt->v_dvol_l[v];
+    int32_t dvol_r = wt->v_dvol_r[v];
+    int32_t a, s;
+
+    while (frames--) {
+        a = data[pos];
+        s = a + (((data[pos + 1] - a) * (int32_t)(frac >> 1)) >> (Q16_SHIFT - 1));
+        out[0] += (s * (vol_l >> GAIN_SHIFT)) >> PRODUCT_SHIFT;
+        out[1] += (s * (vol_r >> GAIN_SHIFT)) >> PRODUCT_SHIFT;
+        out += 2;
+        vol_l += dvol_l;
+        vol_r += dvol_r;
+
+        frac += step;
+        pos += frac >> Q16_SHIFT;
+        frac &= (1 << Q16_SHIFT) - 1;
+        if (pos >= end) {
+            if (!loop_len) {
+                wt->v_on[v] = 0;
+                break;
+            }
+            while (pos >= end) pos -= loop_len;
+        }
+    }
+
+    wt->v_pos[v] = pos;
+    wt->v_frac[v] = frac;
+    wt->v_vol_l[v] = vol_l;
+    wt->v_vol_r[v] = vol_r;
+}
+
+
+/* wt_advance
+ *
+ * 		DESCRIPTION: moves a voice on as wt_mix_voice would without mixing
+ *		             it, for silent voices and seeking
+ *		INPUTS: wt -- synthesizer state
+ *		        v -- voice
+ *		        frames -- number of frames
+ *		OUTPUTS: wt -- the voice's position and volumes
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+static void wt_advance(wavetable_t* wt, uint32_t v, uint32_t frames) {
+
+    uint64_t total = (uint64_t)wt->v_step[v] * frames + wt->v_frac[v];
+    uint64_t pos = wt->v_pos[v] + (total >> Q16_SHIFT);
+    uint32_t end = wt->v_end[v];
+    uint32_t loop_len = wt->v_loop_len[v];
+
+    wt->v_vol_l[v] += wt->v_dvol_l[v] * (int32_t)frames;
+    wt->v_vol_r[v] += wt->v_dvol_r[v] * (int32_t)frames;
+    wt->v_frac[v] = total & ((1 << Q16_SHIFT) - 1);
+    if (pos >= end) {
+        if (!loop_len) {
+            wt->v_on[v] = 0;
+            return;
+        }
+        pos = end - loop_len + (uint32_t)(pos - end) % loop_len;
+    }
+    wt->v_pos[v] = pos;
+}
+
+
+/* rd32
+ *
+ * 		DESCRIPTION: reads a little-endian 32-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint32_t rd32(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+/* rd16
+ *
+ * 		DESCRIPTION: reads a little-endian 16-bit value
+ *		INPUTS: p -- bytes
+ *		OUTPUTS: none
+ *		RETURN VALUE: the value
+ *		SIDE EFFECTS: none
+ */
+static uint16_t rd16(const uint8_t* p) {
+
+    return p[0] | (p[1] << 8);
+}
@@ -0,0 +1,174 @@
+/* wavetable.h - Sample-based General MIDI synthesizer definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _WAVETABLE_H
+#define _WAVETABLE_H
+
+#include <stdint.h>
+#include "midi.h"
+
+/* songs are rendered as 16-bit stereo at one rate, like modules */
+#define WT_RATE             44100
+#define WT_FRAME_SIZE       4
+
+/* returned by wt_open for a file that isn't a Standard MIDI File */
+#define WT_NOT_MIDI         (-2)
+
+/* SoundFont 2 bank, loaded with the first song and kept for the rest */
+#define WT_BANK_FILE        "gm.sf2"
+
+/* voices that can sound at once; wt_open allows all of them, and the cap
+ * can be lowered to bound the cost of a period */
+#define WT_MAX_VOICES       64
+
+/* events, envelopes and controllers are applied once a block, and
+ * volume changes are ramped across it */
+#define WT_BLOCK_BITS       5
+#define WT_BLOCK            (1 << WT_BLOCK_BITS)
+
+/* the bank's sample data in 16-bit words, the rest of the bank as it is
+ * in the file, and the zones it works out to; a megabyte of samples keeps
+ * the synthesizer no bigger than the module player, which it shares its
+ * memory with */
+#define WT_SAMPLE_WORDS     (1 << 19)
+#define WT_HYDRA_SIZE       (1 << 18)
+#define WT_MAX_REGIONS      4096
+
+/* melodic programs of bank 0, then the drum kits of bank 128 */
+#define WT_PROGRAMS         128
+#define WT_PRESETS          (WT_PROGRAMS * 2)
+#define WT_DRUM_BANK        128
+
+/* sample modes */
+#define WT_LOOP_NONE        0
+#define WT_LOOP_ON          1
+#define WT_LOOP_RELEASE     3
+
+/* envelope stages */
+#define WT_ENV_DELAY        0
+#define WT_ENV_ATTACK       1
+#define WT_ENV_HOLD         2
+#define WT_ENV_DECAY        3
+#define WT_ENV_SUSTAIN      4
+#define WT_ENV_RELEASE      5
+#define WT_ENV_DONE         6
+
+/* a sample and how it plays over a range of keys and velocities, with the
+ * preset's generators added to the instrument's */
+typedef struct wt_region {
+    uint8_t key_lo;
+    uint8_t key_hi;
+    uint8_t vel_lo;
+    uint8_t vel_hi;
+    uint32_t start;         /* in the bank's sample data, end exclusive */
+    uint32_t end;
+    uint32_t loop_start;
+    uint32_t loop_end;
+    uint32_t mode;          /* WT_LOOP_NONE, WT_LOOP_ON or WT_LOOP_RELEASE */
+    uint32_t rate;
+    int32_t root;           /* key the sample plays at its own rate */
+    int32_t key;            /* key it always plays as, -1 for none */
+    int32_t tune;           /* cents */
+    int32_t scale;          /* cents per key */
+    int32_t atten;          /* cB */
+    int32_t pan;            /* -500 to 500 */
+    uint32_t exclusive;     /* class that cuts the others off, 0 for none */
+    int32_t delay;          /* volume envelope, timecents and cB */
+    int32_t attack;
+    int32_t hold;
+    int32_t decay;
+    int32_t sustain;
+    int32_t release;
+    int32_t key_hold;       /* timecents per key below 60 */
+    int32_t key_decay;
+} wt_region_t;
+
+typedef struct wt_chan {
+    uint32_t program;
+    uint32_t volume;
+    uint32_t expression;
+    uint32_t pan;
+    uint32_t sustain;       /* 1 while the pedal is down */
+    uint32_t rpn;           /* registered parameter selected, 0x3FFF for none */
+    int32_t bend;           /* cents */
+    uint32_t bend_range;    /* semitones */
+    int32_t atten;          /* cB from volume and expression */
+} wt_chan_t;
+
+/* a voice's notes and envelope, updated once a block */
+typedef struct wt_voice {
+    const wt_region_t* rg;
+    uint32_t chan;
+    uint32_t key;           /* note as played, for its note off */
+    uint32_t down;          /* 1 while the key is held */
+    uint32_t held;          /* 1 if released while the pedal was down */
+    uint32_t age;
+    int32_t atten;          /* cB from velocity */
+    int32_t pan_l;          /* Q15 */
+    int32_t pan_r;
+    uint32_t stage;
+    uint32_t left;          /* blocks left in the delay or hold */
+    uint32_t amp;           /* Q16, climbing through the attack */
+    uint32_t amp_step;
+    uint32_t hold_blocks;
+    int32_t env;            /* cB in Q16, falling through decay and release */
+    int32_t decay_step;
+    int32_t release_step;
+    int32_t sustain;
+} wt_voice_t;
+
+/* bank, song and voices; the voices the mixer reads are kept as one array
+ * per field, as in the module player */
+typedef struct wavetable {
+    midi_t midi;
+    uint32_t loop;          /* 1 to play the song forever */
+    uint32_t cap;           /* voices allowed to sound */
+    uint32_t loaded;        /* 1 once the bank is in */
+    uint32_t nsamples;
+    uint32_t nregions;
+    uint16_t preset_first[WT_PRESETS];
+    uint16_t preset_count[WT_PRESETS];
+    wt_region_t region[WT_MAX_REGIONS];
+    wt_chan_t chan[MIDI_CHANNELS];
+    wt_voice_t voice[WT_MAX_VOICES];
+    uint32_t clock;         /* notes started, for voice ages */
+    uint32_t carry;         /* microseconds times WT_RATE not yet played */
+    uint32_t block_left;    /* frames left in the block */
+    uint32_t frame;         /* frames rendered since the start */
+    uint32_t ending;        /* 1 once the song is over and its tails ring */
+    uint32_t end;
+
+    /* voices */
+    uint32_t v_on[WT_MAX_VOICES];
+    uint32_t v_pos[WT_MAX_VOICES];
+    uint32_t v_frac[WT_MAX_VOICES];         /* Q16 */
+    uint32_t v_step[WT_MAX_VOICES];         /* Q16 samples per frame */
+    uint32_t v_end[WT_MAX_VOICES];
+    uint32_t v_loop_len[WT_MAX_VOICES];     /* 0 if the sample stops */
+    int32_t v_vol_l[WT_MAX_VOICES];         /* Q14 */
+    int32_t v_vol_r[WT_MAX_VOICES];
+    int32_t v_dvol_l[WT_MAX_VOICES];        /* per frame */
+    int32_t v_dvol_r[WT_MAX_VOICES];
+
+    int32_t mix[WT_BLOCK * 2];
+    uint8_t hydra[WT_HYDRA_SIZE];
+    int16_t samples[WT_SAMPLE_WORDS + 1];   /* with a guard sample */
+} wavetable_t;
+
+
+/* opens a MIDI file, loading the sound bank if it isn't already */
+int32_t wt_open(wavetable_t* wt, const uint8_t* fname, const uint8_t* bank_name,
+                int32_t loop);
+
+/* renders the next len bytes of 16-bit stereo */
+int32_t wt_read(wavetable_t* wt, int8_t* dst, uint32_t len);
+
+/* moves to a frame of the song, so the next read starts there */
+int32_t wt_seek(wavetable_t* wt, uint32_t frame);
+
+/* releases the song; the bank stays loaded */
+void wt_close(wavetable_t* wt);
+
+
+#endif
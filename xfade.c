@@ -0,0 +1,71 @@
+/* xfade.c - Equal-power crossfade between consecutive streams.
+ * Written by Soumithri Bala. */
+
+
+#include "xfade.h"
+#include "fixmath.h"
+
+
+/* xfade_start
+ *
+ * 		DESCRIPTION: starts a crossfade
+ *		INPUTS: xf -- crossfade state
+ *		        frames -- length of the fade in frames
+ *		OUTPUTS: xf -- state at the start of the fade
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: none
+ */
+void xfade_start(xfade_t* xf, uint32_t frames) {
+
+    xf->phase = 0;
+    xf->step = frames ? PHASE_QUARTER / frames : PHASE_QUARTER;
+}
+
+
+/* xfade_mix
+ *
+ * 		DESCRIPTION: mixes the incoming stream into the outgoing one with
+ *		             sin/cos gains, so the summed power stays constant
+ *		INPUTS: xf -- crossfade state
+ *		        bus -- outgoing stream on the mix bus, mixed in place
+ *		        in -- incoming stream
+ *		        frames -- number of frames to mix
+ *		        channels -- samples per frame
+ *		        in_gain -- gain on the incoming stream in Q16
+ *		OUTPUTS: bus -- mixed frames, unclipped
+ *		RETURN VALUE: none
+ *		SIDE EFFECTS: advances the fade
+ */
+void xfade_mix(xfade_t* xf, int32_t* bus, const int16_t* in, uint32_t frames,
+               uint32_t channels, uint32_t in_gain) {
+
+    uint32_t n, i, c, end;
+    int32_t g_out, g_in, d_out, d_in, g;
+
+    while (frames) {
+        n = frames < XFADE_RAMP ? frames : XFADE_RAMP;
+
+        /* look up the curve only at the ends of each short run, and ramp
+         * the gains linearly in between */
+        end = xf->phase + xf->step * n;
+        if (end > PHASE_QUARTER || end < xf->phase) end = PHASE_QUARTER;
+        g_out = fix_cos(xf->phase) << 8;
+        g_in = fix_sin(xf->phase) << 8;
+        d_out = ((fix_cos(end) << 8) - g_out) / (int32_t)n;
+        d_in = ((fix_sin(end) << 8) - g_in) / (int32_t)n;
+
+        for (i = 0; i < n; i++) {
+            g = (int32_t)(((int64_t)(g_in >> 8) * in_gain) >> 16);
+            for (c = 0; c < channels; c++) {
+                *bus = (int32_t)(((int64_t)*bus * (g_out >> 8) + (int64_t)*in * g) >> Q15_SHIFT);
+                bus++;
+                in++;
+            }
+            g_out += d_out;
+            g_in += d_in;
+        }
+
+        xf->phase = end;
+        frames -= n;
+    }
+}
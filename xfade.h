@@ -0,0 +1,27 @@
+/* xfade.h - Equal-power crossfade definitions.
+ * Written by Soumithri Bala. */
+
+
+#ifndef _XFADE_H
+#define _XFADE_H
+
+#include <stdint.h>
+
+#define XFADE_RAMP          32
+
+/* position along a crossfade */
+typedef struct xfade {
+    uint32_t phase;     /* quarter turn over the whole fade */
+    uint32_t step;      /* phase advance per frame */
+} xfade_t;
+
+
+/* starts a crossfade of the given number of frames */
+void xfade_start(xfade_t* xf, uint32_t frames);
+
+/* mixes incoming frames into the outgoing ones on the mix bus */
+void xfade_mix(xfade_t* xf, int32_t* bus, const int16_t* in, uint32_t frames,
+               uint32_t channels, uint32_t in_gain);
+
+
+#endif